@@ -0,0 +1,494 @@
+//=================================================================================================
+//
+//  D3D12 Memory Pool Performance Test
+//  by MJP
+//  https://therealmjp.github.io/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#include <PCH.h>
+
+#include <Utility.h>
+
+#include "AccessPatterns.h"
+#include "SharedTypes.h"
+
+static const uint64 ElemSize = sizeof(Float4);
+static const uint64 IndexSize = sizeof(uint32);
+
+bool AccessPatternUsesIndexBuffer(AccessPatterns pattern)
+{
+    return pattern == AccessPatterns::RandomPermutation || pattern == AccessPatterns::StridedGather ||
+           pattern == AccessPatterns::SparseBlocks;
+}
+
+bool AccessPatternUsesTargetBuffer(AccessPatterns pattern)
+{
+    return pattern == AccessPatterns::WriteOnly || pattern == AccessPatterns::ReadModifyWrite;
+}
+
+static uint32 SparseBlockSize(const AccessPatternDesc& desc)
+{
+    return Clamp(desc.SparseBlockSize, 1u, desc.NumInputElems);
+}
+
+uint32 NumAccessPatternIndices(const AccessPatternDesc& desc)
+{
+    if(desc.Pattern == AccessPatterns::RandomPermutation || desc.Pattern == AccessPatterns::StridedGather ||
+       desc.Pattern == AccessPatterns::PointerChase)
+        return desc.NumInputElems;
+
+    if(desc.Pattern == AccessPatterns::SparseBlocks)
+    {
+        const uint32 blockSize = SparseBlockSize(desc);
+        const uint32 numBlocks = desc.NumInputElems / blockSize;
+        return ((numBlocks + SparseBlockSpacing - 1) / SparseBlockSpacing) * blockSize;
+    }
+
+    return 0;
+}
+
+void GenerateAccessPatternIndices(const AccessPatternDesc& desc, Array<uint32>& indices)
+{
+    Assert_(desc.NumInputElems > 0);
+
+    const uint32 numElems = desc.NumInputElems;
+    const uint32 numIndices = NumAccessPatternIndices(desc);
+    indices.Init(numIndices);
+    if(numIndices == 0)
+        return;
+
+    Random random;
+    random.SeedWithValue(desc.Seed);
+
+    if(desc.Pattern == AccessPatterns::RandomPermutation)
+    {
+        // Fisher-Yates shuffle
+        for(uint32 i = 0; i < numElems; ++i)
+            indices[i] = i;
+        for(uint32 i = numElems - 1; i > 0; --i)
+            Swap(indices[i], indices[random.RandomUint() % (i + 1)]);
+    }
+    else if(desc.Pattern == AccessPatterns::StridedGather)
+    {
+        // Neighboring indices are GatherStride elements apart, and every time they wrap around the end of the buffer
+        // they shift over by one element. That visits every element exactly once as long as the number of elements
+        // is a multiple of the stride.
+        const uint64 stride = Max(desc.GatherStride, 1u);
+        for(uint32 i = 0; i < numElems; ++i)
+        {
+            const uint64 offset = i * stride;
+            indices[i] = uint32((offset + offset / numElems) % numElems);
+        }
+    }
+    else if(desc.Pattern == AccessPatterns::PointerChase)
+    {
+        // Sattolo's algorithm, which only produces permutations that are a single cycle
+        for(uint32 i = 0; i < numElems; ++i)
+            indices[i] = i;
+        for(uint32 i = numElems - 1; i > 0; --i)
+            Swap(indices[i], indices[random.RandomUint() % i]);
+    }
+    else if(desc.Pattern == AccessPatterns::SparseBlocks)
+    {
+        const uint32 blockSize = SparseBlockSize(desc);
+        const uint32 numBlocks = numElems / blockSize;
+
+        uint32 indexIdx = 0;
+        for(uint32 firstBlock = 0; firstBlock < numBlocks; firstBlock += SparseBlockSpacing)
+        {
+            const uint32 numCandidates = Min(SparseBlockSpacing, numBlocks - firstBlock);
+            const uint32 block = firstBlock + random.RandomUint() % numCandidates;
+            for(uint32 i = 0; i < blockSize; ++i)
+                indices[indexIdx++] = block * blockSize + i;
+        }
+
+        Assert_(indexIdx == numIndices);
+    }
+    else
+    {
+        AssertFail_("Unhandled access pattern");
+    }
+}
+
+void FillAccessPatternInput(const AccessPatternDesc& desc, const Array<uint32>& indices, Array<Float4>& inputData)
+{
+    Assert_(desc.NumInputElems > 0);
+
+    const bool pointerChase = desc.Pattern == AccessPatterns::PointerChase;
+    Assert_(pointerChase == false || indices.Size() == desc.NumInputElems);
+
+    inputData.Init(desc.NumInputElems);
+    for(uint32 i = 0; i < desc.NumInputElems; ++i)
+    {
+        const uint32 next = pointerChase ? indices[i] : i;
+        inputData[i] = Float4(float(i & AccessPatternValueMask), float(next >> ChaseIdxLowBits), float(next & ChaseIdxLowMask), 1.0f);
+    }
+}
+
+Float4 AccessPatternWriteValue(uint32 elemIdx)
+{
+    return Float4(float(elemIdx & AccessPatternValueMask), 1.0f, 2.0f, 3.0f);
+}
+
+static float ElemSum(const Float4& elem)
+{
+    return elem.x + elem.y + elem.z + elem.w;
+}
+
+// Calls func(threadIdx, elemIdx) for every element that the compute job accesses, in the same order as
+// ComputeJob.hlsl. The index math uses 32-bit wraparound just like the shader does.
+template<typename TFunc> static void ForEachAccess(const AccessPatternDesc& desc, const Array<uint32>& indices, TFunc func)
+{
+    Assert_(desc.NumInputElems > 0);
+
+    const uint32 numElems = desc.NumInputElems;
+    const uint32 numIndices = Max(NumAccessPatternIndices(desc), 1u);
+    const bool pointerChase = desc.Pattern == AccessPatterns::PointerChase;
+    const bool useIndexBuffer = AccessPatternUsesIndexBuffer(desc.Pattern);
+    Assert_(useIndexBuffer == false || indices.Size() == numIndices);
+    Assert_(pointerChase == false || indices.Size() == numElems);
+
+    const uint32 groupSize = uint32(AppSettings::ThreadGroupSize);
+    for(uint32 groupIdx = 0; groupIdx < desc.NumThreadGroups; ++groupIdx)
+    {
+        for(uint32 localThreadIdx = 0; localThreadIdx < groupSize; ++localThreadIdx)
+        {
+            const uint32 threadIdx = groupIdx * groupSize + localThreadIdx;
+
+            uint32 elemIdx = (desc.ElemsPerThread * groupSize * desc.GroupElemOffset * groupIdx) +
+                             (desc.ElemsPerThread * desc.ThreadElemOffset * localThreadIdx);
+            uint32 chaseIdx = elemIdx % numElems;
+            for(uint32 i = 0; i < desc.ElemsPerThread; ++i)
+            {
+                uint32 accessIdx = elemIdx % numElems;
+                if(pointerChase)
+                {
+                    accessIdx = chaseIdx;
+                    chaseIdx = indices[chaseIdx];
+                }
+                else if(useIndexBuffer)
+                {
+                    accessIdx = indices[elemIdx % numIndices];
+                }
+
+                func(threadIdx, accessIdx);
+
+                elemIdx += desc.ThreadElemStride;
+            }
+        }
+    }
+}
+
+AccessPatternStats ComputeAccessPatternStats(const AccessPatternDesc& desc, const Array<uint32>& indices)
+{
+    // One bit per element, for counting how many different elements were touched
+    Array<uint64> touchedElems((desc.NumInputElems + 63) / 64, 0);
+    uint64 numAccesses = 0;
+    uint64 numUniqueAccesses = 0;
+
+    ForEachAccess(desc, indices, [&](uint32, uint32 elemIdx)
+    {
+        numAccesses += 1;
+
+        uint64& touchedBits = touchedElems[elemIdx / 64];
+        const uint64 elemBit = 1ull << (elemIdx % 64);
+        if((touchedBits & elemBit) == 0)
+        {
+            touchedBits |= elemBit;
+            numUniqueAccesses += 1;
+        }
+    });
+
+    const bool reads = desc.Pattern != AccessPatterns::WriteOnly;
+    const bool writes = AccessPatternUsesTargetBuffer(desc.Pattern);
+
+    AccessPatternStats stats;
+    stats.BytesRead = reads ? numAccesses * ElemSize : 0;
+    stats.BytesWritten = writes ? numAccesses * ElemSize : 0;
+    stats.UniqueBytesRead = reads ? numUniqueAccesses * ElemSize : 0;
+    stats.UniqueBytesWritten = writes ? numUniqueAccesses * ElemSize : 0;
+    stats.IndexBytesRead = AccessPatternUsesIndexBuffer(desc.Pattern) ? numAccesses * IndexSize : 0;
+
+    return stats;
+}
+
+void RunAccessPatternReference(const AccessPatternDesc& desc, const Array<uint32>& indices, const Array<Float4>& inputData,
+                               Array<float>& threadSums, Array<Float4>& target)
+{
+    Assert_(inputData.Size() == desc.NumInputElems);
+    Assert_(AccessPatternUsesTargetBuffer(desc.Pattern) == false || target.Size() == desc.NumInputElems);
+
+    threadSums.Init(uint64(desc.NumThreadGroups) * AppSettings::ThreadGroupSize, 0.0f);
+
+    const AccessPatterns pattern = desc.Pattern;
+    ForEachAccess(desc, indices, [&](uint32 threadIdx, uint32 elemIdx)
+    {
+        if(pattern == AccessPatterns::WriteOnly)
+        {
+            target[elemIdx] = AccessPatternWriteValue(elemIdx);
+        }
+        else if(pattern == AccessPatterns::ReadModifyWrite)
+        {
+            // The shader keeps the max of the old and new values, and the previous dispatch already wrote
+            // the new value to every element that this one touches
+            const Float4 value = AccessPatternWriteValue(elemIdx);
+            threadSums[threadIdx] += ElemSum(value);
+            target[elemIdx] = value;
+        }
+        else
+        {
+            threadSums[threadIdx] += ElemSum(inputData[elemIdx]);
+        }
+    });
+}
+
+bool ValidateAccessPatternResults(const AccessPatternDesc& desc, const Array<uint32>& indices, const Array<Float4>& inputData,
+                                  const float* gpuThreadSums, const Float4* gpuTarget)
+{
+    Assert_(gpuThreadSums != nullptr);
+
+    const bool usesTarget = AccessPatternUsesTargetBuffer(desc.Pattern);
+    Assert_(usesTarget == false || gpuTarget != nullptr);
+
+    Array<float> threadSums;
+    Array<Float4> target(usesTarget ? desc.NumInputElems : 0, Float4());
+    RunAccessPatternReference(desc, indices, inputData, threadSums, target);
+
+    // Every value is a small integer, so the sums should match exactly regardless of the order they were added in
+    uint64 numSumMismatches = 0;
+    uint64 firstSumMismatch = uint64(-1);
+    for(uint64 threadIdx = 0; threadIdx < threadSums.Size(); ++threadIdx)
+    {
+        if(threadSums[threadIdx] != gpuThreadSums[threadIdx])
+        {
+            if(numSumMismatches == 0)
+                firstSumMismatch = threadIdx;
+            numSumMismatches += 1;
+        }
+    }
+
+    uint64 numTargetMismatches = 0;
+    uint64 firstTargetMismatch = uint64(-1);
+    for(uint64 elemIdx = 0; elemIdx < target.Size(); ++elemIdx)
+    {
+        const Float4& expected = target[elemIdx];
+        const Float4& actual = gpuTarget[elemIdx];
+        if(expected.x != actual.x || expected.y != actual.y || expected.z != actual.z || expected.w != actual.w)
+        {
+            if(numTargetMismatches == 0)
+                firstTargetMismatch = elemIdx;
+            numTargetMismatches += 1;
+        }
+    }
+
+    const bool passed = numSumMismatches == 0 && numTargetMismatches == 0;
+    WriteLog("Access pattern validation (%s, %u elements, %u thread groups, %u elements per thread): "
+             "%llu of %llu thread sums and %llu of %llu target elements mismatched -> %s",
+             AccessPatternsLabels[uint32(desc.Pattern)], desc.NumInputElems, desc.NumThreadGroups, desc.ElemsPerThread,
+             numSumMismatches, threadSums.Size(), numTargetMismatches, target.Size(), passed ? "PASSED" : "FAILED");
+
+    if(numSumMismatches > 0)
+        WriteLog("    Thread %llu summed to %f, expected %f", firstSumMismatch,
+                 gpuThreadSums[firstSumMismatch], threadSums[firstSumMismatch]);
+
+    if(numTargetMismatches > 0)
+    {
+        const Float4& expected = target[firstTargetMismatch];
+        const Float4& actual = gpuTarget[firstTargetMismatch];
+        WriteLog("    Target element %llu was (%f, %f, %f, %f), expected (%f, %f, %f, %f)", firstTargetMismatch,
+                 actual.x, actual.y, actual.z, actual.w, expected.x, expected.y, expected.z, expected.w);
+    }
+
+    return passed;
+}
+
+bool ValidateAccessPatternGenerators()
+{
+    // With these settings thread i reads elements [i * ElemsPerThread, (i + 1) * ElemsPerThread) before any indirection,
+    // so the linear addressing hits every element exactly once. The element count is a multiple of the gather stride,
+    // and the number of sparse blocks isn't a multiple of the block spacing.
+    AccessPatternDesc desc;
+    desc.NumInputElems = 5 * 1024;
+    desc.NumThreadGroups = 5;
+    desc.ElemsPerThread = 4;
+    desc.ThreadElemStride = 1;
+    desc.GroupElemOffset = 1;
+    desc.ThreadElemOffset = 1;
+    desc.GatherStride = 16;
+    desc.SparseBlockSize = 256;
+    desc.Seed = 1234;
+
+    const uint32 numElems = desc.NumInputElems;
+    const uint64 numThreads = uint64(desc.NumThreadGroups) * AppSettings::ThreadGroupSize;
+    const uint64 numAccesses = numThreads * desc.ElemsPerThread;
+
+    bool allPassed = true;
+    for(AccessPatterns pattern : AccessPatternsValues)
+    {
+        desc.Pattern = pattern;
+
+        const char* failure = nullptr;
+
+        Array<uint32> indices;
+        GenerateAccessPatternIndices(desc, indices);
+
+        Array<uint32> repeatedIndices;
+        GenerateAccessPatternIndices(desc, repeatedIndices);
+
+        Array<uint32> indexCounts(numElems, 0);
+        for(uint32 idx : indices)
+        {
+            if(idx >= numElems)
+                failure = "an index is out of bounds";
+            else
+                indexCounts[idx] += 1;
+        }
+
+        const bool permutation = pattern == AccessPatterns::RandomPermutation || pattern == AccessPatterns::StridedGather ||
+                                 pattern == AccessPatterns::PointerChase;
+
+        if(indices.Size() != NumAccessPatternIndices(desc))
+            failure = "the wrong number of indices were generated";
+        else if(indices.Size() > 0 && memcmp(indices.Data(), repeatedIndices.Data(), indices.MemorySize()) != 0)
+            failure = "the same seed produced different indices";
+
+        if(failure == nullptr && permutation)
+        {
+            for(uint32 count : indexCounts)
+            {
+                if(count != 1)
+                    failure = "the indices aren't a permutation";
+            }
+        }
+
+        if(failure == nullptr && pattern == AccessPatterns::RandomPermutation)
+        {
+            AccessPatternDesc otherSeedDesc = desc;
+            otherSeedDesc.Seed += 1;
+
+            Array<uint32> otherSeedIndices;
+            GenerateAccessPatternIndices(otherSeedDesc, otherSeedIndices);
+            if(memcmp(indices.Data(), otherSeedIndices.Data(), indices.MemorySize()) == 0)
+                failure = "a different seed produced the same indices";
+        }
+
+        if(failure == nullptr && pattern == AccessPatterns::PointerChase)
+        {
+            // Following the chain needs to visit every element before coming back around to the start
+            uint32 chaseIdx = indices[0];
+            uint32 cycleLength = 1;
+            while(chaseIdx != 0 && cycleLength <= numElems)
+            {
+                chaseIdx = indices[chaseIdx];
+                cycleLength += 1;
+            }
+
+            if(cycleLength != numElems)
+                failure = "the chain isn't a single cycle through every element";
+        }
+
+        if(failure == nullptr && pattern == AccessPatterns::SparseBlocks)
+        {
+            // Every block needs to be whole, and be the only one picked from its group of SparseBlockSpacing blocks
+            const uint32 blockSize = desc.SparseBlockSize;
+            for(uint64 i = 0; i < indices.Size() && failure == nullptr; ++i)
+            {
+                const uint32 runIdx = uint32(i / blockSize);
+                const uint32 block = indices[i] / blockSize;
+                if(indices[i] % blockSize != i % blockSize)
+                    failure = "a block is split up";
+                else if(block / SparseBlockSpacing != runIdx)
+                    failure = "a block was picked from the wrong group";
+            }
+
+            const uint32 numGroups = (numElems / blockSize + SparseBlockSpacing - 1) / SparseBlockSpacing;
+            if(failure == nullptr && indices.Size() != uint64(numGroups) * blockSize)
+                failure = "the wrong number of blocks were picked";
+        }
+
+        const bool reads = pattern != AccessPatterns::WriteOnly;
+        const bool writes = AccessPatternUsesTargetBuffer(pattern);
+        const bool indexed = AccessPatternUsesIndexBuffer(pattern);
+
+        // Pointer chasing follows the chain from where each thread starts, but every other pattern touches every
+        // element (or every element that the indices point to)
+        const uint64 numTouchedElems = indexed ? indices.Size() : numElems;
+        const AccessPatternStats stats = ComputeAccessPatternStats(desc, indices);
+        if(failure == nullptr)
+        {
+            if(stats.BytesRead != (reads ? numAccesses * ElemSize : 0) || stats.BytesWritten != (writes ? numAccesses * ElemSize : 0) ||
+               stats.IndexBytesRead != (indexed ? numAccesses * IndexSize : 0))
+                failure = "the stats have the wrong number of bytes accessed";
+            else if(pattern != AccessPatterns::PointerChase &&
+                    (stats.UniqueBytesRead != (reads ? numTouchedElems * ElemSize : 0) ||
+                     stats.UniqueBytesWritten != (writes ? numTouchedElems * ElemSize : 0)))
+                failure = "the stats have the wrong number of unique bytes accessed";
+            else if(stats.UniqueBytesRead > stats.BytesRead || stats.UniqueBytesWritten > stats.BytesWritten)
+                failure = "the stats have more unique bytes than total bytes";
+        }
+
+        Array<Float4> inputData;
+        FillAccessPatternInput(desc, indices, inputData);
+
+        Array<float> threadSums;
+        Array<Float4> target(numElems, Float4());
+        RunAccessPatternReference(desc, indices, inputData, threadSums, target);
+
+        if(failure == nullptr && pattern == AccessPatterns::PointerChase)
+        {
+            // Follow the chain through the input data the same way that the shader does, rather than through the indices
+            for(uint32 threadIdx = 0; threadIdx < numThreads && failure == nullptr; ++threadIdx)
+            {
+                uint32 chaseIdx = (threadIdx * desc.ElemsPerThread) % numElems;
+                float expectedSum = 0.0f;
+                for(uint32 i = 0; i < desc.ElemsPerThread; ++i)
+                {
+                    const Float4& elem = inputData[chaseIdx];
+                    expectedSum += ElemSum(elem);
+                    chaseIdx = (uint32(elem.y) << ChaseIdxLowBits) + uint32(elem.z);
+                }
+
+                if(threadSums[threadIdx] != expectedSum)
+                    failure = "a reference sum doesn't match following the chain through the input data";
+            }
+        }
+        else if(failure == nullptr && writes)
+        {
+            // Everything gets written exactly once
+            for(uint32 elemIdx = 0; elemIdx < numElems && failure == nullptr; ++elemIdx)
+            {
+                const Float4 expected = AccessPatternWriteValue(elemIdx);
+                if(memcmp(&target[elemIdx], &expected, sizeof(Float4)) != 0)
+                    failure = "the reference didn't write every element";
+            }
+        }
+        else if(failure == nullptr)
+        {
+            // The linear addressing covers [0, numAccesses) exactly once, so all of the sums added together need to
+            // match the sum of everything that range points to. Doubles keep the totals exact.
+            double total = 0.0;
+            for(float threadSum : threadSums)
+                total += threadSum;
+
+            double expectedTotal = 0.0;
+            for(uint64 i = 0; i < numAccesses; ++i)
+                expectedTotal += ElemSum(inputData[indexed ? indices[i % indices.Size()] : i % numElems]);
+
+            if(total != expectedTotal)
+                failure = "the reference sums don't add up to the elements that the pattern reads";
+        }
+
+        if(failure == nullptr)
+            WriteLog("Access pattern generator check (%s): PASSED (%llu indices, %llu unique bytes)",
+                     AccessPatternsLabels[uint32(pattern)], indices.Size(), Max(stats.UniqueBytesRead, stats.UniqueBytesWritten));
+        else
+            WriteLog("Access pattern generator check (%s): FAILED because %s", AccessPatternsLabels[uint32(pattern)], failure);
+
+        allPassed = allPassed && failure == nullptr;
+    }
+
+    return allPassed;
+}
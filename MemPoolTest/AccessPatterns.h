@@ -0,0 +1,84 @@
+//=================================================================================================
+//
+//  D3D12 Memory Pool Performance Test
+//  by MJP
+//  https://therealmjp.github.io/
+//
+//  All code and content licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include <PCH.h>
+
+#include <Containers.h>
+#include <SF12_Math.h>
+#include "AppSettings.h"
+
+using namespace SampleFramework12;
+
+// Everything that determines which elements the compute job touches
+struct AccessPatternDesc
+{
+    AccessPatterns Pattern = AccessPatterns::Linear;
+    uint32 NumInputElems = 0;
+    uint32 NumThreadGroups = 0;
+    uint32 ElemsPerThread = 1;
+    uint32 ThreadElemStride = 1;
+    uint32 GroupElemOffset = 1;
+    uint32 ThreadElemOffset = 1;
+    uint32 GatherStride = 1;
+    uint32 SparseBlockSize = 1;
+    uint32 Seed = 0;
+};
+
+// Memory traffic for a single dispatch. BytesRead/BytesWritten only count the buffer under test (the input buffer,
+// or the target buffer for the write patterns), since the index buffer always lives in a DEFAULT heap.
+struct AccessPatternStats
+{
+    uint64 BytesRead = 0;
+    uint64 BytesWritten = 0;
+    uint64 UniqueBytesRead = 0;
+    uint64 UniqueBytesWritten = 0;
+    uint64 IndexBytesRead = 0;
+};
+
+// Patterns that read their element indices from the index buffer
+bool AccessPatternUsesIndexBuffer(AccessPatterns pattern);
+
+// Patterns that write to the target buffer instead of reading the input buffer
+bool AccessPatternUsesTargetBuffer(AccessPatterns pattern);
+
+// Number of indices that GenerateAccessPatternIndices() produces, which is 0 for patterns that don't need any
+uint32 NumAccessPatternIndices(const AccessPatternDesc& desc);
+
+// Builds the indices using a generator seeded with desc.Seed, so the same desc always gives the same indices.
+// For Pointer Chase these are the next element to visit from each element (forming a single cycle through the
+// whole buffer), which get baked into the input data by FillAccessPatternInput() instead of an index buffer.
+void GenerateAccessPatternIndices(const AccessPatternDesc& desc, Array<uint32>& indices);
+
+// Fills the input buffer contents described in SharedTypes.h
+void FillAccessPatternInput(const AccessPatternDesc& desc, const Array<uint32>& indices, Array<Float4>& inputData);
+
+// What the write patterns store to an element, which matches AccessPatternWriteValue() in ComputeJob.hlsl
+Float4 AccessPatternWriteValue(uint32 elemIdx);
+
+// Walks every access that the compute job makes to count the bytes it reads and writes
+AccessPatternStats ComputeAccessPatternStats(const AccessPatternDesc& desc, const Array<uint32>& indices);
+
+// CPU reference of the compute job: produces the sum that each thread ends up with, and applies the writes to target
+// (which needs to start out zeroed). Read-Modify-Write assumes that the target has already been through a dispatch,
+// which is always the case for the GPU results that get compared against it.
+void RunAccessPatternReference(const AccessPatternDesc& desc, const Array<uint32>& indices, const Array<Float4>& inputData,
+                               Array<float>& threadSums, Array<Float4>& target);
+
+// Compares the per-thread sums (and the target buffer for the write patterns) that were read back from the GPU
+// against the reference. Logs the results and returns false if anything didn't match.
+bool ValidateAccessPatternResults(const AccessPatternDesc& desc, const Array<uint32>& indices, const Array<Float4>& inputData,
+                                  const float* gpuThreadSums, const Float4* gpuTarget);
+
+// Checks that every generator produces what it's supposed to (a permutation, a single cycle, blocks that respect the
+// spacing, etc.) and is deterministic for a given seed, and that the stats match the number of elements that each
+// pattern touches. Logs the results and returns false if anything failed.
+bool ValidateAccessPatternGenerators();
@@ -8,7 +8,7 @@
 //
 //=================================================================================================
 
-#define EnableSkyModel_ (0)
+#define EnableSkyModel_ (1)
 #define EnableEmbree_ (0)
 #define EnableDXR_ (0)
 #define EnablePreviewDX12SDK_ (1)
@@ -76,6 +76,28 @@ const BufferUploadPaths BufferUploadPathsValues[uint32(BufferUploadPaths::NumVal
     BufferUploadPaths::FastUploadCopyQueue,
 };
 
+const char* AccessPatternsLabels[uint32(AccessPatterns::NumValues)] =
+{
+    "Linear (Strided)",
+    "Random Permutation",
+    "Fixed-Stride Gather",
+    "Pointer Chase",
+    "Sparse Blocks",
+    "Write",
+    "Read-Modify-Write",
+};
+
+const AccessPatterns AccessPatternsValues[uint32(AccessPatterns::NumValues)] =
+{
+    AccessPatterns::Linear,
+    AccessPatterns::RandomPermutation,
+    AccessPatterns::StridedGather,
+    AccessPatterns::PointerChase,
+    AccessPatterns::SparseBlocks,
+    AccessPatterns::WriteOnly,
+    AccessPatterns::ReadModifyWrite,
+};
+
 namespace AppSettings
 {
     static SettingsContainer Settings;
@@ -91,6 +113,10 @@ namespace AppSettings
     IntSetting ThreadElemStride;
     IntSetting GroupElemOffset;
     IntSetting ThreadElemOffset;
+    AccessPatternsSetting AccessPattern;
+    IntSetting GatherStride;
+    IntSetting SparseBlockSize;
+    IntSetting AccessPatternSeed;
     IntSetting NumThreadGroups;
     BoolSetting ReadFromGPUMem;
     BufferUploadPathsSetting BufferUploadPath;
@@ -99,12 +125,16 @@ namespace AppSettings
     IntSetting NumInputBufferElems;
     IntSetting InputBufferIdx;
     IntSetting OutputBufferIdx;
+    IntSetting IndexBufferIdx;
+    IntSetting TargetBufferIdx;
+    BoolSetting WriteThreadSums;
     BoolSetting EnableVSync;
     BoolSetting StablePowerState;
     BoolSetting EnableDriverBackgroundThreads;
 
     ConstantBuffer CBuffer;
     const uint32 CBufferRegister = 12;
+    static AppSettingsCBuffer CBufferData;
 
     void Initialize()
     {
@@ -150,6 +180,18 @@ namespace AppSettings
         ThreadElemOffset.Initialize("ThreadElemOffset", "Test Config", "Thread Elem Offset", "", 1, 0, 16);
         Settings.AddSetting(&ThreadElemOffset);
 
+        AccessPattern.Initialize("AccessPattern", "Test Config", "Access Pattern", "Which elements each thread accesses, and whether it reads, writes, or both", AccessPatterns::Linear, 7, AccessPatternsLabels);
+        Settings.AddSetting(&AccessPattern);
+
+        GatherStride.Initialize("GatherStride", "Test Config", "Gather Stride (Elements)", "", 16, 1, 1024);
+        Settings.AddSetting(&GatherStride);
+
+        SparseBlockSize.Initialize("SparseBlockSize", "Test Config", "Sparse Block Size (Elements)", "", 16, 1, 1024);
+        Settings.AddSetting(&SparseBlockSize);
+
+        AccessPatternSeed.Initialize("AccessPatternSeed", "Test Config", "Access Pattern Seed", "Seeds the generator used for building the index buffers of the random access patterns", 1, 0, 65535);
+        Settings.AddSetting(&AccessPatternSeed);
+
         NumThreadGroups.Initialize("NumThreadGroups", "Test Config", "Num Thread Groups", "", 4096, 1, 65535);
         Settings.AddSetting(&NumThreadGroups);
 
@@ -177,6 +219,18 @@ namespace AppSettings
         Settings.AddSetting(&OutputBufferIdx);
         OutputBufferIdx.SetVisible(false);
 
+        IndexBufferIdx.Initialize("IndexBufferIdx", "Test Config", "Index Buffer Idx", "", -1, -2147483648, 2147483647);
+        Settings.AddSetting(&IndexBufferIdx);
+        IndexBufferIdx.SetVisible(false);
+
+        TargetBufferIdx.Initialize("TargetBufferIdx", "Test Config", "Target Buffer Idx", "", -1, -2147483648, 2147483647);
+        Settings.AddSetting(&TargetBufferIdx);
+        TargetBufferIdx.SetVisible(false);
+
+        WriteThreadSums.Initialize("WriteThreadSums", "Test Config", "Write Thread Sums", "", false);
+        Settings.AddSetting(&WriteThreadSums);
+        WriteThreadSums.SetVisible(false);
+
         EnableVSync.Initialize("EnableVSync", "Debug", "Enable VSync", "Enables or disables vertical sync during Present", true);
         Settings.AddSetting(&EnableVSync);
 
@@ -201,12 +255,85 @@ namespace AppSettings
 
     void UpdateCBuffer()
     {
-        AppSettingsCBuffer cbData;
+        // Only settings that were modified since the last update get copied, and if nothing was
+        // modified then the version of the buffer from the last update stays bound
+        bool dirty = false;
+
+        if(HeapType.Dirty())
+        {
+            CBufferData.HeapType = HeapType;
+            HeapType.ClearDirty();
+            dirty = true;
+        }
+
+        if(InputBufferIdx.Dirty())
+        {
+            CBufferData.InputBufferIdx = InputBufferIdx;
+            InputBufferIdx.ClearDirty();
+            dirty = true;
+        }
+
+        if(OutputBufferIdx.Dirty())
+        {
+            CBufferData.OutputBufferIdx = OutputBufferIdx;
+            OutputBufferIdx.ClearDirty();
+            dirty = true;
+        }
+
+        if(IndexBufferIdx.Dirty())
+        {
+            CBufferData.IndexBufferIdx = IndexBufferIdx;
+            IndexBufferIdx.ClearDirty();
+            dirty = true;
+        }
+
+        if(TargetBufferIdx.Dirty())
+        {
+            CBufferData.TargetBufferIdx = TargetBufferIdx;
+            TargetBufferIdx.ClearDirty();
+            dirty = true;
+        }
+
+        if(WriteThreadSums.Dirty())
+        {
+            CBufferData.WriteThreadSums = WriteThreadSums;
+            WriteThreadSums.ClearDirty();
+            dirty = true;
+        }
+
+        #if UseAsserts_
+            AppSettingsCBuffer cbData;
+            RebuildCBuffer(&cbData);
+            Assert_(memcmp(&cbData, &CBufferData, sizeof(AppSettingsCBuffer)) == 0);
+        #endif
+
+        if(dirty)
+            CBuffer.MapAndPatchData(CBufferData);
+    }
+
+    uint64 RebuildCBuffer(void* cbDataOut)
+    {
+        // Fills out the whole struct from the current values, ignoring the dirty bits. CBuffer's size is
+        // always enough room for it.
+        AppSettingsCBuffer& cbData = *reinterpret_cast<AppSettingsCBuffer*>(cbDataOut);
+        memset(&cbData, 0, sizeof(AppSettingsCBuffer));
         cbData.HeapType = HeapType;
         cbData.InputBufferIdx = InputBufferIdx;
         cbData.OutputBufferIdx = OutputBufferIdx;
+        cbData.IndexBufferIdx = IndexBufferIdx;
+        cbData.TargetBufferIdx = TargetBufferIdx;
+        cbData.WriteThreadSums = WriteThreadSums;
+        return sizeof(AppSettingsCBuffer);
+    }
 
-        CBuffer.MapAndSetData(cbData);
+    void GetCBufferSettings(List<Setting*>& cbSettings)
+    {
+        cbSettings.Add(&HeapType);
+        cbSettings.Add(&InputBufferIdx);
+        cbSettings.Add(&OutputBufferIdx);
+        cbSettings.Add(&IndexBufferIdx);
+        cbSettings.Add(&TargetBufferIdx);
+        cbSettings.Add(&WriteThreadSums);
     }
 
     void BindCBufferGfx(ID3D12GraphicsCommandList* cmdList, uint32 rootParameter)
@@ -49,6 +49,30 @@ enum BufferUploadPaths
     FastUploadCopyQueue,
 }
 
+enum AccessPatterns
+{
+    [EnumLabel("Linear (Strided)")]
+    Linear,
+
+    [EnumLabel("Random Permutation")]
+    RandomPermutation,
+
+    [EnumLabel("Fixed-Stride Gather")]
+    StridedGather,
+
+    [EnumLabel("Pointer Chase")]
+    PointerChase,
+
+    [EnumLabel("Sparse Blocks")]
+    SparseBlocks,
+
+    [EnumLabel("Write")]
+    WriteOnly,
+
+    [EnumLabel("Read-Modify-Write")]
+    ReadModifyWrite,
+}
+
 public class Settings
 {
     const uint ThreadGroupSize = 256;
@@ -105,6 +129,28 @@ public class Settings
         [UseAsShaderConstant(false)]
         int ThreadElemOffset = 1;
 
+        [UseAsShaderConstant(false)]
+        [HelpText("Which elements each thread accesses, and whether it reads, writes, or both")]
+        AccessPatterns AccessPattern = AccessPatterns.Linear;
+
+        [DisplayName("Gather Stride (Elements)")]
+        [MinValue(1)]
+        [MaxValue(1024)]
+        [UseAsShaderConstant(false)]
+        int GatherStride = 16;
+
+        [DisplayName("Sparse Block Size (Elements)")]
+        [MinValue(1)]
+        [MaxValue(1024)]
+        [UseAsShaderConstant(false)]
+        int SparseBlockSize = 16;
+
+        [MinValue(0)]
+        [MaxValue(65535)]
+        [UseAsShaderConstant(false)]
+        [HelpText("Seeds the generator used for building the index buffers of the random access patterns")]
+        int AccessPatternSeed = 1;
+
         [MinValue(1)]
         [MaxValue(65535)]
         [UseAsShaderConstant(false)]
@@ -138,6 +184,15 @@ public class Settings
 
         [Visible(false)]
         int OutputBufferIdx = -1;
+
+        [Visible(false)]
+        int IndexBufferIdx = -1;
+
+        [Visible(false)]
+        int TargetBufferIdx = -1;
+
+        [Visible(false)]
+        bool WriteThreadSums = false;
     }
 
     [ExpandGroup(true)]
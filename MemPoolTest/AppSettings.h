@@ -82,6 +82,25 @@ extern const BufferUploadPaths BufferUploadPathsValues[uint32(BufferUploadPaths:
 
 typedef EnumSettingT<BufferUploadPaths> BufferUploadPathsSetting;
 
+enum class AccessPatterns
+{
+    Linear = 0,
+    RandomPermutation = 1,
+    StridedGather = 2,
+    PointerChase = 3,
+    SparseBlocks = 4,
+    WriteOnly = 5,
+    ReadModifyWrite = 6,
+
+    NumValues
+};
+
+extern const char* AccessPatternsLabels[uint32(AccessPatterns::NumValues)];
+
+extern const AccessPatterns AccessPatternsValues[uint32(AccessPatterns::NumValues)];
+
+typedef EnumSettingT<AccessPatterns> AccessPatternsSetting;
+
 namespace AppSettings
 {
     static const uint64 ThreadGroupSize = 256;
@@ -97,6 +116,10 @@ namespace AppSettings
     extern IntSetting ThreadElemStride;
     extern IntSetting GroupElemOffset;
     extern IntSetting ThreadElemOffset;
+    extern AccessPatternsSetting AccessPattern;
+    extern IntSetting GatherStride;
+    extern IntSetting SparseBlockSize;
+    extern IntSetting AccessPatternSeed;
     extern IntSetting NumThreadGroups;
     extern BoolSetting ReadFromGPUMem;
     extern BufferUploadPathsSetting BufferUploadPath;
@@ -105,6 +128,9 @@ namespace AppSettings
     extern IntSetting NumInputBufferElems;
     extern IntSetting InputBufferIdx;
     extern IntSetting OutputBufferIdx;
+    extern IntSetting IndexBufferIdx;
+    extern IntSetting TargetBufferIdx;
+    extern BoolSetting WriteThreadSums;
     extern BoolSetting EnableVSync;
     extern BoolSetting StablePowerState;
     extern BoolSetting EnableDriverBackgroundThreads;
@@ -114,6 +140,9 @@ namespace AppSettings
         int32 HeapType;
         int32 InputBufferIdx;
         int32 OutputBufferIdx;
+        int32 IndexBufferIdx;
+        int32 TargetBufferIdx;
+        bool32 WriteThreadSums;
     };
 
     extern ConstantBuffer CBuffer;
@@ -123,6 +152,8 @@ namespace AppSettings
     void Shutdown();
     void Update(uint32 displayWidth, uint32 displayHeight, const Float4x4& viewMatrix);
     void UpdateCBuffer();
+    uint64 RebuildCBuffer(void* cbDataOut);
+    void GetCBufferSettings(List<Setting*>& cbSettings);
     void BindCBufferGfx(ID3D12GraphicsCommandList* cmdList, uint32 rootParameter);
     void BindCBufferCompute(ID3D12GraphicsCommandList* cmdList, uint32 rootParameter);
     void GetShaderCompileOptions(CompileOptions& opts);
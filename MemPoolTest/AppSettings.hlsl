@@ -5,6 +5,9 @@ struct AppSettings_CBLayout
     int HeapType;
     int InputBufferIdx;
     int OutputBufferIdx;
+    int IndexBufferIdx;
+    int TargetBufferIdx;
+    bool WriteThreadSums;
 };
 
 ConstantBuffer<AppSettings_CBLayout> AppSettingsCB : register(b12);
@@ -14,6 +17,9 @@ struct AppSettings_Values
     int HeapType;
     int InputBufferIdx;
     int OutputBufferIdx;
+    int IndexBufferIdx;
+    int TargetBufferIdx;
+    bool WriteThreadSums;
 };
 
 static const AppSettings_Values AppSettings =
@@ -21,6 +27,9 @@ static const AppSettings_Values AppSettings =
     AppSettingsCB.HeapType,
     AppSettingsCB.InputBufferIdx,
     AppSettingsCB.OutputBufferIdx,
+    AppSettingsCB.IndexBufferIdx,
+    AppSettingsCB.TargetBufferIdx,
+    AppSettingsCB.WriteThreadSums,
 };
 
 enum HeapTypes
@@ -59,4 +68,15 @@ enum BufferUploadPaths
     FastUploadCopyQueue = 2,
 };
 
+enum AccessPatterns
+{
+    Linear = 0,
+    RandomPermutation = 1,
+    StridedGather = 2,
+    PointerChase = 3,
+    SparseBlocks = 4,
+    WriteOnly = 5,
+    ReadModifyWrite = 6,
+};
+
 static const uint ThreadGroupSize = 256;
@@ -12,6 +12,7 @@
 // Includes
 //=================================================================================================
 #include "AppSettings.hlsl"
+#include "SharedTypes.h"
 
 #if ConstantBuffer_
     struct CB
@@ -21,6 +22,12 @@
     ConstantBuffer<CB> CBuffer : register(b0);
 #endif
 
+// What the write patterns store to an element, which matches AccessPatternWriteValue() in AccessPatterns.cpp
+float4 AccessPatternWriteValue(in uint elemIdx)
+{
+    return float4(elemIdx & AccessPatternValueMask, 1.0f, 2.0f, 3.0f);
+}
+
 [numthreads(ThreadGroupSize, 1, 1)]
 void ComputeJob(in uint3 dispatchThreadID : SV_DispatchThreadID, in uint3 groupThreadID : SV_GroupThreadID,
                 in uint3 groupID : SV_GroupID)
@@ -37,30 +44,61 @@ void ComputeJob(in uint3 dispatchThreadID : SV_DispatchThreadID, in uint3 groupT
         StructuredBuffer<float4> inputBuffer = ResourceDescriptorHeap[AppSettings.InputBufferIdx];
     #endif
 
+    // The access pattern is a compile-time constant, so all of the branches on it get compiled out
+    const uint accessPattern = AccessPattern_;
+    const bool useIndexBuffer = accessPattern == RandomPermutation || accessPattern == StridedGather ||
+                                accessPattern == SparseBlocks;
+
+    ByteAddressBuffer indexBuffer = ResourceDescriptorHeap[AppSettings.IndexBufferIdx];
+    RWByteAddressBuffer targetBuffer = ResourceDescriptorHeap[AppSettings.TargetBufferIdx];
+
     float sum = 0.0f;
 
     uint elemIdx = (ElemsPerThread_ * ThreadGroupSize * GroupElemOffset_ * groupIndex) +
                     (ElemsPerThread_ * ThreadElemOffset_ * localThreadIndex);
+    uint chaseIdx = elemIdx % NumInputBufferElems_;
     for(uint i = 0; i < ElemsPerThread_; ++i)
     {
-        const uint loadIdx = elemIdx % NumInputBufferElems_;
+        uint loadIdx = elemIdx % NumInputBufferElems_;
+        if(accessPattern == PointerChase)
+            loadIdx = chaseIdx;
+        else if(useIndexBuffer)
+            loadIdx = indexBuffer.Load((elemIdx % NumAccessPatternIndices_) * 4);
+
+        if(accessPattern == WriteOnly)
+        {
+            targetBuffer.Store4(loadIdx * 16, asuint(AccessPatternWriteValue(loadIdx)));
+        }
+        else if(accessPattern == ReadModifyWrite)
+        {
+            const float4 prevValue = asfloat(targetBuffer.Load4(loadIdx * 16));
+            targetBuffer.Store4(loadIdx * 16, asuint(max(prevValue, AccessPatternWriteValue(loadIdx))));
+
+            sum += dot(prevValue, 1.0f);
+        }
+        else
+        {
+            #if RawBuffer_
+                const float4 data = asfloat(inputBuffer.Load4(loadIdx * 16));
+            #elif StructuredBuffer_ || FormattedBuffer_
+                const float4 data = inputBuffer[loadIdx];
+            #elif ConstantBuffer_
+                const float4 data = CBuffer.Elems[loadIdx];
+            #endif
 
-        #if RawBuffer_
-            const float4 data = asfloat(inputBuffer.Load4(loadIdx * 16));
-        #elif StructuredBuffer_ || FormattedBuffer_
-            const float4 data = inputBuffer[loadIdx];
-        #elif ConstantBuffer_
-            const float4 data = CBuffer.Elems[loadIdx];
-        #endif
+            // The next element in the chain is stored in the element itself, so every load depends on the last one
+            if(accessPattern == PointerChase)
+                chaseIdx = (uint(data.y) << ChaseIdxLowBits) + uint(data.z);
 
-        sum += dot(data, 1.0f);
+            sum += dot(data, 1.0f);
+        }
 
         elemIdx += ThreadElemStride_;
     }
 
-    if(sum < 0.0f)
+    if(sum < 0.0f || AppSettings.WriteThreadSums)
     {
         RWByteAddressBuffer outputBuffer = ResourceDescriptorHeap[AppSettings.OutputBufferIdx];
-        outputBuffer.Store(globalThreadIndex * 4, sum);
+        outputBuffer.Store(globalThreadIndex * 4, asuint(sum));
     }
-}
\ No newline at end of file
+}
@@ -18,6 +18,8 @@
 #include <Graphics/Profiler.h>
 #include <Graphics/DX12.h>
 #include <Graphics/DX12_Helpers.h>
+#include <Graphics/BarrierTracker.h>
+#include <Graphics/DX12_PipelineCache.h>
 #include <ImGui/ImGui.h>
 #include <ImGuiHelper.h>
 #include <EnkiTS/TaskScheduler_c.h>
@@ -58,6 +60,61 @@ static bool IsInputBufferCPUWritable(const BenchmarkConfig& config)
     return false;
 }
 
+// Returns the actual size of the input buffer, after clamping + aligning the requested size
+static uint32 InputBufferSize(BufferTypes bufferType, uint64 requestedSize)
+{
+    const uint32 inputBufferAlignment = (bufferType == BufferTypes::Constant) ? DX12::ConstantBufferAlignment : 1;
+    const uint32 maxInputBufferSize = (bufferType == BufferTypes::Constant) ? MaxCBufferSize : (1 * 1024 * 1024 * 1024);
+    return AlignTo(uint32(Clamp<uint64>(requestedSize, 1, maxInputBufferSize)), inputBufferAlignment);
+}
+
+static AccessPatternDesc CurrentAccessPatternDesc(uint32 numInputElems)
+{
+    AccessPatternDesc desc;
+    desc.Pattern = AppSettings::AccessPattern;
+    desc.NumInputElems = numInputElems;
+    desc.NumThreadGroups = uint32(AppSettings::NumThreadGroups);
+    desc.ElemsPerThread = uint32(AppSettings::ElemsPerThread);
+    desc.ThreadElemStride = uint32(AppSettings::ThreadElemStride);
+    desc.GroupElemOffset = uint32(AppSettings::GroupElemOffset);
+    desc.ThreadElemOffset = uint32(AppSettings::ThreadElemOffset);
+    desc.GatherStride = uint32(AppSettings::GatherStride);
+    desc.SparseBlockSize = uint32(AppSettings::SparseBlockSize);
+    desc.Seed = uint32(AppSettings::AccessPatternSeed);
+    return desc;
+}
+
+static AccessPatternDesc BenchmarkAccessPatternDesc(const BenchmarkConfig& config, uint32 numInputElems)
+{
+    AccessPatternDesc desc;
+    desc.Pattern = config.AccessPattern;
+    desc.NumInputElems = numInputElems;
+    desc.NumThreadGroups = config.NumThreadGroups;
+    desc.ElemsPerThread = config.ElemsPerThread;
+    desc.ThreadElemStride = config.ThreadElemStride;
+    desc.GroupElemOffset = config.GroupElemOffset;
+    desc.ThreadElemOffset = config.ThreadElemOffset;
+    desc.GatherStride = config.GatherStride;
+    desc.SparseBlockSize = config.SparseBlockSize;
+    desc.Seed = uint32(AppSettings::AccessPatternSeed);
+    return desc;
+}
+
+static void MakeComputeJobCompileOptions(CompileOptions& opts, BufferTypes bufferType, const AccessPatternDesc& desc)
+{
+    opts.Add("ElemsPerThread_", desc.ElemsPerThread);
+    opts.Add("ThreadElemOffset_", desc.ThreadElemOffset);
+    opts.Add("GroupElemOffset_", desc.GroupElemOffset);
+    opts.Add("NumInputBufferElems_", desc.NumInputElems);
+    opts.Add("ThreadElemStride_", desc.ThreadElemStride);
+    opts.Add("AccessPattern_", uint32(desc.Pattern));
+    opts.Add("NumAccessPatternIndices_", Max(NumAccessPatternIndices(desc), 1u));
+    opts.Add("RawBuffer_", bufferType == BufferTypes::Raw);
+    opts.Add("FormattedBuffer_", bufferType == BufferTypes::Formatted);
+    opts.Add("StructuredBuffer_", bufferType == BufferTypes::Structured);
+    opts.Add("ConstantBuffer_", bufferType == BufferTypes::Constant);
+}
+
 static RawBuffer* backgroundUploadBufferPtr = nullptr;
 
 static void BackgroundUploadTask(uint32 start, uint32 end, uint32 threadnum, void* args)
@@ -170,9 +227,13 @@ void MemPoolTest::Shutdown()
     taskScheduler = nullptr;
     backgroundUploadBuffer.Shutdown();
 
+    UntrackBuffers();
     inputBuffer.Shutdown();
     uploadBuffer.Shutdown();
     outputBuffer.Shutdown();
+    indexBuffer.Shutdown();
+    targetBuffer.Shutdown();
+    validationReadback.Shutdown();
     DX12::Release(inputBufferHeap);
     DX12::SRVDescriptorHeap.FreePersistent(inputBufferSRV);
 }
@@ -185,7 +246,7 @@ void MemPoolTest::CreatePSOs()
         psoDesc.CS = computeJobCS.ByteCode();
         psoDesc.pRootSignature = DX12::UniversalRootSignature;
         psoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
-        DXCall(DX12::Device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&computeJobPSO)));
+        DX12::CreateComputePipelineState(psoDesc, &computeJobPSO);
     }
 }
 
@@ -203,6 +264,8 @@ void MemPoolTest::Update(const Timer& timer)
 
     TickBenchmark();
 
+    CheckAccessPatternValidation();
+
     // Toggle stable power state
     if(AppSettings::StablePowerState != stablePowerState)
     {
@@ -238,13 +301,19 @@ void MemPoolTest::Update(const Timer& timer)
         &AppSettings::CPUPageProperty,
         &AppSettings::MemoryPool,
         &AppSettings::InputBufferType,
+        &AppSettings::AccessPattern,
+        &AppSettings::GatherStride,
+        &AppSettings::SparseBlockSize,
+        &AppSettings::AccessPatternSeed,
     };
 
+    bool rebuiltBuffers = false;
     for(const Setting* setting : rebuildBufferSettings)
     {
         if(setting->Changed())
         {
             CreateBuffers();
+            rebuiltBuffers = true;
             break;
         }
     }
@@ -259,12 +328,19 @@ void MemPoolTest::Update(const Timer& timer)
         &AppSettings::GroupElemOffset,
         &AppSettings::ThreadElemOffset,
         &AppSettings::InputBufferType,
+        &AppSettings::AccessPattern,
+        &AppSettings::GatherStride,
+        &AppSettings::SparseBlockSize,
     };
 
     for(const Setting* setting : recompileSettings)
     {
         if(setting->Changed())
         {
+            // Rebuilding the buffers already updated the stats
+            if(rebuiltBuffers == false)
+                UpdateAccessPatternStats();
+
             CompileComputeJob();
             DestroyPSOs();
             CreatePSOs();
@@ -295,6 +371,7 @@ void MemPoolTest::Render(const Timer& timer)
     cmdList->OMSetRenderTargets(1, rtvHandles, false, nullptr);
 
     float clearColor[4] = { 0.2f, 0.4f, 0.8f, 1.0f };
+    DX12::FlushBarriers(cmdList);
     cmdList->ClearRenderTargetView(rtvHandles[0], clearColor, 0, nullptr);
 
     DX12::SetViewport(cmdList, swapChain.Width(), swapChain.Height());
@@ -302,11 +379,21 @@ void MemPoolTest::Render(const Timer& timer)
     RenderHUD(timer);
 }
 
+void MemPoolTest::UntrackBuffers()
+{
+    DX12::CmdListBarriers.Untrack(inputBuffer.Resource());
+    DX12::CmdListBarriers.Untrack(outputBuffer.Resource());
+    DX12::CmdListBarriers.Untrack(targetBuffer.Resource());
+}
+
 void MemPoolTest::CreateBuffers()
 {
+    UntrackBuffers();
     inputBuffer.Shutdown();
     uploadBuffer.Shutdown();
     outputBuffer.Shutdown();
+    indexBuffer.Shutdown();
+    targetBuffer.Shutdown();
 
     DX12::FlushGPU();
 
@@ -314,12 +401,16 @@ void MemPoolTest::CreateBuffers()
 
     DX12::SRVDescriptorHeap.FreePersistent(inputBufferSRV);
 
-    const uint32 inputBufferAlignment = (AppSettings::InputBufferType == BufferTypes::Constant) ? DX12::ConstantBufferAlignment : 1;
-    const uint32 maxInputBufferSize = (AppSettings::InputBufferType == BufferTypes::Constant) ? MaxCBufferSize : (1 * 1024 * 1024 * 1024);
-    const uint32 inputBufferSize = AlignTo(Clamp<uint32>(AppSettings::InputBufferSizeMB * (1024 * 1024) + AppSettings::InputBufferSizeKB * 1024 + AppSettings::InputBufferSizeBytes, 1u, maxInputBufferSize), inputBufferAlignment);
+    const uint32 inputBufferSize = InputBufferSize(AppSettings::InputBufferType, AppSettings::InputBufferSizeMB * (1024 * 1024) + AppSettings::InputBufferSizeKB * 1024 + AppSettings::InputBufferSizeBytes);
     const uint32 numInputElems = inputBufferSize / 16;
     const uint32 totalInputBufferSize = AlignTo(inputBufferSize * uint32(DX12::RenderLatency), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
 
+    // The write patterns write to a separate buffer that goes in the same heap as the input buffer, except for upload
+    // heaps since the GPU can't write to those
+    const bool useTargetBuffer = AccessPatternUsesTargetBuffer(AppSettings::AccessPattern);
+    const bool targetBufferInHeap = useTargetBuffer && AppSettings::HeapType != HeapTypes::Upload;
+    const uint64 targetBufferSize = AlignTo(uint64(numInputElems) * 16, uint64(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+
     const uint32 numTotalThreads = AppSettings::ThreadGroupSize * AppSettings::NumThreadGroups;
     numComputeJobThreads = numTotalThreads;
 
@@ -374,7 +465,7 @@ void MemPoolTest::CreateBuffers()
 
         D3D12_HEAP_DESC heapDesc =
         {
-            .SizeInBytes = totalInputBufferSize,
+            .SizeInBytes = totalInputBufferSize + (targetBufferInHeap ? targetBufferSize : 0),
             .Properties = heapProps,
             .Alignment = 0,
             .Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
@@ -442,7 +533,6 @@ void MemPoolTest::CreateBuffers()
     }
 
     AppSettings::InputBufferIdx.SetValue(inputBufferSRV);
-    AppSettings::OutputBufferIdx.SetValue(outputBuffer.UAV);
     AppSettings::NumInputBufferElems.SetValue(numInputElems);
 
     if(cpuWritable == false)
@@ -462,25 +552,85 @@ void MemPoolTest::CreateBuffers()
         .Name = L"Output Buffer",
     });
 
-    inputBufferShadowMem.Init(numInputElems, Float4(1.0f, 1.0f, 1.0f, 1.0f));
+    AppSettings::OutputBufferIdx.SetValue(outputBuffer.UAV);
+    DX12::CmdListBarriers.TrackBuffer(outputBuffer.Resource(), ResourceStates::BufferUnorderedAccess);
+
+    // The indices (or the chain for Pointer Chase, which lives in the input data) are generated up-front
+    accessPatternDesc = CurrentAccessPatternDesc(numInputElems);
+    GenerateAccessPatternIndices(accessPatternDesc, accessPatternIndices);
+    FillAccessPatternInput(accessPatternDesc, accessPatternIndices, inputBufferShadowMem);
     readbackMem.Init(numInputElems, Float4());
+
+    if(AccessPatternUsesIndexBuffer(accessPatternDesc.Pattern))
+    {
+        indexBuffer.Initialize({
+            .NumElements = accessPatternIndices.Size(),
+            .InitData = accessPatternIndices.Data(),
+            .Name = L"Index Buffer",
+        });
+    }
+
+    if(useTargetBuffer)
+    {
+        // Starts out zeroed so that the results can be compared against the CPU reference
+        Array<Float4> targetInitData(numInputElems, Float4());
+        targetBuffer.Initialize({
+            .NumElements = uint64(numInputElems) * 4,
+            .CreateUAV = true,
+            .InitData = targetInitData.Data(),
+            .Heap = targetBufferInHeap ? inputBufferHeap : nullptr,
+            .HeapOffset = targetBufferInHeap ? totalInputBufferSize : 0,
+            .Name = L"Target Buffer",
+        });
+        DX12::CmdListBarriers.TrackBuffer(targetBuffer.Resource(), ResourceStates::BufferUnorderedAccess);
+    }
+
+    AppSettings::IndexBufferIdx.SetValue(indexBuffer.SRV);
+    AppSettings::TargetBufferIdx.SetValue(targetBuffer.UAV);
+
+    UpdateAccessPatternStats();
+}
+
+void MemPoolTest::UpdateAccessPatternStats()
+{
+    // Only the addressing can change here, anything that changes the indices goes through CreateBuffers()
+    accessPatternDesc = CurrentAccessPatternDesc(accessPatternDesc.NumInputElems);
+    accessPatternStats = ComputeAccessPatternStats(accessPatternDesc, accessPatternIndices);
+
+    // Read-Modify-Write needs a dispatch with the new addressing before its results can be validated
+    numComputeDispatches = 0;
+
+    if(validationFrame != uint64(-1))
+    {
+        WriteLog("Access pattern validation was cancelled because the settings changed");
+        validationReadback.Shutdown();
+        validationFrame = uint64(-1);
+    }
 }
 
 void MemPoolTest::CompileComputeJob()
 {
     CompileOptions opts;
-    opts.Add("ElemsPerThread_", AppSettings::ElemsPerThread);
-    opts.Add("ThreadElemOffset_", AppSettings::ThreadElemOffset);
-    opts.Add("GroupElemOffset_", AppSettings::GroupElemOffset);
-    opts.Add("NumInputBufferElems_", AppSettings::NumInputBufferElems);
-    opts.Add("ThreadElemStride_", AppSettings::ThreadElemStride);
-    opts.Add("RawBuffer_", AppSettings::InputBufferType == BufferTypes::Raw);
-    opts.Add("FormattedBuffer_", AppSettings::InputBufferType == BufferTypes::Formatted);
-    opts.Add("StructuredBuffer_", AppSettings::InputBufferType == BufferTypes::Structured);
-    opts.Add("ConstantBuffer_", AppSettings::InputBufferType == BufferTypes::Constant);
+    MakeComputeJobCompileOptions(opts, AppSettings::InputBufferType, accessPatternDesc);
     computeJobCS = CompileFromFile(L"ComputeJob.hlsl", "ComputeJob", ShaderType::Compute, opts);
 }
 
+void MemPoolTest::PrecompileBenchmarkShaders()
+{
+    // Build every compute job permutation used by the benchmark in parallel up-front, so that
+    // switching between configs only hits the shader cache instead of stalling on a compile
+    List<CompileOptions> permutations(numBenchmarks);
+    for(const BenchmarkConfig& config : benchmarkConfigs)
+    {
+        const uint32 numInputElems = InputBufferSize(config.InputBufferType, config.InputBufferSize) / 16;
+
+        CompileOptions& opts = permutations.Add();
+        MakeComputeJobCompileOptions(opts, config.InputBufferType, BenchmarkAccessPatternDesc(config, numInputElems));
+    }
+
+    PrecompileFromFile(L"ComputeJob.hlsl", "ComputeJob", ShaderType::Compute, permutations.Data(), permutations.Count());
+}
+
 void MemPoolTest::InitBenchmark()
 {
     benchmarkSamples.Init(NumBenchmarkMeasureFrames);
@@ -553,6 +703,18 @@ void MemPoolTest::InitBenchmark()
         1,
         // 4,
     };
+    AccessPatterns accessPatterns[] =
+    {
+        AccessPatterns::Linear,
+        AccessPatterns::RandomPermutation,
+        AccessPatterns::StridedGather,
+        AccessPatterns::PointerChase,
+        AccessPatterns::SparseBlocks,
+        AccessPatterns::WriteOnly,
+        AccessPatterns::ReadModifyWrite,
+    };
+    const uint32 benchmarkGatherStride = 16;
+    const uint32 benchmarkSparseBlockSize = 16;
 
     for(HeapTypes heapType : HeapTypesValues)
     {
@@ -603,17 +765,27 @@ void MemPoolTest::InitBenchmark()
                                     {
                                         for(uint32 threadElemOffset : threadElemOffsets)
                                         {
-                                            BenchmarkConfig& config = benchmarkConfigs.Add();
-                                            config.HeapType = heapType;
-                                            config.CPUPageProperty = cpuPageProperty;
-                                            config.MemoryPool = memoryPool;
-                                            config.InputBufferType = bufferType;
-                                            config.NumThreadGroups = numThreadGroups;
-                                            config.InputBufferSize = inputBufferSize;
-                                            config.ElemsPerThread = elemsPerThread;
-                                            config.ThreadElemStride = threadElemStride;
-                                            config.GroupElemOffset = groupElemOffset;
-                                            config.ThreadElemOffset = threadElemOffset;
+                                            for(AccessPatterns accessPattern : accessPatterns)
+                                            {
+                                                // The write patterns can't test an upload heap since the GPU can't write to it
+                                                if(heapType == HeapTypes::Upload && AccessPatternUsesTargetBuffer(accessPattern))
+                                                    continue;
+
+                                                BenchmarkConfig& config = benchmarkConfigs.Add();
+                                                config.HeapType = heapType;
+                                                config.CPUPageProperty = cpuPageProperty;
+                                                config.MemoryPool = memoryPool;
+                                                config.InputBufferType = bufferType;
+                                                config.NumThreadGroups = numThreadGroups;
+                                                config.InputBufferSize = inputBufferSize;
+                                                config.ElemsPerThread = elemsPerThread;
+                                                config.ThreadElemStride = threadElemStride;
+                                                config.GroupElemOffset = groupElemOffset;
+                                                config.ThreadElemOffset = threadElemOffset;
+                                                config.AccessPattern = accessPattern;
+                                                config.GatherStride = benchmarkGatherStride;
+                                                config.SparseBlockSize = benchmarkSparseBlockSize;
+                                            }
                                         }
                                     }
                                 }
@@ -669,10 +841,13 @@ void MemPoolTest::UpdateBuffer()
 
                 MapResult mapResult = uploadBuffer.MapAndSetData(inputBufferShadowMem.Data(), uploadBuffer.Size);
 
+                // Nothing in this frame has read from the region that the buffer just cycled to, so the copy
+                // can go ahead without a barrier. The one after it gets flushed right before the compute job.
                 const uint64 dstOffset = inputBuffer.CycleBuffer();
+                DX12::CmdListBarriers.TrackBuffer(inputBuffer.Resource(), ResourceStates::BufferCopyDest);
                 cmdList->CopyBufferRegion(inputBuffer.Resource(), dstOffset, mapResult.Resource, mapResult.ResourceOffset, uploadBuffer.Size);
 
-                DX12::Barrier(cmdList, inputBuffer.InternalBuffer.WriteToReadBarrier({ .SyncBefore = D3D12_BARRIER_SYNC_COPY, .AccessBefore = D3D12_BARRIER_ACCESS_COPY_DEST }));
+                DX12::CmdListBarriers.TransitionBuffer(inputBuffer.Resource(), ResourceStates::BufferShaderResource);
             }
         }
     }
@@ -699,9 +874,59 @@ void MemPoolTest::RunCompute()
 
     AppSettings::BindCBufferCompute(cmdList, URS_AppSettings);
 
+    // Writes from the previous dispatch (or reads from the validation copy) need to finish first
+    const bool useTargetBuffer = targetBuffer.Resource() != nullptr;
+    DX12::CmdListBarriers.TransitionBuffer(outputBuffer.Resource(), ResourceStates::BufferUnorderedAccess);
+    if(useTargetBuffer)
+        DX12::CmdListBarriers.TransitionBuffer(targetBuffer.Resource(), ResourceStates::BufferUnorderedAccess);
+    DX12::FlushBarriers(cmdList);
+
     cmdList->Dispatch(AppSettings::NumThreadGroups, 1, 1);
 
-    DX12::Barrier(cmdList, outputBuffer.InternalBuffer.WriteToWriteBarrier());
+    // Read-Modify-Write only matches the reference once the target has been through a dispatch with the current
+    // addressing, so skip capturing the very first one
+    const bool captureResults = validationRequested && AppSettings::WriteThreadSums && numComputeDispatches > 0 &&
+                                validationFrame == uint64(-1);
+    numComputeDispatches += 1;
+
+    if(captureResults)
+    {
+        const uint64 outputSize = outputBuffer.NumElements * 4;
+        const uint64 targetSize = useTargetBuffer ? targetBuffer.NumElements * 4 : 0;
+        validationReadback.Initialize(outputSize + targetSize);
+
+        DX12::CmdListBarriers.TransitionBuffer(outputBuffer.Resource(), ResourceStates::BufferCopySource);
+        if(useTargetBuffer)
+            DX12::CmdListBarriers.TransitionBuffer(targetBuffer.Resource(), ResourceStates::BufferCopySource);
+        DX12::FlushBarriers(cmdList);
+
+        cmdList->CopyBufferRegion(validationReadback.Resource, 0, outputBuffer.Resource(), 0, outputSize);
+        if(useTargetBuffer)
+            cmdList->CopyBufferRegion(validationReadback.Resource, outputSize, targetBuffer.Resource(), 0, targetSize);
+
+        validationRequested = false;
+        validationFrame = DX12::CurrentCPUFrame;
+        AppSettings::WriteThreadSums.SetValue(false);
+    }
+}
+
+void MemPoolTest::CheckAccessPatternValidation()
+{
+    // Wait until the GPU has finished the frame that copied the results into the readback buffer
+    if(validationFrame == uint64(-1) || DX12::CurrentGPUFrame <= validationFrame)
+        return;
+
+    const float* results = validationReadback.Map<float>();
+    const float* threadSums = results;
+    const Float4* target = nullptr;
+    if(targetBuffer.Resource() != nullptr)
+        target = reinterpret_cast<const Float4*>(results + outputBuffer.NumElements);
+
+    ValidateAccessPatternResults(accessPatternDesc, accessPatternIndices, inputBufferShadowMem, threadSums, target);
+
+    validationReadback.Unmap();
+    validationReadback.Shutdown();
+    validationFrame = uint64(-1);
 }
 
 static double ToMB(uint64 numBytes)
@@ -778,20 +1003,34 @@ void MemPoolTest::RenderHUD(const Timer& timer)
     else
         ImGui::Text("Input Buffer Size: %llu B", inputBufferSize);
 
-    const uint64 bufferBytesRead = uint64(AppSettings::ElemsPerThread) * 16ull * numComputeJobThreads;
-    if(bufferBytesRead >= (1024 * 1024))
-        ImGui::Text("Total Bytes Read: %.2f MB", bufferBytesRead / (1024.0 * 1024.0f));
-    else if(bufferBytesRead >= 1024)
-        ImGui::Text("Total Bytes Read: %.2f KB", bufferBytesRead / 1024.0);
-    else
-        ImGui::Text("Total Bytes Read: %llu B", bufferBytesRead);
+    ImGui::Text("Access Pattern: %s", AccessPatternsLabels[uint32(accessPatternDesc.Pattern)]);
+    if(AccessPatternUsesTargetBuffer(accessPatternDesc.Pattern) && AppSettings::HeapType == HeapTypes::Upload)
+        ImGui::Text("Target Buffer: DEFAULT heap (the GPU can't write to UPLOAD heaps)");
+
+    auto byteCountText = [](const char* label, uint64 numBytes)
+    {
+        if(numBytes >= (1024 * 1024))
+            ImGui::Text("%s: %.2f MB", label, numBytes / (1024.0 * 1024.0f));
+        else if(numBytes >= 1024)
+            ImGui::Text("%s: %.2f KB", label, numBytes / 1024.0);
+        else
+            ImGui::Text("%s: %llu B", label, numBytes);
+    };
+
+    byteCountText("Total Bytes Read", accessPatternStats.BytesRead);
+    byteCountText("Unique Bytes Read", accessPatternStats.UniqueBytesRead);
+    byteCountText("Total Bytes Written", accessPatternStats.BytesWritten);
+    byteCountText("Unique Bytes Written", accessPatternStats.UniqueBytesWritten);
+    if(AccessPatternUsesIndexBuffer(accessPatternDesc.Pattern))
+        byteCountText("Index Bytes Read", accessPatternStats.IndexBytesRead);
 
     ImGui::Text("Total Num Threads: %u", numComputeJobThreads);
 
     ImGui::Separator();
 
+    const uint64 bufferBytesAccessed = accessPatternStats.BytesRead + accessPatternStats.BytesWritten;
     const double computeJobTime = Profiler::GlobalProfiler.GPUProfileTimingAvg("Compute Job");
-    const double maxEffectiveBandwidth = (bufferBytesRead / (1024.0 * 1024.0)) / (computeJobTime / 1000.0);
+    const double maxEffectiveBandwidth = (bufferBytesAccessed / (1024.0 * 1024.0)) / (computeJobTime / 1000.0);
 
     ImGui::Text("Total Frame Time: %.2f ms", avgFrameTime * 1000.0);
     ImGui::Text("GPU Time Reading Buffer: %.2f ms", computeJobTime);
@@ -810,10 +1049,22 @@ void MemPoolTest::RenderHUD(const Timer& timer)
         copyTestInfoToClipboard = ImGui::Button("Copy To Clipboard");
         if(ImGui::Button("Run Benchmark"))
         {
+            PrecompileBenchmarkShaders();
+
             benchmarkConfigIdx = 0;
             benchmarkFrameIdx = NumBenchmarkTotalFrames;
         }
 
+        if(ImGui::Button("Validate Access Pattern"))
+        {
+            // Check the generators on the CPU right away, then have the next dispatch write out its sums so
+            // that they can be compared against the CPU reference once the GPU is done with them
+            ValidateAccessPatternGenerators();
+
+            validationRequested = true;
+            AppSettings::WriteThreadSums.SetValue(true);
+        }
+
         ImGui::InputText("Benchmark CSV Name", benchmarkCSVName, ArraySize_(benchmarkCSVName));
     }
     else
@@ -842,6 +1093,9 @@ void MemPoolTest::TickBenchmark()
         AppSettings::ThreadElemStride.SetValue(config.ThreadElemStride);
         AppSettings::GroupElemOffset.SetValue(config.GroupElemOffset);
         AppSettings::ThreadElemOffset.SetValue(config.ThreadElemOffset);
+        AppSettings::AccessPattern.SetValue(config.AccessPattern);
+        AppSettings::GatherStride.SetValue(config.GatherStride);
+        AppSettings::SparseBlockSize.SetValue(config.SparseBlockSize);
 
         const uint32 inputBufferBytes = uint32(config.InputBufferSize % 1024);
         const uint32 inputBufferKB = uint32(config.InputBufferSize % (1024 * 1024)) / 1024;
@@ -886,6 +1140,7 @@ void MemPoolTest::TickBenchmark()
         results.ComputeJobTime /= NumBenchmarkMeasureFrames;
         results.CPUTimeUpdatingBuffer /= NumBenchmarkMeasureFrames;
         results.CPUTimeReadingBuffer /= NumBenchmarkMeasureFrames;
+        results.Stats = accessPatternStats;
 
         benchmarkConfigIdx += 1;
     }
@@ -893,7 +1148,8 @@ void MemPoolTest::TickBenchmark()
     if(benchmarkConfigIdx == numBenchmarks)
     {
         std::string csv = "HeapType, CPUPageProperty, MemoryPool, InputBufferType, NumThreadGroups, InputBufferSize, ElemsPerThread, ThreadElemStride, GroupElemOffset, ThreadElemOffset, ";
-        csv += "Total Num Threads, CPU-Writable Heap, Total Bytes Read, Unique Bytes Read, ";
+        csv += "AccessPattern, GatherStride, SparseBlockSize, AccessPatternSeed, ";
+        csv += "Total Num Threads, CPU-Writable Heap, Total Bytes Read, Unique Bytes Read, Total Bytes Written, Unique Bytes Written, Index Bytes Read, ";
         csv += "Compute Job Time (ms), CPU Time Updating Buffer (ms), CPU Time Reading Buffer (ms), Max Effective Bandwidth (MB) \n";
 
         for(uint32 benchmarkIdx = 0; benchmarkIdx < numBenchmarks; ++benchmarkIdx)
@@ -902,11 +1158,9 @@ void MemPoolTest::TickBenchmark()
             const BenchmarkResults& results = benchmarkResults[benchmarkIdx];
 
             const uint32 numTotalThreads = AppSettings::ThreadGroupSize * config.NumThreadGroups;
-            const uint64 bufferBytesRead = uint64(config.ElemsPerThread) * 16ull * numTotalThreads;
-            const uint64 uniqueBytesPerGroup = config.ElemsPerThread * 16ull * (config.ThreadElemOffset > 0 ? AppSettings::ThreadGroupSize : 1);
-            const uint64 uniqueBytesRead = Min(uniqueBytesPerGroup * (config.GroupElemOffset > 0 ? config.NumThreadGroups : 1), config.InputBufferSize);
+            const uint64 bufferBytesAccessed = results.Stats.BytesRead + results.Stats.BytesWritten;
 
-            const double maxEffectiveBandwidth = (bufferBytesRead / (1024.0 * 1024.0)) / (results.ComputeJobTime / 1000.0);
+            const double maxEffectiveBandwidth = (bufferBytesAccessed / (1024.0 * 1024.0)) / (results.ComputeJobTime / 1000.0);
 
             csv += MakeString("%s, ", HeapTypesLabels[uint32(config.HeapType)]);
             csv += MakeString("%s, ", CPUPagePropertiesLabels[uint32(config.CPUPageProperty)]);
@@ -918,11 +1172,18 @@ void MemPoolTest::TickBenchmark()
             csv += MakeString("%u, ", config.ThreadElemStride);
             csv += MakeString("%u, ", config.GroupElemOffset);
             csv += MakeString("%u, ", config.ThreadElemOffset);
+            csv += MakeString("%s, ", AccessPatternsLabels[uint32(config.AccessPattern)]);
+            csv += MakeString("%u, ", config.GatherStride);
+            csv += MakeString("%u, ", config.SparseBlockSize);
+            csv += MakeString("%d, ", AppSettings::AccessPatternSeed.Value());
 
             csv += MakeString("%u, ", numTotalThreads);
             csv += IsInputBufferCPUWritable(config) ? "Yes, " : "No, ";
-            csv += MakeString("%llu, ", bufferBytesRead);
-            csv += MakeString("%llu, ", uniqueBytesRead);
+            csv += MakeString("%llu, ", results.Stats.BytesRead);
+            csv += MakeString("%llu, ", results.Stats.UniqueBytesRead);
+            csv += MakeString("%llu, ", results.Stats.BytesWritten);
+            csv += MakeString("%llu, ", results.Stats.UniqueBytesWritten);
+            csv += MakeString("%llu, ", results.Stats.IndexBytesRead);
 
             csv += MakeString("%f, ", results.ComputeJobTime);
             csv += MakeString("%f, ", results.CPUTimeUpdatingBuffer);
@@ -15,6 +15,7 @@
 #include <App.h>
 #include <Graphics/GraphicsTypes.h>
 #include "AppSettings.h"
+#include "AccessPatterns.h"
 
 struct enkiTaskScheduler;
 struct enkiTaskSet;
@@ -33,6 +34,9 @@ struct BenchmarkConfig
     uint32 ThreadElemStride = 0;
     uint32 GroupElemOffset = 0;
     uint32 ThreadElemOffset = 0;
+    AccessPatterns AccessPattern = AccessPatterns::Linear;
+    uint32 GatherStride = 1;
+    uint32 SparseBlockSize = 1;
 };
 
 struct BenchmarkResults
@@ -40,6 +44,7 @@ struct BenchmarkResults
     double ComputeJobTime = 0.0;
     double CPUTimeUpdatingBuffer = 0.0;
     double CPUTimeReadingBuffer = 0.0;
+    AccessPatternStats Stats;
 };
 
 class MemPoolTest : public App
@@ -62,6 +67,17 @@ protected:
     Array<Float4> readbackMem;
     uint32 numComputeJobThreads = 0;
 
+    RawBuffer indexBuffer;
+    RawBuffer targetBuffer;
+    AccessPatternDesc accessPatternDesc;
+    Array<uint32> accessPatternIndices;
+    AccessPatternStats accessPatternStats;
+    uint32 numComputeDispatches = 0;
+
+    bool32 validationRequested = false;
+    uint64 validationFrame = uint64(-1);
+    ReadbackBuffer validationReadback;
+
     RawBuffer backgroundUploadBuffer;
     enkiTaskScheduler* taskScheduler = nullptr;
     enkiTaskSet* taskSet = nullptr;
@@ -92,9 +108,13 @@ protected:
     virtual void CreatePSOs() override;
     virtual void DestroyPSOs() override;
 
+    void UntrackBuffers();
     void CreateBuffers();
     void CompileComputeJob();
+    void UpdateAccessPatternStats();
+    void CheckAccessPatternValidation();
     void InitBenchmark();
+    void PrecompileBenchmarkShaders();
     void UpdateBuffer();
     void RunCompute();
     void RenderHUD(const Timer& timer);
@@ -14,4 +14,14 @@
     #include <Shaders/ShaderShared.h>
 #else
     #include <ShaderShared.h>
-#endif
\ No newline at end of file
+#endif
+
+// Element i of the input buffer holds (i & AccessPatternValueMask, next >> ChaseIdxLowBits, next & ChaseIdxLowMask, 1),
+// where next is the element that the Pointer Chase pattern visits after i (and is i itself for every other pattern).
+// Splitting next across 2 floats keeps it exact past 2^24 elements, and keeps every per-thread sum exact.
+SharedConstant_ uint32_t AccessPatternValueMask = 0xFFFF;
+SharedConstant_ uint32_t ChaseIdxLowBits = 12;
+SharedConstant_ uint32_t ChaseIdxLowMask = (1 << ChaseIdxLowBits) - 1;
+
+// The Sparse Blocks pattern reads one randomly-chosen block out of every SparseBlockSpacing blocks
+SharedConstant_ uint32_t SparseBlockSpacing = 8;
@@ -14,10 +14,13 @@
 #include "Graphics\\Profiler.h"
 #include "Graphics\\Spectrum.h"
 #include "Graphics\\ShaderDebug.h"
+#include "Graphics\\DX12_PipelineCache.h"
 #include "SF12_Math.h"
 #include "FileIO.h"
 #include "Settings.h"
+#include "Tasks.h"
 #include "ImGuiHelper.h"
+#include "SelfTests.h"
 #include "ImGui/imgui.h"
 
 // AppSettings framework
@@ -74,20 +77,57 @@ int32 App::Run()
 
         CreatePSOs_Internal();
 
-        while(window.IsAlive())
+        DX12::LogPipelineCacheStats("startup");
+
+        DrainLog();
+
+        if(runSelfTests)
         {
-            if(!window.IsMinimized())
+            // Run the framework's checks (and benchmarks) instead of the main loop, and report failures through
+            // the exit code
+            returnCode = RunSelfTests(runBenchmarks, selfTestFilter.c_str()) ? 0 : 1;
+
+            // The ImGui stress test times whole frames, so it runs through the main loop once the others are done.
+            // Its draws are also what the command list recording benchmark records.
+            if(runBenchmarks && (SelfTestMatchesFilter("ImGuiStressTest", selfTestFilter.c_str()) ||
+                                 SelfTestMatchesFilter("CmdListRecording", selfTestFilter.c_str())))
             {
-                Update_Internal();
+                WriteLog("== Benchmark ImGuiStressTest ==");
+
+                ImGuiHelper::RunStressTest();
+                while(ImGuiHelper::StressTestRunning() && window.IsAlive())
+                {
+                    if(!window.IsMinimized())
+                    {
+                        Update_Internal();
+
+                        Render_Internal();
+                    }
+
+                    window.MessageLoop();
+                }
 
-                Render_Internal();
+                DrainLog();
             }
+        }
+        else
+        {
+            while(window.IsAlive())
+            {
+                if(!window.IsMinimized())
+                {
+                    Update_Internal();
+
+                    Render_Internal();
+                }
 
-            window.MessageLoop();
+                window.MessageLoop();
+            }
         }
     }
     catch(SampleFramework12::Exception exception)
     {
+        DrainLog();
         exception.ShowErrorMessage();
         return -1;
     }
@@ -171,16 +211,32 @@ void App::ParseCommandLine(const wchar* cmdLine)
     cxxopts::Options options("App", "");
     options.allow_unrecognised_options();
     options.add_options()
-         ("a,adapter", "GPU adapter index", cxxopts::value<int32>());
+         ("a,adapter", "GPU adapter index", cxxopts::value<int32>())
+         ("selftest", "Run the framework's validation checks and exit")
+         ("benchmark", "Run the framework's validation checks and benchmarks, and exit")
+         ("selftest-filter", "Only run checks and benchmarks whose name contains this string", cxxopts::value<std::string>());
 
     cxxopts::ParseResult parseResult = options.parse(argc, argv);
 
     if(parseResult.count("adapter"))
         adapterIdx = parseResult["adapter"].as<int32>();
+
+    runBenchmarks = parseResult.count("benchmark") > 0;
+    runSelfTests = runBenchmarks || parseResult.count("selftest") > 0;
+    if(parseResult.count("selftest-filter"))
+        selfTestFilter = parseResult["selftest-filter"].as<std::string>();
+
+    // Nothing gets presented while the checks run
+    if(runSelfTests)
+        showWindow = false;
 }
 
 void App::Initialize_Internal()
 {
+    InitializeLog();
+
+    Tasks::Initialize();
+
     DX12::Initialize(minFeatureLevel, adapterIdx);
 
     window.SetClientArea(swapChain.Width(), swapChain.Height());
@@ -225,12 +281,19 @@ void App::Shutdown_Internal()
     Shutdown();
 
     DX12::Shutdown();
+
+    Tasks::Shutdown();
+
+    ShutdownLog();
 }
 
 void App::Update_Internal()
 {
     appTimer.Update();
 
+    // Flush anything that was logged since last frame (from any thread) into the log window
+    DrainLog();
+
     const uint32 displayWidth = swapChain.Width();
     const uint32 displayHeight = swapChain.Height();
     ImGuiHelper::BeginFrame(displayWidth, displayHeight, appTimer.DeltaSecondsF());
@@ -252,7 +315,10 @@ void App::Render_Internal()
 
         DX12::FlushGPU();
 
+        DX12::ResetPipelineCacheStats();
         CreatePSOs();
+        DX12::PrunePipelineCache();
+        DX12::LogPipelineCacheStats("shader reload");
     }
 
     DX12::BeginFrame();
@@ -363,8 +429,9 @@ void App::AddToLog(const char* msg)
     if(msg == nullptr)
         return;
 
-    const uint64 idx = uint64(InterlockedIncrement64(&numLogMessages) - 1) % MaxLogMessages;
-    logMessages[idx] = msg;
+    // Only called from the main thread, since other threads go through the log ring
+    logMessages[numLogMessages % MaxLogMessages] = msg;
+    numLogMessages += 1;
 
     newLogMessage = true;
 }
@@ -75,12 +75,16 @@ protected:
 
     static const uint64 MaxLogMessages = 1024;
     std::string logMessages[MaxLogMessages];
-    volatile int64 numLogMessages = 0;
+    uint64 numLogMessages = 0;
     bool showLog = false;
     bool newLogMessage = false;
 
     bool showGUI = true;
 
+    bool runSelfTests = false;
+    bool runBenchmarks = false;
+    std::string selfTestFilter;
+
 private:
 
     void ParseCommandLine(const wchar* cmdLine);
@@ -113,6 +113,17 @@ uint64 GetFileTimestamp(const wchar* filePath)
     return attributes.ftLastWriteTime.dwLowDateTime | (uint64(attributes.ftLastWriteTime.dwHighDateTime) << 32);
 }
 
+// Returns the last write time and the size of a file with a single query
+void GetFileTimestampAndSize(const wchar* filePath, uint64& timeStamp, uint64& fileSize)
+{
+    Assert_(filePath);
+
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    Win32Call(GetFileAttributesEx(filePath, GetFileExInfoStandard, &attributes));
+    timeStamp = attributes.ftLastWriteTime.dwLowDateTime | (uint64(attributes.ftLastWriteTime.dwHighDateTime) << 32);
+    fileSize = attributes.nFileSizeLow | (uint64(attributes.nFileSizeHigh) << 32);
+}
+
 // Returns the contents of a file as a string
 std::string ReadFileAsString(const wchar* filePath)
 {
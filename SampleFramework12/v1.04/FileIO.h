@@ -27,6 +27,7 @@ std::wstring GetFileNameWithoutExtension(const wchar* filePath);
 std::wstring GetFilePathWithoutExtension(const wchar* filePath);
 std::wstring GetFileExtension(const wchar* filePath);
 uint64 GetFileTimestamp(const wchar* filePath);
+void GetFileTimestampAndSize(const wchar* filePath, uint64& timeStamp, uint64& fileSize);
 
 std::string ReadFileAsString(const wchar* filePath);
 void WriteStringAsFile(const wchar* filePath, const std::string& data);
@@ -0,0 +1,1006 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "BVH.h"
+#include "Model.h"
+#include "..\\Tasks.h"
+#include "..\\Timer.h"
+
+namespace SampleFramework12
+{
+
+static const uint32 NumSAHBins = 16;
+static const uint32 MaxLeafPrims = 8;
+static const uint32 MaxTraversalDepth = 128;
+static const float SAHTraversalCost = 1.0f;
+
+// The traversal stacks grow by at most one entry per level, plus one for the children of the last interior
+// node. Near the limit the builder switches from SAH to median splits, which can handle 2^32 primitives in the
+// remaining levels, and anything that still reaches MaxTreeDepth becomes a leaf.
+static const uint32 MaxTreeDepth = MaxTraversalDepth - 2;
+static const uint32 MedianSplitDepth = MaxTreeDepth - 32;
+
+// Ranges smaller than this are built on a single thread
+static const uint32 MinParallelSubtreePrims = 4096;
+
+static float HalfSurfaceArea(const Float3& aabbMin, const Float3& aabbMax)
+{
+    const Float3 extent = aabbMax - aabbMin;
+    return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+}
+
+struct BVHBuildContext
+{
+    const Float3* PrimMins = nullptr;
+    const Float3* PrimMaxs = nullptr;
+    const Float3* Centroids = nullptr;
+    uint32* PrimIndices = nullptr;
+};
+
+struct BVHRange
+{
+    uint32 NodeIdx = 0;
+    uint32 First = 0;
+    uint32 Count = 0;
+    uint32 Depth = 0;
+};
+
+// Partitions a range around the median centroid on its longest axis, returning the number of primitives on the left side
+static uint32 MedianSplitRange(const BVHBuildContext& context, uint32 first, uint32 count, const Float3& centroidMin, const Float3& centroidMax)
+{
+    const Float3 centroidExtent = centroidMax - centroidMin;
+    uint32 axis = 0;
+    if(centroidExtent.y > centroidExtent[axis])
+        axis = 1;
+    if(centroidExtent.z > centroidExtent[axis])
+        axis = 2;
+
+    const uint32 numLeft = count / 2;
+    const Float3* centroids = context.Centroids;
+    std::nth_element(context.PrimIndices + first, context.PrimIndices + first + numLeft, context.PrimIndices + first + count,
+                     [centroids, axis](uint32 a, uint32 b) { return centroids[a][axis] < centroids[b][axis]; });
+
+    return numLeft;
+}
+
+// Computes the node bounds for a range, and either partitions it with binned SAH (returning
+// the number of primitives on the left side) or returns 0 if it should be a leaf
+static uint32 SplitRange(const BVHBuildContext& context, uint32 first, uint32 count, uint32 depth, BVHNode& node)
+{
+    Float3 nodeMin = FloatMax;
+    Float3 nodeMax = -FloatMax;
+    Float3 centroidMin = FloatMax;
+    Float3 centroidMax = -FloatMax;
+    for(uint32 i = first; i < first + count; ++i)
+    {
+        const uint32 primIdx = context.PrimIndices[i];
+        nodeMin = Min(nodeMin, context.PrimMins[primIdx]);
+        nodeMax = Max(nodeMax, context.PrimMaxs[primIdx]);
+        centroidMin = Min(centroidMin, context.Centroids[primIdx]);
+        centroidMax = Max(centroidMax, context.Centroids[primIdx]);
+    }
+
+    node.AABBMin = nodeMin;
+    node.AABBMax = nodeMax;
+
+    if(count <= 2 || depth >= MaxTreeDepth)
+        return 0;
+
+    // Degenerate inputs can make SAH peel off a few primitives per level, so close to the depth limit
+    // we fall back to median splits, which always halve the range
+    if(depth >= MedianSplitDepth)
+        return count <= MaxLeafPrims ? 0 : MedianSplitRange(context, first, count, centroidMin, centroidMax);
+
+    struct Bin
+    {
+        Float3 AABBMin = FloatMax;
+        Float3 AABBMax = -FloatMax;
+        uint32 Count = 0;
+    };
+
+    float bestCost = FloatMax;
+    uint32 bestAxis = 0;
+    uint32 bestSplit = 0;
+
+    for(uint32 axis = 0; axis < 3; ++axis)
+    {
+        const float axisMin = centroidMin[axis];
+        const float axisExtent = centroidMax[axis] - axisMin;
+        if(axisExtent <= 0.0f)
+            continue;
+
+        Bin bins[NumSAHBins];
+        const float binScale = NumSAHBins / axisExtent;
+        for(uint32 i = first; i < first + count; ++i)
+        {
+            const uint32 primIdx = context.PrimIndices[i];
+            const uint32 binIdx = Min(uint32((context.Centroids[primIdx][axis] - axisMin) * binScale), NumSAHBins - 1);
+            Bin& bin = bins[binIdx];
+            bin.AABBMin = Min(bin.AABBMin, context.PrimMins[primIdx]);
+            bin.AABBMax = Max(bin.AABBMax, context.PrimMaxs[primIdx]);
+            bin.Count += 1;
+        }
+
+        // Sweep from both sides to get the cost of splitting after each bin
+        float leftAreas[NumSAHBins - 1] = { };
+        uint32 leftCounts[NumSAHBins - 1] = { };
+        Float3 leftMin = FloatMax;
+        Float3 leftMax = -FloatMax;
+        uint32 leftCount = 0;
+        for(uint32 i = 0; i < NumSAHBins - 1; ++i)
+        {
+            leftCount += bins[i].Count;
+            if(bins[i].Count > 0)
+            {
+                leftMin = Min(leftMin, bins[i].AABBMin);
+                leftMax = Max(leftMax, bins[i].AABBMax);
+            }
+
+            leftCounts[i] = leftCount;
+            leftAreas[i] = leftCount > 0 ? HalfSurfaceArea(leftMin, leftMax) : 0.0f;
+        }
+
+        Float3 rightMin = FloatMax;
+        Float3 rightMax = -FloatMax;
+        uint32 rightCount = 0;
+        for(uint32 i = NumSAHBins - 1; i > 0; --i)
+        {
+            rightCount += bins[i].Count;
+            if(bins[i].Count > 0)
+            {
+                rightMin = Min(rightMin, bins[i].AABBMin);
+                rightMax = Max(rightMax, bins[i].AABBMax);
+            }
+
+            if(leftCounts[i - 1] == 0 || rightCount == 0)
+                continue;
+
+            const float cost = leftAreas[i - 1] * leftCounts[i - 1] + HalfSurfaceArea(rightMin, rightMax) * rightCount;
+            if(cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    // All of the centroids are in the same spot, so SAH can't separate anything. Splitting down the middle still
+    // keeps the leaves small instead of putting everything into one huge leaf.
+    if(bestCost == FloatMax)
+        return count <= MaxLeafPrims ? 0 : MedianSplitRange(context, first, count, centroidMin, centroidMax);
+
+    // Compare against the cost of intersecting everything in a leaf
+    const float nodeArea = HalfSurfaceArea(nodeMin, nodeMax);
+    const float splitCost = SAHTraversalCost + (nodeArea > 0.0f ? bestCost / nodeArea : 0.0f);
+    if(splitCost >= float(count) && count <= MaxLeafPrims)
+        return 0;
+
+    // Partition in place around the chosen bin boundary
+    const float axisMin = centroidMin[bestAxis];
+    const float binScale = NumSAHBins / (centroidMax[bestAxis] - axisMin);
+    uint32 left = first;
+    uint32 right = first + count;
+    while(left < right)
+    {
+        const uint32 primIdx = context.PrimIndices[left];
+        const uint32 binIdx = Min(uint32((context.Centroids[primIdx][bestAxis] - axisMin) * binScale), NumSAHBins - 1);
+        if(binIdx < bestSplit)
+        {
+            ++left;
+        }
+        else
+        {
+            --right;
+            std::swap(context.PrimIndices[left], context.PrimIndices[right]);
+        }
+    }
+
+    const uint32 numLeft = left - first;
+    return (numLeft > 0 && numLeft < count) ? numLeft : 0;
+}
+
+// Builds the hierarchy for a range into a node list, where the range's node must already be allocated
+static void BuildRange(const BVHBuildContext& context, List<BVHNode>& nodes, BVHRange rootRange)
+{
+    List<BVHRange> stack;
+    stack.Add(rootRange);
+
+    while(stack.Count() > 0)
+    {
+        const BVHRange range = stack[stack.Count() - 1];
+        stack.Remove(stack.Count() - 1);
+
+        BVHNode node;
+        const uint32 numLeft = SplitRange(context, range.First, range.Count, range.Depth, node);
+        if(numLeft == 0)
+        {
+            node.LeftFirst = range.First;
+            node.PrimCount = range.Count;
+            nodes[range.NodeIdx] = node;
+            continue;
+        }
+
+        node.LeftFirst = uint32(nodes.Count());
+        node.PrimCount = 0;
+        nodes[range.NodeIdx] = node;
+        nodes.AddMultiple(2);
+
+        BVHRange leftRange = { node.LeftFirst, range.First, numLeft, range.Depth + 1 };
+        BVHRange rightRange = { node.LeftFirst + 1, range.First + numLeft, range.Count - numLeft, range.Depth + 1 };
+        stack.Add(rightRange);
+        stack.Add(leftRange);
+    }
+}
+
+struct BVHSubtreeTaskArgs
+{
+    const BVHBuildContext* Context = nullptr;
+    const BVHRange* Ranges = nullptr;
+    List<BVHNode>* SubtreeNodes = nullptr;
+};
+
+static void BuildSubtreeTask(uint32 start, uint32 end, uint32 threadNum, void* args_)
+{
+    const BVHSubtreeTaskArgs* args = reinterpret_cast<const BVHSubtreeTaskArgs*>(args_);
+    for(uint32 i = start; i < end; ++i)
+    {
+        List<BVHNode>& subtreeNodes = args->SubtreeNodes[i];
+        subtreeNodes.Add(BVHNode());
+
+        BVHRange range = args->Ranges[i];
+        range.NodeIdx = 0;
+        BuildRange(*args->Context, subtreeNodes, range);
+    }
+}
+
+void BVH::Build(const Float3* primMins, const Float3* primMaxs, uint64 numPrims)
+{
+    Assert_(numPrims < UINT32_MAX);
+
+    nodes.Shutdown();
+    primIndices.Init(numPrims);
+    if(numPrims == 0)
+        return;
+
+    Array<Float3> centroids(numPrims);
+    for(uint64 i = 0; i < numPrims; ++i)
+    {
+        centroids[i] = (primMins[i] + primMaxs[i]) * 0.5f;
+        primIndices[i] = uint32(i);
+    }
+
+    BVHBuildContext context;
+    context.PrimMins = primMins;
+    context.PrimMaxs = primMaxs;
+    context.Centroids = centroids.Data();
+    context.PrimIndices = primIndices.Data();
+
+    // Split the top of the tree on this thread until there are enough large subtrees to keep
+    // all of the worker threads busy, and then build those subtrees in parallel
+    const uint64 targetSubtrees = Tasks::NumThreads() * 4;
+
+    List<BVHNode> topNodes;
+    topNodes.Add(BVHNode());
+
+    List<BVHRange> pendingRanges;
+    List<BVHRange> subtreeRanges;
+    pendingRanges.Add({ 0, 0, uint32(numPrims), 0 });
+    while(pendingRanges.Count() > 0)
+    {
+        const BVHRange range = pendingRanges[0];
+        pendingRanges.Remove(0);
+
+        if(range.Count < MinParallelSubtreePrims || (pendingRanges.Count() + subtreeRanges.Count()) >= targetSubtrees)
+        {
+            subtreeRanges.Add(range);
+            continue;
+        }
+
+        BVHNode& node = topNodes[range.NodeIdx];
+        const uint32 numLeft = SplitRange(context, range.First, range.Count, range.Depth, node);
+        if(numLeft == 0)
+        {
+            node.LeftFirst = range.First;
+            node.PrimCount = range.Count;
+            continue;
+        }
+
+        // Adding the children can re-allocate the list, so the node reference is invalid afterwards
+        const uint32 leftIdx = uint32(topNodes.Count());
+        node.LeftFirst = leftIdx;
+        node.PrimCount = 0;
+        topNodes.AddMultiple(2);
+
+        pendingRanges.Add({ leftIdx, range.First, numLeft, range.Depth + 1 });
+        pendingRanges.Add({ leftIdx + 1, range.First + numLeft, range.Count - numLeft, range.Depth + 1 });
+    }
+
+    Array<List<BVHNode>> subtreeNodes(subtreeRanges.Count());
+
+    BVHSubtreeTaskArgs args;
+    args.Context = &context;
+    args.Ranges = subtreeRanges.Data();
+    args.SubtreeNodes = subtreeNodes.Data();
+    Tasks::ParallelFor(uint32(subtreeRanges.Count()), 1, BuildSubtreeTask, &args);
+
+    // Stitch the subtrees into the final node array. Each subtree's root replaces its placeholder
+    // in the top of the tree, and the rest of its nodes are appended with their indices offset.
+    uint64 numNodes = topNodes.Count();
+    for(const List<BVHNode>& subtree : subtreeNodes)
+        numNodes += subtree.Count() - 1;
+
+    nodes.Init(numNodes);
+    memcpy(nodes.Data(), topNodes.Data(), topNodes.Count() * sizeof(BVHNode));
+
+    uint64 nextNode = topNodes.Count();
+    for(uint64 subtreeIdx = 0; subtreeIdx < subtreeRanges.Count(); ++subtreeIdx)
+    {
+        const List<BVHNode>& subtree = subtreeNodes[subtreeIdx];
+        const uint32 offset = uint32(nextNode - 1);
+        for(uint64 localIdx = 0; localIdx < subtree.Count(); ++localIdx)
+        {
+            BVHNode node = subtree[localIdx];
+            if(node.IsLeaf() == false)
+                node.LeftFirst += offset;
+
+            if(localIdx == 0)
+                nodes[subtreeRanges[subtreeIdx].NodeIdx] = node;
+            else
+                nodes[nextNode++] = node;
+        }
+    }
+
+    Assert_(nextNode == numNodes);
+}
+
+void BVH::BuildFromTriangles(const Float3* positions, uint64 numTriangles)
+{
+    Timer timer;
+
+    Array<Float3> triMins(numTriangles);
+    Array<Float3> triMaxs(numTriangles);
+    for(uint64 i = 0; i < numTriangles; ++i)
+    {
+        const Float3* tri = &positions[i * 3];
+        triMins[i] = Min(Min(tri[0], tri[1]), tri[2]);
+        triMaxs[i] = Max(Max(tri[0], tri[1]), tri[2]);
+    }
+
+    primType = BVHPrimitiveType::Triangles;
+    Build(triMins.Data(), triMaxs.Data(), numTriangles);
+
+    // Store the triangles in leaf order, so that traversal doesn't need to follow the indices
+    primData.Init(numTriangles * 3);
+    for(uint64 i = 0; i < numTriangles; ++i)
+    {
+        const Float3* tri = &positions[primIndices[i] * 3];
+        primData[i * 3 + 0] = tri[0];
+        primData[i * 3 + 1] = tri[1];
+        primData[i * 3 + 2] = tri[2];
+    }
+
+    timer.Update();
+    buildTimeMS = timer.ElapsedMillisecondsD();
+}
+
+void BVH::BuildFromAABBs(const Float3* aabbMins, const Float3* aabbMaxs, uint64 numAABBs)
+{
+    Timer timer;
+
+    primType = BVHPrimitiveType::AABBs;
+    Build(aabbMins, aabbMaxs, numAABBs);
+
+    primData.Init(numAABBs * 2);
+    for(uint64 i = 0; i < numAABBs; ++i)
+    {
+        primData[i * 2 + 0] = aabbMins[primIndices[i]];
+        primData[i * 2 + 1] = aabbMaxs[primIndices[i]];
+    }
+
+    timer.Update();
+    buildTimeMS = timer.ElapsedMillisecondsD();
+}
+
+void BVH::BuildFromModelTriangles(const Model& model)
+{
+    const Array<Mesh>& meshes = model.Meshes();
+    const MeshVertex* vertices = model.Vertices();
+
+    uint64 numTriangles = 0;
+    for(const Mesh& mesh : meshes)
+        numTriangles += mesh.NumIndices() / 3;
+
+    Array<Float3> positions(numTriangles * 3);
+    uint64 vtxOffset = 0;
+    uint64 idxOffset = 0;
+    for(const Mesh& mesh : meshes)
+    {
+        for(uint32 i = 0; i < mesh.NumIndices(); ++i)
+        {
+            const uint32 idx = model.IndexBufferType() == IndexType::Index16Bit ? model.Indices()[idxOffset + i] : model.Indices32()[idxOffset + i];
+            positions[idxOffset + i] = vertices[vtxOffset + idx].Position;
+        }
+
+        vtxOffset += mesh.NumVertices();
+        idxOffset += mesh.NumIndices();
+    }
+
+    BuildFromTriangles(positions.Data(), numTriangles);
+}
+
+void BVH::BuildFromMeshAABBs(const Model& model)
+{
+    const Array<Mesh>& meshes = model.Meshes();
+
+    Array<Float3> aabbMins(meshes.Size());
+    Array<Float3> aabbMaxs(meshes.Size());
+    for(uint64 i = 0; i < meshes.Size(); ++i)
+    {
+        aabbMins[i] = meshes[i].AABBMin();
+        aabbMaxs[i] = meshes[i].AABBMax();
+    }
+
+    BuildFromAABBs(aabbMins.Data(), aabbMaxs.Data(), meshes.Size());
+}
+
+void BVH::Shutdown()
+{
+    nodes.Shutdown();
+    primIndices.Shutdown();
+    primData.Shutdown();
+    buildTimeMS = 0.0;
+}
+
+// == Queries =====================================================================================
+
+// Slab test, returning the entry distance or FloatMax on a miss
+static float IntersectRayAABB(const Float3& origin, const Float3& invDir, float tMax, const Float3& aabbMin, const Float3& aabbMax)
+{
+    const float tx0 = (aabbMin.x - origin.x) * invDir.x;
+    const float tx1 = (aabbMax.x - origin.x) * invDir.x;
+    const float ty0 = (aabbMin.y - origin.y) * invDir.y;
+    const float ty1 = (aabbMax.y - origin.y) * invDir.y;
+    const float tz0 = (aabbMin.z - origin.z) * invDir.z;
+    const float tz1 = (aabbMax.z - origin.z) * invDir.z;
+
+    const float tEnter = Max(Max(Min(tx0, tx1), Min(ty0, ty1)), Max(Min(tz0, tz1), 0.0f));
+    const float tExit = Min(Min(Max(tx0, tx1), Max(ty0, ty1)), Min(Max(tz0, tz1), tMax));
+
+    return tEnter <= tExit ? tEnter : FloatMax;
+}
+
+static Float3 SafeInverseDirection(const Float3& direction)
+{
+    const float eps = 1e-20f;
+    return Float3(1.0f / (std::abs(direction.x) > eps ? direction.x : std::copysign(eps, direction.x)),
+                  1.0f / (std::abs(direction.y) > eps ? direction.y : std::copysign(eps, direction.y)),
+                  1.0f / (std::abs(direction.z) > eps ? direction.z : std::copysign(eps, direction.z)));
+}
+
+bool BVH::IntersectPrimitive(uint64 primSlot, const Float3& origin, const Float3& direction, float tMax, BVHHit& hit) const
+{
+    if(primType == BVHPrimitiveType::AABBs)
+    {
+        const float t = IntersectRayAABB(origin, SafeInverseDirection(direction), tMax, primData[primSlot * 2 + 0], primData[primSlot * 2 + 1]);
+        if(t >= tMax)
+            return false;
+
+        hit.T = t;
+        hit.PrimIdx = primIndices[primSlot];
+        hit.Barycentrics = Float2();
+        return true;
+    }
+
+    // Moller-Trumbore, two-sided
+    const Float3& p0 = primData[primSlot * 3 + 0];
+    const Float3 e1 = primData[primSlot * 3 + 1] - p0;
+    const Float3 e2 = primData[primSlot * 3 + 2] - p0;
+
+    const Float3 p = Float3::Cross(direction, e2);
+    const float det = Float3::Dot(e1, p);
+    if(std::abs(det) < 1e-12f)
+        return false;
+
+    const float invDet = 1.0f / det;
+    const Float3 s = origin - p0;
+    const float u = Float3::Dot(s, p) * invDet;
+    if(u < 0.0f || u > 1.0f)
+        return false;
+
+    const Float3 q = Float3::Cross(s, e1);
+    const float v = Float3::Dot(direction, q) * invDet;
+    if(v < 0.0f || u + v > 1.0f)
+        return false;
+
+    const float t = Float3::Dot(e2, q) * invDet;
+    if(t < 0.0f || t >= tMax)
+        return false;
+
+    hit.T = t;
+    hit.PrimIdx = primIndices[primSlot];
+    hit.Barycentrics = Float2(u, v);
+    return true;
+}
+
+bool BVH::IntersectRay(const Float3& origin, const Float3& direction, float tMax, BVHHit& hit) const
+{
+    hit = BVHHit();
+    if(nodes.Size() == 0)
+        return false;
+
+    const Float3 invDir = SafeInverseDirection(direction);
+    if(IntersectRayAABB(origin, invDir, tMax, nodes[0].AABBMin, nodes[0].AABBMax) == FloatMax)
+        return false;
+
+    float closestT = tMax;
+    bool foundHit = false;
+
+    uint32 stack[MaxTraversalDepth];
+    uint32 stackSize = 0;
+    uint32 nodeIdx = 0;
+    while(true)
+    {
+        const BVHNode& node = nodes[nodeIdx];
+        if(node.IsLeaf())
+        {
+            for(uint32 i = 0; i < node.PrimCount; ++i)
+            {
+                if(IntersectPrimitive(node.LeftFirst + i, origin, direction, closestT, hit))
+                {
+                    closestT = hit.T;
+                    foundHit = true;
+                }
+            }
+        }
+        else
+        {
+            // Visit the closer child first, and push the other one
+            uint32 nearIdx = node.LeftFirst;
+            uint32 farIdx = node.LeftFirst + 1;
+            float nearT = IntersectRayAABB(origin, invDir, closestT, nodes[nearIdx].AABBMin, nodes[nearIdx].AABBMax);
+            float farT = IntersectRayAABB(origin, invDir, closestT, nodes[farIdx].AABBMin, nodes[farIdx].AABBMax);
+            if(farT < nearT)
+            {
+                std::swap(nearIdx, farIdx);
+                std::swap(nearT, farT);
+            }
+
+            if(nearT != FloatMax)
+            {
+                if(farT != FloatMax)
+                {
+                    Assert_(stackSize < MaxTraversalDepth);
+                    stack[stackSize++] = farIdx;
+                }
+
+                nodeIdx = nearIdx;
+                continue;
+            }
+        }
+
+        if(stackSize == 0)
+            break;
+        nodeIdx = stack[--stackSize];
+    }
+
+    if(foundHit == false)
+        hit = BVHHit();
+
+    return foundHit;
+}
+
+bool BVH::IntersectRayAny(const Float3& origin, const Float3& direction, float tMax) const
+{
+    if(nodes.Size() == 0)
+        return false;
+
+    const Float3 invDir = SafeInverseDirection(direction);
+
+    uint32 stack[MaxTraversalDepth];
+    uint32 stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0)
+    {
+        const BVHNode& node = nodes[stack[--stackSize]];
+        if(IntersectRayAABB(origin, invDir, tMax, node.AABBMin, node.AABBMax) == FloatMax)
+            continue;
+
+        if(node.IsLeaf())
+        {
+            BVHHit hit;
+            for(uint32 i = 0; i < node.PrimCount; ++i)
+                if(IntersectPrimitive(node.LeftFirst + i, origin, direction, tMax, hit))
+                    return true;
+        }
+        else
+        {
+            Assert_(stackSize + 2 <= MaxTraversalDepth);
+            stack[stackSize++] = node.LeftFirst + 1;
+            stack[stackSize++] = node.LeftFirst;
+        }
+    }
+
+    return false;
+}
+
+void BVH::QueryAABB(const Float3& aabbMin, const Float3& aabbMax, List<uint32>& results) const
+{
+    if(nodes.Size() == 0)
+        return;
+
+    auto overlaps = [&](const Float3& otherMin, const Float3& otherMax)
+    {
+        return otherMin.x <= aabbMax.x && otherMax.x >= aabbMin.x &&
+               otherMin.y <= aabbMax.y && otherMax.y >= aabbMin.y &&
+               otherMin.z <= aabbMax.z && otherMax.z >= aabbMin.z;
+    };
+
+    uint32 stack[MaxTraversalDepth];
+    uint32 stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0)
+    {
+        const BVHNode& node = nodes[stack[--stackSize]];
+        if(overlaps(node.AABBMin, node.AABBMax) == false)
+            continue;
+
+        if(node.IsLeaf())
+        {
+            for(uint32 i = node.LeftFirst; i < node.LeftFirst + node.PrimCount; ++i)
+            {
+                Float3 primMin;
+                Float3 primMax;
+                if(primType == BVHPrimitiveType::AABBs)
+                {
+                    primMin = primData[i * 2 + 0];
+                    primMax = primData[i * 2 + 1];
+                }
+                else
+                {
+                    const Float3* tri = &primData[i * 3];
+                    primMin = Min(Min(tri[0], tri[1]), tri[2]);
+                    primMax = Max(Max(tri[0], tri[1]), tri[2]);
+                }
+
+                if(overlaps(primMin, primMax))
+                    results.Add(primIndices[i]);
+            }
+        }
+        else
+        {
+            Assert_(stackSize + 2 <= MaxTraversalDepth);
+            stack[stackSize++] = node.LeftFirst + 1;
+            stack[stackSize++] = node.LeftFirst;
+        }
+    }
+}
+
+
+// == Testing =====================================================================================
+
+static uint32 ComputeMaxDepth(const Array<BVHNode>& nodes)
+{
+    if(nodes.Size() == 0)
+        return 0;
+
+    struct StackEntry
+    {
+        uint32 NodeIdx;
+        uint32 Depth;
+    };
+
+    List<StackEntry> stack;
+    stack.Add({ 0, 0 });
+
+    uint32 maxDepth = 0;
+    while(stack.Count() > 0)
+    {
+        const StackEntry entry = stack[stack.Count() - 1];
+        stack.Remove(stack.Count() - 1);
+
+        maxDepth = Max(maxDepth, entry.Depth);
+        const BVHNode& node = nodes[entry.NodeIdx];
+        if(node.IsLeaf() == false)
+        {
+            stack.Add({ node.LeftFirst, entry.Depth + 1 });
+            stack.Add({ node.LeftFirst + 1, entry.Depth + 1 });
+        }
+    }
+
+    return maxDepth;
+}
+
+// Same test as BVH::IntersectPrimitive(), but with the original triangle order
+static float IntersectRayTriangleReference(const Float3& origin, const Float3& direction, float tMax, const Float3* tri)
+{
+    const Float3 e1 = tri[1] - tri[0];
+    const Float3 e2 = tri[2] - tri[0];
+
+    const Float3 p = Float3::Cross(direction, e2);
+    const float det = Float3::Dot(e1, p);
+    if(std::abs(det) < 1e-12f)
+        return FloatMax;
+
+    const float invDet = 1.0f / det;
+    const Float3 s = origin - tri[0];
+    const float u = Float3::Dot(s, p) * invDet;
+    if(u < 0.0f || u > 1.0f)
+        return FloatMax;
+
+    const Float3 q = Float3::Cross(s, e1);
+    const float v = Float3::Dot(direction, q) * invDet;
+    if(v < 0.0f || u + v > 1.0f)
+        return FloatMax;
+
+    const float t = Float3::Dot(e2, q) * invDet;
+    return (t < 0.0f || t >= tMax) ? FloatMax : t;
+}
+
+static Float3 RandomDirection(Random& rng)
+{
+    const Float2 u = rng.RandomFloat2();
+    const float cosTheta = 1.0f - 2.0f * u.x;
+    const float sinTheta = std::sqrt(Max(1.0f - cosTheta * cosTheta, 0.0f));
+    const float phi = u.y * Pi2;
+    return Float3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+}
+
+// Small random triangles scattered through a cube centered on the origin
+static void MakeTriangleSoup(uint64 numTriangles, float sceneSize, float triangleSize, uint32 seed, Array<Float3>& positions)
+{
+    Random rng;
+    rng.SeedWithValue(seed);
+
+    positions.Init(numTriangles * 3);
+    for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+    {
+        const Float3 center = (Float3(rng.RandomFloat(), rng.RandomFloat(), rng.RandomFloat()) - 0.5f) * sceneSize;
+        for(uint64 i = 0; i < 3; ++i)
+            positions[triIdx * 3 + i] = center + (Float3(rng.RandomFloat(), rng.RandomFloat(), rng.RandomFloat()) - 0.5f) * triangleSize;
+    }
+}
+
+bool ValidateBVH()
+{
+    bool passed = true;
+
+    // Boxes with geometrically shrinking centers and sizes, which makes binned SAH split off a single
+    // box per level. Without the depth limit this produces a tree that's several hundred levels deep.
+    {
+        const uint64 numAABBs = 1500;
+        Array<Float3> aabbMins(numAABBs);
+        Array<Float3> aabbMaxs(numAABBs);
+        float x = 1.0f;
+        for(uint64 i = 0; i < numAABBs; ++i)
+        {
+            aabbMins[i] = Float3(x - x * 0.25f, 0.0f, 0.0f);
+            aabbMaxs[i] = Float3(x + x * 0.25f, 1.0f, 1.0f);
+            x *= 0.8f;
+        }
+
+        BVH bvh;
+        bvh.BuildFromAABBs(aabbMins.Data(), aabbMaxs.Data(), numAABBs);
+
+        const uint32 maxDepth = ComputeMaxDepth(bvh.Nodes());
+        WriteLog("Degenerate BVH: %llu nodes, max depth %u", bvh.NumNodes(), maxDepth);
+        if(maxDepth > MaxTreeDepth)
+        {
+            WriteLog("The degenerate BVH is deeper than the traversal stack allows");
+            passed = false;
+        }
+
+        List<uint32> results;
+        bvh.QueryAABB(Float3(-1.0f, -1.0f, -1.0f), Float3(2.0f, 2.0f, 2.0f), results);
+        if(results.Count() != numAABBs)
+        {
+            WriteLog("An AABB query over the degenerate BVH returned %llu of %llu boxes", results.Count(), numAABBs);
+            passed = false;
+        }
+
+        // A ray along the chain has to find the box with the smallest minimum
+        float closestMin = FloatMax;
+        for(uint64 i = 0; i < numAABBs; ++i)
+            closestMin = Min(closestMin, aabbMins[i].x);
+
+        BVHHit hit;
+        const Float3 origin = Float3(-1.0f, 0.5f, 0.5f);
+        if(bvh.IntersectRay(origin, Float3(1.0f, 0.0f, 0.0f), 10.0f, hit) == false || std::abs(hit.T - (closestMin - origin.x)) > 1e-6f ||
+           bvh.IntersectRayAny(origin, Float3(1.0f, 0.0f, 0.0f), 10.0f) == false)
+        {
+            WriteLog("A ray along the degenerate BVH didn't hit the closest box");
+            passed = false;
+        }
+    }
+
+    // Boxes that all share the same center, which SAH can't split at all
+    {
+        const uint64 numAABBs = 1000;
+        Array<Float3> aabbMins(numAABBs);
+        Array<Float3> aabbMaxs(numAABBs);
+        for(uint64 i = 0; i < numAABBs; ++i)
+        {
+            const float size = 1.0f + i * 0.01f;
+            aabbMins[i] = Float3(-size);
+            aabbMaxs[i] = Float3(size);
+        }
+
+        BVH bvh;
+        bvh.BuildFromAABBs(aabbMins.Data(), aabbMaxs.Data(), numAABBs);
+
+        uint32 maxLeafPrims = 0;
+        for(const BVHNode& node : bvh.Nodes())
+            maxLeafPrims = Max(maxLeafPrims, node.PrimCount);
+
+        List<uint32> results;
+        bvh.QueryAABB(Float3(-0.5f), Float3(0.5f), results);
+
+        WriteLog("Coincident BVH: %llu nodes, max depth %u, up to %u primitives per leaf", bvh.NumNodes(),
+                 ComputeMaxDepth(bvh.Nodes()), maxLeafPrims);
+        if(maxLeafPrims > MaxLeafPrims || results.Count() != numAABBs)
+        {
+            WriteLog("The coincident BVH has oversized leaves, or a query returned %llu of %llu boxes", results.Count(), numAABBs);
+            passed = false;
+        }
+
+        results.Shutdown();
+    }
+
+    // Random triangles against brute force
+    {
+        const uint64 numTriangles = 4000;
+        const float sceneSize = 20.0f;
+        Array<Float3> positions;
+        MakeTriangleSoup(numTriangles, sceneSize, 1.0f, 33, positions);
+
+        BVH bvh;
+        bvh.BuildFromTriangles(positions.Data(), numTriangles);
+
+        Random rng;
+        rng.SeedWithValue(33);
+
+        const uint64 numRays = 1000;
+        uint64 numHits = 0;
+        for(uint64 rayIdx = 0; rayIdx < numRays && passed; ++rayIdx)
+        {
+            const Float3 origin = (Float3(rng.RandomFloat(), rng.RandomFloat(), rng.RandomFloat()) - 0.5f) * sceneSize;
+            const Float3 direction = RandomDirection(rng);
+            const float tMax = 1.0f + rng.RandomFloat() * sceneSize;
+
+            float closestT = FloatMax;
+            for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+                closestT = Min(closestT, IntersectRayTriangleReference(origin, direction, tMax, &positions[triIdx * 3]));
+
+            const bool expectHit = closestT != FloatMax;
+            numHits += expectHit ? 1 : 0;
+
+            BVHHit hit;
+            const bool foundHit = bvh.IntersectRay(origin, direction, tMax, hit);
+            const bool foundAnyHit = bvh.IntersectRayAny(origin, direction, tMax);
+            if(foundHit != expectHit || foundAnyHit != expectHit || (expectHit && hit.T != closestT))
+            {
+                WriteLog("Ray %llu: the BVH gave a hit at %f, brute force gave %f", rayIdx, foundHit ? hit.T : -1.0f, expectHit ? closestT : -1.0f);
+                passed = false;
+                break;
+            }
+
+            if(expectHit && IntersectRayTriangleReference(origin, direction, tMax, &positions[hit.PrimIdx * 3]) != hit.T)
+            {
+                WriteLog("Ray %llu: the BVH returned the wrong primitive index", rayIdx);
+                passed = false;
+            }
+
+            // Boxes around the ray origin
+            const Float3 queryExtent = Float3(rng.RandomFloat(), rng.RandomFloat(), rng.RandomFloat()) * 2.0f;
+            const Float3 queryMin = origin - queryExtent;
+            const Float3 queryMax = origin + queryExtent;
+
+            List<uint32> results;
+            bvh.QueryAABB(queryMin, queryMax, results);
+            std::sort(results.begin(), results.end());
+
+            uint64 numExpected = 0;
+            for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+            {
+                const Float3* tri = &positions[triIdx * 3];
+                const Float3 triMin = Min(Min(tri[0], tri[1]), tri[2]);
+                const Float3 triMax = Max(Max(tri[0], tri[1]), tri[2]);
+                if(triMin.x > queryMax.x || triMax.x < queryMin.x || triMin.y > queryMax.y || triMax.y < queryMin.y ||
+                   triMin.z > queryMax.z || triMax.z < queryMin.z)
+                    continue;
+
+                if(numExpected >= results.Count() || results[numExpected] != triIdx)
+                {
+                    numExpected = uint64(-1);
+                    break;
+                }
+
+                ++numExpected;
+            }
+
+            if(numExpected != results.Count())
+            {
+                WriteLog("Ray %llu: the AABB query doesn't match brute force", rayIdx);
+                passed = false;
+            }
+        }
+
+        WriteLog("Random BVH: %llu nodes, max depth %u, %llu of %llu rays hit", bvh.NumNodes(), ComputeMaxDepth(bvh.Nodes()), numHits, numRays);
+        if(numHits == 0 || numHits == numRays)
+        {
+            WriteLog("The random rays should hit some of the triangles, but not all of them");
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+bool BenchmarkBVH(uint64 numTriangles, uint64 numRays)
+{
+    const float sceneSize = 100.0f;
+    Array<Float3> positions;
+    MakeTriangleSoup(numTriangles, sceneSize, 1.0f, 33, positions);
+
+    BVH bvh;
+    bvh.BuildFromTriangles(positions.Data(), numTriangles);
+
+    Random rng;
+    rng.SeedWithValue(33);
+
+    Array<Float3> origins(numRays);
+    Array<Float3> directions(numRays);
+    for(uint64 rayIdx = 0; rayIdx < numRays; ++rayIdx)
+    {
+        origins[rayIdx] = (Float3(rng.RandomFloat(), rng.RandomFloat(), rng.RandomFloat()) - 0.5f) * sceneSize;
+        directions[rayIdx] = RandomDirection(rng);
+    }
+
+    const float tMax = sceneSize * 0.25f;
+
+    Timer timer;
+
+    uint64 numHits = 0;
+    for(uint64 rayIdx = 0; rayIdx < numRays; ++rayIdx)
+    {
+        BVHHit hit;
+        numHits += bvh.IntersectRay(origins[rayIdx], directions[rayIdx], tMax, hit) ? 1 : 0;
+    }
+    timer.Update();
+    const double closestTime = timer.DeltaMillisecondsD();
+
+    uint64 numAnyHits = 0;
+    for(uint64 rayIdx = 0; rayIdx < numRays; ++rayIdx)
+        numAnyHits += bvh.IntersectRayAny(origins[rayIdx], directions[rayIdx], tMax) ? 1 : 0;
+    timer.Update();
+    const double anyTime = timer.DeltaMillisecondsD();
+
+    uint64 numQueryResults = 0;
+    List<uint32> results;
+    const Float3 queryExtent = Float3(1.0f, 1.0f, 1.0f);
+    for(uint64 rayIdx = 0; rayIdx < numRays; ++rayIdx)
+    {
+        results.RemoveAll();
+        bvh.QueryAABB(origins[rayIdx] - queryExtent, origins[rayIdx] + queryExtent, results);
+        numQueryResults += results.Count();
+    }
+    timer.Update();
+    const double queryTime = timer.DeltaMillisecondsD();
+
+    WriteLog("BVH: %llu triangles, %llu nodes, max depth %u, built in %.2fms", numTriangles, bvh.NumNodes(), ComputeMaxDepth(bvh.Nodes()), bvh.BuildTimeMS());
+    WriteLog("    Closest hit: %.2fms for %llu rays (%.2f Mrays/s), %llu hits", closestTime, numRays, numRays / (closestTime * 1000.0), numHits);
+    WriteLog("    Any hit: %.2fms for %llu rays (%.2f Mrays/s), %llu hits", anyTime, numRays, numRays / (anyTime * 1000.0), numAnyHits);
+    WriteLog("    AABB queries: %.2fms for %llu queries, %.1f results per query", queryTime, numRays, double(numQueryResults) / numRays);
+
+    return numHits == numAnyHits;
+}
+
+}
@@ -0,0 +1,116 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\SF12_Math.h"
+#include "..\\Containers.h"
+#include "..\\Serialization.h"
+
+namespace SampleFramework12
+{
+
+class Model;
+
+// Flattened BVH node. Children of an interior node are stored next to each other, so only
+// the index of the left child is needed.
+struct BVHNode
+{
+    Float3 AABBMin;
+    uint32 LeftFirst = 0;       // Left child index for interior nodes, first primitive for leaves
+    Float3 AABBMax;
+    uint32 PrimCount = 0;       // 0 for interior nodes
+
+    bool IsLeaf() const { return PrimCount > 0; }
+};
+
+StaticAssert_(sizeof(BVHNode) == 32);
+
+enum class BVHPrimitiveType : uint32
+{
+    Triangles = 0,
+    AABBs,
+
+    NumValues
+};
+
+struct BVHHit
+{
+    float T = FloatMax;
+    uint32 PrimIdx = uint32(-1);    // Original index of the primitive that was hit
+    Float2 Barycentrics;            // Only valid for triangles
+};
+
+// Bounding volume hierarchy for CPU-side queries, built with binned SAH
+class BVH
+{
+
+public:
+
+    // Builds over all of the triangles in a model, where the primitive index is the index of the
+    // triangle in the model's index buffer (index / 3)
+    void BuildFromModelTriangles(const Model& model);
+
+    // Builds over the AABB of each mesh in a model, where the primitive index is the mesh index
+    void BuildFromMeshAABBs(const Model& model);
+
+    void BuildFromTriangles(const Float3* positions, uint64 numTriangles);
+    void BuildFromAABBs(const Float3* aabbMins, const Float3* aabbMaxs, uint64 numAABBs);
+
+    void Shutdown();
+
+    // Returns the closest hit along the ray within [0, tMax)
+    bool IntersectRay(const Float3& origin, const Float3& direction, float tMax, BVHHit& hit) const;
+
+    // Returns true if anything is hit along the ray within [0, tMax)
+    bool IntersectRayAny(const Float3& origin, const Float3& direction, float tMax) const;
+
+    // Appends the indices of all primitives whose bounds overlap the AABB
+    void QueryAABB(const Float3& aabbMin, const Float3& aabbMax, List<uint32>& primIndices) const;
+
+    // Accessors
+    const Array<BVHNode>& Nodes() const { return nodes; }
+    uint64 NumNodes() const { return nodes.Size(); }
+    uint64 NumPrimitives() const { return primIndices.Size(); }
+    BVHPrimitiveType PrimitiveType() const { return primType; }
+    double BuildTimeMS() const { return buildTimeMS; }
+
+    template<typename TSerializer> void Serialize(TSerializer& serializer)
+    {
+        uint32 type = uint32(primType);
+        SerializeItem(serializer, type);
+        primType = BVHPrimitiveType(type);
+        BulkSerializeItem(serializer, nodes);
+        BulkSerializeItem(serializer, primIndices);
+        BulkSerializeItem(serializer, primData);
+    }
+
+protected:
+
+    void Build(const Float3* primMins, const Float3* primMaxs, uint64 numPrims);
+
+    bool IntersectPrimitive(uint64 primSlot, const Float3& origin, const Float3& direction, float tMax, BVHHit& hit) const;
+
+    Array<BVHNode> nodes;
+    Array<uint32> primIndices;
+    Array<Float3> primData;     // 3 positions per triangle or min/max per AABB, in leaf order
+    BVHPrimitiveType primType = BVHPrimitiveType::Triangles;
+    double buildTimeMS = 0.0;
+};
+
+// Compares ray and AABB queries against brute force for random triangles, and checks that a degenerate input
+// that makes SAH produce a very deep tree is limited to a depth that the traversal stacks can handle
+bool ValidateBVH();
+
+// Builds over a soup of random triangles and times the build along with closest-hit, any-hit and AABB queries
+bool BenchmarkBVH(uint64 numTriangles = 1000000, uint64 numRays = 250000);
+
+}
@@ -0,0 +1,905 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "BarrierTracker.h"
+#include "GraphicsTypes.h"
+#include "..\\Timer.h"
+#include "..\\Utility.h"
+
+namespace SampleFramework12
+{
+
+static const D3D12_BARRIER_ACCESS ReadOnlyAccessMask = D3D12_BARRIER_ACCESS_VERTEX_BUFFER |
+                                                       D3D12_BARRIER_ACCESS_CONSTANT_BUFFER |
+                                                       D3D12_BARRIER_ACCESS_INDEX_BUFFER |
+                                                       D3D12_BARRIER_ACCESS_DEPTH_STENCIL_READ |
+                                                       D3D12_BARRIER_ACCESS_SHADER_RESOURCE |
+                                                       D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT |
+                                                       D3D12_BARRIER_ACCESS_COPY_SOURCE |
+                                                       D3D12_BARRIER_ACCESS_RESOLVE_SOURCE |
+                                                       D3D12_BARRIER_ACCESS_RAYTRACING_ACCELERATION_STRUCTURE_READ |
+                                                       D3D12_BARRIER_ACCESS_SHADING_RATE_SOURCE |
+                                                       D3D12_BARRIER_ACCESS_PREDICATION;
+
+static bool IsReadOnlyAccess(D3D12_BARRIER_ACCESS access)
+{
+    if(access == D3D12_BARRIER_ACCESS_COMMON || access == D3D12_BARRIER_ACCESS_NO_ACCESS)
+        return false;
+
+    return (access & ~ReadOnlyAccessMask) == 0;
+}
+
+// Render target and depth writes are kept in order by the output merger, unlike UAV writes
+static bool IsOrderedWriteAccess(D3D12_BARRIER_ACCESS access)
+{
+    return access == D3D12_BARRIER_ACCESS_RENDER_TARGET || access == D3D12_BARRIER_ACCESS_DEPTH_STENCIL_WRITE;
+}
+
+// The combined sync bits also cover the individual stages that they're made up of
+static D3D12_BARRIER_SYNC ExpandSync(D3D12_BARRIER_SYNC sync)
+{
+    if((sync & D3D12_BARRIER_SYNC_ALL) != 0)
+        return ~D3D12_BARRIER_SYNC_SPLIT;
+
+    if((sync & D3D12_BARRIER_SYNC_DRAW) != 0)
+        sync |= D3D12_BARRIER_SYNC_INDEX_INPUT | D3D12_BARRIER_SYNC_VERTEX_SHADING | D3D12_BARRIER_SYNC_PIXEL_SHADING |
+                D3D12_BARRIER_SYNC_DEPTH_STENCIL | D3D12_BARRIER_SYNC_RENDER_TARGET;
+    if((sync & D3D12_BARRIER_SYNC_ALL_SHADING) != 0)
+        sync |= D3D12_BARRIER_SYNC_VERTEX_SHADING | D3D12_BARRIER_SYNC_PIXEL_SHADING | D3D12_BARRIER_SYNC_COMPUTE_SHADING |
+                D3D12_BARRIER_SYNC_NON_PIXEL_SHADING;
+    if((sync & D3D12_BARRIER_SYNC_NON_PIXEL_SHADING) != 0)
+        sync |= D3D12_BARRIER_SYNC_VERTEX_SHADING | D3D12_BARRIER_SYNC_COMPUTE_SHADING;
+
+    return sync;
+}
+
+// Reads that follow other reads in the same layout don't need to wait on each other, and neither
+// do render target or depth writes that follow the same kind of write
+static bool CanShareState(const ResourceState& current, const ResourceState& next)
+{
+    if(current.Layout != next.Layout)
+        return false;
+
+    if(IsReadOnlyAccess(current.Access) && IsReadOnlyAccess(next.Access))
+        return true;
+
+    return current.Access == next.Access && IsOrderedWriteAccess(current.Access);
+}
+
+// Whatever last wrote the resource was only made visible to the sync/access it was transitioned to, so a
+// read with a different sync or access still needs a barrier even though it doesn't wait on the other reads
+static bool CanSkipTransition(const ResourceState& current, const ResourceState& next)
+{
+    if(CanShareState(current, next) == false)
+        return false;
+
+    return (ExpandSync(next.Sync) & ~ExpandSync(current.Sync)) == 0 && (next.Access & ~current.Access) == 0;
+}
+
+// Accumulates all of the readers, so that the next write waits on every one of them
+static ResourceState CombineStates(const ResourceState& a, const ResourceState& b)
+{
+    Assert_(a.Layout == b.Layout);
+    return { a.Sync | b.Sync, a.Access | b.Access, a.Layout };
+}
+
+static ResourceState StateAfter(const D3D12_TEXTURE_BARRIER& barrier)
+{
+    return { barrier.SyncAfter, barrier.AccessAfter, barrier.LayoutAfter };
+}
+
+static ResourceState StateBefore(const D3D12_TEXTURE_BARRIER& barrier)
+{
+    return { barrier.SyncBefore, barrier.AccessBefore, barrier.LayoutBefore };
+}
+
+static bool SameRange(const D3D12_BARRIER_SUBRESOURCE_RANGE& a, const D3D12_BARRIER_SUBRESOURCE_RANGE& b)
+{
+    return a.IndexOrFirstMipLevel == b.IndexOrFirstMipLevel && a.NumMipLevels == b.NumMipLevels &&
+           a.FirstArraySlice == b.FirstArraySlice && a.NumArraySlices == b.NumArraySlices;
+}
+
+static bool RangesOverlap(const D3D12_BARRIER_SUBRESOURCE_RANGE& a, const D3D12_BARRIER_SUBRESOURCE_RANGE& b)
+{
+    const bool mipsOverlap = a.IndexOrFirstMipLevel < b.IndexOrFirstMipLevel + b.NumMipLevels &&
+                             b.IndexOrFirstMipLevel < a.IndexOrFirstMipLevel + a.NumMipLevels;
+    const bool slicesOverlap = a.FirstArraySlice < b.FirstArraySlice + b.NumArraySlices &&
+                               b.FirstArraySlice < a.FirstArraySlice + a.NumArraySlices;
+    return mipsOverlap && slicesOverlap;
+}
+
+void BarrierTracker::Shutdown()
+{
+    resources.clear();
+    bufferBarriers.Shutdown();
+    textureBarriers.Shutdown();
+    globalBarriers.Shutdown();
+    batchStarts.Shutdown();
+}
+
+// == Resource registration =======================================================================
+
+void BarrierTracker::TrackTexture(ID3D12Resource* resource, uint32 numMips, uint32 arraySize, const ResourceState& state)
+{
+    Assert_(resource != nullptr);
+    Assert_(numMips > 0 && arraySize > 0);
+
+    TrackedResource& tracked = resources[resource];
+    tracked.State = state;
+    tracked.SubresourceStates.Shutdown();
+    tracked.NumMips = numMips;
+    tracked.ArraySize = arraySize;
+    tracked.IsTexture = true;
+}
+
+void BarrierTracker::TrackTexture(const Texture& texture, const ResourceState& state)
+{
+    TrackTexture(texture.Resource, texture.NumMips, texture.ArraySize, state);
+}
+
+void BarrierTracker::TrackBuffer(ID3D12Resource* resource, const ResourceState& state)
+{
+    Assert_(resource != nullptr);
+    Assert_(state.Layout == D3D12_BARRIER_LAYOUT_UNDEFINED);
+
+    TrackedResource& tracked = resources[resource];
+    tracked.State = state;
+    tracked.SubresourceStates.Shutdown();
+    tracked.NumMips = 1;
+    tracked.ArraySize = 1;
+    tracked.IsTexture = false;
+}
+
+void BarrierTracker::Untrack(ID3D12Resource* resource)
+{
+    resources.erase(resource);
+}
+
+bool BarrierTracker::IsTracked(ID3D12Resource* resource) const
+{
+    return resources.find(resource) != resources.end();
+}
+
+BarrierTracker::TrackedResource& BarrierTracker::GetTrackedResource(ID3D12Resource* resource)
+{
+    auto iter = resources.find(resource);
+    Assert_(iter != resources.end());
+    return iter->second;
+}
+
+const BarrierTracker::TrackedResource& BarrierTracker::GetTrackedResource(ID3D12Resource* resource) const
+{
+    auto iter = resources.find(resource);
+    Assert_(iter != resources.end());
+    return iter->second;
+}
+
+ResourceState BarrierTracker::CurrentState(ID3D12Resource* resource, uint32 mipLevel, uint32 arraySlice) const
+{
+    const TrackedResource& tracked = GetTrackedResource(resource);
+    Assert_(mipLevel < tracked.NumMips);
+    Assert_(arraySlice < tracked.ArraySize);
+
+    if(tracked.SubresourceStates.Size() == 0)
+        return tracked.State;
+
+    return tracked.SubresourceStates[arraySlice * tracked.NumMips + mipLevel];
+}
+
+// == Transitions =================================================================================
+
+void BarrierTracker::TransitionTexture(ID3D12Resource* resource, const ResourceState& state, TextureSubresources subresources, bool discard)
+{
+    TrackedResource& tracked = GetTrackedResource(resource);
+    Assert_(tracked.IsTexture);
+    Assert_(subresources.StartMipLevel < tracked.NumMips);
+    Assert_(subresources.StartArraySlice < tracked.ArraySize);
+
+    stats.NumTransitions += 1;
+
+    const uint32 startMip = subresources.StartMipLevel;
+    const uint32 numMips = Min(subresources.NumMipLevels, tracked.NumMips - startMip);
+    const uint32 startSlice = subresources.StartArraySlice;
+    const uint32 numSlices = Min(subresources.NumArraySlices, tracked.ArraySize - startSlice);
+
+    D3D12_BARRIER_SUBRESOURCE_RANGE range =
+    {
+        .IndexOrFirstMipLevel = startMip,
+        .NumMipLevels = numMips,
+        .FirstArraySlice = startSlice,
+        .NumArraySlices = numSlices,
+        .FirstPlane = 0,
+        .NumPlanes = 1,
+    };
+
+    const bool wholeResource = numMips == tracked.NumMips && numSlices == tracked.ArraySize;
+    if(wholeResource && tracked.SubresourceStates.Size() == 0)
+    {
+        tracked.State = TransitionTextureRange(resource, tracked.State, state, range, discard);
+        return;
+    }
+
+    if(tracked.SubresourceStates.Size() == 0)
+        tracked.SubresourceStates.Init(uint64(tracked.NumMips) * tracked.ArraySize, tracked.State);
+
+    ResourceState* subStates = tracked.SubresourceStates.Data();
+    const ResourceState firstState = subStates[startSlice * tracked.NumMips + startMip];
+
+    bool uniformRange = true;
+    for(uint32 slice = startSlice; slice < startSlice + numSlices && uniformRange; ++slice)
+        for(uint32 mip = startMip; mip < startMip + numMips; ++mip)
+            uniformRange = uniformRange && subStates[slice * tracked.NumMips + mip] == firstState;
+
+    if(uniformRange)
+    {
+        // Everything in the range is coming from the same state, so a single barrier covers it
+        const ResourceState newState = TransitionTextureRange(resource, firstState, state, range, discard);
+        for(uint32 slice = startSlice; slice < startSlice + numSlices; ++slice)
+            for(uint32 mip = startMip; mip < startMip + numMips; ++mip)
+                subStates[slice * tracked.NumMips + mip] = newState;
+    }
+    else
+    {
+        // One barrier for each run of consecutive array slices that share a state, per mip level
+        for(uint32 mip = startMip; mip < startMip + numMips; ++mip)
+        {
+            uint32 runStart = startSlice;
+            while(runStart < startSlice + numSlices)
+            {
+                const ResourceState runState = subStates[runStart * tracked.NumMips + mip];
+                uint32 runEnd = runStart + 1;
+                while(runEnd < startSlice + numSlices && subStates[runEnd * tracked.NumMips + mip] == runState)
+                    runEnd += 1;
+
+                range.IndexOrFirstMipLevel = mip;
+                range.NumMipLevels = 1;
+                range.FirstArraySlice = runStart;
+                range.NumArraySlices = runEnd - runStart;
+                const ResourceState newState = TransitionTextureRange(resource, runState, state, range, discard);
+                for(uint32 slice = runStart; slice < runEnd; ++slice)
+                    subStates[slice * tracked.NumMips + mip] = newState;
+
+                runStart = runEnd;
+            }
+        }
+    }
+
+    // Go back to tracking a single state once all of the subresources agree again
+    const uint64 numSubresources = tracked.SubresourceStates.Size();
+    bool allEqual = true;
+    for(uint64 i = 1; i < numSubresources && allEqual; ++i)
+        allEqual = subStates[i] == subStates[0];
+
+    if(allEqual)
+    {
+        tracked.State = subStates[0];
+        tracked.SubresourceStates.Shutdown();
+    }
+}
+
+void BarrierTracker::TransitionTexture(const Texture& texture, const ResourceState& state, TextureSubresources subresources, bool discard)
+{
+    TransitionTexture(texture.Resource, state, subresources, discard);
+}
+
+ResourceState BarrierTracker::TransitionTextureRange(ID3D12Resource* resource, const ResourceState& current, const ResourceState& next,
+                                                     const D3D12_BARRIER_SUBRESOURCE_RANGE& range, bool discard)
+{
+    // Barriers within a single batch never overlap, which means that a pending barrier for the same
+    // resource either covers exactly the same subresources (and can absorb this transition), or it
+    // covers some of them and this barrier needs to go in a later batch
+    const PendingBatchStart batchStart = CurrentBatchStart();
+    bool overlapsPending = false;
+    for(uint64 i = batchStart.TextureBarrier; i < textureBarriers.Count(); ++i)
+    {
+        D3D12_TEXTURE_BARRIER& pending = textureBarriers[i];
+        if(pending.pResource != resource)
+            continue;
+
+        if(SameRange(pending.Subresources, range))
+        {
+            // Nothing has run in between, so the intermediate state never needs to exist
+            stats.NumMerged += 1;
+
+            const ResourceState pendingAfter = StateAfter(pending);
+            const ResourceState merged = (discard == false && CanShareState(pendingAfter, next)) ? CombineStates(pendingAfter, next) : next;
+            if(discard)
+            {
+                pending.AccessBefore = D3D12_BARRIER_ACCESS_NO_ACCESS;
+                pending.LayoutBefore = D3D12_BARRIER_LAYOUT_UNDEFINED;
+                pending.Flags = D3D12_TEXTURE_BARRIER_FLAG_DISCARD;
+            }
+
+            pending.SyncAfter = merged.Sync;
+            pending.AccessAfter = merged.Access;
+            pending.LayoutAfter = merged.Layout;
+
+            // A barrier that ends up going back to a state that's covered by where it started does nothing
+            const ResourceState pendingBefore = StateBefore(pending);
+            if(pending.Flags == D3D12_TEXTURE_BARRIER_FLAG_NONE && CanSkipTransition(pendingBefore, merged))
+            {
+                textureBarriers.Remove(i);
+                return CombineStates(pendingBefore, merged);
+            }
+
+            return merged;
+        }
+
+        overlapsPending = overlapsPending || RangesOverlap(pending.Subresources, range);
+    }
+
+    if(discard == false && CanSkipTransition(current, next))
+    {
+        stats.NumSkipped += 1;
+        return CombineStates(current, next);
+    }
+
+    // A new kind of read widens the set of readers instead of replacing it
+    const ResourceState after = (discard == false && CanShareState(current, next)) ? CombineStates(current, next) : next;
+
+    if(overlapsPending)
+        StartNewPendingBatch();
+
+    textureBarriers.Add(
+    {
+        .SyncBefore = current.Sync,
+        .SyncAfter = after.Sync,
+        .AccessBefore = discard ? D3D12_BARRIER_ACCESS_NO_ACCESS : current.Access,
+        .AccessAfter = after.Access,
+        .LayoutBefore = discard ? D3D12_BARRIER_LAYOUT_UNDEFINED : current.Layout,
+        .LayoutAfter = after.Layout,
+        .pResource = resource,
+        .Subresources = range,
+        .Flags = discard ? D3D12_TEXTURE_BARRIER_FLAG_DISCARD : D3D12_TEXTURE_BARRIER_FLAG_NONE,
+    });
+
+    return after;
+}
+
+void BarrierTracker::TransitionBuffer(ID3D12Resource* resource, const ResourceState& state)
+{
+    TrackedResource& tracked = GetTrackedResource(resource);
+    Assert_(tracked.IsTexture == false);
+    Assert_(state.Layout == D3D12_BARRIER_LAYOUT_UNDEFINED);
+
+    stats.NumTransitions += 1;
+
+    const PendingBatchStart batchStart = CurrentBatchStart();
+    for(uint64 i = batchStart.BufferBarrier; i < bufferBarriers.Count(); ++i)
+    {
+        D3D12_BUFFER_BARRIER& pending = bufferBarriers[i];
+        if(pending.pResource != resource)
+            continue;
+
+        stats.NumMerged += 1;
+
+        const ResourceState pendingBefore = { pending.SyncBefore, pending.AccessBefore, D3D12_BARRIER_LAYOUT_UNDEFINED };
+        const ResourceState pendingAfter = { pending.SyncAfter, pending.AccessAfter, D3D12_BARRIER_LAYOUT_UNDEFINED };
+        const ResourceState merged = CanShareState(pendingAfter, state) ? CombineStates(pendingAfter, state) : state;
+        pending.SyncAfter = merged.Sync;
+        pending.AccessAfter = merged.Access;
+
+        if(CanSkipTransition(pendingBefore, merged))
+        {
+            bufferBarriers.Remove(i);
+            tracked.State = CombineStates(pendingBefore, merged);
+        }
+        else
+        {
+            tracked.State = merged;
+        }
+
+        return;
+    }
+
+    if(CanSkipTransition(tracked.State, state))
+    {
+        stats.NumSkipped += 1;
+        tracked.State = CombineStates(tracked.State, state);
+        return;
+    }
+
+    const ResourceState after = CanShareState(tracked.State, state) ? CombineStates(tracked.State, state) : state;
+
+    bufferBarriers.Add(
+    {
+        .SyncBefore = tracked.State.Sync,
+        .SyncAfter = after.Sync,
+        .AccessBefore = tracked.State.Access,
+        .AccessAfter = after.Access,
+        .pResource = resource,
+        .Offset = 0,
+        .Size = UINT64_MAX,
+    });
+
+    tracked.State = after;
+}
+
+void BarrierTracker::AddGlobalBarrier(const D3D12_GLOBAL_BARRIER& barrier)
+{
+    globalBarriers.Add(barrier);
+}
+
+// == Pending barriers ============================================================================
+
+BarrierTracker::PendingBatchStart BarrierTracker::CurrentBatchStart() const
+{
+    return batchStarts.Count() > 0 ? batchStarts[batchStarts.Count() - 1] : PendingBatchStart();
+}
+
+void BarrierTracker::StartNewPendingBatch()
+{
+    const PendingBatchStart start = { bufferBarriers.Count(), textureBarriers.Count(), globalBarriers.Count() };
+    batchStarts.Add(start);
+}
+
+bool BarrierTracker::HasPendingBarriers() const
+{
+    return bufferBarriers.Count() + textureBarriers.Count() + globalBarriers.Count() > 0;
+}
+
+uint64 BarrierTracker::NumPendingBatches() const
+{
+    return HasPendingBarriers() ? batchStarts.Count() + 1 : 0;
+}
+
+BarrierBatch BarrierTracker::PendingBatch(uint64 batchIdx) const
+{
+    Assert_(batchIdx < NumPendingBatches());
+
+    const PendingBatchStart start = batchIdx > 0 ? batchStarts[batchIdx - 1] : PendingBatchStart();
+    PendingBatchStart end = { bufferBarriers.Count(), textureBarriers.Count(), globalBarriers.Count() };
+    if(batchIdx < batchStarts.Count())
+        end = batchStarts[batchIdx];
+
+    return
+    {
+        .BufferBarriers = bufferBarriers.Data() + start.BufferBarrier,
+        .NumBufferBarriers = uint32(end.BufferBarrier - start.BufferBarrier),
+        .TextureBarriers = textureBarriers.Data() + start.TextureBarrier,
+        .NumTextureBarriers = uint32(end.TextureBarrier - start.TextureBarrier),
+        .GlobalBarriers = globalBarriers.Data() + start.GlobalBarrier,
+        .NumGlobalBarriers = uint32(end.GlobalBarrier - start.GlobalBarrier),
+    };
+}
+
+void BarrierTracker::ClearPendingBarriers()
+{
+    bufferBarriers.RemoveAll();
+    textureBarriers.RemoveAll();
+    globalBarriers.RemoveAll();
+    batchStarts.RemoveAll();
+}
+
+void BarrierTracker::Flush(ID3D12GraphicsCommandList7* cmdList)
+{
+    if(HasPendingBarriers() == false)
+        return;
+
+    const uint64 numBatches = NumPendingBatches();
+    for(uint64 batchIdx = 0; batchIdx < numBatches; ++batchIdx)
+    {
+        const BarrierBatch batch = PendingBatch(batchIdx);
+        if(batch.NumBufferBarriers + batch.NumTextureBarriers + batch.NumGlobalBarriers == 0)
+            continue;
+
+        DX12::Barrier(cmdList, batch);
+        stats.NumEmitted += batch.NumBufferBarriers + batch.NumTextureBarriers + batch.NumGlobalBarriers;
+        stats.NumBarrierCalls += 1;
+    }
+
+    stats.NumFlushes += 1;
+    ClearPendingBarriers();
+}
+
+// == Main command list ===========================================================================
+
+namespace DX12
+{
+
+BarrierTracker CmdListBarriers;
+
+void FlushBarriers(ID3D12GraphicsCommandList* cmdList)
+{
+    if(cmdList == CmdList)
+        CmdListBarriers.Flush(CmdList);
+}
+
+}
+
+// == Validation ==================================================================================
+
+struct PendingBarrierCounts
+{
+    uint64 NumBatches = 0;
+    uint64 NumBufferBarriers = 0;
+    uint64 NumTextureBarriers = 0;
+};
+
+static PendingBarrierCounts CountPendingBarriers(const BarrierTracker& tracker)
+{
+    PendingBarrierCounts counts;
+    counts.NumBatches = tracker.NumPendingBatches();
+    for(uint64 batchIdx = 0; batchIdx < counts.NumBatches; ++batchIdx)
+    {
+        const BarrierBatch batch = tracker.PendingBatch(batchIdx);
+        counts.NumBufferBarriers += batch.NumBufferBarriers;
+        counts.NumTextureBarriers += batch.NumTextureBarriers;
+    }
+
+    return counts;
+}
+
+bool ValidateBarrierTracker()
+{
+    bool passed = true;
+
+    // Same as the benchmark, the resources are never dereferenced
+    auto FakeResource = [](uint64 idx) { return reinterpret_cast<ID3D12Resource*>(uintptr_t(idx * 256)); };
+
+    // Repeating a read (or a render target write) doesn't need a barrier. A different kind of read does, since
+    // the last write was only made visible to the earlier reads, and the next write has to wait on all of them.
+    {
+        ID3D12Resource* texture = FakeResource(1);
+        ID3D12Resource* buffer = FakeResource(2);
+
+        BarrierTracker tracker;
+        tracker.TrackTexture(texture, 1, 1, ResourceStates::ShaderResource);
+        tracker.TrackBuffer(buffer, ResourceStates::BufferShaderResource);
+
+        tracker.TransitionTexture(texture, ResourceStates::ShaderResource);
+        tracker.TransitionBuffer(buffer, ResourceStates::BufferShaderResource);
+        if(tracker.HasPendingBarriers() || tracker.Stats().NumSkipped != 2)
+        {
+            WriteLog("Repeated reads emitted a barrier");
+            passed = false;
+        }
+
+        tracker.TransitionBuffer(buffer, ResourceStates::IndirectArgument);
+        BarrierBatch batch = tracker.NumPendingBatches() == 1 ? tracker.PendingBatch(0) : BarrierBatch();
+        if(batch.NumBufferBarriers != 1 ||
+           batch.BufferBarriers[0].AccessBefore != D3D12_BARRIER_ACCESS_SHADER_RESOURCE ||
+           batch.BufferBarriers[0].SyncAfter != (D3D12_BARRIER_SYNC_ALL_SHADING | D3D12_BARRIER_SYNC_EXECUTE_INDIRECT) ||
+           batch.BufferBarriers[0].AccessAfter != (D3D12_BARRIER_ACCESS_SHADER_RESOURCE | D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT))
+        {
+            WriteLog("Reading a shader resource buffer as indirect arguments didn't emit a barrier that adds the new read");
+            passed = false;
+        }
+        tracker.ClearPendingBarriers();
+
+        tracker.TransitionBuffer(buffer, ResourceStates::IndirectArgument);
+        tracker.TransitionBuffer(buffer, ResourceStates::BufferShaderResource);
+        if(tracker.HasPendingBarriers())
+        {
+            WriteLog("Reads that were already covered by the buffer's state emitted a barrier");
+            passed = false;
+        }
+
+        tracker.TransitionBuffer(buffer, ResourceStates::BufferUnorderedAccess);
+        batch = tracker.NumPendingBatches() == 1 ? tracker.PendingBatch(0) : BarrierBatch();
+        if(batch.NumBufferBarriers != 1 ||
+           batch.BufferBarriers[0].SyncBefore != (D3D12_BARRIER_SYNC_ALL_SHADING | D3D12_BARRIER_SYNC_EXECUTE_INDIRECT) ||
+           batch.BufferBarriers[0].AccessBefore != (D3D12_BARRIER_ACCESS_SHADER_RESOURCE | D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT))
+        {
+            WriteLog("A write after two different reads didn't wait on both of them");
+            passed = false;
+        }
+        tracker.ClearPendingBarriers();
+
+        // A new read before the write's barrier gets flushed widens that barrier instead of adding another one
+        tracker.TransitionBuffer(buffer, ResourceStates::BufferShaderResource);
+        tracker.TransitionBuffer(buffer, ResourceStates::IndirectArgument);
+        batch = tracker.NumPendingBatches() == 1 ? tracker.PendingBatch(0) : BarrierBatch();
+        if(batch.NumBufferBarriers != 1 ||
+           batch.BufferBarriers[0].AccessBefore != D3D12_BARRIER_ACCESS_UNORDERED_ACCESS ||
+           batch.BufferBarriers[0].AccessAfter != (D3D12_BARRIER_ACCESS_SHADER_RESOURCE | D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT))
+        {
+            WriteLog("Two reads after a write didn't share the write's barrier");
+            passed = false;
+        }
+
+        tracker.ClearPendingBarriers();
+        tracker.TrackTexture(texture, 1, 1, ResourceStates::RenderTarget);
+        tracker.TransitionTexture(texture, ResourceStates::RenderTarget);
+        if(tracker.HasPendingBarriers())
+        {
+            WriteLog("A render target to render target transition emitted a barrier");
+            passed = false;
+        }
+
+        tracker.Shutdown();
+    }
+
+    // UAV writes aren't ordered, so going from UAV to UAV still needs a barrier. Asking again before
+    // the flush folds into the one that's already pending.
+    {
+        ID3D12Resource* buffer = FakeResource(3);
+
+        BarrierTracker tracker;
+        tracker.TrackBuffer(buffer, ResourceStates::BufferUnorderedAccess);
+        tracker.TransitionBuffer(buffer, ResourceStates::BufferUnorderedAccess);
+        tracker.TransitionBuffer(buffer, ResourceStates::BufferUnorderedAccess);
+
+        const PendingBarrierCounts counts = CountPendingBarriers(tracker);
+        if(counts.NumBufferBarriers != 1 || tracker.Stats().NumMerged != 1)
+        {
+            WriteLog("UAV to UAV produced %llu buffer barriers instead of 1", counts.NumBufferBarriers);
+            passed = false;
+        }
+
+        tracker.Shutdown();
+    }
+
+    // Transitions that get undone before the flush disappear, and ones that keep going collapse into a single barrier
+    {
+        ID3D12Resource* roundTrip = FakeResource(4);
+        ID3D12Resource* chained = FakeResource(5);
+
+        BarrierTracker tracker;
+        tracker.TrackTexture(roundTrip, 1, 1, ResourceStates::ShaderResource);
+        tracker.TrackTexture(chained, 1, 1, ResourceStates::ShaderResource);
+
+        tracker.TransitionTexture(roundTrip, ResourceStates::RenderTarget);
+        tracker.TransitionTexture(roundTrip, ResourceStates::ShaderResource);
+        tracker.TransitionTexture(chained, ResourceStates::RenderTarget);
+        tracker.TransitionTexture(chained, ResourceStates::UnorderedAccess);
+
+        const BarrierBatch batch = tracker.NumPendingBatches() == 1 ? tracker.PendingBatch(0) : BarrierBatch();
+        if(batch.NumTextureBarriers != 1 || batch.TextureBarriers[0].pResource != chained ||
+           batch.TextureBarriers[0].LayoutBefore != ResourceStates::ShaderResource.Layout ||
+           batch.TextureBarriers[0].LayoutAfter != ResourceStates::UnorderedAccess.Layout)
+        {
+            WriteLog("Back-to-back texture transitions weren't merged");
+            passed = false;
+        }
+
+        tracker.Shutdown();
+    }
+
+    // Discarding doesn't need the previous contents or layout
+    {
+        ID3D12Resource* texture = FakeResource(6);
+
+        BarrierTracker tracker;
+        tracker.TrackTexture(texture, 1, 1, ResourceStates::ShaderResource);
+        tracker.TransitionTexture(texture, ResourceStates::RenderTarget, TextureSubresources(), true);
+
+        const BarrierBatch batch = tracker.NumPendingBatches() == 1 ? tracker.PendingBatch(0) : BarrierBatch();
+        if(batch.NumTextureBarriers != 1 || batch.TextureBarriers[0].Flags != D3D12_TEXTURE_BARRIER_FLAG_DISCARD ||
+           batch.TextureBarriers[0].LayoutBefore != D3D12_BARRIER_LAYOUT_UNDEFINED ||
+           batch.TextureBarriers[0].AccessBefore != D3D12_BARRIER_ACCESS_NO_ACCESS)
+        {
+            WriteLog("A discarding transition didn't produce a discard barrier");
+            passed = false;
+        }
+
+        tracker.Shutdown();
+    }
+
+    // Per-subresource tracking, the same way that ShadowHelper converts one slice of an array at a time
+    {
+        const uint32 numSlices = 4;
+        ID3D12Resource* texture = FakeResource(7);
+
+        BarrierTracker tracker;
+        tracker.TrackTexture(texture, 1, numSlices, ResourceStates::ShaderResource);
+
+        // A barrier on one slice that depends on a pending barrier for the whole resource has to go in a later batch
+        tracker.TransitionTexture(texture, ResourceStates::RenderTarget);
+        tracker.TransitionTexture(texture, ResourceStates::ShaderResource, { .StartArraySlice = 1, .NumArraySlices = 1 });
+        if(tracker.NumPendingBatches() != 2 || tracker.CurrentState(texture, 0, 1) != ResourceStates::ShaderResource ||
+           tracker.CurrentState(texture, 0, 2) != ResourceStates::RenderTarget)
+        {
+            WriteLog("Overlapping subresource transitions weren't split into separate batches");
+            passed = false;
+        }
+        tracker.ClearPendingBarriers();
+
+        // Slices 0 and 2-3 are still render targets, so there's one barrier for each run of them
+        tracker.TransitionTexture(texture, ResourceStates::ShaderResource);
+        PendingBarrierCounts counts = CountPendingBarriers(tracker);
+        if(counts.NumBatches != 1 || counts.NumTextureBarriers != 2)
+        {
+            WriteLog("Transitioning mixed slices produced %llu barriers in %llu batches instead of 2 in 1", counts.NumTextureBarriers, counts.NumBatches);
+            passed = false;
+        }
+        tracker.ClearPendingBarriers();
+
+        // Once everything agrees again the whole resource goes back to a single barrier
+        tracker.TransitionTexture(texture, ResourceStates::UnorderedAccess);
+        const BarrierBatch batch = tracker.NumPendingBatches() == 1 ? tracker.PendingBatch(0) : BarrierBatch();
+        if(batch.NumTextureBarriers != 1 || batch.TextureBarriers[0].Subresources.FirstArraySlice != 0 ||
+           batch.TextureBarriers[0].Subresources.NumArraySlices != numSlices)
+        {
+            WriteLog("The subresources didn't go back to being tracked as a whole");
+            passed = false;
+        }
+
+        tracker.Shutdown();
+    }
+
+    WriteLog("Barrier tracker validation %s", passed ? "passed" : "failed");
+    return passed;
+}
+
+// == Benchmark ===================================================================================
+
+// Stands in for flushing before a draw or dispatch, without needing a command list
+static uint64 DrainPendingBarriers(BarrierTracker& tracker, uint64& numBarrierCalls)
+{
+    uint64 numBarriers = 0;
+    const uint64 numBatches = tracker.NumPendingBatches();
+    for(uint64 batchIdx = 0; batchIdx < numBatches; ++batchIdx)
+    {
+        const BarrierBatch batch = tracker.PendingBatch(batchIdx);
+        const uint64 batchSize = batch.NumBufferBarriers + batch.NumTextureBarriers + batch.NumGlobalBarriers;
+        numBarriers += batchSize;
+        numBarrierCalls += batchSize > 0 ? 1 : 0;
+    }
+
+    tracker.ClearPendingBarriers();
+    return numBarriers;
+}
+
+void BenchmarkBarrierTracker(uint64 numFrames)
+{
+    // The tracker never dereferences the resources, so fake pointers are fine
+    uint64 nextFakeResource = 1;
+    auto FakeResource = [&]() { return reinterpret_cast<ID3D12Resource*>(uintptr_t(nextFakeResource++ * 256)); };
+
+    static const uint32 NumGBufferTargets = 4;
+    static const uint32 NumCascades = 4;
+    static const uint32 NumBloomMips = 6;
+
+    ID3D12Resource* depthBuffer = FakeResource();
+    ID3D12Resource* gBuffer[NumGBufferTargets] = { };
+    for(uint32 i = 0; i < NumGBufferTargets; ++i)
+        gBuffer[i] = FakeResource();
+    ID3D12Resource* cascadeDepth = FakeResource();
+    ID3D12Resource* shadowMap = FakeResource();
+    ID3D12Resource* shadowTemp = FakeResource();
+    ID3D12Resource* lightingTarget = FakeResource();
+    ID3D12Resource* bloomChain = FakeResource();
+    ID3D12Resource* backBuffer = FakeResource();
+    ID3D12Resource* lightBuffer = FakeResource();
+    ID3D12Resource* tileLightLists = FakeResource();
+    ID3D12Resource* indirectArgs = FakeResource();
+
+    BarrierTracker tracker;
+    tracker.TrackTexture(depthBuffer, 1, 1, ResourceStates::DepthRead);
+    for(uint32 i = 0; i < NumGBufferTargets; ++i)
+        tracker.TrackTexture(gBuffer[i], 1, 1, ResourceStates::ShaderResource);
+    tracker.TrackTexture(cascadeDepth, 1, 1, ResourceStates::DepthRead);
+    tracker.TrackTexture(shadowMap, 1, NumCascades, ResourceStates::ShaderResource);
+    tracker.TrackTexture(shadowTemp, 1, 1, ResourceStates::ShaderResource);
+    tracker.TrackTexture(lightingTarget, 1, 1, ResourceStates::ShaderResource);
+    tracker.TrackTexture(bloomChain, NumBloomMips, 1, ResourceStates::ShaderResource);
+    tracker.TrackTexture(backBuffer, 1, 1, ResourceStates::Present);
+    tracker.TrackBuffer(lightBuffer, ResourceStates::BufferShaderResource);
+    tracker.TrackBuffer(tileLightLists, ResourceStates::BufferShaderResource);
+    tracker.TrackBuffer(indirectArgs, ResourceStates::IndirectArgument);
+
+    uint64 numRequested = 0;
+    uint64 numEmitted = 0;
+    uint64 numBarrierCalls = 0;
+    uint64 numDrawsAndDispatches = 0;
+
+    auto TransitionTex = [&](ID3D12Resource* resource, const ResourceState& state, TextureSubresources subresources = TextureSubresources(), bool discard = false)
+    {
+        tracker.TransitionTexture(resource, state, subresources, discard);
+        numRequested += 1;
+    };
+
+    auto TransitionBuf = [&](ID3D12Resource* resource, const ResourceState& state)
+    {
+        tracker.TransitionBuffer(resource, state);
+        numRequested += 1;
+    };
+
+    auto Work = [&]()
+    {
+        numEmitted += DrainPendingBarriers(tracker, numBarrierCalls);
+        numDrawsAndDispatches += 1;
+    };
+
+    Timer timer;
+
+    for(uint64 frameIdx = 0; frameIdx < numFrames; ++frameIdx)
+    {
+        // Light culling writes the tile lists and the indirect args, then a second pass reads them back
+        TransitionBuf(lightBuffer, ResourceStates::BufferShaderResource);
+        TransitionBuf(tileLightLists, ResourceStates::BufferUnorderedAccess);
+        TransitionBuf(indirectArgs, ResourceStates::BufferUnorderedAccess);
+        Work();
+        TransitionBuf(tileLightLists, ResourceStates::BufferShaderResource);
+        TransitionBuf(indirectArgs, ResourceStates::IndirectArgument);
+        Work();
+
+        // G-Buffer
+        TransitionTex(depthBuffer, ResourceStates::DepthWrite, TextureSubresources(), true);
+        for(uint32 i = 0; i < NumGBufferTargets; ++i)
+            TransitionTex(gBuffer[i], ResourceStates::RenderTarget, TextureSubresources(), true);
+        Work();
+
+        // Each pass puts its outputs back into a readable state when it's done, and the decal pass
+        // immediately moves some of them back to being render targets
+        for(uint32 i = 0; i < NumGBufferTargets; ++i)
+            TransitionTex(gBuffer[i], ResourceStates::ShaderResource);
+        TransitionTex(depthBuffer, ResourceStates::DepthRead);
+
+        TransitionTex(gBuffer[0], ResourceStates::RenderTarget);
+        TransitionTex(gBuffer[1], ResourceStates::RenderTarget);
+        TransitionTex(depthBuffer, ResourceStates::DepthRead);
+        Work();
+        TransitionTex(gBuffer[0], ResourceStates::ShaderResource);
+        TransitionTex(gBuffer[1], ResourceStates::ShaderResource);
+
+        // Shadow cascades, with the same per-slice conversion and filtering that ShadowHelper does
+        for(uint32 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+        {
+            const TextureSubresources slice = { .StartArraySlice = cascadeIdx, .NumArraySlices = 1 };
+
+            TransitionTex(cascadeDepth, ResourceStates::DepthWrite, TextureSubresources(), true);
+            Work();
+            TransitionTex(cascadeDepth, ResourceStates::ShaderResource);
+            TransitionTex(shadowMap, ResourceStates::RenderTarget, slice, true);
+            Work();
+            TransitionTex(shadowMap, ResourceStates::ShaderResource, slice);
+            TransitionTex(shadowTemp, ResourceStates::RenderTarget, TextureSubresources(), true);
+            Work();
+            TransitionTex(shadowTemp, ResourceStates::ShaderResource);
+            TransitionTex(shadowMap, ResourceStates::RenderTarget, slice, true);
+            Work();
+            TransitionTex(shadowMap, ResourceStates::ShaderResource, slice);
+        }
+
+        // Deferred lighting, where every input gets transitioned by the pass whether or not it needs to be
+        for(uint32 i = 0; i < NumGBufferTargets; ++i)
+            TransitionTex(gBuffer[i], ResourceStates::ShaderResource);
+        TransitionTex(depthBuffer, ResourceStates::DepthRead);
+        TransitionTex(shadowMap, ResourceStates::ShaderResource);
+        TransitionBuf(lightBuffer, ResourceStates::BufferShaderResource);
+        TransitionBuf(tileLightLists, ResourceStates::BufferShaderResource);
+        TransitionTex(lightingTarget, ResourceStates::UnorderedAccess);
+        Work();
+
+        // Bloom downsample chain, one mip at a time
+        TransitionTex(lightingTarget, ResourceStates::ShaderResource);
+        for(uint32 mip = 0; mip < NumBloomMips; ++mip)
+        {
+            if(mip > 0)
+                TransitionTex(bloomChain, ResourceStates::ShaderResource, { .StartMipLevel = mip - 1, .NumMipLevels = 1 });
+            TransitionTex(bloomChain, ResourceStates::UnorderedAccess, { .StartMipLevel = mip, .NumMipLevels = 1 });
+            Work();
+        }
+        TransitionTex(bloomChain, ResourceStates::ShaderResource);
+
+        // Tone mapping into the back buffer
+        TransitionTex(lightingTarget, ResourceStates::ShaderResource);
+        TransitionTex(backBuffer, ResourceStates::RenderTarget);
+        Work();
+        TransitionTex(backBuffer, ResourceStates::Present);
+        Work();
+    }
+
+    timer.Update();
+
+    const double framesD = double(numFrames);
+    WriteLog("Barrier tracker benchmark (%llu frames, %llu draws/dispatches per frame)", numFrames, numDrawsAndDispatches / Max<uint64>(numFrames, 1));
+    WriteLog("    Requested transitions (what issuing every transition directly would emit): %.1f per frame", numRequested / framesD);
+    WriteLog("    Emitted barriers: %.1f per frame in %.1f Barrier() calls", numEmitted / framesD, numBarrierCalls / framesD);
+    WriteLog("    Skipped: %.1f per frame, merged: %.1f per frame", tracker.Stats().NumSkipped / framesD, tracker.Stats().NumMerged / framesD);
+    WriteLog("    CPU time: %.3f us per frame", timer.ElapsedMicrosecondsD() / framesD);
+
+    tracker.Shutdown();
+}
+
+}
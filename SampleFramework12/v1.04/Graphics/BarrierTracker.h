@@ -0,0 +1,184 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\Containers.h"
+#include "DX12_Helpers.h"
+
+namespace SampleFramework12
+{
+
+struct Texture;
+
+// The sync/access/layout that a resource is in (or is about to be used in). Buffers always use
+// D3D12_BARRIER_LAYOUT_UNDEFINED.
+struct ResourceState
+{
+    D3D12_BARRIER_SYNC Sync = D3D12_BARRIER_SYNC_NONE;
+    D3D12_BARRIER_ACCESS Access = D3D12_BARRIER_ACCESS_NO_ACCESS;
+    D3D12_BARRIER_LAYOUT Layout = D3D12_BARRIER_LAYOUT_UNDEFINED;
+};
+
+inline bool operator==(const ResourceState& a, const ResourceState& b)
+{
+    return a.Sync == b.Sync && a.Access == b.Access && a.Layout == b.Layout;
+}
+
+inline bool operator!=(const ResourceState& a, const ResourceState& b)
+{
+    return !(a == b);
+}
+
+// Common states, matching the ones used by the barrier helpers in GraphicsTypes.h
+namespace ResourceStates
+{
+    const ResourceState ShaderResource = { D3D12_BARRIER_SYNC_ALL_SHADING, D3D12_BARRIER_ACCESS_SHADER_RESOURCE, D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE };
+    const ResourceState RenderTarget = { D3D12_BARRIER_SYNC_RENDER_TARGET, D3D12_BARRIER_ACCESS_RENDER_TARGET, D3D12_BARRIER_LAYOUT_RENDER_TARGET };
+    const ResourceState UnorderedAccess = { D3D12_BARRIER_SYNC_ALL_SHADING, D3D12_BARRIER_ACCESS_UNORDERED_ACCESS, D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_UNORDERED_ACCESS };
+    const ResourceState DepthWrite = { D3D12_BARRIER_SYNC_DEPTH_STENCIL, D3D12_BARRIER_ACCESS_DEPTH_STENCIL_WRITE, D3D12_BARRIER_LAYOUT_DEPTH_STENCIL_WRITE };
+    const ResourceState DepthRead = { D3D12_BARRIER_SYNC_ALL_SHADING | D3D12_BARRIER_SYNC_DEPTH_STENCIL,
+                                      D3D12_BARRIER_ACCESS_SHADER_RESOURCE | D3D12_BARRIER_ACCESS_DEPTH_STENCIL_READ,
+                                      D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_GENERIC_READ };
+    const ResourceState CopySource = { D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_SOURCE, D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_COPY_SOURCE };
+    const ResourceState CopyDest = { D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_DEST, D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_COPY_DEST };
+    const ResourceState Present = { D3D12_BARRIER_SYNC_NONE, D3D12_BARRIER_ACCESS_NO_ACCESS, D3D12_BARRIER_LAYOUT_PRESENT };
+
+    const ResourceState BufferShaderResource = { D3D12_BARRIER_SYNC_ALL_SHADING, D3D12_BARRIER_ACCESS_SHADER_RESOURCE, D3D12_BARRIER_LAYOUT_UNDEFINED };
+    const ResourceState BufferUnorderedAccess = { D3D12_BARRIER_SYNC_ALL_SHADING, D3D12_BARRIER_ACCESS_UNORDERED_ACCESS, D3D12_BARRIER_LAYOUT_UNDEFINED };
+    const ResourceState BufferCopySource = { D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_SOURCE, D3D12_BARRIER_LAYOUT_UNDEFINED };
+    const ResourceState BufferCopyDest = { D3D12_BARRIER_SYNC_COPY, D3D12_BARRIER_ACCESS_COPY_DEST, D3D12_BARRIER_LAYOUT_UNDEFINED };
+    const ResourceState IndirectArgument = { D3D12_BARRIER_SYNC_EXECUTE_INDIRECT, D3D12_BARRIER_ACCESS_INDIRECT_ARGUMENT, D3D12_BARRIER_LAYOUT_UNDEFINED };
+}
+
+struct TextureSubresources
+{
+    uint32 StartMipLevel = 0;
+    uint32 NumMipLevels = uint32(-1);
+    uint32 StartArraySlice = 0;
+    uint32 NumArraySlices = uint32(-1);
+};
+
+struct BarrierTrackerStats
+{
+    uint64 NumTransitions = 0;      // Calls to TransitionTexture()/TransitionBuffer()
+    uint64 NumSkipped = 0;          // Transitions that didn't need a barrier at all
+    uint64 NumMerged = 0;           // Transitions that were folded into a barrier that was still pending
+    uint64 NumEmitted = 0;          // Barriers that were handed to the command list
+    uint64 NumFlushes = 0;          // Flushes that emitted at least one barrier
+    uint64 NumBarrierCalls = 0;     // Calls to ID3D12GraphicsCommandList7::Barrier()
+};
+
+// Tracks the last sync/access/layout of every registered resource for a command list, and turns
+// requests for a resource to be in a new state into enhanced barriers. Transitions that don't need
+// a barrier (a read that the current reads already cover, or render target -> render target in the
+// same layout) are skipped, and barriers are held back until Flush() so that back-to-back
+// transitions of the same resource collapse into a single barrier. Call Flush() right before each
+// draw, dispatch, copy, or clear that depends on the transitions.
+//
+// This only does CPU-side bookkeeping until Flush(), which makes it usable without a device.
+class BarrierTracker
+{
+
+public:
+
+    void Shutdown();
+
+    // Registers a resource along with the state it's currently in. Textures can be tracked per-subresource.
+    void TrackTexture(ID3D12Resource* resource, uint32 numMips, uint32 arraySize, const ResourceState& state);
+    void TrackTexture(const Texture& texture, const ResourceState& state);
+    void TrackBuffer(ID3D12Resource* resource, const ResourceState& state);
+    void Untrack(ID3D12Resource* resource);
+    bool IsTracked(ID3D12Resource* resource) const;
+
+    // Requests that a resource (or a range of its subresources) is in the given state for the next piece of GPU work.
+    // Discarding throws away the current contents, and requires the resource to be a render target or depth buffer.
+    void TransitionTexture(ID3D12Resource* resource, const ResourceState& state, TextureSubresources subresources = TextureSubresources(), bool discard = false);
+    void TransitionTexture(const Texture& texture, const ResourceState& state, TextureSubresources subresources = TextureSubresources(), bool discard = false);
+    void TransitionBuffer(ID3D12Resource* resource, const ResourceState& state);
+
+    // Global barriers aren't tracked, they're just batched along with everything else
+    void AddGlobalBarrier(const D3D12_GLOBAL_BARRIER& barrier);
+
+    // Returns the state that the resource will be in once the pending barriers are flushed
+    ResourceState CurrentState(ID3D12Resource* resource, uint32 mipLevel = 0, uint32 arraySlice = 0) const;
+
+    // Pending barriers are split into batches only when a barrier needs to wait for an earlier one
+    // on an overlapping set of subresources, otherwise there's only ever one batch
+    bool HasPendingBarriers() const;
+    uint64 NumPendingBatches() const;
+    BarrierBatch PendingBatch(uint64 batchIdx) const;
+    void ClearPendingBarriers();
+
+    // Issues all pending barriers on the command list
+    void Flush(ID3D12GraphicsCommandList7* cmdList);
+
+    const BarrierTrackerStats& Stats() const { return stats; }
+    void ResetStats() { stats = BarrierTrackerStats(); }
+
+protected:
+
+    struct TrackedResource
+    {
+        ResourceState State;                        // Used while every subresource is in the same state
+        Array<ResourceState> SubresourceStates;     // Indexed by arraySlice * NumMips + mipLevel, empty while uniform
+        uint32 NumMips = 1;
+        uint32 ArraySize = 1;
+        bool IsTexture = false;
+    };
+
+    struct PendingBatchStart
+    {
+        uint64 BufferBarrier = 0;
+        uint64 TextureBarrier = 0;
+        uint64 GlobalBarrier = 0;
+    };
+
+    TrackedResource& GetTrackedResource(ID3D12Resource* resource);
+    const TrackedResource& GetTrackedResource(ID3D12Resource* resource) const;
+
+    ResourceState TransitionTextureRange(ID3D12Resource* resource, const ResourceState& current, const ResourceState& next,
+                                         const D3D12_BARRIER_SUBRESOURCE_RANGE& range, bool discard);
+    PendingBatchStart CurrentBatchStart() const;
+    void StartNewPendingBatch();
+
+    std::unordered_map<ID3D12Resource*, TrackedResource> resources;
+
+    List<D3D12_BUFFER_BARRIER> bufferBarriers;
+    List<D3D12_TEXTURE_BARRIER> textureBarriers;
+    List<D3D12_GLOBAL_BARRIER> globalBarriers;
+    List<PendingBatchStart> batchStarts;
+
+    BarrierTrackerStats stats;
+};
+
+namespace DX12
+{
+
+// Tracks resources whose state changes on the main command list (DX12::CmdList). Whatever is still
+// pending gets flushed by DX12::EndFrame() before the command list is closed.
+extern BarrierTracker CmdListBarriers;
+
+// Flushes CmdListBarriers if the command list is the main one, call before any draw, dispatch,
+// copy or clear. Other command lists are left alone.
+void FlushBarriers(ID3D12GraphicsCommandList* cmdList);
+
+}
+
+// Checks the barriers that the tracker emits for a set of scripted transitions, without a device
+bool ValidateBarrierTracker();
+
+// Replays a synthetic frame (G-Buffer, shadow cascades with per-slice filtering, a compute lighting pass,
+// and a post-processing chain) through a BarrierTracker, and logs how many barriers the naive per-pass
+// transitions would issue compared to what the tracker actually emits
+void BenchmarkBarrierTracker(uint64 numFrames = 1000);
+
+}
@@ -0,0 +1,433 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "Culling.h"
+#include "Camera.h"
+#include "Model.h"
+#include "ShadowHelper.h"
+#include "..\\Tasks.h"
+#include "..\\Utility.h"
+#include "..\\Timer.h"
+
+using namespace DirectX;
+
+namespace SampleFramework12
+{
+
+static const uint32 CullingGroupSize = 4;
+
+static Float4 NormalizePlane(const Float4& plane)
+{
+    const float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    if(length <= 0.0f)
+        return plane;
+
+    return Float4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+}
+
+Frustum ComputeFrustum(const Float4x4& m)
+{
+    // Gribb/Hartmann plane extraction, using the columns since we transform row vectors
+    const Float4 col0 = Float4(m._11, m._21, m._31, m._41);
+    const Float4 col1 = Float4(m._12, m._22, m._32, m._42);
+    const Float4 col2 = Float4(m._13, m._23, m._33, m._43);
+    const Float4 col3 = Float4(m._14, m._24, m._34, m._44);
+
+    Frustum frustum;
+    frustum.Planes[0] = NormalizePlane(col3 + col0);    // Left
+    frustum.Planes[1] = NormalizePlane(col3 - col0);    // Right
+    frustum.Planes[2] = NormalizePlane(col3 + col1);    // Bottom
+    frustum.Planes[3] = NormalizePlane(col3 - col1);    // Top
+    frustum.Planes[4] = NormalizePlane(col2);           // Near
+    frustum.Planes[5] = NormalizePlane(col3 - col2);    // Far
+
+    return frustum;
+}
+
+Frustum ComputeFrustum(const Camera& camera)
+{
+    return ComputeFrustum(camera.ViewProjectionMatrix());
+}
+
+Frustum ComputeShadowCasterFrustum(const Camera& shadowCamera)
+{
+    Frustum frustum = ComputeFrustum(shadowCamera.ViewProjectionMatrix());
+    frustum.Planes[4] = Float4(0.0f, 0.0f, 0.0f, 1.0f);
+    return frustum;
+}
+
+// == CullingBounds ===============================================================================
+
+void CullingBounds::Init(uint64 numBounds)
+{
+    NumBounds = numBounds;
+
+    // The padding gets tested along with everything else, but is skipped when compacting the results
+    const uint64 paddedSize = AlignTo(numBounds, uint64(CullingGroupSize));
+    CenterX.Init(paddedSize, 0.0f);
+    CenterY.Init(paddedSize, 0.0f);
+    CenterZ.Init(paddedSize, 0.0f);
+    ExtentX.Init(paddedSize, 0.0f);
+    ExtentY.Init(paddedSize, 0.0f);
+    ExtentZ.Init(paddedSize, 0.0f);
+}
+
+void CullingBounds::Init(const Model& model)
+{
+    const Array<Mesh>& meshes = model.Meshes();
+    Init(meshes.Size());
+    for(uint64 i = 0; i < meshes.Size(); ++i)
+        SetAABB(i, meshes[i].AABBMin(), meshes[i].AABBMax());
+}
+
+void CullingBounds::Shutdown()
+{
+    CenterX.Shutdown();
+    CenterY.Shutdown();
+    CenterZ.Shutdown();
+    ExtentX.Shutdown();
+    ExtentY.Shutdown();
+    ExtentZ.Shutdown();
+    NumBounds = 0;
+}
+
+void CullingBounds::SetAABB(uint64 idx, const Float3& aabbMin, const Float3& aabbMax)
+{
+    Assert_(idx < NumBounds);
+
+    const Float3 center = (aabbMin + aabbMax) * 0.5f;
+    const Float3 extent = (aabbMax - aabbMin) * 0.5f;
+    CenterX[idx] = center.x;
+    CenterY[idx] = center.y;
+    CenterZ[idx] = center.z;
+    ExtentX[idx] = extent.x;
+    ExtentY[idx] = extent.y;
+    ExtentZ[idx] = extent.z;
+}
+
+// == Culling =====================================================================================
+
+struct CullTaskArgs
+{
+    const CullingBounds* Bounds = nullptr;
+    const Frustum* Frusta = nullptr;
+    uint64 NumViews = 0;
+    CullingResults* Results = nullptr;
+};
+
+// Tests groups of 4 AABBs against every plane of every view, and writes out a bit mask per AABB
+static void CullTask(uint32 start, uint32 end, uint32 threadNum, void* args_)
+{
+    const CullTaskArgs* args = reinterpret_cast<const CullTaskArgs*>(args_);
+    const CullingBounds& bounds = *args->Bounds;
+    uint8* masks = args->Results->VisibilityMasks.Data();
+
+    for(uint32 groupIdx = start; groupIdx < end; ++groupIdx)
+    {
+        const uint64 baseIdx = uint64(groupIdx) * CullingGroupSize;
+        const XMVECTOR cx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.CenterX[baseIdx]));
+        const XMVECTOR cy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.CenterY[baseIdx]));
+        const XMVECTOR cz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.CenterZ[baseIdx]));
+        const XMVECTOR ex = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.ExtentX[baseIdx]));
+        const XMVECTOR ey = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.ExtentY[baseIdx]));
+        const XMVECTOR ez = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&bounds.ExtentZ[baseIdx]));
+
+        uint32 groupMasks[CullingGroupSize] = { };
+        for(uint64 viewIdx = 0; viewIdx < args->NumViews; ++viewIdx)
+        {
+            const Frustum& frustum = args->Frusta[viewIdx];
+
+            // An AABB is outside if it's fully behind any plane, which we test using the vertex
+            // that's furthest along the plane normal: dot(c, n) + dot(e, abs(n)) + d < 0
+            XMVECTOR outside = XMVectorFalseInt();
+            for(uint64 planeIdx = 0; planeIdx < 6; ++planeIdx)
+            {
+                const Float4& plane = frustum.Planes[planeIdx];
+
+                XMVECTOR dist = XMVectorReplicate(plane.w);
+                dist = XMVectorMultiplyAdd(cx, XMVectorReplicate(plane.x), dist);
+                dist = XMVectorMultiplyAdd(cy, XMVectorReplicate(plane.y), dist);
+                dist = XMVectorMultiplyAdd(cz, XMVectorReplicate(plane.z), dist);
+                dist = XMVectorMultiplyAdd(ex, XMVectorReplicate(std::abs(plane.x)), dist);
+                dist = XMVectorMultiplyAdd(ey, XMVectorReplicate(std::abs(plane.y)), dist);
+                dist = XMVectorMultiplyAdd(ez, XMVectorReplicate(std::abs(plane.z)), dist);
+
+                outside = XMVectorOrInt(outside, XMVectorLess(dist, XMVectorZero()));
+            }
+
+            XMUINT4 outsideMask;
+            XMStoreUInt4(&outsideMask, outside);
+            groupMasks[0] |= outsideMask.x ? 0 : (1 << viewIdx);
+            groupMasks[1] |= outsideMask.y ? 0 : (1 << viewIdx);
+            groupMasks[2] |= outsideMask.z ? 0 : (1 << viewIdx);
+            groupMasks[3] |= outsideMask.w ? 0 : (1 << viewIdx);
+        }
+
+        for(uint64 i = 0; i < CullingGroupSize; ++i)
+            masks[baseIdx + i] = uint8(groupMasks[i]);
+    }
+}
+
+// Compacts the visibility masks into a list of visible indices for a single view
+static void CompactTask(uint32 start, uint32 end, uint32 threadNum, void* args_)
+{
+    const CullTaskArgs* args = reinterpret_cast<const CullTaskArgs*>(args_);
+    CullingResults& results = *args->Results;
+    const uint64 numBounds = args->Bounds->NumBounds;
+    const uint8* masks = results.VisibilityMasks.Data();
+
+    for(uint32 viewIdx = start; viewIdx < end; ++viewIdx)
+    {
+        const uint8 viewBit = uint8(1 << viewIdx);
+        uint32* visibleIndices = results.VisibleIndices[viewIdx].Data();
+
+        uint64 numVisible = 0;
+        for(uint64 i = 0; i < numBounds; ++i)
+        {
+            visibleIndices[numVisible] = uint32(i);
+            numVisible += (masks[i] & viewBit) ? 1 : 0;
+        }
+
+        results.NumVisible[viewIdx] = numVisible;
+    }
+}
+
+void CullBounds(const CullingBounds& bounds, const Frustum* frusta, uint64 numViews, CullingResults& results)
+{
+    Assert_(numViews <= MaxCullingViews);
+    Assert_(frusta != nullptr || numViews == 0);
+
+    const uint64 numGroups = AlignTo(bounds.NumBounds, uint64(CullingGroupSize)) / CullingGroupSize;
+    if(results.VisibilityMasks.Size() != numGroups * CullingGroupSize)
+        results.VisibilityMasks.Init(numGroups * CullingGroupSize);
+
+    results.NumViews = numViews;
+    for(uint64 viewIdx = 0; viewIdx < MaxCullingViews; ++viewIdx)
+    {
+        results.NumVisible[viewIdx] = 0;
+        if(viewIdx < numViews && results.VisibleIndices[viewIdx].Size() < bounds.NumBounds)
+            results.VisibleIndices[viewIdx].Init(bounds.NumBounds);
+    }
+
+    if(bounds.NumBounds == 0 || numViews == 0)
+        return;
+
+    CullTaskArgs args;
+    args.Bounds = &bounds;
+    args.Frusta = frusta;
+    args.NumViews = numViews;
+    args.Results = &results;
+
+    Tasks::ParallelFor(uint32(numGroups), 256, CullTask, &args);
+    Tasks::ParallelFor(uint32(numViews), 1, CompactTask, &args);
+}
+
+void CullCameraAndCascades(const CullingBounds& bounds, const Camera& camera, const OrthographicCamera* cascadeCameras,
+                           uint64 numCascades, CullingResults& results)
+{
+    Assert_(numCascades + 1 <= MaxCullingViews);
+    Assert_(cascadeCameras != nullptr || numCascades == 0);
+
+    Frustum frusta[MaxCullingViews];
+    frusta[0] = ComputeFrustum(camera);
+    for(uint64 cascadeIdx = 0; cascadeIdx < numCascades; ++cascadeIdx)
+        frusta[cascadeIdx + 1] = ComputeShadowCasterFrustum(cascadeCameras[cascadeIdx]);
+
+    CullBounds(bounds, frusta, numCascades + 1, results);
+}
+
+// == Testing =====================================================================================
+
+// Accumulates in the same order as CullTask, so that boxes touching a plane get the same result
+static bool AABBInFrustumReference(const Float3& center, const Float3& extent, const Frustum& frustum)
+{
+    for(uint64 planeIdx = 0; planeIdx < 6; ++planeIdx)
+    {
+        const Float4& plane = frustum.Planes[planeIdx];
+        float dist = plane.w;
+        dist = center.x * plane.x + dist;
+        dist = center.y * plane.y + dist;
+        dist = center.z * plane.z + dist;
+        dist = extent.x * std::abs(plane.x) + dist;
+        dist = extent.y * std::abs(plane.y) + dist;
+        dist = extent.z * std::abs(plane.z) + dist;
+        if(dist < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+static void CullBoundsReference(const CullingBounds& bounds, const Frustum* frusta, uint64 numViews, Array<uint8>& masks)
+{
+    masks.Init(bounds.NumBounds, 0);
+    for(uint64 i = 0; i < bounds.NumBounds; ++i)
+    {
+        const Float3 center = Float3(bounds.CenterX[i], bounds.CenterY[i], bounds.CenterZ[i]);
+        const Float3 extent = Float3(bounds.ExtentX[i], bounds.ExtentY[i], bounds.ExtentZ[i]);
+        for(uint64 viewIdx = 0; viewIdx < numViews; ++viewIdx)
+            masks[i] |= AABBInFrustumReference(center, extent, frusta[viewIdx]) ? uint8(1 << viewIdx) : 0;
+    }
+}
+
+// Random boxes scattered around a camera at the origin, along with cascades for a sun that's coming in at an angle
+struct CullingTestScene
+{
+    CullingBounds Bounds;
+    PerspectiveCamera MainCamera;
+    OrthographicCamera CascadeCameras[NumCascades];
+    Frustum Frusta[NumCascades + 1];
+
+    void Init(uint64 numBounds, uint32 seed)
+    {
+        Random rng;
+        rng.SeedWithValue(seed);
+
+        const float sceneSize = 400.0f;
+        Bounds.Init(numBounds);
+        for(uint64 i = 0; i < numBounds; ++i)
+        {
+            const Float3 center = (Float3(rng.RandomFloat(), rng.RandomFloat(), rng.RandomFloat()) - 0.5f) * sceneSize;
+            const Float3 extent = Float3(rng.RandomFloat(), rng.RandomFloat(), rng.RandomFloat()) * 4.0f + 0.05f;
+            Bounds.SetAABB(i, center - extent, center + extent);
+        }
+
+        MainCamera.Initialize(16.0f / 9.0f, Pi_4, 0.1f, sceneSize * 0.5f);
+        MainCamera.SetLookAt(Float3(0.0f, 2.0f, 0.0f), Float3(1.0f, 1.5f, 2.0f), Float3(0.0f, 1.0f, 0.0f));
+
+        SunShadowConstantsBase constants;
+        const Float3 lightDir = Float3::Normalize(Float3(0.3f, 1.0f, -0.4f));
+        ShadowHelper::PrepareCascades(lightDir, 2048, true, MainCamera, constants, CascadeCameras);
+
+        Frusta[0] = ComputeFrustum(MainCamera);
+        for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+            Frusta[cascadeIdx + 1] = ComputeShadowCasterFrustum(CascadeCameras[cascadeIdx]);
+    }
+};
+
+static bool CompareCullingResults(const CullingBounds& bounds, const CullingResults& results, const Array<uint8>& referenceMasks)
+{
+    for(uint64 i = 0; i < bounds.NumBounds; ++i)
+    {
+        if(results.VisibilityMasks[i] != referenceMasks[i])
+        {
+            WriteLog("Bound %llu has a visibility mask of 0x%02X, the reference gives 0x%02X", i, results.VisibilityMasks[i], referenceMasks[i]);
+            return false;
+        }
+    }
+
+    for(uint64 viewIdx = 0; viewIdx < results.NumViews; ++viewIdx)
+    {
+        uint64 numVisible = 0;
+        for(uint64 i = 0; i < bounds.NumBounds; ++i)
+        {
+            if((referenceMasks[i] & (1 << viewIdx)) == 0)
+                continue;
+
+            if(numVisible >= results.NumVisible[viewIdx] || results.VisibleIndices[viewIdx][numVisible] != i)
+            {
+                WriteLog("The visible list for view %llu doesn't match the reference", viewIdx);
+                return false;
+            }
+
+            ++numVisible;
+        }
+
+        if(numVisible != results.NumVisible[viewIdx])
+        {
+            WriteLog("View %llu has %llu visible bounds, the reference has %llu", viewIdx, results.NumVisible[viewIdx], numVisible);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ValidateCulling()
+{
+    // An odd count, so that the last group is partially padding
+    CullingTestScene scene;
+    scene.Init(10001, 32);
+
+    CullingResults results;
+    CullCameraAndCascades(scene.Bounds, scene.MainCamera, scene.CascadeCameras, NumCascades, results);
+
+    Array<uint8> referenceMasks;
+    CullBoundsReference(scene.Bounds, scene.Frusta, NumCascades + 1, referenceMasks);
+
+    bool passed = CompareCullingResults(scene.Bounds, results, referenceMasks);
+
+    WriteLog("Culling: %llu bounds, %llu visible to the camera, %llu/%llu/%llu/%llu casters per cascade", scene.Bounds.NumBounds,
+             results.NumVisible[0], results.NumVisible[1], results.NumVisible[2], results.NumVisible[3], results.NumVisible[4]);
+
+    if(results.NumVisible[0] == 0 || results.NumVisible[0] == scene.Bounds.NumBounds)
+    {
+        WriteLog("The camera frustum should see some of the bounds, but not all of them");
+        passed = false;
+    }
+
+    // A caster between the sun and the first cascade is outside of the cascade camera's frustum, but still needs to be drawn
+    const OrthographicCamera& cascadeCamera = scene.CascadeCameras[0];
+    const Float3 casterCenter = cascadeCamera.Position() + cascadeCamera.Back() * 10.0f;
+    const Float3 casterExtent = Float3(0.5f, 0.5f, 0.5f);
+
+    CullingBounds casterBounds;
+    casterBounds.Init(1);
+    casterBounds.SetAABB(0, casterCenter - casterExtent, casterCenter + casterExtent);
+    CullCameraAndCascades(casterBounds, scene.MainCamera, scene.CascadeCameras, NumCascades, results);
+
+    if(AABBInFrustumReference(casterCenter, casterExtent, ComputeFrustum(cascadeCamera)) || results.NumVisible[1] != 1)
+    {
+        WriteLog("A shadow caster in front of the first cascade's near plane was culled");
+        passed = false;
+    }
+
+    return passed;
+}
+
+bool BenchmarkCulling(uint64 maxBounds)
+{
+    bool passed = true;
+
+    for(uint64 numBounds = 10000; numBounds <= maxBounds && passed; numBounds *= 10)
+    {
+        CullingTestScene scene;
+        scene.Init(numBounds, 32);
+
+        CullingResults results;
+        Array<uint8> referenceMasks;
+
+        // Warm up the result arrays and the task scheduler before timing anything
+        CullCameraAndCascades(scene.Bounds, scene.MainCamera, scene.CascadeCameras, NumCascades, results);
+
+        const uint64 numIterations = Max<uint64>(10000000 / numBounds, 4);
+        Timer timer;
+        for(uint64 i = 0; i < numIterations; ++i)
+            CullCameraAndCascades(scene.Bounds, scene.MainCamera, scene.CascadeCameras, NumCascades, results);
+        timer.Update();
+        const double cullTime = timer.DeltaMillisecondsD() / numIterations;
+
+        for(uint64 i = 0; i < numIterations; ++i)
+            CullBoundsReference(scene.Bounds, scene.Frusta, NumCascades + 1, referenceMasks);
+        timer.Update();
+        const double referenceTime = timer.DeltaMillisecondsD() / numIterations;
+
+        passed = CompareCullingResults(scene.Bounds, results, referenceMasks);
+
+        WriteLog("Culling %llu bounds against %llu views: %.3fms (%.1f M bounds/s), scalar reference %.3fms (%.2fx), %llu visible to the camera",
+                 numBounds, NumCascades + 1, cullTime, numBounds / (cullTime * 1000.0), referenceTime, referenceTime / cullTime,
+                 results.NumVisible[0]);
+    }
+
+    return passed;
+}
+
+}
@@ -0,0 +1,86 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\SF12_Math.h"
+#include "..\\Containers.h"
+
+namespace SampleFramework12
+{
+
+class Camera;
+class OrthographicCamera;
+class Model;
+
+static const uint64 MaxCullingViews = 8;
+
+// Planes of a view frustum, with normals that point inwards
+struct Frustum
+{
+    Float4 Planes[6];
+};
+
+// Extracts the frustum planes from a view * projection matrix (works for both perspective and orthographic)
+Frustum ComputeFrustum(const Float4x4& viewProjection);
+Frustum ComputeFrustum(const Camera& camera);
+
+// Frustum for culling shadow casters against a shadow/cascade camera. The near plane is dropped, since
+// casters that are between the light and the shadow camera still cast shadows into its frustum.
+Frustum ComputeShadowCasterFrustum(const Camera& shadowCamera);
+
+// A set of AABBs stored as SoA centers/extents, padded to a multiple of 4 so that they can be tested with SIMD
+struct CullingBounds
+{
+    Array<float> CenterX;
+    Array<float> CenterY;
+    Array<float> CenterZ;
+    Array<float> ExtentX;
+    Array<float> ExtentY;
+    Array<float> ExtentZ;
+    uint64 NumBounds = 0;
+
+    void Init(uint64 numBounds);
+    void Init(const Model& model);
+    void Shutdown();
+
+    void SetAABB(uint64 idx, const Float3& aabbMin, const Float3& aabbMax);
+};
+
+// Compact lists of the bounds that are visible to each view
+struct CullingResults
+{
+    Array<uint32> VisibleIndices[MaxCullingViews];
+    uint64 NumVisible[MaxCullingViews] = { };
+    uint64 NumViews = 0;
+
+    // One bit per view for each bound
+    Array<uint8> VisibilityMasks;
+};
+
+// Tests all bounds against all views in a single pass, spread across the task scheduler's threads. A typical
+// usage is the main camera frustum followed by the frustum of each shadow cascade.
+void CullBounds(const CullingBounds& bounds, const Frustum* frusta, uint64 numViews, CullingResults& results);
+
+// Culls against the main camera (view 0) and the shadow casters for each cascade (views 1 through numCascades),
+// using the cascade cameras that were filled out by ShadowHelper::PrepareCascades()
+void CullCameraAndCascades(const CullingBounds& bounds, const Camera& camera, const OrthographicCamera* cascadeCameras,
+                           uint64 numCascades, CullingResults& results);
+
+// Compares CullCameraAndCascades() against a scalar reference for random bounds, and checks that casters in
+// front of a cascade's near plane are kept. Logs the results, and returns false if anything failed.
+bool ValidateCulling();
+
+// Times CullCameraAndCascades() and the scalar reference for 10k, 100k and 1M bounds against a camera and
+// its shadow cascades, and returns false if their results differ
+bool BenchmarkCulling(uint64 maxBounds = 1000000);
+
+}
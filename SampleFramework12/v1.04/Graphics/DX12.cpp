@@ -11,7 +11,10 @@
 #include "DX12.h"
 #include "DX12_Upload.h"
 #include "DX12_Helpers.h"
+#include "DX12_PipelineCache.h"
+#include "DX12_CmdLists.h"
 #include "GraphicsTypes.h"
+#include "BarrierTracker.h"
 
 #if Debug_
     #define UseDebugDevice_ 1
@@ -42,11 +45,7 @@ namespace DX12
 {
 
 ID3D12Device10* Device = nullptr;
-#if EnableWorkGraphsPreview_
-    ID3D12GraphicsCommandListExperimental* CmdList = nullptr;
-#else
-    ID3D12GraphicsCommandList7* CmdList = nullptr;
-#endif
+GraphicsCmdList* CmdList = nullptr;
 ID3D12CommandQueue* GfxQueue = nullptr;
 D3D_FEATURE_LEVEL FeatureLevel = D3D_FEATURE_LEVEL_11_0;
 IDXGIFactory4* Factory = nullptr;
@@ -236,11 +235,14 @@ void Initialize(D3D_FEATURE_LEVEL minFeatureLevel, uint32 adapterIdx)
     DXCall(CmdAllocators[CurrFrameIdx]->Reset());
     DXCall(CmdList->Reset(CmdAllocators[CurrFrameIdx], nullptr));
 
+    Initialize_CmdLists(CmdList);
+
     FrameFence.Init(0);
 
     for(uint64 i = 0; i < ArraySize_(DeferredSRVCreates); ++i)
         DeferredSRVCreates[i].Init(1024);
 
+    Initialize_PipelineCache();
     Initialize_Helpers();
     Initialize_Upload();
 }
@@ -258,6 +260,8 @@ void Shutdown()
     for(uint64 i = 0; i < RenderLatency; ++i)
         Release(CmdAllocators[i]);
 
+    Shutdown_CmdLists();
+    CmdListBarriers.Shutdown();
     Release(CmdList);
     Release(GfxQueue);
     Release(Factory);
@@ -265,6 +269,7 @@ void Shutdown()
 
     Shutdown_Helpers();
     Shutdown_Upload();
+    Shutdown_PipelineCache();
 
     #if BreakOnDXError_
         if(Device != nullptr)
@@ -299,12 +304,13 @@ void EndFrame(IDXGISwapChain4* swapChain, uint32 syncIntervals)
 {
     Assert_(Device);
 
+    CmdListBarriers.Flush(CmdList);
     DXCall(CmdList->Close());
 
     EndFrame_Upload();
 
-    ID3D12CommandList* commandLists[] = { CmdList };
-    GfxQueue->ExecuteCommandLists(ArraySize_(commandLists), commandLists);
+    // Submits the main command list along with any that were recorded in parallel
+    Submit_CmdLists();
 
     // Present the frame.
     if(swapChain)
@@ -329,6 +335,7 @@ void EndFrame(IDXGISwapChain4* swapChain, uint32 syncIntervals)
 
     // Prepare the command buffers to be used for the next frame
     DXCall(CmdAllocators[CurrFrameIdx]->Reset());
+    BeginFrame_CmdLists();
     DXCall(CmdList->Reset(CmdAllocators[CurrFrameIdx], nullptr));
 
     EndFrame_Helpers();
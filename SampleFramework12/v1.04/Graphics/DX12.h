@@ -20,13 +20,15 @@ namespace DX12
 // Constants
 const uint64 RenderLatency = 2;
 
-// Externals
-extern ID3D12Device10* Device;
 #if EnableWorkGraphsPreview_
-    extern ID3D12GraphicsCommandListExperimental* CmdList;
+    typedef ID3D12GraphicsCommandListExperimental GraphicsCmdList;
 #else
-    extern ID3D12GraphicsCommandList7* CmdList;
+    typedef ID3D12GraphicsCommandList7 GraphicsCmdList;
 #endif
+
+// Externals
+extern ID3D12Device10* Device;
+extern GraphicsCmdList* CmdList;
 extern ID3D12CommandQueue* GfxQueue;
 extern D3D_FEATURE_LEVEL FeatureLevel;
 extern IDXGIFactory4* Factory;
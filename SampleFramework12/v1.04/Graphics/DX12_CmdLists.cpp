@@ -0,0 +1,507 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "DX12_CmdLists.h"
+#include "DX12.h"
+#include "DX12_Helpers.h"
+
+#include "..\\Exceptions.h"
+#include "..\\SF12_Math.h"
+#include "..\\Tasks.h"
+#include "..\\Timer.h"
+#include "..\\Utility.h"
+
+namespace SampleFramework12
+{
+
+namespace DX12
+{
+
+// Creates graphics command lists and allocators on the D3D12 device, and executes them on the given queue
+struct D3D12CmdListDevice
+{
+    typedef GraphicsCmdList CmdList;
+    typedef ID3D12CommandAllocator CmdAllocator;
+
+    // Lists only get executed if there's a queue, which lets the benchmark throw them away instead
+    ID3D12CommandQueue* Queue = nullptr;
+
+    CmdAllocator* CreateCmdAllocator()
+    {
+        ID3D12CommandAllocator* allocator = nullptr;
+        DXCall(Device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&allocator)));
+        return allocator;
+    }
+
+    CmdList* CreateCmdList(CmdAllocator* allocator)
+    {
+        GraphicsCmdList* cmdList = nullptr;
+        DXCall(Device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator, nullptr, IID_PPV_ARGS(&cmdList)));
+        DXCall(cmdList->Close());
+        cmdList->SetName(L"Parallel Graphics Command List");
+        return cmdList;
+    }
+
+    void ResetCmdAllocator(CmdAllocator* allocator)
+    {
+        DXCall(allocator->Reset());
+    }
+
+    void ResetCmdList(CmdList* cmdList, CmdAllocator* allocator)
+    {
+        DXCall(cmdList->Reset(allocator, nullptr));
+    }
+
+    void ExecuteCmdLists(CmdList** cmdLists, uint64 numCmdLists)
+    {
+        if(Queue != nullptr)
+            Queue->ExecuteCommandLists(uint32(numCmdLists), reinterpret_cast<ID3D12CommandList* const*>(cmdLists));
+    }
+
+    void Release(CmdList* cmdList)
+    {
+        cmdList->Release();
+    }
+
+    void Release(CmdAllocator* allocator)
+    {
+        allocator->Release();
+    }
+};
+
+// A set of command lists that are being recorded by the task threads
+struct ParallelCmdListBatch
+{
+    enkiTaskSet* TaskSet = nullptr;
+    RecordCmdListFunction RecordFunc = nullptr;
+    void* Context = nullptr;
+    GraphicsCmdList* CmdLists[MaxParallelCmdLists] = { };
+    uint64 NumCmdLists = 0;
+};
+
+static const uint64 MaxParallelBatches = 32;
+
+static D3D12CmdListDevice FrameDevice;
+static CmdListPool<D3D12CmdListDevice> FramePool;
+static GraphicsCmdList* PrimaryCmdList = nullptr;
+static ParallelCmdListBatch Batches[MaxParallelBatches];
+static uint64 NumBatches = 0;
+
+void Initialize_CmdLists(GraphicsCmdList* primaryCmdList)
+{
+    Assert_(primaryCmdList != nullptr);
+    Assert_(GfxQueue != nullptr);
+
+    PrimaryCmdList = primaryCmdList;
+    FrameDevice.Queue = GfxQueue;
+    FramePool.Initialize(&FrameDevice);
+    FramePool.BeginFrame(CurrentCPUFrame);
+    NumBatches = 0;
+}
+
+void Shutdown_CmdLists()
+{
+    Assert_(NumBatches == 0);
+
+    FramePool.Shutdown();
+    FrameDevice.Queue = nullptr;
+    CmdList = PrimaryCmdList;
+    PrimaryCmdList = nullptr;
+}
+
+void BeginFrame_CmdLists()
+{
+    Assert_(NumBatches == 0);
+
+    // The allocators for this frame index were last used RenderLatency frames ago, which EndFrame() has already waited on
+    FramePool.BeginFrame(CurrentCPUFrame);
+    CmdList = PrimaryCmdList;
+}
+
+void Submit_CmdLists()
+{
+    for(uint64 batchIdx = 0; batchIdx < NumBatches; ++batchIdx)
+        WaitForParallelCmdLists(batchIdx);
+    NumBatches = 0;
+
+    // The primary list always has everything that was recorded before the first parallel batch
+    FramePool.Submit(PrimaryCmdList);
+}
+
+static void RecordCmdListsTask(uint32 start, uint32 end, uint32 threadNum, void* args)
+{
+    const ParallelCmdListBatch& batch = *reinterpret_cast<const ParallelCmdListBatch*>(args);
+    for(uint32 listIdx = start; listIdx < end; ++listIdx)
+    {
+        GraphicsCmdList* cmdList = batch.CmdLists[listIdx];
+        SetDescriptorHeaps(cmdList);
+        batch.RecordFunc(cmdList, listIdx, batch.Context);
+        DXCall(cmdList->Close());
+    }
+}
+
+uint64 BeginParallelCmdLists(uint64 numLists, RecordCmdListFunction recordFunc, void* context)
+{
+    Assert_(numLists > 0 && numLists <= MaxParallelCmdLists);
+    Assert_(recordFunc != nullptr);
+    Assert_(NumBatches < MaxParallelBatches);
+
+    // Everything that was recorded so far goes before the parallel lists
+    DXCall(CmdList->Close());
+
+    const uint64 batchIdx = NumBatches++;
+    ParallelCmdListBatch& batch = Batches[batchIdx];
+    batch.RecordFunc = recordFunc;
+    batch.Context = context;
+    batch.NumCmdLists = numLists;
+
+    // Acquiring the lists up-front (in order) is what determines the submission order
+    for(uint64 listIdx = 0; listIdx < numLists; ++listIdx)
+        batch.CmdLists[listIdx] = FramePool.Acquire();
+
+    // The rest of the frame gets recorded into a new list that goes after the parallel ones
+    CmdList = FramePool.Acquire();
+    SetDescriptorHeaps(CmdList);
+
+    batch.TaskSet = Tasks::BeginParallelFor(uint32(numLists), 1, RecordCmdListsTask, &batch);
+
+    return batchIdx;
+}
+
+void WaitForParallelCmdLists(uint64 batchIdx)
+{
+    Assert_(batchIdx < NumBatches);
+
+    ParallelCmdListBatch& batch = Batches[batchIdx];
+    Tasks::WaitForTaskSet(batch.TaskSet);
+    batch.TaskSet = nullptr;
+}
+
+GraphicsCmdList* RecordParallelCmdLists(uint64 numLists, RecordCmdListFunction recordFunc, void* context)
+{
+    WaitForParallelCmdLists(BeginParallelCmdLists(numLists, recordFunc, context));
+    return CmdList;
+}
+
+// == Validation ==================================================================================
+
+struct FakeCmdList;
+
+struct FakeCmdAllocator
+{
+    FakeCmdList* OpenList = nullptr;
+    uint64 SubmitFence = 0;         // The GPU has to reach this before the allocator can be reset
+};
+
+struct FakeCmdList
+{
+    FakeCmdAllocator* Allocator = nullptr;
+    bool Open = false;
+    uint64 Tag = 0;                 // Written while "recording", and it's where the list should end up in the submission
+};
+
+// Checks that lists and allocators are used the way that D3D12 requires, with the GPU's progress simulated
+// by the completed fence value
+struct FakeCmdListDevice
+{
+    typedef FakeCmdList CmdList;
+    typedef FakeCmdAllocator CmdAllocator;
+
+    uint64 CPUFrame = 0;
+    uint64 GPUFence = 0;
+    uint64 NumInvalidResets = 0;
+    uint64 NumInvalidExecutes = 0;
+    uint64 NumLiveObjects = 0;
+    uint64 NumSubmitted = 0;
+    List<uint64> ExecutedTags;
+
+    CmdAllocator* CreateCmdAllocator()
+    {
+        NumLiveObjects += 1;
+        return new FakeCmdAllocator();
+    }
+
+    CmdList* CreateCmdList(CmdAllocator*)
+    {
+        NumLiveObjects += 1;
+        return new FakeCmdList();
+    }
+
+    void ResetCmdAllocator(CmdAllocator* allocator)
+    {
+        if(allocator->OpenList != nullptr || allocator->SubmitFence > GPUFence)
+            NumInvalidResets += 1;
+    }
+
+    void ResetCmdList(CmdList* cmdList, CmdAllocator* allocator)
+    {
+        if(cmdList->Open || allocator->OpenList != nullptr)
+            NumInvalidResets += 1;
+
+        cmdList->Open = true;
+        cmdList->Allocator = allocator;
+        allocator->OpenList = cmdList;
+    }
+
+    // Gets called by the task threads, but never for the same list at the same time
+    static void Close(CmdList* cmdList)
+    {
+        cmdList->Open = false;
+        cmdList->Allocator->OpenList = nullptr;
+    }
+
+    void ExecuteCmdLists(CmdList** cmdLists, uint64 numCmdLists)
+    {
+        for(uint64 i = 0; i < numCmdLists; ++i)
+        {
+            if(cmdLists[i]->Open)
+                NumInvalidExecutes += 1;
+
+            cmdLists[i]->Allocator->SubmitFence = CPUFrame + 1;
+            ExecutedTags.Add(cmdLists[i]->Tag);
+        }
+
+        NumSubmitted += numCmdLists;
+    }
+
+    void Release(CmdList* cmdList)
+    {
+        NumLiveObjects -= 1;
+        delete cmdList;
+    }
+
+    void Release(CmdAllocator* allocator)
+    {
+        NumLiveObjects -= 1;
+        delete allocator;
+    }
+};
+
+struct FakeBatch
+{
+    FakeCmdList* CmdLists[MaxParallelCmdLists] = { };
+    uint64 FirstTag = 0;
+    enkiTaskSet* TaskSet = nullptr;
+};
+
+static void RecordFakeCmdListsTask(uint32 start, uint32 end, uint32 threadNum, void* args)
+{
+    const FakeBatch& batch = *reinterpret_cast<const FakeBatch*>(args);
+    for(uint32 listIdx = start; listIdx < end; ++listIdx)
+    {
+        batch.CmdLists[listIdx]->Tag = batch.FirstTag + listIdx;
+        FakeCmdListDevice::Close(batch.CmdLists[listIdx]);
+    }
+}
+
+bool ValidateCmdListPool(uint64 numFrames)
+{
+    static const uint64 MaxBatchesPerFrame = 4;
+    static const uint64 MaxListsPerBatch = 16;
+
+    FakeCmdListDevice device;
+    CmdListPool<FakeCmdListDevice> pool;
+    pool.Initialize(&device);
+    pool.BeginFrame(0);
+
+    // Stands in for DX12::CmdList and its allocators, which live outside of the pool
+    FakeCmdAllocator* primaryAllocators[RenderLatency] = { };
+    for(uint64 i = 0; i < RenderLatency; ++i)
+        primaryAllocators[i] = device.CreateCmdAllocator();
+    FakeCmdList* primaryList = device.CreateCmdList(primaryAllocators[0]);
+    device.ResetCmdList(primaryList, primaryAllocators[0]);
+
+    Random rng;
+    FakeBatch batches[MaxBatchesPerFrame];
+    uint64 numOrderErrors = 0;
+    uint64 maxListsPerFrame = 0;
+
+    for(uint64 frame = 0; frame < numFrames; ++frame)
+    {
+        uint64 nextTag = 0;
+        primaryList->Tag = nextTag++;
+        FakeCmdList* currList = primaryList;
+
+        // Kick off a random number of batches, which are recorded on the task threads while this thread moves on
+        const uint64 numBatches = rng.RandomUint() % (MaxBatchesPerFrame + 1);
+        for(uint64 batchIdx = 0; batchIdx < numBatches; ++batchIdx)
+        {
+            FakeCmdListDevice::Close(currList);
+
+            FakeBatch& batch = batches[batchIdx];
+            const uint64 numLists = 1 + rng.RandomUint() % MaxListsPerBatch;
+            for(uint64 listIdx = 0; listIdx < numLists; ++listIdx)
+                batch.CmdLists[listIdx] = pool.Acquire();
+            batch.FirstTag = nextTag;
+            nextTag += numLists;
+
+            currList = pool.Acquire();
+            currList->Tag = nextTag++;
+
+            batch.TaskSet = Tasks::BeginParallelFor(uint32(numLists), 1, RecordFakeCmdListsTask, &batch);
+        }
+
+        FakeCmdListDevice::Close(currList);
+        for(uint64 batchIdx = 0; batchIdx < numBatches; ++batchIdx)
+            Tasks::WaitForTaskSet(batches[batchIdx].TaskSet);
+
+        maxListsPerFrame = Max(maxListsPerFrame, pool.NumPending());
+
+        device.ExecutedTags.RemoveAll();
+        pool.Submit(primaryList);
+
+        if(device.ExecutedTags.Count() != nextTag)
+            numOrderErrors += 1;
+        for(uint64 i = 0; i < device.ExecutedTags.Count(); ++i)
+            numOrderErrors += device.ExecutedTags[i] != i ? 1 : 0;
+
+        // Mirrors EndFrame(), where the GPU gets a random amount of work done and the CPU waits on it if it gets too far ahead
+        device.CPUFrame += 1;
+        device.GPUFence += rng.RandomUint() % (device.CPUFrame - device.GPUFence + 1);
+        if(device.CPUFrame - device.GPUFence >= RenderLatency)
+            device.GPUFence = device.CPUFrame - RenderLatency + 1;
+
+        const uint64 frameIdx = device.CPUFrame % RenderLatency;
+        device.ResetCmdAllocator(primaryAllocators[frameIdx]);
+        pool.BeginFrame(device.CPUFrame);
+        device.ResetCmdList(primaryList, primaryAllocators[frameIdx]);
+    }
+
+    const uint64 numInvalidResets = device.NumInvalidResets;
+    const uint64 numCmdLists = pool.NumCmdLists();
+    const uint64 numAllocators = pool.NumCmdAllocators();
+    const bool boundedGrowth = numCmdLists <= maxListsPerFrame && numAllocators <= maxListsPerFrame * RenderLatency;
+
+    // Make sure that the fake device actually catches resetting allocators before the GPU is done with them
+    FakeCmdListDevice::Close(primaryList);
+    for(uint64 i = 0; i < RenderLatency; ++i)
+        FakeCmdListDevice::Close(pool.Acquire());
+    pool.Submit(nullptr);
+    device.CPUFrame += RenderLatency;
+    pool.BeginFrame(device.CPUFrame);
+    const bool caughtEarlyReset = device.NumInvalidResets > numInvalidResets;
+
+    pool.Shutdown();
+    device.Release(primaryList);
+    for(uint64 i = 0; i < RenderLatency; ++i)
+        device.Release(primaryAllocators[i]);
+    device.ExecutedTags.Shutdown();
+
+    WriteLog("Command list pool: %llu frames, %llu lists submitted, %llu out of order, %llu invalid resets, %llu invalid executes, "
+             "%llu lists + %llu allocators created (up to %llu lists per frame), %llu objects leaked, %s an early allocator reset",
+             numFrames, device.NumSubmitted, numOrderErrors, numInvalidResets, device.NumInvalidExecutes, numCmdLists,
+             numAllocators, maxListsPerFrame, device.NumLiveObjects, caughtEarlyReset ? "caught" : "didn't catch");
+
+    const bool passed = numOrderErrors == 0 && numInvalidResets == 0 && device.NumInvalidExecutes == 0 && boundedGrowth &&
+                        device.NumLiveObjects == 0 && caughtEarlyReset;
+    return passed;
+}
+
+// == Benchmarking ================================================================================
+
+struct BenchmarkRecordArgs
+{
+    GraphicsCmdList* CmdLists[MaxParallelCmdLists] = { };
+    uint64 NumCmdLists = 0;
+    uint64 NumDraws = 0;
+    RecordDrawFunction DrawFunc = nullptr;
+    RecordCmdListFunction SetupFunc = nullptr;
+    void* Context = nullptr;
+};
+
+static void RecordBenchmarkCmdList(const BenchmarkRecordArgs& args, uint64 listIdx)
+{
+    GraphicsCmdList* cmdList = args.CmdLists[listIdx];
+    SetDescriptorHeaps(cmdList);
+    if(args.SetupFunc != nullptr)
+        args.SetupFunc(cmdList, listIdx, args.Context);
+
+    const uint64 startDraw = listIdx * args.NumDraws / args.NumCmdLists;
+    const uint64 endDraw = (listIdx + 1) * args.NumDraws / args.NumCmdLists;
+    for(uint64 drawIdx = startDraw; drawIdx < endDraw; ++drawIdx)
+        args.DrawFunc(cmdList, drawIdx, args.Context);
+
+    DXCall(cmdList->Close());
+}
+
+static void RecordBenchmarkTask(uint32 start, uint32 end, uint32 threadNum, void* args)
+{
+    const BenchmarkRecordArgs& recordArgs = *reinterpret_cast<const BenchmarkRecordArgs*>(args);
+    for(uint32 listIdx = start; listIdx < end; ++listIdx)
+        RecordBenchmarkCmdList(recordArgs, listIdx);
+}
+
+void BenchmarkCmdListRecording(uint64 numDraws, RecordDrawFunction drawFunc, void* context, RecordCmdListFunction setupFunc)
+{
+    Assert_(Device != nullptr);
+    Assert_(drawFunc != nullptr);
+
+    static const uint64 NumIterations = 16;
+
+    // No queue, so that the lists get thrown away instead of executed
+    D3D12CmdListDevice device;
+    CmdListPool<D3D12CmdListDevice> pool;
+    pool.Initialize(&device);
+
+    BenchmarkRecordArgs args;
+    args.NumDraws = numDraws;
+    args.DrawFunc = drawFunc;
+    args.SetupFunc = setupFunc;
+    args.Context = context;
+
+    const uint64 maxLists = Min<uint64>(MaxParallelCmdLists, Tasks::NumThreads() * 2);
+    WriteLog("Command list recording benchmark: %llu draws, %u threads", numDraws, Tasks::NumThreads());
+
+    uint64 frame = 0;
+    double singleListTime = 0.0;
+    for(uint64 numLists = 0; numLists <= maxLists; numLists = numLists == 0 ? 1 : numLists * 2)
+    {
+        // 0 lists means recording everything on this thread, like everything does with DX12::CmdList
+        const bool mainThread = numLists == 0;
+        args.NumCmdLists = mainThread ? 1 : numLists;
+
+        // Do one extra iteration to warm up the allocators
+        double totalTime = 0.0;
+        for(uint64 iteration = 0; iteration <= NumIterations; ++iteration)
+        {
+            pool.BeginFrame(frame++);
+
+            Timer timer;
+            for(uint64 listIdx = 0; listIdx < args.NumCmdLists; ++listIdx)
+                args.CmdLists[listIdx] = pool.Acquire();
+
+            if(mainThread)
+                RecordBenchmarkCmdList(args, 0);
+            else
+                Tasks::ParallelFor(uint32(args.NumCmdLists), 1, RecordBenchmarkTask, &args);
+
+            timer.Update();
+            if(iteration > 0)
+                totalTime += timer.ElapsedMillisecondsD();
+
+            pool.Submit(nullptr);
+        }
+
+        const double frameTime = totalTime / NumIterations;
+        if(mainThread)
+            singleListTime = frameTime;
+
+        WriteLog("    %2llu lists (%s): %.3fms per frame (%.2fx), %.1fns per draw", args.NumCmdLists,
+                 mainThread ? "main thread" : "task threads", frameTime, singleListTime / frameTime,
+                 frameTime * 1000000.0 / double(Max<uint64>(numDraws, 1)));
+    }
+
+    pool.Shutdown();
+}
+
+} // namespace DX12
+
+} // namespace SampleFramework12
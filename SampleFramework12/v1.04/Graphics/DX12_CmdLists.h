@@ -0,0 +1,194 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\Containers.h"
+#include "DX12.h"
+
+namespace SampleFramework12
+{
+
+// Hands out command lists that each get their own allocator, and submits them in the same order that they were
+// acquired (regardless of which thread recorded them or when they finished). Allocators are kept per frame and
+// are only reset once that frame comes back around, which is the same RenderLatency recycling used for the main
+// command list. TDevice creates, resets, executes, and releases the lists and allocators, which keeps the pool
+// itself independent of D3D12. Acquire(), Submit(), and BeginFrame() need to be called from the same thread.
+template<typename TDevice> class CmdListPool
+{
+
+public:
+
+    typedef typename TDevice::CmdList CmdList;
+    typedef typename TDevice::CmdAllocator CmdAllocator;
+
+    void Initialize(TDevice* device_)
+    {
+        Assert_(device_ != nullptr);
+        Shutdown();
+
+        device = device_;
+    }
+
+    void Shutdown()
+    {
+        if(device == nullptr)
+            return;
+
+        Assert_(pending.Count() == 0);
+
+        for(uint64 i = 0; i < freeLists.Count(); ++i)
+            device->Release(freeLists[i]);
+        freeLists.Shutdown();
+        pending.Shutdown();
+        submitList.Shutdown();
+
+        for(uint64 frameIdx = 0; frameIdx < DX12::RenderLatency; ++frameIdx)
+        {
+            for(uint64 i = 0; i < allocators[frameIdx].Count(); ++i)
+                device->Release(allocators[frameIdx][i]);
+            allocators[frameIdx].Shutdown();
+            numUsedAllocators[frameIdx] = 0;
+        }
+
+        numCmdLists = 0;
+        device = nullptr;
+    }
+
+    // Resets the allocators that were used the last time this frame index came around, so the GPU needs
+    // to be done with that frame by now
+    void BeginFrame(uint64 cpuFrame)
+    {
+        Assert_(device != nullptr);
+        Assert_(pending.Count() == 0);
+
+        currFrameIdx = cpuFrame % DX12::RenderLatency;
+        for(uint64 i = 0; i < numUsedAllocators[currFrameIdx]; ++i)
+            device->ResetCmdAllocator(allocators[currFrameIdx][i]);
+        numUsedAllocators[currFrameIdx] = 0;
+    }
+
+    // Returns a command list that's ready to record into, which will be submitted after every list that
+    // was acquired before it
+    CmdList* Acquire()
+    {
+        Assert_(device != nullptr);
+
+        List<CmdAllocator*>& frameAllocators = allocators[currFrameIdx];
+        if(numUsedAllocators[currFrameIdx] == frameAllocators.Count())
+            frameAllocators.Add(device->CreateCmdAllocator());
+        CmdAllocator* allocator = frameAllocators[numUsedAllocators[currFrameIdx]++];
+
+        CmdList* cmdList = nullptr;
+        if(freeLists.Count() > 0)
+        {
+            cmdList = freeLists[freeLists.Count() - 1];
+            freeLists.Remove(freeLists.Count() - 1);
+        }
+        else
+        {
+            cmdList = device->CreateCmdList(allocator);
+            numCmdLists += 1;
+        }
+
+        device->ResetCmdList(cmdList, allocator);
+        pending.Add(cmdList);
+
+        return cmdList;
+    }
+
+    // Executes firstList (if there is one) followed by every acquired list, all of which need to be closed.
+    // The lists can be re-used right away, but their allocators stay untouched until the frame comes back around.
+    void Submit(CmdList* firstList)
+    {
+        Assert_(device != nullptr);
+
+        submitList.RemoveAll();
+        if(firstList != nullptr)
+            submitList.Add(firstList);
+        submitList.Append(pending.Data(), pending.Count());
+
+        if(submitList.Count() > 0)
+            device->ExecuteCmdLists(submitList.Data(), submitList.Count());
+
+        freeLists.Append(pending.Data(), pending.Count());
+        pending.RemoveAll();
+    }
+
+    uint64 NumPending() const { return pending.Count(); }
+    uint64 NumCmdLists() const { return numCmdLists; }
+
+    uint64 NumCmdAllocators() const
+    {
+        uint64 numAllocators = 0;
+        for(uint64 frameIdx = 0; frameIdx < DX12::RenderLatency; ++frameIdx)
+            numAllocators += allocators[frameIdx].Count();
+        return numAllocators;
+    }
+
+protected:
+
+    TDevice* device = nullptr;
+    List<CmdAllocator*> allocators[DX12::RenderLatency];
+    uint64 numUsedAllocators[DX12::RenderLatency] = { };
+    uint64 currFrameIdx = 0;
+    List<CmdList*> freeLists;
+    List<CmdList*> pending;
+    List<CmdList*> submitList;
+    uint64 numCmdLists = 0;
+};
+
+namespace DX12
+{
+
+// Records a single command list on a task thread. The list already has the descriptor heaps set, and gets closed
+// once this returns. Gets called concurrently for different lists, so it needs to be thread-safe.
+typedef void (*RecordCmdListFunction)(GraphicsCmdList* cmdList, uint64 listIdx, void* context);
+
+const uint64 MaxParallelCmdLists = 64;
+
+// Lifetime
+void Initialize_CmdLists(GraphicsCmdList* primaryCmdList);
+void Shutdown_CmdLists();
+void BeginFrame_CmdLists();
+void Submit_CmdLists();
+
+// Closes DX12::CmdList and kicks off recording numLists command lists on the task scheduler, without waiting for
+// them. DX12::CmdList gets swapped for a new list that picks up right after the parallel lists, so anything that's
+// holding on to the old pointer needs to grab it again. Command list state doesn't carry over between lists, so
+// the new one (like the parallel ones) only has the descriptor heaps set. All of the lists go to the GPU in order
+// at the end of the frame, which waits for any recording that's still going. context needs to stay alive until
+// then, or until WaitForParallelCmdLists() is called with the returned batch index. Only call this from the
+// main thread.
+uint64 BeginParallelCmdLists(uint64 numLists, RecordCmdListFunction recordFunc, void* context);
+void WaitForParallelCmdLists(uint64 batchIdx);
+
+// Same as above, except that it waits for the recording to finish before returning the new DX12::CmdList
+GraphicsCmdList* RecordParallelCmdLists(uint64 numLists, RecordCmdListFunction recordFunc, void* context);
+
+// Runs a simulated frame loop against a fake device that checks that lists are submitted in the order they were
+// acquired (including when they're recorded by task threads), that allocators are never reset while the GPU could
+// still be using them, and that the number of allocators stops growing. Logs the results and returns false if
+// anything failed.
+bool ValidateCmdListPool(uint64 numFrames = 1000);
+
+// Records a single draw into the command list, which is assumed to already have a compatible PSO/root signature
+typedef void (*RecordDrawFunction)(GraphicsCmdList* cmdList, uint64 drawIdx, void* context);
+
+// Logs the CPU time for recording numDraws draws onto a single list on the main thread, vs. spreading them across
+// an increasing number of lists recorded by the task threads. setupFunc gets called once at the start of every list
+// to bind state (it can be nullptr). The recorded lists are thrown away without being executed.
+void BenchmarkCmdListRecording(uint64 numDraws, RecordDrawFunction drawFunc, void* context,
+                               RecordCmdListFunction setupFunc = nullptr);
+
+} // namespace DX12
+
+} // namespace SampleFramework12
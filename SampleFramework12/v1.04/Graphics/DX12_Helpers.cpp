@@ -12,7 +12,9 @@
 #include "DX12_Helpers.h"
 #include "DX12.h"
 #include "DX12_Upload.h"
+#include "DX12_PipelineCache.h"
 #include "GraphicsTypes.h"
+#include "BarrierTracker.h"
 #include "ShaderCompilation.h"
 #include "SF12_Math.h"
 
@@ -522,13 +524,13 @@ void Initialize_Helpers()
             psoDesc.CS = convertCS.ByteCode();
             psoDesc.pRootSignature = UniversalRootSignature;
             psoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
-            Device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&convertPSO));
+            CreateComputePipelineState(psoDesc, &convertPSO);
 
             psoDesc.CS = convertArrayCS.ByteCode();
-            Device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&convertArrayPSO));
+            CreateComputePipelineState(psoDesc, &convertArrayPSO);
 
             psoDesc.CS = convertCubeCS.ByteCode();
-            Device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&convertCubePSO));
+            CreateComputePipelineState(psoDesc, &convertCubePSO);
         }
 
         convertFence.Init(0);
@@ -545,7 +547,7 @@ void Initialize_Helpers()
         psoDesc.CS = clearRawBufferCS.ByteCode();
         psoDesc.pRootSignature = UniversalRootSignature;
         psoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
-        Device->CreateComputePipelineState(&psoDesc, IID_PPV_ARGS(&clearRawBufferPSO));
+        CreateComputePipelineState(psoDesc, &clearRawBufferPSO);
     }
 
 }
@@ -830,6 +832,7 @@ void CreateRootSignature(ID3D12RootSignature** rootSignature, const D3D12_ROOT_S
     }
 
     DXCall(DX12::Device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(), IID_PPV_ARGS(rootSignature)));
+    SetRootSignatureHash(*rootSignature, GenerateHash(signature->GetBufferPointer(), signature->GetBufferSize()));
 }
 
 uint32 DispatchSize(uint64 numElements, uint64 groupSize)
@@ -1065,6 +1068,7 @@ void ClearRawBuffer(ID3D12GraphicsCommandList* cmdList, const RawBuffer& buffer,
     BindTempConstantBuffer(cmdList, cbData, URS_ConstantBuffers + 0, CmdListMode::Compute);
 
     uint32 dispatchX = DispatchSize(cbData.Num16ByteElements, clearRawBufferTGSize);
+    FlushBarriers(cmdList);
     cmdList->Dispatch(dispatchX, 1, 1);
 }
 
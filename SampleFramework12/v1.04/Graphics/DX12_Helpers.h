@@ -11,6 +11,7 @@
 
 #include "../PCH.h"
 #include "../SF12_Assert.h"
+#include "../Containers.h"
 #include "DX12.h"
 #include "Utility.h"
 #include "../Shaders/ShaderShared.h"
@@ -114,43 +115,84 @@ struct BarrierBatch
     uint32 NumGlobalBarriers = 0;
 };
 
+// Fixed-capacity storage for the common case of a handful of barriers, which spills over into
+// a growable List once the inline storage runs out
+template<typename T, uint32 InlineCapacity> struct BarrierArray
+{
+    T Inline[InlineCapacity] = { };
+    List<T> Overflow;
+    uint32 Count = 0;
+
+    ~BarrierArray()
+    {
+        Overflow.Shutdown();
+    }
+
+    void Add(const T& barrier)
+    {
+        if(Count < InlineCapacity)
+        {
+            Inline[Count++] = barrier;
+            return;
+        }
+
+        if(Overflow.Count() == 0)
+            Overflow.Append(Inline, InlineCapacity);
+        Overflow.Add(barrier);
+        Count += 1;
+    }
+
+    const T* Data() const
+    {
+        return Count > InlineCapacity ? Overflow.Data() : Inline;
+    }
+
+    void Clear()
+    {
+        Overflow.RemoveAll();
+        Count = 0;
+    }
+};
+
 struct BarrierBatchBuilder
 {
-    D3D12_BUFFER_BARRIER BufferBarriers[16] = { };
-    uint32 NumBufferBarriers = 0;
-    D3D12_TEXTURE_BARRIER TextureBarriers[16] = { };
-    uint32 NumTextureBarriers = 0;
-    D3D12_GLOBAL_BARRIER GlobalBarriers[16] = { };
-    uint32 NumGlobalBarriers = 0;
+    BarrierArray<D3D12_BUFFER_BARRIER, 16> BufferBarriers;
+    BarrierArray<D3D12_TEXTURE_BARRIER, 16> TextureBarriers;
+    BarrierArray<D3D12_GLOBAL_BARRIER, 4> GlobalBarriers;
 
     void Add(D3D12_BUFFER_BARRIER barrier)
     {
-        Assert_(NumBufferBarriers < ArraySize_(BufferBarriers));
-        BufferBarriers[NumBufferBarriers++] = barrier;
+        BufferBarriers.Add(barrier);
     }
 
     void Add(D3D12_TEXTURE_BARRIER barrier)
     {
-        Assert_(NumTextureBarriers < ArraySize_(TextureBarriers));
-        TextureBarriers[NumTextureBarriers++] = barrier;
+        TextureBarriers.Add(barrier);
     }
 
     void Add(D3D12_GLOBAL_BARRIER barrier)
     {
-        Assert_(NumGlobalBarriers < ArraySize_(GlobalBarriers));
-        GlobalBarriers[NumGlobalBarriers++] = barrier;
+        GlobalBarriers.Add(barrier);
+    }
+
+    void Clear()
+    {
+        BufferBarriers.Clear();
+        TextureBarriers.Clear();
+        GlobalBarriers.Clear();
     }
 
+    // The returned batch points into the builder, and is only valid until the next call to Add() or Clear()
     BarrierBatch Build() const
     {
         return
         {
-            .BufferBarriers = BufferBarriers,
-            .NumBufferBarriers = NumBufferBarriers,
-            .TextureBarriers = TextureBarriers,
-            .NumTextureBarriers = NumTextureBarriers,
-            .GlobalBarriers = GlobalBarriers,
-            .NumGlobalBarriers = NumGlobalBarriers,
+            .BufferBarriers = BufferBarriers.Data(),
+            .NumBufferBarriers = BufferBarriers.Count,
+            .TextureBarriers = TextureBarriers.Data(),
+            .NumTextureBarriers = TextureBarriers.Count,
+            .GlobalBarriers = GlobalBarriers.Data(),
+            .NumGlobalBarriers = GlobalBarriers.Count,
         };
     }
 };
@@ -0,0 +1,468 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "DX12_PipelineCache.h"
+#include "DX12.h"
+#include "DX12_Helpers.h"
+#include "ShaderCompilation.h"
+
+#include "..\\Exceptions.h"
+#include "..\\FileIO.h"
+#include "..\\Timer.h"
+#include "..\\Utility.h"
+
+namespace SampleFramework12
+{
+
+namespace DX12
+{
+
+static const uint64 LibraryFileMagic = 0x42494C4F53503231;     // "12PSOLIB"
+static const uint64 LibraryFileVersion = 1;
+
+struct LibraryFileHeader
+{
+    uint64 Magic = LibraryFileMagic;
+    uint64 Version = LibraryFileVersion;
+    Hash CompilerHash;
+    uint64 NumPipelines = 0;
+    uint64 DataSize = 0;
+};
+
+// {5B1E2C7A-3F0D-4D8E-9A61-2E47C308B51D}
+static const GUID RootSignatureHashGUID = { 0x5b1e2c7a, 0x3f0d, 0x4d8e, { 0x9a, 0x61, 0x2e, 0x47, 0xc3, 0x8, 0xb5, 0x1d } };
+
+static PipelineStateMap PSOMap;
+static SRWLOCK PSOMapLock = SRWLOCK_INIT;
+
+// The library saved by the previous run is only ever loaded from, and everything that gets used during this run
+// is stored into a fresh library. Saving the fresh one at shutdown keeps PSOs that are no longer used (which
+// happens every time a shader is edited) from piling up in the file.
+static ID3D12PipelineLibrary* LoadedLibrary = nullptr;
+static Array<uint8> LoadedLibraryData;      // Needs to outlive LoadedLibrary
+static uint64 NumLoadedPipelines = 0;
+static ID3D12PipelineLibrary* SessionLibrary = nullptr;
+static uint64 NumStoredPipelines = 0;
+static bool LibraryDirty = false;
+
+static volatile int64 NumRequests = 0;
+static volatile int64 NumMemoryHits = 0;
+static PipelineCacheStats MissStats;        // Protected by PSOMapLock
+
+static std::wstring LibraryFilePath()
+{
+    return ShaderCacheDir() + L"PipelineLibrary.cache";
+}
+
+static void LoadPipelineLibrary()
+{
+    const std::wstring filePath = LibraryFilePath();
+    if(FileExists(filePath.c_str()) == false)
+        return;
+
+    Array<uint8> fileData;
+    ReadFileAsByteArray(filePath.c_str(), fileData);
+
+    LibraryFileHeader header;
+    if(fileData.Size() < sizeof(LibraryFileHeader))
+        return;
+    memcpy(&header, fileData.Data(), sizeof(LibraryFileHeader));
+
+    if(header.Magic != LibraryFileMagic || header.Version != LibraryFileVersion ||
+       header.DataSize != fileData.Size() - sizeof(LibraryFileHeader) || header.DataSize == 0)
+    {
+        WriteLog("Discarding pipeline library %ls, since it's from an incompatible version", filePath.c_str());
+        return;
+    }
+
+    if((header.CompilerHash == ShaderCompilerHash()) == false)
+    {
+        WriteLog("Discarding pipeline library %ls, since the shader compiler has changed", filePath.c_str());
+        return;
+    }
+
+    LoadedLibraryData.Init(header.DataSize);
+    memcpy(LoadedLibraryData.Data(), fileData.Data() + sizeof(LibraryFileHeader), header.DataSize);
+
+    // This fails if the driver or adapter changed since the library was saved, which just means starting over
+    HRESULT hr = Device->CreatePipelineLibrary(LoadedLibraryData.Data(), LoadedLibraryData.Size(), IID_PPV_ARGS(&LoadedLibrary));
+    if(FAILED(hr))
+    {
+        WriteLog("Discarding pipeline library %ls, since it couldn't be loaded (0x%08X)", filePath.c_str(), uint32(hr));
+        LoadedLibraryData.Shutdown();
+        return;
+    }
+
+    NumLoadedPipelines = header.NumPipelines;
+}
+
+static void SavePipelineLibrary()
+{
+    if(SessionLibrary == nullptr)
+        return;
+
+    // Nothing to do if this run used exactly what was already in the file
+    if(LibraryDirty == false && NumStoredPipelines == NumLoadedPipelines)
+        return;
+
+    LibraryFileHeader header;
+    header.CompilerHash = ShaderCompilerHash();
+    header.NumPipelines = NumStoredPipelines;
+    header.DataSize = SessionLibrary->GetSerializedSize();
+
+    Array<uint8> fileData(sizeof(LibraryFileHeader) + header.DataSize);
+    memcpy(fileData.Data(), &header, sizeof(LibraryFileHeader));
+    DXCall(SessionLibrary->Serialize(fileData.Data() + sizeof(LibraryFileHeader), header.DataSize));
+
+    EnsureShaderCacheDirExists();
+
+    const std::wstring filePath = LibraryFilePath();
+    const std::wstring tempPath = filePath + L".tmp";
+    WriteFileAsByteArray(tempPath.c_str(), fileData);
+    Win32Call(MoveFileEx(tempPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING));
+}
+
+void Initialize_PipelineCache()
+{
+    LoadPipelineLibrary();
+
+    HRESULT hr = Device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&SessionLibrary));
+    if(FAILED(hr))
+    {
+        // Some configurations (such as running under certain graphics debuggers) don't support pipeline libraries,
+        // in which case we still get the in-memory cache
+        WriteLog("Pipeline libraries aren't supported (0x%08X), PSOs won't be cached on disk", uint32(hr));
+        SessionLibrary = nullptr;
+    }
+
+    ResetPipelineCacheStats();
+}
+
+void Shutdown_PipelineCache()
+{
+    SavePipelineLibrary();
+
+    PSOMap.ForEach([](Hash, ID3D12PipelineState* pso) { pso->Release(); });
+    PSOMap.Clear();
+
+    Release(SessionLibrary);
+    Release(LoadedLibrary);
+    LoadedLibraryData.Shutdown();
+
+    NumLoadedPipelines = 0;
+    NumStoredPipelines = 0;
+    LibraryDirty = false;
+}
+
+void SetRootSignatureHash(ID3D12RootSignature* rootSignature, Hash hash)
+{
+    Assert_(rootSignature != nullptr);
+    DXCall(rootSignature->SetPrivateData(RootSignatureHashGUID, sizeof(Hash), &hash));
+}
+
+Hash GetRootSignatureHash(ID3D12RootSignature* rootSignature)
+{
+    // PSOs without a root signature get it from their shaders, which are already part of the key
+    if(rootSignature == nullptr)
+        return Hash();
+
+    Hash hash;
+    uint32 dataSize = sizeof(Hash);
+    const HRESULT hr = rootSignature->GetPrivateData(RootSignatureHashGUID, &dataSize, &hash);
+    AssertMsg_(SUCCEEDED(hr) && dataSize == sizeof(Hash),
+               "Root signature has no hash, either create it with CreateRootSignature() or call SetRootSignatureHash()");
+    DXCall(hr);
+
+    return hash;
+}
+
+static HRESULT LoadFromLibrary(const wchar* name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3D12PipelineState** pso)
+{
+    return LoadedLibrary->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(pso));
+}
+
+static HRESULT LoadFromLibrary(const wchar* name, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, ID3D12PipelineState** pso)
+{
+    return LoadedLibrary->LoadComputePipeline(name, &desc, IID_PPV_ARGS(pso));
+}
+
+static void CreatePSO(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3D12PipelineState** pso)
+{
+    DXCall(Device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pso)));
+}
+
+static void CreatePSO(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, ID3D12PipelineState** pso)
+{
+    DXCall(Device->CreateComputePipelineState(&desc, IID_PPV_ARGS(pso)));
+}
+
+template<typename TDesc> static ID3D12PipelineState* FindOrCreatePSO(const TDesc& desc, Hash key)
+{
+    InterlockedIncrement64(&NumRequests);
+
+    AcquireSRWLockShared(&PSOMapLock);
+    ID3D12PipelineState* pso = PSOMap.Find(key, CurrentCPUFrame);
+    ReleaseSRWLockShared(&PSOMapLock);
+
+    if(pso != nullptr)
+    {
+        InterlockedIncrement64(&NumMemoryHits);
+        return pso;
+    }
+
+    // Load or create outside of the lock, since this can take a while
+    const std::wstring name = key.ToString();
+    ID3D12PipelineState* newPSO = nullptr;
+    Timer timer;
+
+    const bool fromLibrary = LoadedLibrary != nullptr && SUCCEEDED(LoadFromLibrary(name.c_str(), desc, &newPSO));
+    if(fromLibrary == false)
+        CreatePSO(desc, &newPSO);
+
+    timer.Update();
+
+    AcquireSRWLockExclusive(&PSOMapLock);
+
+    pso = PSOMap.Find(key, CurrentCPUFrame);
+    if(pso == nullptr)
+    {
+        PSOMap.Insert(key, newPSO, CurrentCPUFrame);
+        pso = newPSO;
+
+        if(SessionLibrary != nullptr && SUCCEEDED(SessionLibrary->StorePipeline(name.c_str(), newPSO)))
+            NumStoredPipelines += 1;
+
+        if(fromLibrary)
+        {
+            MissStats.NumLibraryHits += 1;
+            MissStats.LibraryLoadTime += timer.ElapsedMillisecondsD();
+        }
+        else
+        {
+            MissStats.NumCreated += 1;
+            MissStats.CreateTime += timer.ElapsedMillisecondsD();
+            LibraryDirty = true;
+        }
+    }
+    else
+    {
+        // Another thread got there first
+        newPSO->Release();
+        InterlockedIncrement64(&NumMemoryHits);
+    }
+
+    ReleaseSRWLockExclusive(&PSOMapLock);
+
+    return pso;
+}
+
+ID3D12PipelineState* GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    return FindOrCreatePSO(desc, MakeGraphicsPipelineKey(GetRootSignatureHash(desc.pRootSignature), desc));
+}
+
+ID3D12PipelineState* GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, Hash key)
+{
+    return FindOrCreatePSO(desc, key);
+}
+
+ID3D12PipelineState* GetComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc)
+{
+    return FindOrCreatePSO(desc, MakeComputePipelineKey(GetRootSignatureHash(desc.pRootSignature), desc));
+}
+
+ID3D12PipelineState* GetComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, Hash key)
+{
+    return FindOrCreatePSO(desc, key);
+}
+
+void CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3D12PipelineState** pso)
+{
+    Assert_(pso != nullptr);
+    *pso = GetGraphicsPipelineState(desc);
+    (*pso)->AddRef();
+}
+
+void CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, ID3D12PipelineState** pso)
+{
+    Assert_(pso != nullptr);
+    *pso = GetComputePipelineState(desc);
+    (*pso)->AddRef();
+}
+
+// Pipeline libraries can't remove anything, so the only way to drop pruned PSOs is to start a new one
+static void RebuildSessionLibrary()
+{
+    Release(SessionLibrary);
+    NumStoredPipelines = 0;
+    LibraryDirty = true;
+
+    if(FAILED(Device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&SessionLibrary))))
+    {
+        SessionLibrary = nullptr;
+        return;
+    }
+
+    PSOMap.ForEach([](Hash key, ID3D12PipelineState* pso)
+    {
+        const std::wstring name = key.ToString();
+        if(SUCCEEDED(SessionLibrary->StorePipeline(name.c_str(), pso)))
+            NumStoredPipelines += 1;
+    });
+}
+
+uint64 PrunePipelineCache()
+{
+    AcquireSRWLockExclusive(&PSOMapLock);
+
+    const uint64 numPruned = PSOMap.RemoveIf([](Hash, ID3D12PipelineState* pso, uint64 lastUsed)
+    {
+        if(lastUsed + RenderLatency > CurrentCPUFrame)
+            return false;
+
+        // Anything that was made with Create*PipelineState() is kept until its owner releases it
+        pso->AddRef();
+        if(pso->Release() > 1)
+            return false;
+
+        DeferredRelease(pso);
+        return true;
+    });
+
+    if(numPruned > 0 && SessionLibrary != nullptr)
+        RebuildSessionLibrary();
+
+    MissStats.NumPruned += numPruned;
+
+    ReleaseSRWLockExclusive(&PSOMapLock);
+
+    return numPruned;
+}
+
+PipelineCacheStats GetPipelineCacheStats()
+{
+    AcquireSRWLockShared(&PSOMapLock);
+    PipelineCacheStats stats = MissStats;
+    ReleaseSRWLockShared(&PSOMapLock);
+
+    stats.NumRequests = uint64(NumRequests);
+    stats.NumMemoryHits = uint64(NumMemoryHits);
+    return stats;
+}
+
+void ResetPipelineCacheStats()
+{
+    AcquireSRWLockExclusive(&PSOMapLock);
+    MissStats = PipelineCacheStats();
+    NumRequests = 0;
+    NumMemoryHits = 0;
+    ReleaseSRWLockExclusive(&PSOMapLock);
+}
+
+void LogPipelineCacheStats(const char* label)
+{
+    const PipelineCacheStats stats = GetPipelineCacheStats();
+    WriteLog("PSO cache (%s, %s pipeline library): %llu requests, %llu found in memory, %llu loaded from the library in %.2fms, %llu created in %.2fms, %llu pruned",
+             label, LoadedLibrary != nullptr ? "warm" : "cold", stats.NumRequests, stats.NumMemoryHits,
+             stats.NumLibraryHits, stats.LibraryLoadTime, stats.NumCreated, stats.CreateTime, stats.NumPruned);
+}
+
+bool BenchmarkPipelineCache(uint64 numPSOs)
+{
+    Assert_(numPSOs > 0);
+
+    WriteLog("Pipeline cache benchmark (%llu PSOs)", numPSOs);
+
+    ID3D12PipelineLibrary* library = nullptr;
+    if(FAILED(Device->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&library))))
+    {
+        WriteLog("    Skipped, since pipeline libraries aren't supported");
+        return true;
+    }
+
+    const std::wstring fullScreenTriPath = SampleFrameworkDir() + L"Shaders\\FullScreenTriangle.hlsl";
+    const std::wstring smConvertPath = SampleFrameworkDir() + L"Shaders\\SMConvert.hlsl";
+    CompiledShaderPtr vs = CompileFromFile(fullScreenTriPath.c_str(), "FullScreenTriangleVS", ShaderType::Vertex);
+    CompiledShaderPtr ps = CompileFromFile(smConvertPath.c_str(), "FilterSM3x3", ShaderType::Pixel);
+
+    // Each PSO gets a different depth bias, so that they all have to be created separately
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = { };
+    psoDesc.pRootSignature = UniversalRootSignature;
+    psoDesc.VS = vs.ByteCode();
+    psoDesc.PS = ps.ByteCode();
+    psoDesc.RasterizerState = GetRasterizerState(RasterizerState::NoCull);
+    psoDesc.BlendState = GetBlendState(BlendState::Disabled);
+    psoDesc.DepthStencilState = GetDepthState(DepthState::Disabled);
+    psoDesc.SampleMask = UINT_MAX;
+    psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    psoDesc.NumRenderTargets = 1;
+    psoDesc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    psoDesc.SampleDesc.Count = 1;
+
+    Array<ID3D12PipelineState*> psos(numPSOs, nullptr);
+    Timer timer;
+
+    // Cold: the driver compiles every PSO (the driver may still have its own cache, so this is a lower bound)
+    for(uint64 i = 0; i < numPSOs; ++i)
+    {
+        psoDesc.RasterizerState.DepthBias = int32(i);
+        DXCall(Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&psos[i])));
+    }
+    timer.Update();
+    const double coldMS = timer.DeltaMillisecondsD();
+
+    for(uint64 i = 0; i < numPSOs; ++i)
+    {
+        const std::wstring name = MakeString(L"%llu", i);
+        DXCall(library->StorePipeline(name.c_str(), psos[i]));
+        Release(psos[i]);
+    }
+
+    Array<uint8> libraryData(library->GetSerializedSize());
+    DXCall(library->Serialize(libraryData.Data(), libraryData.Size()));
+    Release(library);
+
+    // Warm: the same PSOs come out of a library that was loaded from the serialized blob, like at startup
+    timer.Update();
+    DXCall(Device->CreatePipelineLibrary(libraryData.Data(), libraryData.Size(), IID_PPV_ARGS(&library)));
+    timer.Update();
+    const double openMS = timer.DeltaMillisecondsD();
+
+    uint64 numLoadFailures = 0;
+    for(uint64 i = 0; i < numPSOs; ++i)
+    {
+        psoDesc.RasterizerState.DepthBias = int32(i);
+        const std::wstring name = MakeString(L"%llu", i);
+        if(FAILED(library->LoadGraphicsPipeline(name.c_str(), &psoDesc, IID_PPV_ARGS(&psos[i]))))
+            numLoadFailures += 1;
+    }
+    timer.Update();
+    const double warmMS = timer.DeltaMillisecondsD();
+
+    for(uint64 i = 0; i < numPSOs; ++i)
+        Release(psos[i]);
+    Release(library);
+
+    WriteLog("    Cold: %.2fms (%.3fms per PSO), warm: %.2fms to open a %.1fKB library + %.2fms (%.3fms per PSO)",
+             coldMS, coldMS / numPSOs, openMS, libraryData.Size() / 1024.0, warmMS, warmMS / numPSOs);
+
+    if(numLoadFailures > 0)
+    {
+        WriteLog("    %llu of %llu PSOs couldn't be loaded from the library", numLoadFailures, numPSOs);
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace DX12
+
+} // namespace SampleFramework12
@@ -0,0 +1,78 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\MurmurHash.h"
+#include "PipelineStateMap.h"
+
+namespace SampleFramework12
+{
+
+struct PipelineCacheStats
+{
+    uint64 NumRequests = 0;
+    uint64 NumMemoryHits = 0;       // Found in the in-memory map
+    uint64 NumLibraryHits = 0;      // Loaded from the pipeline library that was saved by a previous run
+    uint64 NumCreated = 0;          // Compiled from scratch by the driver
+    double LibraryLoadTime = 0.0;   // In milliseconds
+    double CreateTime = 0.0;        // In milliseconds
+    uint64 NumPruned = 0;           // Released by PrunePipelineCache()
+};
+
+namespace DX12
+{
+
+// Lifetime
+void Initialize_PipelineCache();
+void Shutdown_PipelineCache();
+
+// Root signatures made with CreateRootSignature() remember a hash of their serialized description, which is
+// what gets used for pipeline keys. Any other root signature has to be given a hash with SetRootSignatureHash()
+// before it's used for a PSO, since its address isn't stable from run to run and can be reused by a different
+// root signature (which would hand back a stale PSO).
+void SetRootSignatureHash(ID3D12RootSignature* rootSignature, Hash hash);
+Hash GetRootSignatureHash(ID3D12RootSignature* rootSignature);
+
+// Returns a PSO from the framework-wide cache, creating it (or loading it from the on-disk pipeline library)
+// on a miss. The cache keeps the PSO alive until it's pruned (see below), so the returned pointer doesn't need to
+// be released as long as it's looked up again every frame.
+// The versions that take a key let callers skip hashing the shader byte code when they already know its hash.
+// Safe to call from multiple threads.
+ID3D12PipelineState* GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+ID3D12PipelineState* GetGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, Hash key);
+ID3D12PipelineState* GetComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc);
+ID3D12PipelineState* GetComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, Hash key);
+
+// Drop-in replacements for ID3D12Device::Create*PipelineState that go through the cache, and add a reference
+// to the returned PSO so that it can still be released with DeferredRelease()
+void CreateGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, ID3D12PipelineState** pso);
+void CreateComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc, ID3D12PipelineState** pso);
+
+// Releases every PSO that nobody else holds a reference to, and that hasn't been looked up for RenderLatency
+// frames (so that the GPU can't still be using it). The pipeline library is rebuilt from what's left, so that
+// the file saved at shutdown only has live PSOs in it. Call this after re-creating PSOs for a shader reload,
+// since otherwise every reload leaves the previous versions in memory. Returns the number of PSOs released.
+uint64 PrunePipelineCache();
+
+PipelineCacheStats GetPipelineCacheStats();
+void ResetPipelineCacheStats();
+
+// Logs the stats since the last reset, along with whether there was a pipeline library to start from
+void LogPipelineCacheStats(const char* label);
+
+// Creates the same set of PSOs through the driver (cold) and then from a pipeline library that holds them
+// (warm), and logs both times. Doesn't touch the framework's cache or its library file.
+bool BenchmarkPipelineCache(uint64 numPSOs = 64);
+
+} // namespace DX12
+
+} // namespace SampleFramework12
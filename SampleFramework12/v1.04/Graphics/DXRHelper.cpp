@@ -95,7 +95,7 @@ void BuildModelAccelStructure(ID3D12GraphicsCommandList7* cmdList, const Model&
         geometryDesc.Triangles.IndexCount = uint32(mesh.NumIndices());
         geometryDesc.Triangles.IndexFormat = idxBuffer.Format;
         geometryDesc.Triangles.Transform3x4 = 0;
-        geometryDesc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+        geometryDesc.Triangles.VertexFormat = model.VertexPositionFormat();
         geometryDesc.Triangles.VertexCount = uint32(mesh.NumVertices());
         geometryDesc.Triangles.VertexBuffer.StartAddress = vtxBuffer.GPUAddress + mesh.VertexOffset() * vtxBuffer.Stride;
         geometryDesc.Triangles.VertexBuffer.StrideInBytes = vtxBuffer.Stride;
@@ -168,7 +168,15 @@ void BuildModelAccelStructure(ID3D12GraphicsCommandList7* cmdList, const Model&
 
     // Create an instance desc for the bottom-level acceleration structure.
     D3D12_RAYTRACING_INSTANCE_DESC instanceDesc = {};
-    instanceDesc.Transform[0][0] = instanceDesc.Transform[1][1] = instanceDesc.Transform[2][2] = sceneScale;
+    // Packed positions are relative to the model's AABB, so the dequantization is folded into the instance transform
+    const Float3 positionScale = model.PositionScale() * sceneScale;
+    const Float3 positionBias = model.PositionBias() * sceneScale;
+    instanceDesc.Transform[0][0] = positionScale.x;
+    instanceDesc.Transform[1][1] = positionScale.y;
+    instanceDesc.Transform[2][2] = positionScale.z;
+    instanceDesc.Transform[0][3] = positionBias.x;
+    instanceDesc.Transform[1][3] = positionBias.y;
+    instanceDesc.Transform[2][3] = positionBias.z;
     instanceDesc.InstanceMask = 1;
     instanceDesc.AccelerationStructure = output.BottomLevelAccelStructure.GPUAddress;
 
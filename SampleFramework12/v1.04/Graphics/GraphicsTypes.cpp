@@ -14,6 +14,7 @@
 #include "..\\Utility.h"
 #include "..\\Serialization.h"
 #include "..\\FileIO.h"
+#include "..\\SF12_Math.h"
 
 namespace SampleFramework12
 {
@@ -449,6 +450,11 @@ bool Buffer::ReadyForBinding() const
 
 void ConstantBuffer::Initialize(const ConstantBufferInit& init)
 {
+    InternalBuffer.Shutdown();
+
+    // The new buffer doesn't have what the shadows say it has, even if it's the same size as the old one
+    PatchShadowValidMask = 0;
+
     InternalBuffer.Initialize({
         .Size = init.Size,
         .Alignment = DX12::ConstantBufferAlignment,
@@ -466,6 +472,8 @@ void ConstantBuffer::Initialize(const ConstantBufferInit& init)
 void ConstantBuffer::Shutdown()
 {
     InternalBuffer.Shutdown();
+    PatchShadow.Shutdown();
+    PatchShadowValidMask = 0;
 }
 
 void ConstantBuffer::SetAsGfxRootParameter(ID3D12GraphicsCommandList* cmdList, uint32 rootParameter) const
@@ -484,9 +492,19 @@ void* ConstantBuffer::Map()
 {
     MapResult mapResult = InternalBuffer.Map();
     CurrentGPUAddress = mapResult.GPUAddress;
+
+    // Whatever the caller writes isn't tracked, so the next patch to this version needs to copy everything
+    PatchShadowValidMask &= ~(1ull << InternalBuffer.CurrBuffer);
+
     return mapResult.CPUAddress;
 }
 
+const void* ConstantBuffer::MappedData() const
+{
+    Assert_(InternalBuffer.CPUAccessible);
+    return InternalBuffer.CPUAddress + InternalBuffer.CurrBuffer * InternalBuffer.Size;
+}
+
 void ConstantBuffer::MapAndSetData(const void* data, uint64 dataSize)
 {
     Assert_(dataSize <= InternalBuffer.Size);
@@ -499,6 +517,161 @@ void ConstantBuffer::QueueUpload(ID3D12Resource* srcResource, uint64 srcOffset,
     CurrentGPUAddress = InternalBuffer.QueueUpload(srcResource, srcOffset, srcSize, dstOffset);
 }
 
+uint64 ConstantBuffer::MapAndPatchData(const void* data, uint64 dataSize)
+{
+    Assert_(dataSize <= InternalBuffer.Size);
+
+    const uint64 bufferSize = InternalBuffer.Size;
+    if(PatchShadow.Size() != bufferSize * DX12::RenderLatency)
+    {
+        PatchShadow.Init(bufferSize * DX12::RenderLatency);
+        PatchShadowValidMask = 0;
+    }
+
+    MapResult mapResult = InternalBuffer.Map();
+    CurrentGPUAddress = mapResult.GPUAddress;
+
+    const uint64 version = InternalBuffer.CurrBuffer;
+    uint8* dst = reinterpret_cast<uint8*>(mapResult.CPUAddress);
+    uint8* shadow = PatchShadow.Data() + version * bufferSize;
+    const uint8* src = reinterpret_cast<const uint8*>(data);
+
+    const uint64 versionBit = 1ull << version;
+    if((PatchShadowValidMask & versionBit) == 0)
+    {
+        // First time writing to this version, so there's nothing to compare against
+        memcpy(dst, src, dataSize);
+        memcpy(shadow, src, dataSize);
+        PatchShadowValidMask |= versionBit;
+        return dataSize;
+    }
+
+    return PatchChangedRanges(dst, shadow, src, dataSize);
+}
+
+uint64 PatchChangedRanges(uint8* dst, uint8* shadow, const uint8* src, uint64 size)
+{
+    const uint64 BlockSize = 16;
+    const uint64 numBlocks = (size + BlockSize - 1) / BlockSize;
+
+    uint64 numBytesWritten = 0;
+    uint64 blockIdx = 0;
+    while(blockIdx < numBlocks)
+    {
+        const uint64 rangeStart = blockIdx * BlockSize;
+        if(memcmp(shadow + rangeStart, src + rangeStart, Min(BlockSize, size - rangeStart)) == 0)
+        {
+            ++blockIdx;
+            continue;
+        }
+
+        // Extend the range over any blocks that also changed, so that each run is a single copy
+        uint64 rangeEnd = Min(rangeStart + BlockSize, size);
+        ++blockIdx;
+        while(blockIdx < numBlocks)
+        {
+            const uint64 blockStart = blockIdx * BlockSize;
+            const uint64 blockEnd = Min(blockStart + BlockSize, size);
+            if(memcmp(shadow + blockStart, src + blockStart, blockEnd - blockStart) == 0)
+                break;
+
+            rangeEnd = blockEnd;
+            ++blockIdx;
+        }
+
+        const uint64 rangeSize = rangeEnd - rangeStart;
+        memcpy(dst + rangeStart, src + rangeStart, rangeSize);
+        memcpy(shadow + rangeStart, src + rangeStart, rangeSize);
+        numBytesWritten += rangeSize;
+    }
+
+    return numBytesWritten;
+}
+
+bool ValidateConstantBufferPatching(uint64 numIterations)
+{
+    // Sizes that cover a single register, a partial trailing register, and a typical settings buffer. Everything up
+    // to 256 bytes shares the same aligned size, so this re-initializes with both the same and a different size.
+    static const uint64 DataSizes[] = { 4, 16, 52, 52, 256, 1000, 256 };
+
+    // Nothing else uses this buffer, so once the GPU is idle it's fine to cycle through its versions more than once
+    // per frame (which Buffer::CycleBuffer() normally asserts on)
+    DX12::FlushGPU();
+
+    Random rng;
+    uint64 numUpdates = 0;
+    uint64 numSkipped = 0;
+    uint64 numMapWrites = 0;
+    uint64 numMismatches = 0;
+    uint64 numBytesPatched = 0;
+    uint64 numBytesFull = 0;
+
+    ConstantBuffer cb;
+    Array<uint8> data;
+
+    for(uint64 dataSize : DataSizes)
+    {
+        // The data is kept when the size repeats, which is when stale patch shadows would go unnoticed
+        if(data.Size() != dataSize)
+            data.Init(dataSize, 0);
+
+        // No Shutdown() in between, so that MapAndPatchData() has to notice the new size on its own
+        ConstantBufferInit cbInit;
+        cbInit.Size = dataSize;
+        cbInit.Name = L"Patch Validation Constant Buffer";
+        cb.Initialize(cbInit);
+
+        bool forceUpdate = true;
+        for(uint64 iteration = 0; iteration < numIterations; ++iteration)
+        {
+            // Edit a random number of values, which is often none at all (just like settings from one frame to the next)
+            const uint32 numEdits = rng.RandomUint() % 4 == 0 ? rng.RandomUint() % 8 : 0;
+            for(uint32 editIdx = 0; editIdx < numEdits; ++editIdx)
+            {
+                const uint64 offset = rng.RandomUint() % dataSize;
+                const uint64 editSize = Min<uint64>(1 + rng.RandomUint() % 12, dataSize - offset);
+                for(uint64 i = 0; i < editSize; ++i)
+                    data[offset + i] = uint8(rng.RandomUint());
+            }
+
+            // Writing through Map() isn't tracked, so the next patch to that version has to copy everything
+            if(rng.RandomUint() % 32 == 0)
+            {
+                cb.InternalBuffer.UploadFrame = uint64(-1);
+                memset(cb.Map(), 0xCD, dataSize);
+                ++numMapWrites;
+                forceUpdate = true;
+            }
+
+            // Mirrors UpdateCBuffer() in the generated settings code, which skips the update when nothing changed
+            if(numEdits == 0 && forceUpdate == false)
+            {
+                if(memcmp(cb.MappedData(), data.Data(), dataSize) != 0)
+                    ++numMismatches;
+                ++numSkipped;
+                continue;
+            }
+
+            cb.InternalBuffer.UploadFrame = uint64(-1);
+            numBytesPatched += cb.MapAndPatchData(data.Data(), dataSize);
+            numBytesFull += dataSize;
+            ++numUpdates;
+            forceUpdate = false;
+
+            if(memcmp(cb.MappedData(), data.Data(), dataSize) != 0)
+                ++numMismatches;
+        }
+    }
+
+    cb.Shutdown();
+
+    WriteLog("Constant buffer patching: %llu updates, %llu skipped, %llu writes through Map(), %llu didn't match a full copy, "
+             "%.1f%% of the bytes written", numUpdates, numSkipped, numMapWrites, numMismatches,
+             numBytesFull > 0 ? double(numBytesPatched) * 100.0 / double(numBytesFull) : 0.0);
+
+    return numMismatches == 0;
+}
+
 // == StructuredBuffer ============================================================================
 
 void StructuredBuffer::Initialize(const StructuredBufferInit& init)
@@ -1131,10 +1304,18 @@ void RenderTexture::Initialize(const RenderTextureInit& init)
     D3D12_CLEAR_VALUE clearValue = { };
     clearValue.Format = init.Format;
 
-    DXCall(DX12::Device->CreateCommittedResource3(DX12::GetDefaultHeapProps(), D3D12_HEAP_FLAG_NONE, &textureDesc,
-                                                  init.InitialLayout, init.CreateRTV ? &clearValue : nullptr, nullptr, 0, nullptr,
-                                                  IID_PPV_ARGS(&Texture.Resource)));
-
+    if(init.Heap)
+    {
+        DXCall(DX12::Device->CreatePlacedResource2(init.Heap, init.HeapOffset, &textureDesc, init.InitialLayout,
+                                                   init.CreateRTV ? &clearValue : nullptr, 0, nullptr,
+                                                   IID_PPV_ARGS(&Texture.Resource)));
+    }
+    else
+    {
+        DXCall(DX12::Device->CreateCommittedResource3(DX12::GetDefaultHeapProps(), D3D12_HEAP_FLAG_NONE, &textureDesc,
+                                                      init.InitialLayout, init.CreateRTV ? &clearValue : nullptr, nullptr, 0, nullptr,
+                                                      IID_PPV_ARGS(&Texture.Resource)));
+    }
 
     if(init.Name != nullptr)
         Texture.Resource->SetName(init.Name);
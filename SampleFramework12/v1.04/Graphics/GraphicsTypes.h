@@ -182,8 +182,30 @@ struct ConstantBuffer
     void MapAndSetData(const void* data, uint64 dataSize);
     template<typename T> void MapAndSetData(const T& data) { MapAndSetData(&data, sizeof(T)); }
     void QueueUpload(ID3D12Resource* srcResource, uint64 srcOffset, uint64 srcSize, uint64 dstOffset);
+
+    // Like MapAndSetData(), except that only the 16-byte registers that differ from what was last written to the
+    // version of the buffer being cycled to get copied. Returns the number of bytes that were written.
+    uint64 MapAndPatchData(const void* data, uint64 dataSize);
+    template<typename T> uint64 MapAndPatchData(const T& data) { return MapAndPatchData(&data, sizeof(T)); }
+
+    // The version of the buffer that was last mapped. Reading from the upload heap is slow, so this is only for checks.
+    const void* MappedData() const;
+
+    // CPU copies of each version's contents, since reading back from the upload heap is slow
+    Array<uint8> PatchShadow;
+    uint64 PatchShadowValidMask = 0;
 };
 
+// Copies the 16-byte blocks of src that differ from shadow into both dst and shadow, merging neighboring blocks
+// into a single copy. Returns the number of bytes that were written to dst.
+uint64 PatchChangedRanges(uint8* dst, uint8* shadow, const uint8* src, uint64 size);
+
+// Applies random edit sequences to constant buffer data and uploads them through MapAndPatchData() on a real
+// constant buffer, checking the bound version against a full copy of the data after every update. Also scribbles
+// over versions through Map(), and re-initializes the buffer with different sizes, to check that the patch shadows
+// get invalidated. Logs the results, and returns false if any version didn't match.
+bool ValidateConstantBufferPatching(uint64 numIterations = 10000);
+
 struct StructuredBufferInit
 {
     uint64 Stride = 0;
@@ -397,6 +419,8 @@ struct RenderTextureInit
     bool32 CubeMap = false;
     uint32 NumMips = 1;
     D3D12_BARRIER_LAYOUT InitialLayout = D3D12_BARRIER_LAYOUT_UNDEFINED;
+    ID3D12Heap* Heap = nullptr;     // Creates a placed resource instead of a committed one
+    uint64 HeapOffset = 0;
     const wchar* Name = nullptr;
 };
 
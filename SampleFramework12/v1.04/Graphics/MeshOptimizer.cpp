@@ -0,0 +1,628 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "MeshOptimizer.h"
+#include "..\\Timer.h"
+
+namespace SampleFramework12
+{
+
+// Triangle adjacency for each vertex, stored as offsets into a single flat list
+struct VertexTriangleAdjacency
+{
+    Array<uint32> Offsets;
+    Array<uint32> Counts;
+    Array<uint32> Triangles;
+
+    void Init(const uint32* indices, uint64 numIndices, uint64 numVertices)
+    {
+        const uint64 numTriangles = numIndices / 3;
+
+        Counts.Init(numVertices, 0);
+        for(uint64 i = 0; i < numIndices; ++i)
+        {
+            Assert_(indices[i] < numVertices);
+            Counts[indices[i]] += 1;
+        }
+
+        Offsets.Init(numVertices);
+        uint32 offset = 0;
+        for(uint64 v = 0; v < numVertices; ++v)
+        {
+            Offsets[v] = offset;
+            offset += Counts[v];
+        }
+
+        Triangles.Init(numIndices);
+        Array<uint32> fillCounts(numVertices, 0);
+        for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+        {
+            for(uint64 i = 0; i < 3; ++i)
+            {
+                const uint32 v = indices[triIdx * 3 + i];
+                Triangles[Offsets[v] + fillCounts[v]] = uint32(triIdx);
+                fillCounts[v] += 1;
+            }
+        }
+    }
+};
+
+VertexCacheStats AnalyzeVertexCache(const uint32* indices, uint64 numIndices, uint64 numVertices, uint32 cacheSize)
+{
+    Assert_(numIndices % 3 == 0);
+    Assert_(cacheSize > 0);
+
+    VertexCacheStats stats;
+    stats.NumTriangles = numIndices / 3;
+    if(numIndices == 0)
+        return stats;
+
+    // A FIFO cache can be simulated with a timestamp per vertex, since a vertex is only
+    // evicted once cacheSize other vertices have been inserted after it
+    Array<uint64> cacheTimeStamps(numVertices, 0);
+    uint64 timeStamp = cacheSize + 1;
+
+    for(uint64 i = 0; i < numIndices; ++i)
+    {
+        const uint32 v = indices[i];
+        Assert_(v < numVertices);
+
+        if(cacheTimeStamps[v] == 0)
+            stats.NumReferencedVertices += 1;
+
+        if(timeStamp - cacheTimeStamps[v] > cacheSize)
+        {
+            cacheTimeStamps[v] = timeStamp++;
+            stats.NumTransformedVertices += 1;
+        }
+    }
+
+    stats.ACMR = float(stats.NumTransformedVertices) / float(stats.NumTriangles);
+    stats.ATVR = float(stats.NumTransformedVertices) / float(stats.NumReferencedVertices);
+
+    return stats;
+}
+
+void OptimizeVertexCache(uint32* indices, uint64 numIndices, uint64 numVertices, uint32 cacheSize, List<uint32>* clusterStarts)
+{
+    Assert_(numIndices % 3 == 0);
+    Assert_(cacheSize > 0);
+
+    if(clusterStarts != nullptr)
+        clusterStarts->RemoveAll();
+
+    const uint64 numTriangles = numIndices / 3;
+    if(numTriangles == 0)
+        return;
+
+    VertexTriangleAdjacency adjacency;
+    adjacency.Init(indices, numIndices, numVertices);
+
+    Array<uint32> liveTriangles(numVertices);
+    for(uint64 v = 0; v < numVertices; ++v)
+        liveTriangles[v] = adjacency.Counts[v];
+
+    Array<uint64> cacheTimeStamps(numVertices, 0);
+    Array<bool> emitted(numTriangles, false);
+    List<uint32> deadEndStack(numIndices);
+    List<uint32> candidates(64);
+
+    Array<uint32> output(numIndices);
+    uint64 numOutputTriangles = 0;
+
+    uint64 timeStamp = cacheSize + 1;
+    uint64 cursor = 0;
+
+    // Returns the next vertex that still has triangles left, first from the dead-end stack
+    // (recently used vertices) and then by scanning forward through the vertices in order
+    auto skipDeadEnd = [&]() -> int64
+    {
+        while(deadEndStack.Count() > 0)
+        {
+            const uint32 v = deadEndStack[deadEndStack.Count() - 1];
+            deadEndStack.Remove(deadEndStack.Count() - 1);
+            if(liveTriangles[v] > 0)
+                return v;
+        }
+
+        while(cursor < numVertices)
+        {
+            if(liveTriangles[cursor] > 0)
+                return int64(cursor);
+            ++cursor;
+        }
+
+        return -1;
+    };
+
+    int64 fanningVertex = skipDeadEnd();
+    bool startCluster = true;
+    while(fanningVertex >= 0)
+    {
+        if(startCluster && clusterStarts != nullptr)
+            clusterStarts->Add(uint32(numOutputTriangles));
+
+        // Emit all remaining triangles around the fanning vertex
+        candidates.RemoveAll();
+        const uint32 adjOffset = adjacency.Offsets[fanningVertex];
+        const uint32 adjCount = adjacency.Counts[fanningVertex];
+        for(uint32 adjIdx = 0; adjIdx < adjCount; ++adjIdx)
+        {
+            const uint32 triIdx = adjacency.Triangles[adjOffset + adjIdx];
+            if(emitted[triIdx])
+                continue;
+
+            for(uint64 i = 0; i < 3; ++i)
+            {
+                const uint32 v = indices[triIdx * 3 + i];
+                output[numOutputTriangles * 3 + i] = v;
+                deadEndStack.Add(v);
+                candidates.Add(v);
+                liveTriangles[v] -= 1;
+
+                if(timeStamp - cacheTimeStamps[v] > cacheSize)
+                    cacheTimeStamps[v] = timeStamp++;
+            }
+
+            emitted[triIdx] = true;
+            ++numOutputTriangles;
+        }
+
+        // Pick the candidate that will still be in the cache after its remaining triangles are
+        // emitted, preferring the oldest one so that it's used before it gets evicted
+        int64 bestVertex = -1;
+        int64 bestPriority = -1;
+        for(uint32 v : candidates)
+        {
+            if(liveTriangles[v] == 0)
+                continue;
+
+            int64 priority = 0;
+            const int64 age = int64(timeStamp - cacheTimeStamps[v]);
+            if(age + 2 * int64(liveTriangles[v]) <= int64(cacheSize))
+                priority = age;
+
+            if(priority > bestPriority)
+            {
+                bestPriority = priority;
+                bestVertex = v;
+            }
+        }
+
+        // Falling back to a dead-end means that the cache is effectively flushed, which
+        // gives us a natural place to break up the mesh into clusters
+        startCluster = bestVertex < 0;
+        if(startCluster)
+            bestVertex = skipDeadEnd();
+
+        fanningVertex = bestVertex;
+    }
+
+    Assert_(numOutputTriangles == numTriangles);
+    memcpy(indices, output.Data(), numIndices * sizeof(uint32));
+}
+
+void SplitClusters(const uint32* indices, uint64 numIndices, uint64 numVertices, uint32 cacheSize,
+                   float acmrThreshold, List<uint32>& clusterStarts)
+{
+    Assert_(numIndices % 3 == 0);
+    Assert_(cacheSize > 0);
+
+    const uint64 numTriangles = numIndices / 3;
+    if(numTriangles == 0)
+        return;
+
+    // The existing cluster starts come from cache flushes, so they're always kept
+    List<uint32> hardStarts = clusterStarts;
+    if(hardStarts.Count() == 0)
+        hardStarts.Add(0);
+    Assert_(hardStarts[0] == 0);
+
+    clusterStarts.RemoveAll();
+
+    Array<uint64> cacheTimeStamps(numVertices, 0);
+    uint64 timeStamp = cacheSize + 1;
+    uint64 nextHardStart = 0;
+    uint64 clusterMisses = 0;
+    uint64 clusterTriangles = 0;
+    bool startCluster = true;
+
+    for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+    {
+        if(nextHardStart < hardStarts.Count() && hardStarts[nextHardStart] == triIdx)
+        {
+            startCluster = true;
+            ++nextHardStart;
+        }
+
+        if(startCluster)
+        {
+            // Moving the timestamp forward by the cache size evicts everything
+            clusterStarts.Add(uint32(triIdx));
+            timeStamp += cacheSize;
+            clusterMisses = 0;
+            clusterTriangles = 0;
+            startCluster = false;
+        }
+
+        for(uint64 i = 0; i < 3; ++i)
+        {
+            const uint32 v = indices[triIdx * 3 + i];
+            if(timeStamp - cacheTimeStamps[v] > cacheSize)
+            {
+                cacheTimeStamps[v] = timeStamp++;
+                clusterMisses += 1;
+            }
+        }
+
+        clusterTriangles += 1;
+        if(float(clusterMisses) <= acmrThreshold * float(clusterTriangles))
+            startCluster = true;
+    }
+
+    Assert_(nextHardStart == hardStarts.Count());
+}
+
+void OptimizeOverdraw(uint32* indices, uint64 numIndices, const MeshVertex* vertices, uint64 numVertices,
+                      const List<uint32>& clusterStarts)
+{
+    const uint64 numTriangles = numIndices / 3;
+    const uint64 numClusters = clusterStarts.Count();
+    if(numClusters <= 1)
+        return;
+
+    struct ClusterSortKey
+    {
+        float Metric;
+        uint32 ClusterIdx;
+    };
+
+    Array<Float3> clusterCentroids(numClusters);
+    Array<Float3> clusterNormals(numClusters);
+
+    // Area-weighted centroid and normal for each cluster, as well as for the whole mesh
+    Float3 meshCentroid;
+    float meshArea = 0.0f;
+    for(uint64 clusterIdx = 0; clusterIdx < numClusters; ++clusterIdx)
+    {
+        const uint64 triStart = clusterStarts[clusterIdx];
+        const uint64 triEnd = clusterIdx + 1 < numClusters ? clusterStarts[clusterIdx + 1] : numTriangles;
+
+        Float3 centroid;
+        Float3 normal;
+        float area = 0.0f;
+        for(uint64 triIdx = triStart; triIdx < triEnd; ++triIdx)
+        {
+            const Float3& p0 = vertices[indices[triIdx * 3 + 0]].Position;
+            const Float3& p1 = vertices[indices[triIdx * 3 + 1]].Position;
+            const Float3& p2 = vertices[indices[triIdx * 3 + 2]].Position;
+
+            const Float3 triNormal = Float3::Cross(p1 - p0, p2 - p0);
+            const float triArea = triNormal.Length();
+
+            centroid += (p0 + p1 + p2) * (triArea / 3.0f);
+            normal += triNormal;
+            area += triArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea += area;
+
+        clusterCentroids[clusterIdx] = area > 0.0f ? centroid / area : centroid;
+        clusterNormals[clusterIdx] = normal.Length() > 0.0f ? Float3::Normalize(normal) : normal;
+    }
+
+    if(meshArea > 0.0f)
+        meshCentroid /= meshArea;
+
+    // Clusters that are far out along their normal are likely to occlude the rest of the mesh
+    Array<ClusterSortKey> sortKeys(numClusters);
+    for(uint64 clusterIdx = 0; clusterIdx < numClusters; ++clusterIdx)
+    {
+        sortKeys[clusterIdx].Metric = Float3::Dot(clusterCentroids[clusterIdx] - meshCentroid, clusterNormals[clusterIdx]);
+        sortKeys[clusterIdx].ClusterIdx = uint32(clusterIdx);
+    }
+
+    std::stable_sort(sortKeys.begin(), sortKeys.end(), [](const ClusterSortKey& a, const ClusterSortKey& b)
+    {
+        return a.Metric > b.Metric;
+    });
+
+    Array<uint32> output(numIndices);
+    uint64 numOutputIndices = 0;
+    for(const ClusterSortKey& key : sortKeys)
+    {
+        const uint64 clusterIdx = key.ClusterIdx;
+        const uint64 triStart = clusterStarts[clusterIdx];
+        const uint64 triEnd = clusterIdx + 1 < numClusters ? clusterStarts[clusterIdx + 1] : numTriangles;
+        const uint64 numClusterIndices = (triEnd - triStart) * 3;
+
+        memcpy(&output[numOutputIndices], &indices[triStart * 3], numClusterIndices * sizeof(uint32));
+        numOutputIndices += numClusterIndices;
+    }
+
+    Assert_(numOutputIndices == numIndices);
+    memcpy(indices, output.Data(), numIndices * sizeof(uint32));
+}
+
+void OptimizeVertexFetch(MeshVertex* vertices, uint64 numVertices, uint32* indices, uint64 numIndices)
+{
+    if(numVertices == 0)
+        return;
+
+    Array<uint32> remap(numVertices, uint32(-1));
+    uint32 nextVertex = 0;
+    for(uint64 i = 0; i < numIndices; ++i)
+    {
+        uint32& newIdx = remap[indices[i]];
+        if(newIdx == uint32(-1))
+            newIdx = nextVertex++;
+
+        indices[i] = newIdx;
+    }
+
+    // Keep unreferenced vertices around at the end, so that the vertex count doesn't change
+    for(uint64 v = 0; v < numVertices; ++v)
+    {
+        if(remap[v] == uint32(-1))
+            remap[v] = nextVertex++;
+    }
+
+    Array<MeshVertex> reordered(numVertices);
+    for(uint64 v = 0; v < numVertices; ++v)
+        reordered[remap[v]] = vertices[v];
+
+    memcpy(vertices, reordered.Data(), numVertices * sizeof(MeshVertex));
+}
+
+MeshOptimizationStats OptimizeMesh(MeshVertex* vertices, uint64 numVertices, uint32* indices, uint64 numIndices,
+                                   uint32 cacheSize, float clusterACMRThreshold)
+{
+    MeshOptimizationStats stats;
+
+    Timer timer;
+
+    stats.Before = AnalyzeVertexCache(indices, numIndices, numVertices, cacheSize);
+
+    List<uint32> clusterStarts;
+    OptimizeVertexCache(indices, numIndices, numVertices, cacheSize, &clusterStarts);
+    SplitClusters(indices, numIndices, numVertices, cacheSize, clusterACMRThreshold, clusterStarts);
+    OptimizeOverdraw(indices, numIndices, vertices, numVertices, clusterStarts);
+    OptimizeVertexFetch(vertices, numVertices, indices, numIndices);
+
+    stats.After = AnalyzeVertexCache(indices, numIndices, numVertices, cacheSize);
+    stats.NumClusters = clusterStarts.Count();
+
+    timer.Update();
+    stats.TimeMS = timer.ElapsedMillisecondsD();
+
+    return stats;
+}
+
+// Builds a grid of gridSize x gridSize quads in the XZ plane, with the vertices at integer coordinates.
+// The triangles and vertices are both shuffled, so that the input has no locality at all.
+static void MakeShuffledGrid(uint64 gridSize, uint32 seed, Array<MeshVertex>& vertices, Array<uint32>& indices)
+{
+    const uint64 rowSize = gridSize + 1;
+    const uint64 numVertices = rowSize * rowSize;
+    const uint64 numTriangles = gridSize * gridSize * 2;
+
+    Random rng;
+    rng.SeedWithValue(seed);
+
+    Array<uint32> vertexOrder(numVertices);
+    for(uint64 v = 0; v < numVertices; ++v)
+        vertexOrder[v] = uint32(v);
+    Shuffle(vertexOrder.Data(), numVertices, rng);
+
+    vertices.Init(numVertices);
+    for(uint64 z = 0; z < rowSize; ++z)
+    {
+        for(uint64 x = 0; x < rowSize; ++x)
+        {
+            const Float3 position = Float3(float(x), 0.0f, float(z));
+            vertices[vertexOrder[z * rowSize + x]] = MeshVertex(position, Float3(0.0f, 1.0f, 0.0f), Float2(float(x), float(z)),
+                                                                Float3(1.0f, 0.0f, 0.0f), Float3(0.0f, 0.0f, 1.0f));
+        }
+    }
+
+    Array<uint32> triangleOrder(numTriangles);
+    for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+        triangleOrder[triIdx] = uint32(triIdx);
+    Shuffle(triangleOrder.Data(), numTriangles, rng);
+
+    indices.Init(numTriangles * 3);
+    for(uint64 z = 0; z < gridSize; ++z)
+    {
+        for(uint64 x = 0; x < gridSize; ++x)
+        {
+            const uint32 v00 = vertexOrder[z * rowSize + x];
+            const uint32 v10 = vertexOrder[z * rowSize + x + 1];
+            const uint32 v01 = vertexOrder[(z + 1) * rowSize + x];
+            const uint32 v11 = vertexOrder[(z + 1) * rowSize + x + 1];
+
+            const uint64 quadIdx = z * gridSize + x;
+            uint32* tri0 = &indices[triangleOrder[quadIdx * 2 + 0] * 3];
+            uint32* tri1 = &indices[triangleOrder[quadIdx * 2 + 1] * 3];
+            tri0[0] = v00; tri0[1] = v01; tri0[2] = v10;
+            tri1[0] = v10; tri1[1] = v01; tri1[2] = v11;
+        }
+    }
+}
+
+// Sorted list of triangles in terms of grid coordinates, rotated so that the smallest vertex comes
+// first. This identifies the triangles and their winding regardless of the triangle/vertex order.
+static void GetGridTriangleKeys(uint64 gridSize, const MeshVertex* vertices, const uint32* indices, uint64 numIndices,
+                                Array<uint64>& keys)
+{
+    const uint64 rowSize = gridSize + 1;
+    const uint64 numTriangles = numIndices / 3;
+
+    keys.Init(numTriangles);
+    for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+    {
+        uint64 gridVertices[3] = { };
+        for(uint64 i = 0; i < 3; ++i)
+        {
+            const Float3& position = vertices[indices[triIdx * 3 + i]].Position;
+            gridVertices[i] = uint64(position.z) * rowSize + uint64(position.x);
+        }
+
+        uint64 first = 0;
+        if(gridVertices[1] < gridVertices[first])
+            first = 1;
+        if(gridVertices[2] < gridVertices[first])
+            first = 2;
+
+        keys[triIdx] = (gridVertices[first] << 42) | (gridVertices[(first + 1) % 3] << 21) | gridVertices[(first + 2) % 3];
+    }
+
+    std::sort(keys.begin(), keys.end());
+}
+
+bool ValidateMeshOptimizer()
+{
+    const uint64 gridSize = 64;
+    Array<MeshVertex> vertices;
+    Array<uint32> indices;
+    MakeShuffledGrid(gridSize, 30, vertices, indices);
+
+    const uint64 numVertices = vertices.Size();
+    const uint64 numIndices = indices.Size();
+    const uint64 numTriangles = numIndices / 3;
+
+    Array<uint64> keysBefore;
+    GetGridTriangleKeys(gridSize, vertices.Data(), indices.Data(), numIndices, keysBefore);
+
+    bool passed = true;
+
+    // Cluster splitting on its own: the clusters must tile the triangles in order, and
+    // a connected grid has to end up with more than the single cluster from Tipsify
+    Array<uint32> tipsifyIndices = indices;
+    List<uint32> clusterStarts;
+    OptimizeVertexCache(tipsifyIndices.Data(), numIndices, numVertices, DefaultVertexCacheSize, &clusterStarts);
+    const uint64 numTipsifyClusters = clusterStarts.Count();
+    SplitClusters(tipsifyIndices.Data(), numIndices, numVertices, DefaultVertexCacheSize, DefaultClusterACMRThreshold, clusterStarts);
+
+    if(clusterStarts.Count() == 0 || clusterStarts[0] != 0)
+    {
+        WriteLog("SplitClusters didn't start a cluster at the first triangle");
+        passed = false;
+    }
+
+    for(uint64 i = 1; i < clusterStarts.Count(); ++i)
+    {
+        if(clusterStarts[i] <= clusterStarts[i - 1] || clusterStarts[i] >= numTriangles)
+        {
+            WriteLog("Cluster %llu starts at triangle %u, after the previous one at %u", i, clusterStarts[i], clusterStarts[i - 1]);
+            passed = false;
+            break;
+        }
+    }
+
+    if(clusterStarts.Count() <= numTipsifyClusters || clusterStarts.Count() < numTriangles / 256)
+    {
+        WriteLog("SplitClusters produced %llu clusters from %llu for %llu triangles", clusterStarts.Count(), numTipsifyClusters, numTriangles);
+        passed = false;
+    }
+
+    // The full pipeline must only permute the triangles and vertices
+    const MeshOptimizationStats stats = OptimizeMesh(vertices.Data(), numVertices, indices.Data(), numIndices);
+
+    Array<uint64> keysAfter;
+    GetGridTriangleKeys(gridSize, vertices.Data(), indices.Data(), numIndices, keysAfter);
+    for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+    {
+        if(keysBefore[triIdx] != keysAfter[triIdx])
+        {
+            WriteLog("The optimized index buffer doesn't contain the same triangles as the original");
+            passed = false;
+            break;
+        }
+    }
+
+    Array<bool> usedVertices(numVertices, false);
+    for(uint64 v = 0; v < numVertices; ++v)
+    {
+        const Float3& position = vertices[v].Position;
+        const uint64 gridVertex = uint64(position.z) * (gridSize + 1) + uint64(position.x);
+        if(usedVertices[gridVertex] || vertices[v].UV.x != position.x || vertices[v].UV.y != position.z)
+        {
+            WriteLog("Vertex %llu was duplicated or corrupted by the optimizer", v);
+            passed = false;
+            break;
+        }
+        usedVertices[gridVertex] = true;
+    }
+
+    // Splitting shouldn't undo most of what Tipsify gains over the shuffled input
+    if(stats.NumClusters != clusterStarts.Count() || stats.After.ACMR > 0.8f || stats.After.ACMR >= stats.Before.ACMR)
+    {
+        WriteLog("Unexpected optimizer results: %llu clusters, ACMR %.3f -> %.3f", stats.NumClusters, stats.Before.ACMR, stats.After.ACMR);
+        passed = false;
+    }
+
+    WriteLog("Mesh optimizer: %llu triangles, %llu clusters, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+             numTriangles, stats.NumClusters, stats.Before.ACMR, stats.After.ACMR, stats.Before.ATVR, stats.After.ATVR);
+
+    return passed;
+}
+
+bool BenchmarkMeshOptimizer(uint64 gridSize)
+{
+    Array<MeshVertex> vertices;
+    Array<uint32> indices;
+    MakeShuffledGrid(gridSize, 30, vertices, indices);
+
+    const uint64 numVertices = vertices.Size();
+    const uint64 numIndices = indices.Size();
+
+    Timer timer;
+
+    const VertexCacheStats before = AnalyzeVertexCache(indices.Data(), numIndices, numVertices);
+    timer.Update();
+    const double analyzeTime = timer.DeltaMillisecondsD();
+
+    List<uint32> clusterStarts;
+    OptimizeVertexCache(indices.Data(), numIndices, numVertices, DefaultVertexCacheSize, &clusterStarts);
+    timer.Update();
+    const double vertexCacheTime = timer.DeltaMillisecondsD();
+
+    const uint64 numTipsifyClusters = clusterStarts.Count();
+    const VertexCacheStats afterTipsify = AnalyzeVertexCache(indices.Data(), numIndices, numVertices);
+    timer.Update();
+
+    SplitClusters(indices.Data(), numIndices, numVertices, DefaultVertexCacheSize, DefaultClusterACMRThreshold, clusterStarts);
+    timer.Update();
+    const double splitTime = timer.DeltaMillisecondsD();
+
+    OptimizeOverdraw(indices.Data(), numIndices, vertices.Data(), numVertices, clusterStarts);
+    timer.Update();
+    const double overdrawTime = timer.DeltaMillisecondsD();
+
+    OptimizeVertexFetch(vertices.Data(), numVertices, indices.Data(), numIndices);
+    timer.Update();
+    const double vertexFetchTime = timer.DeltaMillisecondsD();
+
+    const VertexCacheStats after = AnalyzeVertexCache(indices.Data(), numIndices, numVertices);
+
+    WriteLog("Mesh optimizer: %llu triangles, %llu vertices", numIndices / 3, numVertices);
+    WriteLog("    Analyze: %.2fms", analyzeTime);
+    WriteLog("    Vertex cache: %.2fms (ACMR %.3f -> %.3f, %llu clusters)", vertexCacheTime, before.ACMR, afterTipsify.ACMR, numTipsifyClusters);
+    WriteLog("    Split clusters: %.2fms (%llu clusters)", splitTime, clusterStarts.Count());
+    WriteLog("    Overdraw: %.2fms (ACMR %.3f)", overdrawTime, after.ACMR);
+    WriteLog("    Vertex fetch: %.2fms", vertexFetchTime);
+    WriteLog("    Total: %.2fms", analyzeTime + vertexCacheTime + splitTime + overdrawTime + vertexFetchTime);
+
+    return after.ACMR < before.ACMR;
+}
+
+}
@@ -0,0 +1,81 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\Containers.h"
+#include "Model.h"
+
+namespace SampleFramework12
+{
+
+static const uint32 DefaultVertexCacheSize = 16;
+
+// Clusters are closed once their ACMR drops to this value (lambda in Sander et al. 2007)
+static const float DefaultClusterACMRThreshold = 0.75f;
+
+// Results of simulating a FIFO post-transform vertex cache
+struct VertexCacheStats
+{
+    uint64 NumTriangles = 0;
+    uint64 NumReferencedVertices = 0;
+    uint64 NumTransformedVertices = 0;
+
+    float ACMR = 0.0f;      // Average cache miss ratio: transformed vertices per triangle (0.5 is optimal for large grids)
+    float ATVR = 0.0f;      // Average transform to vertex ratio: transformed vertices per referenced vertex (1.0 is optimal)
+};
+
+struct MeshOptimizationStats
+{
+    VertexCacheStats Before;
+    VertexCacheStats After;
+    uint64 NumClusters = 0;
+    double TimeMS = 0.0;
+};
+
+VertexCacheStats AnalyzeVertexCache(const uint32* indices, uint64 numIndices, uint64 numVertices,
+                                    uint32 cacheSize = DefaultVertexCacheSize);
+
+// Re-orders triangles for the post-transform vertex cache using Tipsify (Sander et al. 2007). If
+// clusterStarts is provided, it receives the first triangle of each cluster that was started after
+// a cache flush, which can then be used for overdraw ordering.
+void OptimizeVertexCache(uint32* indices, uint64 numIndices, uint64 numVertices, uint32 cacheSize,
+                         List<uint32>* clusterStarts = nullptr);
+
+// Splits the clusters produced by OptimizeVertexCache into smaller ones, following Sander et al. 2007:
+// the cache is simulated from empty at the start of each cluster, and a new cluster is started as
+// soon as the ACMR of the current one drops to acmrThreshold or below. Higher thresholds produce
+// more clusters, which gives OptimizeOverdraw more freedom at the cost of some cache efficiency.
+void SplitClusters(const uint32* indices, uint64 numIndices, uint64 numVertices, uint32 cacheSize,
+                   float acmrThreshold, List<uint32>& clusterStarts);
+
+// Re-orders the clusters produced by OptimizeVertexCache/SplitClusters so that outward-facing clusters on the
+// outside of the mesh are drawn first, which reduces overdraw independently of the view direction
+void OptimizeOverdraw(uint32* indices, uint64 numIndices, const MeshVertex* vertices, uint64 numVertices,
+                      const List<uint32>& clusterStarts);
+
+// Re-orders vertices in the order that they're first referenced by the index buffer, and re-maps
+// the indices to match. Unreferenced vertices are moved to the end.
+void OptimizeVertexFetch(MeshVertex* vertices, uint64 numVertices, uint32* indices, uint64 numIndices);
+
+// Runs all of the above in order
+MeshOptimizationStats OptimizeMesh(MeshVertex* vertices, uint64 numVertices, uint32* indices, uint64 numIndices,
+                                   uint32 cacheSize = DefaultVertexCacheSize,
+                                   float clusterACMRThreshold = DefaultClusterACMRThreshold);
+
+// Checks that the optimizer only permutes triangles and vertices, and that it splits a grid into
+// multiple clusters while still improving its ACMR
+bool ValidateMeshOptimizer();
+
+// Optimizes a shuffled grid with 2 * gridSize * gridSize triangles and logs the time for each stage
+bool BenchmarkMeshOptimizer(uint64 gridSize = 400);
+
+}
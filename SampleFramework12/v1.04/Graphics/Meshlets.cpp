@@ -0,0 +1,436 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
+#include "..\\Timer.h"
+
+namespace SampleFramework12
+{
+
+static const uint8 InvalidLocalIndex = 0xFF;
+
+static uint32 PackMeshletTriangle(uint32 i0, uint32 i1, uint32 i2)
+{
+    return i0 | (i1 << 8) | (i2 << 16);
+}
+
+static void UnpackMeshletTriangle(uint32 packed, uint32& i0, uint32& i1, uint32& i2)
+{
+    i0 = packed & 0xFF;
+    i1 = (packed >> 8) & 0xFF;
+    i2 = (packed >> 16) & 0xFF;
+}
+
+void BuildMeshlets(const MeshVertex* vertices, uint64 numVertices, const uint32* indices, uint64 numIndices,
+                   List<Meshlet>& meshlets, List<uint32>& meshletVertices, List<uint32>& meshletTriangles,
+                   uint32 maxVertices, uint32 maxTriangles)
+{
+    Assert_(numIndices % 3 == 0);
+    Assert_(maxVertices >= 3 && maxVertices < InvalidLocalIndex);
+    Assert_(maxTriangles > 0);
+
+    if(numIndices == 0)
+        return;
+
+    // Maps mesh vertices to their index within the current meshlet
+    Array<uint8> localIndices(numVertices, InvalidLocalIndex);
+
+    Meshlet current;
+    current.VertexOffset = uint32(meshletVertices.Count());
+    current.TriangleOffset = uint32(meshletTriangles.Count());
+
+    auto finishMeshlet = [&]()
+    {
+        for(uint32 i = 0; i < current.VertexCount; ++i)
+            localIndices[meshletVertices[current.VertexOffset + i]] = InvalidLocalIndex;
+
+        ComputeMeshletBounds(vertices, &meshletVertices[current.VertexOffset], &meshletTriangles[current.TriangleOffset], current);
+        meshlets.Add(current);
+
+        current = Meshlet();
+        current.VertexOffset = uint32(meshletVertices.Count());
+        current.TriangleOffset = uint32(meshletTriangles.Count());
+    };
+
+    const uint64 numTriangles = numIndices / 3;
+    for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+    {
+        const uint32* triIndices = &indices[triIdx * 3];
+
+        uint32 numNewVertices = 0;
+        for(uint64 i = 0; i < 3; ++i)
+        {
+            Assert_(triIndices[i] < numVertices);
+            if(localIndices[triIndices[i]] == InvalidLocalIndex)
+                ++numNewVertices;
+        }
+
+        if(current.VertexCount + numNewVertices > maxVertices || current.TriangleCount + 1 > maxTriangles)
+            finishMeshlet();
+
+        uint32 local[3] = { };
+        for(uint64 i = 0; i < 3; ++i)
+        {
+            const uint32 v = triIndices[i];
+            if(localIndices[v] == InvalidLocalIndex)
+            {
+                localIndices[v] = uint8(current.VertexCount++);
+                meshletVertices.Add(v);
+            }
+
+            local[i] = localIndices[v];
+        }
+
+        meshletTriangles.Add(PackMeshletTriangle(local[0], local[1], local[2]));
+        current.TriangleCount += 1;
+    }
+
+    if(current.TriangleCount > 0)
+        finishMeshlet();
+}
+
+void ComputeMeshletBounds(const MeshVertex* vertices, const uint32* meshletVertices, const uint32* meshletTriangles, Meshlet& meshlet)
+{
+    Assert_(meshlet.VertexCount > 0);
+
+    // Bounding sphere centered on the AABB, which is cheap and reasonably tight for small clusters
+    Float3 aabbMin = FloatMax;
+    Float3 aabbMax = -FloatMax;
+    for(uint32 i = 0; i < meshlet.VertexCount; ++i)
+    {
+        const Float3& position = vertices[meshletVertices[i]].Position;
+        aabbMin = Min(aabbMin, position);
+        aabbMax = Max(aabbMax, position);
+    }
+
+    const Float3 center = (aabbMin + aabbMax) * 0.5f;
+    float radius = 0.0f;
+    for(uint32 i = 0; i < meshlet.VertexCount; ++i)
+        radius = Max(radius, Float3::Distance(center, vertices[meshletVertices[i]].Position));
+
+    meshlet.BoundsCenter = center;
+    meshlet.BoundsRadius = radius;
+
+    // Normal cone from the average of the triangle normals
+    Float3 normalSum;
+    Array<Float3> triNormals(meshlet.TriangleCount);
+    uint32 numValidNormals = 0;
+    for(uint32 triIdx = 0; triIdx < meshlet.TriangleCount; ++triIdx)
+    {
+        uint32 i0, i1, i2;
+        UnpackMeshletTriangle(meshletTriangles[triIdx], i0, i1, i2);
+
+        const Float3& p0 = vertices[meshletVertices[i0]].Position;
+        const Float3& p1 = vertices[meshletVertices[i1]].Position;
+        const Float3& p2 = vertices[meshletVertices[i2]].Position;
+
+        Float3 normal = Float3::Cross(p1 - p0, p2 - p0);
+        const float length = normal.Length();
+        if(length > 0.0f)
+        {
+            normal /= length;
+            normalSum += normal;
+            ++numValidNormals;
+        }
+
+        triNormals[triIdx] = normal;
+    }
+
+    // A cutoff of 1.0 means that the cone can never be used for culling
+    meshlet.ConeAxis = Float3(0.0f, 0.0f, 1.0f);
+    meshlet.ConeCutoff = 1.0f;
+    meshlet.ConeApex = center;
+
+    const float normalSumLength = normalSum.Length();
+    if(numValidNormals == 0 || normalSumLength <= 0.0f)
+        return;
+
+    const Float3 axis = normalSum / normalSumLength;
+
+    float minDot = 1.0f;
+    for(const Float3& normal : triNormals)
+    {
+        if(normal.Length() > 0.0f)
+            minDot = Min(minDot, Float3::Dot(normal, axis));
+    }
+
+    // Cones that are wider than ~84 degrees are too wide to cull anything in practice
+    if(minDot <= 0.1f)
+        return;
+
+    // Move the apex back along the axis so that every triangle's plane is in front of it, which
+    // makes the cone test conservative for any camera position
+    float maxT = 0.0f;
+    for(uint32 triIdx = 0; triIdx < meshlet.TriangleCount; ++triIdx)
+    {
+        const Float3& normal = triNormals[triIdx];
+        if(normal.Length() == 0.0f)
+            continue;
+
+        uint32 i0, i1, i2;
+        UnpackMeshletTriangle(meshletTriangles[triIdx], i0, i1, i2);
+        const Float3& p0 = vertices[meshletVertices[i0]].Position;
+
+        const float distToPlane = Float3::Dot(center - p0, normal);
+        const float axisDotNormal = Float3::Dot(axis, normal);
+        maxT = Max(maxT, distToPlane / axisDotNormal);
+    }
+
+    meshlet.ConeAxis = axis;
+    meshlet.ConeCutoff = std::sqrt(1.0f - minDot * minDot);
+    meshlet.ConeApex = center - axis * maxT;
+}
+
+bool MeshletConeCulled(const Meshlet& meshlet, const Float3& cameraPos)
+{
+    const Float3 viewDir = meshlet.ConeApex - cameraPos;
+    const float viewDirLength = viewDir.Length();
+    if(viewDirLength <= 0.0f)
+        return false;
+
+    return Float3::Dot(viewDir / viewDirLength, meshlet.ConeAxis) >= meshlet.ConeCutoff;
+}
+
+// Unit sphere made by projecting the faces of a subdivided cube, with outward-facing triangles
+static void MakeCubeSphere(uint64 faceSize, Array<MeshVertex>& vertices, Array<uint32>& indices)
+{
+    const uint64 rowSize = faceSize + 1;
+    const uint64 numFaceVertices = rowSize * rowSize;
+    vertices.Init(numFaceVertices * 6);
+    indices.Init(faceSize * faceSize * 6 * 6);
+
+    uint64 numIndices = 0;
+    for(uint64 face = 0; face < 6; ++face)
+    {
+        const uint64 axis = face / 2;
+        const float sign = (face % 2) == 0 ? 1.0f : -1.0f;
+
+        for(uint64 y = 0; y < rowSize; ++y)
+        {
+            for(uint64 x = 0; x < rowSize; ++x)
+            {
+                const float u = (float(x) / float(faceSize)) * 2.0f - 1.0f;
+                const float v = (float(y) / float(faceSize)) * 2.0f - 1.0f;
+
+                float cubePos[3] = { };
+                cubePos[axis] = sign;
+                cubePos[(axis + 1) % 3] = u;
+                cubePos[(axis + 2) % 3] = v;
+
+                const Float3 position = Float3::Normalize(Float3(cubePos[0], cubePos[1], cubePos[2]));
+                vertices[face * numFaceVertices + y * rowSize + x] = MeshVertex(position, position, Float2(u, v),
+                                                                                Float3(), Float3());
+            }
+        }
+
+        for(uint64 y = 0; y < faceSize; ++y)
+        {
+            for(uint64 x = 0; x < faceSize; ++x)
+            {
+                const uint32 v00 = uint32(face * numFaceVertices + y * rowSize + x);
+                const uint32 v10 = v00 + 1;
+                const uint32 v01 = v00 + uint32(rowSize);
+                const uint32 v11 = v01 + 1;
+
+                const uint32 quad[6] = { v00, v01, v10, v10, v01, v11 };
+                for(uint64 triIdx = 0; triIdx < 2; ++triIdx)
+                {
+                    uint32* tri = &indices[numIndices];
+                    tri[0] = quad[triIdx * 3 + 0];
+                    tri[1] = quad[triIdx * 3 + 1];
+                    tri[2] = quad[triIdx * 3 + 2];
+
+                    // Flip the winding on the faces where the (u, v) basis is left-handed
+                    const Float3& p0 = vertices[tri[0]].Position;
+                    const Float3 normal = Float3::Cross(vertices[tri[1]].Position - p0, vertices[tri[2]].Position - p0);
+                    if(Float3::Dot(normal, p0) < 0.0f)
+                        Swap(tri[1], tri[2]);
+
+                    numIndices += 3;
+                }
+            }
+        }
+    }
+
+    Assert_(numIndices == indices.Size());
+}
+
+bool ValidateMeshlets()
+{
+    Array<MeshVertex> vertices;
+    Array<uint32> indices;
+    MakeCubeSphere(16, vertices, indices);
+    OptimizeMesh(vertices.Data(), vertices.Size(), indices.Data(), indices.Size());
+
+    List<Meshlet> meshlets;
+    List<uint32> meshletVertices;
+    List<uint32> meshletTriangles;
+    BuildMeshlets(vertices.Data(), vertices.Size(), indices.Data(), indices.Size(), meshlets, meshletVertices, meshletTriangles);
+
+    bool passed = true;
+
+    // Walking the meshlets in order has to give back the original index buffer
+    uint64 numIndices = 0;
+    for(uint64 meshletIdx = 0; meshletIdx < meshlets.Count() && passed; ++meshletIdx)
+    {
+        const Meshlet& meshlet = meshlets[meshletIdx];
+        if(meshlet.VertexCount == 0 || meshlet.VertexCount > MaxMeshletVertices ||
+           meshlet.TriangleCount == 0 || meshlet.TriangleCount > MaxMeshletTriangles)
+        {
+            WriteLog("Meshlet %llu has %u vertices and %u triangles", meshletIdx, meshlet.VertexCount, meshlet.TriangleCount);
+            passed = false;
+            break;
+        }
+
+        const uint32* localVertices = &meshletVertices[meshlet.VertexOffset];
+        for(uint32 triIdx = 0; triIdx < meshlet.TriangleCount; ++triIdx)
+        {
+            uint32 local[3] = { };
+            UnpackMeshletTriangle(meshletTriangles[meshlet.TriangleOffset + triIdx], local[0], local[1], local[2]);
+            for(uint64 i = 0; i < 3; ++i)
+            {
+                if(local[i] >= meshlet.VertexCount || localVertices[local[i]] != indices[numIndices + i])
+                {
+                    WriteLog("Triangle %u of meshlet %llu doesn't match the index buffer", triIdx, meshletIdx);
+                    passed = false;
+                }
+            }
+
+            numIndices += 3;
+        }
+
+        for(uint32 i = 0; i < meshlet.VertexCount; ++i)
+        {
+            const float distance = Float3::Distance(vertices[localVertices[i]].Position, meshlet.BoundsCenter);
+            if(distance > meshlet.BoundsRadius * 1.0001f + 1e-6f)
+            {
+                WriteLog("Vertex %u of meshlet %llu is outside of its bounding sphere", i, meshletIdx);
+                passed = false;
+                break;
+            }
+        }
+    }
+
+    if(passed && numIndices != indices.Size())
+    {
+        WriteLog("The meshlets only cover %llu of %llu indices", numIndices, indices.Size());
+        passed = false;
+    }
+
+    if(passed == false)
+        return false;
+
+    // A culled meshlet must not have any triangles facing the camera
+    Random rng;
+    rng.SeedWithValue(31);
+
+    const uint64 numCameras = 256;
+    uint64 numCulled = 0;
+    for(uint64 cameraIdx = 0; cameraIdx < numCameras && passed; ++cameraIdx)
+    {
+        const Float2 u = rng.RandomFloat2();
+        const float cosTheta = 1.0f - 2.0f * u.x;
+        const float sinTheta = std::sqrt(Max(1.0f - cosTheta * cosTheta, 0.0f));
+        const float phi = u.y * Pi2;
+        const float distance = 1.1f + rng.RandomFloat() * 8.0f;
+        const Float3 cameraPos = Float3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta) * distance;
+
+        for(uint64 meshletIdx = 0; meshletIdx < meshlets.Count(); ++meshletIdx)
+        {
+            const Meshlet& meshlet = meshlets[meshletIdx];
+            if(MeshletConeCulled(meshlet, cameraPos) == false)
+                continue;
+
+            ++numCulled;
+
+            const uint32* localVertices = &meshletVertices[meshlet.VertexOffset];
+            for(uint32 triIdx = 0; triIdx < meshlet.TriangleCount; ++triIdx)
+            {
+                uint32 i0, i1, i2;
+                UnpackMeshletTriangle(meshletTriangles[meshlet.TriangleOffset + triIdx], i0, i1, i2);
+                const Float3& p0 = vertices[localVertices[i0]].Position;
+                const Float3& p1 = vertices[localVertices[i1]].Position;
+                const Float3& p2 = vertices[localVertices[i2]].Position;
+
+                const Float3 normal = Float3::Normalize(Float3::Cross(p1 - p0, p2 - p0));
+                if(Float3::Dot(p0 - cameraPos, normal) < -1e-5f)
+                {
+                    WriteLog("Meshlet %llu was cone culled with a front-facing triangle", meshletIdx);
+                    passed = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Roughly half of a sphere faces away from any camera, so the cones should catch a decent part of it
+    const float culledFraction = float(numCulled) / float(numCameras * meshlets.Count());
+    WriteLog("Meshlets: %llu for %llu triangles, %.1f%% cone culled on average", meshlets.Count(), indices.Size() / 3,
+             culledFraction * 100.0f);
+
+    if(culledFraction < 0.1f)
+    {
+        WriteLog("The normal cones culled fewer meshlets than expected");
+        passed = false;
+    }
+
+    return passed;
+}
+
+bool BenchmarkMeshlets(uint64 faceSize)
+{
+    Array<MeshVertex> vertices;
+    Array<uint32> indices;
+    MakeCubeSphere(faceSize, vertices, indices);
+
+    const uint64 numTriangles = indices.Size() / 3;
+
+    Timer timer;
+
+    List<Meshlet> meshlets;
+    List<uint32> meshletVertices;
+    List<uint32> meshletTriangles;
+    BuildMeshlets(vertices.Data(), vertices.Size(), indices.Data(), indices.Size(), meshlets, meshletVertices, meshletTriangles);
+    timer.Update();
+    const double unoptimizedTime = timer.DeltaMillisecondsD();
+    const uint64 numUnoptimizedMeshlets = meshlets.Count();
+
+    OptimizeMesh(vertices.Data(), vertices.Size(), indices.Data(), indices.Size());
+    timer.Update();
+    const double optimizeTime = timer.DeltaMillisecondsD();
+
+    meshlets.RemoveAll();
+    meshletVertices.RemoveAll();
+    meshletTriangles.RemoveAll();
+    BuildMeshlets(vertices.Data(), vertices.Size(), indices.Data(), indices.Size(), meshlets, meshletVertices, meshletTriangles);
+    timer.Update();
+    const double optimizedTime = timer.DeltaMillisecondsD();
+
+    const Float3 cameraPos = Float3(0.0f, 0.0f, -3.0f);
+    uint64 numCulled = 0;
+    for(const Meshlet& meshlet : meshlets)
+        numCulled += MeshletConeCulled(meshlet, cameraPos) ? 1 : 0;
+    timer.Update();
+    const double cullTime = timer.DeltaMillisecondsD();
+
+    const uint64 numMeshlets = meshlets.Count();
+    WriteLog("Meshlets: %llu triangles, %llu vertices", numTriangles, vertices.Size());
+    WriteLog("    Build (input order): %.2fms, %llu meshlets", unoptimizedTime, numUnoptimizedMeshlets);
+    WriteLog("    Optimize mesh: %.2fms", optimizeTime);
+    WriteLog("    Build (optimized): %.2fms, %llu meshlets, %.1f vertices and %.1f triangles per meshlet", optimizedTime, numMeshlets,
+             double(meshletVertices.Count()) / numMeshlets, double(meshletTriangles.Count()) / numMeshlets);
+    WriteLog("    Cone culling: %.3fms, %llu of %llu culled", cullTime, numCulled, numMeshlets);
+
+    return numMeshlets > 0 && meshletTriangles.Count() == numTriangles;
+}
+
+}
@@ -0,0 +1,44 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\Containers.h"
+#include "Model.h"
+
+namespace SampleFramework12
+{
+
+static const uint32 MaxMeshletVertices = 64;
+static const uint32 MaxMeshletTriangles = 124;
+
+// Splits a mesh into meshlets by walking its triangles in order, so the index buffer should already be
+// optimized for locality. Vertex indices are relative to the mesh, and triangles are packed as three
+// 8-bit indices into the meshlet's vertex list. Offsets are relative to the output lists, which are
+// appended to rather than cleared.
+void BuildMeshlets(const MeshVertex* vertices, uint64 numVertices, const uint32* indices, uint64 numIndices,
+                   List<Meshlet>& meshlets, List<uint32>& meshletVertices, List<uint32>& meshletTriangles,
+                   uint32 maxVertices = MaxMeshletVertices, uint32 maxTriangles = MaxMeshletTriangles);
+
+// Computes the bounding sphere and normal cone for a single meshlet
+void ComputeMeshletBounds(const MeshVertex* vertices, const uint32* meshletVertices, const uint32* meshletTriangles, Meshlet& meshlet);
+
+// Returns true if the whole meshlet faces away from the camera, based on the normal cone
+bool MeshletConeCulled(const Meshlet& meshlet, const Float3& cameraPos);
+
+// Checks the meshlet size limits, that the meshlets reproduce the index buffer, and that the
+// bounding spheres and normal cones are conservative
+bool ValidateMeshlets();
+
+// Builds meshlets for a sphere with 12 * faceSize * faceSize triangles and logs the timings
+bool BenchmarkMeshlets(uint64 faceSize = 256);
+
+}
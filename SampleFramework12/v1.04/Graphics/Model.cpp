@@ -17,10 +17,15 @@
 #include "..\\Serialization.h"
 #include "..\\FileIO.h"
 #include "..\\MurmurHash.h"
+#include "..\\Timer.h"
 #include "Textures.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "..\\Tasks.h"
 
 using std::string;
 using std::wstring;
+using namespace DirectX;
 
 namespace SampleFramework12
 {
@@ -43,6 +48,24 @@ static const D3D12_INPUT_ELEMENT_DESC StandardInputElements[5] =
     { "BITANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 44, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 };
 
+static const InputElementType PackedInputElementTypes[4] =
+{
+    InputElementType::Position,
+    InputElementType::Normal,
+    InputElementType::Tangent,
+    InputElementType::UV,
+};
+
+static const D3D12_INPUT_ELEMENT_DESC PackedInputElements[4] =
+{
+    { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    { "UV", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+};
+
+StaticAssert_(ArraySize_(PackedInputElementTypes) == ArraySize_(PackedInputElements));
+
 static const wchar* DefaultTextures[] =
 {
     L"..\\Content\\Textures\\DefaultBaseColor.dds",     // Albedo
@@ -116,24 +139,22 @@ static void LoadMaterialResources(Array<MeshMaterial>& materials, const wstring&
     }
 }
 
-static const uint64 CacheVersion = 1;
+static const uint64 CacheVersion = 7;
 static const wchar* CacheDir = L"ModelCache";
 
 static wstring MakeModelCachePath(ModelLoadSettings settings)
 {
-    Array<uint8> fileData;
-    ReadFileAsByteArray(settings.FilePath, fileData);
+    Hash modelHash = GenerateFileHash(settings.FilePath);
 
-    Hash settingsHash = GenerateHash(settings.FilePath, int32(wcslen(settings.FilePath)));
+    Hash settingsHash = GenerateHash(settings.FilePath, wcslen(settings.FilePath) * sizeof(wchar));
     if(settings.TextureDir != nullptr)
-        settingsHash = CombineHashes(settingsHash, GenerateHash(settings.TextureDir, int32(wcslen(settings.TextureDir))));
+        settingsHash = CombineHashes(settingsHash, GenerateHash(settings.TextureDir, wcslen(settings.TextureDir) * sizeof(wchar)));
 
     settings.FilePath = nullptr;
     settings.TextureDir = nullptr;
+    settings.VerboseLogging = false;
     settingsHash = CombineHashes(settingsHash, GenerateHash(&settings, sizeof(settings)));
 
-    Hash modelHash = GenerateHash(fileData.Data(), int32(fileData.Size()));
-
     return MakeString(L"%ls\\%ls_%ls_%llu.modelcache", CacheDir, settingsHash.ToString().c_str(), modelHash.ToString().c_str(), CacheVersion);
 }
 
@@ -145,10 +166,7 @@ void Mesh::InitFromAssimpMesh(const aiMesh& assimpMesh, const ModelLoadSettings&
 
     if(assimpMesh.HasPositions())
     {
-        // Compute the AABB of the mesh, and copy the positions
-        aabbMin = FloatMax;
-        aabbMax = -FloatMax;
-
+        // Copy the positions, and compute the AABB of the mesh
         for(uint64 i = 0; i < numVertices; ++i)
         {
             Float3 position = ConvertVector(assimpMesh.mVertices[i]) * loadSettings.SceneScale;
@@ -159,11 +177,10 @@ void Mesh::InitFromAssimpMesh(const aiMesh& assimpMesh, const ModelLoadSettings&
                 position.y = -z;
             }
 
-            aabbMin = Min(aabbMin, position);
-            aabbMax = Max(aabbMax, position);
-
             dstVertices[i].Position = position;
         }
+
+        ComputeBounds(&dstVertices[0].Position, numVertices, sizeof(MeshVertex), aabbMin, aabbMax);
     }
 
     if(assimpMesh.HasNormals())
@@ -187,29 +204,37 @@ void Mesh::InitFromAssimpMesh(const aiMesh& assimpMesh, const ModelLoadSettings&
         }
     }
 
-    // Copy the index data
+    // Gather the index data
     const uint64 numTriangles = assimpMesh.mNumFaces;
+    Array<uint32> meshIndices(numIndices);
+    for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
+    {
+        meshIndices[triIdx * 3 + 0] = uint32(assimpMesh.mFaces[triIdx].mIndices[0]);
+        meshIndices[triIdx * 3 + 1] = uint32(assimpMesh.mFaces[triIdx].mIndices[1]);
+        meshIndices[triIdx * 3 + 2] = uint32(assimpMesh.mFaces[triIdx].mIndices[2]);
+    }
+
+    if(loadSettings.OptimizeMeshes)
+    {
+        const MeshOptimizationStats stats = OptimizeMesh(dstVertices, numVertices, meshIndices.Data(), numIndices);
+        if(loadSettings.VerboseLogging)
+            WriteLog("Optimized mesh '%s' (%u triangles, %llu clusters) in %.2fms: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+                     assimpMesh.mName.C_Str(), uint32(numTriangles), stats.NumClusters, stats.TimeMS,
+                     stats.Before.ACMR, stats.After.ACMR, stats.Before.ATVR, stats.After.ATVR);
+    }
+
+    // Copy the index data
     if(indexType_ == IndexType::Index16Bit)
     {
         uint16* dstIndices16 = (uint16*)dstIndices;
-        for(uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
-        {
-            dstIndices16[triIdx * 3 + 0] = uint16(assimpMesh.mFaces[triIdx].mIndices[0]);
-            dstIndices16[triIdx * 3 + 1] = uint16(assimpMesh.mFaces[triIdx].mIndices[1]);
-            dstIndices16[triIdx * 3 + 2] = uint16(assimpMesh.mFaces[triIdx].mIndices[2]);
-        }
+        for(uint64 i = 0; i < numIndices; ++i)
+            dstIndices16[i] = uint16(meshIndices[i]);
     }
     else
     {
-        uint32* dstIndices32 = (uint32*)dstIndices;
-        for (uint64 triIdx = 0; triIdx < numTriangles; ++triIdx)
-        {
-            dstIndices32[triIdx * 3 + 0] = uint32(assimpMesh.mFaces[triIdx].mIndices[0]);
-            dstIndices32[triIdx * 3 + 1] = uint32(assimpMesh.mFaces[triIdx].mIndices[1]);
-            dstIndices32[triIdx * 3 + 2] = uint32(assimpMesh.mFaces[triIdx].mIndices[2]);
-        }
+        memcpy(dstIndices, meshIndices.Data(), numIndices * sizeof(uint32));
     }
-    
+
     meshParts.Init(1);
     MeshPart& part = meshParts[0];
     part.IndexStart = 0;
@@ -265,15 +290,10 @@ void Mesh::InitBox(const Float3& dimensions, const Float3& position,
     dstVertices[vIdx++] = MeshVertex(Float3(1.0f, -1.0f, 1.0f), Float3(1.0f, 0.0f, 0.0f), Float2(1.0f, 1.0f), Float3(0.0f, 0.0f, 1.0f), Float3(0.0f, -1.0f, 0.0f));
     dstVertices[vIdx++] = MeshVertex(Float3(1.0f, -1.0f, -1.0f), Float3(1.0f, 0.0f, 0.0f), Float2(0.0f, 1.0f), Float3(0.0f, 0.0f, 1.0f), Float3(0.0f, -1.0f, 0.0f));
 
-    aabbMin = FloatMax;
-    aabbMax = -FloatMax;
     for(uint64 i = 0; i < NumBoxVerts; ++i)
-    {
         dstVertices[i].Transform(position, dimensions * 0.5f, orientation);
 
-        aabbMin = Min(aabbMin, dstVertices[i].Position);
-        aabbMax = Max(aabbMax, dstVertices[i].Position);
-    }
+    ComputeBounds(&dstVertices[0].Position, NumBoxVerts, sizeof(MeshVertex), aabbMin, aabbMax);
 
     uint64 iIdx = 0;
 
@@ -353,15 +373,10 @@ void Mesh::InitPlane(const Float2& dimensions, const Float3& position, const Qua
     dstVertices[vIdx++] = MeshVertex(Float3(1.0f, 0.0f, -1.0f), Float3(0.0f, 1.0f, 0.0f), Float2(1.0f, 1.0f), Float3(1.0f, 0.0f, 0.0f), Float3(0.0f, 0.0f, -1.0f));
     dstVertices[vIdx++] = MeshVertex(Float3(-1.0f, 0.0f, -1.0f), Float3(0.0f, 1.0f, 0.0f), Float2(0.0f, 1.0f), Float3(1.0f, 0.0f, 0.0f), Float3(0.0f, 0.0f, -1.0f));
 
-    aabbMin = FloatMax;
-    aabbMax = -FloatMax;
     for(uint64 i = 0; i < NumPlaneVerts; ++i)
-    {
         dstVertices[i].Transform(position, Float3(dimensions.x, 1.0f, dimensions.y) * 0.5f, orientation);
 
-        aabbMin = Min(aabbMin, dstVertices[i].Position);
-        aabbMax = Max(aabbMax, dstVertices[i].Position);
-    }
+    ComputeBounds(&dstVertices[0].Position, NumPlaneVerts, sizeof(MeshVertex), aabbMin, aabbMax);
 
     uint64 iIdx = 0;
     dstIndices[iIdx++] = 0;
@@ -385,7 +400,8 @@ void Mesh::InitPlane(const Float2& dimensions, const Float3& position, const Qua
     part.MaterialIdx = materialIdx;
 }
 
-void Mesh::InitCommon(const MeshVertex* vertices_, const uint8* indices_, uint64 vbAddress, uint64 ibAddress, uint64 vtxOffset_, uint64 idxOffset_)
+void Mesh::InitCommon(const MeshVertex* vertices_, const uint8* indices_, uint64 vbAddress, uint64 ibAddress, uint64 vtxOffset_, uint64 idxOffset_,
+                      uint64 vtxStride)
 {
     Assert_(meshParts.Size() > 0);
 
@@ -395,8 +411,8 @@ void Mesh::InitCommon(const MeshVertex* vertices_, const uint8* indices_, uint64
     idxOffset = uint32(idxOffset_);
 
     vbView.BufferLocation = vbAddress;
-    vbView.SizeInBytes = sizeof(MeshVertex) * numVertices;
-    vbView.StrideInBytes = sizeof(MeshVertex);
+    vbView.SizeInBytes = uint32(vtxStride * numVertices);
+    vbView.StrideInBytes = uint32(vtxStride);
 
     ibView.Format = IndexBufferFormat();
     ibView.SizeInBytes = IndexSize() * numIndices;
@@ -410,6 +426,9 @@ void Mesh::Shutdown()
     meshParts.Shutdown();
     vertices = nullptr;
     indices = nullptr;
+    meshlets = nullptr;
+    meshletOffset = 0;
+    numMeshlets = 0;
 }
 
 const char* Mesh::InputElementTypeString(InputElementType elemType)
@@ -429,6 +448,327 @@ const char* Mesh::InputElementTypeString(InputElementType elemType)
     return ElemStrings[uint64(elemType)];
 }
 
+// == Vertex packing ==============================================================================
+
+static const float SNorm16Max = 32767.0f;
+
+// Octahedral encoding for 4 vectors stored in SoA form, producing values in [-1, 1]
+static void OctEncode4(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, XMVECTOR& outX, XMVECTOR& outY)
+{
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR one = XMVectorSplatOne();
+
+    const XMVECTOR l1Norm = XMVectorAdd(XMVectorAdd(XMVectorAbs(x), XMVectorAbs(y)), XMVectorAbs(z));
+    const XMVECTOR invL1Norm = XMVectorReciprocal(XMVectorMax(l1Norm, XMVectorReplicate(1e-20f)));
+    const XMVECTOR octX = XMVectorMultiply(x, invL1Norm);
+    const XMVECTOR octY = XMVectorMultiply(y, invL1Norm);
+
+    // Fold the lower hemisphere over the diagonals
+    const XMVECTOR signX = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(octX, zero));
+    const XMVECTOR signY = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(octY, zero));
+    const XMVECTOR foldedX = XMVectorMultiply(XMVectorSubtract(one, XMVectorAbs(octY)), signX);
+    const XMVECTOR foldedY = XMVectorMultiply(XMVectorSubtract(one, XMVectorAbs(octX)), signY);
+
+    const XMVECTOR lowerHemisphere = XMVectorLess(z, zero);
+    outX = XMVectorSelect(octX, foldedX, lowerHemisphere);
+    outY = XMVectorSelect(octY, foldedY, lowerHemisphere);
+}
+
+static Float3 OctDecode(float x, float y)
+{
+    Float3 n = Float3(x, y, 1.0f - std::abs(x) - std::abs(y));
+    if(n.z < 0.0f)
+    {
+        const float foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        const float foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        n.x = foldedX;
+        n.y = foldedY;
+    }
+
+    return Float3::Normalize(n);
+}
+
+static XMINT4 QuantizeSNorm16(FXMVECTOR v)
+{
+    const XMVECTOR clamped = XMVectorClamp(v, XMVectorNegate(XMVectorSplatOne()), XMVectorSplatOne());
+    const XMVECTOR scaled = XMVectorRound(XMVectorScale(clamped, SNorm16Max));
+
+    XMINT4 result;
+    XMStoreSInt4(&result, XMConvertVectorFloatToInt(scaled, 0));
+    return result;
+}
+
+static float DequantizeSNorm16(int16 v)
+{
+    return Max(v / SNorm16Max, -1.0f);
+}
+
+// Loads a Float3 member of 4 vertices, and transposes them into SoA form
+static void LoadVertexComponent4(const MeshVertex* vertices, const uint64* vtxIndices, uint64 memberOffset,
+                                 XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+{
+    XMMATRIX m;
+    for(uint64 i = 0; i < 4; ++i)
+    {
+        const uint8* vtxMem = reinterpret_cast<const uint8*>(&vertices[vtxIndices[i]]) + memberOffset;
+        m.r[i] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(vtxMem));
+    }
+
+    m = XMMatrixTranspose(m);
+    x = m.r[0];
+    y = m.r[1];
+    z = m.r[2];
+}
+
+void ComputePositionDequantization(const Float3& aabbMin, const Float3& aabbMax, Float3& posScale, Float3& posBias)
+{
+    posBias = (aabbMin + aabbMax) * 0.5f;
+    posScale = (aabbMax - aabbMin) * 0.5f;
+
+    // Avoid a zero scale for flat meshes so that the encoder doesn't need to divide by zero
+    posScale.x = Max(posScale.x, 1e-8f);
+    posScale.y = Max(posScale.y, 1e-8f);
+    posScale.z = Max(posScale.z, 1e-8f);
+}
+
+void EncodePackedVertices(const MeshVertex* srcVertices, uint64 numVertices, const Float3& posScale, const Float3& posBias,
+                          PackedMeshVertex* dstVertices)
+{
+    if(numVertices == 0)
+        return;
+
+    Assert_(srcVertices != nullptr);
+    Assert_(dstVertices != nullptr);
+
+    const XMVECTOR invScaleX = XMVectorReplicate(1.0f / posScale.x);
+    const XMVECTOR invScaleY = XMVectorReplicate(1.0f / posScale.y);
+    const XMVECTOR invScaleZ = XMVectorReplicate(1.0f / posScale.z);
+    const XMVECTOR biasX = XMVectorReplicate(posBias.x);
+    const XMVECTOR biasY = XMVectorReplicate(posBias.y);
+    const XMVECTOR biasZ = XMVectorReplicate(posBias.z);
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR one = XMVectorSplatOne();
+
+    for(uint64 baseIdx = 0; baseIdx < numVertices; baseIdx += 4)
+    {
+        // Replicate the last vertex to fill out the final group
+        const uint64 numInGroup = Min<uint64>(numVertices - baseIdx, 4);
+        uint64 vtxIndices[4];
+        for(uint64 i = 0; i < 4; ++i)
+            vtxIndices[i] = baseIdx + Min<uint64>(i, numInGroup - 1);
+
+        XMVECTOR px, py, pz;
+        XMVECTOR nx, ny, nz;
+        XMVECTOR tx, ty, tz;
+        XMVECTOR bx, by, bz;
+        LoadVertexComponent4(srcVertices, vtxIndices, offsetof(MeshVertex, Position), px, py, pz);
+        LoadVertexComponent4(srcVertices, vtxIndices, offsetof(MeshVertex, Normal), nx, ny, nz);
+        LoadVertexComponent4(srcVertices, vtxIndices, offsetof(MeshVertex, Tangent), tx, ty, tz);
+        LoadVertexComponent4(srcVertices, vtxIndices, offsetof(MeshVertex, Bitangent), bx, by, bz);
+
+        px = XMVectorMultiply(XMVectorSubtract(px, biasX), invScaleX);
+        py = XMVectorMultiply(XMVectorSubtract(py, biasY), invScaleY);
+        pz = XMVectorMultiply(XMVectorSubtract(pz, biasZ), invScaleZ);
+
+        // The bitangent is reconstructed as cross(N, T) * sign
+        const XMVECTOR cx = XMVectorSubtract(XMVectorMultiply(ny, tz), XMVectorMultiply(nz, ty));
+        const XMVECTOR cy = XMVectorSubtract(XMVectorMultiply(nz, tx), XMVectorMultiply(nx, tz));
+        const XMVECTOR cz = XMVectorSubtract(XMVectorMultiply(nx, ty), XMVectorMultiply(ny, tx));
+        const XMVECTOR handedness = XMVectorAdd(XMVectorAdd(XMVectorMultiply(cx, bx), XMVectorMultiply(cy, by)), XMVectorMultiply(cz, bz));
+        const XMVECTOR bitangentSign = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(handedness, zero));
+
+        XMVECTOR octNX, octNY, octTX, octTY;
+        OctEncode4(nx, ny, nz, octNX, octNY);
+        OctEncode4(tx, ty, tz, octTX, octTY);
+
+        const XMINT4 qpx = QuantizeSNorm16(px);
+        const XMINT4 qpy = QuantizeSNorm16(py);
+        const XMINT4 qpz = QuantizeSNorm16(pz);
+        const XMINT4 qpw = QuantizeSNorm16(bitangentSign);
+        const XMINT4 qnx = QuantizeSNorm16(octNX);
+        const XMINT4 qny = QuantizeSNorm16(octNY);
+        const XMINT4 qtx = QuantizeSNorm16(octTX);
+        const XMINT4 qty = QuantizeSNorm16(octTY);
+
+        const int32* lanes[8] = { &qpx.x, &qpy.x, &qpz.x, &qpw.x, &qnx.x, &qny.x, &qtx.x, &qty.x };
+        for(uint64 i = 0; i < numInGroup; ++i)
+        {
+            PackedMeshVertex& dst = dstVertices[baseIdx + i];
+            dst.Position[0] = int16(lanes[0][i]);
+            dst.Position[1] = int16(lanes[1][i]);
+            dst.Position[2] = int16(lanes[2][i]);
+            dst.Position[3] = int16(lanes[3][i]);
+            dst.Normal[0] = int16(lanes[4][i]);
+            dst.Normal[1] = int16(lanes[5][i]);
+            dst.Tangent[0] = int16(lanes[6][i]);
+            dst.Tangent[1] = int16(lanes[7][i]);
+        }
+    }
+
+    // UVs are converted as strided streams, which uses F16C when it's enabled for DirectXMath
+    PackedVector::HALF* dstUV = reinterpret_cast<PackedVector::HALF*>(dstVertices[0].UV);
+    const float* srcUV = &srcVertices[0].UV.x;
+    PackedVector::XMConvertFloatToHalfStream(dstUV, sizeof(PackedMeshVertex), srcUV, sizeof(MeshVertex), size_t(numVertices));
+    PackedVector::XMConvertFloatToHalfStream(dstUV + 1, sizeof(PackedMeshVertex), srcUV + 1, sizeof(MeshVertex), size_t(numVertices));
+}
+
+MeshVertex DecodePackedVertex(const PackedMeshVertex& vertex, const Float3& posScale, const Float3& posBias)
+{
+    MeshVertex result;
+    result.Position = Float3(DequantizeSNorm16(vertex.Position[0]),
+                             DequantizeSNorm16(vertex.Position[1]),
+                             DequantizeSNorm16(vertex.Position[2])) * posScale + posBias;
+    result.Normal = OctDecode(DequantizeSNorm16(vertex.Normal[0]), DequantizeSNorm16(vertex.Normal[1]));
+    result.Tangent = OctDecode(DequantizeSNorm16(vertex.Tangent[0]), DequantizeSNorm16(vertex.Tangent[1]));
+    result.Bitangent = Float3::Cross(result.Normal, result.Tangent) * (vertex.Position[3] >= 0 ? 1.0f : -1.0f);
+    result.UV = Float2(PackedVector::XMConvertHalfToFloat(vertex.UV[0]), PackedVector::XMConvertHalfToFloat(vertex.UV[1]));
+
+    return result;
+}
+
+// Uses atan2 instead of acos, since acos of a dot product can't resolve angles much below 0.02 degrees in float
+static float AngleBetween(const Float3& a, const Float3& b)
+{
+    return std::atan2(Float3::Cross(a, b).Length(), Float3::Dot(a, b));
+}
+
+PackedVertexErrors MeasurePackedVertexErrors(const MeshVertex* srcVertices, const PackedMeshVertex* packedVertices, uint64 numVertices,
+                                             const Float3& posScale, const Float3& posBias)
+{
+    PackedVertexErrors errors;
+    for(uint64 i = 0; i < numVertices; ++i)
+    {
+        const MeshVertex& src = srcVertices[i];
+        const MeshVertex decoded = DecodePackedVertex(packedVertices[i], posScale, posBias);
+
+        errors.MaxPositionError = Max(errors.MaxPositionError, Float3::Distance(src.Position, decoded.Position));
+        errors.MaxNormalAngle = Max(errors.MaxNormalAngle, AngleBetween(src.Normal, decoded.Normal));
+        errors.MaxTangentAngle = Max(errors.MaxTangentAngle, AngleBetween(src.Tangent, decoded.Tangent));
+        errors.MaxUVError = Max(errors.MaxUVError, Max(std::abs(src.UV.x - decoded.UV.x), std::abs(src.UV.y - decoded.UV.y)));
+        if(Float3::Dot(src.Bitangent, decoded.Bitangent) < 0.0f)
+            ++errors.NumBitangentSignErrors;
+    }
+
+    return errors;
+}
+
+// Builds a random unit vector, with every 8th one snapped to an axis and every 8th one on the z = 0 boundary, since
+// those are where the octahedral fold is most likely to go wrong
+static Float3 RandomUnitVector(Random& rng, uint64 idx)
+{
+    if(idx % 8 == 0)
+    {
+        float axis[3] = { 0.0f, 0.0f, 0.0f };
+        axis[(idx / 8) % 3] = ((idx / 24) % 2) ? -1.0f : 1.0f;
+        return Float3(axis[0], axis[1], axis[2]);
+    }
+
+    const float u = rng.RandomFloat() * 2.0f - 1.0f;
+    const float phi = rng.RandomFloat() * Pi2;
+    const float r = std::sqrt(Max(1.0f - u * u, 0.0f));
+    const Float3 v = Float3(r * std::cos(phi), r * std::sin(phi), idx % 8 == 1 ? 0.0f : u);
+    return Float3::Normalize(v);
+}
+
+bool ValidatePackedVertices(uint64 numVertices)
+{
+    Assert_(numVertices > 0);
+
+    Random rng;
+    rng.SeedWithValue(29);
+
+    // A deliberately lopsided AABB, so that each axis has a different quantization step
+    const Float3 aabbMin = Float3(-12.5f, 0.25f, -0.001f);
+    const Float3 aabbMax = Float3(40.0f, 3.0f, 0.001f);
+
+    Array<MeshVertex> vertices(numVertices);
+    Array<float> bitangentSigns(numVertices);
+    for(uint64 i = 0; i < numVertices; ++i)
+    {
+        MeshVertex& vtx = vertices[i];
+        vtx.Position = Float3(Lerp(aabbMin.x, aabbMax.x, rng.RandomFloat()), Lerp(aabbMin.y, aabbMax.y, rng.RandomFloat()),
+                              Lerp(aabbMin.z, aabbMax.z, rng.RandomFloat()));
+
+        // Force the corners of the AABB into the set, since those hit the ends of the snorm range
+        if(i < 8)
+            vtx.Position = Float3((i & 1) ? aabbMax.x : aabbMin.x, (i & 2) ? aabbMax.y : aabbMin.y, (i & 4) ? aabbMax.z : aabbMin.z);
+
+        vtx.Normal = RandomUnitVector(rng, i);
+
+        // Tangent is perpendicular to the normal, and every other bitangent is flipped like it would be for mirrored UVs
+        Float3 tangent = Float3::Cross(vtx.Normal, RandomUnitVector(rng, i + 3));
+        if(tangent.Length() < 1e-3f)
+            tangent = Float3::Cross(vtx.Normal, std::abs(vtx.Normal.x) < 0.9f ? Float3(1.0f, 0.0f, 0.0f) : Float3(0.0f, 1.0f, 0.0f));
+        vtx.Tangent = Float3::Normalize(tangent);
+
+        bitangentSigns[i] = (i % 2) ? -1.0f : 1.0f;
+        vtx.Bitangent = Float3::Cross(vtx.Normal, vtx.Tangent) * bitangentSigns[i];
+
+        vtx.UV = Float2(rng.RandomFloat() * 8.0f - 4.0f, rng.RandomFloat() * 8.0f - 4.0f);
+        if(i % 16 == 5)
+            vtx.UV = Float2(0.0f, 1.0f);
+    }
+
+    Float3 posScale;
+    Float3 posBias;
+    ComputePositionDequantization(aabbMin, aabbMax, posScale, posBias);
+
+    Array<PackedMeshVertex> packedVertices(numVertices);
+    EncodePackedVertices(vertices.Data(), numVertices, posScale, posBias, packedVertices.Data());
+
+    // Half a quantization step on each axis, with some slack for float rounding in the encode/decode math
+    const Float3 halfStep = posScale * (0.5f / SNorm16Max);
+    const float maxPositionError = halfStep.Length() * 1.01f + 1e-6f;
+
+    // 16-bit octahedral encoding is good to about 0.005 degrees
+    const float maxDirectionAngle = DegToRad(0.01f);
+
+    uint64 numFailures = 0;
+    for(uint64 i = 0; i < numVertices; ++i)
+    {
+        const MeshVertex& src = vertices[i];
+        const PackedMeshVertex& packed = packedVertices[i];
+        const MeshVertex decoded = DecodePackedVertex(packed, posScale, posBias);
+
+        const float positionError = Float3::Distance(src.Position, decoded.Position);
+        const float normalAngle = AngleBetween(src.Normal, decoded.Normal);
+        const float tangentAngle = AngleBetween(src.Tangent, decoded.Tangent);
+
+        // Half floats round to 11 significant bits, and values below the normal range have a fixed step
+        const float maxUVError = Max(Max(std::abs(src.UV.x), std::abs(src.UV.y)), 6.1035e-5f) / 2048.0f;
+        const float uvError = Max(std::abs(src.UV.x - decoded.UV.x), std::abs(src.UV.y - decoded.UV.y));
+
+        // A flipped bitangent has to come back flipped, both in the stored sign and in the reconstructed vector
+        const bool signStored = (packed.Position[3] < 0) == (bitangentSigns[i] < 0.0f) && std::abs(packed.Position[3]) == int32(SNorm16Max);
+        const bool signDecoded = Float3::Dot(src.Bitangent, decoded.Bitangent) > 0.99f;
+
+        const bool passed = positionError <= maxPositionError && normalAngle <= maxDirectionAngle &&
+                            tangentAngle <= maxDirectionAngle && uvError <= maxUVError && signStored && signDecoded;
+        if(passed == false)
+        {
+            if(numFailures == 0)
+            {
+                WriteLog("Packed vertex %llu failed: position error %f (max %f), normal %f deg, tangent %f deg (max %f), UV error %f (max %f), bitangent sign %s",
+                         i, positionError, maxPositionError, RadToDeg(normalAngle), RadToDeg(tangentAngle), RadToDeg(maxDirectionAngle),
+                         uvError, maxUVError, signStored && signDecoded ? "ok" : "wrong");
+            }
+
+            ++numFailures;
+        }
+    }
+
+    // The aggregate numbers from the same helper that the model loader uses
+    const PackedVertexErrors errors = MeasurePackedVertexErrors(vertices.Data(), packedVertices.Data(), numVertices, posScale, posBias);
+    if(errors.NumBitangentSignErrors > 0)
+        ++numFailures;
+
+    WriteLog("Packed vertex round trip (%llu vertices): position %f, normal %f deg, tangent %f deg, UV %f, %llu flipped bitangents -> %s",
+             numVertices, errors.MaxPositionError, RadToDeg(errors.MaxNormalAngle), RadToDeg(errors.MaxTangentAngle),
+             errors.MaxUVError, errors.NumBitangentSignErrors, numFailures == 0 ? "PASSED" : "FAILED");
+
+    return numFailures == 0;
+}
+
 // == Model =======================================================================================
 
 void Model::CreateWithAssimp(const ModelLoadSettings& settings)
@@ -438,6 +778,8 @@ void Model::CreateWithAssimp(const ModelLoadSettings& settings)
     if(FileExists(filePath) == false)
         throw Exception(MakeString(L"Model file with path '%ls' does not exist", filePath));
 
+    vertexFormat = settings.VertexBufferFormat;
+
     const wstring cachePath = MakeModelCachePath(settings);
     if(FileExists(cachePath.c_str()))
     {
@@ -609,6 +951,12 @@ void Model::CreateWithAssimp(const ModelLoadSettings& settings)
         idxOffset += meshes[i].NumIndices() * indexSize;
     }
 
+    if(settings.GenerateMeshlets)
+        BuildMeshlets(settings.VerboseLogging);
+
+    if(settings.BuildTriangleBVH)
+        triangleBVH.BuildFromModelTriangles(*this);
+
     CreateBuffers();
 
     WriteLog("Finished loading scene '%ls'", filePath);
@@ -724,18 +1072,13 @@ void Model::CreateProcedural(const ProceduralModelInit& init)
 
     LoadMaterialResources(meshMaterials, L"", init.ForceSRGB, materialTextures);
 
-    vertices.Init(init.NumVertices);
-    aabbMin = FloatMax;
-    aabbMax = -FloatMax;
+    vertexFormat = init.VertexBufferFormat;
 
+    vertices.Init(init.NumVertices);
     for(uint32 i = 0; i < init.NumVertices; ++i)
-    {
-        const MeshVertex& srcVtx = init.Vertices[i];
-        vertices[i] = srcVtx;
+        vertices[i] = init.Vertices[i];
 
-        aabbMin = Min(aabbMin, srcVtx.Position);
-        aabbMax = Max(aabbMax, srcVtx.Position);
-    }
+    ComputeBounds(&init.Vertices[0].Position, init.NumVertices, sizeof(MeshVertex), aabbMin, aabbMax);
 
     if(init.NumVertices > 64 * 1024)
     {
@@ -788,34 +1131,208 @@ void Model::Shutdown()
 
     vertexBuffer.Shutdown();
     indexBuffer.Shutdown();
+    vertexFormat = VertexFormat::Standard;
     vertices.Shutdown();
     indices.Shutdown();
+
+    meshletBuffer.Shutdown();
+    meshletVertexBuffer.Shutdown();
+    meshletTriangleBuffer.Shutdown();
+    meshlets.Shutdown();
+    meshletVertices.Shutdown();
+    meshletTriangles.Shutdown();
+
+    triangleBVH.Shutdown();
+}
+
+const D3D12_INPUT_ELEMENT_DESC* Model::InputElements(VertexFormat format)
+{
+    Assert_(uint64(format) < uint64(VertexFormat::NumValues));
+    return format == VertexFormat::Packed ? PackedInputElements : StandardInputElements;
 }
 
-const D3D12_INPUT_ELEMENT_DESC* Model::InputElements()
+const InputElementType* Model::InputElementTypes(VertexFormat format)
 {
-    return StandardInputElements;
+    Assert_(uint64(format) < uint64(VertexFormat::NumValues));
+    return format == VertexFormat::Packed ? PackedInputElementTypes : StandardInputElementTypes;
 }
 
-const InputElementType* Model::InputElementTypes()
+uint64 Model::NumInputElements(VertexFormat format)
 {
-    return StandardInputElementTypes;
+    Assert_(uint64(format) < uint64(VertexFormat::NumValues));
+    return format == VertexFormat::Packed ? ArraySize_(PackedInputElements) : ArraySize_(StandardInputElements);
 }
 
-uint64 Model::NumInputElements()
+uint32 Model::VertexStride(VertexFormat format)
 {
-    return ArraySize_(StandardInputElements);
+    Assert_(uint64(format) < uint64(VertexFormat::NumValues));
+    return format == VertexFormat::Packed ? sizeof(PackedMeshVertex) : sizeof(MeshVertex);
+}
+
+struct MeshletBuildTaskArgs
+{
+    const Mesh* Meshes = nullptr;
+    const MeshVertex* Vertices = nullptr;
+    const uint8* Indices = nullptr;
+    const uint64* VertexStarts = nullptr;
+    const uint64* IndexStarts = nullptr;
+    IndexType IdxType = IndexType::Index16Bit;
+
+    List<Meshlet>* MeshMeshlets = nullptr;
+    List<uint32>* MeshMeshletVertices = nullptr;
+    List<uint32>* MeshMeshletTriangles = nullptr;
+};
+
+static void MeshletBuildTask(uint32 start, uint32 end, uint32 threadNum, void* args_)
+{
+    const MeshletBuildTaskArgs* args = reinterpret_cast<const MeshletBuildTaskArgs*>(args_);
+    for(uint32 meshIdx = start; meshIdx < end; ++meshIdx)
+    {
+        const Mesh& mesh = args->Meshes[meshIdx];
+        const uint64 idxStart = args->IndexStarts[meshIdx];
+
+        Array<uint32> meshIndices(mesh.NumIndices());
+        for(uint64 i = 0; i < mesh.NumIndices(); ++i)
+        {
+            if(args->IdxType == IndexType::Index16Bit)
+                meshIndices[i] = reinterpret_cast<const uint16*>(args->Indices)[idxStart + i];
+            else
+                meshIndices[i] = reinterpret_cast<const uint32*>(args->Indices)[idxStart + i];
+        }
+
+        List<Meshlet>& meshlets = args->MeshMeshlets[meshIdx];
+        BuildMeshlets(&args->Vertices[args->VertexStarts[meshIdx]], mesh.NumVertices(), meshIndices.Data(), meshIndices.Size(),
+                      meshlets, args->MeshMeshletVertices[meshIdx], args->MeshMeshletTriangles[meshIdx]);
+
+        for(Meshlet& meshlet : meshlets)
+            meshlet.MeshIdx = meshIdx;
+    }
+}
+
+void Model::BuildMeshlets(bool logStats)
+{
+    const uint64 numMeshes = meshes.Size();
+    if(numMeshes == 0)
+        return;
+
+    Timer timer;
+
+    Array<uint64> vertexStarts(numMeshes);
+    Array<uint64> indexStarts(numMeshes);
+    uint64 vtxOffset = 0;
+    uint64 idxOffset = 0;
+    for(uint64 i = 0; i < numMeshes; ++i)
+    {
+        vertexStarts[i] = vtxOffset;
+        indexStarts[i] = idxOffset;
+        vtxOffset += meshes[i].NumVertices();
+        idxOffset += meshes[i].NumIndices();
+    }
+
+    // Meshes are independent, so they're built in parallel into separate lists that get merged afterwards
+    Array<List<Meshlet>> meshMeshlets(numMeshes);
+    Array<List<uint32>> meshMeshletVertices(numMeshes);
+    Array<List<uint32>> meshMeshletTriangles(numMeshes);
+
+    MeshletBuildTaskArgs args;
+    args.Meshes = meshes.Data();
+    args.Vertices = vertices.Data();
+    args.Indices = indices.Data();
+    args.VertexStarts = vertexStarts.Data();
+    args.IndexStarts = indexStarts.Data();
+    args.IdxType = indexType;
+    args.MeshMeshlets = meshMeshlets.Data();
+    args.MeshMeshletVertices = meshMeshletVertices.Data();
+    args.MeshMeshletTriangles = meshMeshletTriangles.Data();
+    Tasks::ParallelFor(uint32(numMeshes), 1, MeshletBuildTask, &args);
+
+    uint64 numMeshlets = 0;
+    uint64 numMeshletVertices = 0;
+    uint64 numMeshletTriangles = 0;
+    for(uint64 i = 0; i < numMeshes; ++i)
+    {
+        numMeshlets += meshMeshlets[i].Count();
+        numMeshletVertices += meshMeshletVertices[i].Count();
+        numMeshletTriangles += meshMeshletTriangles[i].Count();
+    }
+
+    meshlets.Init(numMeshlets);
+    meshletVertices.Init(numMeshletVertices);
+    meshletTriangles.Init(numMeshletTriangles);
+
+    uint64 meshletOffset = 0;
+    uint64 meshletVtxOffset = 0;
+    uint64 meshletTriOffset = 0;
+    for(uint64 i = 0; i < numMeshes; ++i)
+    {
+        Mesh& mesh = meshes[i];
+        mesh.meshletOffset = uint32(meshletOffset);
+        mesh.numMeshlets = uint32(meshMeshlets[i].Count());
+
+        for(const Meshlet& srcMeshlet : meshMeshlets[i])
+        {
+            Meshlet& dstMeshlet = meshlets[meshletOffset++];
+            dstMeshlet = srcMeshlet;
+            dstMeshlet.VertexOffset += uint32(meshletVtxOffset);
+            dstMeshlet.TriangleOffset += uint32(meshletTriOffset);
+        }
+
+        if(meshMeshletVertices[i].Count() > 0)
+            memcpy(&meshletVertices[meshletVtxOffset], meshMeshletVertices[i].Data(), meshMeshletVertices[i].Count() * sizeof(uint32));
+        if(meshMeshletTriangles[i].Count() > 0)
+            memcpy(&meshletTriangles[meshletTriOffset], meshMeshletTriangles[i].Data(), meshMeshletTriangles[i].Count() * sizeof(uint32));
+
+        meshletVtxOffset += meshMeshletVertices[i].Count();
+        meshletTriOffset += meshMeshletTriangles[i].Count();
+    }
+
+    timer.Update();
+    if(logStats)
+        WriteLog("Built %llu meshlets for %llu meshes in %.2fms", numMeshlets, numMeshes, timer.ElapsedMillisecondsD());
 }
 
 void Model::CreateBuffers()
 {
     Assert_(meshes.Size() > 0);
 
+    const uint32 vtxStride = VertexStride(vertexFormat);
+
     StructuredBufferInit sbInit;
-    sbInit.Stride = sizeof(MeshVertex);
-    sbInit.NumElements = vertices.Size();;
-    sbInit.InitData = vertices.Data();
-    vertexBuffer.Initialize(sbInit);
+    sbInit.Stride = vtxStride;
+    sbInit.NumElements = vertices.Size();
+
+    if(vertexFormat == VertexFormat::Packed)
+    {
+        ComputePositionDequantization(aabbMin, aabbMax, positionScale, positionBias);
+
+        Timer timer;
+        Array<PackedMeshVertex> packedVertices(vertices.Size());
+        EncodePackedVertices(vertices.Data(), vertices.Size(), positionScale, positionBias, packedVertices.Data());
+        timer.Update();
+
+        const double elapsedMS = timer.ElapsedMillisecondsD();
+        WriteLog("Packed %llu vertices in %.2fms (%.1f million vertices/sec)", vertices.Size(), elapsedMS,
+                 elapsedMS > 0.0 ? vertices.Size() / (elapsedMS * 1000.0) : 0.0);
+
+        #if Debug_
+            const PackedVertexErrors errors = MeasurePackedVertexErrors(vertices.Data(), packedVertices.Data(), vertices.Size(),
+                                                                        positionScale, positionBias);
+            WriteLog("Packed vertex errors: position %f, normal %f deg, tangent %f deg, UV %f, %llu flipped bitangents",
+                     errors.MaxPositionError, RadToDeg(errors.MaxNormalAngle), RadToDeg(errors.MaxTangentAngle),
+                     errors.MaxUVError, errors.NumBitangentSignErrors);
+        #endif
+
+        sbInit.InitData = packedVertices.Data();
+        vertexBuffer.Initialize(sbInit);
+    }
+    else
+    {
+        positionScale = Float3(1.0f);
+        positionBias = Float3(0.0f);
+
+        sbInit.InitData = vertices.Data();
+        vertexBuffer.Initialize(sbInit);
+    }
 
     const uint32 indexSize = IndexSize();
 
@@ -830,13 +1347,40 @@ void Model::CreateBuffers()
     const uint64 numMeshes = meshes.Size();
     for(uint64 i = 0; i < numMeshes; ++i)
     {
-        uint64 vbOffset = vtxOffset * sizeof(MeshVertex);
+        uint64 vbOffset = vtxOffset * vtxStride;
         uint64 ibOffset = idxOffset * indexSize;
-        meshes[i].InitCommon(&vertices[vtxOffset], &indices[ibOffset], vertexBuffer.GPUAddress + vbOffset, indexBuffer.GPUAddress + ibOffset, vtxOffset, idxOffset);
+        meshes[i].InitCommon(&vertices[vtxOffset], &indices[ibOffset], vertexBuffer.GPUAddress + vbOffset, indexBuffer.GPUAddress + ibOffset,
+                             vtxOffset, idxOffset, vtxStride);
+
+        meshes[i].meshlets = meshes[i].numMeshlets > 0 ? &meshlets[meshes[i].meshletOffset] : nullptr;
 
         vtxOffset += meshes[i].NumVertices();
         idxOffset += meshes[i].NumIndices();
     }
+
+    if(meshlets.Size() > 0)
+    {
+        StructuredBufferInit meshletInit;
+        meshletInit.Stride = sizeof(Meshlet);
+        meshletInit.NumElements = meshlets.Size();
+        meshletInit.InitData = meshlets.Data();
+        meshletInit.Name = L"Meshlet Buffer";
+        meshletBuffer.Initialize(meshletInit);
+
+        FormattedBufferInit meshletVtxInit;
+        meshletVtxInit.Format = DXGI_FORMAT_R32_UINT;
+        meshletVtxInit.NumElements = meshletVertices.Size();
+        meshletVtxInit.InitData = meshletVertices.Data();
+        meshletVtxInit.Name = L"Meshlet Vertex Buffer";
+        meshletVertexBuffer.Initialize(meshletVtxInit);
+
+        FormattedBufferInit meshletTriInit;
+        meshletTriInit.Format = DXGI_FORMAT_R32_UINT;
+        meshletTriInit.NumElements = meshletTriangles.Size();
+        meshletTriInit.InitData = meshletTriangles.Data();
+        meshletTriInit.Name = L"Meshlet Triangle Buffer";
+        meshletTriangleBuffer.Initialize(meshletTriInit);
+    }
 }
 
 // == Geometry helpers ============================================================================
@@ -16,6 +16,7 @@
 #include "..\\Serialization.h"
 #include "..\\Containers.h"
 #include "GraphicsTypes.h"
+#include "BVH.h"
 
 struct aiMesh;
 
@@ -64,6 +65,51 @@ struct MeshVertex
     }
 };
 
+// Compact vertex layout that can optionally be used for a model's GPU vertex buffer (20 bytes vs. 56):
+//  - Position: snorm16 xyz relative to the model's AABB, with the bitangent sign in w
+//  - Normal/Tangent: octahedral-encoded snorm16 pairs
+//  - UV: half-precision floats
+struct PackedMeshVertex
+{
+    int16 Position[4];
+    int16 Normal[2];
+    int16 Tangent[2];
+    uint16 UV[2];
+};
+
+StaticAssert_(sizeof(PackedMeshVertex) == 20);
+
+enum class VertexFormat : uint32
+{
+    Standard = 0,   // MeshVertex
+    Packed,         // PackedMeshVertex
+
+    NumValues
+};
+
+// Maximum error introduced by packing a set of vertices
+struct PackedVertexErrors
+{
+    float MaxPositionError = 0.0f;
+    float MaxNormalAngle = 0.0f;        // In radians
+    float MaxTangentAngle = 0.0f;       // In radians
+    float MaxUVError = 0.0f;
+    uint64 NumBitangentSignErrors = 0;
+};
+
+// Packs vertices 4 at a time with SIMD. The position of a packed vertex is reconstructed as
+// (Position.xyz * posScale) + posBias, where scale and bias are computed from the AABB.
+void ComputePositionDequantization(const Float3& aabbMin, const Float3& aabbMax, Float3& posScale, Float3& posBias);
+void EncodePackedVertices(const MeshVertex* srcVertices, uint64 numVertices, const Float3& posScale, const Float3& posBias,
+                          PackedMeshVertex* dstVertices);
+MeshVertex DecodePackedVertex(const PackedMeshVertex& vertex, const Float3& posScale, const Float3& posBias);
+PackedVertexErrors MeasurePackedVertexErrors(const MeshVertex* srcVertices, const PackedMeshVertex* packedVertices, uint64 numVertices,
+                                             const Float3& posScale, const Float3& posBias);
+
+// Round-trips random vertices (including AABB corners, axis-aligned and z = 0 normals, and flipped bitangents) through
+// the packed format, and checks every vertex against the error bounds of the quantization. Returns false on any failure.
+bool ValidatePackedVertices(uint64 numVertices = 4099);
+
 enum class MaterialTextures
 {
     Albedo = 0,
@@ -113,6 +159,25 @@ struct MeshPart
     }
 };
 
+// A small cluster of triangles with bounds for culling, laid out so that it can be used directly
+// in a structured buffer. Vertex and triangle offsets index into the model's meshlet vertex and
+// triangle buffers, and meshlet vertices are relative to the mesh's vertex offset.
+struct Meshlet
+{
+    Float3 BoundsCenter;
+    float BoundsRadius = 0.0f;
+    Float3 ConeAxis;
+    float ConeCutoff = 1.0f;        // Back-facing if dot(normalize(ConeApex - cameraPos), ConeAxis) >= ConeCutoff
+    Float3 ConeApex;
+    uint32 VertexOffset = 0;
+    uint32 VertexCount = 0;
+    uint32 TriangleOffset = 0;
+    uint32 TriangleCount = 0;
+    uint32 MeshIdx = 0;
+};
+
+StaticAssert_(sizeof(Meshlet) == 64);
+
 enum class IndexType
 {
     Index16Bit = 0,
@@ -177,7 +242,8 @@ public:
                    const Quaternion& orientation, uint32 materialIdx,
                    MeshVertex* dstVertices, uint16* dstIndices);
 
-    void InitCommon(const MeshVertex* vertices, const uint8* indices, uint64 vbAddress, uint64 ibAddress, uint64 vtxOffset, uint64 idxOffset);
+    void InitCommon(const MeshVertex* vertices, const uint8* indices, uint64 vbAddress, uint64 ibAddress, uint64 vtxOffset, uint64 idxOffset,
+                    uint64 vtxStride = sizeof(MeshVertex));
 
     void Shutdown();
 
@@ -213,6 +279,10 @@ public:
     const Float3& AABBMin() const { return aabbMin; }
     const Float3& AABBMax() const { return aabbMax; }
 
+    const Meshlet* Meshlets() const { return meshlets; }
+    uint32 NumMeshlets() const { return numMeshlets; }
+    uint32 MeshletOffset() const { return meshletOffset; }
+
     static const char* InputElementTypeString(InputElementType elemType);
 
     template<typename TSerializer> void Serialize(TSerializer& serializer)
@@ -227,6 +297,8 @@ public:
         indexType = IndexType(idxType);
         SerializeItem(serializer, aabbMin);
         SerializeItem(serializer, aabbMax);
+        SerializeItem(serializer, meshletOffset);
+        SerializeItem(serializer, numMeshlets);
     }
 
 protected:
@@ -243,6 +315,10 @@ protected:
     const MeshVertex* vertices = nullptr;
     const uint8* indices = nullptr;
 
+    const Meshlet* meshlets = nullptr;
+    uint32 meshletOffset = 0;
+    uint32 numMeshlets = 0;
+
     D3D12_VERTEX_BUFFER_VIEW vbView = { };
     D3D12_INDEX_BUFFER_VIEW ibView = { };
 
@@ -258,6 +334,11 @@ struct ModelLoadSettings
     bool ForceSRGB = false;
     bool MergeMeshes = true;
     bool ConvertFromZUp = false;
+    bool OptimizeMeshes = true;     // Re-order triangles and vertices for the vertex cache, overdraw and fetch locality
+    VertexFormat VertexBufferFormat = VertexFormat::Standard;
+    bool GenerateMeshlets = false;  // Build meshlets with bounds and normal cones, for meshlet-based culling
+    bool BuildTriangleBVH = false;  // Build a BVH over all triangles, for CPU-side ray and nearest-point queries
+    bool VerboseLogging = false;    // Log per-mesh statistics while loading (doesn't affect the model cache key)
 };
 
 struct ProceduralModelInit
@@ -268,6 +349,7 @@ struct ProceduralModelInit
     uint32 NumIndices = 0;
     const wchar* TexturePaths[uint64(MaterialTextures::Count)] = { };
     bool ForceSRGB = false;
+    VertexFormat VertexBufferFormat = VertexFormat::Standard;
 };
 
 class Model
@@ -320,13 +402,32 @@ public:
     const StructuredBuffer& VertexBuffer() const { return vertexBuffer; }
     const FormattedBuffer& IndexBuffer() const { return indexBuffer; }
 
+    // Meshlets for all meshes, only built on import when ModelLoadSettings::GenerateMeshlets is set (and stored in the model cache)
+    const Array<Meshlet>& Meshlets() const { return meshlets; }
+    const StructuredBuffer& MeshletBuffer() const { return meshletBuffer; }
+    const FormattedBuffer& MeshletVertexBuffer() const { return meshletVertexBuffer; }
+    const FormattedBuffer& MeshletTriangleBuffer() const { return meshletTriangleBuffer; }
+
+    // BVH over all triangles for CPU-side queries, where primitive indices are triangle indices into the index buffer.
+    // Only built on import when ModelLoadSettings::BuildTriangleBVH is set (and stored in the model cache).
+    const BVH& TriangleBVH() const { return triangleBVH; }
+
     const MeshVertex* Vertices() const { return vertices.Data(); }
     const uint16* Indices() const { Assert_(indexType == IndexType::Index16Bit); return (const uint16*)indices.Data(); }
     const uint32* Indices32() const { Assert_(indexType == IndexType::Index32Bit); return (const uint32*)indices.Data(); }
 
-    static const D3D12_INPUT_ELEMENT_DESC* InputElements();
-    static const InputElementType* InputElementTypes();
-    static uint64 NumInputElements();
+    static const D3D12_INPUT_ELEMENT_DESC* InputElements(VertexFormat format = VertexFormat::Standard);
+    static const InputElementType* InputElementTypes(VertexFormat format = VertexFormat::Standard);
+    static uint64 NumInputElements(VertexFormat format = VertexFormat::Standard);
+    static uint32 VertexStride(VertexFormat format);
+
+    // The format of the GPU vertex buffer. CPU-side vertices are always full-precision MeshVertex.
+    VertexFormat VertexBufferFormat() const { return vertexFormat; }
+    DXGI_FORMAT VertexPositionFormat() const { return vertexFormat == VertexFormat::Packed ? DXGI_FORMAT_R16G16B16A16_SNORM : DXGI_FORMAT_R32G32B32_FLOAT; }
+
+    // Needed to reconstruct positions from a packed vertex buffer, identity otherwise
+    const Float3& PositionScale() const { return positionScale; }
+    const Float3& PositionBias() const { return positionBias; }
 
     IndexType IndexBufferType() const { return indexType; }
     DXGI_FORMAT IndexBufferFormat() const { return indexType == IndexType::Index32Bit ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT; }
@@ -349,10 +450,15 @@ public:
         uint32 idxType = uint32(indexType);
         SerializeItem(serializer, idxType);
         indexType = IndexType(idxType);
+        BulkSerializeItem(serializer, meshlets);
+        BulkSerializeItem(serializer, meshletVertices);
+        BulkSerializeItem(serializer, meshletTriangles);
+        SerializeItem(serializer, triangleBVH);
     }
 
 protected:
 
+    void BuildMeshlets(bool logStats);
     void CreateBuffers();
 
     Array<Mesh> meshes;
@@ -366,10 +472,22 @@ protected:
 
     StructuredBuffer vertexBuffer;
     FormattedBuffer indexBuffer;
+    VertexFormat vertexFormat = VertexFormat::Standard;
+    Float3 positionScale = Float3(1.0f);
+    Float3 positionBias;
     Array<MeshVertex> vertices;
     Array<uint8> indices;
     IndexType indexType = IndexType::Index16Bit;
 
+    StructuredBuffer meshletBuffer;
+    FormattedBuffer meshletVertexBuffer;
+    FormattedBuffer meshletTriangleBuffer;
+    Array<Meshlet> meshlets;
+    Array<uint32> meshletVertices;
+    Array<uint32> meshletTriangles;
+
+    BVH triangleBVH;
+
     List<MaterialTexture*> materialTextures;
 };
 
@@ -0,0 +1,572 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "PipelineStateMap.h"
+#include "..\\Timer.h"
+#include "..\\Utility.h"
+
+namespace SampleFramework12
+{
+
+static const uint64 MinMapCapacity = 64;
+
+// Only for types without any padding
+template<typename T> static void HashValue(Hasher& hasher, const T& value)
+{
+    hasher.Update(&value, sizeof(T));
+}
+
+static void HashString(Hasher& hasher, const char* str)
+{
+    // Include the terminator so that "AB" + "C" doesn't match "A" + "BC"
+    const uint64 len = str != nullptr ? strlen(str) + 1 : 0;
+    HashValue(hasher, len);
+    if(len > 0)
+        hasher.Update(str, len);
+}
+
+static void HashDepthStencilOp(Hasher& hasher, const D3D12_DEPTH_STENCILOP_DESC& desc)
+{
+    HashValue(hasher, desc.StencilFailOp);
+    HashValue(hasher, desc.StencilDepthFailOp);
+    HashValue(hasher, desc.StencilPassOp);
+    HashValue(hasher, desc.StencilFunc);
+}
+
+Hash HashShaderByteCode(const D3D12_SHADER_BYTECODE& byteCode)
+{
+    if(byteCode.pShaderBytecode == nullptr || byteCode.BytecodeLength == 0)
+        return Hash();
+
+    return GenerateHash(byteCode.pShaderBytecode, byteCode.BytecodeLength);
+}
+
+Hash HashGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    Hasher hasher;
+
+    const D3D12_STREAM_OUTPUT_DESC& so = desc.StreamOutput;
+    HashValue(hasher, so.NumEntries);
+    for(uint32 i = 0; i < so.NumEntries; ++i)
+    {
+        const D3D12_SO_DECLARATION_ENTRY& entry = so.pSODeclaration[i];
+        HashValue(hasher, entry.Stream);
+        HashString(hasher, entry.SemanticName);
+        HashValue(hasher, entry.SemanticIndex);
+        HashValue(hasher, entry.StartComponent);
+        HashValue(hasher, entry.ComponentCount);
+        HashValue(hasher, entry.OutputSlot);
+    }
+    HashValue(hasher, so.NumStrides);
+    if(so.NumStrides > 0)
+        hasher.Update(so.pBufferStrides, so.NumStrides * sizeof(uint32));
+    HashValue(hasher, so.RasterizedStream);
+
+    const D3D12_BLEND_DESC& blend = desc.BlendState;
+    HashValue(hasher, blend.AlphaToCoverageEnable);
+    HashValue(hasher, blend.IndependentBlendEnable);
+    for(uint64 i = 0; i < ArraySize_(blend.RenderTarget); ++i)
+    {
+        const D3D12_RENDER_TARGET_BLEND_DESC& rt = blend.RenderTarget[i];
+        HashValue(hasher, rt.BlendEnable);
+        HashValue(hasher, rt.LogicOpEnable);
+        HashValue(hasher, rt.SrcBlend);
+        HashValue(hasher, rt.DestBlend);
+        HashValue(hasher, rt.BlendOp);
+        HashValue(hasher, rt.SrcBlendAlpha);
+        HashValue(hasher, rt.DestBlendAlpha);
+        HashValue(hasher, rt.BlendOpAlpha);
+        HashValue(hasher, rt.LogicOp);
+        HashValue(hasher, rt.RenderTargetWriteMask);
+    }
+
+    HashValue(hasher, desc.SampleMask);
+    HashValue(hasher, desc.RasterizerState);
+
+    const D3D12_DEPTH_STENCIL_DESC& depth = desc.DepthStencilState;
+    HashValue(hasher, depth.DepthEnable);
+    HashValue(hasher, depth.DepthWriteMask);
+    HashValue(hasher, depth.DepthFunc);
+    HashValue(hasher, depth.StencilEnable);
+    HashValue(hasher, depth.StencilReadMask);
+    HashValue(hasher, depth.StencilWriteMask);
+    HashDepthStencilOp(hasher, depth.FrontFace);
+    HashDepthStencilOp(hasher, depth.BackFace);
+
+    const D3D12_INPUT_LAYOUT_DESC& inputLayout = desc.InputLayout;
+    HashValue(hasher, inputLayout.NumElements);
+    for(uint32 i = 0; i < inputLayout.NumElements; ++i)
+    {
+        const D3D12_INPUT_ELEMENT_DESC& element = inputLayout.pInputElementDescs[i];
+        HashString(hasher, element.SemanticName);
+        HashValue(hasher, element.SemanticIndex);
+        HashValue(hasher, element.Format);
+        HashValue(hasher, element.InputSlot);
+        HashValue(hasher, element.AlignedByteOffset);
+        HashValue(hasher, element.InputSlotClass);
+        HashValue(hasher, element.InstanceDataStepRate);
+    }
+
+    HashValue(hasher, desc.IBStripCutValue);
+    HashValue(hasher, desc.PrimitiveTopologyType);
+    HashValue(hasher, desc.NumRenderTargets);
+    for(uint32 i = 0; i < desc.NumRenderTargets; ++i)
+        HashValue(hasher, desc.RTVFormats[i]);
+    HashValue(hasher, desc.DSVFormat);
+    HashValue(hasher, desc.SampleDesc);
+    HashValue(hasher, desc.NodeMask);
+    HashValue(hasher, desc.Flags);
+
+    return hasher.Finalize();
+}
+
+Hash HashComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc)
+{
+    Hasher hasher;
+    HashValue(hasher, desc.NodeMask);
+    HashValue(hasher, desc.Flags);
+
+    return hasher.Finalize();
+}
+
+Hash MakeGraphicsPipelineKey(Hash rootSignatureHash, const GraphicsPipelineShaderHashes& shaderHashes, Hash stateHash)
+{
+    // Order matters here, so that swapping two shaders gives a different key
+    const Hash hashes[] = { rootSignatureHash, shaderHashes.VS, shaderHashes.PS, shaderHashes.DS,
+                            shaderHashes.HS, shaderHashes.GS, stateHash };
+    return GenerateHash(hashes, sizeof(hashes));
+}
+
+Hash MakeGraphicsPipelineKey(Hash rootSignatureHash, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    GraphicsPipelineShaderHashes shaderHashes;
+    shaderHashes.VS = HashShaderByteCode(desc.VS);
+    shaderHashes.PS = HashShaderByteCode(desc.PS);
+    shaderHashes.DS = HashShaderByteCode(desc.DS);
+    shaderHashes.HS = HashShaderByteCode(desc.HS);
+    shaderHashes.GS = HashShaderByteCode(desc.GS);
+
+    return MakeGraphicsPipelineKey(rootSignatureHash, shaderHashes, HashGraphicsPipelineState(desc));
+}
+
+Hash MakeComputePipelineKey(Hash rootSignatureHash, Hash csHash, Hash stateHash)
+{
+    // Tagged so that a compute key can never collide with a graphics key that only has a VS
+    const Hash hashes[] = { Hash(0, 1), rootSignatureHash, csHash, stateHash };
+    return GenerateHash(hashes, sizeof(hashes));
+}
+
+Hash MakeComputePipelineKey(Hash rootSignatureHash, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc)
+{
+    return MakeComputePipelineKey(rootSignatureHash, HashShaderByteCode(desc.CS), HashComputePipelineState(desc));
+}
+
+// == PipelineStateMap ============================================================================
+
+const PipelineStateMap::Slot* PipelineStateMap::FindSlot(Hash key) const
+{
+    if(count == 0)
+        return nullptr;
+
+    const uint64 mask = slots.Size() - 1;
+    for(uint64 slotIdx = key.A & mask; ; slotIdx = (slotIdx + 1) & mask)
+    {
+        const Slot& slot = slots[slotIdx];
+        if(slot.PSO == nullptr)
+            return nullptr;
+        if(slot.Key == key)
+            return &slot;
+    }
+}
+
+ID3D12PipelineState* PipelineStateMap::Find(Hash key) const
+{
+    const Slot* slot = FindSlot(key);
+    return slot != nullptr ? slot->PSO : nullptr;
+}
+
+ID3D12PipelineState* PipelineStateMap::Find(Hash key, uint64 epoch)
+{
+    Slot* slot = const_cast<Slot*>(FindSlot(key));
+    if(slot == nullptr)
+        return nullptr;
+
+    // Only write when it changes, so that threads hitting the same PSO every frame don't fight over the cache line
+    // Nothing else is published through it, so relaxed ordering is enough
+    if(slot->LastUsed.load(std::memory_order_relaxed) != epoch)
+        slot->LastUsed.store(epoch, std::memory_order_relaxed);
+
+    return slot->PSO;
+}
+
+void PipelineStateMap::Insert(Hash key, ID3D12PipelineState* pso, uint64 epoch)
+{
+    Assert_(pso != nullptr);
+
+    // Keep the load factor at or below 1/2 so that probe sequences stay short
+    if((count + 1) * 2 > slots.Size())
+        Rehash(Max(slots.Size() * 2, MinMapCapacity));
+
+    const uint64 mask = slots.Size() - 1;
+    uint64 slotIdx = key.A & mask;
+    while(slots[slotIdx].PSO != nullptr)
+    {
+        Assert_(!(slots[slotIdx].Key == key));
+        slotIdx = (slotIdx + 1) & mask;
+    }
+
+    slots[slotIdx].Key = key;
+    slots[slotIdx].PSO = pso;
+    slots[slotIdx].LastUsed.store(epoch, std::memory_order_relaxed);
+    count += 1;
+}
+
+void PipelineStateMap::Clear()
+{
+    slots.Shutdown();
+    count = 0;
+}
+
+void PipelineStateMap::Rehash(uint64 capacity)
+{
+    Array<Slot> oldSlots = std::move(slots);
+
+    slots.Init(capacity);
+    count = 0;
+
+    for(uint64 i = 0; i < oldSlots.Size(); ++i)
+        if(oldSlots[i].PSO != nullptr)
+            Insert(oldSlots[i].Key, oldSlots[i].PSO, oldSlots[i].LastUsed.load(std::memory_order_relaxed));
+}
+
+// == Benchmark ===================================================================================
+
+void BenchmarkPipelineStateMap(uint64 numPSOs)
+{
+    WriteLog("Pipeline state map benchmark (%llu PSOs)", numPSOs);
+
+    const D3D12_INPUT_ELEMENT_DESC inputElements[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+        { "UV", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+    };
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = { };
+    psoDesc.SampleMask = UINT_MAX;
+    psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    psoDesc.NumRenderTargets = 3;
+    psoDesc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+    psoDesc.RTVFormats[1] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    psoDesc.RTVFormats[2] = DXGI_FORMAT_R10G10B10A2_UNORM;
+    psoDesc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+    psoDesc.SampleDesc.Count = 1;
+    psoDesc.InputLayout.pInputElementDescs = inputElements;
+    psoDesc.InputLayout.NumElements = ArraySize_(inputElements);
+
+    const uint64 numIterations = 10000;
+    Hash stateHash;
+
+    Timer timer;
+    for(uint64 i = 0; i < numIterations; ++i)
+    {
+        psoDesc.RasterizerState.DepthBias = int32(i);
+        stateHash = CombineHashes(stateHash, HashGraphicsPipelineState(psoDesc));
+    }
+    timer.Update();
+    const double stateHashNS = timer.ElapsedMicrosecondsD() * 1000.0 / numIterations;
+
+    // Fake PSO pointers are fine here, since the map never dereferences them
+    Array<Hash> keys(numPSOs);
+    PipelineStateMap map;
+    for(uint64 i = 0; i < numPSOs; ++i)
+    {
+        GraphicsPipelineShaderHashes shaderHashes;
+        shaderHashes.VS = Hash(i / 16, 0);
+        shaderHashes.PS = Hash(i, 1);
+        keys[i] = MakeGraphicsPipelineKey(Hash(), shaderHashes, stateHash);
+        map.Insert(keys[i], reinterpret_cast<ID3D12PipelineState*>((i + 1) * 16));
+    }
+
+    const uint64 numLookups = 1000000;
+    uint64 numFound = 0;
+
+    timer.Update();
+    for(uint64 i = 0; i < numLookups; ++i)
+    {
+        const Hash& key = keys[(i * 7919) % numPSOs];
+        numFound += map.Find(key) != nullptr ? 1 : 0;
+    }
+    timer.Update();
+    const double mapNS = timer.DeltaMicrosecondsD() * 1000.0 / numLookups;
+
+    const uint64 numLinearLookups = numLookups / 100;
+    for(uint64 i = 0; i < numLinearLookups; ++i)
+    {
+        const Hash& key = keys[(i * 7919) % numPSOs];
+        for(uint64 j = 0; j < numPSOs; ++j)
+        {
+            if(keys[j] == key)
+            {
+                numFound += 1;
+                break;
+            }
+        }
+    }
+    timer.Update();
+    const double linearNS = timer.DeltaMicrosecondsD() * 1000.0 / numLinearLookups;
+
+    WriteLog("    State hash: %.1fns, map lookup: %.1fns (capacity %llu), linear search: %.1fns (%llu found)",
+             stateHashNS, mapNS, map.Capacity(), linearNS, numFound);
+}
+
+
+// == Validation ==================================================================================
+
+// Fills out the same description every time, on top of whatever garbage is already in the struct
+static void FillTestPipelineDesc(D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const D3D12_INPUT_ELEMENT_DESC* elements,
+                                 uint32 numElements, uint8 garbage)
+{
+    memset(&desc, garbage, sizeof(desc));
+    desc.pRootSignature = nullptr;
+    desc.VS = { };
+    desc.PS = { };
+    desc.DS = { };
+    desc.HS = { };
+    desc.GS = { };
+    desc.StreamOutput = { };
+    desc.BlendState = { };
+    desc.SampleMask = UINT_MAX;
+    desc.RasterizerState = { };
+    desc.RasterizerState.FillMode = D3D12_FILL_MODE_SOLID;
+    desc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
+    desc.DepthStencilState = { };
+    desc.DepthStencilState.DepthEnable = true;
+    desc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ALL;
+    desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_GREATER_EQUAL;
+    desc.InputLayout.pInputElementDescs = elements;
+    desc.InputLayout.NumElements = numElements;
+    desc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+    desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    desc.NumRenderTargets = 2;
+    desc.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    desc.RTVFormats[1] = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.NodeMask = 0;
+    desc.CachedPSO = { };
+    desc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
+}
+
+bool ValidatePipelineStateMap()
+{
+    bool passed = true;
+
+    // Keys can't depend on padding, on the unused RTV slots, or on where the semantic strings live
+    {
+        char semanticA[] = "POSITION";
+        char semanticB[] = "POSITION";
+        const D3D12_INPUT_ELEMENT_DESC elementsA[] = { { semanticA, 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } };
+        const D3D12_INPUT_ELEMENT_DESC elementsB[] = { { semanticB, 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 } };
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC descA;
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC descB;
+        FillTestPipelineDesc(descA, elementsA, ArraySize_(elementsA), 0x00);
+        FillTestPipelineDesc(descB, elementsB, ArraySize_(elementsB), 0xCD);
+
+        const Hash stateHash = HashGraphicsPipelineState(descA);
+        if((HashGraphicsPipelineState(descB) == stateHash) == false)
+        {
+            WriteLog("Identical pipeline descriptions hashed differently");
+            passed = false;
+        }
+
+        if((MakeGraphicsPipelineKey(Hash(), descA) == MakeGraphicsPipelineKey(Hash(), descB)) == false)
+        {
+            WriteLog("Identical pipeline descriptions produced different keys");
+            passed = false;
+        }
+
+        // Every one of these changes has to show up in the hash
+        struct Change
+        {
+            const char* Name;
+            void (*Apply)(D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+        };
+
+        const Change changes[] =
+        {
+            { "DepthBias", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.RasterizerState.DepthBias = 1; } },
+            { "BlendEnable", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.BlendState.RenderTarget[1].BlendEnable = true; } },
+            { "RTVFormats", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.RTVFormats[1] = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB; } },
+            { "NumRenderTargets", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.NumRenderTargets = 1; } },
+            { "DepthFunc", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS; } },
+            { "InputLayout", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.InputLayout.NumElements = 0; } },
+            { "SampleDesc", [](D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc) { desc.SampleDesc.Count = 4; } },
+        };
+
+        for(const Change& change : changes)
+        {
+            FillTestPipelineDesc(descB, elementsB, ArraySize_(elementsB), 0xCD);
+            change.Apply(descB);
+            if(HashGraphicsPipelineState(descB) == stateHash)
+            {
+                WriteLog("Changing %s didn't change the pipeline state hash", change.Name);
+                passed = false;
+            }
+        }
+
+        FillTestPipelineDesc(descB, elementsB, ArraySize_(elementsB), 0xCD);
+        descB.RTVFormats[5] = DXGI_FORMAT_R32_FLOAT;
+        if((HashGraphicsPipelineState(descB) == stateHash) == false)
+        {
+            WriteLog("An RTV format past NumRenderTargets changed the pipeline state hash");
+            passed = false;
+        }
+
+        semanticB[0] = 'Q';
+        FillTestPipelineDesc(descB, elementsB, ArraySize_(elementsB), 0xCD);
+        if(HashGraphicsPipelineState(descB) == stateHash)
+        {
+            WriteLog("Changing a semantic name didn't change the pipeline state hash");
+            passed = false;
+        }
+    }
+
+    // Shader and root signature hashes have to be kept apart by position, and compute keys can't collide
+    // with graphics keys
+    {
+        const uint8 byteCodeA[] = { 1, 2, 3, 4 };
+        const uint8 byteCodeB[] = { 4, 3, 2, 1 };
+        const Hash hashA = HashShaderByteCode({ byteCodeA, sizeof(byteCodeA) });
+        const Hash hashB = HashShaderByteCode({ byteCodeB, sizeof(byteCodeB) });
+        const Hash stateHash = Hash(5, 6);
+
+        if((HashShaderByteCode({ nullptr, 0 }) == Hash()) == false)
+        {
+            WriteLog("Missing shader stages didn't hash to an empty hash");
+            passed = false;
+        }
+
+        GraphicsPipelineShaderHashes shadersAB;
+        shadersAB.VS = hashA;
+        shadersAB.PS = hashB;
+        GraphicsPipelineShaderHashes shadersBA;
+        shadersBA.VS = hashB;
+        shadersBA.PS = hashA;
+        const Hash keyAB = MakeGraphicsPipelineKey(Hash(), shadersAB, stateHash);
+
+        if(MakeGraphicsPipelineKey(Hash(), shadersBA, stateHash) == keyAB)
+        {
+            WriteLog("Swapping the VS and PS didn't change the pipeline key");
+            passed = false;
+        }
+
+        if(MakeGraphicsPipelineKey(Hash(1, 0), shadersAB, stateHash) == keyAB)
+        {
+            WriteLog("Changing the root signature hash didn't change the pipeline key");
+            passed = false;
+        }
+
+        GraphicsPipelineShaderHashes vsOnly;
+        vsOnly.VS = hashA;
+        if(MakeComputePipelineKey(Hash(), hashA, stateHash) == MakeGraphicsPipelineKey(Hash(), vsOnly, stateHash))
+        {
+            WriteLog("A compute pipeline key matched a graphics pipeline key");
+            passed = false;
+        }
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = { };
+        desc.VS = { byteCodeA, sizeof(byteCodeA) };
+        desc.PS = { byteCodeB, sizeof(byteCodeB) };
+        if((MakeGraphicsPipelineKey(Hash(), desc) == MakeGraphicsPipelineKey(Hash(), shadersAB, HashGraphicsPipelineState(desc))) == false)
+        {
+            WriteLog("Keys built from a description didn't match keys built from known shader hashes");
+            passed = false;
+        }
+    }
+
+    // Find, grow, prune with RemoveIf, and re-insert. Fake PSO pointers are fine, since the map never
+    // dereferences them.
+    {
+        const uint64 numEntries = 1000;
+        auto fakePSO = [](uint64 i) { return reinterpret_cast<ID3D12PipelineState*>((i + 1) * 16); };
+        auto makeKey = [](uint64 i) { return MakeComputePipelineKey(Hash(), Hash(i, 0), Hash()); };
+
+        PipelineStateMap map;
+        for(uint64 i = 0; i < numEntries; ++i)
+            map.Insert(makeKey(i), fakePSO(i), 1);
+
+        bool allFound = true;
+        for(uint64 i = 0; i < numEntries; ++i)
+            allFound &= map.Find(makeKey(i)) == fakePSO(i);
+
+        if(allFound == false || map.Count() != numEntries || map.Count() * 2 > map.Capacity())
+        {
+            WriteLog("Pipeline state map lost entries while growing (%llu entries, capacity %llu)", map.Count(), map.Capacity());
+            passed = false;
+        }
+
+        if(map.Find(makeKey(numEntries)) != nullptr)
+        {
+            WriteLog("Pipeline state map found a key that was never inserted");
+            passed = false;
+        }
+
+        // Touch every third entry in a later epoch, then prune everything that wasn't touched
+        for(uint64 i = 0; i < numEntries; i += 3)
+            map.Find(makeKey(i), 2);
+
+        const uint64 numRemoved = map.RemoveIf([](Hash, ID3D12PipelineState*, uint64 lastUsed) { return lastUsed < 2; });
+        const uint64 numKept = (numEntries + 2) / 3;
+
+        bool prunedCorrectly = numRemoved == numEntries - numKept && map.Count() == numKept;
+        for(uint64 i = 0; i < numEntries; ++i)
+            prunedCorrectly &= map.Find(makeKey(i)) == (i % 3 == 0 ? fakePSO(i) : nullptr);
+
+        if(prunedCorrectly == false)
+        {
+            WriteLog("Pipeline state map pruned the wrong entries (%llu removed, %llu left)", numRemoved, map.Count());
+            passed = false;
+        }
+
+        // The kept entries have to remember when they were last used
+        const uint64 numRemovedAgain = map.RemoveIf([](Hash, ID3D12PipelineState*, uint64 lastUsed) { return lastUsed < 2; });
+        if(numRemovedAgain != 0)
+        {
+            WriteLog("Pipeline state map lost the last-used epoch while pruning");
+            passed = false;
+        }
+
+        for(uint64 i = 0; i < numEntries; ++i)
+            if(i % 3 != 0)
+                map.Insert(makeKey(i), fakePSO(i), 3);
+
+        allFound = map.Count() == numEntries;
+        for(uint64 i = 0; i < numEntries; ++i)
+            allFound &= map.Find(makeKey(i)) == fakePSO(i);
+
+        if(allFound == false)
+        {
+            WriteLog("Pipeline state map didn't find re-inserted entries after pruning");
+            passed = false;
+        }
+
+        map.Clear();
+    }
+
+    WriteLog("Pipeline state map validation %s", passed ? "passed" : "failed");
+
+    return passed;
+}
+
+}
@@ -0,0 +1,119 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\Containers.h"
+#include "..\\MurmurHash.h"
+
+#include <atomic>
+
+namespace SampleFramework12
+{
+
+// Hashes of the shaders used by a graphics PSO, for callers that already have them (CompiledShader::ByteCodeHash)
+// and don't want to re-hash the byte code on every lookup. Stages that aren't used are left as an empty hash.
+struct GraphicsPipelineShaderHashes
+{
+    Hash VS;
+    Hash PS;
+    Hash DS;
+    Hash HS;
+    Hash GS;
+};
+
+Hash HashShaderByteCode(const D3D12_SHADER_BYTECODE& byteCode);
+
+// Hashes everything in a PSO description except for the root signature and shaders, field by field so that
+// struct padding and pointers never end up in the hash
+Hash HashGraphicsPipelineState(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+Hash HashComputePipelineState(const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc);
+
+// Cache keys, which only depend on the contents of the descriptions (and so are stable from run to run)
+Hash MakeGraphicsPipelineKey(Hash rootSignatureHash, const GraphicsPipelineShaderHashes& shaderHashes, Hash stateHash);
+Hash MakeGraphicsPipelineKey(Hash rootSignatureHash, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+Hash MakeComputePipelineKey(Hash rootSignatureHash, Hash csHash, Hash stateHash);
+Hash MakeComputePipelineKey(Hash rootSignatureHash, const D3D12_COMPUTE_PIPELINE_STATE_DESC& desc);
+
+// Open-addressing hash map from a pipeline key to a PSO, with linear probing. The map doesn't hold a
+// reference to the PSOs. Each entry remembers the last "epoch" (a frame number, for the pipeline cache) that
+// it was looked up in, so that entries nobody has asked for in a while can be pruned with RemoveIf().
+class PipelineStateMap
+{
+
+public:
+
+    ID3D12PipelineState* Find(Hash key) const;
+
+    // Also marks the entry as used during 'epoch'. This only does a relaxed atomic store to the entry, so it's safe
+    // to call from multiple threads at once as long as nothing is inserting or removing.
+    ID3D12PipelineState* Find(Hash key, uint64 epoch);
+
+    // The key must not already be in the map
+    void Insert(Hash key, ID3D12PipelineState* pso, uint64 epoch = 0);
+
+    // Removes every entry for which func(key, pso, lastUsedEpoch) returns true, and returns how many were removed
+    template<typename TFunc> uint64 RemoveIf(TFunc func)
+    {
+        uint64 numRemoved = 0;
+        for(uint64 i = 0; i < slots.Size(); ++i)
+        {
+            if(slots[i].PSO != nullptr && func(slots[i].Key, slots[i].PSO, slots[i].LastUsed.load(std::memory_order_relaxed)))
+            {
+                slots[i].PSO = nullptr;
+                numRemoved += 1;
+            }
+        }
+
+        // Emptied slots would break the probe sequences of anything that was inserted after them
+        if(numRemoved > 0)
+            Rehash(slots.Size());
+
+        return numRemoved;
+    }
+
+    void Clear();
+
+    template<typename TFunc> void ForEach(TFunc func) const
+    {
+        for(uint64 i = 0; i < slots.Size(); ++i)
+            if(slots[i].PSO != nullptr)
+                func(slots[i].Key, slots[i].PSO);
+    }
+
+    uint64 Count() const { return count; }
+    uint64 Capacity() const { return slots.Size(); }
+
+protected:
+
+    struct Slot
+    {
+        Hash Key;
+        ID3D12PipelineState* PSO = nullptr;
+        std::atomic<uint64> LastUsed { 0 };     // Written by Find() under a shared lock, so it has to be atomic
+    };
+
+    const Slot* FindSlot(Hash key) const;
+    void Rehash(uint64 capacity);
+
+    Array<Slot> slots;
+    uint64 count = 0;
+};
+
+// Logs how long it takes to build a key for a typical PSO description, and to look it up in a
+// PipelineStateMap vs. a linear search through a list of hashes
+void BenchmarkPipelineStateMap(uint64 numPSOs = 1024);
+
+// Checks that keys only depend on the contents of the descriptions, and that the map finds, prunes and
+// re-finds entries correctly. Doesn't need a device.
+bool ValidatePipelineStateMap();
+
+}
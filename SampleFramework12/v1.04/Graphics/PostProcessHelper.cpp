@@ -15,6 +15,8 @@
 #include "ShaderCompilation.h"
 #include "DX12.h"
 #include "DX12_Helpers.h"
+#include "DX12_PipelineCache.h"
+#include "BarrierTracker.h"
 
 namespace AppSettings
 {
@@ -36,14 +38,37 @@ enum RootParams : uint32
     NumRootParams,
 };
 
+// Free temporary render targets that haven't been used for this many frames are destroyed in End()
+static const uint64 MaxIdleFrames = 60;
+
+// The request sequence needs to be the same for this many frames before an aliasing plan is built for it
+static const uint64 MinStableFrames = 2;
+
+static uint64 TempRTKey(uint32 width, uint32 height, DXGI_FORMAT format, bool useAsUAV)
+{
+    Assert_(width < (1 << 20) && height < (1 << 20));
+    return uint64(width) | (uint64(height) << 20) | (uint64(format) << 40) | (uint64(useAsUAV ? 1 : 0) << 60);
+}
+
+static RenderTextureInit TempRTInit(uint64 key)
+{
+    RenderTextureInit rtInit;
+    rtInit.Width = uint32(key & 0xFFFFF);
+    rtInit.Height = uint32((key >> 20) & 0xFFFFF);
+    rtInit.Format = DXGI_FORMAT((key >> 40) & 0xFFFFF);
+    rtInit.CreateUAV = ((key >> 60) & 1) != 0;
+    rtInit.InitialLayout = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE;
+    return rtInit;
+}
+
 PostProcessHelper::PostProcessHelper()
 {
 }
 
 PostProcessHelper::~PostProcessHelper()
 {
-    Assert_(tempRenderTargets.Count() == 0);
-    Assert_(pipelineStates.Count() == 0);
+    Assert_(tempRenderTargets.NumItems() == 0);
+    Assert_(aliasedRenderTargets.Count() == 0);
 }
 
 void PostProcessHelper::Initialize()
@@ -51,65 +76,82 @@ void PostProcessHelper::Initialize()
     // Load the shaders
     std::wstring fullScreenTriPath = SampleFrameworkDir() + L"Shaders\\FullScreenTriangle.hlsl";
     fullScreenTriVS = CompileFromFile(fullScreenTriPath.c_str(), "FullScreenTriangleVS", ShaderType::Vertex);
+
+    rootSignatureHash = DX12::GetRootSignatureHash(DX12::UniversalRootSignature);
 }
 
 void PostProcessHelper::Shutdown()
 {
     ClearCache();
+    lifetimeRecorder.Shutdown();
 }
 
 void PostProcessHelper::ClearCache()
 {
-    for(uint64 i = 0; i < tempRenderTargets.Count(); ++i)
+    List<TempRenderTarget*> removed;
+    tempRenderTargets.RemoveAll(removed);
+    for(uint64 i = 0; i < removed.Count(); ++i)
     {
-        TempRenderTarget* tempRT = tempRenderTargets[i];
+        TempRenderTarget* tempRT = removed[i];
         tempRT->RT.Shutdown();
         delete tempRT;
     }
+    removed.Shutdown();
 
-    tempRenderTargets.RemoveAll();
+    tempRTAllocInfos.clear();
 
-    for(uint64 i = 0; i < pipelineStates.Count(); ++i)
-        DX12::DeferredRelease(pipelineStates[i].PSO);
-
-    pipelineStates.RemoveAll();
+    ShutdownAliasing();
 }
 
 TempRenderTarget* PostProcessHelper::GetTempRenderTarget(uint32 width, uint32 height, DXGI_FORMAT format, bool useAsUAV)
 {
-    for(uint64 i = 0; i < tempRenderTargets.Count(); ++i)
+    const uint64 key = TempRTKey(width, height, format, useAsUAV);
+
+    TempRenderTarget* tempRT = nullptr;
+    uint32 requestIdx = uint32(-1);
+    if(cmdList != nullptr)
     {
-        TempRenderTarget* tempRT = tempRenderTargets[i];
-        if(tempRT->InUse)
-            continue;
-
-        const RenderTexture& rt = tempRT->RT;
-        if(rt.Texture.Width == width && rt.Texture.Height == height && rt.Texture.Format == format && useAsUAV == (rt.UAV != uint32(-1))) {
-            tempRT->InUse = true;
-            return tempRT;
-        }
+        const TempRTAllocInfo allocInfo = GetAllocInfo(key, width, height, format, useAsUAV);
+        requestIdx = lifetimeRecorder.Acquire(key, allocInfo.Size, allocInfo.Alignment);
+        tempRT = AcquireAliasedRenderTarget(key);
     }
 
-    RenderTextureInit rtInit;
-    rtInit.Width = width;
-    rtInit.Height = height;
-    rtInit.Format = format;
-    rtInit.CreateUAV = useAsUAV;
-    rtInit.InitialLayout = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE;
+    if(tempRT == nullptr)
+        tempRT = tempRenderTargets.Acquire(key, DX12::CurrentCPUFrame);
 
-    TempRenderTarget* tempRT = new TempRenderTarget();
-    tempRT->RT.Initialize(rtInit);
-    tempRT->RT.Texture.Resource->SetName(L"PP Temp Render Target");
-    tempRT->InUse = true;
-    tempRenderTargets.Add(tempRT);
+    if(tempRT == nullptr)
+    {
+        tempRT = new TempRenderTarget();
+        tempRT->RT.Initialize(TempRTInit(key));
+        tempRT->RT.Texture.Resource->SetName(L"PP Temp Render Target");
+        tempRT->InUse = true;
+        tempRT->LastUsedFrame = DX12::CurrentCPUFrame;
+        tempRenderTargets.Add(key, tempRT);
+    }
 
+    tempRT->RequestIdx = requestIdx;
     return tempRT;
 }
 
-void PostProcessHelper::Begin(ID3D12GraphicsCommandList* cmdList_)
+void PostProcessHelper::ReleaseTempRenderTarget(TempRenderTarget* tempRT)
+{
+    Assert_(tempRT != nullptr);
+    Assert_(tempRT->InUse);
+
+    if(cmdList != nullptr && tempRT->RequestIdx != uint32(-1))
+        lifetimeRecorder.Release(tempRT->RequestIdx);
+
+    tempRT->RequestIdx = uint32(-1);
+    tempRT->InUse = false;
+}
+
+void PostProcessHelper::Begin(ID3D12GraphicsCommandList7* cmdList_)
 {
     Assert_(cmdList == nullptr);
     cmdList = cmdList_;
+
+    lifetimeRecorder.BeginFrame();
+    aliasingDiverged = false;
 }
 
 void PostProcessHelper::End()
@@ -117,8 +159,178 @@ void PostProcessHelper::End()
     Assert_(cmdList != nullptr);
     cmdList = nullptr;
 
-    for(uint64 i = 0; i < tempRenderTargets.Count(); ++i)
-        Assert_(tempRenderTargets[i]->InUse == false);
+    tempRenderTargets.ForEach([](const TempRenderTarget* tempRT) { Assert_(tempRT->InUse == false); });
+    for(uint64 i = 0; i < aliasedRenderTargets.Count(); ++i)
+    {
+        Assert_(aliasedRenderTargets[i]->InUse == false);
+        aliasedRenderTargets[i]->RequestIdx = uint32(-1);
+    }
+
+    lifetimeRecorder.EndFrame();
+    UpdateAliasing();
+
+    List<TempRenderTarget*> evicted;
+    tempRenderTargets.EvictIdle(DX12::CurrentCPUFrame, MaxIdleFrames, evicted);
+    for(uint64 i = 0; i < evicted.Count(); ++i)
+    {
+        evicted[i]->RT.Shutdown();
+        delete evicted[i];
+    }
+    evicted.Shutdown();
+}
+
+TempRenderTargetStats PostProcessHelper::TempRenderTargetMemoryStats() const
+{
+    TempRenderTargetStats stats;
+    stats.NumCommitted = tempRenderTargets.NumItems();
+    tempRenderTargets.ForEach([&](const TempRenderTarget* tempRT)
+    {
+        const uint64 key = TempRTKey(tempRT->Width(), tempRT->Height(), tempRT->Format(), tempRT->RT.UAV != uint32(-1));
+        auto iter = tempRTAllocInfos.find(key);
+        if(iter != tempRTAllocInfos.end())
+            stats.CommittedSize += iter->second.Size;
+    });
+
+    if(aliasingHeap != nullptr)
+    {
+        stats.NumAliased = aliasedRenderTargets.Count();
+        stats.AliasedHeapSize = aliasingPlan.HeapSize;
+        stats.AliasedUnaliasedSize = aliasingPlan.UnaliasedSize;
+    }
+
+    return stats;
+}
+
+// Hands out the placed target for the current request if the frame is still following the aliasing plan
+TempRenderTarget* PostProcessHelper::AcquireAliasedRenderTarget(uint64 key)
+{
+    const uint64 requestIdx = lifetimeRecorder.NumRequests() - 1;
+    if(aliasingHeap == nullptr || aliasingDiverged || requestIdx >= aliasingPlan.NumResources() || aliasingPlan.Keys[requestIdx] != key)
+    {
+        aliasingDiverged = true;
+        return nullptr;
+    }
+
+    // A target that's still in use past the point where the plan expected it to be released would get stomped on
+    for(uint64 i = 0; i < aliasedRenderTargets.Count(); ++i)
+    {
+        if(i != requestIdx && aliasedRenderTargets[i]->InUse && aliasingPlan.MemoryOverlaps(i, requestIdx))
+        {
+            aliasingDiverged = true;
+            return nullptr;
+        }
+    }
+
+    TempRenderTarget* tempRT = aliasedRenderTargets[requestIdx];
+    Assert_(tempRT->InUse == false);
+    tempRT->InUse = true;
+    tempRT->LastUsedFrame = DX12::CurrentCPUFrame;
+
+    // The memory was last used by a different resource, so the contents need to be discarded before the target can be used
+    D3D12_TEXTURE_BARRIER barrier =
+    {
+        .SyncBefore = D3D12_BARRIER_SYNC_ALL,
+        .SyncAfter = D3D12_BARRIER_SYNC_ALL_SHADING | D3D12_BARRIER_SYNC_RENDER_TARGET,
+        .AccessBefore = D3D12_BARRIER_ACCESS_NO_ACCESS,
+        .AccessAfter = D3D12_BARRIER_ACCESS_SHADER_RESOURCE,
+        .LayoutBefore = D3D12_BARRIER_LAYOUT_UNDEFINED,
+        .LayoutAfter = D3D12_BARRIER_LAYOUT_DIRECT_QUEUE_SHADER_RESOURCE,
+        .pResource = tempRT->RT.Resource(),
+        .Subresources = { .IndexOrFirstMipLevel = uint32(-1) },
+        .Flags = D3D12_TEXTURE_BARRIER_FLAG_DISCARD,
+    };
+    DX12::Barrier(cmdList, barrier);
+
+    return tempRT;
+}
+
+// Rebuilds the aliased targets once the sequence of requests has settled on something new
+void PostProcessHelper::UpdateAliasing()
+{
+    if(lifetimeRecorder.NumStableFrames() < MinStableFrames || lifetimeRecorder.NumRequests() < 2)
+        return;
+
+    if(aliasingPlan.NumResources() > 0 && aliasingPlan.Signature == lifetimeRecorder.Signature())
+        return;
+
+    ShutdownAliasing();
+
+    const List<TransientLifetime>& lifetimes = lifetimeRecorder.Lifetimes();
+    PlanTransientAliasing(lifetimes.Data(), lifetimes.Count(), aliasingPlan);
+
+    // Keep the plan around (so that it isn't rebuilt every frame) but skip the heap if nothing could share memory
+    if(aliasingPlan.HeapSize >= aliasingPlan.UnaliasedSize)
+        return;
+
+    D3D12_HEAP_DESC heapDesc =
+    {
+        .SizeInBytes = aliasingPlan.HeapSize,
+        .Properties = *DX12::GetDefaultHeapProps(),
+        .Alignment = 0,
+        .Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES,
+    };
+    DXCall(DX12::Device->CreateHeap(&heapDesc, IID_PPV_ARGS(&aliasingHeap)));
+    aliasingHeap->SetName(L"PP Temp Render Target Heap");
+
+    aliasedRenderTargets.Reserve(aliasingPlan.NumResources());
+    for(uint64 i = 0; i < aliasingPlan.NumResources(); ++i)
+    {
+        RenderTextureInit rtInit = TempRTInit(aliasingPlan.Keys[i]);
+        rtInit.InitialLayout = D3D12_BARRIER_LAYOUT_UNDEFINED;
+        rtInit.Heap = aliasingHeap;
+        rtInit.HeapOffset = aliasingPlan.Offsets[i];
+
+        TempRenderTarget* tempRT = new TempRenderTarget();
+        tempRT->RT.Initialize(rtInit);
+        tempRT->RT.Texture.Resource->SetName(L"PP Aliased Temp Render Target");
+        aliasedRenderTargets.Add(tempRT);
+    }
+}
+
+void PostProcessHelper::ShutdownAliasing()
+{
+    for(uint64 i = 0; i < aliasedRenderTargets.Count(); ++i)
+    {
+        TempRenderTarget* tempRT = aliasedRenderTargets[i];
+        tempRT->RT.Shutdown();
+        delete tempRT;
+    }
+
+    aliasedRenderTargets.RemoveAll();
+    DX12::DeferredRelease(aliasingHeap);
+    aliasingPlan = TransientAliasingPlan();
+}
+
+PostProcessHelper::TempRTAllocInfo PostProcessHelper::GetAllocInfo(uint64 key, uint32 width, uint32 height, DXGI_FORMAT format, bool useAsUAV)
+{
+    auto iter = tempRTAllocInfos.find(key);
+    if(iter != tempRTAllocInfos.end())
+        return iter->second;
+
+    // Needs to match the description used by RenderTexture::Initialize
+    D3D12_RESOURCE_DESC1 textureDesc = { };
+    textureDesc.MipLevels = 1;
+    textureDesc.Format = format;
+    textureDesc.Width = width;
+    textureDesc.Height = height;
+    textureDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+    if(useAsUAV)
+        textureDesc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+    textureDesc.DepthOrArraySize = 1;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    textureDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    textureDesc.Alignment = 0;
+
+    const D3D12_RESOURCE_ALLOCATION_INFO info = DX12::Device->GetResourceAllocationInfo2(0, 1, &textureDesc, nullptr);
+
+    TempRTAllocInfo allocInfo;
+    allocInfo.Size = info.SizeInBytes;
+    allocInfo.Alignment = info.Alignment;
+    tempRTAllocInfos[key] = allocInfo;
+
+    return allocInfo;
 }
 
 void PostProcessHelper::PostProcess(CompiledShaderPtr pixelShader, const char* name, const RenderTexture& input, const RenderTexture& output)
@@ -149,12 +361,6 @@ void PostProcessHelper::PostProcess(CompiledShaderPtr pixelShader, const char* n
     PostProcess(pixelShader, name, inputs, 1, outputs, 1);
 }
 
-struct HashSource
-{
-    DXGI_FORMAT OutputFormats[8] = { };
-    uint64 MSAASamples = 0;
-};
-
 void PostProcessHelper::PostProcess(CompiledShaderPtr pixelShader, const char* name, const uint32* inputs, uint64 numInputs,
                                     const RenderTexture*const* outputs, uint64 numOutputs)
 {
@@ -166,52 +372,30 @@ void PostProcessHelper::PostProcess(CompiledShaderPtr pixelShader, const char* n
 
     PIXMarker marker(cmdList, name);
 
-    HashSource hashSource;
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
+    psoDesc.pRootSignature = DX12::UniversalRootSignature;
+    psoDesc.VS = fullScreenTriVS.ByteCode();
+    psoDesc.PS = pixelShader.ByteCode();
+    psoDesc.RasterizerState = DX12::GetRasterizerState(RasterizerState::NoCull);
+    psoDesc.BlendState = DX12::GetBlendState(BlendState::Disabled);
+    psoDesc.DepthStencilState = DX12::GetDepthState(DepthState::Disabled);
+    psoDesc.SampleMask = UINT_MAX;
+    psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    psoDesc.NumRenderTargets = uint32(numOutputs);
     for(uint64 i = 0; i < numOutputs; ++i)
     {
-        hashSource.OutputFormats[i] = outputs[i]->Texture.Format;
-        hashSource.MSAASamples = outputs[i]->MSAASamples;
+        psoDesc.RTVFormats[i] = outputs[i]->Texture.Format;
+        psoDesc.SampleDesc.Count = outputs[i]->MSAASamples;
     }
+    psoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
 
-    Hash psoHash = GenerateHash(&hashSource, sizeof(HashSource));
-    psoHash = CombineHashes(psoHash, pixelShader->ByteCodeHash);
+    // We already have hashes for the shaders, so only the fixed-function state needs hashing here
+    GraphicsPipelineShaderHashes shaderHashes;
+    shaderHashes.VS = fullScreenTriVS->ByteCodeHash;
+    shaderHashes.PS = pixelShader->ByteCodeHash;
+    const Hash psoKey = MakeGraphicsPipelineKey(rootSignatureHash, shaderHashes, HashGraphicsPipelineState(psoDesc));
 
-    ID3D12PipelineState* pso = nullptr;
-
-    // The most linear of searches!
-    const uint64 numPSOs = pipelineStates.Count();
-    for(uint64 i = 0; i < numPSOs; ++i)
-    {
-        if(pipelineStates[i].Hash == psoHash)
-        {
-            pso = pipelineStates[i].PSO;
-            break;
-        }
-    }
-
-    if(pso == nullptr)
-    {
-        D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = {};
-        psoDesc.pRootSignature = DX12::UniversalRootSignature;
-        psoDesc.VS = fullScreenTriVS.ByteCode();
-        psoDesc.PS = pixelShader.ByteCode();
-        psoDesc.RasterizerState = DX12::GetRasterizerState(RasterizerState::NoCull);
-        psoDesc.BlendState = DX12::GetBlendState(BlendState::Disabled);
-        psoDesc.DepthStencilState = DX12::GetDepthState(DepthState::Disabled);
-        psoDesc.SampleMask = UINT_MAX;
-        psoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-        psoDesc.NumRenderTargets = uint32(numOutputs);
-        for(uint64 i = 0; i < numOutputs; ++i)
-            psoDesc.RTVFormats[i] = hashSource.OutputFormats[i];
-        psoDesc.DSVFormat = DXGI_FORMAT_UNKNOWN;
-        psoDesc.SampleDesc.Count = uint32(hashSource.MSAASamples);
-        DXCall(DX12::Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pso)));
-
-        CachedPSO cachedPSO;
-        cachedPSO.Hash = psoHash;
-        cachedPSO.PSO = pso;
-        pipelineStates.Add(cachedPSO);
-    }
+    ID3D12PipelineState* pso = DX12::GetGraphicsPipelineState(psoDesc, psoKey);
 
     D3D12_CPU_DESCRIPTOR_HANDLE rtvHandles[8] = { };
     for(uint64 i = 0; i < numOutputs; ++i)
@@ -234,6 +418,7 @@ void PostProcessHelper::PostProcess(CompiledShaderPtr pixelShader, const char* n
     DX12::SetViewport(cmdList, outputs[0]->Texture.Width, outputs[0]->Texture.Height);
 
     cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    DX12::FlushBarriers(cmdList);
     cmdList->DrawInstanced(3, 1, 0, 0);
 
 }
@@ -15,6 +15,7 @@
 #include "..\\SF12_Math.h"
 #include "ShaderCompilation.h"
 #include "GraphicsTypes.h"
+#include "TransientResources.h"
 
 namespace SampleFramework12
 {
@@ -26,6 +27,17 @@ struct TempRenderTarget
     uint32 Height() const { return RT.Texture.Height; }
     DXGI_FORMAT Format() const { return RT.Texture.Format; }
     bool32 InUse = false;
+    uint64 LastUsedFrame = 0;
+    uint32 RequestIdx = uint32(-1);     // Index of the request within the current frame, if acquired between Begin() and End()
+};
+
+struct TempRenderTargetStats
+{
+    uint64 NumCommitted = 0;
+    uint64 CommittedSize = 0;
+    uint64 NumAliased = 0;
+    uint64 AliasedHeapSize = 0;
+    uint64 AliasedUnaliasedSize = 0;    // What the aliased targets would take up as separate allocations
 };
 
 class PostProcessHelper
@@ -41,11 +53,18 @@ public:
 
     void ClearCache();
 
+    // Temporary render targets are always handed out in the DIRECT_QUEUE_SHADER_RESOURCE layout, and their contents are
+    // undefined. Targets that are acquired between Begin() and End() may share memory with other temporary targets
+    // once the sequence of requests has been the same for a few frames, which is why releasing them through
+    // ReleaseTempRenderTarget() as soon as they're no longer needed (rather than clearing InUse) is preferred.
     TempRenderTarget* GetTempRenderTarget(uint32 width, uint32 height, DXGI_FORMAT format, bool useAsUAV = false);
+    void ReleaseTempRenderTarget(TempRenderTarget* tempRT);
 
-    void Begin(ID3D12GraphicsCommandList* cmdList);
+    void Begin(ID3D12GraphicsCommandList7* cmdList);
     void End();
 
+    TempRenderTargetStats TempRenderTargetMemoryStats() const;
+
     void PostProcess(CompiledShaderPtr pixelShader, const char* name, const RenderTexture& input, const RenderTexture& output);
     void PostProcess(CompiledShaderPtr pixelShader, const char* name, const RenderTexture& input, const TempRenderTarget* output);
     void PostProcess(CompiledShaderPtr pixelShader, const char* name, const TempRenderTarget* input, const RenderTexture& output);
@@ -55,19 +74,32 @@ public:
 
 protected:
 
-
-    struct CachedPSO
+    struct TempRTAllocInfo
     {
-        ID3D12PipelineState* PSO = nullptr;
-        Hash Hash;
+        uint64 Size = 0;
+        uint64 Alignment = 0;
     };
 
-    List<TempRenderTarget*> tempRenderTargets;
-    List<CachedPSO> pipelineStates;
+    TempRenderTarget* AcquireAliasedRenderTarget(uint64 key);
+    void UpdateAliasing();
+    void ShutdownAliasing();
+    TempRTAllocInfo GetAllocInfo(uint64 key, uint32 width, uint32 height, DXGI_FORMAT format, bool useAsUAV);
+
+    // Committed targets, looked up by descriptor and evicted once they've gone unused for a while
+    TransientPool<TempRenderTarget> tempRenderTargets;
+    std::unordered_map<uint64, TempRTAllocInfo> tempRTAllocInfos;
+
+    // Placed targets sharing a heap, one per request in the plan
+    TransientLifetimeRecorder lifetimeRecorder;
+    TransientAliasingPlan aliasingPlan;
+    ID3D12Heap* aliasingHeap = nullptr;
+    List<TempRenderTarget*> aliasedRenderTargets;
+    bool aliasingDiverged = false;
 
     CompiledShaderPtr fullScreenTriVS;
+    Hash rootSignatureHash;
 
-    ID3D12GraphicsCommandList* cmdList = nullptr;
+    ID3D12GraphicsCommandList7* cmdList = nullptr;
 };
 
 }
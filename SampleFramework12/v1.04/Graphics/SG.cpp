@@ -28,6 +28,11 @@
 #include "SG.h"
 #include "Textures.h"
 #include "..\\Containers.h"
+#include "..\\Tasks.h"
+#include "..\\Timer.h"
+#include "..\\Utility.h"
+
+using namespace DirectX;
 
 namespace SampleFramework12
 {
@@ -96,93 +101,159 @@ void GenerateUniformSGs(SG* outSGs, uint64 numSGs, SGDistribution distribution)
         outSGs[i].Sharpness = sharpness;
 }
 
-#if EnableEigen_
+// Sample directions and values stored as SoA, padded to a multiple of 4 so that the SG basis
+// functions can be evaluated for 4 samples at a time. Padding samples have a value of 0.
+struct SGSampleSet
+{
+    Array<float> DirX;
+    Array<float> DirY;
+    Array<float> DirZ;
+    Array<float> ValueR;
+    Array<float> ValueG;
+    Array<float> ValueB;
+    uint64 NumSamples = 0;
+    uint64 NumGroups = 0;
+};
 
-// Solve for SG's using non-negative least squares
-static void SolveNNLS(SGSolveParams& params)
+static void PrepareSamples(const SGSolveParams& params, bool normalizeDirs, SGSampleSet& samples)
 {
     Assert_(params.SampleDirs != nullptr);
     Assert_(params.SampleValues != nullptr);
 
-    // -- Linearly solve for the rgb channels one at a time
-    Eigen::MatrixXf Ar, Ag, Ab;
-    Ar.resize(params.NumSamples, int64(params.NumSGs));
-    Ag.resize(params.NumSamples, int64(params.NumSGs));
-    Ab.resize(params.NumSamples, int64(params.NumSGs));
-    Eigen::VectorXf br(params.NumSamples);
-    Eigen::VectorXf bg(params.NumSamples);
-    Eigen::VectorXf bb(params.NumSamples);
-    for(uint32 i = 0; i < params.NumSamples; ++i)
+    samples.NumSamples = params.NumSamples;
+    samples.NumGroups = (params.NumSamples + 3) / 4;
+
+    const uint64 paddedSize = samples.NumGroups * 4;
+    samples.DirX.Init(paddedSize, 0.0f);
+    samples.DirY.Init(paddedSize, 0.0f);
+    samples.DirZ.Init(paddedSize, 0.0f);
+    samples.ValueR.Init(paddedSize, 0.0f);
+    samples.ValueG.Init(paddedSize, 0.0f);
+    samples.ValueB.Init(paddedSize, 0.0f);
+
+    // The least squares solvers use the directions exactly as they're given. Projection normalizes them, which
+    // ProjectOntoSGs() does for every SG and sample, so here it's done once per sample up front instead.
+    for(uint64 i = 0; i < params.NumSamples; ++i)
+    {
+        const Float3 dir = normalizeDirs ? Float3::Normalize(params.SampleDirs[i]) : params.SampleDirs[i];
+        samples.DirX[i] = dir.x;
+        samples.DirY[i] = dir.y;
+        samples.DirZ[i] = dir.z;
+        samples.ValueR[i] = params.SampleValues[i].x;
+        samples.ValueG[i] = params.SampleValues[i].y;
+        samples.ValueB[i] = params.SampleValues[i].z;
+    }
+}
+
+// Evaluates exp(sharpness * (dot(dir, axis) - 1)) for a group of 4 samples
+static XMVECTOR EvaluateSGBasis(const SGSampleSet& samples, uint64 groupIdx, const SG& sg, XMVECTOR& cosTheta)
+{
+    const uint64 baseIdx = groupIdx * 4;
+    const XMVECTOR dirX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&samples.DirX[baseIdx]));
+    const XMVECTOR dirY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&samples.DirY[baseIdx]));
+    const XMVECTOR dirZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&samples.DirZ[baseIdx]));
+
+    cosTheta = XMVectorMultiply(dirX, XMVectorReplicate(sg.Axis.x));
+    cosTheta = XMVectorMultiplyAdd(dirY, XMVectorReplicate(sg.Axis.y), cosTheta);
+    cosTheta = XMVectorMultiplyAdd(dirZ, XMVectorReplicate(sg.Axis.z), cosTheta);
+
+    const XMVECTOR exponent = XMVectorMultiply(XMVectorSubtract(cosTheta, XMVectorSplatOne()), XMVectorReplicate(sg.Sharpness));
+    return XMVectorExpE(exponent);
+}
+
+static float HorizontalSum(FXMVECTOR v)
+{
+    XMFLOAT4 sum;
+    XMStoreFloat4(&sum, v);
+    return (sum.x + sum.y) + (sum.z + sum.w);
+}
+
+#if EnableEigen_
+
+// Builds the (NumSamples x NumSGs) matrix of SG basis function values, which is shared by all 3 color channels
+static void BuildDesignMatrix(const SGSampleSet& samples, const SGSolveParams& params, Eigen::MatrixXf& A)
+{
+    A.resize(int64(samples.NumSamples), int64(params.NumSGs));
+
+    // Eigen matrices are column-major, so each SG's column is contiguous and can be written 4 samples at a time
+    for(uint64 sgIdx = 0; sgIdx < params.NumSGs; ++sgIdx)
     {
-        // compute difference squared from actual observed data
-        for(uint32 j = 0; j < params.NumSGs; ++j)
+        float* column = A.col(int64(sgIdx)).data();
+        for(uint64 groupIdx = 0; groupIdx < samples.NumGroups; ++groupIdx)
         {
-            float exponent = exp((Float3::Dot(params.SampleDirs[i], params.OutSGs[j].Axis) - 1.0f) *
-                                 params.OutSGs[j].Sharpness);
-            Ar(i,j) = exponent;
-            Ag(i,j) = exponent;
-            Ab(i,j) = exponent;
+            XMVECTOR cosTheta;
+            const XMVECTOR basis = EvaluateSGBasis(samples, groupIdx, params.OutSGs[sgIdx], cosTheta);
+
+            const uint64 baseIdx = groupIdx * 4;
+            if(baseIdx + 4 <= samples.NumSamples)
+            {
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&column[baseIdx]), basis);
+            }
+            else
+            {
+                float values[4];
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(values), basis);
+                for(uint64 i = baseIdx; i < samples.NumSamples; ++i)
+                    column[i] = values[i - baseIdx];
+            }
         }
-        br(i) = params.SampleValues[i].x;
-        bg(i) = params.SampleValues[i].y;
-        bb(i) = params.SampleValues[i].z;
+    }
+}
+
+// Builds the (NumSamples x 3) matrix of sample colors, so that all channels can be solved at once
+static void BuildSampleMatrix(const SGSolveParams& params, Eigen::MatrixXf& B)
+{
+    B.resize(int64(params.NumSamples), 3);
+    for(uint64 i = 0; i < params.NumSamples; ++i)
+    {
+        B(i, 0) = params.SampleValues[i].x;
+        B(i, 1) = params.SampleValues[i].y;
+        B(i, 2) = params.SampleValues[i].z;
+    }
+}
+
+// Solve for SG's using non-negative least squares
+static void SolveNNLS(SGSolveParams& params, const SGSampleSet& samples)
+{
+    Eigen::MatrixXf A;
+    Eigen::MatrixXf B;
+    BuildDesignMatrix(samples, params, A);
+    BuildSampleMatrix(params, B);
+
+    // The solver caches A^T * A when it's constructed, so a single instance is re-used for every channel
+    Eigen::NNLS<Eigen::MatrixXf> nnls(A);
+    Eigen::VectorXf channels[3];
+    for(uint64 channel = 0; channel < 3; ++channel)
+    {
+        nnls.solve(B.col(channel));
+        channels[channel] = nnls.x();
     }
 
-    Eigen::NNLS<Eigen::MatrixXf> nnlsr(Ar);
-    Eigen::NNLS<Eigen::MatrixXf> nnlsg(Ag);
-    Eigen::NNLS<Eigen::MatrixXf> nnlsb(Ab);
-    nnlsr.solve(br);
-    nnlsg.solve(bg);
-    nnlsb.solve(bb);
-    Eigen::VectorXf rchan = nnlsr.x();
-    Eigen::VectorXf gchan = nnlsg.x();
-    Eigen::VectorXf bchan = nnlsb.x();
-
-    for(uint32 j = 0; j < params.NumSGs; ++j)
+    for(uint64 j = 0; j < params.NumSGs; ++j)
     {
-        params.OutSGs[j].Amplitude.x = rchan[j];
-        params.OutSGs[j].Amplitude.y = gchan[j];
-        params.OutSGs[j].Amplitude.z = bchan[j];
+        params.OutSGs[j].Amplitude.x = channels[0][j];
+        params.OutSGs[j].Amplitude.y = channels[1][j];
+        params.OutSGs[j].Amplitude.z = channels[2][j];
     }
 }
 
 // Solve for SG's using singular value decomposition
-static void SolveSVD(SGSolveParams& params)
+static void SolveSVD(SGSolveParams& params, const SGSampleSet& samples)
 {
-	// -- Linearly solve for the rgb channels one at a time
-	Eigen::MatrixXf Ar, Ag, Ab;
-
-	Ar.resize(params.NumSamples, params.NumSGs);
-	Ag.resize(params.NumSamples, params.NumSGs);
-	Ab.resize(params.NumSamples, params.NumSGs);
-	Eigen::VectorXf br(params.NumSamples);
-	Eigen::VectorXf bg(params.NumSamples);
-	Eigen::VectorXf bb(params.NumSamples);
-	for(uint32 i = 0; i < params.NumSamples; ++i)
-	{
-		// compute difference squared from actual observed data
-		for(uint32 j = 0; j < params.NumSGs; ++j)
-		{
-			float exponent = std::exp((Float3::Dot(params.SampleDirs[i], params.OutSGs[j].Axis) - 1.0f) *
-				                      params.OutSGs[j].Sharpness);
-			Ar(i, j) = exponent;
-			Ag(i, j) = exponent;
-			Ab(i, j) = exponent;
-		}
-		br(i) = params.SampleValues[i].x;
-		bg(i) = params.SampleValues[i].y;
-		bb(i) = params.SampleValues[i].z;
-	}
-
-	Eigen::VectorXf rchan = Ar.jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(br);
-	Eigen::VectorXf gchan = Ag.jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(bg);
-	Eigen::VectorXf bchan = Ab.jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(bb);
-
-	for(uint32 j = 0; j < params.NumSGs; ++j) {
-		params.OutSGs[j].Amplitude.x = rchan[j];
-		params.OutSGs[j].Amplitude.y = gchan[j];
-		params.OutSGs[j].Amplitude.z = bchan[j];
-	}
+    Eigen::MatrixXf A;
+    Eigen::MatrixXf B;
+    BuildDesignMatrix(samples, params, A);
+    BuildSampleMatrix(params, B);
+
+    // Factorize once, and back-substitute all 3 channels together
+    Eigen::MatrixXf x = A.jacobiSvd(Eigen::ComputeThinU | Eigen::ComputeThinV).solve(B);
+
+    for(uint64 j = 0; j < params.NumSGs; ++j)
+    {
+        params.OutSGs[j].Amplitude.x = x(j, 0);
+        params.OutSGs[j].Amplitude.y = x(j, 1);
+        params.OutSGs[j].Amplitude.z = x(j, 2);
+    }
 }
 
 #endif
@@ -210,16 +281,8 @@ void ProjectOntoSGs(const Float3& dir, const Float3& color, SG* outSGs, uint64 n
     }
 }
 
-// Do a projection of the colors onto the SG's
-static void SolveProjection(SGSolveParams& params)
+static float ProjectionMonteCarloFactor(const SGSolveParams& params)
 {
-    Assert_(params.SampleDirs != nullptr);
-    Assert_(params.SampleValues != nullptr);
-
-    // Project color samples onto the SGs
-    for(uint32 i = 0; i < params.NumSamples; ++i)
-        ProjectOntoSGs(params.SampleDirs[i], params.SampleValues[i], params.OutSGs, params.NumSGs);
-
     // Weight the samples by the monte carlo factor for uniformly sampling the sphere/hemisphere
     float monteCarloFactor = ((2.0f * Pi) / params.NumSamples);
     if(params.Distribution == SGDistribution::Spherical)
@@ -229,6 +292,35 @@ static void SolveProjection(SGSolveParams& params)
     if(params.Distribution == SGDistribution::Spherical && params.NumSGs == 9)
         monteCarloFactor *= Pi / 2.46373701f;
 
+    return monteCarloFactor;
+}
+
+// Do a projection of the colors onto the SG's
+static void SolveProjection(SGSolveParams& params, const SGSampleSet& samples)
+{
+    // Project color samples onto the SGs, which is the same as ProjectOntoSGs but with 4 samples at a time
+    const XMVECTOR zero = XMVectorZero();
+    for(uint64 sgIdx = 0; sgIdx < params.NumSGs; ++sgIdx)
+    {
+        XMVECTOR sumR = zero;
+        XMVECTOR sumG = zero;
+        XMVECTOR sumB = zero;
+        for(uint64 groupIdx = 0; groupIdx < samples.NumGroups; ++groupIdx)
+        {
+            XMVECTOR cosTheta;
+            XMVECTOR weight = EvaluateSGBasis(samples, groupIdx, params.OutSGs[sgIdx], cosTheta);
+            weight = XMVectorSelect(zero, weight, XMVectorGreater(cosTheta, zero));
+
+            const uint64 baseIdx = groupIdx * 4;
+            sumR = XMVectorMultiplyAdd(weight, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&samples.ValueR[baseIdx])), sumR);
+            sumG = XMVectorMultiplyAdd(weight, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&samples.ValueG[baseIdx])), sumG);
+            sumB = XMVectorMultiplyAdd(weight, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&samples.ValueB[baseIdx])), sumB);
+        }
+
+        params.OutSGs[sgIdx].Amplitude += Float3(HorizontalSum(sumR), HorizontalSum(sumG), HorizontalSum(sumB));
+    }
+
+    const float monteCarloFactor = ProjectionMonteCarloFactor(params);
     for(uint32 i = 0; i < params.NumSGs; ++i)
         params.OutSGs[i].Amplitude *= monteCarloFactor;
 }
@@ -238,18 +330,44 @@ void SolveSGs(SGSolveParams& params)
 {
     GenerateUniformSGs(params.OutSGs, params.NumSGs, params.Distribution);
 
+    #if EnableEigen_
+        const bool normalizeDirs = params.SolveMode == SGSolveMode::Projection;
+    #else
+        const bool normalizeDirs = true;
+    #endif
+
+    SGSampleSet samples;
+    PrepareSamples(params, normalizeDirs, samples);
+
     #if EnableEigen_
         if(params.SolveMode == SGSolveMode::NNLS)
-            SolveNNLS(params);
+            SolveNNLS(params, samples);
         else if(params.SolveMode == SGSolveMode::SVD)
-            SolveSVD(params);
+            SolveSVD(params, samples);
         else
-            SolveProjection(params);
+            SolveProjection(params, samples);
     #else
-        SolveProjection(params);
+        SolveProjection(params, samples);
     #endif
 }
 
+static void SolveSGsTask(uint32 start, uint32 end, uint32 threadNum, void* args)
+{
+    SGSolveParams* params = reinterpret_cast<SGSolveParams*>(args);
+    for(uint32 i = start; i < end; ++i)
+        SolveSGs(params[i]);
+}
+
+void SolveSGsBatch(SGSolveParams* params, uint64 numSolves)
+{
+    Assert_(params != nullptr || numSolves == 0);
+    Assert_(numSolves <= UINT32_MAX);
+    if(numSolves == 0)
+        return;
+
+    Tasks::ParallelFor(uint32(numSolves), 1, SolveSGsTask, params);
+}
+
 void SolveSGsForCubemap(const Texture& texture, SG* outSGs, uint64 numSGs, SGSolveMode solveMode)
 {
     Assert_(texture.Cubemap);
@@ -287,5 +405,204 @@ void SolveSGsForCubemap(const Texture& texture, SG* outSGs, uint64 numSGs, SGSol
     params.OutSGs = outSGs;
     SolveSGs(params);
 }
+// Sky-like radiance for benchmarking: a sharp sun lobe on top of a sky gradient, with a dim ground
+static Float3 BenchmarkRadiance(const Float3& dir)
+{
+    const Float3 sunDir = Float3::Normalize(Float3(0.3f, 0.8f, 0.5f));
+    const float sun = std::pow(Saturate(Float3::Dot(dir, sunDir)), 256.0f) * 100.0f;
+    const float horizon = Saturate(dir.y);
+    const Float3 sky = Lerp(Float3(0.8f, 0.9f, 1.0f), Float3(0.2f, 0.4f, 1.0f), horizon);
+    return dir.y >= 0.0f ? sky + Float3(sun, sun * 0.9f, sun * 0.8f) : Float3(0.1f, 0.08f, 0.05f);
+}
+
+static const char* SGSolveModeName(SGSolveMode mode)
+{
+    if(mode == SGSolveMode::NNLS)
+        return "NNLS";
+    else if(mode == SGSolveMode::SVD)
+        return "SVD";
+    return "Projection";
+}
+
+void BenchmarkSGSolvers(uint32 cubemapSize, uint64 numBatchProbes)
+{
+    Assert_(cubemapSize > 0);
+
+    const uint64 texelsPerFace = uint64(cubemapSize) * cubemapSize;
+    const uint64 numSamples = texelsPerFace * 6;
+    Array<Float3> sampleDirs(numSamples);
+    Array<Float3> sampleValues(numSamples);
+    for(uint32 face = 0; face < 6; ++face)
+    {
+        for(uint32 y = 0; y < cubemapSize; ++y)
+        {
+            for(uint32 x = 0; x < cubemapSize; ++x)
+            {
+                const uint64 idx = face * texelsPerFace + y * cubemapSize + x;
+                sampleDirs[idx] = MapXYSToDirection(x, y, face, cubemapSize, cubemapSize);
+                sampleValues[idx] = BenchmarkRadiance(sampleDirs[idx]);
+            }
+        }
+    }
+
+    #if EnableEigen_
+        const SGSolveMode modes[] = { SGSolveMode::NNLS, SGSolveMode::SVD, SGSolveMode::Projection };
+    #else
+        const SGSolveMode modes[] = { SGSolveMode::Projection };
+    #endif
+
+    WriteLog("SG solver benchmark: %ux%u cubemap (%llu samples), %u threads", cubemapSize, cubemapSize, numSamples, Tasks::NumThreads());
+
+    const uint64 sgCounts[] = { 9, 12, 24 };
+    for(uint64 numSGs : sgCounts)
+    {
+        Array<SG> sgs(numSGs);
+
+        SGSolveParams params;
+        params.SampleDirs = sampleDirs.Data();
+        params.SampleValues = sampleValues.Data();
+        params.NumSamples = numSamples;
+        params.Distribution = SGDistribution::Spherical;
+        params.NumSGs = numSGs;
+        params.OutSGs = sgs.Data();
+
+        for(SGSolveMode mode : modes)
+        {
+            params.SolveMode = mode;
+
+            Timer timer;
+            SolveSGs(params);
+            timer.Update();
+            WriteLog("    %llu SGs, %s: %.2fms", numSGs, SGSolveModeName(mode), timer.ElapsedMillisecondsD());
+        }
+
+        // Scalar projection of one sample at a time, for comparison with the SIMD path
+        {
+            GenerateUniformSGs(sgs.Data(), numSGs, SGDistribution::Spherical);
+
+            Timer timer;
+            for(uint64 i = 0; i < numSamples; ++i)
+                ProjectOntoSGs(sampleDirs[i], sampleValues[i], sgs.Data(), numSGs);
+            timer.Update();
+            WriteLog("    %llu SGs, per-sample ProjectOntoSGs: %.2fms", numSGs, timer.ElapsedMillisecondsD());
+        }
+
+        if(numBatchProbes > 0)
+        {
+            Array<SG> batchSGs(numBatchProbes * numSGs);
+            Array<SGSolveParams> batchParams(numBatchProbes);
+            for(uint64 i = 0; i < numBatchProbes; ++i)
+            {
+                batchParams[i] = params;
+                batchParams[i].SolveMode = modes[0];
+                batchParams[i].OutSGs = &batchSGs[i * numSGs];
+            }
+
+            Timer serialTimer;
+            for(uint64 i = 0; i < numBatchProbes; ++i)
+                SolveSGs(batchParams[i]);
+            serialTimer.Update();
+
+            Timer batchTimer;
+            SolveSGsBatch(batchParams.Data(), numBatchProbes);
+            batchTimer.Update();
+
+            WriteLog("    %llu SGs, %s x %llu probes: %.2fms serial, %.2fms batched", numSGs, SGSolveModeName(modes[0]),
+                     numBatchProbes, serialTimer.ElapsedMillisecondsD(), batchTimer.ElapsedMillisecondsD());
+        }
+    }
+}
+
+bool ValidateSGProjection(uint32 cubemapSize)
+{
+    Assert_(cubemapSize > 0);
+
+    bool passed = true;
+
+    // Un-normalized directions, so that the normalization done up front for the SIMD path is covered as well
+    const uint64 texelsPerFace = uint64(cubemapSize) * cubemapSize;
+    const uint64 numSamples = texelsPerFace * 6 + 3;
+    Array<Float3> sampleDirs(numSamples);
+    Array<Float3> sampleValues(numSamples);
+    for(uint64 i = 0; i < numSamples; ++i)
+    {
+        const uint32 face = uint32((i / texelsPerFace) % 6);
+        const uint32 x = uint32(i % cubemapSize);
+        const uint32 y = uint32((i / cubemapSize) % cubemapSize);
+        const Float3 dir = MapXYSToDirection(x, y, face, cubemapSize, cubemapSize);
+        sampleDirs[i] = dir * (0.5f + (i % 7) * 0.25f);
+        sampleValues[i] = BenchmarkRadiance(dir);
+    }
+
+    const uint64 sgCounts[] = { 9, 12, 24 };
+    const SGDistribution distributions[] = { SGDistribution::Spherical, SGDistribution::Hemispherical };
+    for(uint64 numSGs : sgCounts)
+    {
+        for(SGDistribution distribution : distributions)
+        {
+            Array<SG> sgs(numSGs);
+
+            SGSolveParams params;
+            params.SampleDirs = sampleDirs.Data();
+            params.SampleValues = sampleValues.Data();
+            params.NumSamples = numSamples;
+            params.SolveMode = SGSolveMode::Projection;
+            params.Distribution = distribution;
+            params.NumSGs = numSGs;
+            params.OutSGs = sgs.Data();
+            SolveSGs(params);
+
+            // The same thing one sample at a time with the scalar path
+            Array<SG> scalarSGs(numSGs);
+            GenerateUniformSGs(scalarSGs.Data(), numSGs, distribution);
+            for(uint64 i = 0; i < numSamples; ++i)
+                ProjectOntoSGs(sampleDirs[i], sampleValues[i], scalarSGs.Data(), numSGs);
+
+            const float monteCarloFactor = ProjectionMonteCarloFactor(params);
+            float maxError = 0.0f;
+            for(uint64 i = 0; i < numSGs; ++i)
+            {
+                const Float3 expected = scalarSGs[i].Amplitude * monteCarloFactor;
+                const Float3 diff = sgs[i].Amplitude - expected;
+                const float scale = Max(Max(std::abs(expected.x), std::abs(expected.y)), Max(std::abs(expected.z), 1e-3f));
+                const float error = Max(Max(std::abs(diff.x), std::abs(diff.y)), std::abs(diff.z)) / scale;
+                maxError = Max(maxError, error);
+            }
+
+            if(maxError > 1e-3f)
+            {
+                WriteLog("Projecting onto %llu %s SGs differed from ProjectOntoSGs by up to %.2f%%", numSGs,
+                         distribution == SGDistribution::Spherical ? "spherical" : "hemispherical", maxError * 100.0f);
+                passed = false;
+            }
+
+            // A batched solve has to produce exactly what solving each probe by itself does
+            const uint64 numBatchProbes = 4;
+            Array<SG> batchSGs(numBatchProbes * numSGs);
+            Array<SGSolveParams> batchParams(numBatchProbes);
+            for(uint64 i = 0; i < numBatchProbes; ++i)
+            {
+                batchParams[i] = params;
+                batchParams[i].OutSGs = &batchSGs[i * numSGs];
+            }
+            SolveSGsBatch(batchParams.Data(), numBatchProbes);
+
+            for(uint64 i = 0; i < numBatchProbes * numSGs; ++i)
+            {
+                const Float3 expected = sgs[i % numSGs].Amplitude;
+                if(batchSGs[i].Amplitude.x != expected.x || batchSGs[i].Amplitude.y != expected.y || batchSGs[i].Amplitude.z != expected.z)
+                {
+                    WriteLog("SolveSGsBatch with %llu SGs didn't match SolveSGs for probe %llu", numSGs, i / numSGs);
+                    passed = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    WriteLog("SG projection validation %s (%llu samples)", passed ? "passed" : "FAILED", numSamples);
+
+    return passed;
+}
 
 }
\ No newline at end of file
@@ -126,9 +126,19 @@ void GenerateUniformSGs(SG* outSGs, uint64 numSGs, SGDistribution distribution);
 // Solve for k-number of SG's based on a sphere or hemisphere of samples
 void SolveSGs(SGSolveParams& params);
 
+// Runs multiple independent solves (i.e. one per probe) in parallel on the task scheduler
+void SolveSGsBatch(SGSolveParams* params, uint64 numSolves);
+
 // Projects a sample onto a set of SG's
 void ProjectOntoSGs(const Float3& dir, const Float3& color, SG* outSGs, uint64 numSGs);
 
 void SolveSGsForCubemap(const Texture& texture, SG* outSGs, uint64 numSGs, SGSolveMode solveMode = SGSolveMode::NNLS);
 
+// Times each solve mode for 9, 12 and 24 SGs over a synthetic cubemap, and writes the results to the log
+void BenchmarkSGSolvers(uint32 cubemapSize = 128, uint64 numBatchProbes = 16);
+
+// Checks the SIMD projection solve against accumulating the same samples with ProjectOntoSGs(), and checks that
+// SolveSGsBatch() matches SolveSGs(). Returns false if either differs.
+bool ValidateSGProjection(uint32 cubemapSize = 16);
+
 }
\ No newline at end of file
@@ -10,9 +10,14 @@
 #include "PCH.h"
 #include "SH.h"
 #include "..\\Utility.h"
+#include "..\\Containers.h"
+#include "..\\Tasks.h"
+#include "..\\Timer.h"
 #include "ShaderCompilation.h"
 #include "Textures.h"
 
+using namespace DirectX;
+
 namespace SampleFramework12
 {
 
@@ -89,29 +94,346 @@ float EvalH4(const H4& h, const Float3& dir)
 
 H4 ConvertToH4(const SH9& sh)
 {
+    // Only 8 of the 36 entries in the 4x9 conversion matrix are non-zero, so the multiply is done sparsely
     const float rt2 = sqrt(2.0f);
     const float rt32 = sqrt(3.0f / 2.0f);
     const float rt52 = sqrt(5.0f / 2.0f);
     const float rt152 = sqrt(15.0f / 2.0f);
-    const float convMatrix[4][9] =
-    {
-        { 1.0f / rt2, 0, 0.5f * rt32, 0, 0, 0, 0, 0, 0 },
-        { 0, 1.0f / rt2, 0, 0, 0, (3.0f / 8.0f) * rt52, 0, 0, 0 },
-        { 0, 0, 1.0f / (2.0f * rt2), 0, 0, 0, 0.25f * rt152, 0, 0 },
-        { 0, 0, 0, 1.0f / rt2, 0, 0, 0, (3.0f / 8.0f) * rt52, 0 }
-    };
 
     H4 hBasis;
+    hBasis.Coefficients[0] = (1.0f / rt2) * sh.Coefficients[0] + (0.5f * rt32) * sh.Coefficients[2];
+    hBasis.Coefficients[1] = (1.0f / rt2) * sh.Coefficients[1] + ((3.0f / 8.0f) * rt52) * sh.Coefficients[5];
+    hBasis.Coefficients[2] = (1.0f / (2.0f * rt2)) * sh.Coefficients[2] + (0.25f * rt152) * sh.Coefficients[6];
+    hBasis.Coefficients[3] = (1.0f / rt2) * sh.Coefficients[3] + ((3.0f / 8.0f) * rt52) * sh.Coefficients[7];
+
+    return hBasis;
+}
+
+// == Batch kernels ===============================================================================
+
+// Batches are split into fixed-size chunks so that the partial sums (and the order that they're
+// added together in) don't depend on the number of threads or how the tasks get scheduled
+static const uint64 SHChunkSize = 4096;
+
+// Loads 4 directions and transposes them so that each lane holds a separate direction
+static void LoadDirections(const Float3* dirs, XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+{
+    XMMATRIX m;
+    m.r[0] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&dirs[0]));
+    m.r[1] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&dirs[1]));
+    m.r[2] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&dirs[2]));
+    m.r[3] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&dirs[3]));
+    m = XMMatrixTranspose(m);
+    x = m.r[0];
+    y = m.r[1];
+    z = m.r[2];
+}
+
+// Same as ProjectOntoSH9(), for 4 directions at once
+static void ProjectOntoSH9(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, XMVECTOR basis[9])
+{
+    basis[0] = XMVectorReplicate(0.282095f);
+    basis[1] = XMVectorMultiply(XMVectorReplicate(0.488603f), y);
+    basis[2] = XMVectorMultiply(XMVectorReplicate(0.488603f), z);
+    basis[3] = XMVectorMultiply(XMVectorReplicate(0.488603f), x);
+    basis[4] = XMVectorMultiply(XMVectorMultiply(XMVectorReplicate(1.092548f), x), y);
+    basis[5] = XMVectorMultiply(XMVectorMultiply(XMVectorReplicate(1.092548f), y), z);
+    basis[6] = XMVectorMultiply(XMVectorReplicate(0.315392f), XMVectorSubtract(XMVectorMultiply(XMVectorMultiply(XMVectorReplicate(3.0f), z), z), XMVectorSplatOne()));
+    basis[7] = XMVectorMultiply(XMVectorMultiply(XMVectorReplicate(1.092548f), x), z);
+    basis[8] = XMVectorMultiply(XMVectorReplicate(0.546274f), XMVectorSubtract(XMVectorMultiply(x, x), XMVectorMultiply(y, y)));
+}
+
+static float HorizontalSum(FXMVECTOR v)
+{
+    XMFLOAT4 sum;
+    XMStoreFloat4(&sum, v);
+    return (sum.x + sum.y) + (sum.z + sum.w);
+}
+
+static XMVECTOR LoadWeights(const float* weights, uint64 idx)
+{
+    return weights != nullptr ? XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&weights[idx])) : XMVectorSplatOne();
+}
+
+static void ProjectChunkSH9(const Float3* dirs, const float* weights, uint64 start, uint64 end, SH9& result)
+{
+    XMVECTOR sums[9];
+    for(uint64 i = 0; i < 9; ++i)
+        sums[i] = XMVectorZero();
 
-    for(uint64 row = 0; row < 4; ++row)
+    uint64 dirIdx = start;
+    for(; dirIdx + 4 <= end; dirIdx += 4)
     {
-        hBasis.Coefficients[row] = 0.0f;
+        XMVECTOR x, y, z;
+        LoadDirections(&dirs[dirIdx], x, y, z);
+
+        XMVECTOR basis[9];
+        ProjectOntoSH9(x, y, z, basis);
 
-        for(uint64 col = 0; col < 9; ++col)
-            hBasis.Coefficients[row] += convMatrix[row][col] * sh.Coefficients[col];
+        const XMVECTOR w = LoadWeights(weights, dirIdx);
+        for(uint64 i = 0; i < 9; ++i)
+            sums[i] = XMVectorMultiplyAdd(basis[i], w, sums[i]);
     }
 
-    return hBasis;
+    for(uint64 i = 0; i < 9; ++i)
+        result.Coefficients[i] = HorizontalSum(sums[i]);
+
+    for(; dirIdx < end; ++dirIdx)
+        result += ProjectOntoSH9(dirs[dirIdx]) * (weights != nullptr ? weights[dirIdx] : 1.0f);
+}
+
+static void ProjectChunkSH9Color(const Float3* dirs, const Float3* colors, const float* weights, uint64 start, uint64 end, SH9Color& result)
+{
+    XMVECTOR sums[9][3];
+    for(uint64 i = 0; i < 9; ++i)
+        sums[i][0] = sums[i][1] = sums[i][2] = XMVectorZero();
+
+    uint64 dirIdx = start;
+    for(; dirIdx + 4 <= end; dirIdx += 4)
+    {
+        XMVECTOR x, y, z;
+        LoadDirections(&dirs[dirIdx], x, y, z);
+
+        XMVECTOR r, g, b;
+        LoadDirections(&colors[dirIdx], r, g, b);
+
+        const XMVECTOR w = LoadWeights(weights, dirIdx);
+        r = XMVectorMultiply(r, w);
+        g = XMVectorMultiply(g, w);
+        b = XMVectorMultiply(b, w);
+
+        XMVECTOR basis[9];
+        ProjectOntoSH9(x, y, z, basis);
+
+        for(uint64 i = 0; i < 9; ++i)
+        {
+            sums[i][0] = XMVectorMultiplyAdd(basis[i], r, sums[i][0]);
+            sums[i][1] = XMVectorMultiplyAdd(basis[i], g, sums[i][1]);
+            sums[i][2] = XMVectorMultiplyAdd(basis[i], b, sums[i][2]);
+        }
+    }
+
+    for(uint64 i = 0; i < 9; ++i)
+        result.Coefficients[i] = Float3(HorizontalSum(sums[i][0]), HorizontalSum(sums[i][1]), HorizontalSum(sums[i][2]));
+
+    for(; dirIdx < end; ++dirIdx)
+        result += ProjectOntoSH9Color(dirs[dirIdx], colors[dirIdx]) * (weights != nullptr ? weights[dirIdx] : 1.0f);
+}
+
+static void ProjectChunkH4(const Float3* dirs, const float* values, uint64 start, uint64 end, H4& result)
+{
+    const float scale0 = 1.0f / std::sqrt(2.0f * 3.14159f);
+    const float scale1 = std::sqrt(1.5f / 3.14159f);
+
+    XMVECTOR sums[4] = { XMVectorZero(), XMVectorZero(), XMVectorZero(), XMVectorZero() };
+
+    uint64 dirIdx = start;
+    for(; dirIdx + 4 <= end; dirIdx += 4)
+    {
+        XMVECTOR x, y, z;
+        LoadDirections(&dirs[dirIdx], x, y, z);
+
+        const XMVECTOR v = LoadWeights(values, dirIdx);
+        const XMVECTOR v1 = XMVectorMultiply(v, XMVectorReplicate(scale1));
+
+        // Same as ProjectOntoH4()
+        sums[0] = XMVectorMultiplyAdd(v, XMVectorReplicate(scale0), sums[0]);
+        sums[1] = XMVectorMultiplyAdd(v1, y, sums[1]);
+        sums[2] = XMVectorMultiplyAdd(v1, XMVectorSubtract(XMVectorAdd(z, z), XMVectorSplatOne()), sums[2]);
+        sums[3] = XMVectorMultiplyAdd(v1, x, sums[3]);
+    }
+
+    for(uint64 i = 0; i < 4; ++i)
+        result.Coefficients[i] = HorizontalSum(sums[i]);
+
+    for(; dirIdx < end; ++dirIdx)
+        result += ProjectOntoH4(dirs[dirIdx]) * (values != nullptr ? values[dirIdx] : 1.0f);
+}
+
+enum class SHBatchKernel
+{
+    SH9,
+    SH9Color,
+    H4,
+    SH9Irradiance,
+};
+
+struct SHBatchTaskArgs
+{
+    SHBatchKernel Kernel = SHBatchKernel::SH9;
+    const Float3* Dirs = nullptr;
+    const Float3* Colors = nullptr;
+    const float* Weights = nullptr;
+    uint64 NumDirs = 0;
+
+    // One partial sum per chunk, for the projection kernels
+    SH9* PartialSH9 = nullptr;
+    SH9Color* PartialSH9Color = nullptr;
+    H4* PartialH4 = nullptr;
+
+    // For irradiance evaluation
+    const SH9Color* SH = nullptr;
+    Float3* Irradiance = nullptr;
+};
+
+static void EvalChunkSH9Irradiance(const Float3* normals, uint64 start, uint64 end, const SH9Color& sh, Float3* irradiance)
+{
+    // Fold the cosine kernel into the coefficients ahead of time
+    const float cosineKernel[9] = { CosineA0, CosineA1, CosineA1, CosineA1, CosineA2, CosineA2, CosineA2, CosineA2, CosineA2 };
+    XMVECTOR coefficients[9][3];
+    for(uint64 i = 0; i < 9; ++i)
+    {
+        coefficients[i][0] = XMVectorReplicate(sh.Coefficients[i].x * cosineKernel[i]);
+        coefficients[i][1] = XMVectorReplicate(sh.Coefficients[i].y * cosineKernel[i]);
+        coefficients[i][2] = XMVectorReplicate(sh.Coefficients[i].z * cosineKernel[i]);
+    }
+
+    uint64 dirIdx = start;
+    for(; dirIdx + 4 <= end; dirIdx += 4)
+    {
+        XMVECTOR x, y, z;
+        LoadDirections(&normals[dirIdx], x, y, z);
+
+        XMVECTOR basis[9];
+        ProjectOntoSH9(x, y, z, basis);
+
+        XMVECTOR r = XMVectorZero();
+        XMVECTOR g = XMVectorZero();
+        XMVECTOR b = XMVectorZero();
+        for(uint64 i = 0; i < 9; ++i)
+        {
+            r = XMVectorMultiplyAdd(basis[i], coefficients[i][0], r);
+            g = XMVectorMultiplyAdd(basis[i], coefficients[i][1], g);
+            b = XMVectorMultiplyAdd(basis[i], coefficients[i][2], b);
+        }
+
+        const XMMATRIX rgb = XMMatrixTranspose(XMMATRIX(r, g, b, XMVectorZero()));
+        for(uint64 i = 0; i < 4; ++i)
+            XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&irradiance[dirIdx + i]), rgb.r[i]);
+    }
+
+    for(; dirIdx < end; ++dirIdx)
+        irradiance[dirIdx] = EvalSH9Irradiance(normals[dirIdx], sh);
+}
+
+static void SHBatchChunk(const SHBatchTaskArgs& args, uint64 chunkIdx)
+{
+    const uint64 start = chunkIdx * SHChunkSize;
+    const uint64 end = Min(start + SHChunkSize, args.NumDirs);
+    if(args.Kernel == SHBatchKernel::SH9)
+        ProjectChunkSH9(args.Dirs, args.Weights, start, end, args.PartialSH9[chunkIdx]);
+    else if(args.Kernel == SHBatchKernel::SH9Color)
+        ProjectChunkSH9Color(args.Dirs, args.Colors, args.Weights, start, end, args.PartialSH9Color[chunkIdx]);
+    else if(args.Kernel == SHBatchKernel::H4)
+        ProjectChunkH4(args.Dirs, args.Weights, start, end, args.PartialH4[chunkIdx]);
+    else if(args.Kernel == SHBatchKernel::SH9Irradiance)
+        EvalChunkSH9Irradiance(args.Dirs, start, end, *args.SH, args.Irradiance);
+}
+
+static void SHBatchTask(uint32 start, uint32 end, uint32 threadNum, void* args)
+{
+    const SHBatchTaskArgs& batchArgs = *reinterpret_cast<const SHBatchTaskArgs*>(args);
+    for(uint32 chunkIdx = start; chunkIdx < end; ++chunkIdx)
+        SHBatchChunk(batchArgs, chunkIdx);
+}
+
+static uint64 NumSHChunks(uint64 numDirs)
+{
+    return (numDirs + SHChunkSize - 1) / SHChunkSize;
+}
+
+static void RunSHBatch(const SHBatchTaskArgs& args)
+{
+    const uint64 numChunks = NumSHChunks(args.NumDirs);
+    if(numChunks == 1)
+        SHBatchChunk(args, 0);
+    else if(numChunks > 1)
+        Tasks::ParallelFor(uint32(numChunks), 1, SHBatchTask, const_cast<SHBatchTaskArgs*>(&args));
+}
+
+SH9 ProjectOntoSH9(const Float3* dirs, const float* weights, uint64 numDirs)
+{
+    Array<SH9> partialSums(NumSHChunks(numDirs));
+
+    SHBatchTaskArgs args;
+    args.Kernel = SHBatchKernel::SH9;
+    args.Dirs = dirs;
+    args.Weights = weights;
+    args.NumDirs = numDirs;
+    args.PartialSH9 = partialSums.Data();
+    RunSHBatch(args);
+
+    SH9 result;
+    for(const SH9& partialSum : partialSums)
+        result += partialSum;
+    return result;
+}
+
+SH9Color ProjectOntoSH9Color(const Float3* dirs, const Float3* colors, const float* weights, uint64 numDirs)
+{
+    Array<SH9Color> partialSums(NumSHChunks(numDirs));
+
+    SHBatchTaskArgs args;
+    args.Kernel = SHBatchKernel::SH9Color;
+    args.Dirs = dirs;
+    args.Colors = colors;
+    args.Weights = weights;
+    args.NumDirs = numDirs;
+    args.PartialSH9Color = partialSums.Data();
+    RunSHBatch(args);
+
+    SH9Color result;
+    for(const SH9Color& partialSum : partialSums)
+        result += partialSum;
+    return result;
+}
+
+H4 ProjectOntoH4(const Float3* dirs, const float* values, uint64 numDirs)
+{
+    Array<H4> partialSums(NumSHChunks(numDirs));
+
+    SHBatchTaskArgs args;
+    args.Kernel = SHBatchKernel::H4;
+    args.Dirs = dirs;
+    args.Weights = values;
+    args.NumDirs = numDirs;
+    args.PartialH4 = partialSums.Data();
+    RunSHBatch(args);
+
+    H4 result;
+    for(const H4& partialSum : partialSums)
+        result += partialSum;
+    return result;
+}
+
+void EvalSH9Irradiance(const Float3* normals, Float3* irradiance, uint64 numNormals, const SH9Color& sh)
+{
+    SHBatchTaskArgs args;
+    args.Kernel = SHBatchKernel::SH9Irradiance;
+    args.Dirs = normals;
+    args.NumDirs = numNormals;
+    args.SH = &sh;
+    args.Irradiance = irradiance;
+    RunSHBatch(args);
+}
+
+// Computes the weight of each texel in a cubemap face for integrating over the sphere
+void ComputeCubemapTexelWeights(uint32 width, uint32 height, float* weights)
+{
+    for(uint32 y = 0; y < height; ++y)
+    {
+        for(uint32 x = 0; x < width; ++x)
+        {
+            float u = (x + 0.5f) / width;
+            float v = (y + 0.5f) / height;
+
+            // Account for cubemap texel distribution
+            u = u * 2.0f - 1.0f;
+            v = v * 2.0f - 1.0f;
+            const float temp = 1.0f + u * u + v * v;
+            weights[y * width + x] = 4.0f / (std::sqrt(temp) * temp);
+        }
+    }
 }
 
 SH9Color ProjectCubemapToSH(const Texture& texture)
@@ -123,8 +445,14 @@ SH9Color ProjectCubemapToSH(const Texture& texture)
     Assert_(textureData.NumSlices == 6);
     const uint32 width = textureData.Width;
     const uint32 height = textureData.Height;
+    const uint32 texelsPerFace = width * height;
 
-    SH9Color result;
+    Array<float> faceWeights(texelsPerFace);
+    ComputeCubemapTexelWeights(width, height, faceWeights.Data());
+
+    Array<Float3> dirs(texelsPerFace * 6);
+    Array<Float3> samples(texelsPerFace * 6);
+    Array<float> weights(texelsPerFace * 6);
     float weightSum = 0.0f;
     for(uint32 face = 0; face < 6; ++face)
     {
@@ -133,26 +461,123 @@ SH9Color ProjectCubemapToSH(const Texture& texture)
             for(uint32 x = 0; x < width; ++x)
             {
                 const uint32 idx = face * (width * height) + y * (width) + x;
-                Float3 sample = textureData.Texels[idx].To3D();
-
-                float u = (x + 0.5f) / width;
-                float v = (y + 0.5f) / height;
-
-                // Account for cubemap texel distribution
-                u = u * 2.0f - 1.0f;
-                v = v * 2.0f - 1.0f;
-                const float temp = 1.0f + u * u + v * v;
-                const float weight = 4.0f / (sqrt(temp) * temp);
-
-                Float3 dir = MapXYSToDirection(x, y, face, width, height);
-                result += ProjectOntoSH9Color(dir, sample) * weight;
-                weightSum += weight;
+                samples[idx] = textureData.Texels[idx].To3D();
+                dirs[idx] = MapXYSToDirection(x, y, face, width, height);
+                weights[idx] = faceWeights[y * width + x];
+                weightSum += weights[idx];
             }
         }
     }
 
+    SH9Color result = ProjectOntoSH9Color(dirs.Data(), samples.Data(), weights.Data(), dirs.Size());
     result *= (4.0f * 3.14159f) / weightSum;
     return result;
 }
 
+// Random directions on the unit sphere, so that results don't depend on the order of a cubemap's texels
+static void GenerateBenchmarkDirections(Float3* dirs, Float3* colors, uint64 numDirs)
+{
+    Random rng;
+    for(uint64 i = 0; i < numDirs; ++i)
+    {
+        const float z = rng.RandomFloat() * 2.0f - 1.0f;
+        const float phi = rng.RandomFloat() * 2.0f * Pi;
+        const float r = std::sqrt(Max(1.0f - z * z, 0.0f));
+        dirs[i] = Float3(std::cos(phi) * r, std::sin(phi) * r, z);
+        colors[i] = rng.RandomFloat() * Float3(1.0f, 0.8f, 0.6f) + Float3(0.1f);
+    }
+}
+
+static double DirectionsPerSecond(uint64 numDirs, const Timer& timer)
+{
+    const double seconds = timer.ElapsedSecondsD();
+    return seconds > 0.0 ? numDirs / seconds : 0.0;
+}
+
+void BenchmarkSHKernels(uint64 numDirs)
+{
+    Array<Float3> dirs(numDirs);
+    Array<Float3> colors(numDirs);
+    Array<float> values(numDirs);
+    GenerateBenchmarkDirections(dirs.Data(), colors.Data(), numDirs);
+    for(uint64 i = 0; i < numDirs; ++i)
+        values[i] = colors[i].x;
+
+    WriteLog("SH kernel benchmark: %llu directions, %u threads", numDirs, Tasks::NumThreads());
+
+    // SH9 color projection
+    {
+        Timer scalarTimer;
+        SH9Color scalarResult;
+        for(uint64 i = 0; i < numDirs; ++i)
+            scalarResult += ProjectOntoSH9Color(dirs[i], colors[i]);
+        scalarTimer.Update();
+
+        Timer batchTimer;
+        SH9Color batchResult = ProjectOntoSH9Color(dirs.Data(), colors.Data(), nullptr, numDirs);
+        batchTimer.Update();
+
+        float maxError = 0.0f;
+        for(uint64 i = 0; i < 9; ++i)
+        {
+            const Float3 diff = batchResult[i] - scalarResult[i];
+            maxError = Max(maxError, Max(std::abs(diff.x), Max(std::abs(diff.y), std::abs(diff.z))));
+        }
+
+        WriteLog("    SH9Color projection: scalar %.1fM dirs/sec, batch %.1fM dirs/sec, max difference %e (sums of %llu samples)",
+                 DirectionsPerSecond(numDirs, scalarTimer) / 1000000.0, DirectionsPerSecond(numDirs, batchTimer) / 1000000.0,
+                 maxError, numDirs);
+    }
+
+    // H4 projection
+    {
+        Timer scalarTimer;
+        H4 scalarResult;
+        for(uint64 i = 0; i < numDirs; ++i)
+            scalarResult += ProjectOntoH4(dirs[i]) * values[i];
+        scalarTimer.Update();
+
+        Timer batchTimer;
+        H4 batchResult = ProjectOntoH4(dirs.Data(), values.Data(), numDirs);
+        batchTimer.Update();
+
+        float maxError = 0.0f;
+        for(uint64 i = 0; i < 4; ++i)
+            maxError = Max(maxError, std::abs(batchResult[i] - scalarResult[i]));
+
+        WriteLog("    H4 projection: scalar %.1fM dirs/sec, batch %.1fM dirs/sec, max difference %e",
+                 DirectionsPerSecond(numDirs, scalarTimer) / 1000000.0, DirectionsPerSecond(numDirs, batchTimer) / 1000000.0,
+                 maxError);
+    }
+
+    // SH9 irradiance evaluation
+    {
+        SH9Color sh = ProjectOntoSH9Color(dirs.Data(), colors.Data(), nullptr, numDirs);
+        sh *= (4.0f * Pi) / numDirs;
+
+        Array<Float3> scalarIrradiance(numDirs);
+        Array<Float3> batchIrradiance(numDirs);
+
+        Timer scalarTimer;
+        for(uint64 i = 0; i < numDirs; ++i)
+            scalarIrradiance[i] = EvalSH9Irradiance(dirs[i], sh);
+        scalarTimer.Update();
+
+        Timer batchTimer;
+        EvalSH9Irradiance(dirs.Data(), batchIrradiance.Data(), numDirs, sh);
+        batchTimer.Update();
+
+        float maxError = 0.0f;
+        for(uint64 i = 0; i < numDirs; ++i)
+        {
+            const Float3 diff = batchIrradiance[i] - scalarIrradiance[i];
+            maxError = Max(maxError, Max(std::abs(diff.x), Max(std::abs(diff.y), std::abs(diff.z))));
+        }
+
+        WriteLog("    SH9 irradiance evaluation: scalar %.1fM dirs/sec, batch %.1fM dirs/sec, max difference %e",
+                 DirectionsPerSecond(numDirs, scalarTimer) / 1000000.0, DirectionsPerSecond(numDirs, batchTimer) / 1000000.0,
+                 maxError);
+    }
+}
+
 }
\ No newline at end of file
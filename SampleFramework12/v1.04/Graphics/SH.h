@@ -225,8 +225,21 @@ H4 ProjectOntoH4(const Float3& dir);
 float EvalH4(const H4& h, const Float3& dir);
 H4 ConvertToH4(const SH9& sh);
 
+// Batch versions of the above, which process 4 directions at a time with SIMD and split large batches
+// across the task scheduler's threads. The projections return the weighted sum over all directions, where
+// a null weight/value array means a weight of 1. Partial sums are always combined in the same order, so the
+// results don't depend on the number of threads.
+SH9 ProjectOntoSH9(const Float3* dirs, const float* weights, uint64 numDirs);
+SH9Color ProjectOntoSH9Color(const Float3* dirs, const Float3* colors, const float* weights, uint64 numDirs);
+H4 ProjectOntoH4(const Float3* dirs, const float* values, uint64 numDirs);
+void EvalSH9Irradiance(const Float3* normals, Float3* irradiance, uint64 numNormals, const SH9Color& sh);
+
 // Lighting environment generation functions
 SH9Color ProjectCubemapToSH(const Texture& texture);
+void ComputeCubemapTexelWeights(uint32 width, uint32 height, float* weights);
+
+// Logs the throughput of the scalar and batch kernels in directions per second
+void BenchmarkSHKernels(uint64 numDirs = 1024 * 1024);
 
 // Constants
 static const H4 H4Identity = H4(std::sqrt(2.0f * 3.14159f), 0.0f, 0.0f, 0.0f);
@@ -9,6 +9,9 @@
 
 #include "PCH.h"
 #include "Sampling.h"
+#include "..\\Tasks.h"
+#include "..\\Timer.h"
+#include "..\\Utility.h"
 
 namespace SampleFramework12
 {
@@ -525,5 +528,639 @@ void GenerateCMJSamples2D(Float2* samples, uint64 numSamplesX, uint64 numSamples
     for(uint64 i = 0; i < numSamples; ++i)
         samples[i] = SampleCMJ2D(int32(i), int32(numSamplesX), int32(numSamplesY), int32(pattern));
 }
+// == Batch sample generation =====================================================================
+
+static const uint64 RadicalInverseBases[64] =
+{
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97, 101,
+    103, 107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199,
+    211, 223, 227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311,
+};
+
+// Sets with at least this many samples are split across the task scheduler's threads
+static const uint64 ParallelSampleThreshold = 64 * 1024;
+static const uint64 SampleChunkSize = 16 * 1024;
+
+// Generates consecutive radical inverses in a single base without any divisions, by incrementing the
+// digits of the index and its digit-reversed value together. Results exactly match RadicalInverseFast().
+struct RadicalInverseGenerator
+{
+    uint64 Base = 2;
+    uint64 NumDigits = 0;
+    uint64 Reversed = 0;
+    uint64 Digits[65] = { };
+    uint64 Powers[64] = { };
+    float Factors[65] = { };
+
+    void Init(uint64 baseIdx, uint64 startIdx)
+    {
+        Assert_(baseIdx < ArraySize_(RadicalInverseBases));
+        Base = RadicalInverseBases[baseIdx];
+
+        // The factors are accumulated the same way as in RadicalInverse_() so that they round identically
+        const float radical = 1.0f / float(Base);
+        Factors[0] = 1.0f;
+        for(uint64 i = 1; i < ArraySize_(Factors); ++i)
+            Factors[i] = Factors[i - 1] * radical;
+
+        Powers[0] = 1;
+        for(uint64 i = 1; i < ArraySize_(Powers); ++i)
+            Powers[i] = Powers[i - 1] * Base;
+
+        NumDigits = 0;
+        while(startIdx)
+        {
+            Digits[NumDigits++] = startIdx % Base;
+            startIdx /= Base;
+        }
+
+        Reversed = 0;
+        for(uint64 i = 0; i < NumDigits; ++i)
+            Reversed = Reversed * Base + Digits[i];
+    }
+
+    // Returns the radical inverse of the current index, and then advances to the next index
+    float Next()
+    {
+        const float inverse = std::min(float(Reversed) * Factors[NumDigits], OneMinusEpsilon);
+
+        for(uint64 digitIdx = 0; ; ++digitIdx)
+        {
+            if(digitIdx == NumDigits)
+            {
+                // All lower digits wrapped around to 0, so the new most-significant digit is the only one left
+                Digits[NumDigits++] = 1;
+                Reversed = 1;
+                break;
+            }
+
+            const uint64 power = Powers[NumDigits - 1 - digitIdx];
+            if(Digits[digitIdx] + 1 < Base)
+            {
+                Digits[digitIdx] += 1;
+                Reversed += power;
+                break;
+            }
+
+            Reversed -= Digits[digitIdx] * power;
+            Digits[digitIdx] = 0;
+        }
+
+        return inverse;
+    }
+};
+
+#if defined(_XM_SSE_INTRINSICS_)
+
+// SSE2 doesn't have a 32-bit multiply that keeps the low bits, so it's done with two 32x32->64 multiplies
+static __m128i MultiplyLow32(__m128i a, uint32 b)
+{
+    const __m128i bv = _mm_set1_epi32(int32(b));
+    const __m128i even = _mm_mul_epu32(a, bv);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), bv);
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Converts unsigned integers to float with the same rounding as a scalar conversion. Both halves convert
+// exactly, so the only rounding happens in the final add.
+static __m128 ConvertUint32ToFloat(__m128i v)
+{
+    const __m128i lo = _mm_and_si128(v, _mm_set1_epi32(0xFFFF));
+    const __m128i hi = _mm_srli_epi32(v, 16);
+    return _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(hi), _mm_set1_ps(65536.0f)), _mm_cvtepi32_ps(lo));
+}
+
+static __m128i XorShiftRight(__m128i v, __m128i mask, int32 shift)
+{
+    return _mm_xor_si128(v, _mm_srli_epi32(_mm_and_si128(v, mask), shift));
+}
+
+// Vectorized version of RadicalInverseBase2()
+static __m128 RadicalInverseBase2(__m128i bits)
+{
+    const __m128i mask55 = _mm_set1_epi32(0x55555555);
+    const __m128i mask33 = _mm_set1_epi32(0x33333333);
+    const __m128i mask0F = _mm_set1_epi32(0x0F0F0F0F);
+    const __m128i mask00FF = _mm_set1_epi32(0x00FF00FF);
+
+    bits = _mm_or_si128(_mm_slli_epi32(bits, 16), _mm_srli_epi32(bits, 16));
+    bits = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(bits, mask55), 1), _mm_and_si128(_mm_srli_epi32(bits, 1), mask55));
+    bits = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(bits, mask33), 2), _mm_and_si128(_mm_srli_epi32(bits, 2), mask33));
+    bits = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(bits, mask0F), 4), _mm_and_si128(_mm_srli_epi32(bits, 4), mask0F));
+    bits = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(bits, mask00FF), 8), _mm_and_si128(_mm_srli_epi32(bits, 8), mask00FF));
+    return _mm_mul_ps(ConvertUint32ToFloat(bits), _mm_set1_ps(2.3283064365386963e-10f));
+}
+
+// Vectorized version of CMJPermute(). Each lane keeps re-hashing until it lands inside [0, l), so the
+// loop runs until every lane has found a valid value.
+static __m128i CMJPermute(__m128i i, uint32 l, uint32 p)
+{
+    Assert_(l > 0 && l <= 0x80000000);
+
+    uint32 w = l - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+
+    const __m128i wv = _mm_set1_epi32(int32(w));
+    const __m128i lv = _mm_set1_epi32(int32(l));
+    const __m128i pv = _mm_set1_epi32(int32(p));
+    __m128i result = _mm_setzero_si128();
+    __m128i done = _mm_setzero_si128();
+    while(true)
+    {
+        i = _mm_xor_si128(i, pv); i = MultiplyLow32(i, 0xe170893d);
+        i = _mm_xor_si128(i, _mm_set1_epi32(int32(p >> 16)));
+        i = XorShiftRight(i, wv, 4);
+        i = _mm_xor_si128(i, _mm_set1_epi32(int32(p >> 8))); i = MultiplyLow32(i, 0x0929eb3f);
+        i = _mm_xor_si128(i, _mm_set1_epi32(int32(p >> 23)));
+        i = XorShiftRight(i, wv, 1); i = MultiplyLow32(i, 1 | p >> 27);
+        i = MultiplyLow32(i, 0x6935fa69);
+        i = XorShiftRight(i, wv, 11); i = MultiplyLow32(i, 0x74dcb303);
+        i = XorShiftRight(i, wv, 2); i = MultiplyLow32(i, 0x9e501cc3);
+        i = XorShiftRight(i, wv, 2); i = MultiplyLow32(i, 0xc860a3df);
+        i = _mm_and_si128(i, wv);
+        i = _mm_xor_si128(i, _mm_srli_epi32(i, 5));
+
+        // i <= w < 2^31 at this point, so a signed compare works
+        const __m128i inRange = _mm_cmplt_epi32(i, lv);
+        result = _mm_or_si128(result, _mm_and_si128(_mm_andnot_si128(done, inRange), i));
+        done = _mm_or_si128(done, inRange);
+        if(_mm_movemask_epi8(done) == 0xFFFF)
+            break;
+    }
+
+    // There's no integer division in SSE2, so the final modulo is done per-lane
+    alignas(16) uint32 lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi32(result, pv));
+    for(uint64 laneIdx = 0; laneIdx < 4; ++laneIdx)
+        lanes[laneIdx] %= l;
+
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(lanes));
+}
+
+// Vectorized version of CMJRandFloat()
+static __m128 CMJRandFloat(__m128i i, uint32 p)
+{
+    i = _mm_xor_si128(i, _mm_set1_epi32(int32(p)));
+    i = _mm_xor_si128(i, _mm_srli_epi32(i, 17));
+    i = _mm_xor_si128(i, _mm_srli_epi32(i, 10)); i = MultiplyLow32(i, 0xb36534e5);
+    i = _mm_xor_si128(i, _mm_srli_epi32(i, 12));
+    i = _mm_xor_si128(i, _mm_srli_epi32(i, 21)); i = MultiplyLow32(i, 0x93fc4795);
+    i = _mm_xor_si128(i, _mm_set1_epi32(int32(0xdf6e307f)));
+    i = _mm_xor_si128(i, _mm_srli_epi32(i, 17)); i = MultiplyLow32(i, 1 | p >> 18);
+    return _mm_mul_ps(ConvertUint32ToFloat(i), _mm_set1_ps(1.0f / 4294967808.0f));
+}
+
+static __m128i SampleIndices(uint64 firstIdx)
+{
+    return _mm_add_epi32(_mm_set1_epi32(int32(uint32(firstIdx))), _mm_setr_epi32(0, 1, 2, 3));
+}
+
+#endif // _XM_SSE_INTRINSICS_
+
+static void GenerateHammersleyRange(float* samplesX, float* samplesY, uint64 start, uint64 end, uint64 numSamples)
+{
+    uint64 sampleIdx = start;
+
+    #if defined(_XM_SSE_INTRINSICS_)
+        if(numSamples <= UINT32_MAX)
+        {
+            const __m128 numSamplesF = _mm_set1_ps(float(numSamples));
+            for(; sampleIdx + 4 <= end; sampleIdx += 4)
+            {
+                const __m128i indices = SampleIndices(sampleIdx);
+                _mm_storeu_ps(&samplesX[sampleIdx], _mm_div_ps(ConvertUint32ToFloat(indices), numSamplesF));
+                _mm_storeu_ps(&samplesY[sampleIdx], RadicalInverseBase2(indices));
+            }
+        }
+    #endif
+
+    for(; sampleIdx < end; ++sampleIdx)
+    {
+        const Float2 sample = Hammersley2D(sampleIdx, numSamples);
+        samplesX[sampleIdx] = sample.x;
+        samplesY[sampleIdx] = sample.y;
+    }
+}
+
+static void GenerateCMJRange(float* samplesX, float* samplesY, uint64 start, uint64 end,
+                             uint32 numSamplesX, uint32 numSamplesY, uint32 pattern)
+{
+    uint64 sampleIdx = start;
+
+    #if defined(_XM_SSE_INTRINSICS_)
+        // The pattern only changes the hash constants, so they're computed once for the whole range
+        const uint32 N = numSamplesX * numSamplesY;
+        const uint32 sampleP = pattern * 0x51633e2d;
+        const uint32 xP = pattern * 0x68bc21eb;
+        const uint32 yP = pattern * 0x02e5be93;
+        const uint32 jitterXP = pattern * 0x967a889b;
+        const uint32 jitterYP = pattern * 0x368cc8b7;
+        const __m128 numSamplesXF = _mm_set1_ps(float(numSamplesX));
+        const __m128 numSamplesYF = _mm_set1_ps(float(numSamplesY));
+        const __m128 NF = _mm_set1_ps(float(N));
+
+        for(; sampleIdx + 4 <= end; sampleIdx += 4)
+        {
+            const __m128i permutedIdx = CMJPermute(SampleIndices(sampleIdx), N, sampleP);
+
+            alignas(16) uint32 permuted[4];
+            alignas(16) uint32 cellX[4];
+            alignas(16) uint32 cellY[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(permuted), permutedIdx);
+            for(uint64 laneIdx = 0; laneIdx < 4; ++laneIdx)
+            {
+                cellX[laneIdx] = permuted[laneIdx] % numSamplesX;
+                cellY[laneIdx] = permuted[laneIdx] / numSamplesX;
+            }
+
+            const __m128i sx = CMJPermute(_mm_load_si128(reinterpret_cast<const __m128i*>(cellX)), numSamplesX, xP);
+            const __m128i sy = CMJPermute(_mm_load_si128(reinterpret_cast<const __m128i*>(cellY)), numSamplesY, yP);
+            const __m128 jx = CMJRandFloat(permutedIdx, jitterXP);
+            const __m128 jy = CMJRandFloat(permutedIdx, jitterYP);
+
+            // (sx + (sy + jx) / numSamplesY) / numSamplesX, (sampleIdx + jy) / N
+            const __m128 x = _mm_div_ps(_mm_add_ps(ConvertUint32ToFloat(sx), _mm_div_ps(_mm_add_ps(ConvertUint32ToFloat(sy), jx), numSamplesYF)), numSamplesXF);
+            const __m128 y = _mm_div_ps(_mm_add_ps(ConvertUint32ToFloat(permutedIdx), jy), NF);
+            _mm_storeu_ps(&samplesX[sampleIdx], x);
+            _mm_storeu_ps(&samplesY[sampleIdx], y);
+        }
+    #endif
+
+    for(; sampleIdx < end; ++sampleIdx)
+    {
+        const Float2 sample = SampleCMJ2D(uint32(sampleIdx), numSamplesX, numSamplesY, pattern);
+        samplesX[sampleIdx] = sample.x;
+        samplesY[sampleIdx] = sample.y;
+    }
+}
+
+enum class BatchSampleType
+{
+    Hammersley,
+    Halton,
+    RadicalInverse,
+    CMJ,
+};
+
+struct SampleTaskArgs
+{
+    BatchSampleType Type = BatchSampleType::Hammersley;
+    float* SamplesX = nullptr;
+    float* SamplesY = nullptr;
+    uint64 NumSamples = 0;
+    uint64 Dimension = 0;           // dimension for Halton, base index for RadicalInverse
+    uint64 StartIdx = 0;            // RadicalInverse only
+    uint32 NumSamplesX = 0;         // CMJ only
+    uint32 NumSamplesY = 0;         // CMJ only
+    uint32 Pattern = 0;             // CMJ only
+};
+
+static void GenerateSampleRange(const SampleTaskArgs& args, uint64 start, uint64 end)
+{
+    if(args.Type == BatchSampleType::Hammersley)
+    {
+        GenerateHammersleyRange(args.SamplesX, args.SamplesY, start, end, args.NumSamples);
+    }
+    else if(args.Type == BatchSampleType::Halton)
+    {
+        // Same bases as GenerateHammersleySamples2D() uses for dimensions > 0
+        RadicalInverseGenerator generatorX;
+        RadicalInverseGenerator generatorY;
+        generatorX.Init(args.Dimension * 2 - 1, start);
+        generatorY.Init(args.Dimension * 2, start);
+        for(uint64 i = start; i < end; ++i)
+        {
+            args.SamplesX[i] = generatorX.Next();
+            args.SamplesY[i] = generatorY.Next();
+        }
+    }
+    else if(args.Type == BatchSampleType::RadicalInverse)
+    {
+        RadicalInverseGenerator generator;
+        generator.Init(args.Dimension, args.StartIdx + start);
+        for(uint64 i = start; i < end; ++i)
+            args.SamplesX[i] = generator.Next();
+    }
+    else if(args.Type == BatchSampleType::CMJ)
+    {
+        GenerateCMJRange(args.SamplesX, args.SamplesY, start, end, args.NumSamplesX, args.NumSamplesY, args.Pattern);
+    }
+}
+
+static void SampleTask(uint32 start, uint32 end, uint32 threadNum, void* args_)
+{
+    const SampleTaskArgs& args = *reinterpret_cast<const SampleTaskArgs*>(args_);
+    for(uint32 chunkIdx = start; chunkIdx < end; ++chunkIdx)
+    {
+        const uint64 chunkStart = chunkIdx * SampleChunkSize;
+        GenerateSampleRange(args, chunkStart, Min(chunkStart + SampleChunkSize, args.NumSamples));
+    }
+}
+
+static void GenerateSamples(SampleTaskArgs& args)
+{
+    if(args.NumSamples < ParallelSampleThreshold)
+    {
+        GenerateSampleRange(args, 0, args.NumSamples);
+        return;
+    }
+
+    const uint64 numChunks = (args.NumSamples + SampleChunkSize - 1) / SampleChunkSize;
+    Assert_(numChunks <= UINT32_MAX);
+    Tasks::ParallelFor(uint32(numChunks), 1, SampleTask, &args);
+}
+
+void GenerateHammersleySamples2D(float* samplesX, float* samplesY, uint64 numSamples, uint64 dimIdx)
+{
+    Assert_(samplesX != nullptr && samplesY != nullptr);
+
+    SampleTaskArgs args;
+    args.Type = dimIdx == 0 ? BatchSampleType::Hammersley : BatchSampleType::Halton;
+    args.SamplesX = samplesX;
+    args.SamplesY = samplesY;
+    args.NumSamples = numSamples;
+    args.Dimension = dimIdx;
+    GenerateSamples(args);
+}
+
+void GenerateCMJSamples2D(float* samplesX, float* samplesY, uint64 numSamplesX, uint64 numSamplesY, uint32 pattern)
+{
+    Assert_(samplesX != nullptr && samplesY != nullptr);
+    Assert_(numSamplesX * numSamplesY <= 0x80000000);
+
+    SampleTaskArgs args;
+    args.Type = BatchSampleType::CMJ;
+    args.SamplesX = samplesX;
+    args.SamplesY = samplesY;
+    args.NumSamples = numSamplesX * numSamplesY;
+    args.NumSamplesX = uint32(numSamplesX);
+    args.NumSamplesY = uint32(numSamplesY);
+    args.Pattern = pattern;
+    GenerateSamples(args);
+}
+
+void GenerateRadicalInverseSequence(float* values, uint64 baseIdx, uint64 startIdx, uint64 count)
+{
+    Assert_(values != nullptr);
+
+    SampleTaskArgs args;
+    args.Type = BatchSampleType::RadicalInverse;
+    args.SamplesX = values;
+    args.NumSamples = count;
+    args.Dimension = baseIdx;
+    args.StartIdx = startIdx;
+    GenerateSamples(args);
+}
+
+// The random number generator is sequential, so this one can't be split up across threads. It does
+// make the same calls in the same order as the Float2 version, so the results are identical.
+void GenerateLatinHypercubeSamples2D(float* samplesX, float* samplesY, uint64 numSamples, Random& rng)
+{
+    Assert_(samplesX != nullptr && samplesY != nullptr);
+
+    const float delta = 1.0f / numSamples;
+    for(uint64 i = 0; i < numSamples; ++i)
+    {
+        const Float2 jitter = rng.RandomFloat2();
+        samplesX[i] = Clamp((float(i) + jitter.x) * delta, 0.0f, OneMinusEpsilon);
+        samplesY[i] = Clamp((float(i) + jitter.y) * delta, 0.0f, OneMinusEpsilon);
+    }
+
+    float* dims[2] = { samplesX, samplesY };
+    for(uint64 dimIdx = 0; dimIdx < ArraySize_(dims); ++dimIdx)
+    {
+        float* dimSamples = dims[dimIdx];
+        for(uint64 j = 0; j < numSamples; ++j)
+        {
+            uint64 other = j + (rng.RandomUint() % (numSamples - j));
+            Swap(dimSamples[j], dimSamples[other]);
+        }
+    }
+}
+
+// == SampleTable2D ===============================================================================
+
+struct SampleTableTaskArgs
+{
+    SampleTable2D* Table = nullptr;
+    SampleTaskArgs SetArgs;
+    bool PatternPerSet = false;
+};
+
+static void SampleTableTask(uint32 start, uint32 end, uint32 threadNum, void* args_)
+{
+    const SampleTableTaskArgs& args = *reinterpret_cast<const SampleTableTaskArgs*>(args_);
+    SampleTable2D& table = *args.Table;
+    for(uint32 setIdx = start; setIdx < end; ++setIdx)
+    {
+        SampleTaskArgs setArgs = args.SetArgs;
+        setArgs.SamplesX = &table.X[setIdx * table.NumSamples];
+        setArgs.SamplesY = &table.Y[setIdx * table.NumSamples];
+        if(args.PatternPerSet)
+            setArgs.Pattern += setIdx;
+        else
+            setArgs.Dimension = setIdx;
+
+        if(setArgs.Type == BatchSampleType::Halton && setArgs.Dimension == 0)
+            setArgs.Type = BatchSampleType::Hammersley;
+
+        GenerateSampleRange(setArgs, 0, table.NumSamples);
+    }
+}
+
+static void InitSampleTable(SampleTable2D& table, const SampleTableTaskArgs& args, uint64 numSamples, uint64 numSets)
+{
+    Assert_(numSets <= UINT32_MAX);
+
+    table.NumSamples = numSamples;
+    table.NumSets = numSets;
+    table.X.Init(numSamples * numSets);
+    table.Y.Init(numSamples * numSets);
+
+    // Sets are generated on separate threads, which is typically a better fit than splitting up
+    // each set when there's lots of small ones
+    const uint64 minSetsPerTask = Max<uint64>(ParallelSampleThreshold / Max<uint64>(numSamples, 1), 1);
+    SampleTableTaskArgs taskArgs = args;
+    taskArgs.Table = &table;
+    if(numSamples * numSets < ParallelSampleThreshold)
+        SampleTableTask(0, uint32(numSets), 0, &taskArgs);
+    else
+        Tasks::ParallelFor(uint32(numSets), uint32(Min<uint64>(minSetsPerTask, UINT32_MAX)), SampleTableTask, &taskArgs);
+}
+
+void SampleTable2D::InitHammersley(uint64 numSamples_, uint64 numDimensions)
+{
+    SampleTableTaskArgs args;
+    args.SetArgs.Type = BatchSampleType::Halton;
+    args.SetArgs.NumSamples = numSamples_;
+    args.PatternPerSet = false;
+    InitSampleTable(*this, args, numSamples_, numDimensions);
+}
+
+void SampleTable2D::InitCMJ(uint64 numSamplesX, uint64 numSamplesY, uint64 numPatterns, uint32 firstPattern)
+{
+    Assert_(numSamplesX * numSamplesY <= 0x80000000);
+
+    SampleTableTaskArgs args;
+    args.SetArgs.Type = BatchSampleType::CMJ;
+    args.SetArgs.NumSamples = numSamplesX * numSamplesY;
+    args.SetArgs.NumSamplesX = uint32(numSamplesX);
+    args.SetArgs.NumSamplesY = uint32(numSamplesY);
+    args.SetArgs.Pattern = firstPattern;
+    args.PatternPerSet = true;
+    InitSampleTable(*this, args, numSamplesX * numSamplesY, numPatterns);
+}
+
+void SampleTable2D::Shutdown()
+{
+    X.Shutdown();
+    Y.Shutdown();
+    NumSamples = 0;
+    NumSets = 0;
+}
+
+// == Benchmarking ================================================================================
+
+static uint64 CountMismatches(const Float2* samples, const float* samplesX, const float* samplesY, uint64 numSamples)
+{
+    uint64 numMismatches = 0;
+    for(uint64 i = 0; i < numSamples; ++i)
+    {
+        if(memcmp(&samples[i].x, &samplesX[i], sizeof(float)) != 0 || memcmp(&samples[i].y, &samplesY[i], sizeof(float)) != 0)
+            ++numMismatches;
+    }
+
+    return numMismatches;
+}
+
+static void LogSampleBenchmark(const char* name, uint64 numSamples, double scalarMS, double batchMS, uint64 numMismatches)
+{
+    WriteLog("    %s: scalar %.2fms, batch %.2fms (%.1fx), %llu/%llu samples differ", name, scalarMS, batchMS,
+             batchMS > 0.0 ? scalarMS / batchMS : 0.0, numMismatches, numSamples);
+}
+
+// Runs each scalar generator against its batch version, and returns how many samples differ in total.
+// CMJ uses the largest grid that fits in numSamples, which is all of them when numSamples is a square.
+static uint64 CompareSampleGenerators(uint64 numSamples, bool logResults)
+{
+    Assert_(numSamples > 0);
+
+    Array<Float2> samples(numSamples);
+    Array<float> samplesX(numSamples);
+    Array<float> samplesY(numSamples);
+    uint64 totalMismatches = 0;
+
+    const uint64 hammersleyDims[] = { 0, 3 };
+    for(uint64 dimIdx : hammersleyDims)
+    {
+        Timer scalarTimer;
+        GenerateHammersleySamples2D(samples.Data(), numSamples, dimIdx);
+        scalarTimer.Update();
+
+        Timer batchTimer;
+        GenerateHammersleySamples2D(samplesX.Data(), samplesY.Data(), numSamples, dimIdx);
+        batchTimer.Update();
+
+        const uint64 numMismatches = CountMismatches(samples.Data(), samplesX.Data(), samplesY.Data(), numSamples);
+        if(logResults)
+            LogSampleBenchmark(dimIdx == 0 ? "Hammersley" : "Hammersley (dimension 3)", numSamples,
+                               scalarTimer.ElapsedMillisecondsD(), batchTimer.ElapsedMillisecondsD(), numMismatches);
+        totalMismatches += numMismatches;
+    }
+
+    {
+        const uint32 pattern = 0x1234;
+        const uint64 cmjSamplesX = Max<uint64>(uint64(std::sqrt(double(numSamples))), 1);
+        const uint64 cmjSamplesY = numSamples / cmjSamplesX;
+        const uint64 numCMJSamples = cmjSamplesX * cmjSamplesY;
+
+        Timer scalarTimer;
+        GenerateCMJSamples2D(samples.Data(), cmjSamplesX, cmjSamplesY, pattern);
+        scalarTimer.Update();
+
+        Timer batchTimer;
+        GenerateCMJSamples2D(samplesX.Data(), samplesY.Data(), cmjSamplesX, cmjSamplesY, pattern);
+        batchTimer.Update();
+
+        const uint64 numMismatches = CountMismatches(samples.Data(), samplesX.Data(), samplesY.Data(), numCMJSamples);
+        if(logResults)
+            LogSampleBenchmark("CMJ", numCMJSamples, scalarTimer.ElapsedMillisecondsD(), batchTimer.ElapsedMillisecondsD(), numMismatches);
+        totalMismatches += numMismatches;
+    }
+
+    {
+        Random scalarRNG;
+        Random batchRNG;
+
+        Timer scalarTimer;
+        GenerateLatinHypercubeSamples2D(samples.Data(), numSamples, scalarRNG);
+        scalarTimer.Update();
+
+        Timer batchTimer;
+        GenerateLatinHypercubeSamples2D(samplesX.Data(), samplesY.Data(), numSamples, batchRNG);
+        batchTimer.Update();
+
+        const uint64 numMismatches = CountMismatches(samples.Data(), samplesX.Data(), samplesY.Data(), numSamples);
+        if(logResults)
+            LogSampleBenchmark("Latin hypercube", numSamples, scalarTimer.ElapsedMillisecondsD(), batchTimer.ElapsedMillisecondsD(), numMismatches);
+        totalMismatches += numMismatches;
+    }
+
+    {
+        // Lots of small sets that get re-used, which is the typical case for per-pixel CMJ patterns
+        const uint64 tableSamplesX = 4;
+        const uint64 numPatterns = Max<uint64>(numSamples / (tableSamplesX * tableSamplesX), 1);
+
+        Timer scalarTimer;
+        Array<Float2> patternSamples(tableSamplesX * tableSamplesX * numPatterns);
+        for(uint64 patternIdx = 0; patternIdx < numPatterns; ++patternIdx)
+            GenerateCMJSamples2D(&patternSamples[patternIdx * tableSamplesX * tableSamplesX], tableSamplesX, tableSamplesX, uint32(patternIdx));
+        scalarTimer.Update();
+
+        Timer batchTimer;
+        SampleTable2D table;
+        table.InitCMJ(tableSamplesX, tableSamplesX, numPatterns);
+        batchTimer.Update();
+
+        const uint64 numMismatches = CountMismatches(patternSamples.Data(), table.X.Data(), table.Y.Data(), patternSamples.Size());
+        if(logResults)
+            LogSampleBenchmark("CMJ table (4x4 patterns)", patternSamples.Size(), scalarTimer.ElapsedMillisecondsD(),
+                               batchTimer.ElapsedMillisecondsD(), numMismatches);
+        totalMismatches += numMismatches;
+    }
+
+    return totalMismatches;
+}
+
+bool BenchmarkSampleGenerators(uint64 numSamples)
+{
+    WriteLog("Sample generator benchmark: %llu samples, %u threads", numSamples, Tasks::NumThreads());
+    return CompareSampleGenerators(numSamples, true) == 0;
+}
+
+bool ValidateSampleGenerators()
+{
+    bool passed = true;
+
+    // Small and odd counts cover the remainder handling, and the last one is big enough to be split across threads
+    const uint64 sampleCounts[] = { 1, 2, 7, 16, 33, 1000, ParallelSampleThreshold + 1000 };
+    for(uint64 numSamples : sampleCounts)
+    {
+        const uint64 numMismatches = CompareSampleGenerators(numSamples, false);
+        if(numMismatches > 0)
+        {
+            WriteLog("The batch sample generators produced %llu mismatched samples for %llu samples", numMismatches, numSamples);
+            passed = false;
+        }
+    }
+
+    WriteLog("Sample generator validation %s", passed ? "passed" : "FAILED");
+
+    return passed;
+}
 
 }
\ No newline at end of file
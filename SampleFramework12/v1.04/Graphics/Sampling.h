@@ -9,6 +9,7 @@
 
 #include "..\\PCH.h"
 #include "..\\SF12_Math.h"
+#include "..\\Containers.h"
 
 namespace SampleFramework12
 {
@@ -49,6 +50,51 @@ void GenerateHammersleySamples2D(Float2* samples, uint64 numSamples, uint64 dimI
 void GenerateLatinHypercubeSamples2D(Float2* samples, uint64 numSamples, Random& rng);
 void GenerateCMJSamples2D(Float2* samples, uint64 numSamplesX, uint64 numSamplesY, uint32 pattern);
 
+// Batch sample set generation into separate X/Y arrays. The results are bit-identical to the Float2 versions,
+// but are generated 4 at a time with SSE2 (or one at a time where SSE isn't available), and large sets are
+// split across the task scheduler's threads.
+void GenerateHammersleySamples2D(float* samplesX, float* samplesY, uint64 numSamples, uint64 dimIdx = 0);
+void GenerateLatinHypercubeSamples2D(float* samplesX, float* samplesY, uint64 numSamples, Random& rng);
+void GenerateCMJSamples2D(float* samplesX, float* samplesY, uint64 numSamplesX, uint64 numSamplesY, uint32 pattern);
+
+// Fills "values" with RadicalInverseFast(baseIdx, startIdx + i) for i in [0, count)
+void GenerateRadicalInverseSequence(float* values, uint64 baseIdx, uint64 startIdx, uint64 count);
+
+// Precomputed sample sets for when the same sets are used over and over (i.e. one CMJ pattern per pixel).
+// Each set is stored contiguously as SoA, so iterating over the samples in a set reads sequential memory.
+struct SampleTable2D
+{
+    Array<float> X;
+    Array<float> Y;
+    uint64 NumSamples = 0;
+    uint64 NumSets = 0;
+
+    // One set per Hammersley dimension, starting with dimension 0
+    void InitHammersley(uint64 numSamples, uint64 numDimensions);
+
+    // One set per CMJ pattern, starting with firstPattern
+    void InitCMJ(uint64 numSamplesX, uint64 numSamplesY, uint64 numPatterns, uint32 firstPattern = 0);
+
+    void Shutdown();
+
+    Float2 Sample(uint64 setIdx, uint64 sampleIdx) const
+    {
+        Assert_(setIdx < NumSets && sampleIdx < NumSamples);
+        const uint64 idx = setIdx * NumSamples + sampleIdx;
+        return Float2(X[idx], Y[idx]);
+    }
+
+    const float* SetX(uint64 setIdx) const { return &X[setIdx * NumSamples]; }
+    const float* SetY(uint64 setIdx) const { return &Y[setIdx * NumSamples]; }
+};
+
+// Times the scalar and batch generators against each other, and checks that they match bit-for-bit.
+// Results are written to the log, and the return value is false if any samples differ.
+bool BenchmarkSampleGenerators(uint64 numSamples = 1024 * 1024);
+
+// Checks that the scalar and batch generators match bit-for-bit over a range of small sample counts
+bool ValidateSampleGenerators();
+
 // Helpers
 float RadicalInverseBase2(uint32 bits);
 float RadicalInverseFast(uint64 baseIndex, uint64 index);
@@ -18,6 +18,8 @@
 #include "../FileIO.h"
 #include "../MurmurHash.h"
 #include "../Containers.h"
+#include "../Tasks.h"
+#include "../Timer.h"
 
 using std::vector;
 using std::wstring;
@@ -34,7 +36,7 @@ namespace AppSettings
 namespace SampleFramework12
 {
 
-static const uint64 CacheVersion = 1;
+static const uint64 CacheVersion = 2;
 
 static const char* TypeStrings[] = { "vertex", "hull", "domain", "geometry", "pixel", "compute", "lib" };
 StaticAssert_(ArraySize_(TypeStrings) == uint64(ShaderType::NumTypes));
@@ -60,77 +62,142 @@ static Hash MakeCompilerHash()
     wchar dllPath[1024] = { };
     GetModuleFileName(module, dllPath, ArraySize_(dllPath));
 
-    File dllFile(dllPath, FileOpenMode::Read);
-    uint64 fileSize = dllFile.Size();
-    Array<uint8> fileData(fileSize);
-    dllFile.Read(fileSize, fileData.Data());
-
-    return GenerateHash(fileData.Data(), int32(fileSize));
+    return GenerateFileHash(dllPath);
 }
 
 static Hash CompilerHash = MakeCompilerHash();
 
-static string GetExpandedShaderCode(const wchar* path, List<wstring>& filePaths)
+// Memoised per-file data used for building cache keys, so that we never need to read and
+// splice together the full expanded source code for a shader just to find out if it's cached
+struct IncludeFileInfo
 {
-    for(uint64 i = 0; i < filePaths.Count(); ++i)
-        if(filePaths[i] == path)
-            return string();
+    uint64 TimeStamp = 0;
+    uint64 FileSize = 0;
+    Hash ContentHash;
+    List<wstring> Includes;
+};
 
-    filePaths.Add(path);
+static std::unordered_map<wstring, IncludeFileInfo> IncludeFileCache;
+static SRWLOCK IncludeFileCacheLock = SRWLOCK_INIT;
 
-    string fileContents = ReadFileAsString(path);
+// Combines two hashes in an order-dependent way (unlike CombineHashes, which is commutative)
+static Hash AccumulateHash(Hash current, Hash next)
+{
+    const Hash hashes[2] = { current, next };
+    return GenerateHash(hashes, sizeof(hashes));
+}
 
+// Scans a file line-by-line for #include statements, without making copies of each line
+static void ParseIncludes(const wchar* path, const string& fileContents, List<wstring>& includes)
+{
     wstring fileDirectory = GetDirectoryFromFilePath(path);
     if(fileDirectory.length() > 0)
         fileDirectory += L"\\";
 
-    // Look for includes
-    size_t lineStart = 0;
-    while(true)
+    static const char IncludeToken[] = "#include";
+    const uint64 tokenLength = ArraySize_(IncludeToken) - 1;
+
+    const char* text = fileContents.c_str();
+    const char* textEnd = text + fileContents.length();
+    const char* lineStart = text;
+    while(lineStart < textEnd)
     {
-        size_t lineEnd = fileContents.find('\n', lineStart);
-        size_t lineLength = 0;
-        if(lineEnd == string::npos)
-            lineLength = string::npos;
-        else
-            lineLength = lineEnd - lineStart;
+        const char* lineEnd = reinterpret_cast<const char*>(memchr(lineStart, '\n', textEnd - lineStart));
+        if(lineEnd == nullptr)
+            lineEnd = textEnd;
 
-        string line = fileContents.substr(lineStart, lineLength);
-        if(line.find("#include") == 0)
+        const uint64 lineLength = uint64(lineEnd - lineStart);
+        if(lineLength >= tokenLength && strncmp(lineStart, IncludeToken, tokenLength) == 0)
         {
+            const std::string_view line(lineStart, lineLength);
+
             wstring fullIncludePath;
             size_t startQuote = line.find('\"');
-            if(startQuote != -1)
+            if(startQuote != std::string_view::npos)
             {
                 size_t endQuote = line.find('\"', startQuote + 1);
-                string includePath = line.substr(startQuote + 1, endQuote - startQuote - 1);
+                string includePath(line.substr(startQuote + 1, endQuote - startQuote - 1));
                 fullIncludePath = fileDirectory + AnsiToWString(includePath.c_str());
             }
             else
             {
                 startQuote = line.find('<');
-                if(startQuote == -1)
-                    throw Exception(L"Malformed include statement: \"" + AnsiToWString(line.c_str()) + L"\" in file " + path);
+                if(startQuote == std::string_view::npos)
+                    throw Exception(L"Malformed include statement: \"" + AnsiToWString(string(line).c_str()) + L"\" in file " + path);
                 size_t endQuote = line.find('>', startQuote + 1);
-                string includePath = line.substr(startQuote + 1, endQuote - startQuote - 1);
+                string includePath(line.substr(startQuote + 1, endQuote - startQuote - 1));
                 fullIncludePath = SampleFrameworkDir() + L"Shaders\\" + AnsiToWString(includePath.c_str());
             }
 
             if(FileExists(fullIncludePath.c_str()) == false)
                 throw Exception(L"Couldn't find #included file \"" + fullIncludePath + L"\" in file " + path);
 
-            string includeCode = GetExpandedShaderCode(fullIncludePath.c_str(), filePaths);
-            fileContents.insert(lineEnd + 1, includeCode);
-            lineEnd += includeCode.length();
+            includes.Add(fullIncludePath);
         }
 
-        if(lineEnd == string::npos)
-            break;
-
         lineStart = lineEnd + 1;
     }
+}
+
+// Returns the content hash and direct includes for a file, only re-reading it if the timestamp or size changed.
+// Checking the size as well catches edits that land within the timestamp resolution of the file system.
+static void GetIncludeFileInfo(const wstring& path, Hash& contentHash, List<wstring>& includes)
+{
+    uint64 timeStamp = 0;
+    uint64 fileSize = 0;
+    GetFileTimestampAndSize(path.c_str(), timeStamp, fileSize);
+
+    AcquireSRWLockShared(&IncludeFileCacheLock);
+
+    auto cached = IncludeFileCache.find(path);
+    if(cached != IncludeFileCache.end() && cached->second.TimeStamp == timeStamp && cached->second.FileSize == fileSize)
+    {
+        contentHash = cached->second.ContentHash;
+        includes = cached->second.Includes;
+
+        ReleaseSRWLockShared(&IncludeFileCacheLock);
+        return;
+    }
+
+    ReleaseSRWLockShared(&IncludeFileCacheLock);
+
+    const string fileContents = ReadFileAsString(path.c_str());
 
-    return fileContents;
+    IncludeFileInfo info;
+    info.TimeStamp = timeStamp;
+    info.FileSize = fileSize;
+    info.ContentHash = GenerateHash(fileContents.data(), fileContents.length());
+    ParseIncludes(path.c_str(), fileContents, info.Includes);
+
+    contentHash = info.ContentHash;
+    includes = info.Includes;
+
+    AcquireSRWLockExclusive(&IncludeFileCacheLock);
+
+    IncludeFileCache[path] = std::move(info);
+
+    ReleaseSRWLockExclusive(&IncludeFileCacheLock);
+}
+
+// Walks the include tree depth-first (skipping files that were already included, which matches
+// how the files would be expanded), and folds each file's content hash into the tree hash in
+// traversal order. The resulting hash changes if any file in the tree or its structure changes.
+static void ResolveIncludeTree(const wstring& path, List<wstring>& filePaths, Hash& treeHash)
+{
+    for(uint64 i = 0; i < filePaths.Count(); ++i)
+        if(filePaths[i] == path)
+            return;
+
+    filePaths.Add(path);
+
+    Hash contentHash;
+    List<wstring> includes;
+    GetIncludeFileInfo(path, contentHash, includes);
+
+    treeHash = AccumulateHash(treeHash, contentHash);
+
+    for(const wstring& includePath : includes)
+        ResolveIncludeTree(includePath, filePaths, treeHash);
 }
 
 static const wstring baseCacheDir = L"ShaderCache\\";
@@ -159,11 +226,10 @@ static string MakeDefinesString(const D3D_SHADER_MACRO* defines)
     return definesString;
 }
 
-static wstring MakeShaderCacheName(const std::string& shaderCode, const char* functionName,
+static wstring MakeShaderCacheName(Hash includeTreeHash, const char* functionName,
                                    const char* profile, const D3D_SHADER_MACRO* defines)
 {
-    string hashString = shaderCode;
-    hashString += "\n";
+    string hashString;
     if(functionName != nullptr)
     {
         hashString += functionName;
@@ -176,7 +242,8 @@ static wstring MakeShaderCacheName(const std::string& shaderCode, const char* fu
 
     hashString += MakeString("%llu", CacheVersion);
 
-    Hash codeHash = GenerateHash(hashString.data(), int(hashString.length()), 0);
+    Hash codeHash = GenerateHash(hashString.data(), hashString.length(), 0);
+    codeHash = AccumulateHash(includeTreeHash, codeHash);
     codeHash = CombineHashes(codeHash, CompilerHash);
 
     return cacheDir + codeHash.ToString() + L".cache";
@@ -258,9 +325,11 @@ static HRESULT CompileShaderDXC(const wchar* path, const D3D_SHADER_MACRO* defin
     return hr;
 }
 
-static void CompileShader(const wchar* path, const char* functionName, ShaderType type,
-                          const CompileOptions& baseCompileOpts, List<wstring>& filePaths,
-                          Array<uint8>& byteCode, bool& includesAppSettings)
+// Resolves the include tree and the final set of defines for a shader, and returns the path of
+// the file where its compiled byte code lives in the shader cache
+static wstring PrepareShaderCompile(const wchar* path, const char* functionName, ShaderType type,
+                                    const CompileOptions& baseCompileOpts, List<wstring>& filePaths,
+                                    CompileOptions& opts, bool& includesAppSettings)
 {
     if(FileExists(path) == false)
     {
@@ -273,8 +342,9 @@ static void CompileShader(const wchar* path, const char* functionName, ShaderTyp
     const char* profileString = ProfileStrings[profileIdx];
     includesAppSettings = false;
 
-    // Make a hash off the expanded shader code
-    string shaderCode = GetExpandedShaderCode(path, filePaths);
+    // Make a hash from the contents of every file in the include tree
+    Hash includeTreeHash;
+    ResolveIncludeTree(path, filePaths, includeTreeHash);
 
     for(const wstring& filePath : filePaths)
     {
@@ -286,20 +356,34 @@ static void CompileShader(const wchar* path, const char* functionName, ShaderTyp
     }
 
     // Add AppSettings compile-time constants if necessary
-    CompileOptions opts = baseCompileOpts;
+    opts = baseCompileOpts;
     if(includesAppSettings)
         AppSettings::GetShaderCompileOptions(opts);
 
     D3D_SHADER_MACRO defines[CompileOptions::MaxDefines + 1] = { };
     opts.MakeDefines(defines);
 
-    wstring cacheName = MakeShaderCacheName(shaderCode, functionName, profileString, defines);
+    return MakeShaderCacheName(includeTreeHash, functionName, profileString, defines);
+}
 
-    if(FileExists(cacheName.c_str()))
+static void EnsureDirectoryExists(const wstring& dirPath)
+{
+    // Multiple threads can race to create the directory, so it's fine if it already exists
+    if(DirectoryExists(dirPath.c_str()) == false)
     {
-        ReadFileAsByteArray(cacheName.c_str(), byteCode);
-        return;
+        if(CreateDirectory(dirPath.c_str(), nullptr) == FALSE && GetLastError() != ERROR_ALREADY_EXISTS)
+            throw Win32Exception(GetLastError());
     }
+}
+
+// Compiles a shader with DXC, and writes the compiled byte code to the shader cache
+static void CompileAndCacheShader(const wchar* path, const char* functionName, ShaderType type,
+                                  const CompileOptions& opts, const wstring& cacheName, Array<uint8>& byteCode)
+{
+    const char* profileString = ProfileStrings[uint64(type)];
+
+    D3D_SHADER_MACRO defines[CompileOptions::MaxDefines + 1] = { };
+    opts.MakeDefines(defines);
 
     if(type == ShaderType::Library)
     {
@@ -340,17 +424,18 @@ static void CompileShader(const wchar* path, const char* functionName, ShaderTyp
         else
         {
             // Create the cache directory if it doesn't exist
-            if(DirectoryExists(baseCacheDir.c_str()) == false)
-                Win32Call(CreateDirectory(baseCacheDir.c_str(), nullptr));
-
-            if(DirectoryExists(cacheDir.c_str()) == false)
-                Win32Call(CreateDirectory(cacheDir.c_str(), nullptr));
-
-            File cacheFile(cacheName.c_str(), FileOpenMode::Write);
+            EnsureShaderCacheDirExists();
 
-            // Write the compiled shader to disk
+            // Write the compiled shader to a temporary file and then move it into place, so that
+            // other threads never see a partially-written cache file (or collide when writing it)
             const uint64 shaderSize = compiledShader->GetBufferSize();
-            cacheFile.Write(shaderSize, compiledShader->GetBufferPointer());
+            const wstring tempName = MakeString(L"%s.%u.tmp", cacheName.c_str(), GetCurrentThreadId());
+            {
+                File cacheFile(tempName.c_str(), FileOpenMode::Write);
+                cacheFile.Write(shaderSize, compiledShader->GetBufferPointer());
+            }
+
+            Win32Call(MoveFileEx(tempName.c_str(), cacheName.c_str(), MOVEFILE_REPLACE_EXISTING));
 
             // Return the compiled shader bytecode
             byteCode.Init(shaderSize);
@@ -361,18 +446,70 @@ static void CompileShader(const wchar* path, const char* functionName, ShaderTyp
     }
 }
 
+static void CompileShader(const wchar* path, const char* functionName, ShaderType type,
+                          const CompileOptions& baseCompileOpts, List<wstring>& filePaths,
+                          Array<uint8>& byteCode, bool& includesAppSettings)
+{
+    CompileOptions opts;
+    const wstring cacheName = PrepareShaderCompile(path, functionName, type, baseCompileOpts,
+                                                   filePaths, opts, includesAppSettings);
+
+    if(FileExists(cacheName.c_str()))
+    {
+        ReadFileAsByteArray(cacheName.c_str(), byteCode);
+        return;
+    }
+
+    CompileAndCacheShader(path, functionName, type, opts, cacheName, byteCode);
+}
+
+// Returns a full, lower-case version of a path that can be used for looking up files regardless
+// of how the path was spelled in an #include or a change notification
+static wstring NormalizeShaderPath(const wchar* path)
+{
+    wchar fullPath[1024] = { };
+    const DWORD length = GetFullPathName(path, ArraySize_(fullPath), fullPath, nullptr);
+    if(length == 0 || length >= ArraySize_(fullPath))
+        return wstring(path);
+
+    CharLowerBuff(fullPath, length);
+    return wstring(fullPath, length);
+}
+
 struct ShaderFile
 {
     wstring FilePath;
+    wstring NormalizedPath;
     uint64 TimeStamp;
-    List<CompiledShader*> Shaders;
+    List<CompiledShader*> Shaders;      // Every shader whose include tree contains this file
 
-    ShaderFile(const wstring& filePath) : TimeStamp(0), FilePath(filePath)
+    // Change notifications are debounced, since editors often write a file multiple times in a row
+    bool ChangePending = false;
+    uint64 LastChangeTime = 0;
+
+    ShaderFile(const wstring& filePath, const wstring& normalizedPath) : FilePath(filePath), NormalizedPath(normalizedPath),
+                                                                         TimeStamp(0)
     {
     }
 };
 
+// Watches a directory for changes using ReadDirectoryChangesW with overlapped I/O, which lets us
+// poll for notifications each frame without blocking and without touching every shader file
+struct DirectoryWatch
+{
+    wstring DirPath;
+    HANDLE DirHandle = INVALID_HANDLE_VALUE;
+    OVERLAPPED Overlapped = { };
+    bool Started = false;
+    bool Failed = false;
+
+    alignas(DWORD) uint8 NotifyBuffer[16 * 1024] = { };
+};
+
 static List<ShaderFile*> ShaderFiles;
+static std::unordered_map<wstring, ShaderFile*> ShaderFileMap;
+static std::unordered_map<wstring, DirectoryWatch*> DirectoryWatches;
+static List<ShaderFile*> PendingShaderFiles;
 static List<CompiledShader*> CompiledShaders;
 static SRWLOCK ShaderFilesLock = SRWLOCK_INIT;
 static SRWLOCK CompiledShadersLock = SRWLOCK_INIT;
@@ -385,30 +522,42 @@ static void CompileShader(CompiledShader* shader)
 
     List<wstring> filePaths;
     CompileShader(shader->FilePath.c_str(), functionName, shader->Type, shader->CompileOpts, filePaths, shader->ByteCode, shader->IncludesAppSettings);
-    shader->ByteCodeHash = GenerateHash(shader->ByteCode.Data(), int(shader->ByteCode.Size()));
+    shader->ByteCodeHash = GenerateHash(shader->ByteCode.Data(), shader->ByteCode.Size());
+
+    List<wstring> normalizedPaths;
+    for(const wstring& filePath : filePaths)
+        normalizedPaths.Add(NormalizeShaderPath(filePath.c_str()));
+
+    // Shaders can be compiled from multiple threads, so the file list needs to stay locked
+    // for the whole lookup + add
+    AcquireSRWLockExclusive(&ShaderFilesLock);
 
     for(uint64 fileIdx = 0; fileIdx < filePaths.Count(); ++ fileIdx)
     {
-        const wstring& filePath = filePaths[fileIdx];
+        const wstring& normalizedPath = normalizedPaths[fileIdx];
         ShaderFile* shaderFile = nullptr;
-        const uint64 numShaderFiles = ShaderFiles.Count();
-        for(uint64 shaderFileIdx = 0; shaderFileIdx < numShaderFiles; ++shaderFileIdx)
+
+        auto existing = ShaderFileMap.find(normalizedPath);
+        if(existing != ShaderFileMap.end())
         {
-            if(ShaderFiles[shaderFileIdx]->FilePath == filePath)
-            {
-                shaderFile = ShaderFiles[shaderFileIdx];
-                break;
-            }
+            shaderFile = existing->second;
         }
-        if(shaderFile == nullptr)
+        else
         {
-            shaderFile = new ShaderFile(filePath);
-
-            AcquireSRWLockExclusive(&ShaderFilesLock);
-
+            shaderFile = new ShaderFile(filePaths[fileIdx], normalizedPath);
+            shaderFile->TimeStamp = GetFileTimestamp(filePaths[fileIdx].c_str());
             ShaderFiles.Add(shaderFile);
+            ShaderFileMap[normalizedPath] = shaderFile;
 
-            ReleaseSRWLockExclusive(&ShaderFilesLock);
+            // The watch itself gets started from UpdateShaders on the main thread, since pending
+            // overlapped I/O is cancelled if the thread that issued it exits
+            const wstring dirPath = GetDirectoryFromFilePath(normalizedPath.c_str());
+            if(DirectoryWatches.find(dirPath) == DirectoryWatches.end())
+            {
+                DirectoryWatch* watch = new DirectoryWatch();
+                watch->DirPath = dirPath;
+                DirectoryWatches[dirPath] = watch;
+            }
         }
 
         bool containsShader = false;
@@ -424,6 +573,8 @@ static void CompileShader(CompiledShader* shader)
         if(containsShader == false)
             shaderFile->Shaders.Add(shader);
     }
+
+    ReleaseSRWLockExclusive(&ShaderFilesLock);
 }
 
 CompiledShaderPtr CompileFromFile(const wchar* path, const char* functionName,
@@ -446,86 +597,789 @@ CompiledShaderPtr CompileFromFile(const wchar* path, const char* functionName,
     return compiledShader;
 }
 
+// == Async compilation ===========================================================================
+
+struct ShaderCompileJob
+{
+    CompiledShader* Shader = nullptr;
+    enkiTaskSet* TaskSet = nullptr;
+    bool Failed = false;
+    std::wstring ErrorMessage;
+};
+
+static void CompileShaderJobTask(uint32 start, uint32 end, uint32 threadNum, void* args)
+{
+    ShaderCompileJob* job = reinterpret_cast<ShaderCompileJob*>(args);
+
+    // Exceptions can't propagate out of a task, so we stash the message and re-throw from Wait()
+    try
+    {
+        CompileShader(job->Shader);
+    }
+    catch(Exception& exception)
+    {
+        job->Failed = true;
+        job->ErrorMessage = exception.GetMessage();
+    }
+}
+
+// Waits for the job to finish and frees it. Returns the compiled shader on success, or
+// null if the compilation failed (in which case the error message is returned)
+static CompiledShader* FinishCompileJob(ShaderCompileJob* job, std::wstring& errorMessage)
+{
+    Assert_(job != nullptr);
+
+    Tasks::WaitForTaskSet(job->TaskSet);
+    job->TaskSet = nullptr;
+
+    CompiledShader* shader = job->Shader;
+    if(job->Failed)
+    {
+        errorMessage = job->ErrorMessage;
+        delete shader;
+        shader = nullptr;
+    }
+    else
+    {
+        AcquireSRWLockExclusive(&CompiledShadersLock);
+
+        CompiledShaders.Add(shader);
+
+        ReleaseSRWLockExclusive(&CompiledShadersLock);
+    }
+
+    delete job;
+
+    return shader;
+}
+
+ShaderCompileHandle CompileFromFileAsync(const wchar* path, const char* functionName,
+                                         ShaderType type, const CompileOptions& compileOpts)
+{
+    if(type == ShaderType::Library)
+    {
+        Assert_(functionName == nullptr);
+    }
+
+    ShaderCompileJob* job = new ShaderCompileJob();
+    job->Shader = new CompiledShader(path, functionName, compileOpts, type);
+
+    job->TaskSet = Tasks::BeginParallelFor(1, 1, CompileShaderJobTask, job);
+
+    return ShaderCompileHandle(job);
+}
+
+struct PrecompileTaskArgs
+{
+    const wchar* Path = nullptr;
+    const char* FunctionName = nullptr;
+    ShaderType Type = ShaderType::NumTypes;
+    const CompileOptions* CompileOpts = nullptr;
+    const wstring* CacheNames = nullptr;
+
+    SRWLOCK ErrorLock = SRWLOCK_INIT;
+    bool Failed = false;
+    std::wstring ErrorMessage;
+};
+
+static void PrecompileTask(uint32 start, uint32 end, uint32 threadNum, void* args_)
+{
+    PrecompileTaskArgs* args = reinterpret_cast<PrecompileTaskArgs*>(args_);
+    for(uint32 i = start; i < end; ++i)
+    {
+        try
+        {
+            Array<uint8> byteCode;
+            CompileAndCacheShader(args->Path, args->FunctionName, args->Type, args->CompileOpts[i], args->CacheNames[i], byteCode);
+        }
+        catch(Exception& exception)
+        {
+            AcquireSRWLockExclusive(&args->ErrorLock);
+
+            if(args->Failed == false)
+            {
+                args->Failed = true;
+                args->ErrorMessage = exception.GetMessage();
+            }
+
+            ReleaseSRWLockExclusive(&args->ErrorLock);
+        }
+    }
+}
+
+void PrecompileFromFile(const wchar* path, const char* functionName, ShaderType type,
+                        const CompileOptions* compileOpts, uint64 numCompileOpts)
+{
+    if(type == ShaderType::Library)
+    {
+        Assert_(functionName == nullptr);
+    }
+
+    Assert_(compileOpts != nullptr || numCompileOpts == 0);
+
+    // Resolving the cache names is cheap (the include tree is memoised), so do that serially up-front
+    // and only kick off compiles for permutations that aren't already cached. This also lets us
+    // skip duplicate permutations, which would otherwise be compiled twice.
+    List<CompileOptions> compileList(numCompileOpts);
+    List<wstring> cacheNames(numCompileOpts);
+    for(uint64 i = 0; i < numCompileOpts; ++i)
+    {
+        List<wstring> filePaths;
+        CompileOptions opts;
+        bool includesAppSettings = false;
+        wstring cacheName = PrepareShaderCompile(path, functionName, type, compileOpts[i], filePaths, opts, includesAppSettings);
+        if(FileExists(cacheName.c_str()))
+            continue;
+
+        bool duplicate = false;
+        for(const wstring& existingName : cacheNames)
+        {
+            if(existingName == cacheName)
+            {
+                duplicate = true;
+                break;
+            }
+        }
+
+        if(duplicate)
+            continue;
+
+        compileList.Add(opts);
+        cacheNames.Add(cacheName);
+    }
+
+    if(compileList.Count() == 0)
+        return;
+
+    PrecompileTaskArgs args;
+    args.Path = path;
+    args.FunctionName = functionName;
+    args.Type = type;
+    args.CompileOpts = compileList.Data();
+    args.CacheNames = cacheNames.Data();
+    Tasks::ParallelFor(uint32(compileList.Count()), 1, PrecompileTask, &args);
+
+    if(args.Failed)
+        throw Exception(args.ErrorMessage);
+}
+
+struct RecompileTaskArgs
+{
+    CompiledShader** Shaders = nullptr;
+
+    SRWLOCK ErrorLock = SRWLOCK_INIT;
+    bool Failed = false;
+    std::wstring ErrorMessage;
+    List<CompiledShader*> FileErrorShaders;
+};
+
+static void RecompileTask(uint32 start, uint32 end, uint32 threadNum, void* args_)
+{
+    RecompileTaskArgs* args = reinterpret_cast<RecompileTaskArgs*>(args_);
+    for(uint32 i = start; i < end; ++i)
+    {
+        try
+        {
+            CompileShader(args->Shaders[i]);
+        }
+        catch(Win32Exception&)
+        {
+            // Most likely a text editor still has the file open, so the caller will try again later
+            AcquireSRWLockExclusive(&args->ErrorLock);
+
+            args->FileErrorShaders.Add(args->Shaders[i]);
+
+            ReleaseSRWLockExclusive(&args->ErrorLock);
+        }
+        catch(Exception& exception)
+        {
+            AcquireSRWLockExclusive(&args->ErrorLock);
+
+            if(args->Failed == false)
+            {
+                args->Failed = true;
+                args->ErrorMessage = exception.GetMessage();
+            }
+
+            ReleaseSRWLockExclusive(&args->ErrorLock);
+        }
+    }
+}
+
+// Re-compiles a set of independent shaders in parallel across the task scheduler's threads. Shaders whose
+// files couldn't be accessed are added to fileErrorShaders, so that the caller can retry them later.
+static void RecompileShaders(List<CompiledShader*>& shaders, List<CompiledShader*>& fileErrorShaders)
+{
+    if(shaders.Count() == 0)
+        return;
+
+    RecompileTaskArgs args;
+    args.Shaders = shaders.Data();
+    Tasks::ParallelFor(uint32(shaders.Count()), 1, RecompileTask, &args);
+
+    if(args.Failed)
+        throw Exception(args.ErrorMessage);
+
+    for(CompiledShader* shader : args.FileErrorShaders)
+        fileErrorShaders.Add(shader);
+}
+
+static const uint64 ChangeDebounceTimeMS = 100;
+static const uint64 MaxFileErrorRetries = 100;
+
+// A shader that couldn't be compiled because one of its files was locked, which gets compiled again on its own
+struct ShaderRetry
+{
+    CompiledShader* Shader = nullptr;
+    uint64 RetryTime = 0;
+    uint64 NumRetries = 0;
+};
+
+// Only touched from the main thread
+static List<ShaderRetry> ShaderRetries;
+
+// Called on the main thread only
+static void MarkShaderFileChanged(ShaderFile* file, uint64 changeTime)
+{
+    file->LastChangeTime = changeTime;
+    if(file->ChangePending == false)
+    {
+        file->ChangePending = true;
+        PendingShaderFiles.Add(file);
+    }
+}
+
+static void AddUniqueShader(List<CompiledShader*>& shaders, CompiledShader* shader)
+{
+    for(CompiledShader* existing : shaders)
+        if(existing == shader)
+            return;
+
+    shaders.Add(shader);
+}
+
+// Updates the retry list after a batch of compiles. Shaders that couldn't be compiled because a file was still locked
+// (usually by the editor that's saving it) get compiled again after a debounce period, instead of blocking the main
+// thread. Only those shaders are retried, not everything else that shares their includes.
+static void QueueFileErrorRetries(const List<CompiledShader*>& compiledShaders, const List<CompiledShader*>& fileErrorShaders,
+                                  uint64 currTime)
+{
+    for(uint64 retryIdx = 0; retryIdx < ShaderRetries.Count(); )
+    {
+        bool compiled = false;
+        for(CompiledShader* shader : compiledShaders)
+            compiled = compiled || shader == ShaderRetries[retryIdx].Shader;
+
+        bool failed = false;
+        for(CompiledShader* shader : fileErrorShaders)
+            failed = failed || shader == ShaderRetries[retryIdx].Shader;
+
+        if(compiled && failed == false)
+            ShaderRetries.Remove(retryIdx);
+        else
+            ++retryIdx;
+    }
+
+    for(CompiledShader* shader : fileErrorShaders)
+    {
+        ShaderRetry* retry = nullptr;
+        for(ShaderRetry& existing : ShaderRetries)
+            if(existing.Shader == shader)
+                retry = &existing;
+
+        if(retry == nullptr)
+        {
+            ShaderRetry newRetry;
+            newRetry.Shader = shader;
+            retry = &ShaderRetries[ShaderRetries.Add(newRetry)];
+        }
+
+        if(++retry->NumRetries > MaxFileErrorRetries)
+            throw Exception(L"Failed to access the files for shader " + shader->FilePath + L" while hot-reloading");
+
+        retry->RetryTime = currTime + ChangeDebounceTimeMS;
+    }
+}
+
+static void IssueDirectoryWatchRead(DirectoryWatch* watch)
+{
+    const DWORD notifyFilter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+    if(ReadDirectoryChangesW(watch->DirHandle, watch->NotifyBuffer, sizeof(watch->NotifyBuffer), FALSE,
+                             notifyFilter, nullptr, &watch->Overlapped, nullptr) == FALSE)
+    {
+        WriteLog("Failed to watch shader directory %ls for changes, hot-reloading is disabled for it\n", watch->DirPath.c_str());
+        CloseHandle(watch->DirHandle);
+        watch->DirHandle = INVALID_HANDLE_VALUE;
+        watch->Failed = true;
+    }
+}
+
+static void StartDirectoryWatch(DirectoryWatch* watch)
+{
+    watch->Started = true;
+    watch->DirHandle = CreateFile(watch->DirPath.c_str(), FILE_LIST_DIRECTORY,
+                                  FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if(watch->DirHandle == INVALID_HANDLE_VALUE)
+    {
+        WriteLog("Failed to open shader directory %ls for change notifications\n", watch->DirPath.c_str());
+        watch->Failed = true;
+        return;
+    }
+
+    IssueDirectoryWatchRead(watch);
+}
+
+static void StopDirectoryWatch(DirectoryWatch* watch)
+{
+    if(watch->DirHandle == INVALID_HANDLE_VALUE)
+        return;
+
+    CancelIoEx(watch->DirHandle, &watch->Overlapped);
+
+    DWORD numBytes = 0;
+    GetOverlappedResult(watch->DirHandle, &watch->Overlapped, &numBytes, TRUE);
+
+    CloseHandle(watch->DirHandle);
+    watch->DirHandle = INVALID_HANDLE_VALUE;
+}
+
+// Checks a directory watch for completed notifications without blocking, and marks any
+// affected shader files as changed. Returns true if the notification buffer overflowed.
+static bool PollDirectoryWatch(DirectoryWatch* watch, uint64 currTime)
+{
+    if(watch->Started == false)
+        StartDirectoryWatch(watch);
+
+    if(watch->Failed)
+        return false;
+
+    DWORD numBytes = 0;
+    if(GetOverlappedResult(watch->DirHandle, &watch->Overlapped, &numBytes, FALSE) == FALSE)
+    {
+        if(GetLastError() != ERROR_IO_INCOMPLETE)
+        {
+            WriteLog("Lost change notifications for shader directory %ls\n", watch->DirPath.c_str());
+            CloseHandle(watch->DirHandle);
+            watch->DirHandle = INVALID_HANDLE_VALUE;
+            watch->Failed = true;
+        }
+
+        return false;
+    }
+
+    // A zero-sized result means that the buffer overflowed, so we don't know which files changed
+    const bool overflowed = numBytes == 0;
+
+    const uint8* entry = watch->NotifyBuffer;
+    while(numBytes > 0)
+    {
+        const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(entry);
+
+        wstring filePath = watch->DirPath;
+        filePath.append(info->FileName, info->FileNameLength / sizeof(wchar));
+        CharLowerBuff(&filePath[0], DWORD(filePath.length()));
+
+        AcquireSRWLockShared(&ShaderFilesLock);
+
+        auto file = ShaderFileMap.find(filePath);
+        ShaderFile* shaderFile = file != ShaderFileMap.end() ? file->second : nullptr;
+
+        ReleaseSRWLockShared(&ShaderFilesLock);
+
+        if(shaderFile != nullptr)
+            MarkShaderFileChanged(shaderFile, currTime);
+
+        if(info->NextEntryOffset == 0)
+            break;
+        entry += info->NextEntryOffset;
+    }
+
+    IssueDirectoryWatchRead(watch);
+
+    return overflowed;
+}
+
 bool UpdateShaders(bool updateAll)
 {
+    AcquireSRWLockShared(&ShaderFilesLock);
+
     uint64 numShaderFiles = ShaderFiles.Count();
+
+    ReleaseSRWLockShared(&ShaderFilesLock);
+
     if(numShaderFiles == 0)
         return false;
 
+    const uint64 currTime = GetTickCount64();
+
     if(AppSettings::ShaderCompileOptionsChanged())
     {
         WriteLog("Hot-swapping shaders that use compile-time constants from AppSettings");
 
-        AcquireSRWLockExclusive(&CompiledShadersLock);
-
         // Re-compile all shaders that included AppSettings.hlsl
+        List<CompiledShader*> shadersToCompile;
+
+        AcquireSRWLockShared(&CompiledShadersLock);
+
         for(CompiledShader* shader : CompiledShaders)
         {
             if(shader->IncludesAppSettings)
-                CompileShader(shader);
+                shadersToCompile.Add(shader);
         }
 
-        ReleaseSRWLockExclusive(&CompiledShadersLock);
+        ReleaseSRWLockShared(&CompiledShadersLock);
+
+        List<CompiledShader*> fileErrorShaders;
+        RecompileShaders(shadersToCompile, fileErrorShaders);
+        QueueFileErrorRetries(shadersToCompile, fileErrorShaders, currTime);
 
         return true;
     }
 
-    static uint64 currFile = 0;
+    // Gather change notifications from all watched directories
+    List<DirectoryWatch*> watches;
+
+    AcquireSRWLockShared(&ShaderFilesLock);
+
+    for(auto& watch : DirectoryWatches)
+        watches.Add(watch.second);
 
-    const uint64 numShadersToCheck = updateAll ? numShaderFiles : 1;
-    bool shaderChanged = false;
+    ReleaseSRWLockShared(&ShaderFilesLock);
 
-    for(uint64 i = 0; i < numShadersToCheck; ++i)
+    for(DirectoryWatch* watch : watches)
     {
-        currFile = (currFile + 1) % uint64(numShaderFiles);
+        const bool overflowed = PollDirectoryWatch(watch, currTime);
+        updateAll = updateAll || overflowed;
+    }
 
-        ShaderFile* file = ShaderFiles[currFile];
-        const uint64 newTimeStamp = GetFileTimestamp(file->FilePath.c_str());
-        if(file->TimeStamp == 0)
+    if(updateAll)
+    {
+        // Check everything immediately, bypassing the debounce delay
+        AcquireSRWLockShared(&ShaderFilesLock);
+
+        for(ShaderFile* file : ShaderFiles)
+            MarkShaderFileChanged(file, 0);
+
+        ReleaseSRWLockShared(&ShaderFilesLock);
+    }
+
+    if(PendingShaderFiles.Count() == 0 && ShaderRetries.Count() == 0)
+        return false;
+
+    // Collect the shaders affected by files that have settled down, making sure that
+    // each shader is only compiled once even if multiple of its files changed
+    List<CompiledShader*> shadersToCompile;
+    for(uint64 pendingIdx = 0; pendingIdx < PendingShaderFiles.Count(); )
+    {
+        ShaderFile* file = PendingShaderFiles[pendingIdx];
+        if(currTime - file->LastChangeTime < ChangeDebounceTimeMS || FileExists(file->FilePath.c_str()) == false)
         {
-            file->TimeStamp = newTimeStamp;
-            return false;
+            ++pendingIdx;
+            continue;
         }
 
-        if(file->TimeStamp < newTimeStamp)
-        {
-            WriteLog("Hot-swapping shaders for %ls\n", file->FilePath.c_str());
-            file->TimeStamp = newTimeStamp;
-            for(uint64 fileIdx = 0; fileIdx < file->Shaders.Count(); ++fileIdx)
-            {
-                // Retry a few times to avoid file conflicts with text editors
-                const uint64 NumRetries = 1000;
-                for(uint64 retryCount = 0; retryCount < NumRetries; ++retryCount)
-                {
-                    try
-                    {
-                        CompiledShader* shader = file->Shaders[fileIdx];
-                        CompileShader(shader);
-                        break;
-                    }
-                    catch(Win32Exception& exception)
-                    {
-                        if(retryCount == NumRetries - 1)
-                            throw exception;
-                        Sleep(15);
-                    }
-                }
-            }
+        PendingShaderFiles.Remove(pendingIdx);
+        file->ChangePending = false;
 
-            shaderChanged = true;
-        }
+        // Ignore notifications that didn't actually modify the file
+        const uint64 newTimeStamp = GetFileTimestamp(file->FilePath.c_str());
+        if(newTimeStamp == file->TimeStamp)
+            continue;
+
+        WriteLog("Hot-swapping shaders for %ls\n", file->FilePath.c_str());
+        file->TimeStamp = newTimeStamp;
+
+        AcquireSRWLockShared(&ShaderFilesLock);
+
+        for(CompiledShader* shader : file->Shaders)
+            AddUniqueShader(shadersToCompile, shader);
+
+        ReleaseSRWLockShared(&ShaderFilesLock);
     }
 
-    return shaderChanged;
+    for(const ShaderRetry& retry : ShaderRetries)
+    {
+        if(currTime >= retry.RetryTime)
+            AddUniqueShader(shadersToCompile, retry.Shader);
+    }
+
+    if(shadersToCompile.Count() == 0)
+        return false;
+
+    // Couldn't read some of the files (probably still being saved), so those get another go after the next debounce period
+    List<CompiledShader*> fileErrorShaders;
+    RecompileShaders(shadersToCompile, fileErrorShaders);
+    QueueFileErrorRetries(shadersToCompile, fileErrorShaders, currTime);
+
+    return true;
 }
 
 void ShutdownShaders()
 {
+    // Make sure that nothing is still compiling in the background
+    Tasks::WaitForAll();
+
+    for(auto& watch : DirectoryWatches)
+    {
+        StopDirectoryWatch(watch.second);
+        delete watch.second;
+    }
+    DirectoryWatches.clear();
+
     for(uint64 i = 0; i < ShaderFiles.Count(); ++i)
         delete ShaderFiles[i];
+    ShaderFiles.Shutdown();
+    ShaderFileMap.clear();
+    PendingShaderFiles.Shutdown();
+    ShaderRetries.Shutdown();
 
     for(uint64 i = 0; i < CompiledShaders.Count(); ++i)
         delete CompiledShaders[i];
+
+    IncludeFileCache.clear();
+}
+
+bool BenchmarkShaderCacheHits(const wchar* path, const char* functionName, ShaderType type,
+                              const CompileOptions& compileOpts, uint64 numIterations)
+{
+    Assert_(numIterations > 0);
+
+    // Make sure the shader is in the cache, so that every iteration below is a hit
+    wstring expectedCacheName;
+    {
+        List<wstring> filePaths;
+        Array<uint8> byteCode;
+        bool includesAppSettings = false;
+        CompileShader(path, functionName, type, compileOpts, filePaths, byteCode, includesAppSettings);
+
+        List<wstring> keyFilePaths;
+        CompileOptions opts;
+        expectedCacheName = PrepareShaderCompile(path, functionName, type, compileOpts, keyFilePaths, opts, includesAppSettings);
+    }
+
+    bool keysMatch = true;
+
+    // Cold memo: every file in the include tree is read and scanned again
+    double coldKeyMS = 0.0;
+    {
+        Timer timer;
+        for(uint64 i = 0; i < numIterations; ++i)
+        {
+            AcquireSRWLockExclusive(&IncludeFileCacheLock);
+            IncludeFileCache.clear();
+            ReleaseSRWLockExclusive(&IncludeFileCacheLock);
+
+            List<wstring> filePaths;
+            CompileOptions opts;
+            bool includesAppSettings = false;
+            keysMatch &= PrepareShaderCompile(path, functionName, type, compileOpts, filePaths, opts, includesAppSettings) == expectedCacheName;
+        }
+        timer.Update();
+        coldKeyMS = timer.ElapsedMillisecondsD();
+    }
+
+    // Warm memo: only the timestamps and sizes are queried
+    double warmKeyMS = 0.0;
+    {
+        Timer timer;
+        for(uint64 i = 0; i < numIterations; ++i)
+        {
+            List<wstring> filePaths;
+            CompileOptions opts;
+            bool includesAppSettings = false;
+            keysMatch &= PrepareShaderCompile(path, functionName, type, compileOpts, filePaths, opts, includesAppSettings) == expectedCacheName;
+        }
+        timer.Update();
+        warmKeyMS = timer.ElapsedMillisecondsD();
+    }
+
+    // A full cache hit, including loading the byte code from the cache file
+    double cacheHitMS = 0.0;
+    {
+        Timer timer;
+        for(uint64 i = 0; i < numIterations; ++i)
+        {
+            List<wstring> filePaths;
+            Array<uint8> byteCode;
+            bool includesAppSettings = false;
+            CompileShader(path, functionName, type, compileOpts, filePaths, byteCode, includesAppSettings);
+        }
+        timer.Update();
+        cacheHitMS = timer.ElapsedMillisecondsD();
+    }
+
+    // For comparison: reading every file in the tree into one string and hashing it along with the defines,
+    // which is what building the key from the expanded source costs even without splicing in the includes
+    double expandedKeyMS = 0.0;
+    {
+        List<wstring> treePaths;
+        Hash treeHash;
+        ResolveIncludeTree(path, treePaths, treeHash);
+
+        D3D_SHADER_MACRO defines[CompileOptions::MaxDefines + 1] = { };
+        compileOpts.MakeDefines(defines);
+        const string definesString = MakeDefinesString(defines);
+
+        Timer timer;
+        for(uint64 i = 0; i < numIterations; ++i)
+        {
+            string expandedSource;
+            for(const wstring& treePath : treePaths)
+                expandedSource += ReadFileAsString(treePath.c_str());
+            expandedSource += definesString;
+            GenerateHash(expandedSource.data(), expandedSource.length());
+        }
+        timer.Update();
+        expandedKeyMS = timer.ElapsedMillisecondsD();
+    }
+
+    const double toMicroseconds = 1000.0 / double(numIterations);
+    WriteLog("Shader cache hit benchmark (%ls %s, %llu iterations)", GetFileName(path).c_str(), functionName, numIterations);
+    WriteLog("    Key from cold include memo: %.2fus", coldKeyMS * toMicroseconds);
+    WriteLog("    Key from warm include memo: %.2fus", warmKeyMS * toMicroseconds);
+    WriteLog("    Full cache hit (key + cached byte code): %.2fus", cacheHitMS * toMicroseconds);
+    WriteLog("    Key from the concatenated source: %.2fus", expandedKeyMS * toMicroseconds);
+    if(keysMatch == false)
+        WriteLog("    Cache keys did not match between the cold and warm memo!");
+
+    return keysMatch;
+}
+
+// Deletes the cached byte code for every permutation, so that the next compile of each one goes through the compiler
+static void RemoveCachedPermutations(const wchar* path, const char* functionName, ShaderType type,
+                                     const CompileOptions* compileOpts, uint64 numCompileOpts)
+{
+    for(uint64 i = 0; i < numCompileOpts; ++i)
+    {
+        List<wstring> filePaths;
+        CompileOptions opts;
+        bool includesAppSettings = false;
+        const wstring cacheName = PrepareShaderCompile(path, functionName, type, compileOpts[i], filePaths, opts, includesAppSettings);
+        if(FileExists(cacheName.c_str()))
+            Win32Call(DeleteFile(cacheName.c_str()));
+    }
+}
+
+bool ValidateAsyncShaderCompiles(const wchar* path, const char* functionName, ShaderType type,
+                                 const CompileOptions* compileOpts, uint64 numCompileOpts)
+{
+    Assert_(compileOpts != nullptr && numCompileOpts > 0);
+
+    // Bulk: PrecompileFromFile() fills the cache, which CompileFromFile() then loads from
+    RemoveCachedPermutations(path, functionName, type, compileOpts, numCompileOpts);
+    Timer timer;
+    PrecompileFromFile(path, functionName, type, compileOpts, numCompileOpts);
+    timer.Update();
+    const double bulkMS = timer.DeltaMillisecondsD();
+
+    Array<Hash> bulkHashes(numCompileOpts);
+    for(uint64 i = 0; i < numCompileOpts; ++i)
+        bulkHashes[i] = CompileFromFile(path, functionName, type, compileOpts[i])->ByteCodeHash;
+
+    // Async: every permutation is in flight at the same time
+    RemoveCachedPermutations(path, functionName, type, compileOpts, numCompileOpts);
+    Array<ShaderCompileHandle> handles(numCompileOpts);
+    for(uint64 i = 0; i < numCompileOpts; ++i)
+        handles[i] = CompileFromFileAsync(path, functionName, type, compileOpts[i]);
+
+    Array<Hash> asyncHashes(numCompileOpts);
+    for(uint64 i = 0; i < numCompileOpts; ++i)
+        asyncHashes[i] = handles[i].Wait()->ByteCodeHash;
+    timer.Update();
+    const double asyncMS = timer.DeltaMillisecondsD();
+
+    // Reference: one at a time on this thread, which also leaves the cache filled in
+    RemoveCachedPermutations(path, functionName, type, compileOpts, numCompileOpts);
+    uint64 numMismatches = 0;
+    for(uint64 i = 0; i < numCompileOpts; ++i)
+    {
+        const Hash syncHash = CompileFromFile(path, functionName, type, compileOpts[i])->ByteCodeHash;
+        if((syncHash == bulkHashes[i]) == false || (syncHash == asyncHashes[i]) == false)
+        {
+            WriteLog("    Permutation %llu: async or bulk byte code doesn't match CompileFromFile", i);
+            numMismatches += 1;
+        }
+    }
+    timer.Update();
+    const double syncMS = timer.DeltaMillisecondsD();
+
+    WriteLog("Async shader compiles (%ls %s, %llu permutations): bulk %.2fms, async %.2fms, serial %.2fms, %llu mismatches",
+             GetFileName(path).c_str(), functionName, numCompileOpts, bulkMS, asyncMS, syncMS, numMismatches);
+
+    return numMismatches == 0;
+}
+
+const std::wstring& ShaderCacheDir()
+{
+    return cacheDir;
+}
+
+void EnsureShaderCacheDirExists()
+{
+    EnsureDirectoryExists(baseCacheDir);
+    EnsureDirectoryExists(cacheDir);
+}
+
+Hash ShaderCompilerHash()
+{
+    return CompilerHash;
+}
+
+// == ShaderCompileHandle =========================================================================
+
+ShaderCompileHandle::ShaderCompileHandle(ShaderCompileHandle&& other) : job(other.job)
+{
+    other.job = nullptr;
+}
+
+ShaderCompileHandle& ShaderCompileHandle::operator=(ShaderCompileHandle&& other)
+{
+    if(&other == this)
+        return *this;
+
+    Release();
+
+    job = other.job;
+    other.job = nullptr;
+
+    return *this;
+}
+
+ShaderCompileHandle::~ShaderCompileHandle()
+{
+    Release();
+}
+
+void ShaderCompileHandle::Release()
+{
+    if(job == nullptr)
+        return;
+
+    // Nobody is going to look at the result, so any error is dropped on the floor
+    std::wstring errorMessage;
+    FinishCompileJob(job, errorMessage);
+    job = nullptr;
+}
+
+bool ShaderCompileHandle::IsComplete() const
+{
+    Assert_(job != nullptr);
+    return Tasks::IsTaskSetComplete(job->TaskSet);
+}
+
+CompiledShaderPtr ShaderCompileHandle::Wait()
+{
+    Assert_(job != nullptr);
+
+    std::wstring errorMessage;
+    CompiledShader* shader = FinishCompileJob(job, errorMessage);
+    job = nullptr;
+
+    if(shader == nullptr)
+        throw Exception(errorMessage);
+
+    return shader;
 }
 
 // == CompileOptions ==============================================================================
@@ -124,11 +124,75 @@ private:
 
 typedef CompiledShaderPtr ShaderPtr;
 
+struct ShaderCompileJob;
+
+// Future-like handle for a shader that's being compiled asynchronously on the task scheduler.
+// Wait() blocks until the shader is ready, and re-throws any compilation error on the calling thread.
+class ShaderCompileHandle
+{
+public:
+
+    ShaderCompileHandle()
+    {
+    }
+
+    explicit ShaderCompileHandle(ShaderCompileJob* job_) : job(job_)
+    {
+    }
+
+    ShaderCompileHandle(ShaderCompileHandle&& other);
+    ShaderCompileHandle& operator=(ShaderCompileHandle&& other);
+    ~ShaderCompileHandle();
+
+    ShaderCompileHandle(const ShaderCompileHandle& other) = delete;
+    ShaderCompileHandle& operator=(const ShaderCompileHandle& other) = delete;
+
+    bool Valid() const
+    {
+        return job != nullptr;
+    }
+
+    bool IsComplete() const;
+    CompiledShaderPtr Wait();
+
+private:
+
+    void Release();
+
+    ShaderCompileJob* job = nullptr;
+};
+
 // Compiles a shader from file and loads the compiled shader binary
 CompiledShaderPtr CompileFromFile(const wchar* path, const char* functionName, ShaderType type,
                                   const CompileOptions& compileOpts = CompileOptions());
 
+// Same as CompileFromFile, except that the compile is kicked off on a worker thread
+ShaderCompileHandle CompileFromFileAsync(const wchar* path, const char* functionName, ShaderType type,
+                                         const CompileOptions& compileOpts = CompileOptions());
+
+// Compiles multiple permutations of a shader in parallel so that they end up in the shader cache,
+// which means that subsequent calls to CompileFromFile with those options will be cache hits
+void PrecompileFromFile(const wchar* path, const char* functionName, ShaderType type,
+                        const CompileOptions* compileOpts, uint64 numCompileOpts);
+
 bool UpdateShaders(bool updateAll);
 void ShutdownShaders();
 
+// Logs how long a shader cache hit takes with a cold and a warm include memo, against hashing the concatenated
+// source. Returns false if the cold and warm memo produced different cache keys.
+bool BenchmarkShaderCacheHits(const wchar* path, const char* functionName, ShaderType type,
+                              const CompileOptions& compileOpts = CompileOptions(), uint64 numIterations = 1000);
+
+// Compiles the permutations with PrecompileFromFile() and CompileFromFileAsync() after removing them from the cache,
+// and checks that both produce the same byte code as a CompileFromFile() that also starts from an empty cache.
+// Logs how long each took, and returns false if any permutation didn't match.
+bool ValidateAsyncShaderCompiles(const wchar* path, const char* functionName, ShaderType type,
+                                 const CompileOptions* compileOpts, uint64 numCompileOpts);
+
+// The directory that compiled shaders are cached in, which other caches built on top of compiled shaders
+// can share. Anything in there is invalid once the compiler hash changes.
+const std::wstring& ShaderCacheDir();
+void EnsureShaderCacheDirExists();
+Hash ShaderCompilerHash();
+
 }
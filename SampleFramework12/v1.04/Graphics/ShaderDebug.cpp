@@ -12,6 +12,7 @@
 #include "ShaderDebug.h"
 #include "GraphicsTypes.h"
 #include "DX12_Helpers.h"
+#include "BarrierTracker.h"
 #include "../App.h"
 #include "../Shaders\\ShaderDebug_Shared.h"
 
@@ -92,6 +93,7 @@ void Initialize()
         .CreateUAV = true,
         .Name = L"Shader Debug Print Buffer",
     });
+    DX12::CmdListBarriers.TrackBuffer(PrintBuffer.Resource(), ResourceStates::BufferUnorderedAccess);
 
     for(ReadbackBuffer& buffer : PrintReadbackBuffers)
         buffer.Initialize(PrintBuffer.InternalBuffer.Size);
@@ -100,6 +102,7 @@ void Initialize()
 void Shutdown()
 {
     DebugInfoBuffer.Shutdown();
+    DX12::CmdListBarriers.Untrack(PrintBuffer.Resource());
     PrintBuffer.Shutdown();
     for(ReadbackBuffer& buffer : PrintReadbackBuffers)
         buffer.Shutdown();
@@ -280,16 +283,22 @@ void BeginRender(ID3D12GraphicsCommandList7* cmdList, uint32 cursorX, uint32 cur
         readbackBuffer.Unmap();
     }
 
+    // The previous frame left the buffer as a copy source. The clear flushes this along with anything
+    // else that's pending (like the back buffer), and the second transition makes the shaders that
+    // print this frame wait for the clear.
+    Assert_(cmdList == DX12::CmdList);
+    DX12::CmdListBarriers.TransitionBuffer(PrintBuffer.Resource(), ResourceStates::BufferUnorderedAccess);
     DX12::ClearRawBuffer(cmdList, PrintBuffer, Uint4(0, 0, 0, 0));
-
-    DX12::Barrier(cmdList, PrintBuffer.InternalBuffer.WriteToWriteBarrier());
+    DX12::CmdListBarriers.TransitionBuffer(PrintBuffer.Resource(), ResourceStates::BufferUnorderedAccess);
 }
 
 void EndRender(ID3D12GraphicsCommandList7* cmdList)
 {
     PIXMarker marker(cmdList, "ShaderDebug - EndRender");
 
-    DX12::Barrier(cmdList, PrintBuffer.InternalBuffer.WriteToReadBarrier( { .SyncAfter = D3D12_BARRIER_SYNC_COPY, .AccessAfter = D3D12_BARRIER_ACCESS_COPY_SOURCE } ));
+    Assert_(cmdList == DX12::CmdList);
+    DX12::CmdListBarriers.TransitionBuffer(PrintBuffer.Resource(), ResourceStates::BufferCopySource);
+    DX12::FlushBarriers(cmdList);
 
     const ReadbackBuffer& readbackBuffer = PrintReadbackBuffers[DX12::CurrentCPUFrame % DX12::RenderLatency];
     cmdList->CopyResource(readbackBuffer.Resource, PrintBuffer.Resource());
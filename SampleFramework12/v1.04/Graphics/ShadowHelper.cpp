@@ -17,6 +17,9 @@
 #include <Graphics\\ShaderCompilation.h>
 #include <Graphics\\GraphicsTypes.h>
 #include <Graphics\\DX12_Helpers.h>
+#include <Graphics\\DX12_PipelineCache.h>
+#include <Graphics\\BarrierTracker.h>
+#include <Graphics\\PostProcessHelper.h>
 
 namespace SampleFramework12
 {
@@ -52,6 +55,10 @@ static ShadowMapMode currSMMode = ShadowMapMode::NumValues;
 static ShadowMSAAMode currMSAAMode = ShadowMSAAMode::NumValues;
 static bool initialized = false;
 
+// The conversion targets are readable when ConvertShadowMap() is called and when it returns, in
+// between this tracks the slice that's being written and the temporary target
+static BarrierTracker convertBarriers;
+
 struct ConvertConstants
 {
     Float2 ShadowMapSize;
@@ -125,6 +132,7 @@ void Shutdown()
 
     currSMMode = ShadowMapMode::NumValues;
     currMSAAMode = ShadowMSAAMode::NumValues;
+    convertBarriers.Shutdown();
     initialized = false;
 }
 
@@ -145,22 +153,22 @@ void CreatePSOs()
     psoDesc.NumRenderTargets = 1;
     psoDesc.RTVFormats[0] = SMFormat();
     psoDesc.SampleDesc.Count = 1;
-    DXCall(DX12::Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&smConvertPSO)));
+    DX12::CreateGraphicsPipelineState(psoDesc, &smConvertPSO);
 
     for(uint32 i = 0; i <= MaxFilterRadius; ++i)
     {
         psoDesc.PS = filterSMHorizontalPS[i].ByteCode();
-        DXCall(DX12::Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&filterSMHorizontalPSO[i])));
+        DX12::CreateGraphicsPipelineState(psoDesc, &filterSMHorizontalPSO[i]);
 
         psoDesc.PS = filterSMVerticalPS[i].ByteCode();
-        DXCall(DX12::Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&filterSMVerticalPSO[i])));
+        DX12::CreateGraphicsPipelineState(psoDesc, &filterSMVerticalPSO[i]);
     }
 
     psoDesc.PS = filter3x3PS.ByteCode();
-    DXCall(DX12::Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&filter3x3PSO)));
+    DX12::CreateGraphicsPipelineState(psoDesc, &filter3x3PSO);
 
     psoDesc.PS = filter5x5PS.ByteCode();
-    DXCall(DX12::Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&filter5x5PSO)));
+    DX12::CreateGraphicsPipelineState(psoDesc, &filter5x5PSO);
 
     D3D12_COMPUTE_PIPELINE_STATE_DESC psoDescCS = { };
     psoDescCS.pRootSignature = DX12::UniversalRootSignature;
@@ -168,7 +176,7 @@ void CreatePSOs()
     for(uint32 i = 0; i <= MaxFilterRadius; ++i)
     {
         psoDescCS.CS = smConvertAndFilterCS[i].ByteCode();
-        DXCall(DX12::Device->CreateComputePipelineState(&psoDescCS, IID_PPV_ARGS(&smConvertAndFilterPSO[i])));
+        DX12::CreateComputePipelineState(psoDescCS, &smConvertAndFilterPSO[i]);
     }
 }
 
@@ -244,6 +252,13 @@ void ConvertShadowMap(ID3D12GraphicsCommandList7* cmdList, const DepthBuffer& de
     constants.ArraySliceIdx = arraySlice;
     constants.OutputTextureIdx = smTarget.UAV;
 
+    // Anything the caller still has pending on the main command list needs to happen before the conversion
+    DX12::FlushBarriers(cmdList);
+
+    const TextureSubresources smSlice = { .StartArraySlice = arraySlice, .NumArraySlices = 1 };
+    convertBarriers.TrackTexture(smTarget.Texture, ResourceStates::ShaderResource);
+    convertBarriers.TrackTexture(tempTarget.Texture, ResourceStates::ShaderResource);
+
     if(useCSConversion)
     {
         uint32 sampleRadius = uint32((Max(filterSizeU, filterSizeV) / 2.0f) + 0.499f);
@@ -253,17 +268,16 @@ void ConvertShadowMap(ID3D12GraphicsCommandList7* cmdList, const DepthBuffer& de
 
         DX12::BindTempConstantBuffer(cmdList, constants, URS_ConstantBuffers + 0, CmdListMode::Compute);
 
-        DX12::Barrier(cmdList, smTarget.UAVWritableBarrier({ .Discard = true, .StartArraySlice = arraySlice, .NumArraySlices = 1 }));
+        convertBarriers.TransitionTexture(smTarget.Texture, ResourceStates::UnorderedAccess, smSlice, true);
+        convertBarriers.Flush(cmdList);
 
         const uint32 BaseThreadGroupWidth = 8;
         cmdList->Dispatch(DX12::DispatchSize(smTarget.Width(), BaseThreadGroupWidth), DX12::DispatchSize(smTarget.Height(), BaseThreadGroupWidth), 1);
-
-        DX12::Barrier(cmdList, smTarget.UAVToShaderReadableBarrier({ .StartArraySlice = arraySlice, .NumArraySlices = 1 }));
     }
     else if(use3x3Filter && ((sampleRadiusU == 1 && sampleRadiusV == 1) || (sampleRadiusU == 2 && sampleRadiusV == 2)))
     {
         // Do a conversion pass, then do 3x3 filtering in single pass
-        DX12::Barrier(cmdList, tempTarget.RTWritableBarrier({ .Discard = true }));
+        convertBarriers.TransitionTexture(tempTarget.Texture, ResourceStates::RenderTarget, TextureSubresources(), true);
 
         D3D12_CPU_DESCRIPTOR_HANDLE rtvHandles[1] = { tempTarget.RTV };
         cmdList->OMSetRenderTargets(1, rtvHandles, false, nullptr);
@@ -276,14 +290,11 @@ void ConvertShadowMap(ID3D12GraphicsCommandList7* cmdList, const DepthBuffer& de
 
         DX12::BindTempConstantBuffer(cmdList, constants, URS_ConstantBuffers + 0, CmdListMode::Graphics);
 
+        convertBarriers.Flush(cmdList);
         cmdList->DrawInstanced(3, 1, 0, 0);
 
-        {
-            BarrierBatchBuilder barrierBuilder;
-            barrierBuilder.Add(tempTarget.RTToShaderReadableBarrier());
-            barrierBuilder.Add(smTarget.RTWritableBarrier({ .Discard = true, .StartArraySlice = arraySlice, .NumArraySlices = 1 }));
-            DX12::Barrier(cmdList, barrierBuilder.Build());
-        }
+        convertBarriers.TransitionTexture(tempTarget.Texture, ResourceStates::ShaderResource);
+        convertBarriers.TransitionTexture(smTarget.Texture, ResourceStates::RenderTarget, smSlice, true);
 
         rtvHandles[0] = arraySlice == 0 ? smTarget.RTV : smTarget.ArrayRTVs[arraySlice];
         cmdList->OMSetRenderTargets(1, rtvHandles, false, nullptr);
@@ -293,9 +304,8 @@ void ConvertShadowMap(ID3D12GraphicsCommandList7* cmdList, const DepthBuffer& de
 
         cmdList->SetPipelineState(sampleRadiusU == 2 ? filter5x5PSO : filter3x3PSO);
 
+        convertBarriers.Flush(cmdList);
         cmdList->DrawInstanced(3, 1, 0, 0);
-
-        DX12::Barrier(cmdList, smTarget.RTToShaderReadableBarrier({ .StartArraySlice = arraySlice, .NumArraySlices = 1 }));
     }
     else
     {
@@ -312,18 +322,15 @@ void ConvertShadowMap(ID3D12GraphicsCommandList7* cmdList, const DepthBuffer& de
 
         DX12::BindTempConstantBuffer(cmdList, constants, URS_ConstantBuffers + 0, CmdListMode::Graphics);
 
-        DX12::Barrier(cmdList, smTarget.RTWritableBarrier({ .Discard = true, .StartArraySlice = arraySlice, .NumArraySlices = 1 }));
+        convertBarriers.TransitionTexture(smTarget.Texture, ResourceStates::RenderTarget, smSlice, true);
+        convertBarriers.Flush(cmdList);
 
         cmdList->DrawInstanced(3, 1, 0, 0);
 
         if(filterSizeU > 1.0f || filterSizeV > 1.0f)
         {
-            {
-                BarrierBatchBuilder barrierBuilder;
-                barrierBuilder.Add(smTarget.RTToShaderReadableBarrier({ .StartArraySlice = arraySlice, .NumArraySlices = 1 }));
-                barrierBuilder.Add(tempTarget.RTWritableBarrier({ .Discard = true }));
-                DX12::Barrier(cmdList, barrierBuilder.Build());
-            }
+            convertBarriers.TransitionTexture(smTarget.Texture, ResourceStates::ShaderResource, smSlice);
+            convertBarriers.TransitionTexture(tempTarget.Texture, ResourceStates::RenderTarget, TextureSubresources(), true);
 
             // Horizontal pass
             rtvHandles[0] = tempTarget.RTV;
@@ -334,14 +341,11 @@ void ConvertShadowMap(ID3D12GraphicsCommandList7* cmdList, const DepthBuffer& de
 
             cmdList->SetPipelineState(filterSMHorizontalPSO[sampleRadiusU]);
 
+            convertBarriers.Flush(cmdList);
             cmdList->DrawInstanced(3, 1, 0, 0);
 
-            {
-                BarrierBatchBuilder barrierBuilder;
-                barrierBuilder.Add(tempTarget.RTToShaderReadableBarrier());
-                barrierBuilder.Add(smTarget.RTWritableBarrier({ .Discard = true, .StartArraySlice = arraySlice, .NumArraySlices = 1 }));
-                DX12::Barrier(cmdList, barrierBuilder.Build());
-            }
+            convertBarriers.TransitionTexture(tempTarget.Texture, ResourceStates::ShaderResource);
+            convertBarriers.TransitionTexture(smTarget.Texture, ResourceStates::RenderTarget, smSlice, true);
 
             // Vertical pass
             rtvHandles[0] = smTargetRTV;
@@ -352,41 +356,64 @@ void ConvertShadowMap(ID3D12GraphicsCommandList7* cmdList, const DepthBuffer& de
 
             cmdList->SetPipelineState(filterSMVerticalPSO[sampleRadiusV]);
 
+            convertBarriers.Flush(cmdList);
             cmdList->DrawInstanced(3, 1, 0, 0);
-
-            {
-                BarrierBatchBuilder barrierBuilder;
-                barrierBuilder.Add(smTarget.RTToShaderReadableBarrier({ .StartArraySlice = arraySlice, .NumArraySlices = 1 }));
-                DX12::Barrier(cmdList, barrierBuilder.Build());
-            }
         }
     }
+
+    // Every path ends with both targets readable, including the unfiltered one
+    convertBarriers.TransitionTexture(smTarget.Texture, ResourceStates::ShaderResource, smSlice);
+    convertBarriers.TransitionTexture(tempTarget.Texture, ResourceStates::ShaderResource);
+    convertBarriers.Flush(cmdList);
+
+    convertBarriers.Untrack(smTarget.Resource());
+    convertBarriers.Untrack(tempTarget.Resource());
 }
 
-void PrepareCascades(const Float3& lightDir, uint64 shadowMapSize, bool stabilize, const Camera& camera,
-                     SunShadowConstantsBase& constants, OrthographicCamera* cascadeCameras)
+void ConvertShadowMap(ID3D12GraphicsCommandList7* cmdList, PostProcessHelper& postProcessHelper, const DepthBuffer& depthMap,
+                      RenderTexture& smTarget, uint32 arraySlice, float filterSizeU, float filterSizeV,
+                      bool32 linearizeDepth, float nearClip, float farClip, const Float4x4& projection,
+                      bool32 useCSConversion, bool32 use3x3Filter, float positiveExponent, float negativeExponent)
 {
-    const float MinDistance = 0.0f;
-    const float MaxDistance = 1.0f;
+    // Temporary targets are handed out as shader resources, which is the state that the conversion expects
+    TempRenderTarget* tempTarget = postProcessHelper.GetTempRenderTarget(smTarget.Width(), smTarget.Height(), smTarget.Texture.Format);
+
+    ConvertShadowMap(cmdList, depthMap, smTarget, arraySlice, tempTarget->RT, filterSizeU, filterSizeV, linearizeDepth,
+                     nearClip, farClip, projection, useCSConversion, use3x3Filter, positiveExponent, negativeExponent);
+
+    postProcessHelper.ReleaseTempRenderTarget(tempTarget);
+}
+
+void ComputeCascadeSlices(float nearClip, float farClip, bool orthographic, const CascadeDepthInfo& depthInfo,
+                          CascadeSlice* slices)
+{
+    Assert_(slices != nullptr);
+
+    float minDistance = Saturate(depthInfo.MinDepth);
+    float maxDistance = Saturate(depthInfo.MaxDepth);
+    if(maxDistance <= minDistance)
+    {
+        // Nothing useful came back from the reduction, so fall back to the whole frustum
+        minDistance = 0.0f;
+        maxDistance = 1.0f;
+    }
 
     // Compute the split distances based on the partitioning mode
-    float cascadeSplits[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float cascadeSplits[NumCascades] = { };
 
-    if(camera.IsOrthographic())
+    if(orthographic)
     {
         for(uint32 i = 0; i < NumCascades; ++i)
-            cascadeSplits[i] = Lerp(MinDistance, MaxDistance, (i + 1.0f) / NumCascades);
+            cascadeSplits[i] = Lerp(minDistance, maxDistance, (i + 1.0f) / NumCascades);
     }
     else
     {
-        float lambda = 0.5f;
+        float lambda = Saturate(depthInfo.SplitLambda);
 
-        float nearClip = camera.NearClip();
-        float farClip = camera.FarClip();
         float clipRange = farClip - nearClip;
 
-        float minZ = nearClip + MinDistance * clipRange;
-        float maxZ = nearClip + MaxDistance * clipRange;
+        float minZ = nearClip + minDistance * clipRange;
+        float maxZ = nearClip + maxDistance * clipRange;
 
         float range = maxZ - minZ;
         float ratio = maxZ / minZ;
@@ -401,49 +428,90 @@ void PrepareCascades(const Float3& lightDir, uint64 shadowMapSize, bool stabiliz
         }
     }
 
-    Float4x4 c0Matrix;
+    for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+    {
+        slices[cascadeIdx].NearDepth = cascadeIdx == 0 ? minDistance : cascadeSplits[cascadeIdx - 1];
+        slices[cascadeIdx].FarDepth = cascadeSplits[cascadeIdx];
+    }
 
-    // Prepare the projections ofr each cascade
+    if(depthInfo.Histogram == nullptr || depthInfo.NumHistogramBins == 0)
+        return;
+
+    // Shrink each slice down to the first and last bins inside of it that actually have samples. Slices
+    // without any samples are left alone, so that they still cover their part of the frustum.
+    const uint64 numBins = depthInfo.NumHistogramBins;
+    const float binSize = 1.0f / float(numBins);
     for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
     {
-        // Get the 8 points of the view frustum in world space
-        Float3 frustumCornersWS[8] =
+        CascadeSlice& slice = slices[cascadeIdx];
+        const uint64 startBin = Min(uint64(slice.NearDepth * float(numBins)), numBins - 1);
+        const uint64 endBin = Min(uint64(std::ceil(slice.FarDepth * float(numBins))), numBins);
+
+        uint64 firstBin = endBin;
+        uint64 lastBin = endBin;
+        for(uint64 binIdx = startBin; binIdx < endBin; ++binIdx)
         {
-            Float3(-1.0f,  1.0f, 0.0f),
-            Float3( 1.0f,  1.0f, 0.0f),
-            Float3( 1.0f, -1.0f, 0.0f),
-            Float3(-1.0f, -1.0f, 0.0f),
-            Float3(-1.0f,  1.0f, 1.0f),
-            Float3( 1.0f,  1.0f, 1.0f),
-            Float3( 1.0f, -1.0f, 1.0f),
-            Float3(-1.0f, -1.0f, 1.0f),
-        };
+            if(depthInfo.Histogram[binIdx] == 0)
+                continue;
 
-        float prevSplitDist = cascadeIdx == 0 ? MinDistance : cascadeSplits[cascadeIdx - 1];
-        float splitDist = cascadeSplits[cascadeIdx];
+            if(firstBin == endBin)
+                firstBin = binIdx;
+            lastBin = binIdx;
+        }
 
-        Float4x4 invViewProj = Float4x4::Invert(camera.ViewProjectionMatrix());
-        for(uint64 i = 0; i < 8; ++i)
-            frustumCornersWS[i] = Float3::Transform(frustumCornersWS[i], invViewProj);
+        if(firstBin == endBin)
+            continue;
+
+        slice.NearDepth = Max(slice.NearDepth, float(firstBin) * binSize);
+        slice.FarDepth = Min(slice.FarDepth, float(lastBin + 1) * binSize);
+    }
+}
+
+void ComputeCascadeBounds(const Float4x4& invViewProjection, const Float3& cameraRight, const Float3& lightDir,
+                          uint64 shadowMapSize, bool stabilize, const CascadeSlice* slices, CascadeBounds* bounds)
+{
+    Assert_(slices != nullptr);
+    Assert_(bounds != nullptr);
+
+    // Get the 8 points of the view frustum in world space, which all of the cascades share
+    Float3 frustumCornersWS[8] =
+    {
+        Float3(-1.0f,  1.0f, 0.0f),
+        Float3( 1.0f,  1.0f, 0.0f),
+        Float3( 1.0f, -1.0f, 0.0f),
+        Float3(-1.0f, -1.0f, 0.0f),
+        Float3(-1.0f,  1.0f, 1.0f),
+        Float3( 1.0f,  1.0f, 1.0f),
+        Float3( 1.0f, -1.0f, 1.0f),
+        Float3(-1.0f, -1.0f, 1.0f),
+    };
+
+    TransformPoints(frustumCornersWS, frustumCornersWS, 8, invViewProjection);
+
+    for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+    {
+        const float prevSplitDist = slices[cascadeIdx].NearDepth;
+        const float splitDist = slices[cascadeIdx].FarDepth;
 
         // Get the corners of the current cascade slice of the view frustum
+        Float3 sliceCornersWS[8];
         for(uint64 i = 0; i < 4; ++i)
         {
             Float3 cornerRay = frustumCornersWS[i + 4] - frustumCornersWS[i];
             Float3 nearCornerRay = cornerRay * prevSplitDist;
             Float3 farCornerRay = cornerRay * splitDist;
-            frustumCornersWS[i + 4] = frustumCornersWS[i] + farCornerRay;
-            frustumCornersWS[i] = frustumCornersWS[i] + nearCornerRay;
+            sliceCornersWS[i + 4] = frustumCornersWS[i] + farCornerRay;
+            sliceCornersWS[i] = frustumCornersWS[i] + nearCornerRay;
         }
 
         // Calculate the centroid of the view frustum slice
         Float3 frustumCenter = Float3(0.0f);
         for(uint64 i = 0; i < 8; ++i)
-            frustumCenter += frustumCornersWS[i];
+            frustumCenter += sliceCornersWS[i];
         frustumCenter *= (1.0f / 8.0f);
 
         // Pick the up vector to use for the light camera
-        Float3 upDir = camera.Right();
+        Float3 upDir = cameraRight;
 
         Float3 minExtents;
         Float3 maxExtents;
@@ -457,7 +525,7 @@ void PrepareCascades(const Float3& lightDir, uint64 shadowMapSize, bool stabiliz
             float sphereRadius = 0.0f;
             for(uint64 i = 0; i < 8; ++i)
             {
-                float dist = Float3::Length(Float3(frustumCornersWS[i]) - frustumCenter);
+                float dist = Float3::Length(sliceCornersWS[i] - frustumCenter);
                 sphereRadius = Max(sphereRadius, dist);
             }
 
@@ -468,23 +536,13 @@ void PrepareCascades(const Float3& lightDir, uint64 shadowMapSize, bool stabiliz
         }
         else
         {
-            // Create a temporary view matrix for the light
-            Float3 lightCameraPos = frustumCenter;
+            // Create a temporary view matrix for the light, and calculate an AABB around the frustum corners
             Float3 lookAt = frustumCenter - lightDir;
-            DirectX::XMMATRIX lightView = DirectX::XMMatrixLookAtLH(lightCameraPos.ToSIMD(), lookAt.ToSIMD(), upDir.ToSIMD());
+            Float4x4 lightView = Float4x4(DirectX::XMMatrixLookAtLH(frustumCenter.ToSIMD(), lookAt.ToSIMD(), upDir.ToSIMD()));
 
-            // Calculate an AABB around the frustum corners
-            DirectX::XMVECTOR mins = DirectX::XMVectorSet(FloatMax, FloatMax, FloatMax, FloatMax);
-            DirectX::XMVECTOR maxes = DirectX::XMVectorSet(-FloatMax, -FloatMax, -FloatMax, -FloatMax);
-            for(uint32 i = 0; i < 8; ++i)
-            {
-                DirectX::XMVECTOR corner = DirectX::XMVector3TransformCoord(frustumCornersWS[i].ToSIMD(), lightView);
-                mins = DirectX::XMVectorMin(mins, corner);
-                maxes = DirectX::XMVectorMax(maxes, corner);
-            }
-
-            minExtents = Float3(mins);
-            maxExtents = Float3(maxes);
+            Float3 sliceCornersLS[8];
+            TransformPoints(sliceCornersWS, sliceCornersLS, 8, lightView);
+            ComputeBounds(sliceCornersLS, 8, sizeof(Float3), minExtents, maxExtents);
         }
 
         // Adjust the min/max to accommodate the filtering size
@@ -494,6 +552,40 @@ void PrepareCascades(const Float3& lightDir, uint64 shadowMapSize, bool stabiliz
         maxExtents.x *= scale;
         maxExtents.y *= scale;
 
+        CascadeBounds& cascadeBounds = bounds[cascadeIdx];
+        cascadeBounds.Center = frustumCenter;
+        cascadeBounds.MinExtents = minExtents;
+        cascadeBounds.MaxExtents = maxExtents;
+        cascadeBounds.UpDir = upDir;
+    }
+}
+
+void PrepareCascades(const Float3& lightDir, uint64 shadowMapSize, bool stabilize, const Camera& camera,
+                     SunShadowConstantsBase& constants, OrthographicCamera* cascadeCameras,
+                     const CascadeDepthInfo* depthInfo)
+{
+    const CascadeDepthInfo defaultDepthInfo;
+    if(depthInfo == nullptr)
+        depthInfo = &defaultDepthInfo;
+
+    CascadeSlice slices[NumCascades];
+    ComputeCascadeSlices(camera.NearClip(), camera.FarClip(), camera.IsOrthographic(), *depthInfo, slices);
+
+    // The inverse is the same for every cascade, so only do it once
+    const Float4x4 invViewProj = Float4x4::Invert(camera.ViewProjectionMatrix());
+
+    CascadeBounds bounds[NumCascades];
+    ComputeCascadeBounds(invViewProj, camera.Right(), lightDir, shadowMapSize, stabilize, slices, bounds);
+
+    Float4x4 c0Matrix;
+
+    // Prepare the projections for each cascade
+    for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+    {
+        const Float3 frustumCenter = bounds[cascadeIdx].Center;
+        const Float3 minExtents = bounds[cascadeIdx].MinExtents;
+        const Float3 maxExtents = bounds[cascadeIdx].MaxExtents;
+
         Float3 cascadeExtents = maxExtents - minExtents;
 
         // Get position of the shadow camera
@@ -502,7 +594,7 @@ void PrepareCascades(const Float3& lightDir, uint64 shadowMapSize, bool stabiliz
         // Come up with a new orthographic camera for the shadow caster
         OrthographicCamera& shadowCamera = cascadeCameras[cascadeIdx];
         shadowCamera.Initialize(minExtents.x, minExtents.y, maxExtents.x, maxExtents.y, 0.0f, cascadeExtents.z);
-        shadowCamera.SetLookAt(shadowCameraPos, frustumCenter, upDir);
+        shadowCamera.SetLookAt(shadowCameraPos, frustumCenter, bounds[cascadeIdx].UpDir);
 
         if(stabilize)
         {
@@ -529,7 +621,7 @@ void PrepareCascades(const Float3& lightDir, uint64 shadowMapSize, bool stabiliz
 
         // Store the split distance in terms of view space depth
         const float clipDist = camera.FarClip() - camera.NearClip();
-        constants.CascadeSplits[cascadeIdx] = camera.NearClip() + splitDist * clipDist;
+        constants.CascadeSplits[cascadeIdx] = camera.NearClip() + slices[cascadeIdx].FarDepth * clipDist;
         constants.CascadeSizes[cascadeIdx] = Float4(maxExtents.x - minExtents.x, maxExtents.y - minExtents.y, cascadeExtents.z, 0.0f);
 
         if(cascadeIdx == 0)
@@ -559,6 +651,342 @@ void PrepareCascades(const Float3& lightDir, uint64 shadowMapSize, bool stabiliz
     }
 }
 
+// == Cascade fitting validation ==================================================================
+
+// The cascade fitting as it was before it was split into slices + bounds, which inverted the view-projection
+// for every cascade and only supported fixed partitioning of the full depth range
+static void ReferenceCascadeBounds(const Float4x4& viewProjection, bool orthographic, float nearClip, float farClip,
+                                   const Float3& cameraRight, const Float3& lightDir, uint64 shadowMapSize, bool stabilize,
+                                   float* cascadeSplits, CascadeBounds* bounds)
+{
+    const float MinDistance = 0.0f;
+    const float MaxDistance = 1.0f;
+
+    if(orthographic)
+    {
+        for(uint32 i = 0; i < NumCascades; ++i)
+            cascadeSplits[i] = Lerp(MinDistance, MaxDistance, (i + 1.0f) / NumCascades);
+    }
+    else
+    {
+        float lambda = 0.5f;
+
+        float clipRange = farClip - nearClip;
+
+        float minZ = nearClip + MinDistance * clipRange;
+        float maxZ = nearClip + MaxDistance * clipRange;
+
+        float range = maxZ - minZ;
+        float ratio = maxZ / minZ;
+
+        for(uint32 i = 0; i < NumCascades; ++i)
+        {
+            float p = (i + 1) / static_cast<float>(NumCascades);
+            float log = minZ * std::pow(ratio, p);
+            float uniform = minZ + range * p;
+            float d = lambda * (log - uniform) + uniform;
+            cascadeSplits[i] = (d - nearClip) / clipRange;
+        }
+    }
+
+    for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+    {
+        Float3 frustumCornersWS[8] =
+        {
+            Float3(-1.0f,  1.0f, 0.0f),
+            Float3( 1.0f,  1.0f, 0.0f),
+            Float3( 1.0f, -1.0f, 0.0f),
+            Float3(-1.0f, -1.0f, 0.0f),
+            Float3(-1.0f,  1.0f, 1.0f),
+            Float3( 1.0f,  1.0f, 1.0f),
+            Float3( 1.0f, -1.0f, 1.0f),
+            Float3(-1.0f, -1.0f, 1.0f),
+        };
+
+        float prevSplitDist = cascadeIdx == 0 ? MinDistance : cascadeSplits[cascadeIdx - 1];
+        float splitDist = cascadeSplits[cascadeIdx];
+
+        Float4x4 invViewProj = Float4x4::Invert(viewProjection);
+        for(uint64 i = 0; i < 8; ++i)
+            frustumCornersWS[i] = Float3::Transform(frustumCornersWS[i], invViewProj);
+
+        for(uint64 i = 0; i < 4; ++i)
+        {
+            Float3 cornerRay = frustumCornersWS[i + 4] - frustumCornersWS[i];
+            Float3 nearCornerRay = cornerRay * prevSplitDist;
+            Float3 farCornerRay = cornerRay * splitDist;
+            frustumCornersWS[i + 4] = frustumCornersWS[i] + farCornerRay;
+            frustumCornersWS[i] = frustumCornersWS[i] + nearCornerRay;
+        }
+
+        Float3 frustumCenter = Float3(0.0f);
+        for(uint64 i = 0; i < 8; ++i)
+            frustumCenter += frustumCornersWS[i];
+        frustumCenter *= (1.0f / 8.0f);
+
+        Float3 upDir = cameraRight;
+
+        Float3 minExtents;
+        Float3 maxExtents;
+
+        if(stabilize)
+        {
+            upDir = Float3(0.0f, 1.0f, 0.0f);
+
+            float sphereRadius = 0.0f;
+            for(uint64 i = 0; i < 8; ++i)
+            {
+                float dist = Float3::Length(Float3(frustumCornersWS[i]) - frustumCenter);
+                sphereRadius = Max(sphereRadius, dist);
+            }
+
+            sphereRadius = std::ceil(sphereRadius * 16.0f) / 16.0f;
+
+            maxExtents = Float3(sphereRadius, sphereRadius, sphereRadius);
+            minExtents = -maxExtents;
+        }
+        else
+        {
+            Float3 lightCameraPos = frustumCenter;
+            Float3 lookAt = frustumCenter - lightDir;
+            DirectX::XMMATRIX lightView = DirectX::XMMatrixLookAtLH(lightCameraPos.ToSIMD(), lookAt.ToSIMD(), upDir.ToSIMD());
+
+            DirectX::XMVECTOR mins = DirectX::XMVectorSet(FloatMax, FloatMax, FloatMax, FloatMax);
+            DirectX::XMVECTOR maxes = DirectX::XMVectorSet(-FloatMax, -FloatMax, -FloatMax, -FloatMax);
+            for(uint32 i = 0; i < 8; ++i)
+            {
+                DirectX::XMVECTOR corner = DirectX::XMVector3TransformCoord(frustumCornersWS[i].ToSIMD(), lightView);
+                mins = DirectX::XMVectorMin(mins, corner);
+                maxes = DirectX::XMVectorMax(maxes, corner);
+            }
+
+            minExtents = Float3(mins);
+            maxExtents = Float3(maxes);
+        }
+
+        float scale = (shadowMapSize + 7.0f) / shadowMapSize;
+        minExtents.x *= scale;
+        minExtents.y *= scale;
+        maxExtents.x *= scale;
+        maxExtents.y *= scale;
+
+        bounds[cascadeIdx].Center = frustumCenter;
+        bounds[cascadeIdx].MinExtents = minExtents;
+        bounds[cascadeIdx].MaxExtents = maxExtents;
+        bounds[cascadeIdx].UpDir = upDir;
+    }
+}
+
+static bool NearlyEqual(const Float3& a, const Float3& b, float tolerance)
+{
+    return std::abs(a.x - b.x) <= tolerance && std::abs(a.y - b.y) <= tolerance && std::abs(a.z - b.z) <= tolerance;
+}
+
+// Checks that a world-space point ends up inside of the shadow projection that gets built from the bounds
+static bool CascadeContainsPoint(const CascadeBounds& bounds, const Float3& lightDir, bool stabilize,
+                                 const Float3& pointWS, float tolerance)
+{
+    if(stabilize)
+        return Float3::Length(pointWS - bounds.Center) <= bounds.MaxExtents.x + tolerance;
+
+    Float3 lookAt = bounds.Center - lightDir;
+    Float4x4 lightView = Float4x4(DirectX::XMMatrixLookAtLH(bounds.Center.ToSIMD(), lookAt.ToSIMD(), bounds.UpDir.ToSIMD()));
+    Float3 pointLS = Float3::Transform(pointWS, lightView);
+    return pointLS.x >= bounds.MinExtents.x - tolerance && pointLS.x <= bounds.MaxExtents.x + tolerance &&
+           pointLS.y >= bounds.MinExtents.y - tolerance && pointLS.y <= bounds.MaxExtents.y + tolerance &&
+           pointLS.z >= bounds.MinExtents.z - tolerance && pointLS.z <= bounds.MaxExtents.z + tolerance;
+}
+
+// Counts random points inside of each slice of the view frustum that the cascade bounds don't contain
+static uint64 CountMissedSamples(const Float4x4& invViewProjection, const Float3& lightDir, bool stabilize,
+                                 const CascadeSlice* slices, const CascadeBounds* bounds, float tolerance, Random& rng)
+{
+    static const uint64 NumSamplesPerCascade = 64;
+
+    uint64 numMissed = 0;
+    for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+    {
+        for(uint64 sampleIdx = 0; sampleIdx < NumSamplesPerCascade; ++sampleIdx)
+        {
+            const float x = rng.RandomFloat() * 2.0f - 1.0f;
+            const float y = rng.RandomFloat() * 2.0f - 1.0f;
+            const float depth = Lerp(slices[cascadeIdx].NearDepth, slices[cascadeIdx].FarDepth, rng.RandomFloat());
+            const Float3 nearPoint = Float3::Transform(Float3(x, y, 0.0f), invViewProjection);
+            const Float3 farPoint = Float3::Transform(Float3(x, y, 1.0f), invViewProjection);
+            const Float3 pointWS = nearPoint + (farPoint - nearPoint) * depth;
+            if(CascadeContainsPoint(bounds[cascadeIdx], lightDir, stabilize, pointWS, tolerance) == false)
+                ++numMissed;
+        }
+    }
+
+    return numMissed;
+}
+
+bool ValidateCascadeFitting()
+{
+    static const uint64 NumConfigurations = 64;
+    static const uint64 NumHistogramBins = 64;
+    static const uint64 ShadowMapSize = 2048;
+
+    Random rng;
+    uint64 numReferenceMismatches = 0;
+    uint64 numBadSlices = 0;
+    uint64 numLooserCascades = 0;
+    uint64 numMissedSamples = 0;
+    uint64 numUncoveredBins = 0;
+    double reducedAreaRatio = 0.0;
+    double histogramLengthRatio = 0.0;
+
+    for(uint64 configIdx = 0; configIdx < NumConfigurations; ++configIdx)
+    {
+        // Make up a camera and a light that's not too close to straight up or down
+        const bool orthographic = configIdx % 4 == 3;
+        const bool stabilize = (configIdx / 4) % 2 == 0;
+        const float nearClip = Lerp(0.1f, 1.0f, rng.RandomFloat());
+        const float farClip = Lerp(50.0f, 500.0f, rng.RandomFloat());
+        const Float3 cameraPos = Float3(rng.RandomFloat(), rng.RandomFloat(), rng.RandomFloat()) * 100.0f - 50.0f;
+        const float yaw = rng.RandomFloat() * Pi2;
+        const float pitch = Lerp(-1.0f, 1.0f, rng.RandomFloat());
+        const Float3 forward = Float3(std::cos(pitch) * std::sin(yaw), std::sin(pitch), std::cos(pitch) * std::cos(yaw));
+        const Float3 cameraRight = Float3::Normalize(Float3::Cross(Float3(0.0f, 1.0f, 0.0f), forward));
+        const float lightAzimuth = rng.RandomFloat() * Pi2;
+        const float lightElevation = Lerp(0.2f, 1.2f, rng.RandomFloat());
+        const Float3 lightDir = Float3(std::cos(lightElevation) * std::cos(lightAzimuth), -std::sin(lightElevation),
+                                       std::cos(lightElevation) * std::sin(lightAzimuth));
+
+        const Float4x4 view = Float4x4(DirectX::XMMatrixLookAtLH(cameraPos.ToSIMD(), (cameraPos + forward).ToSIMD(),
+                                                                 Float3(0.0f, 1.0f, 0.0f).ToSIMD()));
+        Float4x4 projection;
+        if(orthographic)
+            projection = Float4x4(DirectX::XMMatrixOrthographicLH(Lerp(10.0f, 100.0f, rng.RandomFloat()),
+                                                                  Lerp(10.0f, 100.0f, rng.RandomFloat()), nearClip, farClip));
+        else
+            projection = Float4x4(DirectX::XMMatrixPerspectiveFovLH(Lerp(0.5f, 1.5f, rng.RandomFloat()),
+                                                                    Lerp(1.0f, 2.0f, rng.RandomFloat()), nearClip, farClip));
+        const Float4x4 viewProjection = view * projection;
+        const Float4x4 invViewProjection = Float4x4::Invert(viewProjection);
+        const float tolerance = farClip * 0.0001f;
+
+        // The default depth info needs to match the original fitting
+        float referenceSplits[NumCascades] = { };
+        CascadeBounds referenceBounds[NumCascades];
+        ReferenceCascadeBounds(viewProjection, orthographic, nearClip, farClip, cameraRight, lightDir, ShadowMapSize,
+                               stabilize, referenceSplits, referenceBounds);
+
+        CascadeSlice fullSlices[NumCascades];
+        CascadeBounds fullBounds[NumCascades];
+        ComputeCascadeSlices(nearClip, farClip, orthographic, CascadeDepthInfo(), fullSlices);
+        ComputeCascadeBounds(invViewProjection, cameraRight, lightDir, ShadowMapSize, stabilize, fullSlices, fullBounds);
+
+        for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+        {
+            // The rounding of the stabilized radius can go either way when the radius lands right on a 1/16 step
+            const float extentsTolerance = stabilize ? tolerance + 1.0f / 16.0f : tolerance;
+            const float prevSplit = cascadeIdx == 0 ? 0.0f : referenceSplits[cascadeIdx - 1];
+            if(std::abs(fullSlices[cascadeIdx].NearDepth - prevSplit) > 0.000001f ||
+               std::abs(fullSlices[cascadeIdx].FarDepth - referenceSplits[cascadeIdx]) > 0.000001f ||
+               NearlyEqual(fullBounds[cascadeIdx].Center, referenceBounds[cascadeIdx].Center, tolerance) == false ||
+               NearlyEqual(fullBounds[cascadeIdx].MinExtents, referenceBounds[cascadeIdx].MinExtents, extentsTolerance) == false ||
+               NearlyEqual(fullBounds[cascadeIdx].MaxExtents, referenceBounds[cascadeIdx].MaxExtents, extentsTolerance) == false)
+                ++numReferenceMismatches;
+        }
+
+        numMissedSamples += CountMissedSamples(invViewProjection, lightDir, stabilize, fullSlices, fullBounds, tolerance, rng);
+
+        // A reduced depth range starting at the near plane should pull every split in, and give a tighter first cascade
+        CascadeDepthInfo reducedInfo;
+        reducedInfo.MaxDepth = Lerp(0.05f, 0.6f, rng.RandomFloat());
+
+        CascadeSlice reducedSlices[NumCascades];
+        CascadeBounds reducedBounds[NumCascades];
+        ComputeCascadeSlices(nearClip, farClip, orthographic, reducedInfo, reducedSlices);
+        ComputeCascadeBounds(invViewProjection, cameraRight, lightDir, ShadowMapSize, stabilize, reducedSlices, reducedBounds);
+
+        for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+        {
+            const CascadeSlice& slice = reducedSlices[cascadeIdx];
+            if(slice.NearDepth < reducedInfo.MinDepth || slice.FarDepth > reducedInfo.MaxDepth + 0.000001f ||
+               slice.NearDepth > slice.FarDepth || slice.FarDepth > fullSlices[cascadeIdx].FarDepth ||
+               (cascadeIdx > 0 && slice.NearDepth != reducedSlices[cascadeIdx - 1].FarDepth))
+                ++numBadSlices;
+        }
+
+        const Float3 fullSize = fullBounds[0].MaxExtents - fullBounds[0].MinExtents;
+        const Float3 reducedSize = reducedBounds[0].MaxExtents - reducedBounds[0].MinExtents;
+        if(reducedSize.x > fullSize.x + tolerance || reducedSize.y > fullSize.y + tolerance)
+            ++numLooserCascades;
+        reducedAreaRatio += double(reducedSize.x * reducedSize.y) / double(fullSize.x * fullSize.y);
+
+        numMissedSamples += CountMissedSamples(invViewProjection, lightDir, stabilize, reducedSlices, reducedBounds, tolerance, rng);
+
+        // Samples clustered into a couple of depth ranges, which is what you get from a character in front of a wall
+        uint32 histogram[NumHistogramBins] = { };
+        for(uint64 clusterIdx = 0; clusterIdx < 2; ++clusterIdx)
+        {
+            const uint64 firstBin = rng.RandomUint() % (NumHistogramBins - 8);
+            const uint64 numBins = 1 + rng.RandomUint() % 8;
+            for(uint64 binIdx = firstBin; binIdx < firstBin + numBins; ++binIdx)
+                histogram[binIdx] += 1 + rng.RandomUint() % 100;
+        }
+
+        CascadeDepthInfo histogramInfo;
+        histogramInfo.Histogram = histogram;
+        histogramInfo.NumHistogramBins = NumHistogramBins;
+
+        CascadeSlice histogramSlices[NumCascades];
+        CascadeBounds histogramBounds[NumCascades];
+        ComputeCascadeSlices(nearClip, farClip, orthographic, histogramInfo, histogramSlices);
+        ComputeCascadeBounds(invViewProjection, cameraRight, lightDir, ShadowMapSize, stabilize, histogramSlices, histogramBounds);
+
+        float fullLength = 0.0f;
+        float histogramLength = 0.0f;
+        for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+        {
+            const CascadeSlice& slice = histogramSlices[cascadeIdx];
+            if(slice.NearDepth < fullSlices[cascadeIdx].NearDepth || slice.FarDepth > fullSlices[cascadeIdx].FarDepth ||
+               slice.NearDepth > slice.FarDepth)
+                ++numBadSlices;
+
+            fullLength += fullSlices[cascadeIdx].FarDepth - fullSlices[cascadeIdx].NearDepth;
+            histogramLength += slice.FarDepth - slice.NearDepth;
+        }
+        histogramLengthRatio += double(histogramLength) / double(fullLength);
+
+        // Every part of a bin with samples in it still needs to be covered by one of the trimmed slices
+        for(uint64 binIdx = 0; binIdx < NumHistogramBins; ++binIdx)
+        {
+            if(histogram[binIdx] == 0)
+                continue;
+
+            bool covered = true;
+            for(uint64 pointIdx = 0; pointIdx < 4; ++pointIdx)
+            {
+                const float depth = (float(binIdx) + (float(pointIdx) + 0.5f) / 4.0f) / float(NumHistogramBins);
+                bool pointCovered = false;
+                for(uint64 cascadeIdx = 0; cascadeIdx < NumCascades; ++cascadeIdx)
+                    pointCovered = pointCovered || (depth >= histogramSlices[cascadeIdx].NearDepth &&
+                                                    depth <= histogramSlices[cascadeIdx].FarDepth);
+                covered = covered && pointCovered;
+            }
+
+            if(covered == false)
+                ++numUncoveredBins;
+        }
+
+        numMissedSamples += CountMissedSamples(invViewProjection, lightDir, stabilize, histogramSlices, histogramBounds, tolerance, rng);
+    }
+
+    WriteLog("Cascade fitting: %llu configurations, %llu cascades didn't match the original fitting, %llu bad slices, "
+             "%llu looser cascades, %llu missed samples, %llu uncovered histogram bins",
+             NumConfigurations, numReferenceMismatches, numBadSlices, numLooserCascades, numMissedSamples, numUncoveredBins);
+    WriteLog("    Reduced depth range: first cascade covers %.1f%% of the area on average. Depth histogram: slices cover %.1f%% of the depth range on average",
+             reducedAreaRatio * 100.0 / double(NumConfigurations), histogramLengthRatio * 100.0 / double(NumConfigurations));
+
+    const bool passed = numReferenceMismatches == 0 && numBadSlices == 0 && numLooserCascades == 0 &&
+                        numMissedSamples == 0 && numUncoveredBins == 0;
+    return passed;
+}
+
 }
 
 }
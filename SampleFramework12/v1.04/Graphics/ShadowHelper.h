@@ -21,6 +21,7 @@ class PerspectiveCamera;
 struct ModelSpotLight;
 struct DepthBuffer;
 struct RenderTexture;
+class PostProcessHelper;
 
 const uint64 NumCascades = 4;
 const float MaxShadowFilterSize = 9.0f;
@@ -68,6 +69,38 @@ struct SunShadowConstantsMSM
     MSMConstants MSM;
 };
 
+// The range of depths that are actually visible, which is usually read back from a reduction of the depth buffer.
+// Depths are expressed as a fraction of the way from the camera's near clip plane to its far clip plane.
+struct CascadeDepthInfo
+{
+    float MinDepth = 0.0f;
+    float MaxDepth = 1.0f;
+
+    // Optional histogram of visible depths, with the bins evenly covering [0, 1]. Each cascade gets trimmed down
+    // to the bins that aren't empty.
+    const uint32* Histogram = nullptr;
+    uint64 NumHistogramBins = 0;
+
+    // Blends between uniform (0) and logarithmic (1) partitioning of perspective cameras
+    float SplitLambda = 0.5f;
+};
+
+// The part of the view frustum that a cascade covers, using the same units as CascadeDepthInfo
+struct CascadeSlice
+{
+    float NearDepth = 0.0f;
+    float FarDepth = 0.0f;
+};
+
+// Where a cascade's orthographic projection goes, relative to the center of its frustum slice in light space
+struct CascadeBounds
+{
+    Float3 Center;
+    Float3 MinExtents;
+    Float3 MaxExtents;
+    Float3 UpDir;
+};
+
 enum class ShadowMapMode : uint32
 {
     DepthMap,
@@ -105,9 +138,33 @@ void ConvertShadowMap(ID3D12GraphicsCommandList7* cmdList, const DepthBuffer& de
                       bool32 linearizeDepth, float nearClip, float farClip, const Float4x4& projection,
                       bool32 useCSConversion = false, bool32 use3x3Filter = true, float positiveExponent = 0.0f, float negativeExponent = 0.0f);
 
+// Same as above, except that the temporary target comes from the post-processing helper (which needs to be between
+// Begin() and End()) and goes back to it as soon as the conversion is done, so that it can share memory with other
+// temporary targets
+void ConvertShadowMap(ID3D12GraphicsCommandList7* cmdList, PostProcessHelper& postProcessHelper, const DepthBuffer& depthMap,
+                      RenderTexture& smTarget, uint32 arraySlice, float filterSizeU, float filterSizeV,
+                      bool32 linearizeDepth, float nearClip, float farClip, const Float4x4& projection,
+                      bool32 useCSConversion = false, bool32 use3x3Filter = true, float positiveExponent = 0.0f, float negativeExponent = 0.0f);
+
 extern Float4x4 ScaleOffsetMatrix;
+
+// Passing depth info fits the cascades to just the visible depth range, instead of the entire view frustum
 void PrepareCascades(const Float3& lightDir, uint64 shadowMapSize, bool stabilize, const Camera& camera,
-                     SunShadowConstantsBase& constants, OrthographicCamera* cascadeCameras);
+                     SunShadowConstantsBase& constants, OrthographicCamera* cascadeCameras,
+                     const CascadeDepthInfo* depthInfo = nullptr);
+
+// The CPU-side math used by PrepareCascades(), which doesn't touch any GPU resources. Both functions fill out
+// NumCascades elements. The default CascadeDepthInfo produces the same splits as the fixed partitioning that
+// gets used when PrepareCascades() isn't given any depth info.
+void ComputeCascadeSlices(float nearClip, float farClip, bool orthographic, const CascadeDepthInfo& depthInfo,
+                          CascadeSlice* slices);
+void ComputeCascadeBounds(const Float4x4& invViewProjection, const Float3& cameraRight, const Float3& lightDir,
+                          uint64 shadowMapSize, bool stabilize, const CascadeSlice* slices, CascadeBounds* bounds);
+
+// Checks the slices + bounds against the original per-cascade fitting code with the full depth range, and checks
+// that reduced depth ranges and histograms produce cascades that are both tighter and still cover every sample.
+// Logs the results, and returns false if anything failed.
+bool ValidateCascadeFitting();
 
 };
 
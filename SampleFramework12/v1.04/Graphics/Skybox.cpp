@@ -19,6 +19,10 @@
 #include "Spectrum.h"
 #include "Sampling.h"
 #include "DX12.h"
+#include "DX12_PipelineCache.h"
+#include "BarrierTracker.h"
+#include "../Tasks.h"
+#include "../Timer.h"
 
 namespace SampleFramework12
 {
@@ -45,6 +49,37 @@ static float IrradianceIntegral(float theta)
     return Pi * sinTheta * sinTheta;
 }
 
+struct SkySampleTaskArgs
+{
+    const SkyCache* Cache = nullptr;
+    const Float3* SampleDirs = nullptr;
+    Float3* Radiance = nullptr;
+    uint64 NumDirs = 0;
+};
+
+static const uint64 SkySampleChunkSize = 1024;
+
+static void SkySampleTask(uint32 start, uint32 end, uint32 threadNum, void* args_)
+{
+    const SkySampleTaskArgs& args = *reinterpret_cast<const SkySampleTaskArgs*>(args_);
+    const uint64 dirStart = start * SkySampleChunkSize;
+    const uint64 dirEnd = Min<uint64>(end * SkySampleChunkSize, args.NumDirs);
+    args.Cache->Sample(args.SampleDirs + dirStart, args.Radiance + dirStart, dirEnd - dirStart);
+}
+
+// Splits a batch evaluation across the task scheduler's threads
+static void SampleParallel(const SkyCache& cache, const Float3* sampleDirs, Float3* radiance, uint64 numDirs)
+{
+    SkySampleTaskArgs args;
+    args.Cache = &cache;
+    args.SampleDirs = sampleDirs;
+    args.Radiance = radiance;
+    args.NumDirs = numDirs;
+
+    const uint64 numChunks = (numDirs + SkySampleChunkSize - 1) / SkySampleChunkSize;
+    Tasks::ParallelFor(uint32(numChunks), 1, SkySampleTask, &args);
+}
+
 bool SkyCache::Init(const Float3& sunDirection_, float sunSize, const Float3& groundAlbedo_, float turbidity, bool createCubemap)
 {
     Float3 sunDirection = sunDirection_;
@@ -72,6 +107,14 @@ bool SkyCache::Init(const Float3& sunDirection_, float sunSize, const Float3& gr
     StateG = arhosek_rgb_skymodelstate_alloc_init(turbidity, groundAlbedo.y, elevation);
     StateB = arhosek_rgb_skymodelstate_alloc_init(turbidity, groundAlbedo.z, elevation);
 
+    const ArHosekSkyModelState* channelStates[3] = { StateR, StateG, StateB };
+    for(uint64 channel = 0; channel < 3; ++channel)
+    {
+        for(uint64 i = 0; i < ArraySize_(ChannelConfigs[channel]); ++i)
+            ChannelConfigs[channel][i] = float(channelStates[channel]->configs[channel][i]);
+        ChannelRadiances[channel] = float(channelStates[channel]->radiances[channel]);
+    }
+
     Albedo = groundAlbedo;
     Elevation = elevation;
     SunDirection = sunDirection;
@@ -82,14 +125,14 @@ bool SkyCache::Init(const Float3& sunDirection_, float sunSize, const Float3& gr
     // Note that the solar radiance function provided by the authors of this sky model only works using
     // spectral rendering, so we sample a range of wavelengths and then convert to RGB.
     SampledSpectrum groundAlbedoSpectrum = SampledSpectrum::FromRGB(Albedo, SpectrumType::Reflectance);
-    SampledSpectrum solarRadiance;
 
     // Init the Hosek solar radiance model for all wavelengths
     ArHosekSkyModelState* skyStates[NumSpectralSamples] = { };
     for(int32 i = 0; i < NumSpectralSamples; ++i)
         skyStates[i] = arhosekskymodelstate_alloc_init(thetaS, turbidity, groundAlbedoSpectrum[i]);
 
-    SunIrradiance = Float3(0.0f);
+    // The conversion to RGB is linear, so the spectral irradiance is accumulated and converted once at the end
+    SampledSpectrum sunSpectralIrradiance;
 
     // Uniformly sample the solid area of the solar disc.
     // Note that we use the *actual* sun size here and not the passed in the sun direction, so that
@@ -100,6 +143,9 @@ bool SkyCache::Init(const Float3& sunDirection_, float sunSize, const Float3& gr
     Float3x3 sunOrientation = Float3x3(sunDirX, sunDirY, sunDirection);
 
     const uint64 NumSamples = 8;
+    float sampleThetaS[NumSamples * NumSamples] = { };
+    float sampleGamma[NumSamples * NumSamples] = { };
+    float sampleCosine[NumSamples * NumSamples] = { };
     for(uint64 x = 0; x < NumSamples; ++x)
     {
         for(uint64 y = 0; y < NumSamples; ++y)
@@ -109,25 +155,31 @@ bool SkyCache::Init(const Float3& sunDirection_, float sunSize, const Float3& gr
             Float3 sampleDir = SampleDirectionCone(u1, u2, CosPhysicalSunSize);
             sampleDir = Float3::Transform(sampleDir, sunOrientation);
 
-            float sampleThetaS = AngleBetween(sampleDir, Float3(0, 1, 0));
-            float sampleGamma = AngleBetween(sampleDir, sunDirection);
-
-            for(int32 i = 0; i < NumSpectralSamples; ++i)
-            {
-                float wavelength = Lerp(float(SampledLambdaStart), float(SampledLambdaEnd), i / float(NumSpectralSamples));
-                solarRadiance[i] = float(arhosekskymodel_solar_radiance(skyStates[i], sampleThetaS, sampleGamma, wavelength));
-            }
+            const uint64 sampleIdx = x * NumSamples + y;
+            sampleThetaS[sampleIdx] = AngleBetween(sampleDir, Float3(0, 1, 0));
+            sampleGamma[sampleIdx] = AngleBetween(sampleDir, sunDirection);
+            sampleCosine[sampleIdx] = Saturate(Float3::Dot(sampleDir, sunDirection));
+        }
+    }
 
-            Float3 sampleRadiance = solarRadiance.ToRGB();
+    // Evaluate all of the sample directions at once for each wavelength
+    for(int32 i = 0; i < NumSpectralSamples; ++i)
+    {
+        float wavelength = Lerp(float(SampledLambdaStart), float(SampledLambdaEnd), i / float(NumSpectralSamples));
 
-            // Pre-scale by our FP16 scaling factor, so that we can use the irradiance value
-            // and have the resulting lighting still fit comfortably in an FP16 render target
-            sampleRadiance *= FP16Scale;
+        float solarRadiance[NumSamples * NumSamples] = { };
+        arhosekskymodel_solar_radiance_batch(skyStates[i], sampleThetaS, sampleGamma, int32(NumSamples * NumSamples), wavelength, solarRadiance);
 
-            SunIrradiance += sampleRadiance * Saturate(Float3::Dot(sampleDir, sunDirection));
-        }
+        float irradiance = 0.0f;
+        for(uint64 sampleIdx = 0; sampleIdx < NumSamples * NumSamples; ++sampleIdx)
+            irradiance += solarRadiance[sampleIdx] * sampleCosine[sampleIdx];
+        sunSpectralIrradiance[i] = irradiance;
     }
 
+    // Pre-scale by our FP16 scaling factor, so that we can use the irradiance value
+    // and have the resulting lighting still fit comfortably in an FP16 render target
+    SunIrradiance = sunSpectralIrradiance.ToRGB() * FP16Scale;
+
     // Apply the monte carlo factor of 1 / (PDF * N)
     float pdf = SampleDirectionCone_PDF(CosPhysicalSunSize);
     SunIrradiance *= (1.0f / NumSamples) * (1.0f / NumSamples) * (1.0f / pdf);
@@ -163,39 +215,28 @@ bool SkyCache::Init(const Float3& sunDirection_, float sunSize, const Float3& gr
         Array<Float3> sampleDirs(NumTexels);
         Array<Half4> texels(NumTexels);
 
-        // We'll also project the sky onto SH coefficients for use during rendering
-        SH = SH9Color();
-        float weightSum = 0.0f;
-
         for(uint32 s = 0; s < 6; ++s)
-        {
             for(uint32 y = 0; y < CubeMapRes; ++y)
-            {
                 for(uint32 x = 0; x < CubeMapRes; ++x)
-                {
-                    Float3 dir = MapXYSToDirection(x, y, s, CubeMapRes, CubeMapRes);
-                    Float3 radiance = Sample(dir);
-
-                    uint32 idx = (s * CubeMapRes * CubeMapRes) + (y * CubeMapRes) + x;
-                    samples[idx] = radiance;
-                    texels[idx] = Half4(Float4(radiance, 1.0f));
-                    sampleDirs[idx] = dir;
-
-                    float u = (x + 0.5f) / CubeMapRes;
-                    float v = (y + 0.5f) / CubeMapRes;
-
-                    // Account for cubemap texel distribution
-                    u = u * 2.0f - 1.0f;
-                    v = v * 2.0f - 1.0f;
-                    const float temp = 1.0f + u * u + v * v;
-                    const float weight = 4.0f / (std::sqrt(temp) * temp);
-
-                    SH += ProjectOntoSH9Color(dir, radiance) * weight;
-                    weightSum += weight;
-                }
-            }
+                    sampleDirs[(s * CubeMapRes * CubeMapRes) + (y * CubeMapRes) + x] = MapXYSToDirection(x, y, s, CubeMapRes, CubeMapRes);
+
+        SampleParallel(*this, sampleDirs.Data(), samples.Data(), NumTexels);
+
+        // We'll also project the sky onto SH coefficients for use during rendering
+        const uint32 texelsPerFace = CubeMapRes * CubeMapRes;
+        Array<float> faceWeights(texelsPerFace);
+        ComputeCubemapTexelWeights(CubeMapRes, CubeMapRes, faceWeights.Data());
+
+        Array<float> weights(NumTexels);
+        float weightSum = 0.0f;
+        for(uint32 idx = 0; idx < NumTexels; ++idx)
+        {
+            texels[idx] = Half4(Float4(samples[idx], 1.0f));
+            weights[idx] = faceWeights[idx % texelsPerFace];
+            weightSum += weights[idx];
         }
 
+        SH = ProjectOntoSH9Color(sampleDirs.Data(), samples.Data(), weights.Data(), NumTexels);
         SH *= (4.0f * 3.14159f) / weightSum;
 
         Create2DTexture(CubeMap, CubeMapRes, CubeMapRes, 1, 1, DXGI_FORMAT_R16G16B16A16_FLOAT, true, texels.Data());
@@ -253,8 +294,9 @@ Float3 SkyCache::Sample(Float3 sampleDir) const
 {
     Assert_(StateR != nullptr);
 
-    float gamma = AngleBetween(sampleDir, SunDirection);
-    float theta = AngleBetween(sampleDir, Float3(0, 1, 0));
+    // Same clamping as AngleBetween(), but with a double acos since a float one is off by up to ~1% near the horizon
+    const double gamma = std::acos(double(Clamp(Float3::Dot(sampleDir, SunDirection), 0.00001f, 1.0f)));
+    const double theta = std::acos(double(Clamp(sampleDir.y, 0.00001f, 1.0f)));
 
     Float3 radiance;
 
@@ -269,6 +311,257 @@ Float3 SkyCache::Sample(Float3 sampleDir) const
     return radiance * FP16Scale;
 }
 
+void SkyCache::Sample(const Float3* sampleDirs, Float3* radiance, uint64 numDirs) const
+{
+    using namespace DirectX;
+
+    Assert_(StateR != nullptr);
+
+    const XMVECTOR sunX = XMVectorReplicate(SunDirection.x);
+    const XMVECTOR sunY = XMVectorReplicate(SunDirection.y);
+    const XMVECTOR sunZ = XMVectorReplicate(SunDirection.z);
+    const XMVECTOR minCos = XMVectorReplicate(0.00001f);
+    const XMVECTOR one = XMVectorSplatOne();
+
+    uint64 dirIdx = 0;
+    for(; dirIdx + 4 <= numDirs; dirIdx += 4)
+    {
+        // Transpose to SoA so that each lane is a separate direction
+        XMMATRIX dirs;
+        dirs.r[0] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&sampleDirs[dirIdx + 0]));
+        dirs.r[1] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&sampleDirs[dirIdx + 1]));
+        dirs.r[2] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&sampleDirs[dirIdx + 2]));
+        dirs.r[3] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&sampleDirs[dirIdx + 3]));
+        dirs = XMMatrixTranspose(dirs);
+
+        // Same clamping as AngleBetween(), but we use the cosines directly instead of going through acos + cos
+        XMVECTOR cosGamma = XMVectorMultiply(dirs.r[0], sunX);
+        cosGamma = XMVectorMultiplyAdd(dirs.r[1], sunY, cosGamma);
+        cosGamma = XMVectorMultiplyAdd(dirs.r[2], sunZ, cosGamma);
+        cosGamma = XMVectorClamp(cosGamma, minCos, one);
+        const XMVECTOR gamma = XMVectorACos(cosGamma);
+        const XMVECTOR cosTheta = XMVectorClamp(dirs.r[1], minCos, one);
+
+        const XMVECTOR rayM = XMVectorMultiply(cosGamma, cosGamma);
+        const XMVECTOR zenith = XMVectorSqrt(cosTheta);
+        const XMVECTOR thetaTerm = XMVectorReciprocal(XMVectorAdd(cosTheta, XMVectorReplicate(0.01f)));
+
+        XMVECTOR channels[3];
+        for(uint64 channel = 0; channel < 3; ++channel)
+        {
+            const float* config = ChannelConfigs[channel];
+
+            // Same as ArHosekSkyModel_GetRadianceInternal()
+            const XMVECTOR expM = XMVectorExpE(XMVectorMultiply(XMVectorReplicate(config[4]), gamma));
+            const XMVECTOR mieBase = XMVectorSubtract(XMVectorReplicate(1.0f + config[8] * config[8]),
+                                                      XMVectorMultiply(XMVectorReplicate(2.0f * config[8]), cosGamma));
+            const XMVECTOR mieM = XMVectorDivide(XMVectorAdd(one, rayM), XMVectorMultiply(mieBase, XMVectorSqrt(mieBase)));
+
+            XMVECTOR result = XMVectorReplicate(config[2]);
+            result = XMVectorMultiplyAdd(XMVectorReplicate(config[3]), expM, result);
+            result = XMVectorMultiplyAdd(XMVectorReplicate(config[5]), rayM, result);
+            result = XMVectorMultiplyAdd(XMVectorReplicate(config[6]), mieM, result);
+            result = XMVectorMultiplyAdd(XMVectorReplicate(config[7]), zenith, result);
+
+            const XMVECTOR zenithExp = XMVectorExpE(XMVectorMultiply(XMVectorReplicate(config[1]), thetaTerm));
+            result = XMVectorMultiply(result, XMVectorMultiplyAdd(XMVectorReplicate(config[0]), zenithExp, one));
+
+            // Multiply by standard luminous efficacy of 683 lm/W and our FP16 scale, same as Sample()
+            channels[channel] = XMVectorMultiply(result, XMVectorReplicate(ChannelRadiances[channel] * 683.0f * FP16Scale));
+        }
+
+        XMMATRIX rgb = XMMatrixTranspose(XMMATRIX(channels[0], channels[1], channels[2], XMVectorZero()));
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&radiance[dirIdx + 0]), rgb.r[0]);
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&radiance[dirIdx + 1]), rgb.r[1]);
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&radiance[dirIdx + 2]), rgb.r[2]);
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&radiance[dirIdx + 3]), rgb.r[3]);
+    }
+
+    for(; dirIdx < numDirs; ++dirIdx)
+        radiance[dirIdx] = Sample(sampleDirs[dirIdx]);
+}
+
+void SkyCache::BenchmarkCubemapGeneration(uint32 cubeMapRes) const
+{
+    Assert_(Initialized());
+
+    const uint64 numTexels = uint64(cubeMapRes) * cubeMapRes * 6;
+    Array<Float3> sampleDirs(numTexels);
+    for(uint32 s = 0; s < 6; ++s)
+        for(uint32 y = 0; y < cubeMapRes; ++y)
+            for(uint32 x = 0; x < cubeMapRes; ++x)
+                sampleDirs[(s * cubeMapRes * cubeMapRes) + (y * cubeMapRes) + x] = MapXYSToDirection(x, y, s, cubeMapRes, cubeMapRes);
+
+    Array<Float3> reference(numTexels);
+    Array<Float3> batch(numTexels);
+    Array<Float3> parallel(numTexels);
+
+    Timer referenceTimer;
+    for(uint64 i = 0; i < numTexels; ++i)
+        reference[i] = Sample(sampleDirs[i]);
+    referenceTimer.Update();
+
+    Timer batchTimer;
+    Sample(sampleDirs.Data(), batch.Data(), numTexels);
+    batchTimer.Update();
+
+    Timer parallelTimer;
+    SampleParallel(*this, sampleDirs.Data(), parallel.Data(), numTexels);
+    parallelTimer.Update();
+
+    float maxRelativeError = 0.0f;
+    for(uint64 i = 0; i < numTexels; ++i)
+    {
+        const Float3 ref = reference[i];
+        const float scale = Max(Max(std::abs(ref.x), std::abs(ref.y)), Max(std::abs(ref.z), 1e-6f));
+        const Float3 diff = batch[i] - ref;
+        maxRelativeError = Max(maxRelativeError, Max(Max(std::abs(diff.x), std::abs(diff.y)), std::abs(diff.z)) / scale);
+    }
+
+    WriteLog("Sky cubemap generation (%ux%u): reference %.2fms, SIMD %.2fms, SIMD + %u threads %.2fms, max relative error %e",
+             cubeMapRes, cubeMapRes, referenceTimer.ElapsedMillisecondsD(), batchTimer.ElapsedMillisecondsD(),
+             Tasks::NumThreads(), parallelTimer.ElapsedMillisecondsD(), maxRelativeError);
+}
+
+// Scalar float copy of the batch Sample() math. Comparing both this and the SIMD path against Sample()
+// separates the error from float precision from the error of the DirectXMath approximations.
+static Float3 SampleFloat(const SkyCache& cache, const Float3& sampleDir)
+{
+    const float cosGamma = Clamp(Float3::Dot(sampleDir, cache.SunDirection), 0.00001f, 1.0f);
+    const float cosTheta = Clamp(sampleDir.y, 0.00001f, 1.0f);
+    const float gamma = std::acos(cosGamma);
+    const float rayM = cosGamma * cosGamma;
+    const float zenith = std::sqrt(cosTheta);
+    const float thetaTerm = 1.0f / (cosTheta + 0.01f);
+
+    float channels[3] = { };
+    for(uint64 channel = 0; channel < 3; ++channel)
+    {
+        const float* config = cache.ChannelConfigs[channel];
+        const float expM = std::exp(config[4] * gamma);
+        const float mieBase = (1.0f + config[8] * config[8]) - (2.0f * config[8]) * cosGamma;
+        const float mieM = (1.0f + rayM) / (mieBase * std::sqrt(mieBase));
+
+        float result = config[2] + config[3] * expM + config[5] * rayM + config[6] * mieM + config[7] * zenith;
+        result *= config[0] * std::exp(config[1] * thetaTerm) + 1.0f;
+        channels[channel] = result * cache.ChannelRadiances[channel] * 683.0f * FP16Scale;
+    }
+
+    return Float3(channels[0], channels[1], channels[2]);
+}
+
+// Error relative to the largest channel of the reference
+static float RelativeError(const Float3& value, const Float3& reference)
+{
+    const float scale = Max(Max(std::abs(reference.x), std::abs(reference.y)), Max(std::abs(reference.z), 1e-6f));
+    const Float3 diff = value - reference;
+    return Max(Max(std::abs(diff.x), std::abs(diff.y)), std::abs(diff.z)) / scale;
+}
+
+bool ValidateSkyModelBatch()
+{
+    struct SkyConfig
+    {
+        Float3 SunDirection;
+        float Turbidity = 0.0f;
+        Float3 Albedo;
+    };
+
+    // Sun from the horizon up to the zenith, over the turbidity range that the model was fitted to
+    const SkyConfig configs[] =
+    {
+        { Float3(1.0f, 0.0f, 0.3f), 2.0f, Float3(0.5f) },
+        { Float3(0.5f, 0.05f, 0.5f), 8.0f, Float3(0.1f, 0.2f, 0.3f) },
+        { Float3(0.3f, 0.5f, 0.2f), 4.0f, Float3(0.3f, 0.2f, 0.1f) },
+        { Float3(-0.2f, 0.7f, 0.4f), 10.0f, Float3(1.0f) },
+        { Float3(0.0f, 1.0f, 0.0f), 1.0f, Float3(0.0f) },
+    };
+
+    const uint64 NumPhi = 400;
+    const uint64 NumTheta = 200;
+    const uint64 numDirs = NumPhi * NumTheta;
+    Array<Float3> sampleDirs(numDirs);
+    for(uint64 t = 0; t < NumTheta; ++t)
+    {
+        for(uint64 p = 0; p < NumPhi; ++p)
+        {
+            const float phi = ((p + 0.5f) / NumPhi) * Pi2;
+            const float cosTheta = ((t + 0.5f) / NumTheta) * 2.0f - 1.0f;
+            const float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+            sampleDirs[t * NumPhi + p] = Float3(std::cos(phi) * sinTheta, cosTheta, std::sin(phi) * sinTheta);
+        }
+    }
+
+    Array<Float3> batch(numDirs);
+
+    // Directions and wavelengths for the solar radiance, covering the solar disc plus a bit of the sky around it
+    const uint64 NumSunSamples = 16;
+    const int32 numSunDirs = int32(NumSunSamples * NumSunSamples);
+    float sunThetas[NumSunSamples * NumSunSamples] = { };
+    float sunGammas[NumSunSamples * NumSunSamples] = { };
+    float sunBatch[NumSunSamples * NumSunSamples] = { };
+    const float cosSunCone = std::cos(PhysicalSunSize * 1.5f);
+    const double wavelengths[] = { 320.0, 333.0, 400.0, 455.5, 560.0, 617.0, 680.0, 719.0, 720.0 };
+
+    const float MaxFloatError = 1e-4f;
+    const float MaxSIMDError = 2e-4f;
+    const float MaxSolarError = 1e-4f;
+
+    float maxFloatError = 0.0f;
+    float maxSIMDError = 0.0f;
+    float maxSolarError = 0.0f;
+
+    for(const SkyConfig& config : configs)
+    {
+        SkyCache cache;
+        cache.Init(config.SunDirection, 1.0f, config.Albedo, config.Turbidity, false);
+
+        cache.Sample(sampleDirs.Data(), batch.Data(), numDirs);
+        for(uint64 i = 0; i < numDirs; ++i)
+        {
+            const Float3 reference = cache.Sample(sampleDirs[i]);
+            maxFloatError = Max(maxFloatError, RelativeError(SampleFloat(cache, sampleDirs[i]), reference));
+            maxSIMDError = Max(maxSIMDError, RelativeError(batch[i], reference));
+        }
+
+        const Float3 sunDirX = Float3::Perpendicular(cache.SunDirection);
+        const Float3 sunDirY = Float3::Cross(cache.SunDirection, sunDirX);
+        const Float3x3 sunOrientation = Float3x3(sunDirX, sunDirY, cache.SunDirection);
+        for(uint64 x = 0; x < NumSunSamples; ++x)
+        {
+            for(uint64 y = 0; y < NumSunSamples; ++y)
+            {
+                Float3 sampleDir = SampleDirectionCone((x + 0.5f) / NumSunSamples, (y + 0.5f) / NumSunSamples, cosSunCone);
+                sampleDir = Float3::Transform(sampleDir, sunOrientation);
+                sunThetas[x * NumSunSamples + y] = AngleBetween(sampleDir, Float3(0, 1, 0));
+                sunGammas[x * NumSunSamples + y] = AngleBetween(sampleDir, cache.SunDirection);
+            }
+        }
+
+        for(double wavelength : wavelengths)
+        {
+            ArHosekSkyModelState* state = arhosekskymodelstate_alloc_init(Pi_2 - cache.Elevation, config.Turbidity, config.Albedo.x);
+            arhosekskymodel_solar_radiance_batch(state, sunThetas, sunGammas, numSunDirs, wavelength, sunBatch);
+
+            for(int32 i = 0; i < numSunDirs; ++i)
+            {
+                const double reference = arhosekskymodel_solar_radiance(state, sunThetas[i], sunGammas[i], wavelength);
+                const double error = std::abs(sunBatch[i] - reference) / Max(std::abs(reference), 1e-6);
+                maxSolarError = Max(maxSolarError, float(error));
+            }
+
+            arhosekskymodelstate_free(state);
+        }
+
+        cache.Shutdown();
+    }
+
+    WriteLog("Sky model batch evaluation: scalar float max relative error %e, SIMD %e, solar radiance %e",
+             maxFloatError, maxSIMDError, maxSolarError);
+
+    return maxFloatError <= MaxFloatError && maxSIMDError <= MaxSIMDError && maxSolarError <= MaxSolarError;
+}
+
 #endif // EnableSkyModel_
 
 // == Skybox ======================================================================================
@@ -366,7 +659,7 @@ void Skybox::CreatePSOs(DXGI_FORMAT rtFormat, DXGI_FORMAT depthFormat, uint32 nu
     psoDesc.SampleDesc.Quality = numMSAASamples > 1 ? DX12::StandardMSAAPattern : 0;
     psoDesc.InputLayout.pInputElementDescs = inputElements;
     psoDesc.InputLayout.NumElements = ArraySize_(inputElements);
-    DXCall(DX12::Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineState)));
+    DX12::CreateGraphicsPipelineState(psoDesc, &pipelineState);
 }
 
 void Skybox::DestroyPSOs()
@@ -399,6 +692,7 @@ void Skybox::RenderCommon(ID3D12GraphicsCommandList* cmdList, const Texture* env
     cmdList->IASetIndexBuffer(&ibView);
 
     // Draw
+    DX12::FlushBarriers(cmdList);
     cmdList->DrawIndexedInstanced(NumIndices, 1, 0, 0, 0);
 }
 
@@ -51,8 +51,22 @@ struct SkyCache
     bool Initialized() const { return StateR != nullptr; }
 
     Float3 Sample(Float3 sampleDir) const;
+
+    // Evaluates all 3 channels for 4 directions at a time using float SIMD. This has a small amount of
+    // error compared to the version above (~1e-4 relative, see ValidateSkyModelBatch()).
+    void Sample(const Float3* sampleDirs, Float3* radiance, uint64 numDirs) const;
+
+    // Generates the sky cubemap texels with the scalar and batch paths, and logs the timings and error
+    void BenchmarkCubemapGeneration(uint32 cubeMapRes = 128) const;
+
+    // Float copies of the model parameters for each channel, used for batch evaluation
+    float ChannelConfigs[3][9] = { };
+    float ChannelRadiances[3] = { };
 };
 
+// Checks the batch sky radiance against SkyCache::Sample(), and the batch solar radiance against the scalar version
+bool ValidateSkyModelBatch();
+
 #endif // EnableSkyModel_
 
 class Skybox
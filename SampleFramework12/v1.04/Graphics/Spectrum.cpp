@@ -33,6 +33,9 @@
 #include "PCH.h"
 
 #include "Spectrum.h"
+#include "..\\Containers.h"
+#include "..\\Timer.h"
+#include "..\\Utility.h"
 
 namespace SampleFramework12
 {
@@ -191,6 +194,142 @@ SampledSpectrum::SampledSpectrum(const RGBSpectrum &r, SpectrumType t) {
     *this = SampledSpectrum::FromRGB(rgb, t);
 }
 
+void SampledSpectrum::ToRGB(const SampledSpectrum *spectra, Float3 *rgb,
+                            uint64 numSpectra) {
+    using namespace DirectX;
+
+    uint64 spectrumIdx = 0;
+    for (; spectrumIdx + 4 <= numSpectra; spectrumIdx += 4) {
+        // Accumulate 4 partial sums per channel for each spectrum, and then
+        // transpose so that the horizontal adds are shared by all 4 spectra
+        XMMATRIX sums[3];
+        for (int s = 0; s < 4; ++s) {
+            const SampledSpectrum &spectrum = spectra[spectrumIdx + s];
+            XMVECTOR r = XMVectorZero();
+            XMVECTOR g = XMVectorZero();
+            XMVECTOR b = XMVectorZero();
+            for (int i = 0; i < nVectors; ++i) {
+                const XMVECTOR v = spectrum.LoadVector(i);
+                r = XMVectorMultiplyAdd(v, rgbMatchR.LoadVector(i), r);
+                g = XMVectorMultiplyAdd(v, rgbMatchG.LoadVector(i), g);
+                b = XMVectorMultiplyAdd(v, rgbMatchB.LoadVector(i), b);
+            }
+            sums[0].r[s] = r;
+            sums[1].r[s] = g;
+            sums[2].r[s] = b;
+        }
+
+        XMFLOAT4 channels[3];
+        for (int channel = 0; channel < 3; ++channel) {
+            const XMMATRIX t = XMMatrixTranspose(sums[channel]);
+            XMStoreFloat4(&channels[channel], XMVectorAdd(XMVectorAdd(t.r[0], t.r[1]), XMVectorAdd(t.r[2], t.r[3])));
+        }
+
+        rgb[spectrumIdx + 0] = Float3(channels[0].x, channels[1].x, channels[2].x);
+        rgb[spectrumIdx + 1] = Float3(channels[0].y, channels[1].y, channels[2].y);
+        rgb[spectrumIdx + 2] = Float3(channels[0].z, channels[1].z, channels[2].z);
+        rgb[spectrumIdx + 3] = Float3(channels[0].w, channels[1].w, channels[2].w);
+    }
+
+    for (; spectrumIdx < numSpectra; ++spectrumIdx)
+        rgb[spectrumIdx] = spectra[spectrumIdx].ToRGB();
+}
+
+void SampledSpectrum::BenchmarkConversion(uint64 numSpectra) {
+    // The scalar conversion that recomputes everything per call, for comparison
+    auto referenceToRGB = [](const SampledSpectrum &s) {
+        float xyz[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < NumSpectralSamples; ++i) {
+            xyz[0] += X.c[i] * s.c[i];
+            xyz[1] += Y.c[i] * s.c[i];
+            xyz[2] += Z.c[i] * s.c[i];
+        }
+        float scale = float(SampledLambdaEnd - SampledLambdaStart) /
+                      float(CIE_Y_integral * NumSpectralSamples);
+        xyz[0] *= scale;
+        xyz[1] *= scale;
+        xyz[2] *= scale;
+        float rgb[3];
+        XYZToRGB(xyz, rgb);
+        return Float3(rgb[0], rgb[1], rgb[2]);
+    };
+
+    float lambda[NumSpectralSamples];
+    for (int i = 0; i < NumSpectralSamples; ++i)
+        lambda[i] = SpectrumLerp((i + 0.5f) / NumSpectralSamples, float(SampledLambdaStart),
+                                 float(SampledLambdaEnd));
+
+    // Blackbody spectra over a range of temperatures
+    Array<SampledSpectrum> spectra(numSpectra);
+    for (uint64 i = 0; i < numSpectra; ++i) {
+        float temperature = 2000.0f + 8000.0f * float(i) / float(numSpectra);
+        float values[NumSpectralSamples];
+        BlackbodyNormalized(lambda, NumSpectralSamples, temperature, values);
+        for (int j = 0; j < NumSpectralSamples; ++j) spectra[i][j] = values[j];
+    }
+
+    Array<Float3> referenceRGB(numSpectra);
+    Array<Float3> singleRGB(numSpectra);
+    Array<Float3> batchRGB(numSpectra);
+
+    Timer referenceTimer;
+    for (uint64 i = 0; i < numSpectra; ++i) referenceRGB[i] = referenceToRGB(spectra[i]);
+    referenceTimer.Update();
+
+    Timer singleTimer;
+    for (uint64 i = 0; i < numSpectra; ++i) singleRGB[i] = spectra[i].ToRGB();
+    singleTimer.Update();
+
+    Timer batchTimer;
+    ToRGB(spectra.Data(), batchRGB.Data(), numSpectra);
+    batchTimer.Update();
+
+    float maxError = 0.0f;
+    for (uint64 i = 0; i < numSpectra; ++i) {
+        const float scale = Max(Max(referenceRGB[i].x, referenceRGB[i].y), Max(referenceRGB[i].z, 1e-6f));
+        for (uint32 channel = 0; channel < 3; ++channel) {
+            maxError = Max(maxError, std::abs(singleRGB[i][channel] - referenceRGB[i][channel]) / scale);
+            maxError = Max(maxError, std::abs(batchRGB[i][channel] - referenceRGB[i][channel]) / scale);
+        }
+    }
+
+    WriteLog("Spectrum -> RGB for %llu spectra: scalar %.2fms, SIMD %.2fms, batch %.2fms (max relative error %e)",
+             numSpectra, referenceTimer.ElapsedMillisecondsD(), singleTimer.ElapsedMillisecondsD(),
+             batchTimer.ElapsedMillisecondsD(), maxError);
+
+    // Integrate the sun the way that SkyCache::Init does: previously every sample was converted to RGB before
+    // being accumulated, whereas now the spectra are accumulated and only the total is converted
+    const uint64 numSkySamples = 64;
+    const uint64 numIntegrations = Max<uint64>(numSpectra / numSkySamples, 1);
+    Float3 referenceTotal;
+    Timer referenceSkyTimer;
+    for (uint64 integrationIdx = 0; integrationIdx < numIntegrations; ++integrationIdx) {
+        for (uint64 sampleIdx = 0; sampleIdx < numSkySamples; ++sampleIdx) {
+            const uint64 spectrumIdx = (integrationIdx * numSkySamples + sampleIdx) % numSpectra;
+            const float cosTheta = 1.0f - sampleIdx / float(numSkySamples * 2);
+            referenceTotal += referenceToRGB(spectra[spectrumIdx]) * cosTheta;
+        }
+    }
+    referenceSkyTimer.Update();
+
+    Float3 total;
+    Timer skyTimer;
+    for (uint64 integrationIdx = 0; integrationIdx < numIntegrations; ++integrationIdx) {
+        SampledSpectrum irradiance;
+        for (uint64 sampleIdx = 0; sampleIdx < numSkySamples; ++sampleIdx) {
+            const uint64 spectrumIdx = (integrationIdx * numSkySamples + sampleIdx) % numSpectra;
+            const float cosTheta = 1.0f - sampleIdx / float(numSkySamples * 2);
+            irradiance.MultiplyAdd(spectra[spectrumIdx], cosTheta);
+        }
+        total += irradiance.ToRGB();
+    }
+    skyTimer.Update();
+
+    WriteLog("Spectral sky integration (%llu x %llu samples): per-sample RGB %.2fms, spectral accumulation %.2fms "
+             "(totals %f %f %f vs. %f %f %f)", numIntegrations, numSkySamples, referenceSkyTimer.ElapsedMillisecondsD(),
+             skyTimer.ElapsedMillisecondsD(), referenceTotal.x, referenceTotal.y, referenceTotal.z, total.x, total.y, total.z);
+}
+
 float InterpolateSpectrumSamples(const float *lambda, const float *vals, int n,
                                  float l) {
     for (int i = 0; i < n - 1; ++i) Assert_(lambda[i + 1] > lambda[i]);
@@ -982,6 +1121,9 @@ void BlackbodyNormalized(const float *lambda, int n, float T, float *Le) {
 SampledSpectrum SampledSpectrum::X;
 SampledSpectrum SampledSpectrum::Y;
 SampledSpectrum SampledSpectrum::Z;
+SampledSpectrum SampledSpectrum::rgbMatchR;
+SampledSpectrum SampledSpectrum::rgbMatchG;
+SampledSpectrum SampledSpectrum::rgbMatchB;
 SampledSpectrum SampledSpectrum::rgbRefl2SpectWhite;
 SampledSpectrum SampledSpectrum::rgbRefl2SpectCyan;
 SampledSpectrum SampledSpectrum::rgbRefl2SpectMagenta;
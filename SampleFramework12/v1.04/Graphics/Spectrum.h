@@ -103,7 +103,9 @@ class CoefficientSpectrum {
   public:
     // CoefficientSpectrum Public Methods
     CoefficientSpectrum(float v = 0.f) {
-        for (int i = 0; i < nSpectrumSamples; ++i) c[i] = v;
+        const DirectX::XMVECTOR vv = DirectX::XMVectorReplicate(v);
+        for (int i = 0; i < nVectors; ++i) StoreVector(i, vv);
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) c[i] = v;
         Assert_(!HasNaNs());
     }
 #ifdef DEBUG
@@ -128,68 +130,98 @@ class CoefficientSpectrum {
     }
     CoefficientSpectrum &operator+=(const CoefficientSpectrum &s2) {
         Assert_(!s2.HasNaNs());
-        for (int i = 0; i < nSpectrumSamples; ++i) c[i] += s2.c[i];
+        for (int i = 0; i < nVectors; ++i)
+            StoreVector(i, DirectX::XMVectorAdd(LoadVector(i), s2.LoadVector(i)));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) c[i] += s2.c[i];
         return *this;
     }
     CoefficientSpectrum operator+(const CoefficientSpectrum &s2) const {
-        Assert_(!s2.HasNaNs());
         CoefficientSpectrum ret = *this;
-        for (int i = 0; i < nSpectrumSamples; ++i) ret.c[i] += s2.c[i];
+        ret += s2;
         return ret;
     }
     CoefficientSpectrum operator-(const CoefficientSpectrum &s2) const {
         Assert_(!s2.HasNaNs());
-        CoefficientSpectrum ret = *this;
-        for (int i = 0; i < nSpectrumSamples; ++i) ret.c[i] -= s2.c[i];
+        CoefficientSpectrum ret;
+        for (int i = 0; i < nVectors; ++i)
+            ret.StoreVector(i, DirectX::XMVectorSubtract(LoadVector(i), s2.LoadVector(i)));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) ret.c[i] = c[i] - s2.c[i];
         return ret;
     }
     CoefficientSpectrum operator/(const CoefficientSpectrum &s2) const {
         Assert_(!s2.HasNaNs());
-        CoefficientSpectrum ret = *this;
-        for (int i = 0; i < nSpectrumSamples; ++i) ret.c[i] /= s2.c[i];
+        CoefficientSpectrum ret;
+        for (int i = 0; i < nVectors; ++i)
+            ret.StoreVector(i, DirectX::XMVectorDivide(LoadVector(i), s2.LoadVector(i)));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) ret.c[i] = c[i] / s2.c[i];
         return ret;
     }
     CoefficientSpectrum operator*(const CoefficientSpectrum &sp) const {
-        Assert_(!sp.HasNaNs());
         CoefficientSpectrum ret = *this;
-        for (int i = 0; i < nSpectrumSamples; ++i) ret.c[i] *= sp.c[i];
+        ret *= sp;
         return ret;
     }
     CoefficientSpectrum &operator*=(const CoefficientSpectrum &sp) {
         Assert_(!sp.HasNaNs());
-        for (int i = 0; i < nSpectrumSamples; ++i) c[i] *= sp.c[i];
+        for (int i = 0; i < nVectors; ++i)
+            StoreVector(i, DirectX::XMVectorMultiply(LoadVector(i), sp.LoadVector(i)));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) c[i] *= sp.c[i];
         return *this;
     }
     CoefficientSpectrum operator*(float a) const {
         CoefficientSpectrum ret = *this;
-        for (int i = 0; i < nSpectrumSamples; ++i) ret.c[i] *= a;
-        Assert_(!ret.HasNaNs());
+        ret *= a;
         return ret;
     }
     CoefficientSpectrum &operator*=(float a) {
-        for (int i = 0; i < nSpectrumSamples; ++i) c[i] *= a;
+        const DirectX::XMVECTOR av = DirectX::XMVectorReplicate(a);
+        for (int i = 0; i < nVectors; ++i)
+            StoreVector(i, DirectX::XMVectorMultiply(LoadVector(i), av));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) c[i] *= a;
         Assert_(!HasNaNs());
         return *this;
     }
+    // Computes this += s * a, without creating any temporaries
+    CoefficientSpectrum &MultiplyAdd(const CoefficientSpectrum &s, float a) {
+        Assert_(!s.HasNaNs());
+        const DirectX::XMVECTOR av = DirectX::XMVectorReplicate(a);
+        for (int i = 0; i < nVectors; ++i)
+            StoreVector(i, DirectX::XMVectorMultiplyAdd(s.LoadVector(i), av, LoadVector(i)));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) c[i] += s.c[i] * a;
+        return *this;
+    }
+    // Sum of the products of all samples
+    float Dot(const CoefficientSpectrum &s2) const {
+        DirectX::XMVECTOR sum = DirectX::XMVectorZero();
+        for (int i = 0; i < nVectors; ++i)
+            sum = DirectX::XMVectorMultiplyAdd(LoadVector(i), s2.LoadVector(i), sum);
+        float result = DirectX::XMVectorGetX(DirectX::XMVector4Dot(sum, DirectX::g_XMOne));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) result += c[i] * s2.c[i];
+        return result;
+    }
     friend inline CoefficientSpectrum operator*(float a,
                                                 const CoefficientSpectrum &s) {
         Assert_(!std::isnan(a) && !s.HasNaNs());
         return s * a;
     }
     CoefficientSpectrum operator/(float a) const {
-        Assert_(!std::isnan(a));
         CoefficientSpectrum ret = *this;
-        for (int i = 0; i < nSpectrumSamples; ++i) ret.c[i] /= a;
+        ret /= a;
         Assert_(!ret.HasNaNs());
         return ret;
     }
     CoefficientSpectrum &operator/=(float a) {
         Assert_(!std::isnan(a));
-        for (int i = 0; i < nSpectrumSamples; ++i) c[i] /= a;
+        const DirectX::XMVECTOR av = DirectX::XMVectorReplicate(a);
+        for (int i = 0; i < nVectors; ++i)
+            StoreVector(i, DirectX::XMVectorDivide(LoadVector(i), av));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) c[i] /= a;
         return *this;
     }
     bool operator==(const CoefficientSpectrum &sp) const {
-        for (int i = 0; i < nSpectrumSamples; ++i)
+        for (int i = 0; i < nVectors; ++i)
+            if (!DirectX::XMVector4Equal(LoadVector(i), sp.LoadVector(i))) return false;
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i)
             if (c[i] != sp.c[i]) return false;
         return true;
     }
@@ -197,13 +229,16 @@ class CoefficientSpectrum {
         return !(*this == sp);
     }
     bool IsBlack() const {
-        for (int i = 0; i < nSpectrumSamples; ++i)
+        for (int i = 0; i < nVectors; ++i)
+            if (DirectX::XMVector4NotEqual(LoadVector(i), DirectX::XMVectorZero())) return false;
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i)
             if (c[i] != 0.) return false;
         return true;
     }
     friend CoefficientSpectrum Sqrt(const CoefficientSpectrum &s) {
         CoefficientSpectrum ret;
-        for (int i = 0; i < nSpectrumSamples; ++i) ret.c[i] = std::sqrt(s.c[i]);
+        for (int i = 0; i < nVectors; ++i) ret.StoreVector(i, DirectX::XMVectorSqrt(s.LoadVector(i)));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) ret.c[i] = std::sqrt(s.c[i]);
         Assert_(!ret.HasNaNs());
         return ret;
     }
@@ -212,7 +247,8 @@ class CoefficientSpectrum {
                                              float e);
     CoefficientSpectrum operator-() const {
         CoefficientSpectrum ret;
-        for (int i = 0; i < nSpectrumSamples; ++i) ret.c[i] = -c[i];
+        for (int i = 0; i < nVectors; ++i) ret.StoreVector(i, DirectX::XMVectorNegate(LoadVector(i)));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i) ret.c[i] = -c[i];
         return ret;
     }
     friend CoefficientSpectrum Exp(const CoefficientSpectrum &s) {
@@ -232,14 +268,21 @@ class CoefficientSpectrum {
         return os;
     }
     CoefficientSpectrum Clamp(float low = 0, float high = FloatInfinity) const {
+        Assert_(high >= low);
+        const DirectX::XMVECTOR lowv = DirectX::XMVectorReplicate(low);
+        const DirectX::XMVECTOR highv = DirectX::XMVectorReplicate(high);
         CoefficientSpectrum ret;
-        for (int i = 0; i < nSpectrumSamples; ++i)
+        for (int i = 0; i < nVectors; ++i)
+            ret.StoreVector(i, DirectX::XMVectorClamp(LoadVector(i), lowv, highv));
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i)
             ret.c[i] = SampleFramework12::Clamp(c[i], low, high);
         Assert_(!ret.HasNaNs());
         return ret;
     }
     bool HasNaNs() const {
-        for (int i = 0; i < nSpectrumSamples; ++i)
+        for (int i = 0; i < nVectors; ++i)
+            if (DirectX::XMVector4IsNaN(LoadVector(i))) return true;
+        for (int i = nVectorSamples; i < nSpectrumSamples; ++i)
             if (std::isnan(c[i])) return true;
         return false;
     }
@@ -262,9 +305,20 @@ class CoefficientSpectrum {
     // CoefficientSpectrum Public Data
     static const int nSamples = nSpectrumSamples;
 
+    // Samples are processed 4 at a time with SIMD, and any remainder is handled one at a time
+    static const int nVectors = nSpectrumSamples / 4;
+    static const int nVectorSamples = nVectors * 4;
+
+    DirectX::XMVECTOR LoadVector(int i) const {
+        return DirectX::XMLoadFloat4A(reinterpret_cast<const DirectX::XMFLOAT4A *>(&c[i * 4]));
+    }
+    void StoreVector(int i, DirectX::FXMVECTOR v) {
+        DirectX::XMStoreFloat4A(reinterpret_cast<DirectX::XMFLOAT4A *>(&c[i * 4]), v);
+    }
+
   protected:
     // CoefficientSpectrum Protected Data
-    float c[nSpectrumSamples];
+    alignas(nSpectrumSamples >= 4 ? 16 : alignof(float)) float c[nSpectrumSamples];
 };
 
 class SampledSpectrum : public CoefficientSpectrum<NumSpectralSamples> {
@@ -308,6 +362,18 @@ class SampledSpectrum : public CoefficientSpectrum<NumSpectralSamples> {
                                             wl1);
         }
 
+        // Fold the XYZ->RGB conversion into a set of RGB matching functions
+        float scale = float(SampledLambdaEnd - SampledLambdaStart) /
+                      float(CIE_Y_integral * NumSpectralSamples);
+        for (int i = 0; i < NumSpectralSamples; ++i) {
+            float xyz[3] = { X.c[i] * scale, Y.c[i] * scale, Z.c[i] * scale };
+            float rgb[3];
+            XYZToRGB(xyz, rgb);
+            rgbMatchR.c[i] = rgb[0];
+            rgbMatchG.c[i] = rgb[1];
+            rgbMatchB.c[i] = rgb[2];
+        }
+
         // Compute RGB to spectrum functions for _SampledSpectrum_
         for (int i = 0; i < NumSpectralSamples; ++i) {
             float wl0 = SpectrumLerp(float(i) / float(NumSpectralSamples),
@@ -359,28 +425,22 @@ class SampledSpectrum : public CoefficientSpectrum<NumSpectralSamples> {
         }
     }
     void ToXYZ(float xyz[3]) const {
-        xyz[0] = xyz[1] = xyz[2] = 0.f;
-        for (int i = 0; i < NumSpectralSamples; ++i) {
-            xyz[0] += X.c[i] * c[i];
-            xyz[1] += Y.c[i] * c[i];
-            xyz[2] += Z.c[i] * c[i];
-        }
         float scale = float(SampledLambdaEnd - SampledLambdaStart) /
                       float(CIE_Y_integral * NumSpectralSamples);
-        xyz[0] *= scale;
-        xyz[1] *= scale;
-        xyz[2] *= scale;
+        xyz[0] = Dot(X) * scale;
+        xyz[1] = Dot(Y) * scale;
+        xyz[2] = Dot(Z) * scale;
     }
     float y() const {
-        float yy = 0.f;
-        for (int i = 0; i < NumSpectralSamples; ++i) yy += Y.c[i] * c[i];
-        return yy * float(SampledLambdaEnd - SampledLambdaStart) /
+        return Dot(Y) * float(SampledLambdaEnd - SampledLambdaStart) /
                float(CIE_Y_integral * NumSpectralSamples);
     }
     void ToRGB(float rgb[3]) const {
-        float xyz[3];
-        ToXYZ(xyz);
-        XYZToRGB(xyz, rgb);
+        // The XYZ->RGB matrix and the scale are already folded into the
+        // RGB matching functions, so this is just 3 dot products
+        rgb[0] = Dot(rgbMatchR);
+        rgb[1] = Dot(rgbMatchG);
+        rgb[2] = Dot(rgbMatchB);
     }
 
     Float3 ToRGB() const {
@@ -389,6 +449,13 @@ class SampledSpectrum : public CoefficientSpectrum<NumSpectralSamples> {
         return Float3(rgb[0], rgb[1], rgb[2]);
     }
 
+    // Converts an array of spectra to RGB, 4 spectra at a time
+    static void ToRGB(const SampledSpectrum *spectra, Float3 *rgb, uint64 numSpectra);
+
+    // Times the conversion to RGB as well as a spectral sky integration, comparing against the
+    // old per-sample conversions. Results are written to the log.
+    static void BenchmarkConversion(uint64 numSpectra = 64 * 1024);
+
     RGBSpectrum ToRGBSpectrum() const;
     static SampledSpectrum FromRGB(
         const float rgb[3], SpectrumType type = SpectrumType::Illuminant);
@@ -409,6 +476,7 @@ class SampledSpectrum : public CoefficientSpectrum<NumSpectralSamples> {
   private:
     // SampledSpectrum Private Data
     static SampledSpectrum X, Y, Z;
+    static SampledSpectrum rgbMatchR, rgbMatchG, rgbMatchB;
     static SampledSpectrum rgbRefl2SpectWhite, rgbRefl2SpectCyan;
     static SampledSpectrum rgbRefl2SpectMagenta, rgbRefl2SpectYellow;
     static SampledSpectrum rgbRefl2SpectRed, rgbRefl2SpectGreen;
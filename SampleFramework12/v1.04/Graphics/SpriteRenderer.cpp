@@ -14,6 +14,8 @@
 #include "SpriteFont.h"
 #include "Textures.h"
 #include "DX12_Helpers.h"
+#include "BarrierTracker.h"
+#include "DX12_PipelineCache.h"
 
 namespace SampleFramework12
 {
@@ -76,7 +78,7 @@ void SpriteRenderer::CreatePSOs(DXGI_FORMAT rtFormat, uint32 numMSAASamples)
         psoDesc.RTVFormats[0] = rtFormat;
         psoDesc.SampleDesc.Count = numMSAASamples;
         psoDesc.SampleDesc.Quality = numMSAASamples > 1 ? DX12::StandardMSAAPattern : 0;
-        DXCall(DX12::Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&pipelineStates[i])));
+        DX12::CreateGraphicsPipelineState(psoDesc, &pipelineStates[i]);
     }
 }
 
@@ -141,6 +143,8 @@ void SpriteRenderer::RenderBatch(ID3D12GraphicsCommandList* cmdList, const Textu
         }
     #endif
 
+    DX12::FlushBarriers(cmdList);
+
     uint64 numSpritesLeft = numSprites;
     for(uint64 offset = 0; offset < numSprites; offset += MaxBatchSize)
     {
@@ -11,6 +11,7 @@
 
 #include "SwapChain.h"
 #include "DX12.h"
+#include "BarrierTracker.h"
 #include "..\\Exceptions.h"
 #include "..\\Utility.h"
 
@@ -158,38 +159,19 @@ void SwapChain::BeginFrame()
 {
     backBufferIdx = swapChain->GetCurrentBackBufferIndex();
 
-    // Indicate that the back buffer will be used as a render target.
-    D3D12_TEXTURE_BARRIER barrier =
-    {
-        .SyncBefore = D3D12_BARRIER_SYNC_NONE,
-        .SyncAfter = D3D12_BARRIER_SYNC_RENDER_TARGET,
-        .AccessBefore = D3D12_BARRIER_ACCESS_NO_ACCESS,
-        .AccessAfter = D3D12_BARRIER_ACCESS_RENDER_TARGET,
-        .LayoutBefore = D3D12_BARRIER_LAYOUT_UNDEFINED,
-        .LayoutAfter = D3D12_BARRIER_LAYOUT_RENDER_TARGET,
-        .pResource = backBuffers[backBufferIdx].Texture.Resource,
-        .Subresources = { },
-        .Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE,
-    };
-    DX12::Barrier(DX12::CmdList, barrier);
+    // Indicate that the back buffer will be used as a render target. Whatever was presented from it
+    // last time doesn't matter, so it starts out with no access and an undefined layout.
+    DX12::CmdListBarriers.TrackTexture(backBuffers[backBufferIdx].Texture, ResourceState());
+    DX12::CmdListBarriers.TransitionTexture(backBuffers[backBufferIdx].Texture, ResourceStates::RenderTarget);
 }
 
 void SwapChain::EndFrame()
 {
-    // Indicate that the back buffer will now be used to present.
-    D3D12_TEXTURE_BARRIER barrier =
-    {
-        .SyncBefore = D3D12_BARRIER_SYNC_RENDER_TARGET,
-        .SyncAfter = D3D12_BARRIER_SYNC_NONE,
-        .AccessBefore = D3D12_BARRIER_ACCESS_RENDER_TARGET,
-        .AccessAfter = D3D12_BARRIER_ACCESS_NO_ACCESS,
-        .LayoutBefore = D3D12_BARRIER_LAYOUT_RENDER_TARGET,
-        .LayoutAfter = D3D12_BARRIER_LAYOUT_PRESENT,
-        .pResource = backBuffers[backBufferIdx].Texture.Resource,
-        .Subresources = { },
-        .Flags = D3D12_TEXTURE_BARRIER_FLAG_NONE,
-    };
-    DX12::Barrier(DX12::CmdList, barrier);
+    // Indicate that the back buffer will now be used to present. It stops being tracked after this,
+    // since the swap chain hands out a different one next frame (and may get resized in between).
+    DX12::CmdListBarriers.TransitionTexture(backBuffers[backBufferIdx].Texture, ResourceStates::Present);
+    DX12::FlushBarriers(DX12::CmdList);
+    DX12::CmdListBarriers.Untrack(backBuffers[backBufferIdx].Texture.Resource);
 }
 
 }
\ No newline at end of file
@@ -13,6 +13,8 @@
 #include "..\\Exceptions.h"
 #include "Textures.h"
 #include "..\\FileIO.h"
+#include "..\\Tasks.h"
+#include "..\\Timer.h"
 #include "ShaderCompilation.h"
 #include "GraphicsTypes.h"
 #include "TinyEXR.h"
@@ -488,11 +490,54 @@ void SaveTextureAsDDS(const Texture& texture, const wchar* filePath)
                         scratchImage.GetMetadata(), DirectX::DDS_FLAGS_FORCE_DX10_EXT, filePath));
 }
 
+// Streams RGBA scanlines through TinyEXR's ZIP writer, which compresses blocks of scanlines in parallel
+// and writes them out as it goes. The texels are read in place, so no planar copy of the image is needed.
+static void SaveEXRScanlines(const Float4* texels, uint32 width, uint32 height, const wchar* filePath, bool parallel = true)
+{
+    // EXR channels need to be in alphabetical order
+    const char* channelNames[3] = { "B", "G", "R" };
+    const int channelComponents[3] = { 2, 1, 0 };
+
+    std::string filePathAnsi = WStringToAnsi(filePath);
+
+    EXRCodecOptions options;
+    InitEXRCodecOptions(&options);
+    options.parallel = parallel ? 1 : 0;
+
+    const char* errorString = nullptr;
+    EXRStreamWriter* writer = BeginEXRStream(filePathAnsi.c_str(), int(width), int(height), 3, channelNames,
+                                             channelComponents, 4, &options, &errorString);
+    int returnCode = -1;
+    if(writer != nullptr)
+    {
+        returnCode = WriteEXRStreamScanlines(writer, &texels[0].x, int(height), &errorString);
+        const int endCode = EndEXRStream(writer, returnCode == 0 ? &errorString : nullptr);
+        if(returnCode == 0)
+            returnCode = endCode;
+    }
+
+    if(returnCode != 0)
+    {
+        AssertFail_("%s", errorString);
+        throw Exception(AnsiToWString(errorString));
+    }
+}
+
 void SaveTextureAsEXR(const Texture& texture, const wchar* filePath)
 {
-    TextureData<Float4> textureData;
-    GetTextureData(texture, textureData);
-    SaveTextureAsEXR(textureData, filePath);
+    WriteLog("Saving EXR file '%ls'", filePath);
+
+    Assert_(texture.Depth == 1);
+    Assert_(texture.ArraySize == 1);
+
+    // Compress straight out of the readback buffer rather than making a copy of the whole image first
+    ReadbackBuffer readbackBuffer;
+    DX12::ConvertAndReadbackTexture(texture, DXGI_FORMAT_R32G32B32A32_FLOAT, readbackBuffer);
+    Assert_(readbackBuffer.Size == texture.Width * texture.Height * sizeof(Float4));
+
+    SaveEXRScanlines(readbackBuffer.Map<Float4>(), texture.Width, texture.Height, filePath);
+
+    readbackBuffer.Shutdown();
 }
 
 void SaveTextureAsEXR(const TextureData<Float4>& texture, const wchar* filePath)
@@ -503,39 +548,100 @@ void SaveTextureAsEXR(const TextureData<Float4>& texture, const wchar* filePath)
     Assert_(texture.Width > 0 && texture.Height > 0);
     Assert_(texture.NumSlices == 1);
 
-    const uint64 numTexels = texture.Texels.Size();
-    std::vector<float> channelDataR;
-    std::vector<float> channelDataG;
-    std::vector<float> channelDataB;
-    channelDataR.resize(numTexels);
-    channelDataG.resize(numTexels);
-    channelDataB.resize(numTexels);
-    for(uint64 i = 0; i < numTexels; ++i)
-    {
-        channelDataR[i] = texture.Texels[i].x;
-        channelDataG[i] = texture.Texels[i].y;
-        channelDataB[i] = texture.Texels[i].z;
-    }
-
-    float* imageChannels[3] = { channelDataB.data(), channelDataG.data(), channelDataR.data() };
-    const char* channelNames[3] = { "B", "G", "R" };
-
-    EXRImage exrImage;
-    exrImage.num_channels = 3;
-    exrImage.width = texture.Width;
-    exrImage.height = texture.Height;
-    exrImage.channel_names = channelNames;
-    exrImage.images = imageChannels;
+    SaveEXRScanlines(texture.Texels.Data(), texture.Width, texture.Height, filePath);
+}
 
+static void LoadEXRScanlines(const wchar* filePath, TextureData<Float4>& textureData, bool parallel)
+{
     std::string filePathAnsi = WStringToAnsi(filePath);
 
+    EXRCodecOptions options;
+    InitEXRCodecOptions(&options);
+    options.parallel = parallel ? 1 : 0;
+
+    float* rgba = nullptr;
+    int width = 0;
+    int height = 0;
     const char* errorString = nullptr;
-    int returnCode = SaveMultiChannelEXR(&exrImage, filePathAnsi.c_str(), &errorString);
+    int returnCode = LoadEXRWithOptions(&rgba, &width, &height, filePathAnsi.c_str(), &options, &errorString);
     if(returnCode != 0)
     {
         AssertFail_("%s", errorString);
         throw Exception(AnsiToWString(errorString));
     }
+
+    textureData.Init(uint32(width), uint32(height), 1);
+    memcpy(textureData.Texels.Data(), rgba, textureData.Texels.MemorySize());
+    free(rgba);
+}
+
+void LoadEXRTextureData(const wchar* filePath, TextureData<Float4>& textureData)
+{
+    LoadEXRScanlines(filePath, textureData, true);
+}
+
+bool BenchmarkEXRCodec(uint32 width, uint32 height)
+{
+    wchar tempDir[MAX_PATH] = { };
+    Win32Call(GetTempPathW(MAX_PATH, tempDir) != 0);
+    const std::wstring filePathString = std::wstring(tempDir) + L"SF12_EXRBenchmark.exr";
+    const wchar* filePath = filePathString.c_str();
+
+    // Smooth gradients with some high-frequency detail, so that compression does a realistic amount of work
+    TextureData<Float4> source;
+    source.Init(width, height, 1);
+    for(uint32 y = 0; y < height; ++y)
+    {
+        for(uint32 x = 0; x < width; ++x)
+        {
+            const float u = (x + 0.5f) / width;
+            const float v = (y + 0.5f) / height;
+            const float detail = std::sin(x * 0.37f) * std::cos(y * 0.23f) * 0.1f;
+            source.Texels[y * width + x] = Float4(u * 4.0f + detail, v * 16.0f, std::sin(u * Pi * 8.0f) * 0.5f + 0.5f + detail, 1.0f);
+        }
+    }
+
+    const double megapixels = double(width) * height / 1000000.0;
+    WriteLog("EXR codec benchmark: %ux%u, %u threads", width, height, Tasks::NumThreads());
+
+    TextureData<Float4> loaded;
+    for(uint32 parallel = 0; parallel < 2; ++parallel)
+    {
+        Timer saveTimer;
+        SaveEXRScanlines(source.Texels.Data(), width, height, filePath, parallel != 0);
+        saveTimer.Update();
+
+        Timer loadTimer;
+        LoadEXRScanlines(filePath, loaded, parallel != 0);
+        loadTimer.Update();
+
+        WriteLog("    %s: save %.2fms (%.1f MPixels/sec), load %.2fms (%.1f MPixels/sec)", parallel ? "Parallel" : "Serial",
+                 saveTimer.ElapsedMillisecondsD(), megapixels / saveTimer.ElapsedSecondsD(),
+                 loadTimer.ElapsedMillisecondsD(), megapixels / loadTimer.ElapsedSecondsD());
+    }
+
+    // The file is stored as half precision, so check the round trip against that
+    Assert_(loaded.Width == width && loaded.Height == height);
+    float maxRelativeError = 0.0f;
+    for(uint64 i = 0; i < source.Texels.Size(); ++i)
+    {
+        const Float4& expectedTexel = source.Texels[i];
+        const Float4& actualTexel = loaded.Texels[i];
+        const float expected[3] = { expectedTexel.x, expectedTexel.y, expectedTexel.z };
+        const float actual[3] = { actualTexel.x, actualTexel.y, actualTexel.z };
+        for(uint32 c = 0; c < 3; ++c)
+        {
+            const float error = std::abs(actual[c] - expected[c]) / Max(std::abs(expected[c]), 0.001f);
+            maxRelativeError = Max(maxRelativeError, error);
+        }
+    }
+
+    WriteLog("    Max relative round-trip error: %f", maxRelativeError);
+
+    DeleteFileW(filePath);
+
+    // Half precision has an 11-bit mantissa
+    return maxRelativeError <= 0.001f;
 }
 
 void SaveTextureAsPNG(const Texture& texture, const wchar* filePath)
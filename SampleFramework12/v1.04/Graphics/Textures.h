@@ -73,11 +73,16 @@ void GetTextureData(const Texture& texture, TextureData<Float4>& textureData);
 void SaveTextureAsDDS(const Texture& texture, const wchar* filePath);
 void SaveTextureAsEXR(const Texture& texture, const wchar* filePath);
 void SaveTextureAsEXR(const TextureData<Float4>& texture, const wchar* filePath);
+void LoadEXRTextureData(const wchar* filePath, TextureData<Float4>& textureData);
 void SaveTextureAsPNG(const Texture& texture, const wchar* filePath);
 void SaveTextureAsPNG(const TextureData<UByte4N>& texture, const wchar* filePath);
 void SaveTextureAsTIFF(const Texture& texture, const wchar* filePath);
 void SaveTextureAsTIFF(const TextureData<UShort4N>& texture, const wchar* filePath);
 
+// Logs save/load throughput for a synthetic image, with and without parallel block compression.
+// Returns false if the round trip doesn't match the source to half precision.
+bool BenchmarkEXRCodec(uint32 width = 3840, uint32 height = 2160);
+
 Float3 MapXYSToDirection(uint32 x, uint32 y, uint32 s, uint32 width, uint32 height);
 
 uint32 CalculateNumMips(uint32 width, uint32 height, uint32 depth = 1);
@@ -0,0 +1,480 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "TransientResources.h"
+#include "..\\Timer.h"
+#include "..\\Utility.h"
+
+namespace SampleFramework12
+{
+
+// == TransientLifetimeRecorder ===================================================================
+
+void TransientLifetimeRecorder::Shutdown()
+{
+    lifetimes.Shutdown();
+    inFrame = false;
+}
+
+void TransientLifetimeRecorder::BeginFrame()
+{
+    Assert_(inFrame == false);
+    lifetimes.RemoveAll();
+    currTick = 0;
+    inFrame = true;
+}
+
+uint32 TransientLifetimeRecorder::Acquire(uint64 key, uint64 size, uint64 alignment)
+{
+    Assert_(inFrame);
+    Assert_(alignment > 0);
+
+    TransientLifetime& lifetime = lifetimes.Add();
+    lifetime.Key = key;
+    lifetime.Size = size;
+    lifetime.Alignment = alignment;
+    lifetime.FirstUse = currTick++;
+    lifetime.LastUse = uint32(-1);
+
+    return uint32(lifetimes.Count() - 1);
+}
+
+void TransientLifetimeRecorder::Release(uint32 requestIdx)
+{
+    Assert_(inFrame);
+    Assert_(requestIdx < lifetimes.Count());
+
+    TransientLifetime& lifetime = lifetimes[requestIdx];
+    Assert_(lifetime.LastUse == uint32(-1));
+    lifetime.LastUse = currTick++;
+}
+
+void TransientLifetimeRecorder::EndFrame()
+{
+    Assert_(inFrame);
+    inFrame = false;
+
+    // Anything that wasn't explicitly released lives until the end of the frame
+    for(uint64 i = 0; i < lifetimes.Count(); ++i)
+        if(lifetimes[i].LastUse == uint32(-1))
+            lifetimes[i].LastUse = currTick;
+
+    const Hash prevSignature = signature;
+    signature = GenerateHash(lifetimes.Data(), lifetimes.Count() * sizeof(TransientLifetime));
+    numStableFrames = (signature == prevSignature) ? numStableFrames + 1 : 1;
+}
+
+// == Aliasing ====================================================================================
+
+bool TransientAliasingPlan::MemoryOverlaps(uint64 idxA, uint64 idxB) const
+{
+    return Offsets[idxA] < Offsets[idxB] + Sizes[idxB] && Offsets[idxB] < Offsets[idxA] + Sizes[idxA];
+}
+
+void PlanTransientAliasing(const TransientLifetime* lifetimes, uint64 numResources, TransientAliasingPlan& plan)
+{
+    Assert_(lifetimes != nullptr || numResources == 0);
+
+    plan.Keys.Init(numResources);
+    plan.Offsets.Init(numResources, uint64(-1));
+    plan.Sizes.Init(numResources);
+    plan.HeapSize = 0;
+    plan.UnaliasedSize = 0;
+    plan.Signature = GenerateHash(lifetimes, numResources * sizeof(TransientLifetime));
+
+    Array<uint32> order(numResources);
+    for(uint64 i = 0; i < numResources; ++i)
+    {
+        order[i] = uint32(i);
+        plan.Keys[i] = lifetimes[i].Key;
+        plan.Sizes[i] = lifetimes[i].Size;
+        plan.UnaliasedSize = AlignTo(plan.UnaliasedSize, lifetimes[i].Alignment) + lifetimes[i].Size;
+    }
+
+    // Largest alignment first so that the padding doesn't open up gaps between smaller resources,
+    // then largest first, and then in the order that they're used
+    std::sort(order.begin(), order.end(), [&](uint32 a, uint32 b)
+    {
+        if(lifetimes[a].Alignment != lifetimes[b].Alignment)
+            return lifetimes[a].Alignment > lifetimes[b].Alignment;
+        if(lifetimes[a].Size != lifetimes[b].Size)
+            return lifetimes[a].Size > lifetimes[b].Size;
+        return lifetimes[a].FirstUse < lifetimes[b].FirstUse;
+    });
+
+    struct Interval
+    {
+        uint64 Start;
+        uint64 End;
+    };
+
+    List<Interval> occupied(numResources);
+    for(uint64 i = 0; i < numResources; ++i)
+    {
+        const uint32 resIdx = order[i];
+        const TransientLifetime& lifetime = lifetimes[resIdx];
+
+        // Gather the memory used by everything placed so far that's alive at the same time
+        occupied.RemoveAll();
+        for(uint64 j = 0; j < i; ++j)
+        {
+            const uint32 otherIdx = order[j];
+            if(LifetimesOverlap(lifetime, lifetimes[otherIdx]))
+                occupied.Add({ plan.Offsets[otherIdx], plan.Offsets[otherIdx] + plan.Sizes[otherIdx] });
+        }
+
+        std::sort(occupied.begin(), occupied.end(), [](const Interval& a, const Interval& b) { return a.Start < b.Start; });
+
+        // Take the first gap that's big enough
+        uint64 offset = 0;
+        for(uint64 j = 0; j < occupied.Count(); ++j)
+        {
+            if(AlignTo(offset, lifetime.Alignment) + lifetime.Size <= occupied[j].Start)
+                break;
+            offset = Max(offset, occupied[j].End);
+        }
+
+        offset = AlignTo(offset, lifetime.Alignment);
+        plan.Offsets[resIdx] = offset;
+        plan.HeapSize = Max(plan.HeapSize, offset + lifetime.Size);
+    }
+
+    occupied.Shutdown();
+
+    // The greedy placement isn't guaranteed to beat laying everything out back-to-back, in which case that's what we do
+    if(plan.HeapSize > plan.UnaliasedSize)
+    {
+        uint64 offset = 0;
+        for(uint64 i = 0; i < numResources; ++i)
+        {
+            offset = AlignTo(offset, lifetimes[i].Alignment);
+            plan.Offsets[i] = offset;
+            offset += lifetimes[i].Size;
+        }
+
+        plan.HeapSize = offset;
+    }
+}
+
+// == Validation ==================================================================================
+
+struct ValidationPoolItem
+{
+    bool32 InUse = false;
+    uint64 LastUsedFrame = 0;
+};
+
+// Checks the properties that every plan needs to have, regardless of how well it packs
+static bool CheckAliasingPlan(const TransientLifetime* lifetimes, uint64 numResources, const TransientAliasingPlan& plan)
+{
+    for(uint64 i = 0; i < numResources; ++i)
+    {
+        if(plan.Offsets[i] % lifetimes[i].Alignment != 0 || plan.Offsets[i] + plan.Sizes[i] > plan.HeapSize)
+        {
+            WriteLog("Aliased resource %llu is misaligned or doesn't fit in the heap", i);
+            return false;
+        }
+
+        for(uint64 j = i + 1; j < numResources; ++j)
+        {
+            if(LifetimesOverlap(lifetimes[i], lifetimes[j]) && plan.MemoryOverlaps(i, j))
+            {
+                WriteLog("Aliased resources %llu and %llu are alive at the same time and share memory", i, j);
+                return false;
+            }
+        }
+    }
+
+    if(plan.HeapSize > plan.UnaliasedSize)
+    {
+        WriteLog("The aliased heap (%llu bytes) is bigger than the unaliased resources (%llu bytes)", plan.HeapSize, plan.UnaliasedSize);
+        return false;
+    }
+
+    return true;
+}
+
+bool ValidateTransientResources()
+{
+    bool passed = true;
+    const uint64 alignment = 64 * 1024;
+
+    // Two targets used one after the other share memory, and a third that's alive during both goes after them
+    {
+        const TransientLifetime lifetimes[] =
+        {
+            { .Key = 0, .Size = 4 * alignment, .Alignment = alignment, .FirstUse = 0, .LastUse = 1 },
+            { .Key = 1, .Size = 4 * alignment, .Alignment = alignment, .FirstUse = 2, .LastUse = 3 },
+            { .Key = 2, .Size = alignment, .Alignment = alignment, .FirstUse = 1, .LastUse = 2 },
+        };
+
+        TransientAliasingPlan plan;
+        PlanTransientAliasing(lifetimes, ArraySize_(lifetimes), plan);
+        passed = CheckAliasingPlan(lifetimes, ArraySize_(lifetimes), plan) && passed;
+        if(plan.Offsets[0] != 0 || plan.Offsets[1] != 0 || plan.Offsets[2] != 4 * alignment ||
+           plan.HeapSize != 5 * alignment || plan.UnaliasedSize != 9 * alignment)
+        {
+            WriteLog("Planned offsets %llu/%llu/%llu with a %llu byte heap, expected 0/0/%llu with %llu bytes",
+                     plan.Offsets[0], plan.Offsets[1], plan.Offsets[2], plan.HeapSize, 4 * alignment, 5 * alignment);
+            passed = false;
+        }
+    }
+
+    // Randomized request sequences recorded the same way that PostProcessHelper records them, including
+    // targets with the 4MB MSAA alignment and targets that are never released
+    {
+        Random rng;
+        rng.SeedWithValue(42);
+
+        for(uint64 iteration = 0; iteration < 200 && passed; ++iteration)
+        {
+            TransientLifetimeRecorder recorder;
+            recorder.BeginFrame();
+
+            List<uint32> live;
+            const uint64 numRequests = 1 + rng.RandomUint() % 40;
+            for(uint64 i = 0; i < numRequests; ++i)
+            {
+                if(live.Count() > 0 && rng.RandomUint() % 2 == 0)
+                {
+                    const uint64 liveIdx = rng.RandomUint() % live.Count();
+                    recorder.Release(live[liveIdx]);
+                    live.Remove(liveIdx);
+                }
+
+                const uint64 size = (1 + rng.RandomUint() % 16) * alignment;
+                const uint64 resourceAlignment = rng.RandomUint() % 4 == 0 ? 4 * 1024 * 1024 : alignment;
+                live.Add(recorder.Acquire(rng.RandomUint() % 8, size, resourceAlignment));
+            }
+
+            recorder.EndFrame();
+
+            TransientAliasingPlan plan;
+            PlanTransientAliasing(recorder.Lifetimes().Data(), recorder.NumRequests(), plan);
+            passed = CheckAliasingPlan(recorder.Lifetimes().Data(), recorder.NumRequests(), plan) && passed;
+
+            live.Shutdown();
+            recorder.Shutdown();
+        }
+    }
+
+    // Frames with the same requests in the same order are stable, anything else starts over
+    {
+        TransientLifetimeRecorder recorder;
+        auto RecordFrame = [&](bool swapReleases)
+        {
+            recorder.BeginFrame();
+            const uint32 a = recorder.Acquire(1, alignment, alignment);
+            const uint32 b = recorder.Acquire(2, alignment, alignment);
+            recorder.Release(swapReleases ? b : a);
+            recorder.Release(swapReleases ? a : b);
+            recorder.Acquire(3, alignment, alignment);
+            recorder.EndFrame();
+        };
+
+        RecordFrame(false);
+        const Hash firstSignature = recorder.Signature();
+        RecordFrame(false);
+        const bool stable = recorder.NumStableFrames() == 2 && recorder.Signature() == firstSignature;
+        RecordFrame(true);
+        const bool restarted = recorder.NumStableFrames() == 1 && (recorder.Signature() == firstSignature) == false;
+        const bool unreleased = recorder.Lifetimes()[2].LastUse == 5;
+        if(stable == false || restarted == false || unreleased == false)
+        {
+            WriteLog("Lifetime recorder signatures: stable %d, restarted %d, unreleased target extended to the end %d", stable, restarted, unreleased);
+            passed = false;
+        }
+
+        recorder.Shutdown();
+    }
+
+    // Only free items that have been idle for longer than the limit get evicted, and empty buckets go away with them
+    {
+        ValidationPoolItem items[4];
+        items[0] = { .InUse = false, .LastUsedFrame = 0 };
+        items[1] = { .InUse = false, .LastUsedFrame = 50 };
+        items[2] = { .InUse = true, .LastUsedFrame = 0 };
+        items[3] = { .InUse = false, .LastUsedFrame = 10 };
+
+        TransientPool<ValidationPoolItem> pool;
+        pool.Add(1, &items[0]);
+        pool.Add(1, &items[1]);
+        pool.Add(1, &items[2]);
+        pool.Add(2, &items[3]);
+
+        const uint64 maxIdleFrames = 60;
+        List<ValidationPoolItem*> evicted;
+        pool.EvictIdle(70, maxIdleFrames, evicted);
+        const bool evictedFirst = evicted.Count() == 1 && evicted[0] == &items[0] && pool.NumItems() == 3;
+
+        evicted.RemoveAll();
+        pool.EvictIdle(71, maxIdleFrames, evicted);
+        const bool evictedLast = evicted.Count() == 1 && evicted[0] == &items[3] && pool.NumItems() == 2;
+
+        const bool emptyBucket = pool.Acquire(2, 72) == nullptr;
+        ValidationPoolItem* acquired = pool.Acquire(1, 72);
+        const bool reused = acquired == &items[1] && acquired->InUse && acquired->LastUsedFrame == 72;
+        if(evictedFirst == false || evictedLast == false || emptyBucket == false || reused == false)
+        {
+            WriteLog("Pool eviction: first %d, last %d, empty bucket %d, reused %d", evictedFirst, evictedLast, emptyBucket, reused);
+            passed = false;
+        }
+
+        evicted.RemoveAll();
+        pool.RemoveAll(evicted);
+        evicted.Shutdown();
+    }
+
+    WriteLog("Transient resource validation %s", passed ? "passed" : "failed");
+    return passed;
+}
+
+// == Benchmark ===================================================================================
+
+struct BenchmarkPoolItem
+{
+    bool32 InUse = false;
+    uint64 LastUsedFrame = 0;
+    uint64 Key = 0;
+};
+
+static uint64 EstimateTargetSize(uint64 width, uint64 height, uint64 bytesPerPixel)
+{
+    return AlignTo(width * height * bytesPerPixel, uint64(64 * 1024));
+}
+
+// Bloom down/up-sampling, depth of field, motion blur, and a final tone mapping pass, with each pass releasing its
+// inputs once it's done with them
+static void RecordPostProcessChain(TransientLifetimeRecorder& recorder, uint64 width, uint64 height)
+{
+    const uint64 alignment = 64 * 1024;
+    const uint32 NumBloomLevels = 6;
+
+    recorder.BeginFrame();
+
+    uint32 bloomDown[NumBloomLevels] = { };
+    for(uint32 i = 0; i < NumBloomLevels; ++i)
+    {
+        const uint64 w = Max<uint64>(width >> (i + 1), 1);
+        const uint64 h = Max<uint64>(height >> (i + 1), 1);
+        bloomDown[i] = recorder.Acquire(i, EstimateTargetSize(w, h, 8), alignment);
+    }
+
+    for(int32 i = NumBloomLevels - 2; i >= 0; --i)
+    {
+        const uint64 w = Max<uint64>(width >> (i + 1), 1);
+        const uint64 h = Max<uint64>(height >> (i + 1), 1);
+        const uint32 bloomUp = recorder.Acquire(100 + i, EstimateTargetSize(w, h, 8), alignment);
+        recorder.Release(bloomDown[i + 1]);
+        bloomDown[i + 1] = bloomUp;
+    }
+
+    const uint32 cocTarget = recorder.Acquire(200, EstimateTargetSize(width, height, 2), alignment);
+    const uint32 dofHalfRes = recorder.Acquire(201, EstimateTargetSize(width / 2, height / 2, 8), alignment);
+    const uint32 dofBlurred = recorder.Acquire(202, EstimateTargetSize(width / 2, height / 2, 8), alignment);
+    recorder.Release(dofHalfRes);
+    const uint32 dofComposite = recorder.Acquire(203, EstimateTargetSize(width, height, 8), alignment);
+    recorder.Release(cocTarget);
+    recorder.Release(dofBlurred);
+
+    const uint32 tileMaxVelocity = recorder.Acquire(300, EstimateTargetSize(width / 16, height / 16, 4), alignment);
+    const uint32 motionBlur = recorder.Acquire(301, EstimateTargetSize(width, height, 8), alignment);
+    recorder.Release(tileMaxVelocity);
+    recorder.Release(dofComposite);
+
+    const uint32 toneMapped = recorder.Acquire(400, EstimateTargetSize(width, height, 4), alignment);
+    recorder.Release(motionBlur);
+    recorder.Release(bloomDown[0]);
+    recorder.Release(bloomDown[1]);
+    recorder.Release(toneMapped);
+
+    recorder.EndFrame();
+}
+
+void BenchmarkTransientResources()
+{
+    WriteLog("Transient resource benchmark");
+
+    const uint64 resolutions[2][2] = { { 1920, 1080 }, { 3840, 2160 } };
+    for(uint64 resIdx = 0; resIdx < ArraySize_(resolutions); ++resIdx)
+    {
+        TransientLifetimeRecorder recorder;
+        RecordPostProcessChain(recorder, resolutions[resIdx][0], resolutions[resIdx][1]);
+
+        const uint64 numIterations = 1000;
+        TransientAliasingPlan plan;
+        Timer timer;
+        for(uint64 i = 0; i < numIterations; ++i)
+            PlanTransientAliasing(recorder.Lifetimes().Data(), recorder.NumRequests(), plan);
+        timer.Update();
+
+        WriteLog("    %llux%llu, %llu targets: %.2fMB unaliased, %.2fMB aliased (%.1f%% saved), planned in %.2fus",
+                 resolutions[resIdx][0], resolutions[resIdx][1], plan.NumResources(),
+                 plan.UnaliasedSize / (1024.0 * 1024.0), plan.HeapSize / (1024.0 * 1024.0),
+                 100.0 * (1.0 - double(plan.HeapSize) / double(plan.UnaliasedSize)),
+                 timer.ElapsedMicrosecondsD() / numIterations);
+
+        recorder.Shutdown();
+    }
+
+    // Lookups in a pool where most targets are busy, which is the worst case for both approaches
+    const uint64 numKeys = 32;
+    const uint64 itemsPerKey = 8;
+    Array<BenchmarkPoolItem> items(numKeys * itemsPerKey);
+    TransientPool<BenchmarkPoolItem> pool;
+    for(uint64 i = 0; i < items.Size(); ++i)
+    {
+        items[i].Key = i % numKeys;
+        items[i].InUse = (i / numKeys) < itemsPerKey - 1;
+        pool.Add(items[i].Key, &items[i]);
+    }
+
+    const uint64 numLookups = 1000000;
+    uint64 numFound = 0;
+
+    Timer timer;
+    for(uint64 i = 0; i < numLookups; ++i)
+    {
+        const uint64 key = (i * 7) % numKeys;
+        BenchmarkPoolItem* item = pool.Acquire(key, i);
+        numFound += item != nullptr ? 1 : 0;
+        if(item != nullptr)
+            item->InUse = false;
+    }
+    timer.Update();
+    const double hashedNS = timer.ElapsedMicrosecondsD() * 1000.0 / numLookups;
+
+    for(uint64 i = 0; i < numLookups; ++i)
+    {
+        const uint64 key = (i * 7) % numKeys;
+        BenchmarkPoolItem* item = nullptr;
+        for(uint64 j = 0; j < items.Size(); ++j)
+        {
+            if(items[j].InUse == false && items[j].Key == key)
+            {
+                item = &items[j];
+                break;
+            }
+        }
+        numFound += item != nullptr ? 1 : 0;
+    }
+    timer.Update();
+    const double linearNS = timer.DeltaMicrosecondsD() * 1000.0 / numLookups;
+
+    WriteLog("    Pool lookup with %llu targets: %.1fns hashed, %.1fns linear scan (%llu found)",
+             items.Size(), hashedNS, linearNS, numFound);
+
+    List<BenchmarkPoolItem*> removed;
+    pool.RemoveAll(removed);
+    removed.Shutdown();
+}
+
+}
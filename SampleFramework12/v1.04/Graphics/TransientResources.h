@@ -0,0 +1,184 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "..\\PCH.h"
+
+#include "..\\Containers.h"
+#include "..\\MurmurHash.h"
+
+namespace SampleFramework12
+{
+
+// Pooled items bucketed by a descriptor key, so that finding a free item only looks at items that
+// could actually be used. T needs InUse and LastUsedFrame members, and the pool doesn't own the items.
+template<typename T> class TransientPool
+{
+
+public:
+
+    T* Acquire(uint64 key, uint64 frame)
+    {
+        auto iter = buckets.find(key);
+        if(iter == buckets.end())
+            return nullptr;
+
+        List<T*>& bucket = iter->second;
+        for(uint64 i = 0; i < bucket.Count(); ++i)
+        {
+            T* item = bucket[i];
+            if(item->InUse == false)
+            {
+                item->InUse = true;
+                item->LastUsedFrame = frame;
+                return item;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void Add(uint64 key, T* item)
+    {
+        buckets[key].Add(item);
+        numItems += 1;
+    }
+
+    // Removes items that are free and haven't been acquired for more than maxIdleFrames
+    void EvictIdle(uint64 frame, uint64 maxIdleFrames, List<T*>& evicted)
+    {
+        for(auto iter = buckets.begin(); iter != buckets.end();)
+        {
+            List<T*>& bucket = iter->second;
+            for(uint64 i = 0; i < bucket.Count();)
+            {
+                T* item = bucket[i];
+                if(item->InUse == false && frame - item->LastUsedFrame > maxIdleFrames)
+                {
+                    evicted.Add(item);
+                    bucket.Remove(i);
+                    numItems -= 1;
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+
+            if(bucket.Count() == 0)
+            {
+                bucket.Shutdown();
+                iter = buckets.erase(iter);
+            }
+            else
+                ++iter;
+        }
+    }
+
+    void RemoveAll(List<T*>& removed)
+    {
+        for(auto& bucket : buckets)
+        {
+            removed.Append(bucket.second.Data(), bucket.second.Count());
+            bucket.second.Shutdown();
+        }
+
+        buckets.clear();
+        numItems = 0;
+    }
+
+    template<typename TFunc> void ForEach(TFunc func) const
+    {
+        for(const auto& bucket : buckets)
+            for(uint64 i = 0; i < bucket.second.Count(); ++i)
+                func(bucket.second[i]);
+    }
+
+    uint64 NumItems() const { return numItems; }
+
+protected:
+
+    std::unordered_map<uint64, List<T*>> buckets;
+    uint64 numItems = 0;
+};
+
+// The memory requirements of a transient resource, and the span of the frame where it's in use.
+// Uses are measured in ticks that advance every time that any transient resource is acquired or released.
+struct TransientLifetime
+{
+    uint64 Key = 0;
+    uint64 Size = 0;
+    uint64 Alignment = 0;
+    uint32 FirstUse = 0;
+    uint32 LastUse = uint32(-1);    // Inclusive
+};
+
+inline bool LifetimesOverlap(const TransientLifetime& a, const TransientLifetime& b)
+{
+    return a.FirstUse <= b.LastUse && b.FirstUse <= a.LastUse;
+}
+
+// Records the order in which transient resources are acquired and released over a frame. Frames that
+// make the same requests in the same order end up with the same signature.
+class TransientLifetimeRecorder
+{
+
+public:
+
+    void Shutdown();
+
+    void BeginFrame();
+    uint32 Acquire(uint64 key, uint64 size, uint64 alignment);
+    void Release(uint32 requestIdx);
+    void EndFrame();
+
+    const List<TransientLifetime>& Lifetimes() const { return lifetimes; }
+    uint64 NumRequests() const { return lifetimes.Count(); }
+    Hash Signature() const { return signature; }
+
+    // Number of frames in a row that have had the current signature
+    uint64 NumStableFrames() const { return numStableFrames; }
+
+protected:
+
+    List<TransientLifetime> lifetimes;
+    uint32 currTick = 0;
+    Hash signature;
+    uint64 numStableFrames = 0;
+    bool inFrame = false;
+};
+
+// Heap offsets for a set of transient resources, where resources only share memory if their lifetimes don't overlap
+struct TransientAliasingPlan
+{
+    Array<uint64> Keys;
+    Array<uint64> Offsets;
+    Array<uint64> Sizes;
+    uint64 HeapSize = 0;
+    uint64 UnaliasedSize = 0;   // How much memory the resources would need without any aliasing
+    Hash Signature;
+
+    uint64 NumResources() const { return Offsets.Size(); }
+    bool MemoryOverlaps(uint64 idxA, uint64 idxB) const;
+};
+
+// Places the resources with the largest alignment and size first, with each one going at the lowest offset that
+// doesn't overlap (in both memory and lifetime) with anything that's already been placed. Falls back to placing
+// everything back-to-back if that would need a smaller heap.
+void PlanTransientAliasing(const TransientLifetime* lifetimes, uint64 numResources, TransientAliasingPlan& plan);
+
+// Checks the planner, the recorder, and pool eviction against hand-built cases and randomized lifetimes
+bool ValidateTransientResources();
+
+// Logs the memory saved by aliasing a synthetic post-processing chain at 1080p and 4K, along with how long it
+// takes to find a free target in a pool through the hashed buckets vs. a linear scan
+void BenchmarkTransientResources();
+
+}
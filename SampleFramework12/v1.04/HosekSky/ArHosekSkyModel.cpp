@@ -816,3 +816,195 @@ double arhosekskymodel_solar_radiance(
     return  direct_radiance + inscattered_radiance;
 }
 
+
+void arhosekskymodel_solar_radiance_batch(
+        ArHosekSkyModelState  * state,
+        const float           * theta,
+        const float           * gamma,
+        int                     count,
+        double                  wavelength,
+        float                 * result
+        )
+{
+    assert(
+           wavelength >= 320.0
+        && wavelength <= 720.0
+        && state->turbidity >= 1.0
+        && state->turbidity <= 10.0
+        );
+
+    //   Direct radiance: same turbidity/wavelength interpolation as
+    //   'arhosekskymodel_solar_radiance_internal2', but folded into a single
+    //   cubic per piece so that each direction only evaluates one polynomial.
+
+    int     turb_low  = (int) state->turbidity - 1;
+    double  turb_frac = state->turbidity - (double) (turb_low + 1);
+
+    if ( turb_low == 9 )
+    {
+        turb_low  = 8;
+        turb_frac = 1.0;
+    }
+
+    int    wl_low  = (int) ((wavelength - 320.0) / 40.0);
+    double wl_frac = fmod(wavelength, 40.0) / 40.0;
+
+    if ( wl_low == 10 )
+    {
+        wl_low = 9;
+        wl_frac = 1.0;
+    }
+
+    const int     sr_turbidity[4] = { turb_low, turb_low, turb_low+1, turb_low+1 };
+    const int     sr_wl[4]        = { wl_low, wl_low+1, wl_low, wl_low+1 };
+    const double  sr_weight[4]    =
+    {
+        ( 1.0 - turb_frac ) * ( 1.0 - wl_frac ),
+        ( 1.0 - turb_frac ) * wl_frac,
+        turb_frac * ( 1.0 - wl_frac ),
+        turb_frac * wl_frac
+    };
+
+    float  sr_coefs[pieces][order];
+    float  sr_break_x[pieces];
+
+    for ( int pos = 0; pos < pieces; ++pos )
+    {
+        sr_break_x[pos] =
+            (float) (pow(((double) pos / (double) pieces), 3.0) * (MATH_PI * 0.5));
+
+        for ( int i = 0; i < order; ++i )
+        {
+            double coef = 0.0;
+
+            for ( int j = 0; j < 4; ++j )
+            {
+                const double  * coefs =
+                    solarDatasets[sr_wl[j]] + (order * pieces * sr_turbidity[j] + order * (pos+1) - 1);
+
+                coef +=
+                      sr_weight[j]
+                    * coefs[-i]
+                    * state->emission_correction_factor_sun[sr_wl[j]];
+            }
+
+            sr_coefs[pos][i] = (float) coef;
+        }
+    }
+
+    float ldCoefficient[6];
+
+    for ( int i = 0; i < 6; i++ )
+        ldCoefficient[i] = (float) (
+              (1.0 - wl_frac) * limbDarkeningDatasets[wl_low  ][i]
+            +        wl_frac  * limbDarkeningDatasets[wl_low+1][i] );
+
+    const double sol_rad_sin = sin(state->solar_radius);
+    const float ar2 = (float) (1 / ( sol_rad_sin * sol_rad_sin ));
+
+    //   Inscattered radiance: same as 'arhosekskymodel_radiance', with the
+    //   radiance and emission correction factors folded into one scale per
+    //   configuration.
+
+    float  sky_configs[2][9] = { { 0.0f } };
+    float  sky_scale[2] = { 0.0f, 0.0f };
+
+    int sky_low_wl = int((wavelength - 320.0 ) / 40.0);
+
+    if ( sky_low_wl >= 0 && sky_low_wl < 11 )
+    {
+        double interp = fmod((wavelength - 320.0 ) / 40.0, 1.0);
+
+        for ( int j = 0; j < 2; ++j )
+        {
+            int wl = sky_low_wl + j;
+
+            if ( wl >= 11 )
+                wl = sky_low_wl;
+
+            for ( int i = 0; i < 9; ++i )
+                sky_configs[j][i] = (float) state->configs[wl][i];
+        }
+
+        if ( interp < 1e-6 )
+        {
+            sky_scale[0] =
+                (float) (  state->radiances[sky_low_wl]
+                         * state->emission_correction_factor_sky[sky_low_wl]);
+        }
+        else
+        {
+            sky_scale[0] =
+                (float) (  ( 1.0 - interp )
+                         * state->radiances[sky_low_wl]
+                         * state->emission_correction_factor_sky[sky_low_wl]);
+
+            if ( sky_low_wl+1 < 11 )
+                sky_scale[1] =
+                    (float) (  interp
+                             * state->radiances[sky_low_wl+1]
+                             * state->emission_correction_factor_sky[sky_low_wl+1]);
+        }
+    }
+
+    for ( int d = 0; d < count; ++d )
+    {
+        const float elevation = (float) (MATH_PI * 0.5) - theta[d];
+
+        //   Unlike the double version, 'pos' is clamped on both sides so
+        //   that directions slightly below the horizon stay in the table
+
+        int pos =
+            (int) (cbrtf(2.0f * elevation / (float) MATH_PI) * pieces); // floor
+
+        if ( pos > 44 ) pos = 44;
+        if ( pos < 0 ) pos = 0;
+
+        const float x = elevation - sr_break_x[pos];
+        const float  * coefs = sr_coefs[pos];
+
+        float direct_radiance =
+            coefs[0] + x * (coefs[1] + x * (coefs[2] + x * coefs[3]));
+
+        const float singamma = sinf(gamma[d]);
+        float sc2 = 1.0f - ar2 * singamma * singamma;
+        if (sc2 < 0.0f ) sc2 = 0.0f;
+        const float sampleCosine = sqrtf(sc2);
+
+        const float darkeningFactor =
+              ldCoefficient[0]
+            + sampleCosine * (ldCoefficient[1]
+            + sampleCosine * (ldCoefficient[2]
+            + sampleCosine * (ldCoefficient[3]
+            + sampleCosine * (ldCoefficient[4]
+            + sampleCosine *  ldCoefficient[5]))));
+
+        direct_radiance *= darkeningFactor;
+
+        //   Same as 'ArHosekSkyModel_GetRadianceInternal', with
+        //   pow(x, 1.5) replaced by x * sqrt(x)
+
+        const float cosGamma = cosf(gamma[d]);
+        const float cosTheta = cosf(theta[d]);
+        const float rayM = cosGamma * cosGamma;
+        const float zenith = sqrtf(cosTheta);
+
+        float inscattered_radiance = 0.0f;
+
+        for ( int j = 0; j < 2; ++j )
+        {
+            const float  * configuration = sky_configs[j];
+
+            const float expM = expf(configuration[4] * gamma[d]);
+            const float mieBase = 1.0f + configuration[8]*configuration[8] - 2.0f*configuration[8]*cosGamma;
+            const float mieM = (1.0f + rayM) / (mieBase * sqrtf(mieBase));
+
+            inscattered_radiance +=
+                  sky_scale[j]
+                * (1.0f + configuration[0] * expf(configuration[1] / (cosTheta + 0.01f)))
+                * (configuration[2] + configuration[3] * expM + configuration[5] * rayM + configuration[6] * mieM + configuration[7] * zenith);
+        }
+
+        result[d] = direct_radiance + inscattered_radiance;
+    }
+}
@@ -451,6 +451,22 @@ double arhosekskymodel_solar_radiance(
         double                      wavelength
         );
 
+//   Same as 'arhosekskymodel_solar_radiance', but for 'count' directions at
+//   one wavelength, in single precision. Everything that only depends on the
+//   wavelength and turbidity is set up once per call, and the per-direction
+//   work runs as plain float loops over the 'theta'/'gamma' arrays that the
+//   compiler can vectorise. Results are within ~1e-4 relative of the double
+//   precision version.
+
+void arhosekskymodel_solar_radiance_batch(
+        ArHosekSkyModelState      * state,
+        const float               * theta,
+        const float               * gamma,
+        int                         count,
+        double                      wavelength,
+        float                     * result
+        );
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,10 +12,17 @@
 #include "Window.h"
 #include "Graphics/DX12.h"
 #include "Graphics/DX12_Helpers.h"
+#include "Graphics/DX12_CmdLists.h"
+#include "Graphics/BarrierTracker.h"
+#include "Graphics/DX12_PipelineCache.h"
 #include "Graphics/GraphicsTypes.h"
 #include "Graphics/ShaderCompilation.h"
 #include "Graphics/Textures.h"
 #include "ImGui/imgui.h"
+#include "MurmurHash.h"
+#include "Tasks.h"
+#include "Timer.h"
+#include "Utility.h"
 
 namespace SampleFramework12
 {
@@ -23,16 +30,84 @@ namespace SampleFramework12
 namespace ImGuiHelper
 {
 
-struct ImGuiVSConstants
+// Passed as root constants, so that switching textures between draws doesn't need a new constant buffer
+struct ImGuiConstants
 {
-    Float4x4 ProjectionMatrix;
+    Float2 Scale;
+    Float2 Translation;
+    uint32 TextureTableIdx = 0;
+    uint32 TextureEntryIdx = 0;
+};
+
+static const uint32 NumImGuiConstants = uint32(sizeof(ImGuiConstants) / sizeof(uint32));
+static const uint32 TextureEntryConstant = uint32(offsetof(ImGuiConstants, TextureEntryIdx) / sizeof(uint32));
+
+// What was last copied into one of the RenderLatency copies of the vertex/index buffers for a single draw list
+struct UploadedDrawList
+{
+    Hash ContentHash;
+    uint64 VtxOffset = 0;
+    uint64 IdxOffset = 0;
+};
+
+// A single draw (or user callback) from one of ImGui's draw lists, with the texture table entry already looked up
+// so that it can be recorded from any thread
+struct ImGuiDraw
+{
+    const ImDrawList* DrawList = nullptr;
+    const ImDrawCmd* DrawCmd = nullptr;
+    D3D12_RECT ScissorRect = { };
+    uint32 StartIndex = 0;
+    uint32 BaseVertex = 0;
+    uint32 TextureEntry = 0;
+};
+
+// Everything that's needed to record this frame's draws, which only gets read once recording starts
+struct FrameDrawState
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE RTV = { };
+    uint32 DisplayWidth = 0;
+    uint32 DisplayHeight = 0;
+    ImGuiConstants Constants;
+    D3D12_VERTEX_BUFFER_VIEW VBView = { };
+    D3D12_INDEX_BUFFER_VIEW IBView = { };
+    List<ImGuiDraw> Draws;
+    uint64 NumCallbacks = 0;
+};
+
+// Below this many draws per list it's not worth binding all of the state again and waking up the task threads
+static const uint64 MinParallelDrawsPerCmdList = 128;
+
+struct StressTestStats
+{
+    uint64 NumFrames = 0;
+    uint64 FramesLeft = 0;
+    double EndFrameTime = 0.0;
+    uint64 NumDrawLists = 0;
+    uint64 NumSkippedDrawLists = 0;
+    uint64 NumUploadedBytes = 0;
+    uint64 NumGeometryBytes = 0;
+    uint64 NumDraws = 0;
+    uint64 NumTextureEntries = 0;
+    uint64 NumParallelCmdLists = 0;
 };
 
 static CompiledShaderPtr VS;
 static CompiledShaderPtr PS;
+static ID3D12RootSignature* RootSignature = nullptr;
 static ID3D12PipelineState* PSO = nullptr;
 static Texture FontTexture;
 
+// Persistent geometry and texture table, which have RenderLatency copies that get cycled through every frame
+static Buffer VertexBuffer;
+static Buffer IndexBuffer;
+static StructuredBuffer TextureTable;
+static List<UploadedDrawList> UploadedDrawLists[DX12::RenderLatency];
+static List<ImTextureID> FrameTextureIDs;
+static FrameDrawState FrameDraws;
+
+static StressTestStats StressTest;
+
 #if UseAsserts_
     static uint64 CurrBeginFrame = uint64(-1);
     static uint64 CurrEndFrame = uint64(-1);
@@ -126,6 +201,29 @@ void Initialize(Window& window)
 
     Create2DTexture(FontTexture, texWidth, texHeight, 1, 1, DXGI_FORMAT_R8G8B8A8_UNORM, false, pixels);
     io.Fonts->TexID = ToImTextureID(FontTexture.SRV, 0);
+
+    {
+        // Same as the universal root signature with IA, except that everything comes from root constants
+        D3D12_ROOT_PARAMETER1 rootParameters[1] = {};
+        rootParameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+        rootParameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+        rootParameters[0].Constants.Num32BitValues = NumImGuiConstants;
+        rootParameters[0].Constants.RegisterSpace = 0;
+        rootParameters[0].Constants.ShaderRegister = 0;
+
+        D3D12_STATIC_SAMPLER_DESC staticSamplers[uint64(SamplerState::NumValues)] = {};
+        for(uint32 i = 0; i < uint32(SamplerState::NumValues); ++i)
+            staticSamplers[i] = DX12::GetStaticSamplerState(SamplerState(i), i, 0, D3D12_SHADER_VISIBILITY_ALL);
+
+        D3D12_ROOT_SIGNATURE_DESC1 rootSignatureDesc = {};
+        rootSignatureDesc.NumParameters = ArraySize_(rootParameters);
+        rootSignatureDesc.pParameters = rootParameters;
+        rootSignatureDesc.NumStaticSamplers = ArraySize_(staticSamplers);
+        rootSignatureDesc.pStaticSamplers = staticSamplers;
+        rootSignatureDesc.Flags = D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED |
+                                  D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT;
+        DX12::CreateRootSignature(&RootSignature, rootSignatureDesc);
+    }
 }
 
 void Shutdown()
@@ -134,8 +232,17 @@ void Shutdown()
     GUIContext = nullptr;
 
     FontTexture.Shutdown();
+    VertexBuffer.Shutdown();
+    IndexBuffer.Shutdown();
+    TextureTable.Shutdown();
+    for(uint64 i = 0; i < DX12::RenderLatency; ++i)
+        UploadedDrawLists[i].Shutdown();
+    FrameTextureIDs.Shutdown();
+    FrameDraws.Draws.Shutdown();
 
     DestroyPSOs();
+
+    DX12::Release(RootSignature);
 }
 
 void CreatePSOs(DXGI_FORMAT rtFormat)
@@ -148,7 +255,7 @@ void CreatePSOs(DXGI_FORMAT rtFormat)
     };
 
     D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc = { };
-    psoDesc.pRootSignature = DX12::UniversalRootSignatureWithIA;
+    psoDesc.pRootSignature = RootSignature;
     psoDesc.VS = VS.ByteCode();
     psoDesc.PS = PS.ByteCode();
     psoDesc.RasterizerState = DX12::GetRasterizerState(RasterizerState::NoCull);
@@ -161,7 +268,7 @@ void CreatePSOs(DXGI_FORMAT rtFormat)
     psoDesc.SampleDesc.Count = 1;
     psoDesc.InputLayout.pInputElementDescs = inputElements;
     psoDesc.InputLayout.NumElements = ArraySize_(inputElements);
-    DXCall(DX12::Device->CreateGraphicsPipelineState(&psoDesc, IID_PPV_ARGS(&PSO)));
+    DX12::CreateGraphicsPipelineState(psoDesc, &PSO);
 }
 
 void DestroyPSOs()
@@ -169,6 +276,54 @@ void DestroyPSOs()
     DX12::DeferredRelease(PSO);
 }
 
+// Lots of windows full of text, plots, and images, where only every other window changes from frame to frame. Every
+// line starts with a small image that uses a different sampler mode from the text, which breaks up the batching and
+// makes for enough draws to get recorded in parallel.
+static void DrawStressTestUI()
+{
+    static const uint64 NumWindows = 32;
+    static const uint64 NumLines = 48;
+    static const uint64 NumPlotValues = 128;
+
+    const uint64 frameIdx = StressTest.NumFrames - StressTest.FramesLeft;
+    const ImGuiIO& io = ImGui::GetIO();
+    const ImTextureID lineTextureID = ToImTextureID(FontTexture.SRV, 1);
+
+    float plotValues[NumPlotValues] = { };
+    for(uint64 i = 0; i < NumPlotValues; ++i)
+        plotValues[i] = std::sin(float(i) * 0.1f);
+
+    for(uint64 windowIdx = 0; windowIdx < NumWindows; ++windowIdx)
+    {
+        const bool animated = (windowIdx % 2) == 1;
+        const float x = float(windowIdx % 8) * io.DisplaySize.x / 8.0f;
+        const float y = float(windowIdx / 8) * io.DisplaySize.y / 4.0f;
+        ImGui::SetNextWindowPos(ImVec2(x, y), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(io.DisplaySize.x / 8.0f, io.DisplaySize.y / 4.0f), ImGuiCond_Always);
+
+        char windowName[32] = { };
+        sprintf_s(windowName, "ImGui Stress Test %llu", windowIdx);
+        if(ImGui::Begin(windowName, nullptr, ImGuiWindowFlags_NoSavedSettings))
+        {
+            for(uint64 lineIdx = 0; lineIdx < NumLines; ++lineIdx)
+            {
+                const float lineHeight = ImGui::GetTextLineHeight();
+                ImGui::Image(lineTextureID, ImVec2(lineHeight, lineHeight));
+                ImGui::SameLine();
+                ImGui::Text("Line %llu: %llu", lineIdx, animated ? frameIdx * NumLines + lineIdx : lineIdx);
+            }
+
+            ImGui::PlotLines("Plot", plotValues, int32(NumPlotValues), animated ? int32(frameIdx % NumPlotValues) : 0);
+
+            // Alternate between sampler modes so that the texture table gets more than one entry
+            const ImTextureID textureID = ToImTextureID(FontTexture.SRV, uint32(windowIdx % 2));
+            ImGui::Image(textureID, ImVec2(64.0f, 64.0f));
+            ImGui::ProgressBar(animated ? float(frameIdx % 100) / 100.0f : 0.5f);
+        }
+        ImGui::End();
+    }
+}
+
 void BeginFrame(uint32 displayWidth, uint32 displayHeight, float timeDelta)
 {
     Assert_(CurrBeginFrame != DX12::CurrentCPUFrame);
@@ -184,108 +339,334 @@ void BeginFrame(uint32 displayWidth, uint32 displayHeight, float timeDelta)
 
     ImGui::NewFrame();
 
+    if(StressTest.FramesLeft > 0)
+        DrawStressTestUI();
+
     #if UseAsserts_
         CurrBeginFrame = DX12::CurrentCPUFrame;
     #endif
 }
 
+// Re-creates a persistent upload buffer if it's too small for this frame, leaving some room to grow
+static bool EnsureBufferSize(Buffer& buffer, uint64 size, const wchar* name)
+{
+    if(buffer.Resource != nullptr && buffer.Size >= size)
+        return false;
+
+    const uint64 newSize = Max(size + size / 2, buffer.Resource != nullptr ? buffer.Size * 2 : 0);
+
+    buffer.Shutdown();
+
+    BufferInit init;
+    init.Size = newSize;
+    init.Alignment = 4;
+    init.Dynamic = true;
+    init.CPUAccessible = true;
+    init.Name = name;
+    buffer.Initialize(init);
+
+    return true;
+}
+
+static uint32 FindTextureEntry(ImTextureID textureID, ImTextureID* tableEntries)
+{
+    for(uint64 i = 0; i < FrameTextureIDs.Count(); ++i)
+        if(FrameTextureIDs[i] == textureID)
+            return uint32(i);
+
+    const uint64 entryIdx = FrameTextureIDs.Add(textureID);
+    tableEntries[entryIdx] = textureID;
+    return uint32(entryIdx);
+}
+
+// Binds everything that the draws need, since command lists don't inherit any state from each other
+static void SetupRenderState(ID3D12GraphicsCommandList* cmdList)
+{
+    DX12::SetViewport(cmdList, FrameDraws.DisplayWidth, FrameDraws.DisplayHeight);
+
+    cmdList->OMSetRenderTargets(1, &FrameDraws.RTV, false, nullptr);
+
+    cmdList->SetPipelineState(PSO);
+    cmdList->SetGraphicsRootSignature(RootSignature);
+    cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+    cmdList->SetGraphicsRoot32BitConstants(0, NumImGuiConstants, &FrameDraws.Constants, 0);
+
+    cmdList->IASetVertexBuffers(0, 1, &FrameDraws.VBView);
+    cmdList->IASetIndexBuffer(&FrameDraws.IBView);
+}
+
+static void RecordDraw(ID3D12GraphicsCommandList* cmdList, const ImGuiDraw& draw, bool setTextureEntry)
+{
+    if(setTextureEntry)
+        cmdList->SetGraphicsRoot32BitConstant(0, draw.TextureEntry, TextureEntryConstant);
+
+    cmdList->RSSetScissorRects(1, &draw.ScissorRect);
+
+    cmdList->DrawIndexedInstanced(draw.DrawCmd->ElemCount, 1, draw.StartIndex, draw.BaseVertex, 0);
+}
+
+// Records draws [startDraw, endDraw) with the state already bound, only updating the texture entry constant
+// when the texture changes
+static void RecordDraws(ID3D12GraphicsCommandList* cmdList, uint64 startDraw, uint64 endDraw)
+{
+    uint32 currTextureEntry = uint32(-1);
+    for(uint64 drawIdx = startDraw; drawIdx < endDraw; ++drawIdx)
+    {
+        const ImGuiDraw& draw = FrameDraws.Draws[drawIdx];
+        if(draw.DrawCmd->UserCallback)
+        {
+            draw.DrawCmd->UserCallback(draw.DrawList, draw.DrawCmd);
+            continue;
+        }
+
+        RecordDraw(cmdList, draw, draw.TextureEntry != currTextureEntry);
+        currTextureEntry = draw.TextureEntry;
+    }
+}
+
+// Gets called from the task threads, with the draws split evenly between the lists
+static void RecordDrawsTask(DX12::GraphicsCmdList* cmdList, uint64 listIdx, void* context)
+{
+    const uint64 numCmdLists = *reinterpret_cast<const uint64*>(context);
+    const uint64 numDraws = FrameDraws.Draws.Count();
+
+    PIXMarker pixMarker(cmdList, "ImGui Rendering");
+
+    SetupRenderState(cmdList);
+    RecordDraws(cmdList, listIdx * numDraws / numCmdLists, (listIdx + 1) * numDraws / numCmdLists);
+}
+
+static void SetupBenchmarkTask(DX12::GraphicsCmdList* cmdList, uint64 listIdx, void* context)
+{
+    SetupRenderState(cmdList);
+}
+
+static void RecordBenchmarkDraw(DX12::GraphicsCmdList* cmdList, uint64 drawIdx, void* context)
+{
+    // These lists are never executed, so the texture entry only needs to be right for the cost to be right
+    const ImGuiDraw& draw = FrameDraws.Draws[drawIdx];
+    if(draw.DrawCmd->UserCallback == nullptr)
+        RecordDraw(cmdList, draw, drawIdx == 0 || draw.TextureEntry != FrameDraws.Draws[drawIdx - 1].TextureEntry);
+}
+
 void EndFrame(ID3D12GraphicsCommandList* cmdList, D3D12_CPU_DESCRIPTOR_HANDLE rtv, uint32 displayWidth, uint32 displayHeight)
 {
     Assert_(CurrBeginFrame == DX12::CurrentCPUFrame);
     Assert_(CurrEndFrame != DX12::CurrentCPUFrame);
 
-    ImGui::Render();
+    Timer timer;
 
-    PIXMarker pixMarker(cmdList, "ImGui Rendering");
+    ImGui::Render();
 
     ImDrawData* drawData = ImGui::GetDrawData();
 
-    // Get memory for vertex and index buffers
-    const uint64 vbSize = sizeof(ImDrawVert) * drawData->TotalVtxCount;
-    const uint64 ibSize = sizeof(ImDrawIdx) * drawData->TotalIdxCount;
-    MapResult vertexMem = DX12::AcquireTempBufferMem(vbSize, 4);
-    MapResult indexMem = DX12::AcquireTempBufferMem(ibSize, 4);
+    const uint64 numVertices = uint64(drawData->TotalVtxCount);
+    const uint64 numIndices = uint64(drawData->TotalIdxCount);
+    uint64 numDrawCmds = 0;
+    for(int32 cmdListIdx = 0; cmdListIdx < drawData->CmdListsCount; ++cmdListIdx)
+        numDrawCmds += uint64(drawData->CmdLists[cmdListIdx]->CmdBuffer.size());
 
-    // Copy and convert all vertices into a single contiguous buffer
-    ImDrawVert* vertexCPUMem = reinterpret_cast<ImDrawVert*>(vertexMem.CPUAddress);
-    ImDrawIdx* indexCPUMem = reinterpret_cast<ImDrawIdx*>(indexMem.CPUAddress);
-    for(uint64 i = 0; i < drawData->CmdListsCount; i++)
+    if(numVertices == 0 || numIndices == 0 || numDrawCmds == 0)
     {
-        const ImDrawList* drawList = drawData->CmdLists[i];
-        memcpy(vertexCPUMem, &drawList->VtxBuffer[0], drawList->VtxBuffer.size() * sizeof(ImDrawVert));
-        memcpy(indexCPUMem, &drawList->IdxBuffer[0], drawList->IdxBuffer.size() * sizeof(ImDrawIdx));
-        vertexCPUMem += drawList->VtxBuffer.size();
-        indexCPUMem += drawList->IdxBuffer.size();
+        #if UseAsserts_
+            CurrEndFrame = DX12::CurrentCPUFrame;
+        #endif
+
+        return;
     }
 
-    // Setup orthographic projection matrix into our constant buffer
-    ImGuiVSConstants constants;
+    // Grow the persistent buffers if needed, which also means that nothing from previous frames is in them anymore
+    bool resized = EnsureBufferSize(VertexBuffer, numVertices * sizeof(ImDrawVert), L"ImGui Vertex Buffer");
+    resized = EnsureBufferSize(IndexBuffer, numIndices * sizeof(ImDrawIdx), L"ImGui Index Buffer") || resized;
+    if(resized)
+    {
+        for(uint64 i = 0; i < DX12::RenderLatency; ++i)
+            UploadedDrawLists[i].RemoveAll();
+    }
 
+    if(TextureTable.NumElements < numDrawCmds)
     {
-        const float L = 0.0f;
-        const float R = float(displayWidth);
-        const float B = float(displayHeight);
-        const float T = 0.0f;
-
-        constants.ProjectionMatrix = Float4x4(Float4(2.0f/(R-L),   0.0f,           0.0f,       0.0f),
-                                              Float4(0.0f,         2.0f/(T-B),     0.0f,       0.0f),
-                                              Float4(0.0f,         0.0f,           0.5f,       0.0f),
-                                              Float4((R+L)/(L-R),  (T+B)/(B-T),    0.5f,       1.0f));
+        StructuredBufferInit sbInit;
+        sbInit.Stride = sizeof(ImTextureID);
+        sbInit.NumElements = Max<uint64>(numDrawCmds, TextureTable.NumElements * 2);
+        sbInit.Dynamic = true;
+        sbInit.CPUAccessible = true;
+        sbInit.Name = L"ImGui Texture Table";
+        TextureTable.Shutdown();
+        TextureTable.Initialize(sbInit);
     }
 
-    // Setup viewport
-    DX12::SetViewport(cmdList, displayWidth, displayHeight);
+    const MapResult vertexMem = VertexBuffer.Map();
+    const MapResult indexMem = IndexBuffer.Map();
+    ImTextureID* tableEntries = TextureTable.Map<ImTextureID>();
+    FrameTextureIDs.RemoveAll();
+
+    // Every copy of the buffers remembers what got written into it, so draw lists that are identical to what was
+    // there RenderLatency frames ago (which is most of them for a UI that isn't changing) don't get copied again
+    Assert_(VertexBuffer.CurrBuffer == IndexBuffer.CurrBuffer);
+    List<UploadedDrawList>& uploadedDrawLists = UploadedDrawLists[VertexBuffer.CurrBuffer];
+
+    uint64 vtxOffset = 0;
+    uint64 idxOffset = 0;
+    uint64 numUploadedBytes = 0;
+    uint64 numSkippedDrawLists = 0;
+    for(int32 cmdListIdx = 0; cmdListIdx < drawData->CmdListsCount; ++cmdListIdx)
+    {
+        const ImDrawList* drawList = drawData->CmdLists[cmdListIdx];
+        const uint64 vtxSize = drawList->VtxBuffer.size() * sizeof(ImDrawVert);
+        const uint64 idxSize = drawList->IdxBuffer.size() * sizeof(ImDrawIdx);
 
-    cmdList->OMSetRenderTargets(1, &rtv, false, nullptr);
+        Hasher hasher;
+        hasher.Update(drawList->VtxBuffer.Data, vtxSize);
+        hasher.Update(drawList->IdxBuffer.Data, idxSize);
 
-    // Bind shader and vertex buffers
-    cmdList->SetPipelineState(PSO);
-    cmdList->SetGraphicsRootSignature(DX12::UniversalRootSignatureWithIA);
-    cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        UploadedDrawList uploaded;
+        uploaded.ContentHash = hasher.Finalize();
+        uploaded.VtxOffset = vtxOffset;
+        uploaded.IdxOffset = idxOffset;
 
-    DX12::BindTempConstantBuffer(cmdList, constants, URS_ConstantBuffers + 0, CmdListMode::Graphics);
+        const uint64 listIdx = uint64(cmdListIdx);
+        if(listIdx < uploadedDrawLists.Count() && uploadedDrawLists[listIdx].ContentHash == uploaded.ContentHash &&
+           uploadedDrawLists[listIdx].VtxOffset == vtxOffset && uploadedDrawLists[listIdx].IdxOffset == idxOffset)
+        {
+            numSkippedDrawLists += 1;
+        }
+        else
+        {
+            memcpy(vertexMem.CPUAddress + vtxOffset, drawList->VtxBuffer.Data, vtxSize);
+            memcpy(indexMem.CPUAddress + idxOffset, drawList->IdxBuffer.Data, idxSize);
+            numUploadedBytes += vtxSize + idxSize;
 
-    D3D12_VERTEX_BUFFER_VIEW vbView = { };
-    vbView.BufferLocation = vertexMem.GPUAddress;
-    vbView.SizeInBytes = uint32(vbSize);
-    vbView.StrideInBytes = sizeof(ImDrawVert);
-    cmdList->IASetVertexBuffers(0, 1, &vbView);
+            if(listIdx < uploadedDrawLists.Count())
+                uploadedDrawLists[listIdx] = uploaded;
+            else
+                uploadedDrawLists.Add(uploaded);
+        }
 
-    D3D12_INDEX_BUFFER_VIEW ibView = { };
-    ibView.BufferLocation = indexMem.GPUAddress;
-    ibView.SizeInBytes = uint32(ibSize);
-    ibView.Format = DXGI_FORMAT_R16_UINT;
-    cmdList->IASetIndexBuffer(&ibView);
+        vtxOffset += vtxSize;
+        idxOffset += idxSize;
+    }
 
-    // Render command lists
-    uint32 vtxOffset = 0;
-    uint32 idxOffset = 0;
-    for(uint64 cmdListIdx = 0; cmdListIdx < drawData->CmdListsCount; cmdListIdx++)
+    // Anything past the current draw lists no longer describes what's in the buffer
+    const uint64 numDrawLists = uint64(drawData->CmdListsCount);
+    if(uploadedDrawLists.Count() > numDrawLists)
+        uploadedDrawLists.RemoveMultiple(numDrawLists, uploadedDrawLists.Count() - numDrawLists);
+
+    // Setup an orthographic projection
+    FrameDraws.Constants.Scale = Float2(2.0f / float(displayWidth), -2.0f / float(displayHeight));
+    FrameDraws.Constants.Translation = Float2(-1.0f, 1.0f);
+    FrameDraws.Constants.TextureTableIdx = TextureTable.SRV;
+    FrameDraws.Constants.TextureEntryIdx = 0;
+
+    FrameDraws.RTV = rtv;
+    FrameDraws.DisplayWidth = displayWidth;
+    FrameDraws.DisplayHeight = displayHeight;
+
+    FrameDraws.VBView.BufferLocation = vertexMem.GPUAddress;
+    FrameDraws.VBView.SizeInBytes = uint32(vtxOffset);
+    FrameDraws.VBView.StrideInBytes = sizeof(ImDrawVert);
+
+    FrameDraws.IBView.BufferLocation = indexMem.GPUAddress;
+    FrameDraws.IBView.SizeInBytes = uint32(idxOffset);
+    FrameDraws.IBView.Format = DXGI_FORMAT_R16_UINT;
+
+    // Flatten the draws and look up their texture table entries here, so that recording them doesn't touch
+    // anything that's shared
+    FrameDraws.Draws.RemoveAll();
+    FrameDraws.NumCallbacks = 0;
+    ImTextureID currTextureID = ImTextureID(-1);
+    uint32 currTextureEntry = 0;
+    uint32 baseVertex = 0;
+    uint32 startIndex = 0;
+    for(int32 cmdListIdx = 0; cmdListIdx < drawData->CmdListsCount; cmdListIdx++)
     {
         const ImDrawList* drawList = drawData->CmdLists[cmdListIdx];
         for(int32 cmdIdx = 0; cmdIdx < drawList->CmdBuffer.size(); cmdIdx++)
         {
-            const ImDrawCmd* drawCmd = &drawList->CmdBuffer[cmdIdx];
-            if(drawCmd->UserCallback)
+            ImGuiDraw draw;
+            draw.DrawList = drawList;
+            draw.DrawCmd = &drawList->CmdBuffer[cmdIdx];
+            draw.ScissorRect = { int32(draw.DrawCmd->ClipRect.x), int32(draw.DrawCmd->ClipRect.y),
+                                 int32(draw.DrawCmd->ClipRect.z), int32(draw.DrawCmd->ClipRect.w) };
+            draw.StartIndex = startIndex;
+            draw.BaseVertex = baseVertex;
+            startIndex += draw.DrawCmd->ElemCount;
+
+            if(draw.DrawCmd->UserCallback)
             {
-                drawCmd->UserCallback(drawList, drawCmd);
+                FrameDraws.Draws.Add(draw);
+                FrameDraws.NumCallbacks += 1;
             }
-            else
+            else if(draw.ScissorRect.left < draw.ScissorRect.right && draw.ScissorRect.top < draw.ScissorRect.bottom)
             {
-                const D3D12_RECT r = { int32(drawCmd->ClipRect.x), int32(drawCmd->ClipRect.y), int32(drawCmd->ClipRect.z), int32(drawCmd->ClipRect.w) };
-
-                if(r.left < r.right && r.top < r.bottom)
+                if(draw.DrawCmd->TextureId != currTextureID)
                 {
-                    DX12::BindTempConstantBuffer(cmdList, drawCmd->TextureId, URS_ConstantBuffers + 1, CmdListMode::Graphics);
-
-                    cmdList->RSSetScissorRects(1, &r);
-
-                    cmdList->DrawIndexedInstanced(drawCmd->ElemCount, 1, idxOffset, vtxOffset, 0);
+                    currTextureEntry = FindTextureEntry(draw.DrawCmd->TextureId, tableEntries);
+                    currTextureID = draw.DrawCmd->TextureId;
                 }
+
+                draw.TextureEntry = currTextureEntry;
+                FrameDraws.Draws.Add(draw);
             }
-            idxOffset += drawCmd->ElemCount;
         }
-        vtxOffset += drawList->VtxBuffer.size();
+        baseVertex += drawList->VtxBuffer.size();
+    }
+
+    const uint64 numDraws = FrameDraws.Draws.Count() - FrameDraws.NumCallbacks;
+
+    // Make sure the render target is ready before any of the draws
+    DX12::FlushBarriers(cmdList);
+
+    // Big UIs get split up across lists that are recorded by the task threads. That swaps out DX12::CmdList, so it
+    // only works if that's what we were given. User callbacks expect to be called on the main thread.
+    uint64 numParallelCmdLists = 0;
+    if(cmdList == DX12::CmdList && FrameDraws.NumCallbacks == 0)
+        numParallelCmdLists = Min<uint64>(Min<uint64>(DX12::MaxParallelCmdLists, Tasks::NumThreads()),
+                                          numDraws / MinParallelDrawsPerCmdList);
+
+    if(numParallelCmdLists > 1)
+    {
+        DX12::RecordParallelCmdLists(numParallelCmdLists, RecordDrawsTask, &numParallelCmdLists);
+    }
+    else
+    {
+        numParallelCmdLists = 0;
+
+        PIXMarker pixMarker(cmdList, "ImGui Rendering");
+
+        SetupRenderState(cmdList);
+        RecordDraws(cmdList, 0, FrameDraws.Draws.Count());
+    }
+
+    timer.Update();
+
+    if(StressTest.FramesLeft > 0)
+    {
+        StressTest.EndFrameTime += timer.ElapsedMillisecondsD();
+        StressTest.NumDrawLists += numDrawLists;
+        StressTest.NumSkippedDrawLists += numSkippedDrawLists;
+        StressTest.NumUploadedBytes += numUploadedBytes;
+        StressTest.NumGeometryBytes += vtxOffset + idxOffset;
+        StressTest.NumDraws += numDraws;
+        StressTest.NumTextureEntries += FrameTextureIDs.Count();
+        StressTest.NumParallelCmdLists += numParallelCmdLists;
+
+        StressTest.FramesLeft -= 1;
+        if(StressTest.FramesLeft == 0)
+        {
+            const double numFrames = double(StressTest.NumFrames);
+            WriteLog("ImGui stress test (%llu frames): EndFrame %.3fms, %.1f draw lists (%.1f skipped), %.1fKB of %.1fKB geometry uploaded, "
+                     "%.1f draws, %.1f texture table entries, %.1f parallel command lists",
+                     StressTest.NumFrames, StressTest.EndFrameTime / numFrames,
+                     double(StressTest.NumDrawLists) / numFrames, double(StressTest.NumSkippedDrawLists) / numFrames,
+                     double(StressTest.NumUploadedBytes) / (numFrames * 1024.0), double(StressTest.NumGeometryBytes) / (numFrames * 1024.0),
+                     double(StressTest.NumDraws) / numFrames, double(StressTest.NumTextureEntries) / numFrames,
+                     double(StressTest.NumParallelCmdLists) / numFrames);
+
+            // Re-record the last frame's draws onto different numbers of lists, without executing any of them
+            DX12::BenchmarkCmdListRecording(FrameDraws.Draws.Count(), RecordBenchmarkDraw, nullptr, SetupBenchmarkTask);
+        }
     }
 
     #if UseAsserts_
@@ -293,6 +674,18 @@ void EndFrame(ID3D12GraphicsCommandList* cmdList, D3D12_CPU_DESCRIPTOR_HANDLE rt
     #endif
 }
 
+void RunStressTest(uint64 numFrames)
+{
+    StressTest = StressTestStats();
+    StressTest.NumFrames = numFrames;
+    StressTest.FramesLeft = numFrames;
+}
+
+bool StressTestRunning()
+{
+    return StressTest.FramesLeft > 0;
+}
+
 } // namespace ImGuiHelper
 
 } // namespace SampleFramework12
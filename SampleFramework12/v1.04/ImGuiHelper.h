@@ -28,9 +28,18 @@ void CreatePSOs(DXGI_FORMAT rtFormat);
 void DestroyPSOs();
 
 void BeginFrame(uint32 displayWidth, uint32 displayHeight, float timeDelta);
+
+// If cmdList is DX12::CmdList and there are enough draws, they get recorded in parallel with
+// DX12::RecordParallelCmdLists(). That swaps out DX12::CmdList, so grab it again after this returns.
 void EndFrame(ID3D12GraphicsCommandList* cmdList, D3D12_CPU_DESCRIPTOR_HANDLE rtv,
               uint32 displayWidth, uint32 displayHeight);
 
+// Draws a heavy synthetic UI on top of the app's UI for the next numFrames frames, and then logs
+// the average CPU time spent in EndFrame() along with how much geometry actually had to be uploaded.
+// The last frame's draws are then run through DX12::BenchmarkCmdListRecording().
+void RunStressTest(uint64 numFrames = 300);
+bool StressTestRunning();
+
 } // namespace ImGuiHelper
 
 inline ImVec2 ToImVec2(Float2 v)
@@ -0,0 +1,357 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "LogRing.h"
+#include "Timer.h"
+#include "Utility.h"
+
+#include <thread>
+
+namespace SampleFramework12
+{
+
+void LogRing::Initialize(uint64 capacity, LogSinkFunction sink_, void* sinkContext_)
+{
+    Assert_(capacity > 0 && (capacity & (capacity - 1)) == 0);
+    Assert_(sink_ != nullptr);
+
+    Shutdown();
+
+    records.Init(capacity);
+    for(uint64 i = 0; i < capacity; ++i)
+        records[i].Sequence = int64(i);
+
+    mask = capacity - 1;
+    sink = sink_;
+    sinkContext = sinkContext_;
+    consumerThreadID = GetCurrentThreadId();
+    numReportedDrops = 0;
+    enqueuePos = 0;
+    dequeuePos = 0;
+    numDropped = 0;
+}
+
+void LogRing::Shutdown()
+{
+    records.Shutdown();
+    mask = 0;
+    sink = nullptr;
+    sinkContext = nullptr;
+    consumerThreadID = 0;
+}
+
+LogRecord* LogRing::TryBeginWrite()
+{
+    int64 pos = enqueuePos;
+    while(true)
+    {
+        LogRecord& record = records[uint64(pos) & mask];
+        const int64 diff = record.Sequence - pos;
+        if(diff == 0)
+        {
+            // The slot is free, try to claim it
+            const int64 prevPos = InterlockedCompareExchange64(&enqueuePos, pos + 1, pos);
+            if(prevPos == pos)
+                return &record;
+            pos = prevPos;
+        }
+        else if(diff < 0)
+        {
+            // The consumer hasn't gotten to this slot yet since it went around last time, so the ring is full
+            return nullptr;
+        }
+        else
+        {
+            // Another producer claimed the slot
+            pos = enqueuePos;
+        }
+    }
+}
+
+LogRecord* LogRing::BeginWrite()
+{
+    LogRecord* record = TryBeginWrite();
+    if(record == nullptr && draining == false && IsConsumerThread())
+    {
+        Drain();
+        record = TryBeginWrite();
+    }
+
+    if(record == nullptr)
+        InterlockedIncrement64(&numDropped);
+
+    return record;
+}
+
+void LogRing::EndWrite(LogRecord* record)
+{
+    // The claimed slot's sequence matches the position it was claimed at, and bumping it
+    // publishes the slot to the consumer (the interlocked op keeps the payload writes from moving past it)
+    InterlockedExchange64(&record->Sequence, record->Sequence + 1);
+}
+
+bool LogRing::WriteText(const char* msg, uint64 msgLength)
+{
+    Assert_(msg != nullptr);
+
+    LogRecord* record = BeginWrite();
+    if(record == nullptr)
+        return false;
+
+    const uint64 textLength = Min(msgLength, LogRecord::PayloadSize - 1);
+    memcpy(record->Payload, msg, textLength);
+    record->Payload[textLength] = 0;
+    record->TextLength = textLength;
+    record->Format = nullptr;
+    record->FormatOffset = 0;
+    EndWrite(record);
+
+    return true;
+}
+
+uint64 LogRing::Drain()
+{
+    if(Initialized() == false)
+        return 0;
+
+    Assert_(IsConsumerThread());
+    Assert_(draining == false);
+    draining = true;
+
+    char buffer[1024 * 8];
+    uint64 numDrained = 0;
+    while(true)
+    {
+        const int64 pos = dequeuePos;
+        LogRecord& record = records[uint64(pos) & mask];
+        if(record.Sequence != pos + 1)
+            break;
+
+        if(record.Format != nullptr)
+        {
+            const char* format = reinterpret_cast<const char*>(record.Payload + record.FormatOffset);
+            const int32 result = record.Format(buffer, sizeof(buffer), format, record.Payload);
+            const uint64 msgLength = result > 0 ? Min(uint64(result), uint64(sizeof(buffer) - 1)) : 0;
+            buffer[msgLength] = 0;
+            sink(buffer, msgLength, sinkContext);
+        }
+        else
+        {
+            sink(reinterpret_cast<const char*>(record.Payload), record.TextLength, sinkContext);
+        }
+
+        // Hand the slot back to the producers for the next time around the ring
+        InterlockedExchange64(&record.Sequence, pos + int64(mask) + 1);
+        dequeuePos = pos + 1;
+        ++numDrained;
+    }
+
+    const uint64 dropped = uint64(numDropped);
+    if(dropped != numReportedDrops)
+    {
+        const int32 result = snprintf(buffer, sizeof(buffer), "%llu log messages were dropped because the log ring was full",
+                                      dropped - numReportedDrops);
+        sink(buffer, result > 0 ? uint64(result) : 0, sinkContext);
+        numReportedDrops = dropped;
+    }
+
+    draining = false;
+
+    return numDrained;
+}
+
+// Validation
+struct LogRingValidationState
+{
+    Array<uint64> NextMessage;      // Per producer thread
+    uint64 NumReceived = 0;
+    uint64 NumBadMessages = 0;
+};
+
+static void CheckLogRingMessage(const char* msg, uint64 msgLength, void* context)
+{
+    LogRingValidationState& state = *reinterpret_cast<LogRingValidationState*>(context);
+
+    // The ring reports drops with a message of its own, which is expected since the producers retry when it's full
+    uint64 threadIdx = 0;
+    uint64 messageIdx = 0;
+    if(sscanf_s(msg, "Thread %llu message %llu", &threadIdx, &messageIdx) != 2)
+    {
+        if(strstr(msg, "were dropped") == nullptr)
+            state.NumBadMessages += 1;
+        return;
+    }
+
+    const std::string expectedEnd = MakeString("from worker %llu", threadIdx);
+    const bool intact = msgLength == strlen(msg) && msgLength >= expectedEnd.length() &&
+                        strcmp(msg + msgLength - expectedEnd.length(), expectedEnd.c_str()) == 0;
+    if(threadIdx >= state.NextMessage.Size() || messageIdx != state.NextMessage[threadIdx] || intact == false)
+    {
+        state.NumBadMessages += 1;
+        return;
+    }
+
+    state.NextMessage[threadIdx] += 1;
+    state.NumReceived += 1;
+}
+
+bool ValidateLogRing(uint64 numThreads, uint64 messagesPerThread)
+{
+    // Small enough that the producers fill it up and it wraps around many times
+    static const uint64 RingCapacity = 64;
+
+    LogRingValidationState state;
+    state.NextMessage.Init(numThreads, 0);
+
+    LogRing ring;
+    ring.Initialize(RingCapacity, CheckLogRingMessage, &state);
+
+    volatile int64 numFinished = 0;
+    Array<std::thread> threads(numThreads);
+    for(uint64 threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+    {
+        threads[threadIdx] = std::thread([&ring, &numFinished, threadIdx, messagesPerThread]()
+        {
+            // The format and the string argument live in buffers that get overwritten right after each write,
+            // so anything that's read back from the caller instead of the ring shows up as a bad message
+            char format[64] = { };
+            char name[32] = { };
+            for(uint64 i = 0; i < messagesPerThread; ++i)
+            {
+                strcpy_s(format, "Thread %llu message %llu (%.2f) from %s");
+                snprintf(name, sizeof(name), "worker %llu", threadIdx);
+                while(ring.Write(format, threadIdx, i, double(i) * 0.5, name) == false)
+                    YieldProcessor();
+                memset(format, 'x', sizeof(format) - 1);
+                memset(name, 'x', sizeof(name) - 1);
+            }
+            InterlockedIncrement64(&numFinished);
+        });
+    }
+
+    while(true)
+    {
+        const bool finished = uint64(numFinished) == numThreads;
+        if(ring.Drain() == 0 && finished)
+            break;
+    }
+
+    for(uint64 threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+        threads[threadIdx].join();
+
+    ring.Shutdown();
+
+    bool passed = state.NumBadMessages == 0 && state.NumReceived == numThreads * messagesPerThread;
+    for(uint64 threadIdx = 0; threadIdx < numThreads; ++threadIdx)
+        passed = passed && state.NextMessage[threadIdx] == messagesPerThread;
+
+    WriteLog("Log ring validation %s: %llu of %llu messages received, %llu lost, corrupted or out of order", passed ? "passed" : "FAILED",
+             state.NumReceived, numThreads * messagesPerThread, state.NumBadMessages);
+
+    return passed;
+}
+
+// Benchmarking
+static void DiscardLogMessage(const char*, uint64, void*)
+{
+}
+
+void BenchmarkLogRing(uint64 messagesPerThread)
+{
+    static const uint64 ThreadCounts[] = { 1, 2, 4, 8, 16, 32 };
+    static const uint64 RingCapacity = 4096;
+    static const uint64 MaxLockedMessages = 1024;
+
+    WriteLog("Log ring benchmark (%llu messages per thread, %llu records)", messagesPerThread, RingCapacity);
+
+    LogRing ring;
+    ring.Initialize(RingCapacity, DiscardLogMessage, nullptr);
+
+    std::string* lockedMessages = new std::string[MaxLockedMessages];
+    uint64 numLockedMessages = 0;
+    SRWLOCK lockedMessagesLock = SRWLOCK_INIT;
+
+    for(uint64 threadCount : ThreadCounts)
+    {
+        const uint64 numMessages = threadCount * messagesPerThread;
+        const uint64 startDropped = ring.NumDropped();
+
+        // Producers write as fast as they can while this thread drains, which is the worst case for the ring
+        volatile int64 numFinished = 0;
+        Timer timer;
+        Array<std::thread> threads(threadCount);
+        for(uint64 threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+        {
+            threads[threadIdx] = std::thread([&ring, &numFinished, threadIdx, messagesPerThread]()
+            {
+                for(uint64 i = 0; i < messagesPerThread; ++i)
+                    ring.Write("Thread %llu wrote message %llu (%.3f) to %s", threadIdx, i, double(i) * 0.25, "the log ring");
+                InterlockedIncrement64(&numFinished);
+            });
+        }
+
+        double writeTime = 0.0;
+        uint64 numDrained = 0;
+        while(true)
+        {
+            const bool finished = uint64(numFinished) == threadCount;
+            if(finished && writeTime == 0.0)
+            {
+                timer.Update();
+                writeTime = timer.ElapsedMillisecondsD();
+            }
+            const uint64 drained = ring.Drain();
+            numDrained += drained;
+            if(drained == 0 && finished)
+                break;
+        }
+
+        timer.Update();
+        const double drainTime = timer.ElapsedMillisecondsD();
+
+        for(uint64 threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+            threads[threadIdx].join();
+
+        // The previous approach: format up-front, then copy into a std::string log behind a lock
+        timer = Timer();
+        for(uint64 threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+        {
+            threads[threadIdx] = std::thread([&, threadIdx]()
+            {
+                char buffer[1024] = { 0 };
+                for(uint64 i = 0; i < messagesPerThread; ++i)
+                {
+                    snprintf(buffer, sizeof(buffer), "Thread %llu wrote message %llu (%.3f) to %s", threadIdx, i, double(i) * 0.25, "the log ring");
+                    AcquireSRWLockExclusive(&lockedMessagesLock);
+                    lockedMessages[numLockedMessages++ % MaxLockedMessages] = buffer;
+                    ReleaseSRWLockExclusive(&lockedMessagesLock);
+                }
+            });
+        }
+
+        for(uint64 threadIdx = 0; threadIdx < threadCount; ++threadIdx)
+            threads[threadIdx].join();
+
+        timer.Update();
+        const double lockedTime = timer.ElapsedMillisecondsD();
+
+        const uint64 numDroppedMessages = ring.NumDropped() - startDropped;
+        WriteLog("    %2llu threads: ring %.1fM writes/sec (%.1fns per write per thread), %.1fM drained/sec, %llu dropped | "
+                 "format + locked copy %.1fM writes/sec",
+                 threadCount, double(numMessages) / (writeTime * 1000.0), writeTime * 1000000.0 / double(messagesPerThread),
+                 double(numDrained) / (drainTime * 1000.0), numDroppedMessages, double(numMessages) / (lockedTime * 1000.0));
+    }
+
+    delete[] lockedMessages;
+    ring.Shutdown();
+}
+
+}
@@ -0,0 +1,308 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "SF12_Assert.h"
+#include "Containers.h"
+
+namespace SampleFramework12
+{
+
+// Formats the arguments that were packed into a record's payload, returning the length of the formatted text
+typedef int32 (*LogFormatFunction)(char* buffer, uint64 bufferSize, const char* format, const uint8* payload);
+
+// Gets called by the consumer for every message that comes out of the ring
+typedef void (*LogSinkFunction)(const char* msg, uint64 msgLength, void* context);
+
+// A preallocated, fixed-size slot in the ring. Records are cache-line aligned so that producers writing to
+// neighboring slots don't fight over the same line.
+struct alignas(64) LogRecord
+{
+    static const uint64 Size = 1024;
+    static const uint64 PayloadSize = Size - 32;
+
+    volatile int64 Sequence = 0;
+    LogFormatFunction Format = nullptr;         // nullptr means that the payload already holds the message text
+    uint64 FormatOffset = 0;                    // Where the copy of the format string starts in the payload
+    uint64 TextLength = 0;
+    uint8 Payload[PayloadSize] = { };
+};
+
+static_assert(sizeof(LogRecord) == LogRecord::Size, "LogRecord has unexpected padding");
+
+// Appends the strings passed to a deferred WriteLog() (and its format string) after the packed arguments, so that
+// the caller's strings don't need to outlive the call
+class LogPayloadWriter
+{
+public:
+
+    LogPayloadWriter(uint8* payload_, uint64 offset_) : payload(payload_), offset(offset_)
+    {
+    }
+
+    template<typename TChar> uint32 AddString(const TChar* str)
+    {
+        if(str == nullptr)
+            return InvalidOffset;
+
+        // Keep the string aligned so that it can be read back in place
+        offset = (offset + alignof(TChar) - 1) & ~uint64(alignof(TChar) - 1);
+        const uint64 maxChars = offset < LogRecord::PayloadSize ? (LogRecord::PayloadSize - offset) / sizeof(TChar) : 0;
+        if(maxChars == 0)
+            return InvalidOffset;
+
+        // Anything that doesn't fit gets truncated
+        const uint32 strOffset = uint32(offset);
+        TChar* dst = reinterpret_cast<TChar*>(payload + offset);
+        uint64 numChars = 0;
+        while(numChars < maxChars - 1 && str[numChars] != 0)
+        {
+            dst[numChars] = str[numChars];
+            ++numChars;
+        }
+        dst[numChars] = 0;
+
+        offset += (numChars + 1) * sizeof(TChar);
+        return strOffset;
+    }
+
+    // Same as AddString(), except that nothing is added if the whole string doesn't fit
+    uint32 AddWholeString(const char* str)
+    {
+        const uint64 length = strlen(str);
+        if(offset >= LogRecord::PayloadSize || length >= LogRecord::PayloadSize - offset)
+            return InvalidOffset;
+
+        return AddString(str);
+    }
+
+    static const uint32 InvalidOffset = uint32(-1);
+
+private:
+
+    uint8* payload = nullptr;
+    uint64 offset = 0;
+};
+
+// Describes how a single WriteLog() argument is stored in a record. Anything that's passed by value through
+// printf-style varargs gets copied as-is, while strings are copied into the payload.
+template<typename T> struct LogArg
+{
+    static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>,
+                  "Only arithmetic, enum, pointer, and string arguments can be passed to WriteLog()");
+
+    typedef T Stored;
+
+    static Stored Pack(LogPayloadWriter&, T value)
+    {
+        return value;
+    }
+
+    static T Unpack(Stored stored, const uint8*)
+    {
+        return stored;
+    }
+};
+
+template<typename TChar> struct LogStringArg
+{
+    typedef uint32 Stored;
+
+    static Stored Pack(LogPayloadWriter& writer, const TChar* str)
+    {
+        return writer.AddString(str);
+    }
+
+    static const TChar* Unpack(Stored stored, const uint8* payload)
+    {
+        static const TChar NullString[] = { '(', 'n', 'u', 'l', 'l', ')', 0 };
+        if(stored == LogPayloadWriter::InvalidOffset)
+            return NullString;
+        return reinterpret_cast<const TChar*>(payload + stored);
+    }
+};
+
+template<> struct LogArg<const char*> : LogStringArg<char> { };
+template<> struct LogArg<char*> : LogStringArg<char> { };
+template<> struct LogArg<const wchar*> : LogStringArg<wchar> { };
+template<> struct LogArg<wchar*> : LogStringArg<wchar> { };
+
+// Where each packed argument lives at the start of a record's payload
+template<typename... Args> struct LogArgLayout
+{
+    uint64 Offsets[sizeof...(Args) + 1] = { };
+    uint64 Size = 0;
+
+    constexpr LogArgLayout()
+    {
+        uint64 idx = 0;
+        ((Size = AlignArg(Size, alignof(typename LogArg<Args>::Stored)),
+          Offsets[idx++] = Size,
+          Size += sizeof(typename LogArg<Args>::Stored)), ...);
+    }
+
+    static constexpr uint64 AlignArg(uint64 offset, uint64 alignment)
+    {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+};
+
+// Bounded multi-producer, single-consumer queue of log messages, based on Dmitry Vyukov's bounded MPMC queue.
+// Producers claim a slot with a single CAS on the enqueue position and then publish it by bumping the slot's
+// sequence number, so they never block each other or the consumer and nothing is allocated after Initialize().
+// Messages written with a format string literal only have their arguments packed into the slot, and the actual
+// formatting happens on the consumer. If the ring fills up messages get dropped (and counted), except when the
+// consumer thread is the one logging, in which case it drains the ring itself first.
+class LogRing
+{
+
+public:
+
+    LogRing()
+    {
+    }
+
+    ~LogRing()
+    {
+        Shutdown();
+    }
+
+    LogRing(const LogRing& other) = delete;
+    LogRing& operator=(const LogRing& other) = delete;
+
+    // The thread that calls Initialize() becomes the consumer, and capacity needs to be a power of 2
+    void Initialize(uint64 capacity, LogSinkFunction sink_, void* sinkContext_);
+    void Shutdown();
+
+    bool Initialized() const
+    {
+        return records.Size() > 0;
+    }
+
+    // Adds a message that's already been formatted, truncating it if it doesn't fit in a record.
+    // Returns false if the message had to be dropped.
+    bool WriteText(const char* msg, uint64 msgLength);
+
+    // Packs the arguments and a copy of the format string into a record, and defers calling snprintf until the
+    // message is drained. If the format doesn't fit next to the arguments, the message gets formatted right away.
+    template<typename... Args> bool Write(const char* format, Args... args)
+    {
+        if constexpr(sizeof...(Args) == 0)
+        {
+            return WriteText(format, strlen(format));
+        }
+        else
+        {
+            static constexpr LogArgLayout<Args...> Layout;
+            static_assert(Layout.Size <= LogRecord::PayloadSize, "Too many arguments to pack into a log record");
+
+            LogRecord* record = BeginWrite();
+            if(record == nullptr)
+                return false;
+
+            // The comma fold runs left-to-right, so strings get appended in argument order
+            LogPayloadWriter writer(record->Payload, Layout.Size);
+            uint64 argIdx = 0;
+            (StoreArg(record->Payload + Layout.Offsets[argIdx++], LogArg<Args>::Pack(writer, args)), ...);
+
+            const uint32 formatOffset = writer.AddWholeString(format);
+            if(formatOffset == LogPayloadWriter::InvalidOffset)
+            {
+                char text[LogRecord::PayloadSize] = { };
+                const int32 result = FormatPacked<Args...>(text, sizeof(text), format, record->Payload);
+                record->TextLength = result > 0 ? std::min<uint64>(uint64(result), sizeof(text) - 1) : 0;
+                memcpy(record->Payload, text, record->TextLength);
+                record->Payload[record->TextLength] = 0;
+                record->Format = nullptr;
+            }
+            else
+            {
+                record->Format = &FormatPacked<Args...>;
+                record->FormatOffset = formatOffset;
+            }
+            EndWrite(record);
+
+            return true;
+        }
+    }
+
+    // Formats all published messages and hands them to the sink. Only the consumer thread can call this,
+    // and it returns the number of messages that were drained.
+    uint64 Drain();
+
+    uint64 NumDropped() const
+    {
+        return uint64(numDropped);
+    }
+
+    bool IsConsumerThread() const
+    {
+        return GetCurrentThreadId() == consumerThreadID;
+    }
+
+private:
+
+    LogRecord* TryBeginWrite();
+    LogRecord* BeginWrite();
+    void EndWrite(LogRecord* record);
+
+    template<typename T> static void StoreArg(uint8* dst, T value)
+    {
+        memcpy(dst, &value, sizeof(T));
+    }
+
+    template<typename T> static T LoadArg(const uint8* src)
+    {
+        T value;
+        memcpy(&value, src, sizeof(T));
+        return value;
+    }
+
+    template<typename... Args, uint64... Indices>
+    static int32 FormatPacked_(char* buffer, uint64 bufferSize, const char* format, const uint8* payload, std::integer_sequence<uint64, Indices...>)
+    {
+        static constexpr LogArgLayout<Args...> Layout;
+        return snprintf(buffer, bufferSize, format,
+                        LogArg<Args>::Unpack(LoadArg<typename LogArg<Args>::Stored>(payload + Layout.Offsets[Indices]), payload)...);
+    }
+
+    template<typename... Args> static int32 FormatPacked(char* buffer, uint64 bufferSize, const char* format, const uint8* payload)
+    {
+        return FormatPacked_<Args...>(buffer, bufferSize, format, payload, std::make_integer_sequence<uint64, sizeof...(Args)>());
+    }
+
+    Array<LogRecord> records;
+    uint64 mask = 0;
+    LogSinkFunction sink = nullptr;
+    void* sinkContext = nullptr;
+    DWORD consumerThreadID = 0;
+    uint64 numReportedDrops = 0;
+    bool draining = false;
+
+    // Padded out to separate cache lines, since every producer hits the enqueue position
+    uint8 padding0[64] = { };
+    volatile int64 enqueuePos = 0;
+    uint8 padding1[64] = { };
+    volatile int64 dequeuePos = 0;
+    uint8 padding2[64] = { };
+    volatile int64 numDropped = 0;
+};
+
+// Writes messages from several threads at once through a small ring that has to wrap around many times, and checks
+// that every message comes out intact and in order for each thread. Returns false if anything was lost or reordered.
+bool ValidateLogRing(uint64 numThreads = 8, uint64 messagesPerThread = 5000);
+
+// Logs messages/second for 1 to 32 producer threads writing into a ring while the calling thread drains it,
+// compared with formatting each message up-front and copying it into a std::string log behind a lock
+void BenchmarkLogRing(uint64 messagesPerThread = 100000);
+
+}
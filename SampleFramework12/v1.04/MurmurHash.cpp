@@ -10,6 +10,9 @@
 #include "PCH.h"
 #include "MurmurHash.h"
 #include "Utility.h"
+#include "Exceptions.h"
+#include "Containers.h"
+#include "Timer.h"
 
 namespace SampleFramework12
 {
@@ -29,20 +32,6 @@ std::wstring Hash::ToString() const
 
 #define BIG_CONSTANT(x) (x)
 
-//-----------------------------------------------------------------------------
-// Block read - if your platform needs to do endian-swapping or can only
-// handle aligned reads, do the conversion here
-
-FORCE_INLINE uint32_t getblock ( const uint32_t * p, int i )
-{
-    return p[i];
-}
-
-FORCE_INLINE uint64_t getblock ( const uint64_t * p, int i )
-{
-    return p[i];
-}
-
 //-----------------------------------------------------------------------------
 // Finalization mix - force all bits of a hash block to avalanche
 
@@ -73,40 +62,25 @@ FORCE_INLINE uint64_t fmix ( uint64_t k )
 
 //-----------------------------------------------------------------------------
 
-Hash GenerateHash(const void* key, const int len, const uint32_t seed)
-{
-    const uint8_t * data = (const uint8_t*)key;
-    const int nblocks = len / 16;
-
-    uint64_t h1 = seed;
-    uint64_t h2 = seed;
-
-    const uint64_t c1 = BIG_CONSTANT(0x87c37b91114253d5);
-    const uint64_t c2 = BIG_CONSTANT(0x4cf5ad432745937f);
+static const uint64_t MurmurC1 = BIG_CONSTANT(0x87c37b91114253d5);
+static const uint64_t MurmurC2 = BIG_CONSTANT(0x4cf5ad432745937f);
 
-    //----------
-    // body
-
-    const uint64_t * blocks = (const uint64_t *)(data);
-
-    for(int i = 0; i < nblocks; i++)
-    {
-        uint64_t k1 = getblock(blocks,i*2+0);
-        uint64_t k2 = getblock(blocks,i*2+1);
-
-        k1 *= c1; k1  = ROTL64(k1,31); k1 *= c2; h1 ^= k1;
-
-        h1 = ROTL64(h1,27); h1 += h2; h1 = h1*5+0x52dce729;
+FORCE_INLINE void MurmurBlock(uint64_t& h1, uint64_t& h2, uint64_t k1, uint64_t k2)
+{
+    k1 *= MurmurC1; k1  = ROTL64(k1,31); k1 *= MurmurC2; h1 ^= k1;
 
-        k2 *= c2; k2  = ROTL64(k2,33); k2 *= c1; h2 ^= k2;
+    h1 = ROTL64(h1,27); h1 += h2; h1 = h1*5+0x52dce729;
 
-        h2 = ROTL64(h2,31); h2 += h1; h2 = h2*5+0x38495ab5;
-    }
+    k2 *= MurmurC2; k2  = ROTL64(k2,33); k2 *= MurmurC1; h2 ^= k2;
 
-    //----------
-    // tail
+    h2 = ROTL64(h2,31); h2 += h1; h2 = h2*5+0x38495ab5;
+}
 
-    const uint8_t * tail = (const uint8_t*)(data + nblocks*16);
+// Mixes in the last (len & 15) bytes and the length, after all of the 16-byte blocks have been processed
+static Hash MurmurFinalize(uint64_t h1, uint64_t h2, const uint8_t* tail, const uint64_t len)
+{
+    const uint64_t c1 = MurmurC1;
+    const uint64_t c2 = MurmurC2;
 
     uint64_t k1 = 0;
     uint64_t k2 = 0;
@@ -150,6 +124,43 @@ Hash GenerateHash(const void* key, const int len, const uint32_t seed)
     return Hash(h1, h2);
 }
 
+Hash GenerateMurmurHash3(const void* key, const uint64 len, const uint32_t seed)
+{
+    const uint8_t * data = (const uint8_t*)key;
+    const uint64_t nblocks = len / 16;
+
+    uint64_t h1 = seed;
+    uint64_t h2 = seed;
+
+    //----------
+    // body
+
+    const uint64_t * blocks = (const uint64_t *)(data);
+
+    for(uint64_t i = 0; i < nblocks; i++)
+        MurmurBlock(h1, h2, blocks[i*2+0], blocks[i*2+1]);
+
+    //----------
+    // tail
+
+    const uint8_t * tail = (const uint8_t*)(data + nblocks*16);
+    return MurmurFinalize(h1, h2, tail, len);
+}
+
+Hash GenerateHash(const void* key, uint64 len, uint64 seed)
+{
+    return GenerateHash(DefaultHashAlgorithm, key, len, seed);
+}
+
+Hash GenerateHash(HashAlgorithm algorithm, const void* key, uint64 len, uint64 seed)
+{
+    if(algorithm == HashAlgorithm::MurmurHash3)
+        return GenerateMurmurHash3(key, len, uint32(seed));
+
+    Assert_(algorithm == HashAlgorithm::XXH3);
+    return XXH3Hash128(key, len, seed);
+}
+
 Hash CombineHashes(Hash a, Hash b)
 {
     Hash c;
@@ -158,4 +169,199 @@ Hash CombineHashes(Hash a, Hash b)
     return c;
 }
 
+// == Hasher ======================================================================================
+
+Hasher::Hasher(HashAlgorithm algorithm_, uint64 seed) : algorithm(algorithm_)
+{
+    Assert_(uint64(algorithm) < uint64(HashAlgorithm::NumValues));
+    Reset(seed);
+}
+
+void Hasher::Reset(uint64 seed)
+{
+    xxh3.Reset(seed);
+    murmurH1 = uint32(seed);
+    murmurH2 = uint32(seed);
+    murmurLen = 0;
+    murmurTailSize = 0;
+}
+
+void Hasher::Update(const void* data, uint64 len)
+{
+    if(algorithm == HashAlgorithm::XXH3)
+    {
+        xxh3.Update(data, len);
+        return;
+    }
+
+    const uint8* bytes = reinterpret_cast<const uint8*>(data);
+    murmurLen += len;
+
+    // Complete a partial block from the last update
+    if(murmurTailSize > 0)
+    {
+        const uint64 numToCopy = std::min(16 - murmurTailSize, len);
+        memcpy(murmurTail + murmurTailSize, bytes, numToCopy);
+        murmurTailSize += numToCopy;
+        bytes += numToCopy;
+        len -= numToCopy;
+
+        if(murmurTailSize < 16)
+            return;
+
+        uint64 k[2];
+        memcpy(k, murmurTail, sizeof(k));
+        MurmurBlock(murmurH1, murmurH2, k[0], k[1]);
+        murmurTailSize = 0;
+    }
+
+    const uint64 numBlocks = len / 16;
+    for(uint64 i = 0; i < numBlocks; ++i)
+    {
+        uint64 k[2];
+        memcpy(k, bytes + i * 16, sizeof(k));
+        MurmurBlock(murmurH1, murmurH2, k[0], k[1]);
+    }
+
+    murmurTailSize = len - numBlocks * 16;
+    memcpy(murmurTail, bytes + numBlocks * 16, murmurTailSize);
+}
+
+Hash Hasher::Finalize() const
+{
+    if(algorithm == HashAlgorithm::XXH3)
+        return xxh3.Finalize();
+
+    return MurmurFinalize(murmurH1, murmurH2, murmurTail, murmurLen);
+}
+
+// == File hashing ================================================================================
+
+// Views need to start on a multiple of the allocation granularity (64KB)
+static const uint64 FileHashViewSize = 64 * 1024 * 1024;
+
+Hash GenerateFileHash(const wchar* filePath, HashAlgorithm algorithm)
+{
+    HANDLE fileHandle = CreateFile(filePath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(fileHandle == INVALID_HANDLE_VALUE)
+    {
+        std::wstring errPrefix = std::wstring(L"Failed to open file ") + filePath + L":\n";
+        throw Win32Exception(GetLastError(), errPrefix.c_str());
+    }
+
+    LARGE_INTEGER fileSize = { };
+    Win32Call(GetFileSizeEx(fileHandle, &fileSize));
+
+    Hasher hasher(algorithm);
+
+    // Empty files can't be mapped
+    if(fileSize.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMapping(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mapping == NULL)
+        {
+            const DWORD error = GetLastError();
+            CloseHandle(fileHandle);
+            throw Win32Exception(error, (std::wstring(L"Failed to map file ") + filePath + L":\n").c_str());
+        }
+
+        const uint64 totalSize = uint64(fileSize.QuadPart);
+        for(uint64 offset = 0; offset < totalSize; offset += FileHashViewSize)
+        {
+            const uint64 viewSize = std::min(FileHashViewSize, totalSize - offset);
+            const void* view = MapViewOfFile(mapping, FILE_MAP_READ, DWORD(offset >> 32), DWORD(offset & 0xFFFFFFFF), SIZE_T(viewSize));
+            if(view == nullptr)
+            {
+                const DWORD error = GetLastError();
+                CloseHandle(mapping);
+                CloseHandle(fileHandle);
+                throw Win32Exception(error, (std::wstring(L"Failed to map a view of file ") + filePath + L":\n").c_str());
+            }
+
+            hasher.Update(view, viewSize);
+            UnmapViewOfFile(view);
+        }
+
+        CloseHandle(mapping);
+    }
+
+    CloseHandle(fileHandle);
+
+    return hasher.Finalize();
+}
+
+// == Benchmark ===================================================================================
+
+bool BenchmarkHashing(uint64 maxSize)
+{
+    static const wchar* AlgorithmNames[] = { L"MurmurHash3", L"XXH3" };
+    StaticAssert_(ArraySize_(AlgorithmNames) == uint64(HashAlgorithm::NumValues));
+
+    // Inputs that are larger than the source buffer are fed through the streaming hasher in pieces,
+    // so that a 4GB run doesn't need 4GB of memory
+    const uint64 bufferSize = std::min<uint64>(maxSize, 256 * 1024 * 1024);
+    Array<uint8> buffer(bufferSize);
+    uint64 state = 0x9E3779B97F4A7C15ull;
+    for(uint64 i = 0; i < bufferSize / sizeof(uint64); ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        reinterpret_cast<uint64*>(buffer.Data())[i] = state;
+    }
+
+    WriteLog("Hashing benchmark (up to %.2fGB)", maxSize / (1024.0 * 1024.0 * 1024.0));
+
+    bool hashesMatch = true;
+
+    for(uint64 size = 1024 * 1024; size <= maxSize; size *= 4)
+    {
+        for(uint64 algIdx = 0; algIdx < uint64(HashAlgorithm::NumValues); ++algIdx)
+        {
+            const HashAlgorithm algorithm = HashAlgorithm(algIdx);
+
+            double oneShotMS = 0.0;
+            Hash oneShotHash;
+            if(size <= bufferSize)
+            {
+                Timer timer;
+                oneShotHash = GenerateHash(algorithm, buffer.Data(), size);
+                timer.Update();
+                oneShotMS = timer.ElapsedMillisecondsD();
+            }
+
+            // Odd-sized pieces, to make sure that the partial-block paths get exercised
+            Timer timer;
+            Hasher hasher(algorithm);
+            const uint64 pieceSize = std::min<uint64>(bufferSize, 1024 * 1024 + 7);
+            for(uint64 offset = 0; offset < size;)
+            {
+                const uint64 start = offset % bufferSize;
+                const uint64 len = std::min(std::min(pieceSize, size - offset), bufferSize - start);
+                hasher.Update(buffer.Data() + start, len);
+                offset += len;
+            }
+            const Hash streamingHash = hasher.Finalize();
+            timer.Update();
+            const double streamingMS = timer.ElapsedMillisecondsD();
+
+            const double sizeGB = size / (1024.0 * 1024.0 * 1024.0);
+            if(size <= bufferSize)
+            {
+                hashesMatch = hashesMatch && (streamingHash == oneShotHash);
+                WriteLog("    %ls, %.1fMB: one-shot %.2fGB/s, streaming %.2fGB/s%ls", AlgorithmNames[algIdx], size / (1024.0 * 1024.0),
+                         sizeGB / (oneShotMS / 1000.0), sizeGB / (streamingMS / 1000.0),
+                         streamingHash == oneShotHash ? L"" : L" (MISMATCH)");
+            }
+            else
+            {
+                WriteLog("    %ls, %.1fMB: streaming %.2fGB/s", AlgorithmNames[algIdx], size / (1024.0 * 1024.0),
+                         sizeGB / (streamingMS / 1000.0));
+            }
+        }
+    }
+
+    return hashesMatch;
+}
+
 }
\ No newline at end of file
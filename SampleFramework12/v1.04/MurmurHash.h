@@ -10,6 +10,7 @@
 #pragma once
 
 #include "PCH.h"
+#include "XXHash.h"
 
 namespace SampleFramework12
 {
@@ -30,7 +31,54 @@ inline bool operator==(const Hash& a, const Hash& b)
     return a.A == b.A && a.B == b.B;
 }
 
-Hash GenerateHash(const void* key, int32 len, uint32 seed = 0);
+enum class HashAlgorithm : uint32
+{
+    MurmurHash3 = 0,
+    XXH3,
+
+    NumValues
+};
+
+// Used by GenerateHash(), the streaming Hasher, and everything that builds cache keys
+static const HashAlgorithm DefaultHashAlgorithm = HashAlgorithm::XXH3;
+
+Hash GenerateHash(const void* key, uint64 len, uint64 seed = 0);
+Hash GenerateHash(HashAlgorithm algorithm, const void* key, uint64 len, uint64 seed = 0);
+Hash GenerateMurmurHash3(const void* key, uint64 len, uint32 seed = 0);
 Hash CombineHashes(Hash a, Hash b);
 
+// Incremental hashing, which gives the same result as calling GenerateHash() on all of the data at once
+class Hasher
+{
+
+public:
+
+    explicit Hasher(HashAlgorithm algorithm = DefaultHashAlgorithm, uint64 seed = 0);
+
+    void Reset(uint64 seed = 0);
+    void Update(const void* data, uint64 len);
+    Hash Finalize() const;
+
+    HashAlgorithm Algorithm() const { return algorithm; }
+
+protected:
+
+    HashAlgorithm algorithm = DefaultHashAlgorithm;
+    XXH3Hasher xxh3;
+
+    // MurmurHash3 state
+    uint64 murmurH1 = 0;
+    uint64 murmurH2 = 0;
+    uint64 murmurLen = 0;
+    uint8 murmurTail[16] = { };
+    uint64 murmurTailSize = 0;
+};
+
+// Hashes a file through a series of memory-mapped views, so that it never needs to be read into memory in one piece
+Hash GenerateFileHash(const wchar* filePath, HashAlgorithm algorithm = DefaultHashAlgorithm);
+
+// Logs the throughput of each algorithm for inputs from 1MB up to maxSize, for both one-shot and streaming hashing.
+// Returns false if the streaming and one-shot hashes don't match.
+bool BenchmarkHashing(uint64 maxSize = 4ull * 1024 * 1024 * 1024);
+
 }
\ No newline at end of file
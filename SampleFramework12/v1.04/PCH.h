@@ -117,6 +117,8 @@ typedef uint32_t bool32;
 #include <string>
 #include <cmath>
 #include <random>
+#include <unordered_map>
+#include <algorithm>
 
 // Assimp
 #include "..\\..\\Externals\\Assimp-5.2.4\\include\\assimp\\Importer.hpp"
@@ -10,6 +10,19 @@
 #include "PCH.h"
 #include "SF12_Math.h"
 #include "Utility.h"
+#include "Timer.h"
+
+// The batch functions have an 8-wide AVX2 path that gets picked at runtime with a CPUID check. MSVC allows AVX
+// intrinsics without /arch:AVX2, but other compilers need AVX2 enabled for the whole file to get the path.
+#if defined(_XM_SSE_INTRINSICS_) && ((defined(_MSC_VER) && !defined(__clang__)) || defined(__AVX2__))
+    #define UseAVX2BatchMath_ 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#else
+    #define UseAVX2BatchMath_ 0
+#endif
 
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -1290,6 +1303,20 @@ void Random::SeedWithRandomValue()
     c = device() % 698769068 + 1;
 }
 
+// Puts the generator into a state that only depends on seed, so that the same sequence can be generated again
+void Random::SeedWithValue(uint32 seed)
+{
+    x = 123456789 ^ seed;
+    y = 987654321 ^ (seed * 2654435761u);
+    if(y == 0)
+        y = 987654321;
+    z = 43219876 + seed;
+    c = 6543217;
+
+    // Mix the seed into all of the state before handing out any numbers
+    Roll(16);
+}
+
 uint32 Random::RandomUint()
 {
     x = 314527869 * x + 1234567;
@@ -1313,4 +1340,819 @@ Float2 Random::RandomFloat2()
     return Float2(RandomFloat(), RandomFloat());
 }
 
+// == Batch operations ============================================================================
+
+// Loads 4 consecutive Float3s and transposes them, so that each register holds one component of all 4
+static void LoadFloat3x4(const Float3* src, XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+{
+    // a = (x0, y0, z0, x1), b = (y1, z1, x2, y2), c = (z2, x3, y3, z3)
+    const float* f = reinterpret_cast<const float*>(src);
+    const XMVECTOR a = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(f + 0));
+    const XMVECTOR b = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(f + 4));
+    const XMVECTOR c = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(f + 8));
+
+    const XMVECTOR x2y2x3y3 = XMVectorPermute<2, 3, 5, 6>(b, c);
+    const XMVECTOR y0z0y1z1 = XMVectorPermute<1, 2, 4, 5>(a, b);
+    x = XMVectorPermute<0, 3, 4, 6>(a, x2y2x3y3);
+    y = XMVectorPermute<0, 2, 5, 7>(y0z0y1z1, x2y2x3y3);
+    z = XMVectorPermute<1, 3, 4, 7>(y0z0y1z1, c);
+}
+
+static void StoreFloat3x4(Float3* dst, FXMVECTOR x, FXMVECTOR y, FXMVECTOR z)
+{
+    const XMVECTOR x0y0x1y1 = XMVectorMergeXY(x, y);
+    const XMVECTOR y1z1y2z2 = XMVectorPermute<1, 5, 2, 6>(y, z);
+    const XMVECTOR x3y3x2y2 = XMVectorPermute<3, 7, 2, 6>(x, y);
+
+    float* f = reinterpret_cast<float*>(dst);
+    XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(f + 0), XMVectorPermute<0, 1, 4, 2>(x0y0x1y1, z));
+    XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(f + 4), XMVectorPermute<0, 1, 6, 2>(y1z1y2z2, x));
+    XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(f + 8), XMVectorPermute<6, 0, 1, 7>(x3y3x2y2, z));
+}
+
+// Every element of a matrix splatted across a register, for transforming SoA data
+struct SoAMatrix
+{
+    XMVECTOR E[4][4];
+
+    explicit SoAMatrix(const Float4x4& m)
+    {
+        const float* elements = &m._11;
+        for(uint64 r = 0; r < 4; ++r)
+            for(uint64 c = 0; c < 4; ++c)
+                E[r][c] = XMVectorReplicate(elements[r * 4 + c]);
+    }
+};
+
+#if UseAVX2BatchMath_
+
+// AVX2 and FMA both need to be there, along with the OS saving the upper halves of the YMM registers
+static bool CPUSupportsAVX2()
+{
+    #if defined(__AVX2__)
+        return true;
+    #else
+        int32 info[4] = { };
+        __cpuid(info, 0);
+        if(info[0] < 7)
+            return false;
+
+        __cpuid(info, 1);
+        const bool fma = (info[2] & (1 << 12)) != 0;
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        if(fma == false || osxsave == false || avx == false || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    #endif
+}
+
+static bool UseAVX2Path()
+{
+    static const bool supported = CPUSupportsAVX2();
+    return supported;
+}
+
+// The AVX2 path puts points 0-3 in the low half of each register and 4-7 in the high half, which lets it use
+// the same in-lane shuffles as the 4-wide path
+static void LoadFloat3x8(const Float3* src, __m256& x, __m256& y, __m256& z)
+{
+    const float* f = reinterpret_cast<const float*>(src);
+    const __m256 a = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f + 0)), _mm_loadu_ps(f + 12), 1);
+    const __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f + 4)), _mm_loadu_ps(f + 16), 1);
+    const __m256 c = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f + 8)), _mm_loadu_ps(f + 20), 1);
+
+    const __m256 x2y2x3y3 = _mm256_shuffle_ps(b, c, _MM_SHUFFLE(2, 1, 3, 2));
+    const __m256 y0z0y1z1 = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(1, 0, 2, 1));
+    x = _mm256_shuffle_ps(a, x2y2x3y3, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm256_shuffle_ps(y0z0y1z1, x2y2x3y3, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm256_shuffle_ps(y0z0y1z1, c, _MM_SHUFFLE(3, 0, 3, 1));
+}
+
+static void StoreFloat3x8(Float3* dst, __m256 x, __m256 y, __m256 z)
+{
+    const __m256 a = _mm256_shuffle_ps(_mm256_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)),
+                                       _mm256_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+    const __m256 b = _mm256_shuffle_ps(_mm256_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)),
+                                       _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+    const __m256 c = _mm256_shuffle_ps(_mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)),
+                                       _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+
+    float* f = reinterpret_cast<float*>(dst);
+    _mm_storeu_ps(f + 0, _mm256_castps256_ps128(a));
+    _mm_storeu_ps(f + 4, _mm256_castps256_ps128(b));
+    _mm_storeu_ps(f + 8, _mm256_castps256_ps128(c));
+    _mm_storeu_ps(f + 12, _mm256_extractf128_ps(a, 1));
+    _mm_storeu_ps(f + 16, _mm256_extractf128_ps(b, 1));
+    _mm_storeu_ps(f + 20, _mm256_extractf128_ps(c, 1));
+}
+
+// Transposes the 4x4 block in each half of the registers, which converts 8 Float4s from AoS to SoA and back
+static void Transpose4x4x2(__m256& r0, __m256& r1, __m256& r2, __m256& r3)
+{
+    const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+    const __m256 t1 = _mm256_unpackhi_ps(r0, r1);
+    const __m256 t2 = _mm256_unpacklo_ps(r2, r3);
+    const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+    r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+    r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+    r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+    r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+static __m256 LoadFloat4x2(const Float4* lo, const Float4* hi)
+{
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&lo->x)), _mm_loadu_ps(&hi->x), 1);
+}
+
+static void StoreFloat4x2(Float4* lo, Float4* hi, __m256 v)
+{
+    _mm_storeu_ps(&lo->x, _mm256_castps256_ps128(v));
+    _mm_storeu_ps(&hi->x, _mm256_extractf128_ps(v, 1));
+}
+
+static float HorizontalMin8(__m256 v)
+{
+    __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+    return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+
+static float HorizontalMax8(__m256 v)
+{
+    __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+    return _mm_cvtss_f32(_mm_max_ss(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+
+struct SoAMatrix8
+{
+    __m256 E[4][4];
+
+    explicit SoAMatrix8(const Float4x4& m)
+    {
+        const float* elements = &m._11;
+        for(uint64 r = 0; r < 4; ++r)
+            for(uint64 c = 0; c < 4; ++c)
+                E[r][c] = _mm256_set1_ps(elements[r * 4 + c]);
+    }
+};
+
+// The 8-wide versions of the batch functions below. They only handle whole groups of 8 and return how many values
+// they processed, leaving the rest for the 4-wide versions. Each one ends with a vzeroupper, since the code that
+// runs after it isn't compiled with VEX encoding and would otherwise pay for the transition.
+static uint64 TransformPoints8(const Float3* points, Float3* output, uint64 count, const Float4x4& m)
+{
+    const SoAMatrix8 m8(m);
+    uint64 i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z;
+        LoadFloat3x8(points + i, x, y, z);
+
+        __m256 r[4];
+        for(uint64 c = 0; c < 4; ++c)
+            r[c] = _mm256_fmadd_ps(x, m8.E[0][c], _mm256_fmadd_ps(y, m8.E[1][c], _mm256_fmadd_ps(z, m8.E[2][c], m8.E[3][c])));
+
+        StoreFloat3x8(output + i, _mm256_div_ps(r[0], r[3]), _mm256_div_ps(r[1], r[3]), _mm256_div_ps(r[2], r[3]));
+    }
+
+    _mm256_zeroupper();
+    return i;
+}
+
+static uint64 TransformDirections8(const Float3* directions, Float3* output, uint64 count, const Float4x4& m)
+{
+    const SoAMatrix8 m8(m);
+    uint64 i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z;
+        LoadFloat3x8(directions + i, x, y, z);
+
+        __m256 r[3];
+        for(uint64 c = 0; c < 3; ++c)
+            r[c] = _mm256_fmadd_ps(x, m8.E[0][c], _mm256_fmadd_ps(y, m8.E[1][c], _mm256_mul_ps(z, m8.E[2][c])));
+
+        StoreFloat3x8(output + i, r[0], r[1], r[2]);
+    }
+
+    _mm256_zeroupper();
+    return i;
+}
+
+static uint64 TransformVectors8(const Float4* vectors, Float4* output, uint64 count, const Float4x4& m)
+{
+    const SoAMatrix8 m8(m);
+    uint64 i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x = LoadFloat4x2(vectors + i + 0, vectors + i + 4);
+        __m256 y = LoadFloat4x2(vectors + i + 1, vectors + i + 5);
+        __m256 z = LoadFloat4x2(vectors + i + 2, vectors + i + 6);
+        __m256 w = LoadFloat4x2(vectors + i + 3, vectors + i + 7);
+        Transpose4x4x2(x, y, z, w);
+
+        __m256 r[4];
+        for(uint64 c = 0; c < 4; ++c)
+            r[c] = _mm256_fmadd_ps(x, m8.E[0][c], _mm256_fmadd_ps(y, m8.E[1][c], _mm256_fmadd_ps(z, m8.E[2][c], _mm256_mul_ps(w, m8.E[3][c]))));
+
+        Transpose4x4x2(r[0], r[1], r[2], r[3]);
+        for(uint64 v = 0; v < 4; ++v)
+            StoreFloat4x2(output + i + v, output + i + v + 4, r[v]);
+    }
+
+    _mm256_zeroupper();
+    return i;
+}
+
+static uint64 NormalizeVectors8(const Float3* vectors, Float3* output, uint64 count)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 infinity = _mm256_set1_ps(FloatInfinity);
+    const __m256 qnan = _mm256_set1_ps(std::numeric_limits<float>::quiet_NaN());
+    uint64 i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z;
+        LoadFloat3x8(vectors + i, x, y, z);
+
+        const __m256 lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z));
+        const __m256 length = _mm256_sqrt_ps(lengthSq);
+        const __m256 nonZero = _mm256_cmp_ps(length, zero, _CMP_NEQ_UQ);
+        const __m256 notInfinite = _mm256_cmp_ps(lengthSq, infinity, _CMP_NEQ_UQ);
+
+        __m256 r[3] = { x, y, z };
+        for(uint64 c = 0; c < 3; ++c)
+            r[c] = _mm256_blendv_ps(qnan, _mm256_and_ps(_mm256_div_ps(r[c], length), nonZero), notInfinite);
+
+        StoreFloat3x8(output + i, r[0], r[1], r[2]);
+    }
+
+    _mm256_zeroupper();
+    return i;
+}
+
+// Two rows of the result per register, with each row of b broadcast to both halves
+static uint64 MultiplyMatrices8(const Float4x4* a, const Float4x4* b, Float4x4* output, uint64 count)
+{
+    for(uint64 i = 0; i < count; ++i)
+    {
+        const __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b[i]._11));
+        const __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b[i]._21));
+        const __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b[i]._31));
+        const __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(&b[i]._41));
+
+        __m256 rows[2] = { _mm256_loadu_ps(&a[i]._11), _mm256_loadu_ps(&a[i]._31) };
+        for(uint64 r = 0; r < 2; ++r)
+        {
+            __m256 x = _mm256_mul_ps(_mm256_permute_ps(rows[r], _MM_SHUFFLE(0, 0, 0, 0)), b0);
+            __m256 y = _mm256_mul_ps(_mm256_permute_ps(rows[r], _MM_SHUFFLE(1, 1, 1, 1)), b1);
+            x = _mm256_fmadd_ps(_mm256_permute_ps(rows[r], _MM_SHUFFLE(2, 2, 2, 2)), b2, x);
+            y = _mm256_fmadd_ps(_mm256_permute_ps(rows[r], _MM_SHUFFLE(3, 3, 3, 3)), b3, y);
+            rows[r] = _mm256_add_ps(x, y);
+        }
+
+        _mm256_storeu_ps(&output[i]._11, rows[0]);
+        _mm256_storeu_ps(&output[i]._31, rows[1]);
+    }
+
+    _mm256_zeroupper();
+    return count;
+}
+
+// Only for tightly packed points
+static uint64 ComputeBounds8(const Float3* points, uint64 count, Float3& minOut, Float3& maxOut)
+{
+    __m256 minX = _mm256_set1_ps(FloatMax), minY = minX, minZ = minX;
+    __m256 maxX = _mm256_set1_ps(-FloatMax), maxY = maxX, maxZ = maxX;
+    uint64 i = 0;
+    for(; i + 8 <= count; i += 8)
+    {
+        __m256 x, y, z;
+        LoadFloat3x8(points + i, x, y, z);
+        minX = _mm256_min_ps(minX, x);
+        minY = _mm256_min_ps(minY, y);
+        minZ = _mm256_min_ps(minZ, z);
+        maxX = _mm256_max_ps(maxX, x);
+        maxY = _mm256_max_ps(maxY, y);
+        maxZ = _mm256_max_ps(maxZ, z);
+    }
+
+    minOut = Float3(HorizontalMin8(minX), HorizontalMin8(minY), HorizontalMin8(minZ));
+    maxOut = Float3(HorizontalMax8(maxX), HorizontalMax8(maxY), HorizontalMax8(maxZ));
+
+    _mm256_zeroupper();
+    return i;
+}
+
+#endif
+
+// The 4-wide versions go through DirectXMath. The multiply-adds are ordered the same way as
+// XMVector3TransformCoord/XMVector3TransformNormal/XMVector4Transform, which is what keeps the results identical
+// to the per-value versions.
+static void TransformPoints4(const Float3* points, Float3* output, uint64 count, const Float4x4& m)
+{
+    const SoAMatrix m4(m);
+    uint64 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        XMVECTOR x, y, z;
+        LoadFloat3x4(points + i, x, y, z);
+
+        XMVECTOR r[4];
+        for(uint64 c = 0; c < 4; ++c)
+            r[c] = XMVectorMultiplyAdd(x, m4.E[0][c], XMVectorMultiplyAdd(y, m4.E[1][c], XMVectorMultiplyAdd(z, m4.E[2][c], m4.E[3][c])));
+
+        StoreFloat3x4(output + i, XMVectorDivide(r[0], r[3]), XMVectorDivide(r[1], r[3]), XMVectorDivide(r[2], r[3]));
+    }
+
+    for(; i < count; ++i)
+        output[i] = Float3::Transform(points[i], m);
+}
+
+static void TransformDirections4(const Float3* directions, Float3* output, uint64 count, const Float4x4& m)
+{
+    const SoAMatrix m4(m);
+    uint64 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        XMVECTOR x, y, z;
+        LoadFloat3x4(directions + i, x, y, z);
+
+        XMVECTOR r[3];
+        for(uint64 c = 0; c < 3; ++c)
+            r[c] = XMVectorMultiplyAdd(x, m4.E[0][c], XMVectorMultiplyAdd(y, m4.E[1][c], XMVectorMultiply(z, m4.E[2][c])));
+
+        StoreFloat3x4(output + i, r[0], r[1], r[2]);
+    }
+
+    for(; i < count; ++i)
+        output[i] = Float3::TransformDirection(directions[i], m);
+}
+
+static void TransformVectors4(const Float4* vectors, Float4* output, uint64 count, const Float4x4& m)
+{
+    const SoAMatrix m4(m);
+    uint64 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        const XMMATRIX soa = XMMatrixTranspose(XMMATRIX(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(vectors + i + 0)),
+                                                        XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(vectors + i + 1)),
+                                                        XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(vectors + i + 2)),
+                                                        XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(vectors + i + 3))));
+
+        XMMATRIX r;
+        for(uint64 c = 0; c < 4; ++c)
+            r.r[c] = XMVectorMultiplyAdd(soa.r[0], m4.E[0][c], XMVectorMultiplyAdd(soa.r[1], m4.E[1][c],
+                     XMVectorMultiplyAdd(soa.r[2], m4.E[2][c], XMVectorMultiply(soa.r[3], m4.E[3][c]))));
+
+        r = XMMatrixTranspose(r);
+        for(uint64 v = 0; v < 4; ++v)
+            XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(output + i + v), r.r[v]);
+    }
+
+    for(; i < count; ++i)
+        output[i] = Float4::Transform(vectors[i], m);
+}
+
+// Matches XMVector3Normalize: zero-length vectors come out as zero, and infinite-length vectors as NaN
+static void NormalizeVectors4(const Float3* vectors, Float3* output, uint64 count)
+{
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR infinity = XMVectorSplatInfinity();
+    const XMVECTOR qnan = XMVectorSplatQNaN();
+    uint64 i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        XMVECTOR x, y, z;
+        LoadFloat3x4(vectors + i, x, y, z);
+
+        const XMVECTOR lengthSq = XMVectorAdd(XMVectorAdd(XMVectorMultiply(x, x), XMVectorMultiply(y, y)), XMVectorMultiply(z, z));
+        const XMVECTOR length = XMVectorSqrt(lengthSq);
+        const XMVECTOR nonZero = XMVectorNotEqual(length, zero);
+        const XMVECTOR notInfinite = XMVectorNotEqual(lengthSq, infinity);
+
+        XMVECTOR r[3] = { x, y, z };
+        for(uint64 c = 0; c < 3; ++c)
+            r[c] = XMVectorSelect(qnan, XMVectorAndInt(XMVectorDivide(r[c], length), nonZero), notInfinite);
+
+        StoreFloat3x4(output + i, r[0], r[1], r[2]);
+    }
+
+    for(; i < count; ++i)
+        output[i] = Float3::Normalize(vectors[i]);
+}
+
+// XMMatrixMultiply already works on whole rows, so there's nothing to gain from transposing here
+static void MultiplyMatrices4(const Float4x4* a, const Float4x4* b, Float4x4* output, uint64 count)
+{
+    for(uint64 i = 0; i < count; ++i)
+    {
+        const XMMATRIX result = XMMatrixMultiply(XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(a + i)),
+                                                 XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(b + i)));
+        XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(output + i), result);
+    }
+}
+
+static void ComputeBounds4(const Float3* points, uint64 count, uint64 stride, Float3& minOut, Float3& maxOut)
+{
+    XMVECTOR minVec = XMVectorReplicate(FloatMax);
+    XMVECTOR maxVec = XMVectorReplicate(-FloatMax);
+    uint64 i = 0;
+
+    if(stride == sizeof(Float3))
+    {
+        // Tightly packed, so the points can be transposed and each component gets its own min/max
+        XMVECTOR minX = minVec, minY = minVec, minZ = minVec;
+        XMVECTOR maxX = maxVec, maxY = maxVec, maxZ = maxVec;
+        for(; i + 4 <= count; i += 4)
+        {
+            XMVECTOR x, y, z;
+            LoadFloat3x4(points + i, x, y, z);
+            minX = XMVectorMin(minX, x);
+            minY = XMVectorMin(minY, y);
+            minZ = XMVectorMin(minZ, z);
+            maxX = XMVectorMax(maxX, x);
+            maxY = XMVectorMax(maxY, y);
+            maxZ = XMVectorMax(maxZ, z);
+        }
+
+        // Transposing back leaves one point per register, which reduces the same way as the AoS path below
+        XMMATRIX mins = XMMatrixTranspose(XMMATRIX(minX, minY, minZ, XMVectorZero()));
+        XMMATRIX maxs = XMMatrixTranspose(XMMATRIX(maxX, maxY, maxZ, XMVectorZero()));
+        minVec = XMVectorMin(XMVectorMin(mins.r[0], mins.r[1]), XMVectorMin(mins.r[2], mins.r[3]));
+        maxVec = XMVectorMax(XMVectorMax(maxs.r[0], maxs.r[1]), XMVectorMax(maxs.r[2], maxs.r[3]));
+    }
+    else
+    {
+        // Interleaved with other data, so stick with AoS but use 4 independent min/max chains
+        const uint8* bytes = reinterpret_cast<const uint8*>(points);
+        XMVECTOR mins[4] = { minVec, minVec, minVec, minVec };
+        XMVECTOR maxs[4] = { maxVec, maxVec, maxVec, maxVec };
+        for(; i + 4 <= count; i += 4)
+        {
+            for(uint64 j = 0; j < 4; ++j)
+            {
+                const XMVECTOR p = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(bytes + (i + j) * stride));
+                mins[j] = XMVectorMin(mins[j], p);
+                maxs[j] = XMVectorMax(maxs[j], p);
+            }
+        }
+
+        minVec = XMVectorMin(XMVectorMin(mins[0], mins[1]), XMVectorMin(mins[2], mins[3]));
+        maxVec = XMVectorMax(XMVectorMax(maxs[0], maxs[1]), XMVectorMax(maxs[2], maxs[3]));
+    }
+
+    const uint8* bytes = reinterpret_cast<const uint8*>(points);
+    for(; i < count; ++i)
+    {
+        const XMVECTOR p = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(bytes + i * stride));
+        minVec = XMVectorMin(minVec, p);
+        maxVec = XMVectorMax(maxVec, p);
+    }
+
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&minOut), minVec);
+    XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&maxOut), maxVec);
+}
+
+// The public versions run the AVX2 path over as much as they can when the CPU supports it, and hand whatever
+// is left over to the 4-wide path
+void TransformPoints(const Float3* points, Float3* output, uint64 count, const Float4x4& m)
+{
+    Assert_(count == 0 || (points != nullptr && output != nullptr));
+
+    uint64 i = 0;
+    #if UseAVX2BatchMath_
+        if(UseAVX2Path())
+            i = TransformPoints8(points, output, count, m);
+    #endif
+
+    TransformPoints4(points + i, output + i, count - i, m);
+}
+
+void TransformDirections(const Float3* directions, Float3* output, uint64 count, const Float4x4& m)
+{
+    Assert_(count == 0 || (directions != nullptr && output != nullptr));
+
+    uint64 i = 0;
+    #if UseAVX2BatchMath_
+        if(UseAVX2Path())
+            i = TransformDirections8(directions, output, count, m);
+    #endif
+
+    TransformDirections4(directions + i, output + i, count - i, m);
+}
+
+void TransformVectors(const Float4* vectors, Float4* output, uint64 count, const Float4x4& m)
+{
+    Assert_(count == 0 || (vectors != nullptr && output != nullptr));
+
+    uint64 i = 0;
+    #if UseAVX2BatchMath_
+        if(UseAVX2Path())
+            i = TransformVectors8(vectors, output, count, m);
+    #endif
+
+    TransformVectors4(vectors + i, output + i, count - i, m);
+}
+
+void NormalizeVectors(const Float3* vectors, Float3* output, uint64 count)
+{
+    Assert_(count == 0 || (vectors != nullptr && output != nullptr));
+
+    uint64 i = 0;
+    #if UseAVX2BatchMath_
+        if(UseAVX2Path())
+            i = NormalizeVectors8(vectors, output, count);
+    #endif
+
+    NormalizeVectors4(vectors + i, output + i, count - i);
+}
+
+void MultiplyMatrices(const Float4x4* a, const Float4x4* b, Float4x4* output, uint64 count)
+{
+    Assert_(count == 0 || (a != nullptr && b != nullptr && output != nullptr));
+
+    uint64 i = 0;
+    #if UseAVX2BatchMath_
+        if(UseAVX2Path())
+            i = MultiplyMatrices8(a, b, output, count);
+    #endif
+
+    MultiplyMatrices4(a + i, b + i, output + i, count - i);
+}
+
+void ComputeBounds(const Float3* points, uint64 count, uint64 stride, Float3& minOut, Float3& maxOut)
+{
+    Assert_(count == 0 || points != nullptr);
+    Assert_(stride >= sizeof(Float3));
+
+    uint64 i = 0;
+    Float3 minPos = FloatMax;
+    Float3 maxPos = -FloatMax;
+    #if UseAVX2BatchMath_
+        if(UseAVX2Path() && stride == sizeof(Float3))
+            i = ComputeBounds8(points, count, minPos, maxPos);
+    #endif
+
+    ComputeBounds4(points + i, count - i, stride, minOut, maxOut);
+    minOut = Min(minOut, minPos);
+    maxOut = Max(maxOut, maxPos);
+}
+
+// Testing and benchmarking
+#if defined(_XM_NO_INTRINSICS_)
+    static const char* BatchMath4BackEnd = "scalar";
+#elif defined(_XM_ARM_NEON_INTRINSICS_)
+    static const char* BatchMath4BackEnd = "NEON";
+#else
+    static const char* BatchMath4BackEnd = "SSE";
+#endif
+
+static const char* BatchMathBackEnd()
+{
+    #if UseAVX2BatchMath_
+        if(UseAVX2Path())
+            return "AVX2";
+    #endif
+
+    return BatchMath4BackEnd;
+}
+
+static const float BatchMathMaxULPs = 4.0f;
+
+// The error is measured in ULPs of the largest component of the expected value, since cancellation can leave
+// small components with much less precision than their own magnitude would suggest
+template<typename T> static float MaxULPError(const T* values, const T* expected, uint64 count)
+{
+    const uint64 numComponents = sizeof(T) / sizeof(float);
+
+    float maxError = 0.0f;
+    for(uint64 i = 0; i < count; ++i)
+    {
+        const float* v = reinterpret_cast<const float*>(values + i);
+        const float* e = reinterpret_cast<const float*>(expected + i);
+
+        float scale = std::numeric_limits<float>::min();
+        for(uint64 c = 0; c < numComponents; ++c)
+            scale = std::isfinite(e[c]) ? Max(scale, std::abs(e[c])) : scale;
+        const float ulp = std::nextafter(scale, FloatInfinity) - scale;
+
+        for(uint64 c = 0; c < numComponents; ++c)
+        {
+            float error = 0.0f;
+            if(std::isnan(v[c]) || std::isnan(e[c]))
+                error = std::isnan(v[c]) && std::isnan(e[c]) ? 0.0f : FloatInfinity;
+            else if(v[c] != e[c])
+                error = std::abs(v[c] - e[c]) / ulp;
+            maxError = Max(maxError, error);
+        }
+    }
+
+    return maxError;
+}
+
+bool ValidateBatchMath(uint64 numValues)
+{
+    Random rng;
+    auto randomFloat = [&rng](float minVal, float maxVal) { return minVal + rng.RandomFloat() * (maxVal - minVal); };
+
+    const Float4x4 affine = Float4x4::ScaleMatrix(Float3(1.5f, 0.75f, 2.0f)) * Float4x4::RotationEuler(0.3f, 1.1f, -0.6f) *
+                            Float4x4::TranslationMatrix(Float3(10.0f, -4.0f, 25.0f));
+    const Float4x4 projection = Float4x4(XMMatrixPerspectiveFovLH(Pi_4, 16.0f / 9.0f, 0.1f, 100.0f));
+
+    // Points in front of the projection's near clip plane, so that w never gets close to 0
+    std::vector<Float3> points(numValues);
+    std::vector<Float3> vectors(numValues);
+    std::vector<Float4> vectors4(numValues);
+    std::vector<Float4x4> matricesA(numValues);
+    std::vector<Float4x4> matricesB(numValues);
+    for(uint64 i = 0; i < numValues; ++i)
+    {
+        points[i] = Float3(randomFloat(-50.0f, 50.0f), randomFloat(-50.0f, 50.0f), randomFloat(1.0f, 100.0f));
+        vectors[i] = Float3(randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f));
+        vectors4[i] = Float4(randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f));
+
+        float* a = &matricesA[i]._11;
+        float* b = &matricesB[i]._11;
+        for(uint64 e = 0; e < 16; ++e)
+        {
+            a[e] = randomFloat(-2.0f, 2.0f);
+            b[e] = randomFloat(-2.0f, 2.0f);
+        }
+    }
+
+    // Make sure that the special cases for normalizing get hit
+    if(numValues > 1)
+    {
+        vectors[0] = Float3(0.0f, 0.0f, 0.0f);
+        vectors[1] = Float3(FloatInfinity, 1.0f, 0.0f);
+    }
+
+    // Min/max doesn't round, so the bounds need to match exactly. The strided version reads the xyz of each Float4.
+    Float3 expectedMin = FloatMax;
+    Float3 expectedMax = -FloatMax;
+    Float3 expectedMin4 = FloatMax;
+    Float3 expectedMax4 = -FloatMax;
+    for(uint64 i = 0; i < numValues; ++i)
+    {
+        expectedMin = Min(expectedMin, points[i]);
+        expectedMax = Max(expectedMax, points[i]);
+        expectedMin4 = Min(expectedMin4, vectors4[i].To3D());
+        expectedMax4 = Max(expectedMax4, vectors4[i].To3D());
+    }
+
+    std::vector<Float3> expectedTransformed(numValues);
+    std::vector<Float3> expectedProjected(numValues);
+    std::vector<Float3> expectedDirections(numValues);
+    std::vector<Float3> expectedNormalized(numValues);
+    std::vector<Float4> expected4(numValues);
+    std::vector<Float4x4> expected4x4(numValues);
+    for(uint64 i = 0; i < numValues; ++i)
+    {
+        expectedTransformed[i] = Float3::Transform(points[i], affine);
+        expectedProjected[i] = Float3::Transform(points[i], projection);
+        expectedDirections[i] = Float3::TransformDirection(vectors[i], affine);
+        expectedNormalized[i] = Float3::Normalize(vectors[i]);
+        expected4[i] = Float4::Transform(vectors4[i], projection);
+        expected4x4[i] = matricesA[i] * matricesB[i];
+    }
+
+    bool passed = true;
+
+    // The 4-wide functions get checked directly, and then through the public functions when those use the AVX2 path
+    auto validate = [&](const char* backEnd, bool useAVX2)
+    {
+        WriteLog("Batch math validation (%llu values, %s)", numValues, backEnd);
+
+        auto check = [&passed](const char* name, float maxError)
+        {
+            WriteLog("    %s: max error of %.2f ULPs", name, maxError);
+            passed = passed && maxError <= BatchMathMaxULPs;
+        };
+
+        std::vector<Float3> output3(numValues);
+        (useAVX2 ? TransformPoints : TransformPoints4)(points.data(), output3.data(), numValues, affine);
+        check("TransformPoints (affine)", MaxULPError(output3.data(), expectedTransformed.data(), numValues));
+
+        output3 = points;
+        (useAVX2 ? TransformPoints : TransformPoints4)(output3.data(), output3.data(), numValues, projection);
+        check("TransformPoints (projection, in-place)", MaxULPError(output3.data(), expectedProjected.data(), numValues));
+
+        (useAVX2 ? TransformDirections : TransformDirections4)(vectors.data(), output3.data(), numValues, affine);
+        check("TransformDirections", MaxULPError(output3.data(), expectedDirections.data(), numValues));
+
+        (useAVX2 ? NormalizeVectors : NormalizeVectors4)(vectors.data(), output3.data(), numValues);
+        check("NormalizeVectors", MaxULPError(output3.data(), expectedNormalized.data(), numValues));
+
+        std::vector<Float4> output4(numValues);
+        (useAVX2 ? TransformVectors : TransformVectors4)(vectors4.data(), output4.data(), numValues, projection);
+        check("TransformVectors", MaxULPError(output4.data(), expected4.data(), numValues));
+
+        std::vector<Float4x4> output4x4(numValues);
+        (useAVX2 ? MultiplyMatrices : MultiplyMatrices4)(matricesA.data(), matricesB.data(), output4x4.data(), numValues);
+        check("MultiplyMatrices", MaxULPError(output4x4.data(), expected4x4.data(), numValues));
+
+        Float3 bounds[4];
+        (useAVX2 ? ComputeBounds : ComputeBounds4)(points.data(), numValues, sizeof(Float3), bounds[0], bounds[1]);
+        (useAVX2 ? ComputeBounds : ComputeBounds4)(reinterpret_cast<const Float3*>(vectors4.data()), numValues, sizeof(Float4), bounds[2], bounds[3]);
+        const Float3 expectedBounds[4] = { expectedMin, expectedMax, expectedMin4, expectedMax4 };
+        check("ComputeBounds", MaxULPError(bounds, expectedBounds, 4) > 0.0f ? FloatInfinity : 0.0f);
+    };
+
+    validate(BatchMath4BackEnd, false);
+
+    #if UseAVX2BatchMath_
+        if(UseAVX2Path())
+            validate("AVX2", true);
+        else
+            WriteLog("Skipping the AVX2 batch math validation, since the CPU doesn't support AVX2 and FMA");
+    #endif
+
+    WriteLog("Batch math validation %s", passed ? "passed" : "FAILED");
+
+    return passed;
+}
+
+// Best of a few runs, in millions of values per second
+template<typename TFunc> static double MeasureThroughput(uint64 numValues, TFunc func)
+{
+    double bestTime = std::numeric_limits<double>::max();
+    for(uint64 run = 0; run < 5; ++run)
+    {
+        Timer timer;
+        func();
+        timer.Update();
+        bestTime = Min(bestTime, timer.ElapsedSecondsD());
+    }
+
+    return double(numValues) / (Max(bestTime, 1e-9) * 1000000.0);
+}
+
+void BenchmarkBatchMath(uint64 numValues)
+{
+    Random rng;
+    const Float4x4 m = Float4x4::RotationEuler(0.3f, 1.1f, -0.6f) * Float4x4(XMMatrixPerspectiveFovLH(Pi_4, 1.5f, 0.1f, 100.0f));
+
+    std::vector<Float3> points(numValues);
+    std::vector<Float3> output3(numValues);
+    std::vector<Float4> vectors4(numValues);
+    std::vector<Float4> output4(numValues);
+    std::vector<Float4x4> matrices(numValues);
+    std::vector<Float4x4> output4x4(numValues);
+    for(uint64 i = 0; i < numValues; ++i)
+    {
+        points[i] = Float3(rng.RandomFloat(), rng.RandomFloat(), rng.RandomFloat()) * 100.0f;
+        vectors4[i] = Float4(points[i], 1.0f);
+        matrices[i] = Float4x4::RotationEuler(rng.RandomFloat(), rng.RandomFloat(), rng.RandomFloat());
+    }
+
+    WriteLog("Batch math benchmark (%llu values, %s)", numValues, BatchMathBackEnd());
+
+    auto report = [](const char* name, double batchRate, double scalarRate)
+    {
+        WriteLog("    %s: %.1fM/sec batched, %.1fM/sec per-value (%.2fx)", name, batchRate, scalarRate, batchRate / scalarRate);
+    };
+
+    report("TransformPoints",
+           MeasureThroughput(numValues, [&]() { TransformPoints(points.data(), output3.data(), numValues, m); }),
+           MeasureThroughput(numValues, [&]() { for(uint64 i = 0; i < numValues; ++i) output3[i] = Float3::Transform(points[i], m); }));
+
+    report("TransformDirections",
+           MeasureThroughput(numValues, [&]() { TransformDirections(points.data(), output3.data(), numValues, m); }),
+           MeasureThroughput(numValues, [&]() { for(uint64 i = 0; i < numValues; ++i) output3[i] = Float3::TransformDirection(points[i], m); }));
+
+    report("NormalizeVectors",
+           MeasureThroughput(numValues, [&]() { NormalizeVectors(points.data(), output3.data(), numValues); }),
+           MeasureThroughput(numValues, [&]() { for(uint64 i = 0; i < numValues; ++i) output3[i] = Float3::Normalize(points[i]); }));
+
+    report("TransformVectors",
+           MeasureThroughput(numValues, [&]() { TransformVectors(vectors4.data(), output4.data(), numValues, m); }),
+           MeasureThroughput(numValues, [&]() { for(uint64 i = 0; i < numValues; ++i) output4[i] = Float4::Transform(vectors4[i], m); }));
+
+    report("MultiplyMatrices",
+           MeasureThroughput(numValues, [&]() { MultiplyMatrices(matrices.data(), matrices.data(), output4x4.data(), numValues); }),
+           MeasureThroughput(numValues, [&]() { for(uint64 i = 0; i < numValues; ++i) output4x4[i] = matrices[i] * matrices[i]; }));
+
+    Float3 minPos, maxPos;
+    report("ComputeBounds",
+           MeasureThroughput(numValues, [&]() { ComputeBounds(points.data(), numValues, sizeof(Float3), minPos, maxPos); }),
+           MeasureThroughput(numValues, [&]()
+           {
+               minPos = FloatMax;
+               maxPos = -FloatMax;
+               for(uint64 i = 0; i < numValues; ++i)
+               {
+                   minPos = Min(minPos, points[i]);
+                   maxPos = Max(maxPos, points[i]);
+               }
+           }));
+
+    // Keeps the results from being optimized away
+    WriteLog("    (%f %f %f %f %f)", output3[numValues / 2].x, output4[numValues / 2].y, output4x4[numValues / 2]._22, minPos.x, maxPos.z);
+}
+
 }
\ No newline at end of file
@@ -517,6 +517,7 @@ public:
 
     void Roll(uint32 numRolls);
     void SeedWithRandomValue();
+    void SeedWithValue(uint32 seed);
 
     uint32 RandomUint();
     float RandomFloat();
@@ -766,4 +767,28 @@ inline Float2 CartesianToSpherical(const Float3& xyz)
     return Float2(azimuth, elevation);
 }
 
+// Batch versions of the per-value functions, for CPU loops that need to process lots of values at once. Values
+// are loaded 4 at a time and transposed to SoA form so that each component lives in its own register, which
+// avoids the splats and horizontal ops that come with processing one AoS vector at a time. The 4-wide path goes
+// through DirectXMath and so uses SSE or NEON (or scalar code with _XM_NO_INTRINSICS_), and an 8-wide AVX2 path
+// takes over when a CPUID check finds AVX2 and FMA. Results match the per-value versions to within a few ULPs
+// (exactly, unless only one of them ends up using FMA), and the input and output arrays can be the same.
+void TransformPoints(const Float3* points, Float3* output, uint64 count, const Float4x4& m);           // Float3::Transform
+void TransformDirections(const Float3* directions, Float3* output, uint64 count, const Float4x4& m);   // Float3::TransformDirection
+void TransformVectors(const Float4* vectors, Float4* output, uint64 count, const Float4x4& m);         // Float4::Transform
+void NormalizeVectors(const Float3* vectors, Float3* output, uint64 count);                            // Float3::Normalize
+void MultiplyMatrices(const Float4x4* a, const Float4x4* b, Float4x4* output, uint64 count);           // a[i] * b[i]
+
+// Computes the min and max of a set of points, where stride is the number of bytes from one point to the next
+// (so that positions can be read straight out of a vertex array). Returns FloatMax/-FloatMax when count is 0.
+void ComputeBounds(const Float3* points, uint64 count, uint64 stride, Float3& minOut, Float3& maxOut);
+
+// Checks the batch functions against the per-value versions using random inputs, logging the max error of each
+// one. The 4-wide path always gets checked, and the AVX2 path as well when the CPU supports it. The count isn't
+// a multiple of 8 by default so that the remainder handling gets covered as well.
+bool ValidateBatchMath(uint64 numValues = 1027);
+
+// Logs the throughput of each batch function, compared with calling the per-value version in a loop
+void BenchmarkBatchMath(uint64 numValues = 1024 * 1024);
+
 }
\ No newline at end of file
@@ -0,0 +1,342 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "SelfTests.h"
+#include "Exceptions.h"
+#include "Utility.h"
+#include "Timer.h"
+#include "MurmurHash.h"
+#include "SF12_Math.h"
+#include "LogRing.h"
+#include "Settings.h"
+#include "Graphics\\ShaderCompilation.h"
+#include "Graphics\\Model.h"
+#include "Graphics\\MeshOptimizer.h"
+#include "Graphics\\Meshlets.h"
+#include "Graphics\\Culling.h"
+#include "Graphics\\BVH.h"
+#include "Graphics\\SG.h"
+#include "Graphics\\Sampling.h"
+#include "Graphics\\Spectrum.h"
+#include "Graphics\\Skybox.h"
+#include "Graphics\\SH.h"
+#include "Graphics\\Textures.h"
+#include "Graphics\\BarrierTracker.h"
+#include "Graphics\\TransientResources.h"
+#include "Graphics\\DX12_PipelineCache.h"
+#include "Graphics\\GraphicsTypes.h"
+#include "Graphics\\ShadowHelper.h"
+#include "Graphics\\DX12_CmdLists.h"
+
+namespace SampleFramework12
+{
+
+struct SelfTest
+{
+    const char* Name = nullptr;
+    bool Benchmark = false;
+    bool (*Run)() = nullptr;
+};
+
+// Benchmarks that only log their timings return true, unless they also check their results
+static const SelfTest SelfTests[] =
+{
+    {
+        "ShaderCacheHits", true, []() -> bool
+        {
+            CompileOptions opts;
+            opts.Add("TGSize_", 8);
+            const std::wstring shaderPath = SampleFrameworkDir() + L"Shaders\\DecodeTextureCS.hlsl";
+            return BenchmarkShaderCacheHits(shaderPath.c_str(), "DecodeTextureCS", ShaderType::Compute, opts);
+        }
+    },
+    {
+        "PackedVertices", false, []() -> bool
+        {
+            return ValidatePackedVertices();
+        }
+    },
+    {
+        "MeshOptimizer", false, []() -> bool
+        {
+            return ValidateMeshOptimizer();
+        }
+    },
+    {
+        "MeshOptimizer", true, []() -> bool
+        {
+            return BenchmarkMeshOptimizer();
+        }
+    },
+    {
+        "Meshlets", false, []() -> bool
+        {
+            return ValidateMeshlets();
+        }
+    },
+    {
+        "Meshlets", true, []() -> bool
+        {
+            return BenchmarkMeshlets();
+        }
+    },
+    {
+        "Culling", false, []() -> bool
+        {
+            return ValidateCulling();
+        }
+    },
+    {
+        "Culling", true, []() -> bool
+        {
+            return BenchmarkCulling();
+        }
+    },
+    {
+        "BVH", false, []() -> bool
+        {
+            return ValidateBVH();
+        }
+    },
+    {
+        "BVH", true, []() -> bool
+        {
+            return BenchmarkBVH();
+        }
+    },
+    {
+        "SGProjection", false, []() -> bool
+        {
+            return ValidateSGProjection();
+        }
+    },
+    {
+        "SGSolvers", true, []() -> bool
+        {
+            BenchmarkSGSolvers();
+            return true;
+        }
+    },
+    {
+        "SampleGenerators", false, []() -> bool
+        {
+            return ValidateSampleGenerators();
+        }
+    },
+    {
+        "SampleGenerators", true, []() -> bool
+        {
+            return BenchmarkSampleGenerators();
+        }
+    },
+    {
+        "SpectrumConversion", true, []() -> bool
+        {
+            SampledSpectrum::BenchmarkConversion();
+            return true;
+        }
+    },
+#if EnableSkyModel_
+    {
+        "SkyModel", false, []() -> bool
+        {
+            return ValidateSkyModelBatch();
+        }
+    },
+    {
+        "SkyCubemap", true, []() -> bool
+        {
+            SkyCache skyCache;
+            skyCache.Init(Float3(0.3f, 0.5f, 0.2f), 1.0f, Float3(0.5f), 2.0f, false);
+            skyCache.BenchmarkCubemapGeneration();
+            skyCache.Shutdown();
+            return true;
+        }
+    },
+#endif // EnableSkyModel_
+    {
+        "SHKernels", true, []() -> bool
+        {
+            BenchmarkSHKernels();
+            return true;
+        }
+    },
+    {
+        "EXRCodec", true, []() -> bool
+        {
+            return BenchmarkEXRCodec();
+        }
+    },
+    {
+        "Hashing", true, []() -> bool
+        {
+            // The source buffer is capped at 256MB, larger sizes go through the streaming hasher
+            return BenchmarkHashing();
+        }
+    },
+    {
+        "BarrierTracker", false, []() -> bool
+        {
+            return ValidateBarrierTracker();
+        }
+    },
+    {
+        "BarrierTracker", true, []() -> bool
+        {
+            BenchmarkBarrierTracker();
+            return true;
+        }
+    },
+    {
+        "TransientResources", false, []() -> bool
+        {
+            return ValidateTransientResources();
+        }
+    },
+    {
+        "TransientResources", true, []() -> bool
+        {
+            BenchmarkTransientResources();
+            return true;
+        }
+    },
+    {
+        "PipelineStateMap", false, []() -> bool
+        {
+            return ValidatePipelineStateMap();
+        }
+    },
+    {
+        "PipelineStateMap", true, []() -> bool
+        {
+            BenchmarkPipelineStateMap();
+            return true;
+        }
+    },
+    {
+        "PipelineCache", true, []() -> bool
+        {
+            return DX12::BenchmarkPipelineCache();
+        }
+    },
+    {
+        "LogRing", false, []() -> bool
+        {
+            return ValidateLogRing();
+        }
+    },
+    {
+        "LogRing", true, []() -> bool
+        {
+            BenchmarkLogRing();
+            return true;
+        }
+    },
+    {
+        "ConstantBufferPatching", false, []() -> bool
+        {
+            return ValidateConstantBufferPatching();
+        }
+    },
+    {
+        "SettingsCBuffer", false, []() -> bool
+        {
+            return ValidateSettingsCBufferUpdates();
+        }
+    },
+    {
+        "BatchMath", false, []() -> bool
+        {
+            return ValidateBatchMath();
+        }
+    },
+    {
+        "BatchMath", true, []() -> bool
+        {
+            BenchmarkBatchMath();
+            return true;
+        }
+    },
+    {
+        "CascadeFitting", false, []() -> bool
+        {
+            return ShadowHelper::ValidateCascadeFitting();
+        }
+    },
+    {
+        "CmdListPool", false, []() -> bool
+        {
+            return DX12::ValidateCmdListPool();
+        }
+    },
+    {
+        "AsyncShaderCompiles", false, []() -> bool
+        {
+            // The duplicate permutation makes sure that PrecompileFromFile() skips it without breaking the others
+            const uint32 tgSizes[] = { 4, 8, 16, 8 };
+            CompileOptions opts[ArraySize_(tgSizes)];
+            for(uint64 i = 0; i < ArraySize_(tgSizes); ++i)
+                opts[i].Add("TGSize_", tgSizes[i]);
+
+            const std::wstring shaderPath = SampleFrameworkDir() + L"Shaders\\DecodeTextureCS.hlsl";
+            return ValidateAsyncShaderCompiles(shaderPath.c_str(), "DecodeTextureCS", ShaderType::Compute, opts, ArraySize_(opts));
+        }
+    },
+};
+
+bool SelfTestMatchesFilter(const char* name, const char* filter)
+{
+    return filter == nullptr || filter[0] == 0 || strstr(name, filter) != nullptr;
+}
+
+bool RunSelfTests(bool runBenchmarks, const char* filter)
+{
+    uint64 numRun = 0;
+    uint64 numFailed = 0;
+
+    for(const SelfTest& test : SelfTests)
+    {
+        if(test.Benchmark && runBenchmarks == false)
+            continue;
+
+        if(SelfTestMatchesFilter(test.Name, filter) == false)
+            continue;
+
+        WriteLog("== %s %s ==", test.Benchmark ? "Benchmark" : "Test", test.Name);
+
+        bool passed = false;
+        Timer timer;
+        try
+        {
+            passed = test.Run();
+        }
+        catch(const Exception& exception)
+        {
+            WriteLog("%s threw an exception: %ls", test.Name, exception.GetMessage().c_str());
+        }
+        timer.Update();
+
+        WriteLog("%s %s (%.2fms)", test.Name, passed ? "passed" : "FAILED", timer.ElapsedMillisecondsD());
+
+        numRun += 1;
+        if(passed == false)
+            numFailed += 1;
+
+        DrainLog();
+    }
+
+    WriteLog("Self tests: %llu of %llu passed", numRun - numFailed, numRun);
+    DrainLog();
+
+    return numFailed == 0;
+}
+
+}
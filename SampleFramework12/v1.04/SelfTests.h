@@ -0,0 +1,26 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+namespace SampleFramework12
+{
+
+// Runs the framework's validation checks, plus its benchmarks if runBenchmarks is set. Only tests whose name
+// contains filter are run (an empty filter runs everything). Results are written to the log, and the return
+// value is false if any check failed. App runs this after initialization for the -selftest and -benchmark switches.
+bool RunSelfTests(bool runBenchmarks, const char* filter);
+
+// Returns true if a test with the given name passes the filter. Benchmarks that need the main loop to render
+// frames (like the ImGui stress test) can't run from RunSelfTests(), so App uses this to decide whether to run them.
+bool SelfTestMatchesFilter(const char* name, const char* filter);
+
+}
@@ -14,6 +14,16 @@
 #include "App.h"
 #include "ImGuiHelper.h"
 #include "ImGui/imgui.h"
+#include "Graphics\\DX12.h"
+#include "Graphics\\GraphicsTypes.h"
+
+namespace AppSettings
+{
+    extern SampleFramework12::ConstantBuffer CBuffer;
+    void UpdateCBuffer();
+    uint64 RebuildCBuffer(void* cbDataOut);
+    void GetCBufferSettings(SampleFramework12::List<SampleFramework12::Setting*>& cbSettings);
+}
 
 namespace SampleFramework12
 {
@@ -128,6 +138,21 @@ bool Setting::Visible() const
     return visible;
 }
 
+bool Setting::Dirty() const
+{
+    return dirty;
+}
+
+void Setting::ClearDirty()
+{
+    dirty = false;
+}
+
+SettingType Setting::Type() const
+{
+    return type;
+}
+
 const std::string& Setting::Name() const
 {
     return name;
@@ -184,6 +209,7 @@ void FloatSetting::Update(const Float4x4& viewMatrix)
         ImGui::SetTooltip("%s", helpText.c_str());
 
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -208,6 +234,7 @@ void FloatSetting::SetValue(float newVal)
 {
     val = Clamp(newVal, minVal, maxVal);
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -220,12 +247,14 @@ void FloatSetting::SetMinValue(float newMinVal)
 {
     minVal = newMinVal;
     val = Max(val, minVal);
+    dirty = true;
 }
 
 void FloatSetting::SetMaxValue(float newMaxVal)
 {
     maxVal = newMaxVal;
     val = Min(val, maxVal);
+    dirty = true;
 }
 
 // == IntSetting ==================================================================================
@@ -260,6 +289,7 @@ void IntSetting::Update(const Float4x4& viewMatrix)
     }
 
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -272,6 +302,7 @@ void IntSetting::SetValue(int32 newVal)
 {
     val = Clamp(newVal, minVal, maxVal);
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -284,12 +315,14 @@ void IntSetting::SetMinValue(int32 newMinVal)
 {
     minVal = newMinVal;
     val = Max(val, minVal);
+    dirty = true;
 }
 
 void IntSetting::SetMaxValue(int32 newMaxVal)
 {
     maxVal = newMaxVal;
     val = Min(val, maxVal);
+    dirty = true;
 }
 
 // == BoolSetting =================================================================================
@@ -317,6 +350,7 @@ void BoolSetting::Update(const Float4x4& viewMatrix)
     val = setting;
 
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -329,6 +363,7 @@ void BoolSetting::SetValue(bool32 newVal)
 {
     val = newVal ? true : false;
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -364,6 +399,7 @@ void EnumSetting::Update(const Float4x4& viewMatrix)
         ImGui::SetTooltip("%s", helpText.c_str());
 
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -376,6 +412,7 @@ void EnumSetting::SetValue(uint32 newVal)
 {
     val = Min(newVal, numValues - 1);
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -385,7 +422,10 @@ void EnumSetting::ClampNumValues(uint32 num)
     Assert_(num > 0);
     numValuesClamp = num;
     if(val >= numValuesClamp)
+    {
         val = numValuesClamp - 1;
+        dirty = true;
+    }
 }
 
 EnumSetting::operator uint32()
@@ -541,6 +581,7 @@ void DirectionSetting::Update(const Float4x4& viewMatrix)
 
     val = Float3::Normalize(val);
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -553,6 +594,7 @@ void DirectionSetting::SetValue(Float3 newVal)
 {
     val = Float3::Normalize(newVal);
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -653,6 +695,7 @@ void OrientationSetting::Update(const Float4x4& viewMatrix)
     val = Quaternion::Normalize(val);
 
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -665,6 +708,7 @@ void OrientationSetting::SetValue(Quaternion newVal)
 {
     val = Quaternion::Normalize(newVal);
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -761,6 +805,7 @@ void ColorSetting::Update(const Float4x4& viewMatrix)
     }
     Float3 newVal = val * multiplier;
     changed = oldVal != newVal;
+    dirty = dirty || changed;
     oldVal = newVal;
 }
 
@@ -781,6 +826,7 @@ void ColorSetting::SetValue(Float3 newVal)
 
     val = Float3::Clamp(newVal, 0.0f, 1.0f);
     changed = oldVal != val;
+    dirty = dirty || changed;
     oldVal = val;
 }
 
@@ -957,4 +1003,144 @@ void SettingsContainer::AddSetting(Setting* setting)
                 setting->Name().c_str(), setting->Group().c_str());
 }
 
-}
\ No newline at end of file
+// == Validation ==================================================================================
+
+bool ValidateSettingsCBufferUpdates(uint64 numIterations)
+{
+    bool passed = true;
+
+    List<Setting*> cbSettings;
+    AppSettings::GetCBufferSettings(cbSettings);
+
+    // Only these types get random edits. The others go through the same dirty bits in the base class.
+    List<Setting*> editable;
+    for(uint64 i = 0; i < cbSettings.Count(); ++i)
+    {
+        const SettingType type = cbSettings[i]->Type();
+        if(type == SettingType::Float || type == SettingType::Int || type == SettingType::Bool || type == SettingType::Enum)
+            editable.Add(cbSettings[i]);
+    }
+
+    // Saved as floats and ints so that they can be put back at the end
+    Array<float> savedFloats(editable.Count(), 0.0f);
+    Array<int32> savedInts(editable.Count(), 0);
+    for(uint64 i = 0; i < editable.Count(); ++i)
+    {
+        Setting* setting = editable[i];
+        if(setting->Type() == SettingType::Float)
+            savedFloats[i] = setting->AsFloat().RawValue();
+        else if(setting->Type() == SettingType::Int)
+            savedInts[i] = setting->AsInt().Value();
+        else if(setting->Type() == SettingType::Bool)
+            savedInts[i] = int32(setting->AsBool().Value());
+        else
+            savedInts[i] = int32(setting->AsEnum().Value());
+    }
+
+    // UpdateCBuffer() can cycle through versions of the buffer more than once per frame here, since nothing is
+    // reading from them on the GPU
+    DX12::FlushGPU();
+
+    ConstantBuffer& cbuffer = AppSettings::CBuffer;
+    Array<uint8> rebuilt(cbuffer.InternalBuffer.Size, 0);
+
+    auto updateAndCheck = [&](uint64 iteration)
+    {
+        bool anyDirty = false;
+        for(uint64 i = 0; i < cbSettings.Count(); ++i)
+            anyDirty = anyDirty || cbSettings[i]->Dirty();
+
+        const uint64 prevGPUAddress = cbuffer.CurrentGPUAddress;
+
+        cbuffer.InternalBuffer.UploadFrame = uint64(-1);
+        AppSettings::UpdateCBuffer();
+
+        for(uint64 i = 0; i < cbSettings.Count(); ++i)
+        {
+            if(cbSettings[i]->Dirty())
+            {
+                WriteLog("Setting %s was still dirty after UpdateCBuffer() (iteration %llu)", cbSettings[i]->Name().c_str(), iteration);
+                passed = false;
+            }
+        }
+
+        if(anyDirty == false && cbuffer.CurrentGPUAddress != prevGPUAddress)
+        {
+            WriteLog("UpdateCBuffer() uploaded even though no setting was dirty (iteration %llu)", iteration);
+            passed = false;
+        }
+
+        const uint64 cbSize = AppSettings::RebuildCBuffer(rebuilt.Data());
+        if(memcmp(cbuffer.MappedData(), rebuilt.Data(), cbSize) != 0)
+        {
+            WriteLog("The settings constant buffer didn't match a full rebuild (iteration %llu)", iteration);
+            passed = false;
+        }
+    };
+
+    Random rng;
+    uint64 numEdits = 0;
+    for(uint64 iteration = 0; iteration < numIterations && passed; ++iteration)
+    {
+        // Most frames don't touch any settings, and the rest usually touch a few
+        const uint32 numIterationEdits = editable.Count() > 0 && rng.RandomUint() % 4 == 0 ? 1 + rng.RandomUint() % 3 : 0;
+        for(uint32 editIdx = 0; editIdx < numIterationEdits; ++editIdx)
+        {
+            Setting* setting = editable[rng.RandomUint() % editable.Count()];
+            if(setting->Type() == SettingType::Float)
+            {
+                FloatSetting& floatSetting = setting->AsFloat();
+                const float minVal = Max(floatSetting.MinValue(), -1000.0f);
+                const float maxVal = Min(floatSetting.MaxValue(), 1000.0f);
+                floatSetting.SetValue(Lerp(minVal, maxVal, rng.RandomFloat()));
+            }
+            else if(setting->Type() == SettingType::Int)
+            {
+                IntSetting& intSetting = setting->AsInt();
+                const int64 range = int64(intSetting.MaxValue()) - int64(intSetting.MinValue()) + 1;
+                intSetting.SetValue(int32(int64(intSetting.MinValue()) + int64(rng.RandomUint() % uint64(range))));
+            }
+            else if(setting->Type() == SettingType::Bool)
+            {
+                setting->AsBool().SetValue(rng.RandomUint() % 2);
+            }
+            else
+            {
+                EnumSetting& enumSetting = setting->AsEnum();
+                enumSetting.SetValue(rng.RandomUint() % enumSetting.NumValues());
+            }
+
+            ++numEdits;
+        }
+
+        updateAndCheck(iteration);
+    }
+
+    for(uint64 i = 0; i < editable.Count(); ++i)
+    {
+        Setting* setting = editable[i];
+        if(setting->Type() == SettingType::Float)
+            setting->AsFloat().SetValue(savedFloats[i]);
+        else if(setting->Type() == SettingType::Int)
+            setting->AsInt().SetValue(savedInts[i]);
+        else if(setting->Type() == SettingType::Bool)
+            setting->AsBool().SetValue(bool32(savedInts[i]));
+        else
+            setting->AsEnum().SetValue(uint32(savedInts[i]));
+    }
+
+    updateAndCheck(numIterations);
+
+    // Let the next real frame map the buffer again
+    cbuffer.InternalBuffer.UploadFrame = uint64(-1);
+
+    WriteLog("Settings constant buffer updates: %llu settings in the cbuffer, %llu random edits, validation %s",
+             cbSettings.Count(), numEdits, passed ? "passed" : "failed");
+
+    cbSettings.Shutdown();
+    editable.Shutdown();
+
+    return passed;
+}
+
+}
@@ -77,6 +77,7 @@ protected:
     std::string label;
     std::string helpText;
     bool changed = false;
+    bool dirty = true;
     bool initialized = false;
     bool visible = true;
 
@@ -104,8 +105,11 @@ public:
     ColorSetting& AsColor();
     Button& AsButton();
 
+    SettingType Type() const;
     bool Changed() const;
     bool Visible() const;
+    bool Dirty() const;
+    void ClearDirty();
     const std::string& Name() const;
     const std::string& Group() const;
 
@@ -114,6 +118,9 @@ public:
     template<typename TSerializer> void SerializeValue(TSerializer& serializer)
     {
         Assert_(initialized);
+        if(serializer.IsReadSerializer())
+            dirty = true;
+
         if(type == SettingType::Float)
             AsFloat().SerializeValue(serializer);
         else if(type == SettingType::Int)
@@ -268,6 +275,7 @@ public:
     uint32 Value() const;
     void SetValue(uint32 newVal);
     void ClampNumValues(uint32 num);
+    uint32 NumValues() const { return numValues; }
 
     operator uint32();
 
@@ -484,4 +492,10 @@ public:
     void SetWindowOpened(bool windowOpened) { opened = windowOpened; }
 };
 
+// Makes random edits to the app's float, int, bool and enum settings that end up in the constant buffer, and runs
+// the generated AppSettings::UpdateCBuffer() after each round. Checks that it clears the dirty bits, that it skips
+// the upload when nothing was modified, and that the bound version of the buffer matches a full rebuild. The
+// settings are put back the way they were afterwards. Returns false if anything didn't match.
+bool ValidateSettingsCBufferUpdates(uint64 numIterations = 1000);
+
 }
\ No newline at end of file
@@ -187,7 +187,23 @@ namespace SettingsCompiler
             if(Type == SettingType.Button)
                 return;
 
-            lines.Add(string.Format("        cbData." + Name + " = {0};", Name));
+            lines.Add("");
+            lines.Add("        if(" + Name + ".Dirty())");
+            lines.Add("        {");
+            lines.Add("            CBufferData." + Name + " = " + Name + ";");
+            lines.Add("            " + Name + ".ClearDirty();");
+            lines.Add("            dirty = true;");
+            lines.Add("        }");
+        }
+
+        public void WriteCBufferRebuild(List<string> lines)
+        {
+            Debug.Assert(UseAsShaderConstant);
+
+            if(Type == SettingType.Button)
+                return;
+
+            lines.Add("        cbData." + Name + " = " + Name + ";");
         }
 
         public static string FloatString(float num)
@@ -291,6 +291,8 @@ namespace SettingsCompiler
             lines.Add("    void Shutdown();");
             lines.Add("    void Update(uint32 displayWidth, uint32 displayHeight, const Float4x4& viewMatrix);");
             lines.Add("    void UpdateCBuffer();");
+            lines.Add("    uint64 RebuildCBuffer(void* cbDataOut);");
+            lines.Add("    void GetCBufferSettings(List<Setting*>& cbSettings);");
             lines.Add("    void BindCBufferGfx(ID3D12GraphicsCommandList* cmdList, uint32 rootParameter);");
             lines.Add("    void BindCBufferCompute(ID3D12GraphicsCommandList* cmdList, uint32 rootParameter);");
             lines.Add("    void GetShaderCompileOptions(CompileOptions& opts);");
@@ -328,6 +330,7 @@ namespace SettingsCompiler
             lines.Add("");
             lines.Add("    ConstantBuffer CBuffer;");
             lines.Add(string.Format("    const uint32 CBufferRegister = {0};", CBufferRegister));
+            lines.Add("    static AppSettingsCBuffer CBufferData;");
 
             lines.Add("");
             lines.Add("    void Initialize()");
@@ -372,13 +375,47 @@ namespace SettingsCompiler
             lines.Add("");
             lines.Add("    void UpdateCBuffer()");
             lines.Add("    {");
-            lines.Add("        AppSettingsCBuffer cbData;");
+            lines.Add("        // Only settings that were modified since the last update get copied, and if nothing was");
+            lines.Add("        // modified then the version of the buffer from the last update stays bound");
+            lines.Add("        bool dirty = false;");
 
             foreach(Setting setting in cbufferSettings)
                 setting.WriteCBufferUpdate(lines);
 
             lines.Add("");
-            lines.Add("        CBuffer.MapAndSetData(cbData);");
+            lines.Add("        #if UseAsserts_");
+            lines.Add("            AppSettingsCBuffer cbData;");
+            lines.Add("            RebuildCBuffer(&cbData);");
+            lines.Add("            Assert_(memcmp(&cbData, &CBufferData, sizeof(AppSettingsCBuffer)) == 0);");
+            lines.Add("        #endif");
+
+            lines.Add("");
+            lines.Add("        if(dirty)");
+            lines.Add("            CBuffer.MapAndPatchData(CBufferData);");
+
+            lines.Add("    }");
+
+            lines.Add("");
+            lines.Add("    uint64 RebuildCBuffer(void* cbDataOut)");
+            lines.Add("    {");
+            lines.Add("        // Fills out the whole struct from the current values, ignoring the dirty bits. CBuffer's size is");
+            lines.Add("        // always enough room for it.");
+            lines.Add("        AppSettingsCBuffer& cbData = *reinterpret_cast<AppSettingsCBuffer*>(cbDataOut);");
+            lines.Add("        memset(&cbData, 0, sizeof(AppSettingsCBuffer));");
+
+            foreach(Setting setting in cbufferSettings)
+                setting.WriteCBufferRebuild(lines);
+
+            lines.Add("        return sizeof(AppSettingsCBuffer);");
+            lines.Add("    }");
+
+            lines.Add("");
+            lines.Add("    void GetCBufferSettings(List<Setting*>& cbSettings)");
+            lines.Add("    {");
+
+            foreach(Setting setting in cbufferSettings)
+                if(setting.Type != SettingType.Button)
+                    lines.Add("        cbSettings.Add(&" + setting.Name + ");");
 
             lines.Add("    }");
 
@@ -23,24 +23,27 @@ struct VSOutput
     float2 UV : UV;
 };
 
-struct VSConstants
+struct ImGuiConstants
 {
-    row_major float4x4 ProjectionMatrix;
+    float2 Scale;
+    float2 Translation;
+    uint TextureTableIdx;
+    uint TextureEntryIdx;
 };
 
-struct PSConstants
+// One entry per unique ImTextureID used in a frame, which matches the layout of ToImTextureID()
+struct TextureEntry
 {
     uint SRVIndex;
     uint SamplerMode;
 };
 
-ConstantBuffer<VSConstants> VSCBuffer : register(b0);
-ConstantBuffer<PSConstants> PSCBuffer : register(b1);
+ConstantBuffer<ImGuiConstants> CBuffer : register(b0);
 
 VSOutput ImGuiVS(in VSInput input)
 {
     VSOutput output;
-    output.Position = mul(float4(input.Position, 0.0f, 1.0f), VSCBuffer.ProjectionMatrix);
+    output.Position = float4(input.Position * CBuffer.Scale + CBuffer.Translation, 0.5f, 1.0f);
     output.Color = input.Color;
     output.UV = input.UV;
 
@@ -49,8 +52,11 @@ VSOutput ImGuiVS(in VSInput input)
 
 float4 ImGuiPS(in VSOutput input) : SV_Target0
 {
-    Texture2D imGuiTexture = ResourceDescriptorHeap[PSCBuffer.SRVIndex];
-    if(PSCBuffer.SamplerMode == 0)
+    StructuredBuffer<TextureEntry> textureTable = ResourceDescriptorHeap[CBuffer.TextureTableIdx];
+    const TextureEntry entry = textureTable[CBuffer.TextureEntryIdx];
+
+    Texture2D imGuiTexture = ResourceDescriptorHeap[entry.SRVIndex];
+    if(entry.SamplerMode == 0)
         return imGuiTexture.Sample(LinearClampSampler, input.UV) * input.Color;
     else
         return imGuiTexture.Sample(PointSampler, input.UV) * input.Color;
@@ -19,4 +19,50 @@ struct MeshVertex
     float3 Bitangent;
 };
 
+// Matches PackedMeshVertex on the CPU side, for reading packed vertices from a structured buffer
+struct PackedMeshVertex
+{
+    uint2 Position;     // snorm16 xyz relative to the model's AABB, bitangent sign in w
+    uint Normal;        // Octahedral snorm16
+    uint Tangent;       // Octahedral snorm16
+    uint UV;            // half2
+};
+
+float2 UnpackSNorm16x2(in uint packed)
+{
+    const int2 signedValues = int2(int(packed << 16), int(packed)) >> 16;
+    return max(signedValues / 32767.0f, -1.0f);
+}
+
+float3 OctDecode(in float2 oct)
+{
+    float3 n = float3(oct.xy, 1.0f - abs(oct.x) - abs(oct.y));
+    if(n.z < 0.0f)
+        n.xy = (1.0f - abs(n.yx)) * select(n.xy >= 0.0f, 1.0f, -1.0f);
+
+    return normalize(n);
+}
+
+// Decodes the attributes of a packed vertex, where the inputs are the values that come
+// from the input assembler when using the packed input layout (or from UnpackSNorm16x2)
+MeshVertex DecodePackedVertex(in float4 position, in float2 normal, in float2 tangent, in float2 uv,
+                              in float3 posScale, in float3 posBias)
+{
+    MeshVertex vtx;
+    vtx.Position = position.xyz * posScale + posBias;
+    vtx.Normal = OctDecode(normal);
+    vtx.Tangent = OctDecode(tangent);
+    vtx.Bitangent = cross(vtx.Normal, vtx.Tangent) * (position.w >= 0.0f ? 1.0f : -1.0f);
+    vtx.UV = uv;
+
+    return vtx;
+}
+
+MeshVertex UnpackMeshVertex(in PackedMeshVertex packed, in float3 posScale, in float3 posBias)
+{
+    const float4 position = float4(UnpackSNorm16x2(packed.Position.x), UnpackSNorm16x2(packed.Position.y));
+    const float2 uv = f16tof32(uint2(packed.UV, packed.UV >> 16));
+    return DecodePackedVertex(position, UnpackSNorm16x2(packed.Normal), UnpackSNorm16x2(packed.Tangent), uv, posScale, posBias);
+}
+
 #endif // MESHVERTEX_HLSL_
\ No newline at end of file
@@ -0,0 +1,39 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#ifndef MESHLET_HLSL_
+#define MESHLET_HLSL_
+
+// Matches the Meshlet struct on the CPU side
+struct Meshlet
+{
+    float3 BoundsCenter;
+    float BoundsRadius;
+    float3 ConeAxis;
+    float ConeCutoff;
+    float3 ConeApex;
+    uint VertexOffset;
+    uint VertexCount;
+    uint TriangleOffset;
+    uint TriangleCount;
+    uint MeshIdx;
+};
+
+// Triangles are stored as three 8-bit indices into the meshlet's vertex list
+uint3 UnpackMeshletTriangle(in uint packed)
+{
+    return uint3(packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF);
+}
+
+bool MeshletConeCulled(in Meshlet meshlet, in float3 cameraPos)
+{
+    return dot(normalize(meshlet.ConeApex - cameraPos), meshlet.ConeAxis) >= meshlet.ConeCutoff;
+}
+
+#endif // MESHLET_HLSL_
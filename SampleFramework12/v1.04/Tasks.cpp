@@ -0,0 +1,100 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+
+#include "Tasks.h"
+#include "SF12_Assert.h"
+
+namespace SampleFramework12
+{
+
+namespace Tasks
+{
+
+static enkiTaskScheduler* TaskScheduler = nullptr;
+
+void Initialize()
+{
+    if(TaskScheduler != nullptr)
+        return;
+
+    // This uses one thread per hardware thread, with the calling thread being one of them
+    TaskScheduler = enkiNewTaskScheduler();
+    enkiInitTaskScheduler(TaskScheduler);
+}
+
+void Shutdown()
+{
+    if(TaskScheduler == nullptr)
+        return;
+
+    enkiWaitForAll(TaskScheduler);
+    enkiDeleteTaskScheduler(TaskScheduler);
+    TaskScheduler = nullptr;
+}
+
+enkiTaskScheduler* Scheduler()
+{
+    // Lazily initialize so that tools and code running before App initialization can still use it
+    if(TaskScheduler == nullptr)
+        Initialize();
+
+    return TaskScheduler;
+}
+
+uint32 NumThreads()
+{
+    return enkiGetNumTaskThreads(Scheduler());
+}
+
+void ParallelFor(uint32 setSize, uint32 minRange, enkiTaskExecuteRange taskFunc, void* args)
+{
+    WaitForTaskSet(BeginParallelFor(setSize, minRange, taskFunc, args));
+}
+
+enkiTaskSet* BeginParallelFor(uint32 setSize, uint32 minRange, enkiTaskExecuteRange taskFunc, void* args)
+{
+    Assert_(taskFunc != nullptr);
+    if(setSize == 0)
+        return nullptr;
+
+    enkiTaskScheduler* scheduler = Scheduler();
+    enkiTaskSet* taskSet = enkiCreateTaskSet(scheduler, taskFunc);
+    enkiAddTaskSetMinRange(scheduler, taskSet, args, setSize, minRange > 0 ? minRange : 1);
+    return taskSet;
+}
+
+void WaitForTaskSet(enkiTaskSet* taskSet)
+{
+    if(taskSet == nullptr)
+        return;
+
+    enkiTaskScheduler* scheduler = Scheduler();
+    enkiWaitForTaskSet(scheduler, taskSet);
+    enkiDeleteTaskSet(scheduler, taskSet);
+}
+
+bool IsTaskSetComplete(const enkiTaskSet* taskSet)
+{
+    if(taskSet == nullptr)
+        return true;
+
+    return enkiIsTaskSetComplete(Scheduler(), const_cast<enkiTaskSet*>(taskSet)) != 0;
+}
+
+void WaitForAll()
+{
+    if(TaskScheduler != nullptr)
+        enkiWaitForAll(TaskScheduler);
+}
+
+} // namespace Tasks
+
+} // namespace SampleFramework12
@@ -0,0 +1,43 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+#include "EnkiTS\\TaskScheduler_c.h"
+
+namespace SampleFramework12
+{
+
+// Framework-wide enkiTS scheduler, used for spreading CPU work across worker threads
+namespace Tasks
+{
+
+void Initialize();
+void Shutdown();
+
+enkiTaskScheduler* Scheduler();
+uint32 NumThreads();
+
+// Runs taskFunc over the range [0, setSize) on all available threads, and waits for it to complete
+void ParallelFor(uint32 setSize, uint32 minRange, enkiTaskExecuteRange taskFunc, void* args);
+
+// Same as ParallelFor(), except that it returns right away. The returned task set needs to be passed to
+// WaitForTaskSet(), which also deletes it, and args need to stay alive until then.
+enkiTaskSet* BeginParallelFor(uint32 setSize, uint32 minRange, enkiTaskExecuteRange taskFunc, void* args);
+void WaitForTaskSet(enkiTaskSet* taskSet);
+bool IsTaskSetComplete(const enkiTaskSet* taskSet);
+
+// Waits for every task set that's been kicked off, including ones that are still owned by someone else
+void WaitForAll();
+
+} // namespace Tasks
+
+} // namespace SampleFramework12
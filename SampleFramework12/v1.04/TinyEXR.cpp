@@ -34,6 +34,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #pragma warning(disable : 4189)
 // == SF11 Changes END ==========================================================================
 
+// == SF12 Changes START ==========================================================================
+#include "Tasks.h"
+// == SF12 Changes END ============================================================================
+
 #include <cstdio>
 #include <cstdlib>
 #include <cassert>
@@ -6973,10 +6977,352 @@ void DecompressZip(unsigned char *dst, unsigned long &uncompressedSize,
   }
 }
 
+
+// == SF12 Changes START ==========================================================================
+
+// Scanlines are compressed in independent blocks, so groups of blocks are encoded in parallel
+// on the framework's task scheduler before being written out in order.
+const int kZipScanlineBlockSize = 16;
+const int kMaxBlocksPerBatch = 64;
+
+// Returns whether blocks should go through the task scheduler, where NULL
+// options mean the defaults
+bool UseParallelBlocks(const EXRCodecOptions *options) {
+  return options == NULL || options->parallel != 0;
+}
+
+// Describes where to find the samples for each channel. This covers both planar
+// (pixelStride == 1) and interleaved (pixelStride == numComponents) layouts.
+struct EXRPixelSource {
+  std::vector<const float *> channels; // First sample of each channel
+  int pixelStride;                     // Floats between consecutive pixels
+  int rowPitch;                        // Floats between consecutive scanlines
+};
+
+// Converts a block of scanlines to half and ZIP compresses it, producing the
+// block header (scanline + data size) followed by the compressed data.
+void EncodeZipBlock(std::vector<unsigned char> &out, const EXRPixelSource &src,
+                    int srcStartY, int width, int numLines, int lineNo) {
+  const int numChannels = int(src.channels.size());
+  std::vector<unsigned short> buf(numChannels * width * numLines);
+
+  bool isBigEndian = IsBigEndian();
+
+  for (int y = 0; y < numLines; y++) {
+    for (int c = 0; c < numChannels; c++) {
+      const float *srcLine =
+          src.channels[c] + size_t(srcStartY + y) * size_t(src.rowPitch);
+      unsigned short *dstLine = &buf[numChannels * y * width + c * width];
+      for (int x = 0; x < width; x++) {
+        FP32 f32;
+        f32.f = srcLine[size_t(x) * size_t(src.pixelStride)];
+
+        FP16 h16 = float_to_half_full(f32);
+        if (isBigEndian) {
+          swap2(reinterpret_cast<unsigned short *>(&h16.u));
+        }
+
+        dstLine[x] = h16.u;
+      }
+    }
+  }
+
+  const unsigned long srcSize = buf.size() * sizeof(unsigned short);
+  out.resize(8 + miniz::mz_compressBound(srcSize));
+
+  unsigned long long outSize = out.size() - 8;
+  CompressZip(&out.at(8), outSize,
+              reinterpret_cast<const unsigned char *>(&buf.at(0)), srcSize);
+
+  // 4 byte: scan line
+  // 4 byte: data size
+  // ~     : pixel data(compressed)
+  unsigned int dataLen = outSize; // truncate
+  memcpy(&out.at(0), &lineNo, sizeof(int));
+  memcpy(&out.at(4), &dataLen, sizeof(unsigned int));
+  if (isBigEndian) {
+    swap4(reinterpret_cast<unsigned int *>(&out.at(0)));
+    swap4(reinterpret_cast<unsigned int *>(&out.at(4)));
+  }
+
+  out.resize(8 + dataLen);
+}
+
+struct EncodeBlocksArgs {
+  const EXRPixelSource *src;
+  int srcStartY;
+  int width;
+  int numLines;
+  int firstLineNo;
+  std::vector<std::vector<unsigned char> > *blocks;
+};
+
+void EncodeBlocksTask(SampleFramework12::uint32 start,
+                      SampleFramework12::uint32 end,
+                      SampleFramework12::uint32 threadNum, void *args_) {
+  const EncodeBlocksArgs *args = reinterpret_cast<const EncodeBlocksArgs *>(args_);
+  for (SampleFramework12::uint32 i = start; i < end; i++) {
+    const int blockStart = int(i) * kZipScanlineBlockSize;
+    const int numLines =
+        std::min(kZipScanlineBlockSize, args->numLines - blockStart);
+    EncodeZipBlock((*args->blocks)[i], *args->src, args->srcStartY + blockStart,
+                   args->width, numLines, args->firstLineNo + blockStart);
+  }
+}
+
+// Encodes `numLines` scanlines into blocks of kZipScanlineBlockSize lines,
+// where only the last block is allowed to be partial
+void EncodeBlocks(std::vector<std::vector<unsigned char> > &blocks,
+                  const EXRPixelSource &src, int srcStartY, int width,
+                  int numLines, int firstLineNo, bool parallel) {
+  const int numBlocks =
+      (numLines + kZipScanlineBlockSize - 1) / kZipScanlineBlockSize;
+  blocks.resize(numBlocks);
+
+  EncodeBlocksArgs args;
+  args.src = &src;
+  args.srcStartY = srcStartY;
+  args.width = width;
+  args.numLines = numLines;
+  args.firstLineNo = firstLineNo;
+  args.blocks = &blocks;
+
+  if (parallel && numBlocks > 1) {
+    SampleFramework12::Tasks::ParallelFor(SampleFramework12::uint32(numBlocks), 1, EncodeBlocksTask, &args);
+  } else {
+    EncodeBlocksTask(0, numBlocks, 0, &args);
+  }
+}
+
+void WriteEXRHeader(FILE *fp, int width, int height, int numChannels,
+                    const char **channelNames) {
+  // Header
+  {
+    const char header[] = {0x76, 0x2f, 0x31, 0x01};
+    size_t n = fwrite(header, 1, 4, fp);
+    assert(n == 4);
+  }
+
+  // Version, scanline.
+  {
+    const char marker[] = {2, 0, 0, 0};
+    size_t n = fwrite(marker, 1, 4, fp);
+    assert(n == 4);
+  }
+
+  // Write attributes.
+  {
+    std::vector<unsigned char> data;
+
+    std::vector<ChannelInfo> channels;
+    for (int c = 0; c < numChannels; c++) {
+      ChannelInfo info;
+      info.pLinear = 0;
+      info.pixelType = 1; // Assume HALF
+      info.xSampling = 1;
+      info.ySampling = 1;
+      info.name = std::string(channelNames[c]);
+      channels.push_back(info);
+    }
+
+    WriteChannelInfo(data, channels);
+
+    WriteAttribute(fp, "channels", "chlist", &data.at(0),
+                   data.size()); // +1 = null
+  }
+
+  {
+    int compressionType = 3; // ZIP compression
+    if (IsBigEndian()) {
+      swap4(reinterpret_cast<unsigned int*>(&compressionType));
+    }
+    WriteAttribute(fp, "compression", "compression",
+                   reinterpret_cast<const unsigned char *>(&compressionType),
+                   1);
+  }
+
+  {
+    int data[4] = {0, 0, width - 1, height - 1};
+    if (IsBigEndian()) {
+      swap4(reinterpret_cast<unsigned int*>(&data[0]));
+      swap4(reinterpret_cast<unsigned int*>(&data[1]));
+      swap4(reinterpret_cast<unsigned int*>(&data[2]));
+      swap4(reinterpret_cast<unsigned int*>(&data[3]));
+    }
+    WriteAttribute(fp, "dataWindow", "box2i",
+                   reinterpret_cast<const unsigned char *>(data),
+                   sizeof(int) * 4);
+    WriteAttribute(fp, "displayWindow", "box2i",
+                   reinterpret_cast<const unsigned char *>(data),
+                   sizeof(int) * 4);
+  }
+
+  {
+    unsigned char lineOrder = 0; // increasingY
+    WriteAttribute(fp, "lineOrder", "lineOrder", &lineOrder, 1);
+  }
+
+  {
+    float aspectRatio = 1.0f;
+    if (IsBigEndian()) {
+      swap4(reinterpret_cast<unsigned int*>(&aspectRatio));
+    }
+    WriteAttribute(fp, "pixelAspectRatio", "float",
+                   reinterpret_cast<const unsigned char *>(&aspectRatio),
+                   sizeof(float));
+  }
+
+  {
+    float center[2] = {0.0f, 0.0f};
+    if (IsBigEndian()) {
+      swap4(reinterpret_cast<unsigned int*>(&center[0]));
+      swap4(reinterpret_cast<unsigned int*>(&center[1]));
+    }
+    WriteAttribute(fp, "screenWindowCenter", "v2f",
+                   reinterpret_cast<const unsigned char *>(center),
+                   2 * sizeof(float));
+  }
+
+  {
+    float w = (float)width;
+    if (IsBigEndian()) {
+      swap4(reinterpret_cast<unsigned int*>(&w));
+    }
+    WriteAttribute(fp, "screenWindowWidth", "float",
+                   reinterpret_cast<const unsigned char *>(&w), sizeof(float));
+  }
+
+  { // end of header
+    unsigned char e = 0;
+    fwrite(&e, 1, 1, fp);
+  }
+}
+
+// Decodes a single block of scanlines into the planar output image
+void DecodeBlock(EXRImage *exrImage, const char *head, long long offset,
+                 int compressionType, int numScanlineBlocks, int blockIdx,
+                 int numChannels, int dataWidth, int dataHeight) {
+  const unsigned char *dataPtr =
+      reinterpret_cast<const unsigned char *>(head + offset);
+  // 4 byte: scan line
+  // 4 byte: data size
+  // ~     : pixel data(uncompressed or compressed)
+  int lineNo;
+  memcpy(&lineNo, dataPtr, sizeof(int));
+  int dataLen;
+  memcpy(&dataLen, dataPtr + 4, sizeof(int));
+  if (IsBigEndian()) {
+    swap4(reinterpret_cast<unsigned int*>(&lineNo));
+    swap4(reinterpret_cast<unsigned int*>(&dataLen));
+  }
+
+  int endLineNo = std::min(lineNo + numScanlineBlocks, dataHeight);
+
+  int numLines = endLineNo - lineNo;
+
+  bool isBigEndian = IsBigEndian();
+
+  if (compressionType == 3) { // ZIP
+
+    // Allocate original data size.
+    std::vector<unsigned short> outBuf(dataWidth * numLines * numChannels);
+
+    unsigned long dstLen = outBuf.size() * sizeof(short);
+    DecompressZip(reinterpret_cast<unsigned char *>(&outBuf.at(0)), dstLen,
+                  dataPtr + 8, dataLen);
+
+    // For ZIP_COMPRESSION:
+    //   pixel sample data for channel 0 for scanline 0
+    //   pixel sample data for channel 1 for scanline 0
+    //   pixel sample data for channel ... for scanline 0
+    //   pixel sample data for channel n for scanline 0
+    //   pixel sample data for channel 0 for scanline 1
+    //   pixel sample data for channel 1 for scanline 1
+    //   pixel sample data for channel ... for scanline 1
+    //   pixel sample data for channel n for scanline 1
+    //   ...
+    for (int v = 0; v < numLines; v++) {
+      for (int c = 0; c < numChannels; c++) {
+        for (int u = 0; u < dataWidth; u++) {
+          FP16 hf;
+
+          hf.u = outBuf[v * (numChannels * dataWidth) + (c * dataWidth) + u];
+
+          if (isBigEndian) {
+            swap2(reinterpret_cast<unsigned short*>(&hf.u));
+          }
+
+          FP32 f32 = half_to_float(hf);
+
+          // Assume increasing Y.
+          exrImage->images[c][(lineNo + v) * dataWidth + u] = f32.f;
+        }
+      }
+    }
+
+  } else if (compressionType == 0) { // No compression
+
+    std::vector<unsigned short> srcBuf(numChannels * dataWidth);
+    memcpy(&srcBuf.at(0), dataPtr + 8, numChannels * dataWidth * sizeof(unsigned short));
+
+    // scanline
+    for (int c = 0; c < numChannels; c++) {
+      for (int u = 0; u < dataWidth; u++) {
+        FP16 hf;
+
+        // Assume (A)BGR
+        hf.u = srcBuf[c * dataWidth + u];
+
+        if (isBigEndian) {
+          swap2(reinterpret_cast<unsigned short*>(&hf.u));
+        }
+
+        FP32 f32 = half_to_float(hf);
+
+        // Assume increasing Y.
+        exrImage->images[c][blockIdx * dataWidth + u] = f32.f;
+
+      }
+    }
+  }
+}
+
+struct DecodeBlocksArgs {
+  EXRImage *exrImage;
+  const char *head;
+  const long long *offsets;
+  int compressionType;
+  int numScanlineBlocks;
+  int numChannels;
+  int dataWidth;
+  int dataHeight;
+};
+
+void DecodeBlocksTask(SampleFramework12::uint32 start,
+                      SampleFramework12::uint32 end,
+                      SampleFramework12::uint32 threadNum, void *args_) {
+  const DecodeBlocksArgs *args = reinterpret_cast<const DecodeBlocksArgs *>(args_);
+  for (SampleFramework12::uint32 i = start; i < end; i++) {
+    DecodeBlock(args->exrImage, args->head, args->offsets[i],
+                args->compressionType, args->numScanlineBlocks, int(i),
+                args->numChannels, args->dataWidth, args->dataHeight);
+  }
+}
+
+// == SF12 Changes END ============================================================================
+
 } // namespace
 
 int LoadEXR(float **out_rgba, int *width, int *height, const char *filename,
             const char **err) {
+  // == SF12 Changes START ========================================================================
+  return LoadEXRWithOptions(out_rgba, width, height, filename, NULL, err);
+}
+
+int LoadEXRWithOptions(float **out_rgba, int *width, int *height,
+                       const char *filename, const EXRCodecOptions *options,
+                       const char **err) {
+  // == SF12 Changes END ==========================================================================
 
   if (out_rgba == NULL) {
     if (*err) {
@@ -6986,7 +7332,7 @@ int LoadEXR(float **out_rgba, int *width, int *height, const char *filename,
   }
 
   EXRImage exrImage;
-  int ret = LoadMultiChannelEXR(&exrImage, filename, err);
+  int ret = LoadMultiChannelEXRWithOptions(&exrImage, filename, options, err);
   if (ret != 0) {
     return ret;
   }
@@ -7013,7 +7359,7 @@ int LoadEXR(float **out_rgba, int *width, int *height, const char *filename,
       (*err) = "R channel not found\n";
     }
 
-    // @todo { free exrImage }
+    FreeEXRImage(&exrImage);
     return -1;
   }
 
@@ -7021,7 +7367,7 @@ int LoadEXR(float **out_rgba, int *width, int *height, const char *filename,
     if (*err) {
       (*err) = "G channel not found\n";
     }
-    // @todo { free exrImage }
+    FreeEXRImage(&exrImage);
     return -1;
   }
 
@@ -7029,7 +7375,7 @@ int LoadEXR(float **out_rgba, int *width, int *height, const char *filename,
     if (*err) {
       (*err) = "B channel not found\n";
     }
-    // @todo { free exrImage }
+    FreeEXRImage(&exrImage);
     return -1;
   }
 
@@ -7037,7 +7383,7 @@ int LoadEXR(float **out_rgba, int *width, int *height, const char *filename,
   //  if (*err) {
   //    (*err) = "A channel not found\n";
   //  }
-  //  // @todo { free exrImage }
+  //  FreeEXRImage(&exrImage);
   //  return -1;
   //}
 
@@ -7056,13 +7402,23 @@ int LoadEXR(float **out_rgba, int *width, int *height, const char *filename,
   (*width) = exrImage.width;
   (*height) = exrImage.height;
 
-  // @todo { free exrImage }
+  // == SF12 Changes START ========================================================================
+  FreeEXRImage(&exrImage);
+  // == SF12 Changes END ==========================================================================
   return 0;
 
 }
 
 int LoadMultiChannelEXR(EXRImage *exrImage, const char *filename,
                         const char **err) {
+  // == SF12 Changes START ========================================================================
+  return LoadMultiChannelEXRWithOptions(exrImage, filename, NULL, err);
+}
+
+int LoadMultiChannelEXRWithOptions(EXRImage *exrImage, const char *filename,
+                                   const EXRCodecOptions *options,
+                                   const char **err) {
+  // == SF12 Changes END ==========================================================================
   if (exrImage == NULL) {
     if (err) {
       (*err) = "Invalid argument.";
@@ -7254,98 +7610,26 @@ int LoadMultiChannelEXR(EXRImage *exrImage, const char *filename,
         (float *)malloc(sizeof(float) * dataWidth * dataHeight);
   }
 
-  for (int y = 0; y < numBlocks; y++) {
-    const unsigned char *dataPtr =
-        reinterpret_cast<const unsigned char *>(head + offsets[y]);
-    // 4 byte: scan line
-    // 4 byte: data size
-    // ~     : pixel data(uncompressed or compressed)
-    int lineNo;
-    memcpy(&lineNo, dataPtr, sizeof(int));
-    int dataLen;
-    memcpy(&dataLen, dataPtr + 4, sizeof(int));
-    if (IsBigEndian()) {
-      swap4(reinterpret_cast<unsigned int*>(&lineNo));
-      swap4(reinterpret_cast<unsigned int*>(&dataLen));
-    }
-
-    int endLineNo = std::min(lineNo + numScanlineBlocks, dataHeight);
-
-    int numLines = endLineNo - lineNo;
-
-    if (compressionType == 3) { // ZIP
-
-      // Allocate original data size.
-      std::vector<unsigned short> outBuf(dataWidth * numLines * numChannels);
-
-      unsigned long dstLen = outBuf.size() * sizeof(short);
-      DecompressZip(reinterpret_cast<unsigned char *>(&outBuf.at(0)), dstLen,
-                    dataPtr + 8, dataLen);
-
-      bool isBigEndian = IsBigEndian();
-
-      // For ZIP_COMPRESSION:
-      //   pixel sample data for channel 0 for scanline 0
-      //   pixel sample data for channel 1 for scanline 0
-      //   pixel sample data for channel ... for scanline 0
-      //   pixel sample data for channel n for scanline 0
-      //   pixel sample data for channel 0 for scanline 1
-      //   pixel sample data for channel 1 for scanline 1
-      //   pixel sample data for channel ... for scanline 1
-      //   pixel sample data for channel n for scanline 1
-      //   ...
-      for (int v = 0; v < numLines; v++) {
-        for (int c = 0; c < numChannels; c++) {
-          for (int u = 0; u < dataWidth; u++) {
-            FP16 hf;
-
-            hf.u = outBuf[v * (numChannels * dataWidth) + (c * dataWidth) + u];
-
-            if (isBigEndian) {
-              swap2(reinterpret_cast<unsigned short*>(&hf.u));
-            }
-
-            FP32 f32 = half_to_float(hf);
-
-            // Assume increasing Y.
-            exrImage->images[c][(lineNo + v) * dataWidth + u] = f32.f;
-          }
-        }
-      }
-
-    } else if (compressionType == 0) { // No compression
-
-      std::vector<unsigned short> srcBuf(numChannels * dataWidth);
-      memcpy(&srcBuf.at(0), dataPtr + 8, numChannels * dataWidth * sizeof(unsigned short));
-
-      bool isBigEndian = IsBigEndian();
-
-      // scanline
-      for (int c = 0; c < numChannels; c++) {
-        for (int u = 0; u < dataWidth; u++) {
-          FP16 hf;
-
-          // Assume (A)BGR
-          hf.u = srcBuf[c * dataWidth + u];
-
-          if (isBigEndian) {
-            swap2(reinterpret_cast<unsigned short*>(&hf.u));
-          }
-
-          FP32 f32 = half_to_float(hf);
-
-          // Assume increasing Y.
-          exrImage->images[c][y * dataWidth + u] = f32.f;
-
-        }
-      }
+  // == SF12 Changes START ========================================================================
+  // Blocks are independent of each other, so they're decoded in parallel
+  {
+    DecodeBlocksArgs args;
+    args.exrImage = exrImage;
+    args.head = head;
+    args.offsets = &offsets.at(0);
+    args.compressionType = compressionType;
+    args.numScanlineBlocks = numScanlineBlocks;
+    args.numChannels = numChannels;
+    args.dataWidth = dataWidth;
+    args.dataHeight = dataHeight;
+
+    if (UseParallelBlocks(options) && numBlocks > 1) {
+      SampleFramework12::Tasks::ParallelFor(SampleFramework12::uint32(numBlocks), 1, DecodeBlocksTask, &args);
     } else {
-      if (err) {
-        (*err) = "Unsupported format.";
-      }
-      return -10;
+      DecodeBlocksTask(0, numBlocks, 0, &args);
     }
   }
+  // == SF12 Changes END ==========================================================================
 
   {
     exrImage->channel_names =
@@ -7538,217 +7822,311 @@ int SaveEXR(const float *in_rgba, int width, int height, const char *filename,
 }
 #endif
 
-int SaveMultiChannelEXR(const EXRImage *exrImage, const char *filename,
-                        const char **err) {
-  if (exrImage == NULL || filename == NULL) {
-    if (err) {
-      (*err) = "Invalid argument.";
-    }
-    return -1;
-  }
+// == SF12 Changes START ==========================================================================
+
+struct EXRStreamWriter {
+  FILE *fp;
+  int width;
+  int height;
+  int numChannels;
+  std::vector<int> channelComponents;
+  int pixelStride;
+  bool parallel;
+
+  std::vector<long long> offsets;
+  long offsetTablePos;
+  long long nextOffset;
+  int numBlocksWritten;
+  int numLinesWritten;
+
+  // Scanlines that don't fill a complete block yet, stored planar
+  std::vector<float> pending;
+  int numPendingLines;
+};
 
-  FILE *fp = fopen(filename, "wb");
-  if (!fp) {
-    if (err) {
-      (*err) = "Cannot write a file.";
-    }
-    return -1;
+namespace {
+
+void WriteEncodedBlocks(EXRStreamWriter *writer,
+                        const std::vector<std::vector<unsigned char> > &blocks) {
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const std::vector<unsigned char> &block = blocks[i];
+    size_t n = fwrite(&block.at(0), 1, block.size(), writer->fp);
+    assert(n == block.size());
+
+    writer->offsets[writer->numBlocksWritten++] = writer->nextOffset;
+    writer->nextOffset += block.size();
   }
+}
 
-  // Header
-  {
-    const char header[] = {0x76, 0x2f, 0x31, 0x01};
-    size_t n = fwrite(header, 1, 4, fp);
-    assert(n == 4);
+// Encodes and writes whole blocks straight from the source, in batches so that
+// only a bounded amount of compressed data is held in memory at a time
+void WriteBlocksFromSource(EXRStreamWriter *writer, const EXRPixelSource &src,
+                           int srcStartY, int numLines) {
+  std::vector<std::vector<unsigned char> > blocks;
+  const int linesPerBatch = kMaxBlocksPerBatch * kZipScanlineBlockSize;
+  for (int batchStart = 0; batchStart < numLines; batchStart += linesPerBatch) {
+    const int batchLines = std::min(linesPerBatch, numLines - batchStart);
+    EncodeBlocks(blocks, src, srcStartY + batchStart, writer->width, batchLines,
+                 writer->numLinesWritten, writer->parallel);
+    WriteEncodedBlocks(writer, blocks);
+    writer->numLinesWritten += batchLines;
   }
+}
 
-  // Version, scanline.
-  {
-    const char marker[] = {2, 0, 0, 0};
-    size_t n = fwrite(marker, 1, 4, fp);
-    assert(n == 4);
+void FlushPendingLines(EXRStreamWriter *writer) {
+  if (writer->numPendingLines == 0) {
+    return;
   }
 
-  int numScanlineBlocks = 16; // 16 for ZIP compression.
+  EXRPixelSource src;
+  src.pixelStride = 1;
+  src.rowPitch = writer->width;
+  for (int c = 0; c < writer->numChannels; c++) {
+    src.channels.push_back(&writer->pending[size_t(c) * writer->width *
+                                            kZipScanlineBlockSize]);
+  }
 
-  // Write attributes.
-  {
-    std::vector<unsigned char> data;
+  const int numLines = writer->numPendingLines;
+  writer->numPendingLines = 0;
+  WriteBlocksFromSource(writer, src, 0, numLines);
+}
 
-    std::vector<ChannelInfo> channels;
-    for (int c = 0; c < exrImage->num_channels; c++) {
-      ChannelInfo info;
-      info.pLinear = 0;
-      info.pixelType = 1; // Assume HALF
-      info.xSampling = 1;
-      info.ySampling = 1;
-      info.name = std::string(exrImage->channel_names[c]);
-      channels.push_back(info);
+int WriteScanlines(EXRStreamWriter *writer, const EXRPixelSource &src,
+                   int numLines, const char **err) {
+  if (writer->numLinesWritten + writer->numPendingLines + numLines >
+      writer->height) {
+    if (err) {
+      (*err) = "Too many scanlines.";
     }
-
-    WriteChannelInfo(data, channels);
-
-    WriteAttribute(fp, "channels", "chlist", &data.at(0),
-                   data.size()); // +1 = null
+    return -1;
   }
 
-  {
-    int compressionType = 3; // ZIP compression
-    if (IsBigEndian()) {
-      swap4(reinterpret_cast<unsigned int*>(&compressionType));
+  int srcY = 0;
+
+  // Top up a partial block first
+  if (writer->numPendingLines > 0) {
+    const int numToCopy =
+        std::min(kZipScanlineBlockSize - writer->numPendingLines, numLines);
+    for (int y = 0; y < numToCopy; y++) {
+      for (int c = 0; c < writer->numChannels; c++) {
+        const float *srcLine = src.channels[c] + size_t(y) * src.rowPitch;
+        float *dstLine =
+            &writer->pending[(size_t(c) * kZipScanlineBlockSize +
+                              writer->numPendingLines + y) * writer->width];
+        for (int x = 0; x < writer->width; x++) {
+          dstLine[x] = srcLine[size_t(x) * src.pixelStride];
+        }
+      }
     }
-    WriteAttribute(fp, "compression", "compression",
-                   reinterpret_cast<const unsigned char *>(&compressionType),
-                   1);
-  }
 
-  {
-    int data[4] = {0, 0, exrImage->width - 1, exrImage->height - 1};
-    if (IsBigEndian()) {
-      swap4(reinterpret_cast<unsigned int*>(&data[0]));
-      swap4(reinterpret_cast<unsigned int*>(&data[1]));
-      swap4(reinterpret_cast<unsigned int*>(&data[2]));
-      swap4(reinterpret_cast<unsigned int*>(&data[3]));
+    writer->numPendingLines += numToCopy;
+    srcY = numToCopy;
+
+    if (writer->numPendingLines == kZipScanlineBlockSize) {
+      FlushPendingLines(writer);
     }
-    WriteAttribute(fp, "dataWindow", "box2i",
-                   reinterpret_cast<const unsigned char *>(data),
-                   sizeof(int) * 4);
-    WriteAttribute(fp, "displayWindow", "box2i",
-                   reinterpret_cast<const unsigned char *>(data),
-                   sizeof(int) * 4);
   }
 
-  {
-    unsigned char lineOrder = 0; // increasingY
-    WriteAttribute(fp, "lineOrder", "lineOrder", &lineOrder, 1);
+  // Whole blocks can be encoded without copying, as can the final partial block
+  int numDirectLines = numLines - srcY;
+  const bool isLastBatch =
+      writer->numLinesWritten + numDirectLines == writer->height;
+  if (!isLastBatch) {
+    numDirectLines -= numDirectLines % kZipScanlineBlockSize;
   }
 
-  {
-    float aspectRatio = 1.0f;
-    if (IsBigEndian()) {
-      swap4(reinterpret_cast<unsigned int*>(&aspectRatio));
-    }
-    WriteAttribute(fp, "pixelAspectRatio", "float",
-                   reinterpret_cast<const unsigned char *>(&aspectRatio),
-                   sizeof(float));
+  if (numDirectLines > 0) {
+    WriteBlocksFromSource(writer, src, srcY, numDirectLines);
+    srcY += numDirectLines;
   }
 
-  {
-    float center[2] = {0.0f, 0.0f};
-    if (IsBigEndian()) {
-      swap4(reinterpret_cast<unsigned int*>(&center[0]));
-      swap4(reinterpret_cast<unsigned int*>(&center[1]));
+  // Keep the rest for the next batch
+  for (int y = srcY; y < numLines; y++) {
+    for (int c = 0; c < writer->numChannels; c++) {
+      const float *srcLine = src.channels[c] + size_t(y) * src.rowPitch;
+      float *dstLine =
+          &writer->pending[(size_t(c) * kZipScanlineBlockSize +
+                            writer->numPendingLines) * writer->width];
+      for (int x = 0; x < writer->width; x++) {
+        dstLine[x] = srcLine[size_t(x) * src.pixelStride];
+      }
     }
-    WriteAttribute(fp, "screenWindowCenter", "v2f",
-                   reinterpret_cast<const unsigned char *>(center),
-                   2 * sizeof(float));
+    writer->numPendingLines++;
   }
 
-  {
-    float w = (float)exrImage->width;
-    if (IsBigEndian()) {
-      swap4(reinterpret_cast<unsigned int*>(&w));
-    }
-    WriteAttribute(fp, "screenWindowWidth", "float",
-                   reinterpret_cast<const unsigned char *>(&w), sizeof(float));
+  if (writer->numLinesWritten + writer->numPendingLines == writer->height) {
+    FlushPendingLines(writer);
   }
 
-  { // end of header
-    unsigned char e = 0;
-    fwrite(&e, 1, 1, fp);
+  return 0;
+}
+
+} // namespace
+
+EXRStreamWriter *BeginEXRStream(const char *filename, int width, int height,
+                                int num_channels, const char **channel_names,
+                                const int *channel_components, int pixel_stride,
+                                const EXRCodecOptions *options,
+                                const char **err) {
+  if (filename == NULL || channel_names == NULL || channel_components == NULL ||
+      width <= 0 || height <= 0 || num_channels < 1 || pixel_stride < 1) {
+    if (err) {
+      (*err) = "Invalid argument.";
+    }
+    return NULL;
   }
 
-  int numBlocks = exrImage->height / numScanlineBlocks;
-  if (numBlocks * numScanlineBlocks < exrImage->height) {
-    numBlocks++;
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) {
+    if (err) {
+      (*err) = "Cannot write a file.";
+    }
+    return NULL;
   }
 
-  std::vector<long long> offsets(numBlocks);
+  WriteEXRHeader(fp, width, height, num_channels, channel_names);
 
-  size_t headerSize = ftell(fp); // sizeof(header)
-  long long offset =
-      headerSize +
-      numBlocks * sizeof(long long); // sizeof(header) + sizeof(offsetTable)
+  EXRStreamWriter *writer = new EXRStreamWriter();
+  writer->fp = fp;
+  writer->width = width;
+  writer->height = height;
+  writer->numChannels = num_channels;
+  writer->channelComponents.assign(channel_components,
+                                   channel_components + num_channels);
+  writer->pixelStride = pixel_stride;
+  writer->parallel = UseParallelBlocks(options);
 
-  std::vector<unsigned char> data;
+  int numBlocks = height / kZipScanlineBlockSize;
+  if (numBlocks * kZipScanlineBlockSize < height) {
+    numBlocks++;
+  }
 
+  // The offset table is filled in once all of the blocks have been written
+  writer->offsets.resize(numBlocks, 0);
+  writer->offsetTablePos = ftell(fp);
+  writer->nextOffset = writer->offsetTablePos + numBlocks * sizeof(long long);
+  writer->numBlocksWritten = 0;
+  writer->numLinesWritten = 0;
+  writer->pending.resize(size_t(num_channels) * width * kZipScanlineBlockSize);
+  writer->numPendingLines = 0;
 
-  bool isBigEndian = IsBigEndian();
+  size_t n = fwrite(&writer->offsets.at(0), 1, sizeof(long long) * numBlocks, fp);
+  assert(n == sizeof(long long) * numBlocks);
 
-  for (int i = 0; i < numBlocks; i++) {
-    int startY = numScanlineBlocks * i;
-    int endY = std::min(numScanlineBlocks * (i + 1), exrImage->height);
-    int h = endY - startY;
+  return writer;
+}
 
-    std::vector<unsigned short> buf(exrImage->num_channels * exrImage->width *
-                                    h);
+int WriteEXRStreamScanlines(EXRStreamWriter *writer, const float *scanlines,
+                            int num_lines, const char **err) {
+  if (writer == NULL || scanlines == NULL || num_lines < 0) {
+    if (err) {
+      (*err) = "Invalid argument.";
+    }
+    return -1;
+  }
 
-    for (int y = 0; y < h; y++) {
-      for (int c = 0; c < exrImage->num_channels; c++) {
-        for (int x = 0; x < exrImage->width; x++) {
-          FP32 f32;
-          f32.f = exrImage->images[c][(y + startY) * exrImage->width + x];
+  EXRPixelSource src;
+  src.pixelStride = writer->pixelStride;
+  src.rowPitch = writer->width * writer->pixelStride;
+  for (int c = 0; c < writer->numChannels; c++) {
+    src.channels.push_back(scanlines + writer->channelComponents[c]);
+  }
 
-          FP16 h16;
-          h16 = float_to_half_full(f32);
+  return WriteScanlines(writer, src, num_lines, err);
+}
 
-          if (isBigEndian) {
-            swap2(reinterpret_cast<unsigned short*>(&h16.u));
-          }
+int EndEXRStream(EXRStreamWriter *writer, const char **err) {
+  if (writer == NULL) {
+    if (err) {
+      (*err) = "Invalid argument.";
+    }
+    return -1;
+  }
 
-          // Assume increasing Y
-          buf[exrImage->num_channels * y * exrImage->width +
-              c * exrImage->width + x] = h16.u;
-        }
+  int ret = 0;
+  if (writer->numLinesWritten != writer->height) {
+    if (err) {
+      (*err) = "Not all scanlines were written.";
+    }
+    ret = -1;
+  } else {
+    std::vector<long long> offsets = writer->offsets;
+    if (IsBigEndian()) {
+      for (size_t i = 0; i < offsets.size(); i++) {
+        swap8(reinterpret_cast<unsigned long long*>(&offsets[i]));
       }
     }
 
-    int bound = miniz::mz_compressBound(buf.size() * sizeof(unsigned short));
+    fseek(writer->fp, writer->offsetTablePos, SEEK_SET);
+    size_t n = fwrite(&offsets.at(0), 1, sizeof(long long) * offsets.size(), writer->fp);
+    assert(n == sizeof(long long) * offsets.size());
+  }
 
-    std::vector<unsigned char> block(
-        miniz::mz_compressBound(buf.size() * sizeof(unsigned short)));
-    unsigned long long outSize = block.size();
+  fclose(writer->fp);
+  delete writer;
 
-    CompressZip(&block.at(0), outSize,
-                reinterpret_cast<const unsigned char *>(&buf.at(0)),
-                buf.size() * sizeof(unsigned short));
+  return ret;
+}
 
-    // 4 byte: scan line
-    // 4 byte: data size
-    // ~     : pixel data(compressed)
-    std::vector<unsigned char> header(8);
-    unsigned int dataLen = outSize; // truncate
-    memcpy(&header.at(0), &startY, sizeof(int));
-    memcpy(&header.at(4), &dataLen, sizeof(unsigned int));
+void InitEXRCodecOptions(EXRCodecOptions *options) { options->parallel = 1; }
 
-    if (IsBigEndian()) {
-      swap4(reinterpret_cast<unsigned int*>(&header.at(0)));
-      swap4(reinterpret_cast<unsigned int*>(&header.at(4)));
+void FreeEXRImage(EXRImage *exrImage) {
+  if (exrImage == NULL) {
+    return;
+  }
+
+  for (int c = 0; c < exrImage->num_channels; c++) {
+    if (exrImage->images) {
+      free(exrImage->images[c]);
+    }
+    if (exrImage->channel_names) {
+      free(const_cast<char *>(exrImage->channel_names[c]));
     }
+  }
 
-    data.insert(data.end(), header.begin(), header.end());
-    data.insert(data.end(), block.begin(), block.begin() + dataLen);
+  free(exrImage->images);
+  free(exrImage->channel_names);
+  exrImage->images = NULL;
+  exrImage->channel_names = NULL;
+  exrImage->num_channels = 0;
+}
 
-    offsets[i] = offset;
-    if (IsBigEndian()) {
-      swap8(reinterpret_cast<unsigned long long*>(&offsets[i]));
+// == SF12 Changes END ============================================================================
+
+int SaveMultiChannelEXR(const EXRImage *exrImage, const char *filename,
+                        const char **err) {
+  if (exrImage == NULL || filename == NULL) {
+    if (err) {
+      (*err) = "Invalid argument.";
     }
-    offset += dataLen + 8; // 8 = sizeof(blockHeader)
+    return -1;
   }
 
-  {
-    size_t n = fwrite(&offsets.at(0), 1, sizeof(unsigned long long) * numBlocks, fp);
-    assert(n == sizeof(unsigned long long) * numBlocks);
+  // == SF12 Changes START ========================================================================
+  // Goes through the streaming writer, with the planar channels as the source
+  std::vector<int> channelComponents(exrImage->num_channels, 0);
+  EXRStreamWriter *writer = BeginEXRStream(
+      filename, exrImage->width, exrImage->height, exrImage->num_channels,
+      exrImage->channel_names, &channelComponents.at(0), 1, NULL, err);
+  if (writer == NULL) {
+    return -1;
   }
 
-  {
-    size_t n = fwrite(&data.at(0), 1, data.size(), fp);
-    assert(n == data.size());
+  EXRPixelSource src;
+  src.pixelStride = 1;
+  src.rowPitch = exrImage->width;
+  for (int c = 0; c < exrImage->num_channels; c++) {
+    src.channels.push_back(exrImage->images[c]);
   }
 
-  fclose(fp);
+  int ret = WriteScanlines(writer, src, exrImage->height, err);
+  if (ret != 0) {
+    EndEXRStream(writer, NULL);
+    return ret;
+  }
 
-  return 0; // OK
+  return EndEXRStream(writer, err);
+  // == SF12 Changes END ==========================================================================
 }
 
 int LoadDeepEXR(DeepImage *deepImage, const char *filename, const char **err) {
@@ -77,6 +77,55 @@ extern int LoadMultiChannelEXR(EXRImage *image, const char *filename,
 extern int SaveMultiChannelEXR(const EXRImage *image, const char *filename,
                                const char **err);
 
+// == SF12 Changes START ==========================================================================
+
+// Options for the SF12 block codec. Functions that take a pointer to these
+// use the defaults when it's NULL.
+typedef struct {
+  int parallel; // Compress/decompress blocks of scanlines in parallel on the
+                // framework's task scheduler (default 1)
+} EXRCodecOptions;
+
+// Fills out the default options
+extern void InitEXRCodecOptions(EXRCodecOptions *options);
+
+// Same as LoadEXR and LoadMultiChannelEXR, with explicit codec options
+extern int LoadEXRWithOptions(float **out_rgba, int *width, int *height,
+                              const char *filename,
+                              const EXRCodecOptions *options,
+                              const char **err);
+extern int LoadMultiChannelEXRWithOptions(EXRImage *image,
+                                          const char *filename,
+                                          const EXRCodecOptions *options,
+                                          const char **err);
+
+// Frees the memory allocated by LoadMultiChannelEXR
+extern void FreeEXRImage(EXRImage *image);
+
+// Streaming ZIP-compressed writer, which takes scanlines from top to bottom in
+// batches of any size so that the whole image never needs to be in memory at
+// once. Each channel is read from `channel_components[c]` floats into every
+// pixel, with `pixel_stride` floats between pixels (e.g. 4 for RGBA). Channel
+// names must be in alphabetical order.
+// EndEXRStream writes the offset table, closes the file and frees the writer.
+// Return 0 if success
+// Returns error string in `err` when there's an error
+typedef struct EXRStreamWriter EXRStreamWriter;
+
+extern EXRStreamWriter *BeginEXRStream(const char *filename, int width,
+                                       int height, int num_channels,
+                                       const char **channel_names,
+                                       const int *channel_components,
+                                       int pixel_stride,
+                                       const EXRCodecOptions *options,
+                                       const char **err);
+extern int WriteEXRStreamScanlines(EXRStreamWriter *writer,
+                                   const float *scanlines, int num_lines,
+                                   const char **err);
+extern int EndEXRStream(EXRStreamWriter *writer, const char **err);
+
+// == SF12 Changes END ============================================================================
+
 // Loads single-frame OpenEXR deep image.
 // Application must free memory of variables in DeepImage(image, offset_table)
 // Return 0 if success
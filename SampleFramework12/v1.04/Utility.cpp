@@ -16,12 +16,51 @@
 namespace SampleFramework12
 {
 
+LogRing GlobalLogRing;
+
+static const uint64 LogRingCapacity = 2048;
+
+static void OutputLogMessage(const char* msg, uint64, void*)
+{
+    if(GlobalApp != nullptr)
+        GlobalApp->AddToLog(msg);
+
+    OutputDebugStringA(msg);
+    OutputDebugStringA("\n");
+}
+
+void InitializeLog()
+{
+    GlobalLogRing.Initialize(LogRingCapacity, OutputLogMessage, nullptr);
+}
+
+void ShutdownLog()
+{
+    GlobalLogRing.Drain();
+    GlobalLogRing.Shutdown();
+}
+
+void DrainLog()
+{
+    GlobalLogRing.Drain();
+}
+
 void WriteLog(const wchar* format, ...)
 {
     wchar buffer[1024 * 8] = { 0 };
     va_list args;
     va_start(args, format);
     int32 len = vswprintf_s(buffer, ArraySize_(buffer) - 1, format, args);
+
+    if(GlobalLogRing.Initialized())
+    {
+        // Convert straight into a stack buffer rather than going through a std::string
+        char ansiBuffer[1024 * 16] = { 0 };
+        const int32 ansiLen = WideCharToMultiByte(CP_ACP, 0, buffer, len, ansiBuffer, int32(ArraySize_(ansiBuffer) - 1), NULL, NULL);
+        GlobalLogRing.WriteText(ansiBuffer, uint64(Max(ansiLen, 0)));
+        return;
+    }
+
     if(GlobalApp != nullptr)
         GlobalApp->AddToLog(WStringToAnsi(buffer).c_str());
 
@@ -36,6 +75,13 @@ void WriteLog(const char* format, ...)
     va_list args;
     va_start(args, format);
     int32 len = vsprintf_s(buffer, ArraySize_(buffer) - 1, format, args);
+
+    if(GlobalLogRing.Initialized())
+    {
+        GlobalLogRing.WriteText(buffer, uint64(Max(len, 0)));
+        return;
+    }
+
     if(GlobalApp != nullptr)
         GlobalApp->AddToLog(buffer);
 
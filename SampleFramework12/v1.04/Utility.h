@@ -16,6 +16,7 @@
 #include "SF12_Math.h"
 #include "SF12_Assert.h"
 #include "Containers.h"
+#include "LogRing.h"
 
 namespace SampleFramework12
 {
@@ -95,9 +96,29 @@ inline List<std::string> Split(const std::string& str, const std::string& delimi
     return parts;
 }
 
+// Once InitializeLog() has been called, log messages go into a lock-free ring that the main thread drains
+// with DrainLog(), which is what forwards them to the debugger output and the in-app log. Before that (and
+// after ShutdownLog()) messages are written out immediately.
+extern LogRing GlobalLogRing;
+
+void InitializeLog();
+void ShutdownLog();
+void DrainLog();
+
 void WriteLog(const wchar* format, ...);
 void WriteLog(const char* format, ...);
 
+// Calls with a string literal format and at least one argument don't format anything on the calling thread:
+// the arguments (and copies of the format and any strings) get packed into the ring, and snprintf runs when the
+// ring is drained.
+template<uint64 N, typename... Args> void WriteLog(const char (&format)[N], Args... args)
+{
+    if(GlobalLogRing.Initialized())
+        GlobalLogRing.Write(format, args...);
+    else
+        WriteLog(static_cast<const char*>(format), args...);
+}
+
 std::wstring MakeString(const wchar* format, ...);
 std::string MakeString(const char* format, ...);
 
@@ -0,0 +1,504 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#include "PCH.h"
+#include "XXHash.h"
+#include "MurmurHash.h"
+
+// Based on the reference implementation of XXH3 from xxHash, by Yann Collet (BSD 2-Clause license)
+
+namespace SampleFramework12
+{
+
+static const uint64 StripeLen = 64;
+static const uint64 SecretConsumeRate = 8;
+static const uint64 SecretLimit = XXH3Hasher::SecretSize - StripeLen;
+static const uint64 StripesPerBlock = SecretLimit / SecretConsumeRate;
+static const uint64 MidSizeMax = 240;
+static const uint64 MidSizeStartOffset = 3;
+static const uint64 MidSizeLastOffset = 17;
+static const uint64 SecretSizeMin = 136;
+static const uint64 SecretLastAccStart = 7;
+static const uint64 SecretMergeAccsStart = 11;
+
+static const uint32 Prime32_1 = 0x9E3779B1U;
+static const uint32 Prime32_2 = 0x85EBCA77U;
+static const uint32 Prime32_3 = 0xC2B2AE3DU;
+static const uint64 Prime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64 Prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64 Prime64_3 = 0x165667B19E3779F9ULL;
+static const uint64 Prime64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64 Prime64_5 = 0x27D4EB2F165667C5ULL;
+static const uint64 PrimeMX1 = 0x165667919E3779F9ULL;
+static const uint64 PrimeMX2 = 0x9FB21C651E98DF25ULL;
+
+// Pseudorandom secret taken directly from FARSH
+alignas(64) static const uint8 DefaultSecret[XXH3Hasher::SecretSize] =
+{
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static const uint64 InitialAcc[8] =
+{
+    Prime32_3, Prime64_1, Prime64_2, Prime64_3, Prime64_4, Prime32_2, Prime64_5, Prime32_1
+};
+
+// == Helpers =====================================================================================
+
+static uint32 Read32(const uint8* p)
+{
+    uint32 result;
+    memcpy(&result, p, sizeof(result));
+    return result;
+}
+
+static uint64 Read64(const uint8* p)
+{
+    uint64 result;
+    memcpy(&result, p, sizeof(result));
+    return result;
+}
+
+static void Write64(uint8* p, uint64 value)
+{
+    memcpy(p, &value, sizeof(value));
+}
+
+static uint64 XorShift64(uint64 v, int shift)
+{
+    return v ^ (v >> shift);
+}
+
+static Hash Mul64To128(uint64 lhs, uint64 rhs)
+{
+    uint64 high = 0;
+    const uint64 low = _umul128(lhs, rhs, &high);
+    return Hash(low, high);
+}
+
+static uint64 Mul128Fold64(uint64 lhs, uint64 rhs)
+{
+    const Hash product = Mul64To128(lhs, rhs);
+    return product.A ^ product.B;
+}
+
+static uint64 XXH64Avalanche(uint64 h)
+{
+    h ^= h >> 33;
+    h *= Prime64_2;
+    h ^= h >> 29;
+    h *= Prime64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64 Avalanche(uint64 h)
+{
+    h = XorShift64(h, 37);
+    h *= PrimeMX1;
+    h = XorShift64(h, 32);
+    return h;
+}
+
+static uint64 Mix16B(const uint8* input, const uint8* secret, uint64 seed)
+{
+    const uint64 inputLo = Read64(input);
+    const uint64 inputHi = Read64(input + 8);
+    return Mul128Fold64(inputLo ^ (Read64(secret) + seed), inputHi ^ (Read64(secret + 8) - seed));
+}
+
+static Hash Mix32B(Hash acc, const uint8* input1, const uint8* input2, const uint8* secret, uint64 seed)
+{
+    acc.A += Mix16B(input1, secret, seed);
+    acc.A ^= Read64(input2) + Read64(input2 + 8);
+    acc.B += Mix16B(input2, secret + 16, seed);
+    acc.B ^= Read64(input1) + Read64(input1 + 8);
+    return acc;
+}
+
+// == Short and medium inputs =====================================================================
+
+static Hash HashLen1To3(const uint8* input, uint64 len, const uint8* secret, uint64 seed)
+{
+    const uint8 c1 = input[0];
+    const uint8 c2 = input[len >> 1];
+    const uint8 c3 = input[len - 1];
+    const uint32 combinedLo = (uint32(c1) << 16) | (uint32(c2) << 24) | (uint32(c3) << 0) | (uint32(len) << 8);
+    const uint32 combinedHi = _rotl(_byteswap_ulong(combinedLo), 13);
+    const uint64 bitFlipLo = (Read32(secret) ^ Read32(secret + 4)) + seed;
+    const uint64 bitFlipHi = (Read32(secret + 8) ^ Read32(secret + 12)) - seed;
+    return Hash(XXH64Avalanche(uint64(combinedLo) ^ bitFlipLo), XXH64Avalanche(uint64(combinedHi) ^ bitFlipHi));
+}
+
+static Hash HashLen4To8(const uint8* input, uint64 len, const uint8* secret, uint64 seed)
+{
+    seed ^= uint64(_byteswap_ulong(uint32(seed))) << 32;
+    const uint32 inputLo = Read32(input);
+    const uint32 inputHi = Read32(input + len - 4);
+    const uint64 input64 = inputLo + (uint64(inputHi) << 32);
+    const uint64 bitFlip = (Read64(secret + 16) ^ Read64(secret + 24)) + seed;
+    const uint64 keyed = input64 ^ bitFlip;
+
+    Hash m128 = Mul64To128(keyed, Prime64_1 + (len << 2));
+    m128.B += (m128.A << 1);
+    m128.A ^= (m128.B >> 3);
+
+    m128.A = XorShift64(m128.A, 35);
+    m128.A *= PrimeMX2;
+    m128.A = XorShift64(m128.A, 28);
+    m128.B = Avalanche(m128.B);
+    return m128;
+}
+
+static Hash HashLen9To16(const uint8* input, uint64 len, const uint8* secret, uint64 seed)
+{
+    const uint64 bitFlipLo = (Read64(secret + 32) ^ Read64(secret + 40)) - seed;
+    const uint64 bitFlipHi = (Read64(secret + 48) ^ Read64(secret + 56)) + seed;
+    const uint64 inputLo = Read64(input);
+    uint64 inputHi = Read64(input + len - 8);
+
+    Hash m128 = Mul64To128(inputLo ^ inputHi ^ bitFlipLo, Prime64_1);
+    m128.A += uint64(len - 1) << 54;
+    inputHi ^= bitFlipHi;
+    m128.B += inputHi + uint64(uint32(inputHi)) * (Prime32_2 - 1);
+    m128.A ^= _byteswap_uint64(m128.B);
+
+    Hash h128 = Mul64To128(m128.A, Prime64_2);
+    h128.B += m128.B * Prime64_2;
+    h128.A = Avalanche(h128.A);
+    h128.B = Avalanche(h128.B);
+    return h128;
+}
+
+static Hash HashLen0To16(const uint8* input, uint64 len, const uint8* secret, uint64 seed)
+{
+    if(len > 8)
+        return HashLen9To16(input, len, secret, seed);
+    if(len >= 4)
+        return HashLen4To8(input, len, secret, seed);
+    if(len > 0)
+        return HashLen1To3(input, len, secret, seed);
+
+    const uint64 bitFlipLo = Read64(secret + 64) ^ Read64(secret + 72);
+    const uint64 bitFlipHi = Read64(secret + 80) ^ Read64(secret + 88);
+    return Hash(XXH64Avalanche(seed ^ bitFlipLo), XXH64Avalanche(seed ^ bitFlipHi));
+}
+
+static Hash FinalizeMidSize(Hash acc, uint64 len, uint64 seed)
+{
+    Hash h128;
+    h128.A = acc.A + acc.B;
+    h128.B = (acc.A * Prime64_1) + (acc.B * Prime64_4) + ((len - seed) * Prime64_2);
+    h128.A = Avalanche(h128.A);
+    h128.B = 0 - Avalanche(h128.B);
+    return h128;
+}
+
+static Hash HashLen17To128(const uint8* input, uint64 len, const uint8* secret, uint64 seed)
+{
+    Hash acc(len * Prime64_1, 0);
+    if(len > 32)
+    {
+        if(len > 64)
+        {
+            if(len > 96)
+                acc = Mix32B(acc, input + 48, input + len - 64, secret + 96, seed);
+            acc = Mix32B(acc, input + 32, input + len - 48, secret + 64, seed);
+        }
+        acc = Mix32B(acc, input + 16, input + len - 32, secret + 32, seed);
+    }
+    acc = Mix32B(acc, input, input + len - 16, secret, seed);
+
+    return FinalizeMidSize(acc, len, seed);
+}
+
+static Hash HashLen129To240(const uint8* input, uint64 len, const uint8* secret, uint64 seed)
+{
+    Hash acc(len * Prime64_1, 0);
+    for(uint64 i = 32; i < 160; i += 32)
+        acc = Mix32B(acc, input + i - 32, input + i - 16, secret + i - 32, seed);
+
+    acc.A = Avalanche(acc.A);
+    acc.B = Avalanche(acc.B);
+    for(uint64 i = 160; i <= len; i += 32)
+        acc = Mix32B(acc, input + i - 32, input + i - 16, secret + MidSizeStartOffset + i - 160, seed);
+
+    acc = Mix32B(acc, input + len - 16, input + len - 32, secret + SecretSizeMin - MidSizeLastOffset - 16, 0 - seed);
+
+    return FinalizeMidSize(acc, len, seed);
+}
+
+// == Long inputs =================================================================================
+
+// Processes one 64-byte stripe into the 8 accumulator lanes
+static void Accumulate512(uint64* acc, const uint8* input, const uint8* secret)
+{
+    #if defined(_XM_SSE_INTRINSICS_)
+        __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+        const __m128i* xinput = reinterpret_cast<const __m128i*>(input);
+        const __m128i* xsecret = reinterpret_cast<const __m128i*>(secret);
+        for(uint64 i = 0; i < StripeLen / sizeof(__m128i); ++i)
+        {
+            const __m128i dataVec = _mm_loadu_si128(xinput + i);
+            const __m128i keyVec = _mm_loadu_si128(xsecret + i);
+            const __m128i dataKey = _mm_xor_si128(dataVec, keyVec);
+
+            // acc += (dataKey & 0xFFFFFFFF) * (dataKey >> 32), plus the input with the lanes swapped
+            const __m128i dataKeyHi = _mm_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1));
+            const __m128i product = _mm_mul_epu32(dataKey, dataKeyHi);
+            const __m128i dataSwap = _mm_shuffle_epi32(dataVec, _MM_SHUFFLE(1, 0, 3, 2));
+            xacc[i] = _mm_add_epi64(product, _mm_add_epi64(xacc[i], dataSwap));
+        }
+    #else
+        for(uint64 lane = 0; lane < 8; ++lane)
+        {
+            const uint64 dataVal = Read64(input + lane * 8);
+            const uint64 dataKey = dataVal ^ Read64(secret + lane * 8);
+            acc[lane ^ 1] += dataVal;
+            acc[lane] += uint64(uint32(dataKey)) * (dataKey >> 32);
+        }
+    #endif
+}
+
+static void ScrambleAcc(uint64* acc, const uint8* secret)
+{
+    #if defined(_XM_SSE_INTRINSICS_)
+        __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+        const __m128i* xsecret = reinterpret_cast<const __m128i*>(secret);
+        const __m128i prime32 = _mm_set1_epi32(int(Prime32_1));
+        for(uint64 i = 0; i < StripeLen / sizeof(__m128i); ++i)
+        {
+            const __m128i accVec = xacc[i];
+            const __m128i dataVec = _mm_xor_si128(accVec, _mm_srli_epi64(accVec, 47));
+            const __m128i dataKey = _mm_xor_si128(dataVec, _mm_loadu_si128(xsecret + i));
+
+            // 64-bit multiply by a 32-bit constant, using two 32x32->64 multiplies
+            const __m128i dataKeyHi = _mm_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1));
+            const __m128i productLo = _mm_mul_epu32(dataKey, prime32);
+            const __m128i productHi = _mm_mul_epu32(dataKeyHi, prime32);
+            xacc[i] = _mm_add_epi64(productLo, _mm_slli_epi64(productHi, 32));
+        }
+    #else
+        for(uint64 lane = 0; lane < 8; ++lane)
+        {
+            uint64 acc64 = XorShift64(acc[lane], 47);
+            acc64 ^= Read64(secret + lane * 8);
+            acc64 *= Prime32_1;
+            acc[lane] = acc64;
+        }
+    #endif
+}
+
+static void AccumulateStripes(uint64* acc, const uint8* input, const uint8* secret, uint64 numStripes)
+{
+    for(uint64 i = 0; i < numStripes; ++i)
+        Accumulate512(acc, input + i * StripeLen, secret + i * SecretConsumeRate);
+}
+
+static uint64 MergeAccs(const uint64* acc, const uint8* secret, uint64 start)
+{
+    uint64 result = start;
+    for(uint64 i = 0; i < 4; ++i)
+        result += Mul128Fold64(acc[2 * i] ^ Read64(secret + 16 * i), acc[2 * i + 1] ^ Read64(secret + 16 * i + 8));
+    return Avalanche(result);
+}
+
+static Hash MergeAccs128(const uint64* acc, const uint8* secret, uint64 len)
+{
+    Hash h128;
+    h128.A = MergeAccs(acc, secret + SecretMergeAccsStart, len * Prime64_1);
+    h128.B = MergeAccs(acc, secret + XXH3Hasher::SecretSize - sizeof(uint64) * 8 - SecretMergeAccsStart, ~(len * Prime64_2));
+    return h128;
+}
+
+static void InitCustomSecret(uint8* customSecret, uint64 seed)
+{
+    for(uint64 i = 0; i < XXH3Hasher::SecretSize / 16; ++i)
+    {
+        Write64(customSecret + 16 * i, Read64(DefaultSecret + 16 * i) + seed);
+        Write64(customSecret + 16 * i + 8, Read64(DefaultSecret + 16 * i + 8) - seed);
+    }
+}
+
+static Hash HashLong(const uint8* input, uint64 len, const uint8* secret)
+{
+    alignas(16) uint64 acc[8];
+    memcpy(acc, InitialAcc, sizeof(acc));
+
+    const uint64 blockLen = StripeLen * StripesPerBlock;
+    const uint64 numBlocks = (len - 1) / blockLen;
+    for(uint64 n = 0; n < numBlocks; ++n)
+    {
+        AccumulateStripes(acc, input + n * blockLen, secret, StripesPerBlock);
+        ScrambleAcc(acc, secret + SecretLimit);
+    }
+
+    // Last partial block
+    const uint64 numStripes = ((len - 1) - (blockLen * numBlocks)) / StripeLen;
+    AccumulateStripes(acc, input + numBlocks * blockLen, secret, numStripes);
+
+    // Last stripe
+    Accumulate512(acc, input + len - StripeLen, secret + SecretLimit - SecretLastAccStart);
+
+    return MergeAccs128(acc, secret, len);
+}
+
+Hash XXH3Hash128(const void* data, uint64 len, uint64 seed)
+{
+    const uint8* input = reinterpret_cast<const uint8*>(data);
+    if(len <= 16)
+        return HashLen0To16(input, len, DefaultSecret, seed);
+    if(len <= 128)
+        return HashLen17To128(input, len, DefaultSecret, seed);
+    if(len <= MidSizeMax)
+        return HashLen129To240(input, len, DefaultSecret, seed);
+
+    if(seed == 0)
+        return HashLong(input, len, DefaultSecret);
+
+    alignas(16) uint8 customSecret[XXH3Hasher::SecretSize];
+    InitCustomSecret(customSecret, seed);
+    return HashLong(input, len, customSecret);
+}
+
+// == XXH3Hasher ==================================================================================
+
+// Like the block loop in HashLong(), except that it can start and stop partway through a block
+static const uint8* ConsumeStripes(uint64* acc, uint64& numStripesSoFar, const uint8* input, uint64 numStripes, const uint8* secret)
+{
+    const uint8* initialSecret = secret + numStripesSoFar * SecretConsumeRate;
+    if(numStripes >= StripesPerBlock - numStripesSoFar)
+    {
+        uint64 numStripesThisIter = StripesPerBlock - numStripesSoFar;
+        do
+        {
+            AccumulateStripes(acc, input, initialSecret, numStripesThisIter);
+            ScrambleAcc(acc, secret + SecretLimit);
+            input += numStripesThisIter * StripeLen;
+            numStripes -= numStripesThisIter;
+            numStripesThisIter = StripesPerBlock;
+            initialSecret = secret;
+        } while(numStripes >= StripesPerBlock);
+
+        numStripesSoFar = 0;
+    }
+
+    if(numStripes > 0)
+    {
+        AccumulateStripes(acc, input, initialSecret, numStripes);
+        input += numStripes * StripeLen;
+        numStripesSoFar += numStripes;
+    }
+
+    return input;
+}
+
+XXH3Hasher::XXH3Hasher(uint64 seed_)
+{
+    Reset(seed_);
+}
+
+void XXH3Hasher::Reset(uint64 seed_)
+{
+    memcpy(acc, InitialAcc, sizeof(acc));
+    if(seed_ == 0)
+        memcpy(secret, DefaultSecret, sizeof(secret));
+    else
+        InitCustomSecret(secret, seed_);
+
+    seed = seed_;
+    totalLen = 0;
+    bufferedSize = 0;
+    numStripesSoFar = 0;
+}
+
+void XXH3Hasher::Update(const void* data, uint64 len)
+{
+    if(len == 0)
+        return;
+
+    const uint8* input = reinterpret_cast<const uint8*>(data);
+    const uint8* end = input + len;
+    totalLen += len;
+
+    // Small inputs just fill the buffer
+    if(len <= BufferSize - bufferedSize)
+    {
+        memcpy(buffer + bufferedSize, input, len);
+        bufferedSize += len;
+        return;
+    }
+
+    // Complete the buffer and consume it
+    if(bufferedSize > 0)
+    {
+        const uint64 loadSize = BufferSize - bufferedSize;
+        memcpy(buffer + bufferedSize, input, loadSize);
+        input += loadSize;
+        ConsumeStripes(acc, numStripesSoFar, buffer, BufferSize / StripeLen, secret);
+        bufferedSize = 0;
+    }
+
+    // Consume the input in place, keeping the last stripe around in case it's needed by Finalize()
+    if(uint64(end - input) > BufferSize)
+    {
+        const uint64 numStripes = uint64(end - 1 - input) / StripeLen;
+        input = ConsumeStripes(acc, numStripesSoFar, input, numStripes, secret);
+        memcpy(buffer + BufferSize - StripeLen, input - StripeLen, StripeLen);
+    }
+
+    // There's always some input left over, which gets buffered
+    memcpy(buffer, input, uint64(end - input));
+    bufferedSize = uint64(end - input);
+}
+
+Hash XXH3Hasher::Finalize() const
+{
+    if(totalLen <= MidSizeMax)
+        return XXH3Hash128(buffer, totalLen, seed);
+
+    // Work on a copy of the accumulators so that more data can be added afterwards
+    alignas(16) uint64 finalAcc[8];
+    memcpy(finalAcc, acc, sizeof(finalAcc));
+
+    uint8 lastStripe[StripeLen];
+    const uint8* lastStripePtr = nullptr;
+    if(bufferedSize >= StripeLen)
+    {
+        const uint64 numStripes = (bufferedSize - 1) / StripeLen;
+        uint64 finalStripesSoFar = numStripesSoFar;
+        ConsumeStripes(finalAcc, finalStripesSoFar, buffer, numStripes, secret);
+        lastStripePtr = buffer + bufferedSize - StripeLen;
+    }
+    else
+    {
+        // The last stripe straddles the end of the previous buffer contents
+        const uint64 catchupSize = StripeLen - bufferedSize;
+        memcpy(lastStripe, buffer + BufferSize - catchupSize, catchupSize);
+        memcpy(lastStripe + catchupSize, buffer, bufferedSize);
+        lastStripePtr = lastStripe;
+    }
+
+    Accumulate512(finalAcc, lastStripePtr, secret + SecretLimit - SecretLastAccStart);
+
+    return MergeAccs128(finalAcc, secret, totalLen);
+}
+
+}
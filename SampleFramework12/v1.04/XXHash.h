@@ -0,0 +1,50 @@
+//=================================================================================================
+//
+//  MJP's DX12 Sample Framework
+//  https://therealmjp.github.io/
+//
+//  All code licensed under the MIT license
+//
+//=================================================================================================
+
+#pragma once
+
+#include "PCH.h"
+
+namespace SampleFramework12
+{
+
+struct Hash;
+
+// 128-bit XXH3 (https://github.com/Cyan4973/xxHash), which produces the same results as the reference
+// XXH3_128bits_withSeed() with A as the low 64 bits and B as the high 64 bits. Long inputs are processed
+// in 64-byte stripes using SSE2.
+Hash XXH3Hash128(const void* data, uint64 len, uint64 seed = 0);
+
+// Incremental version of XXH3Hash128(), which gives the same result as hashing all of the data at once
+class XXH3Hasher
+{
+
+public:
+
+    static const uint64 SecretSize = 192;
+    static const uint64 BufferSize = 256;
+
+    explicit XXH3Hasher(uint64 seed = 0);
+
+    void Reset(uint64 seed = 0);
+    void Update(const void* data, uint64 len);
+    Hash Finalize() const;
+
+protected:
+
+    alignas(16) uint64 acc[8] = { };
+    alignas(16) uint8 secret[SecretSize] = { };
+    alignas(16) uint8 buffer[BufferSize] = { };
+    uint64 seed = 0;
+    uint64 totalLen = 0;
+    uint64 bufferedSize = 0;
+    uint64 numStripesSoFar = 0;
+};
+
+}